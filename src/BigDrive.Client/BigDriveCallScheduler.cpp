@@ -0,0 +1,387 @@
+// <copyright file="BigDriveCallScheduler.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveCallScheduler.h"
+
+/// <inheritdoc />
+BigDriveCallScheduler::BigDriveCallScheduler(ULONG defaultProviderLimit, DWORD agingMs)
+    : m_defaultProviderLimit((defaultProviderLimit == 0) ? 1 : defaultProviderLimit),
+    m_agingMs(agingMs),
+    m_pProviders(nullptr),
+    m_sequence(0),
+    m_admittedCount(0),
+    m_waitedCount(0),
+    m_promotedCount(0),
+    m_timedOutCount(0)
+{
+    ::InitializeSRWLock(&m_lock);
+    ::InitializeConditionVariable(&m_admitted);
+}
+
+/// <inheritdoc />
+BigDriveCallScheduler::~BigDriveCallScheduler()
+{
+    BigDriveCallSchedulerProvider* pProvider = nullptr;
+
+    while (m_pProviders)
+    {
+        pProvider = m_pProviders;
+        m_pProviders = pProvider->pNext;
+        delete pProvider;
+    }
+}
+
+/// <inheritdoc />
+BigDriveCallScheduler& BigDriveCallScheduler::GetInstance()
+{
+    static BigDriveCallScheduler* s_pInstance = new BigDriveCallScheduler(DefaultProviderLimit, DefaultAgingMs);
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveCallScheduler::SetProviderLimits(REFCLSID providerClsid, ULONG limit, ULONG ratePerSecond, ULONG burst)
+{
+    HRESULT hr = S_OK;
+    BigDriveCallSchedulerProvider* pProvider = nullptr;
+    ULONGLONG ullNow = 0;
+
+    if ((limit == 0) || ((ratePerSecond > 0) && (burst == 0)))
+    {
+        return E_INVALIDARG;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    hr = GetProvider(providerClsid, &pProvider);
+    if (SUCCEEDED(hr))
+    {
+        ullNow = ::GetTickCount64();
+
+        pProvider->limit = limit;
+        pProvider->ratePerSecond = ratePerSecond;
+        pProvider->burst = burst;
+        pProvider->milliTokens = static_cast<ULONGLONG>(burst) * 1000;
+        pProvider->ullRefilled = ullNow;
+
+        // Raised limits may let waiting requests in
+        Dispatch(pProvider, ullNow);
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveCallScheduler::Enter(REFCLSID providerClsid, BigDriveCallPriority priority, DWORD dwTimeoutMs)
+{
+    HRESULT hr = S_OK;
+    BigDriveCallSchedulerProvider* pProvider = nullptr;
+    BigDriveCallSchedulerWaiter waiter;
+    ULONGLONG ullStart = 0;
+    ULONGLONG ullNow = 0;
+    ULONGLONG ullElapsed = 0;
+    DWORD dwWaitMs = INFINITE;
+    BOOL fWaited = FALSE;
+
+    if ((priority < BigDriveCallPriority_Foreground) || (priority >= BigDriveCallPriority_Count))
+    {
+        return E_INVALIDARG;
+    }
+
+    ::ZeroMemory(&waiter, sizeof(BigDriveCallSchedulerWaiter));
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    hr = GetProvider(providerClsid, &pProvider);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    ullStart = ::GetTickCount64();
+    ullNow = ullStart;
+
+    // Queued behind the requests already waiting; Dispatch decides whether it can go ahead of them
+    waiter.priority = priority;
+    waiter.ullQueued = ullNow;
+    waiter.sequence = m_sequence++;
+
+    if (pProvider->apLast[priority] != nullptr)
+    {
+        pProvider->apLast[priority]->pNext = &waiter;
+    }
+    else
+    {
+        pProvider->apFirst[priority] = &waiter;
+    }
+
+    pProvider->apLast[priority] = &waiter;
+
+    Dispatch(pProvider, ullNow);
+
+    while (!waiter.fAdmitted)
+    {
+        if (!fWaited)
+        {
+            fWaited = TRUE;
+            ::InterlockedIncrement(&m_waitedCount);
+        }
+
+        ullElapsed = ullNow - ullStart;
+        if ((dwTimeoutMs != INFINITE) && (ullElapsed >= dwTimeoutMs))
+        {
+            Unlink(pProvider, &waiter);
+            ::InterlockedIncrement(&m_timedOutCount);
+            hr = HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+            goto End;
+        }
+
+        // A provider with a free slot is waiting on its bucket, which only time refills; a full
+        // provider waits for a Leave
+        dwWaitMs = INFINITE;
+        if (pProvider->active < pProvider->limit)
+        {
+            dwWaitMs = GetTokenWaitMs(pProvider);
+            if (dwWaitMs == 0)
+            {
+                dwWaitMs = 1;
+            }
+        }
+
+        if ((dwTimeoutMs != INFINITE) && ((dwWaitMs == INFINITE) || (dwWaitMs > dwTimeoutMs - ullElapsed)))
+        {
+            dwWaitMs = static_cast<DWORD>(dwTimeoutMs - ullElapsed);
+        }
+
+        ::SleepConditionVariableSRW(&m_admitted, &m_lock, dwWaitMs, 0);
+
+        ullNow = ::GetTickCount64();
+        Dispatch(pProvider, ullNow);
+    }
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveCallScheduler::Leave(REFCLSID providerClsid)
+{
+    BigDriveCallSchedulerProvider* pProvider = nullptr;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    for (pProvider = m_pProviders; pProvider != nullptr; pProvider = pProvider->pNext)
+    {
+        if (::IsEqualGUID(pProvider->clsid, providerClsid))
+        {
+            if (pProvider->active > 0)
+            {
+                pProvider->active--;
+            }
+
+            Dispatch(pProvider, ::GetTickCount64());
+            break;
+        }
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+void BigDriveCallScheduler::GetStatistics(LONG& admitted, LONG& waited, LONG& promoted, LONG& timedOut)
+{
+    admitted = ::InterlockedCompareExchange(&m_admittedCount, 0, 0);
+    waited = ::InterlockedCompareExchange(&m_waitedCount, 0, 0);
+    promoted = ::InterlockedCompareExchange(&m_promotedCount, 0, 0);
+    timedOut = ::InterlockedCompareExchange(&m_timedOutCount, 0, 0);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveCallScheduler::GetProvider(REFCLSID providerClsid, BigDriveCallSchedulerProvider** ppProvider)
+{
+    BigDriveCallSchedulerProvider* pProvider = nullptr;
+
+    *ppProvider = nullptr;
+
+    for (pProvider = m_pProviders; pProvider != nullptr; pProvider = pProvider->pNext)
+    {
+        if (::IsEqualGUID(pProvider->clsid, providerClsid))
+        {
+            *ppProvider = pProvider;
+            return S_OK;
+        }
+    }
+
+    // Zero initialized: no rate limit and no waiting requests
+    pProvider = new BigDriveCallSchedulerProvider();
+    if (pProvider == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    pProvider->clsid = providerClsid;
+    pProvider->limit = m_defaultProviderLimit;
+    pProvider->pNext = m_pProviders;
+    m_pProviders = pProvider;
+
+    *ppProvider = pProvider;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+void BigDriveCallScheduler::Dispatch(BigDriveCallSchedulerProvider* pProvider, ULONGLONG ullNow)
+{
+    BigDriveCallSchedulerWaiter* pWaiter = nullptr;
+    BOOL fAdmitted = FALSE;
+
+    while (pProvider->active < pProvider->limit)
+    {
+        pWaiter = SelectWaiter(pProvider, ullNow);
+        if (pWaiter == nullptr)
+        {
+            break;
+        }
+
+        if (!TakeToken(pProvider, ullNow))
+        {
+            break;
+        }
+
+        for (ULONG i = 0; i < static_cast<ULONG>(pWaiter->priority); i++)
+        {
+            if (pProvider->apFirst[i] != nullptr)
+            {
+                // Overtook a more urgent class by aging
+                ::InterlockedIncrement(&m_promotedCount);
+                break;
+            }
+        }
+
+        Unlink(pProvider, pWaiter);
+        pWaiter->fAdmitted = TRUE;
+        pProvider->active++;
+
+        ::InterlockedIncrement(&m_admittedCount);
+        fAdmitted = TRUE;
+    }
+
+    if (fAdmitted)
+    {
+        ::WakeAllConditionVariable(&m_admitted);
+    }
+}
+
+/// <inheritdoc />
+BigDriveCallSchedulerWaiter* BigDriveCallScheduler::SelectWaiter(BigDriveCallSchedulerProvider* pProvider, ULONGLONG ullNow)
+{
+    BigDriveCallSchedulerWaiter* pBest = nullptr;
+    BigDriveCallSchedulerWaiter* pWaiter = nullptr;
+    ULONGLONG rank = 0;
+    ULONGLONG bestRank = 0;
+    ULONGLONG steps = 0;
+
+    // Each class is served in arrival order, so only the oldest of each competes
+    for (ULONG i = 0; i < BigDriveCallPriority_Count; i++)
+    {
+        pWaiter = pProvider->apFirst[i];
+        if (pWaiter == nullptr)
+        {
+            continue;
+        }
+
+        rank = 0;
+        if (m_agingMs > 0)
+        {
+            steps = (ullNow - pWaiter->ullQueued) / m_agingMs;
+            rank = (steps >= i) ? 0 : i - steps;
+        }
+
+        if ((pBest == nullptr) || (rank < bestRank) || ((rank == bestRank) && (pWaiter->sequence < pBest->sequence)))
+        {
+            pBest = pWaiter;
+            bestRank = rank;
+        }
+    }
+
+    return pBest;
+}
+
+/// <inheritdoc />
+void BigDriveCallScheduler::Unlink(BigDriveCallSchedulerProvider* pProvider, BigDriveCallSchedulerWaiter* pWaiter)
+{
+    BigDriveCallSchedulerWaiter** ppLink = &pProvider->apFirst[pWaiter->priority];
+    BigDriveCallSchedulerWaiter* pPrevious = nullptr;
+
+    while (*ppLink != nullptr)
+    {
+        if (*ppLink == pWaiter)
+        {
+            *ppLink = pWaiter->pNext;
+            break;
+        }
+
+        pPrevious = *ppLink;
+        ppLink = &(*ppLink)->pNext;
+    }
+
+    if (pProvider->apLast[pWaiter->priority] == pWaiter)
+    {
+        pProvider->apLast[pWaiter->priority] = pPrevious;
+    }
+
+    pWaiter->pNext = nullptr;
+}
+
+/// <inheritdoc />
+BOOL BigDriveCallScheduler::TakeToken(BigDriveCallSchedulerProvider* pProvider, ULONGLONG ullNow)
+{
+    ULONGLONG capacity = 0;
+
+    if (pProvider->ratePerSecond == 0)
+    {
+        return TRUE;
+    }
+
+    // A rate of r calls a second adds r thousandths of a call each millisecond
+    if (ullNow > pProvider->ullRefilled)
+    {
+        capacity = static_cast<ULONGLONG>(pProvider->burst) * 1000;
+
+        pProvider->milliTokens += (ullNow - pProvider->ullRefilled) * pProvider->ratePerSecond;
+        if (pProvider->milliTokens > capacity)
+        {
+            pProvider->milliTokens = capacity;
+        }
+
+        pProvider->ullRefilled = ullNow;
+    }
+
+    if (pProvider->milliTokens < 1000)
+    {
+        return FALSE;
+    }
+
+    pProvider->milliTokens -= 1000;
+
+    return TRUE;
+}
+
+/// <inheritdoc />
+DWORD BigDriveCallScheduler::GetTokenWaitMs(BigDriveCallSchedulerProvider* pProvider)
+{
+    if ((pProvider->ratePerSecond == 0) || (pProvider->milliTokens >= 1000))
+    {
+        return 0;
+    }
+
+    return static_cast<DWORD>((1000 - pProvider->milliTokens + pProvider->ratePerSecond - 1) / pProvider->ratePerSecond);
+}
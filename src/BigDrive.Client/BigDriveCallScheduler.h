@@ -0,0 +1,304 @@
+// <copyright file="BigDriveCallScheduler.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+/// <summary>
+/// Priority classes of provider calls, most urgent first.
+/// </summary>
+enum BigDriveCallPriority
+{
+    /// <summary>
+    /// Calls the user is waiting on: enumerating a folder, the metadata of visible items.
+    /// </summary>
+    BigDriveCallPriority_Foreground = 0,
+
+    /// <summary>
+    /// Calls made ahead of need: prefetch, thumbnails.
+    /// </summary>
+    BigDriveCallPriority_Background = 1,
+
+    /// <summary>
+    /// Transfers.
+    /// </summary>
+    BigDriveCallPriority_Bulk = 2,
+
+    BigDriveCallPriority_Count = 3
+};
+
+/// <summary>
+/// A request waiting for admission. Lives on the stack of the thread waiting in
+/// <see cref="BigDriveCallScheduler::Enter"/>.
+/// </summary>
+struct BigDriveCallSchedulerWaiter
+{
+    /// <summary>
+    /// Priority class of the call.
+    /// </summary>
+    BigDriveCallPriority priority;
+
+    /// <summary>
+    /// GetTickCount64 value of the time the request was queued.
+    /// </summary>
+    ULONGLONG ullQueued;
+
+    /// <summary>
+    /// Order of arrival across all classes, which breaks ties.
+    /// </summary>
+    ULONGLONG sequence;
+
+    /// <summary>
+    /// TRUE once the request was admitted and removed from its queue.
+    /// </summary>
+    BOOL fAdmitted;
+
+    /// <summary>
+    /// Next request in the same class.
+    /// </summary>
+    BigDriveCallSchedulerWaiter* pNext;
+};
+
+/// <summary>
+/// Admission state of one provider: its limits, the calls running and the requests waiting.
+/// </summary>
+struct BigDriveCallSchedulerProvider
+{
+    /// <summary>
+    /// CLSID of the provider.
+    /// </summary>
+    CLSID clsid;
+
+    /// <summary>
+    /// Maximum number of calls run at once.
+    /// </summary>
+    ULONG limit;
+
+    /// <summary>
+    /// Number of calls running.
+    /// </summary>
+    ULONG active;
+
+    /// <summary>
+    /// Calls admitted per second, or zero for no rate limit.
+    /// </summary>
+    ULONG ratePerSecond;
+
+    /// <summary>
+    /// Number of calls admitted back to back after the provider has been idle.
+    /// </summary>
+    ULONG burst;
+
+    /// <summary>
+    /// Tokens in the bucket, in thousandths of a call, so a rate of one call a second refills one
+    /// unit a millisecond.
+    /// </summary>
+    ULONGLONG milliTokens;
+
+    /// <summary>
+    /// GetTickCount64 value of the last refill.
+    /// </summary>
+    ULONGLONG ullRefilled;
+
+    /// <summary>
+    /// Oldest waiting request of each class.
+    /// </summary>
+    BigDriveCallSchedulerWaiter* apFirst[BigDriveCallPriority_Count];
+
+    /// <summary>
+    /// Newest waiting request of each class.
+    /// </summary>
+    BigDriveCallSchedulerWaiter* apLast[BigDriveCallPriority_Count];
+
+    /// <summary>
+    /// Next provider in the list.
+    /// </summary>
+    BigDriveCallSchedulerProvider* pNext;
+};
+
+/// <summary>
+/// Admission control for provider calls. A caller enters before calling a provider and leaves
+/// when the call returns; the call itself is made on the caller's thread, so it stays in the
+/// apartment that owns the interface pointer.
+///
+/// Each provider runs at most its concurrency limit of calls at once, and when it has a rate limit,
+/// a token bucket admits at most that many calls a second after an initial burst, so a bulk copy
+/// can neither take every connection nor trip a web service's throttling. When a slot and a token
+/// are free, the oldest request of the most urgent class waiting is admitted, so a foreground
+/// enumeration overtakes a queue of transfers. To keep background and bulk requests from starving
+/// under a steady foreground load, a request rises one class for every aging interval it waits;
+/// ties go to the request that arrived first.
+/// </summary>
+class BigDriveCallScheduler
+{
+public:
+
+    /// <summary>
+    /// Default maximum number of calls run at once against one provider.
+    /// </summary>
+    static const ULONG DefaultProviderLimit = 4;
+
+    /// <summary>
+    /// Default milliseconds a request waits before it rises one priority class.
+    /// </summary>
+    static const DWORD DefaultAgingMs = 500;
+
+private:
+
+    /// <summary>
+    /// Maximum number of calls run at once against a provider without its own limit.
+    /// </summary>
+    ULONG m_defaultProviderLimit;
+
+    /// <summary>
+    /// Milliseconds a request waits before it rises one class; zero admits in arrival order.
+    /// </summary>
+    DWORD m_agingMs;
+
+    /// <summary>
+    /// Providers seen, with their limits.
+    /// </summary>
+    BigDriveCallSchedulerProvider* m_pProviders;
+
+    /// <summary>
+    /// Sequence number given to the next request queued.
+    /// </summary>
+    ULONGLONG m_sequence;
+
+    /// <summary>
+    /// Guards every field above and every provider and waiter.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Signaled when requests are admitted.
+    /// </summary>
+    CONDITION_VARIABLE m_admitted;
+
+    /// <summary>
+    /// Counter of requests admitted.
+    /// </summary>
+    volatile LONG m_admittedCount;
+
+    /// <summary>
+    /// Counter of requests that had to wait.
+    /// </summary>
+    volatile LONG m_waitedCount;
+
+    /// <summary>
+    /// Counter of requests admitted ahead of a waiting request of a more urgent class, because
+    /// they had aged.
+    /// </summary>
+    volatile LONG m_promotedCount;
+
+    /// <summary>
+    /// Counter of requests that gave up waiting.
+    /// </summary>
+    volatile LONG m_timedOutCount;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveCallScheduler"/> class.
+    /// </summary>
+    /// <param name="defaultProviderLimit">Maximum number of calls run at once against a provider without its own limit.</param>
+    /// <param name="agingMs">Milliseconds a request waits before it rises one class; zero admits requests in
+    /// arrival order, ignoring their class.</param>
+    BigDriveCallScheduler(ULONG defaultProviderLimit, DWORD agingMs);
+
+    /// <summary>
+    /// Frees the provider list. No thread may be using the scheduler.
+    /// </summary>
+    ~BigDriveCallScheduler();
+
+    /// <summary>
+    /// Retrieves the process-wide instance.
+    /// </summary>
+    /// <returns>The call scheduler.</returns>
+    static BigDriveCallScheduler& GetInstance();
+
+    /// <summary>
+    /// Sets the limits of a provider. The token bucket starts full.
+    /// </summary>
+    /// <param name="providerClsid">CLSID of the provider.</param>
+    /// <param name="limit">Maximum number of calls run at once; at least one.</param>
+    /// <param name="ratePerSecond">Calls admitted per second, or zero for no rate limit.</param>
+    /// <param name="burst">Calls admitted back to back after the provider has been idle; at least one with a rate limit.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; or E_OUTOFMEMORY.</returns>
+    HRESULT SetProviderLimits(REFCLSID providerClsid, ULONG limit, ULONG ratePerSecond, ULONG burst);
+
+    /// <summary>
+    /// Waits until a call to the provider may be made. Every successful Enter must be matched by a
+    /// <see cref="Leave"/> once the call returns.
+    /// </summary>
+    /// <param name="providerClsid">CLSID of the provider.</param>
+    /// <param name="priority">Priority class of the call.</param>
+    /// <param name="dwTimeoutMs">Milliseconds to wait, zero to poll, or INFINITE.</param>
+    /// <returns>S_OK if admitted; HRESULT_FROM_WIN32(ERROR_TIMEOUT) if not admitted in time; E_INVALIDARG; or E_OUTOFMEMORY.</returns>
+    HRESULT Enter(REFCLSID providerClsid, BigDriveCallPriority priority, DWORD dwTimeoutMs);
+
+    /// <summary>
+    /// Ends a call admitted by <see cref="Enter"/>, admitting the next request waiting.
+    /// </summary>
+    /// <param name="providerClsid">CLSID of the provider.</param>
+    void Leave(REFCLSID providerClsid);
+
+    /// <summary>
+    /// Retrieves the scheduler counters.
+    /// </summary>
+    /// <param name="admitted">Receives the number of requests admitted.</param>
+    /// <param name="waited">Receives the number of requests that had to wait. A request is counted as soon as it is queued.</param>
+    /// <param name="promoted">Receives the number of requests admitted ahead of a more urgent class because they had aged.</param>
+    /// <param name="timedOut">Receives the number of requests that gave up waiting.</param>
+    void GetStatistics(LONG& admitted, LONG& waited, LONG& promoted, LONG& timedOut);
+
+private:
+
+    /// <summary>
+    /// Finds a provider, adding it with the default limits if it is new. Called with the lock held.
+    /// </summary>
+    /// <param name="providerClsid">CLSID of the provider.</param>
+    /// <param name="ppProvider">Receives the provider.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY.</returns>
+    HRESULT GetProvider(REFCLSID providerClsid, BigDriveCallSchedulerProvider** ppProvider);
+
+    /// <summary>
+    /// Admits waiting requests while the provider has a free slot and a token. Called with the lock held.
+    /// </summary>
+    /// <param name="pProvider">The provider.</param>
+    /// <param name="ullNow">GetTickCount64 value of the current time.</param>
+    void Dispatch(BigDriveCallSchedulerProvider* pProvider, ULONGLONG ullNow);
+
+    /// <summary>
+    /// Picks the waiting request to admit next: the lowest class once aged, then the oldest.
+    /// </summary>
+    /// <param name="pProvider">The provider.</param>
+    /// <param name="ullNow">GetTickCount64 value of the current time.</param>
+    /// <returns>The request, or nullptr if none is waiting.</returns>
+    BigDriveCallSchedulerWaiter* SelectWaiter(BigDriveCallSchedulerProvider* pProvider, ULONGLONG ullNow);
+
+    /// <summary>
+    /// Removes a request from its queue.
+    /// </summary>
+    /// <param name="pProvider">The provider.</param>
+    /// <param name="pWaiter">The request.</param>
+    static void Unlink(BigDriveCallSchedulerProvider* pProvider, BigDriveCallSchedulerWaiter* pWaiter);
+
+    /// <summary>
+    /// Takes a token from the provider's bucket, refilling it first.
+    /// </summary>
+    /// <param name="pProvider">The provider.</param>
+    /// <param name="ullNow">GetTickCount64 value of the current time.</param>
+    /// <returns>TRUE if a token was taken or the provider has no rate limit.</returns>
+    static BOOL TakeToken(BigDriveCallSchedulerProvider* pProvider, ULONGLONG ullNow);
+
+    /// <summary>
+    /// Computes how long until the provider's bucket holds a token.
+    /// </summary>
+    /// <param name="pProvider">The provider, refilled to the current time.</param>
+    /// <returns>Milliseconds until a token is available; zero if one is.</returns>
+    static DWORD GetTokenWaitMs(BigDriveCallSchedulerProvider* pProvider);
+};
@@ -0,0 +1,224 @@
+// <copyright file="BigDriveClsidSetCache.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveClsidSetCache.h"
+
+// System
+#include <objbase.h>
+
+// Local
+#include "BigDriveClientConfigurationManager.h"
+
+/// <inheritdoc />
+BigDriveClsidSetCache::BigDriveClsidSetCache(BigDriveClsidSetFetch pfnFetch, LPCWSTR szWatchKey)
+    : m_pfnFetch(pfnFetch),
+    m_szWatchKey(szWatchKey),
+    m_count(0),
+    m_fLoaded(FALSE),
+    m_watch(HKEY_CURRENT_USER, szWatchKey, 0, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, OnWatchKeyChanged, this),
+    m_hits(0),
+    m_loads(0),
+    m_invalidations(0)
+{
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        m_apBuckets[i] = nullptr;
+    }
+
+    ::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveClsidSetCache::~BigDriveClsidSetCache()
+{
+    m_watch.Stop();
+
+    ::AcquireSRWLockExclusive(&m_lock);
+    FreeNodes();
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveClsidSetCache& BigDriveClsidSetCache::GetInstance()
+{
+    static BigDriveClsidSetCache* s_pInstance = new BigDriveClsidSetCache(
+        BigDriveClientConfigurationManager::GetDriveGuids, L"Software\\BigDrive\\Drives");
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveClsidSetCache::Contains(REFCLSID clsid)
+{
+    HRESULT hr = S_OK;
+    BOOL fLoaded = FALSE;
+    BOOL fFound = FALSE;
+
+    // Armed before the first load, so a change made during it is noticed
+    if (m_szWatchKey != nullptr)
+    {
+        m_watch.EnsureArmed();
+    }
+
+    // Steady state: a shared lock and one bucket chain
+    ::AcquireSRWLockShared(&m_lock);
+
+    fLoaded = m_fLoaded;
+    if (fLoaded)
+    {
+        fFound = Find(clsid);
+    }
+
+    ::ReleaseSRWLockShared(&m_lock);
+
+    if (fLoaded)
+    {
+        ::InterlockedIncrement(&m_hits);
+        return fFound ? S_OK : S_FALSE;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    // Another caller may have loaded while this one waited for the lock
+    if (!m_fLoaded)
+    {
+        hr = Load();
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+    }
+
+    hr = Find(clsid) ? S_OK : S_FALSE;
+
+    // Without a registry watch a held set could go stale unnoticed, so don't hold it
+    if ((m_szWatchKey != nullptr) && FAILED(m_watch.EnsureArmed()))
+    {
+        FreeNodes();
+        m_fLoaded = FALSE;
+    }
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveClsidSetCache::Invalidate()
+{
+    // Waits for a load in progress, so a set read before the change is never kept
+    ::AcquireSRWLockExclusive(&m_lock);
+    FreeNodes();
+    m_fLoaded = FALSE;
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    ::InterlockedIncrement(&m_invalidations);
+}
+
+/// <inheritdoc />
+void BigDriveClsidSetCache::GetStatistics(LONG& hits, LONG& loads, LONG& invalidations)
+{
+    hits = ::InterlockedCompareExchange(&m_hits, 0, 0);
+    loads = ::InterlockedCompareExchange(&m_loads, 0, 0);
+    invalidations = ::InterlockedCompareExchange(&m_invalidations, 0, 0);
+}
+
+/// <inheritdoc />
+BOOL BigDriveClsidSetCache::Find(REFCLSID clsid)
+{
+    BigDriveClsidSetNode* pNode = nullptr;
+
+    for (pNode = m_apBuckets[GetBucket(clsid)]; pNode != nullptr; pNode = pNode->pNextInBucket)
+    {
+        if (::IsEqualGUID(pNode->clsid, clsid))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveClsidSetCache::Load()
+{
+    HRESULT hr = S_OK;
+    GUID* pClsids = nullptr;
+    DWORD size = 0;
+    BigDriveClsidSetNode* pNode = nullptr;
+    ULONG bucket = 0;
+
+    ::InterlockedIncrement(&m_loads);
+
+    hr = m_pfnFetch(&pClsids, size);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    FreeNodes();
+
+    for (DWORD i = 0; i < size; i++)
+    {
+        pNode = new BigDriveClsidSetNode();
+        if (pNode == nullptr)
+        {
+            FreeNodes();
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        bucket = GetBucket(pClsids[i]);
+        pNode->clsid = pClsids[i];
+        pNode->pNextInBucket = m_apBuckets[bucket];
+        m_apBuckets[bucket] = pNode;
+        m_count++;
+    }
+
+    m_fLoaded = TRUE;
+
+End:
+
+    if (pClsids)
+    {
+        ::CoTaskMemFree(pClsids);
+        pClsids = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveClsidSetCache::FreeNodes()
+{
+    BigDriveClsidSetNode* pNode = nullptr;
+
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        while (m_apBuckets[i] != nullptr)
+        {
+            pNode = m_apBuckets[i];
+            m_apBuckets[i] = pNode->pNextInBucket;
+            delete pNode;
+        }
+    }
+
+    m_count = 0;
+}
+
+/// <inheritdoc />
+void BigDriveClsidSetCache::OnWatchKeyChanged(PVOID pContext)
+{
+    static_cast<BigDriveClsidSetCache*>(pContext)->Invalidate();
+}
+
+/// <inheritdoc />
+ULONG BigDriveClsidSetCache::GetBucket(REFCLSID clsid)
+{
+    return (clsid.Data1 ^ clsid.Data2 ^ clsid.Data4[7]) & (BucketCount - 1);
+}
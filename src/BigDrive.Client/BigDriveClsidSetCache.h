@@ -0,0 +1,171 @@
+// <copyright file="BigDriveClsidSetCache.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveRegistryWatch.h"
+
+/// <summary>
+/// Reads the CLSIDs of every registered drive from their source of truth.
+/// </summary>
+/// <param name="ppClsids">Receives the CLSIDs, allocated with CoTaskMemAlloc.</param>
+/// <param name="size">Receives the number of CLSIDs.</param>
+/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+typedef HRESULT (*BigDriveClsidSetFetch)(GUID** ppClsids, DWORD& size);
+
+/// <summary>
+/// A registered CLSID and its place in the hash buckets.
+/// </summary>
+struct BigDriveClsidSetNode
+{
+    /// <summary>
+    /// The CLSID of the drive's shell folder, which is the drive GUID.
+    /// </summary>
+    CLSID clsid;
+
+    /// <summary>
+    /// Next node in the bucket chain.
+    /// </summary>
+    BigDriveClsidSetNode* pNextInBucket;
+};
+
+/// <summary>
+/// In-process set of the CLSIDs of the registered drives, so DllGetClassObject answers
+/// Explorer's class-object requests (one per This PC refresh and per new window) without
+/// enumerating the registry each time. The set is read once and held until it is invalidated,
+/// explicitly or when the registry watch on the Drives key under HKEY_CURRENT_USER fires.
+/// If the watch was asked for but can't be armed, the set is read on every call, so it never goes stale.
+/// </summary>
+class BigDriveClsidSetCache
+{
+private:
+
+    /// <summary>
+    /// Number of hash buckets. Must be a power of two.
+    /// </summary>
+    static const ULONG BucketCount = 64;
+
+    /// <summary>
+    /// Reads the CLSIDs on a miss.
+    /// </summary>
+    BigDriveClsidSetFetch m_pfnFetch;
+
+    /// <summary>
+    /// Key under HKEY_CURRENT_USER to watch, or nullptr for none.
+    /// </summary>
+    LPCWSTR m_szWatchKey;
+
+    /// <summary>
+    /// Hash buckets.
+    /// </summary>
+    BigDriveClsidSetNode* m_apBuckets[BucketCount];
+
+    /// <summary>
+    /// Number of CLSIDs held.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// TRUE when the buckets hold the current set.
+    /// </summary>
+    BOOL m_fLoaded;
+
+    /// <summary>
+    /// Guards the buckets, the count, and the loaded flag.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Watch on the key, which invalidates the set. The set is not held while it isn't armed.
+    /// </summary>
+    BigDriveRegistryWatch m_watch;
+
+    /// <summary>
+    /// Counter of lookups served from the held set.
+    /// </summary>
+    volatile LONG m_hits;
+
+    /// <summary>
+    /// Counter of times the set was read.
+    /// </summary>
+    volatile LONG m_loads;
+
+    /// <summary>
+    /// Counter of times the set was invalidated.
+    /// </summary>
+    volatile LONG m_invalidations;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveClsidSetCache"/> class.
+    /// </summary>
+    /// <param name="pfnFetch">Reads the CLSIDs on a miss.</param>
+    /// <param name="szWatchKey">Key under HKEY_CURRENT_USER whose changes invalidate the set, or nullptr to rely on <see cref="Invalidate"/> only.</param>
+    BigDriveClsidSetCache(BigDriveClsidSetFetch pfnFetch, LPCWSTR szWatchKey);
+
+    /// <summary>
+    /// Stops the registry watch and frees the set.
+    /// </summary>
+    ~BigDriveClsidSetCache();
+
+    /// <summary>
+    /// Retrieves the process-wide instance, which reads the registered drives with
+    /// BigDriveClientConfigurationManager::GetDriveGuids and watches Software\BigDrive\Drives.
+    /// </summary>
+    /// <returns>The CLSID set cache.</returns>
+    static BigDriveClsidSetCache& GetInstance();
+
+    /// <summary>
+    /// Determines whether a CLSID belongs to a registered drive, reading the set on a miss.
+    /// </summary>
+    /// <param name="clsid">The CLSID.</param>
+    /// <returns>S_OK if it is registered; S_FALSE if not; otherwise, the HRESULT returned by the fetch.</returns>
+    HRESULT Contains(REFCLSID clsid);
+
+    /// <summary>
+    /// Drops the held set, so the next lookup reads it again.
+    /// </summary>
+    void Invalidate();
+
+    /// <summary>
+    /// Retrieves the cache counters.
+    /// </summary>
+    /// <param name="hits">Receives the number of lookups served from the held set.</param>
+    /// <param name="loads">Receives the number of times the set was read.</param>
+    /// <param name="invalidations">Receives the number of times the set was invalidated.</param>
+    void GetStatistics(LONG& hits, LONG& loads, LONG& invalidations);
+
+private:
+
+    /// <summary>
+    /// Finds a CLSID in the buckets. The caller must hold the lock.
+    /// </summary>
+    BOOL Find(REFCLSID clsid);
+
+    /// <summary>
+    /// Reads the set into the buckets. The caller must hold the lock exclusive.
+    /// </summary>
+    /// <returns>S_OK on success; otherwise, the HRESULT returned by the fetch.</returns>
+    HRESULT Load();
+
+    /// <summary>
+    /// Frees every node. The caller must hold the lock exclusive.
+    /// </summary>
+    void FreeNodes();
+
+    /// <summary>
+    /// Registry watch callback: invalidates the set.
+    /// </summary>
+    static void OnWatchKeyChanged(PVOID pContext);
+
+    /// <summary>
+    /// Computes the bucket of a CLSID.
+    /// </summary>
+    static ULONG GetBucket(REFCLSID clsid);
+};
@@ -0,0 +1,336 @@
+// <copyright file="BigDriveConfigurationCache.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveConfigurationCache.h"
+
+// System
+#include <objbase.h>
+#include <oleauto.h>
+
+// Local
+#include "BigDrivePerformanceCounters.h"
+
+/// <inheritdoc />
+BigDriveConfigurationCache::BigDriveConfigurationCache(BigDriveConfigurationFetch pfnFetch, BOOL fWatchRegistry)
+    : m_pfnFetch(pfnFetch),
+    m_version(0),
+    m_activeReaders(0),
+    m_pRetired(nullptr),
+    m_fWatchRegistry(fWatchRegistry),
+    m_watch(HKEY_LOCAL_MACHINE, L"SOFTWARE\\BigDrive\\Drives", KEY_WOW64_64KEY, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, OnDrivesKeyChanged, this),
+    m_hits(0),
+    m_fetches(0)
+{
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        m_apBuckets[i] = nullptr;
+    }
+
+    ::InitializeSRWLock(&m_fetchLock);
+}
+
+/// <inheritdoc />
+BigDriveConfigurationCache::~BigDriveConfigurationCache()
+{
+    BigDriveConfigurationCacheNode* pNode = nullptr;
+
+    m_watch.Stop();
+
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        pNode = m_apBuckets[i];
+        while (pNode)
+        {
+            BigDriveConfigurationCacheNode* pNext = pNode->pNext;
+            FreeNode(pNode);
+            pNode = pNext;
+        }
+
+        m_apBuckets[i] = nullptr;
+    }
+
+    while (m_pRetired)
+    {
+        pNode = m_pRetired;
+        m_pRetired = pNode->pNextRetired;
+        FreeNode(pNode);
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConfigurationCache::GetConfiguration(const GUID& driveGuid, LPWSTR& pszConfiguration)
+{
+    HRESULT hr = S_OK;
+    LPWSTR pszFetched = nullptr;
+    LONG version = 0;
+
+    pszConfiguration = nullptr;
+
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_ConfigurationLookups);
+
+    // Steady state: lock-free read of the published configuration
+    hr = Lookup(driveGuid, pszConfiguration);
+    if (hr != S_FALSE)
+    {
+        return hr;
+    }
+
+    if (m_fWatchRegistry)
+    {
+        m_watch.EnsureArmed();
+    }
+
+    ::AcquireSRWLockExclusive(&m_fetchLock);
+
+    // Another caller may have fetched while this one waited for the lock
+    hr = Lookup(driveGuid, pszConfiguration);
+    if (hr != S_FALSE)
+    {
+        goto End;
+    }
+
+    // Read the version before fetching so a change during the fetch leaves the entry stale
+    version = m_version;
+
+    ::InterlockedIncrement(&m_fetches);
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_ConfigurationCacheMisses);
+
+    hr = m_pfnFetch(driveGuid, pszFetched);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    pszConfiguration = ::SysAllocString(pszFetched);
+    if (pszConfiguration == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    // Without a registry watch a cached entry could go stale unnoticed, so don't cache
+    if (m_fWatchRegistry && FAILED(m_watch.EnsureArmed()))
+    {
+        goto End;
+    }
+
+    hr = Publish(driveGuid, version, pszFetched);
+    if (FAILED(hr))
+    {
+        // Caching is an optimization; the caller still gets the configuration
+        hr = S_OK;
+        goto End;
+    }
+
+    pszFetched = nullptr;
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_fetchLock);
+
+    if (pszFetched)
+    {
+        ::CoTaskMemFree(pszFetched);
+        pszFetched = nullptr;
+    }
+
+    if (FAILED(hr) && pszConfiguration)
+    {
+        ::SysFreeString(pszConfiguration);
+        pszConfiguration = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveConfigurationCache::Invalidate()
+{
+    ::InterlockedIncrement(&m_version);
+}
+
+/// <inheritdoc />
+LONG BigDriveConfigurationCache::GetVersion()
+{
+    return m_version;
+}
+
+/// <inheritdoc />
+void BigDriveConfigurationCache::GetStatistics(LONG& hits, LONG& fetches)
+{
+    hits = m_hits;
+    fetches = m_fetches;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConfigurationCache::Lookup(const GUID& driveGuid, LPWSTR& pszConfiguration)
+{
+    HRESULT hr = S_FALSE;
+    BigDriveConfigurationCacheNode* pNode = nullptr;
+    LONG version = m_version;
+
+    // Announce the traversal so retired chains aren't freed underneath it
+    ::InterlockedIncrement(&m_activeReaders);
+
+    for (pNode = m_apBuckets[GetBucket(driveGuid)]; pNode != nullptr; pNode = pNode->pNext)
+    {
+        if (::IsEqualGUID(pNode->driveGuid, driveGuid))
+        {
+            if (pNode->version == version)
+            {
+                pszConfiguration = ::SysAllocString(pNode->pszConfiguration);
+                hr = (pszConfiguration != nullptr) ? S_OK : E_OUTOFMEMORY;
+            }
+
+            break;
+        }
+    }
+
+    ::InterlockedDecrement(&m_activeReaders);
+
+    if (hr == S_OK)
+    {
+        ::InterlockedIncrement(&m_hits);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_ConfigurationCacheHits);
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConfigurationCache::Publish(const GUID& driveGuid, LONG version, LPWSTR pszConfiguration)
+{
+    HRESULT hr = S_OK;
+    ULONG bucket = GetBucket(driveGuid);
+    LONG currentVersion = m_version;
+    BigDriveConfigurationCacheNode* pHead = nullptr;
+    BigDriveConfigurationCacheNode* pOld = nullptr;
+    BigDriveConfigurationCacheNode* pNode = nullptr;
+    BigDriveConfigurationCacheNode* pCopy = nullptr;
+    size_t cch = 0;
+
+    pHead = new BigDriveConfigurationCacheNode();
+    if (pHead == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pHead->driveGuid = driveGuid;
+    pHead->version = version;
+    pHead->pszConfiguration = pszConfiguration;
+    pHead->pNext = nullptr;
+    pHead->pNextRetired = nullptr;
+
+    // Build a new chain: the new node plus copies of the other current nodes. Stale nodes are dropped.
+    for (pNode = m_apBuckets[bucket]; pNode != nullptr; pNode = pNode->pNext)
+    {
+        if (::IsEqualGUID(pNode->driveGuid, driveGuid) || (pNode->version != currentVersion))
+        {
+            continue;
+        }
+
+        pCopy = new BigDriveConfigurationCacheNode();
+        if (pCopy == nullptr)
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        cch = ::wcslen(pNode->pszConfiguration) + 1;
+        pCopy->driveGuid = pNode->driveGuid;
+        pCopy->version = pNode->version;
+        pCopy->pNextRetired = nullptr;
+        pCopy->pszConfiguration = static_cast<LPWSTR>(::CoTaskMemAlloc(cch * sizeof(WCHAR)));
+        if (pCopy->pszConfiguration == nullptr)
+        {
+            delete pCopy;
+            pCopy = nullptr;
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        ::CopyMemory(pCopy->pszConfiguration, pNode->pszConfiguration, cch * sizeof(WCHAR));
+        pCopy->pNext = pHead->pNext;
+        pHead->pNext = pCopy;
+        pCopy = nullptr;
+    }
+
+    // Publish; the interlocked exchange orders the node writes before the pointer
+    pOld = static_cast<BigDriveConfigurationCacheNode*>(
+        ::InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&m_apBuckets[bucket]), pHead));
+    pHead = nullptr;
+
+    for (pNode = pOld; pNode != nullptr; pNode = pNode->pNext)
+    {
+        pNode->pNextRetired = m_pRetired;
+        m_pRetired = pNode;
+    }
+
+    ReclaimRetired();
+
+End:
+
+    if (pHead)
+    {
+        // Ownership of the configuration stays with the caller on failure
+        pHead->pszConfiguration = nullptr;
+
+        while (pHead)
+        {
+            pNode = pHead->pNext;
+            FreeNode(pHead);
+            pHead = pNode;
+        }
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveConfigurationCache::ReclaimRetired()
+{
+    BigDriveConfigurationCacheNode* pNode = nullptr;
+
+    // A lookup that starts after the publish sees the new chain, so with no
+    // lookup in flight nothing can still reference a retired node
+    if (::InterlockedCompareExchange(&m_activeReaders, 0, 0) != 0)
+    {
+        return;
+    }
+
+    while (m_pRetired)
+    {
+        pNode = m_pRetired;
+        m_pRetired = pNode->pNextRetired;
+        FreeNode(pNode);
+    }
+}
+
+/// <inheritdoc />
+void BigDriveConfigurationCache::OnDrivesKeyChanged(PVOID pContext)
+{
+    static_cast<BigDriveConfigurationCache*>(pContext)->Invalidate();
+}
+
+/// <inheritdoc />
+ULONG BigDriveConfigurationCache::GetBucket(const GUID& driveGuid)
+{
+    return (driveGuid.Data1 ^ driveGuid.Data2 ^ driveGuid.Data4[7]) & (BucketCount - 1);
+}
+
+/// <inheritdoc />
+void BigDriveConfigurationCache::FreeNode(BigDriveConfigurationCacheNode* pNode)
+{
+    if (pNode->pszConfiguration)
+    {
+        ::CoTaskMemFree(pNode->pszConfiguration);
+        pNode->pszConfiguration = nullptr;
+    }
+
+    delete pNode;
+}
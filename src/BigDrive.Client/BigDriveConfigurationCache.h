@@ -0,0 +1,201 @@
+// <copyright file="BigDriveConfigurationCache.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveRegistryWatch.h"
+
+/// <summary>
+/// Fetches the JSON configuration of a drive from its source of truth.
+/// </summary>
+/// <param name="driveGuid">The drive to fetch.</param>
+/// <param name="pszConfiguration">Receives the configuration, allocated with CoTaskMemAlloc.</param>
+/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+typedef HRESULT (*BigDriveConfigurationFetch)(const GUID& driveGuid, LPWSTR& pszConfiguration);
+
+/// <summary>
+/// An immutable cached configuration. Nodes are never modified after they are published;
+/// replacing an entry publishes a new bucket chain and retires the old one.
+/// </summary>
+struct BigDriveConfigurationCacheNode
+{
+    /// <summary>
+    /// The drive the configuration belongs to.
+    /// </summary>
+    GUID driveGuid;
+
+    /// <summary>
+    /// The cache version the configuration was fetched under.
+    /// </summary>
+    LONG version;
+
+    /// <summary>
+    /// The JSON configuration, allocated with CoTaskMemAlloc.
+    /// </summary>
+    LPWSTR pszConfiguration;
+
+    /// <summary>
+    /// Next node in the bucket chain.
+    /// </summary>
+    BigDriveConfigurationCacheNode* pNext;
+
+    /// <summary>
+    /// Next node in the retired list.
+    /// </summary>
+    BigDriveConfigurationCacheNode* pNextRetired;
+};
+
+/// <summary>
+/// In-process cache of drive configurations keyed by drive GUID.
+/// Lookups are lock-free: they read a published bucket chain and compare the node version with
+/// the current cache version. Bumping the version (explicitly, or when the registry watch on
+/// HKLM\SOFTWARE\BigDrive\Drives fires) invalidates every entry at once. Misses are serialized
+/// behind a fetch lock and re-check the cache, so concurrent misses for a drive cost one fetch.
+/// </summary>
+class BigDriveConfigurationCache
+{
+private:
+
+    /// <summary>
+    /// Number of hash buckets. Must be a power of two.
+    /// </summary>
+    static const ULONG BucketCount = 16;
+
+    /// <summary>
+    /// Fetches configurations on a miss.
+    /// </summary>
+    BigDriveConfigurationFetch m_pfnFetch;
+
+    /// <summary>
+    /// Published bucket chains.
+    /// </summary>
+    BigDriveConfigurationCacheNode* volatile m_apBuckets[BucketCount];
+
+    /// <summary>
+    /// Current cache version. Nodes with a different version are stale.
+    /// </summary>
+    volatile LONG m_version;
+
+    /// <summary>
+    /// Number of lookups currently traversing bucket chains.
+    /// </summary>
+    volatile LONG m_activeReaders;
+
+    /// <summary>
+    /// Serializes misses and writers.
+    /// </summary>
+    SRWLOCK m_fetchLock;
+
+    /// <summary>
+    /// Nodes unlinked from the buckets that may still be read by a lookup. Guarded by the fetch lock.
+    /// </summary>
+    BigDriveConfigurationCacheNode* m_pRetired;
+
+    /// <summary>
+    /// TRUE to watch the Drives registry key for changes.
+    /// </summary>
+    BOOL m_fWatchRegistry;
+
+    /// <summary>
+    /// Watch on the Drives key in the 64-bit view of HKEY_LOCAL_MACHINE, which the configuration
+    /// service reads. Entries are not cached while it isn't armed.
+    /// </summary>
+    BigDriveRegistryWatch m_watch;
+
+    /// <summary>
+    /// Counter of lookups served from the cache.
+    /// </summary>
+    volatile LONG m_hits;
+
+    /// <summary>
+    /// Counter of lookups that fetched.
+    /// </summary>
+    volatile LONG m_fetches;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveConfigurationCache"/> class.
+    /// </summary>
+    /// <param name="pfnFetch">Fetches configurations on a miss.</param>
+    /// <param name="fWatchRegistry">TRUE to invalidate on changes to the Drives registry key; FALSE to rely on <see cref="Invalidate"/> only.</param>
+    BigDriveConfigurationCache(BigDriveConfigurationFetch pfnFetch, BOOL fWatchRegistry);
+
+    /// <summary>
+    /// Stops the registry watch and frees all cached configurations.
+    /// </summary>
+    ~BigDriveConfigurationCache();
+
+    /// <summary>
+    /// Retrieves a copy of the configuration of a drive, fetching it on a miss.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="pszConfiguration">Receives the configuration, allocated with SysAllocString. The caller must free it.</param>
+    /// <returns>S_OK on success; otherwise, the HRESULT returned by the fetch.</returns>
+    HRESULT GetConfiguration(const GUID& driveGuid, LPWSTR& pszConfiguration);
+
+    /// <summary>
+    /// Invalidates every cached configuration by advancing the version stamp.
+    /// </summary>
+    void Invalidate();
+
+    /// <summary>
+    /// Retrieves the current version stamp. It changes every time the cache is invalidated.
+    /// </summary>
+    /// <returns>The version stamp.</returns>
+    LONG GetVersion();
+
+    /// <summary>
+    /// Retrieves the cache counters.
+    /// </summary>
+    /// <param name="hits">Receives the number of lookups served from the cache.</param>
+    /// <param name="fetches">Receives the number of lookups that fetched.</param>
+    void GetStatistics(LONG& hits, LONG& fetches);
+
+private:
+
+    /// <summary>
+    /// Lock-free lookup of a current configuration.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="pszConfiguration">Receives a SysAllocString copy on a hit.</param>
+    /// <returns>S_OK on a hit, S_FALSE on a miss, E_OUTOFMEMORY if the copy failed.</returns>
+    HRESULT Lookup(const GUID& driveGuid, LPWSTR& pszConfiguration);
+
+    /// <summary>
+    /// Publishes a configuration. The caller must hold the fetch lock exclusive.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="version">The version the configuration was fetched under.</param>
+    /// <param name="pszConfiguration">The configuration. Ownership passes to the cache on success.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT Publish(const GUID& driveGuid, LONG version, LPWSTR pszConfiguration);
+
+    /// <summary>
+    /// Frees retired nodes if no lookup can still be reading them. The caller must hold the fetch lock exclusive.
+    /// </summary>
+    void ReclaimRetired();
+
+    /// <summary>
+    /// Registry watch callback: invalidates every cached configuration.
+    /// </summary>
+    static void OnDrivesKeyChanged(PVOID pContext);
+
+    /// <summary>
+    /// Computes the bucket of a drive.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <returns>The bucket index.</returns>
+    static ULONG GetBucket(const GUID& driveGuid);
+
+    /// <summary>
+    /// Frees a node and its configuration.
+    /// </summary>
+    /// <param name="pNode">The node to free.</param>
+    static void FreeNode(BigDriveConfigurationCacheNode* pNode);
+};
@@ -26,12 +26,45 @@ BigDriveClientEventLogger BigDriveConfigurationClient::s_eventLogger(L"BigDrive.
 
 /// </inheritdoc>
 HRESULT BigDriveConfigurationClient::GetDriveConfig(GUID guid, LPWSTR* pszConfiguration)
+{
+    if (pszConfiguration == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    return GetCache().GetConfiguration(guid, *pszConfiguration);
+}
+
+/// </inheritdoc>
+void BigDriveConfigurationClient::InvalidateCache()
+{
+    GetCache().Invalidate();
+}
+
+/// </inheritdoc>
+LONG BigDriveConfigurationClient::GetConfigurationVersion()
+{
+    return GetCache().GetVersion();
+}
+
+/// </inheritdoc>
+BigDriveConfigurationCache& BigDriveConfigurationClient::GetCache()
+{
+    static BigDriveConfigurationCache* s_pCache = new BigDriveConfigurationCache(FetchDriveConfig, TRUE);
+    return *s_pCache;
+}
+
+/// </inheritdoc>
+HRESULT BigDriveConfigurationClient::FetchDriveConfig(const GUID& guid, LPWSTR& pszConfiguration)
 {
     HRESULT hr = S_OK;
     IBigDriveConfiguration* pBigDriveConfiguration = nullptr;
+    size_t cch = 0;
 
     BSTR configuration = nullptr;
 
+    pszConfiguration = nullptr;
+
     // Initialize COM
     hr = ::CoInitialize(NULL);
     if (FAILED(hr))
@@ -65,14 +98,17 @@ HRESULT BigDriveConfigurationClient::GetDriveConfig(GUID guid, LPWSTR* pszConfig
     }
 
     // Convert BSTR to LPWSTR
-    *pszConfiguration = ::SysAllocString(configuration);
-    if (*pszConfiguration == NULL)
+    cch = ::SysStringLen(configuration) + 1;
+    pszConfiguration = static_cast<LPWSTR>(::CoTaskMemAlloc(cch * sizeof(WCHAR)));
+    if (pszConfiguration == NULL)
     {
         hr = E_OUTOFMEMORY;
         s_eventLogger.WriteErrorFormmated(L"Failed to allocate memory for configuration string. HRESULT: 0x%08X", hr);
         goto End;
     }
 
+    ::CopyMemory(pszConfiguration, configuration, cch * sizeof(WCHAR));
+
 End:
 
     if (configuration)
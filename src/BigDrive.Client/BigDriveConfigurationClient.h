@@ -12,6 +12,7 @@
 #include "BigDriveClientEventLogger.h"
 
 // Local
+#include "BigDriveConfigurationCache.h"
 #include "DriveConfiguration.h"
 
 class BigDriveConfigurationClient
@@ -26,10 +27,11 @@ private:
 public:
 
     /// <summary>
-    /// Gets the configuration from the registry by calling the BigDriveConfiguration COM object.
+    /// Gets the configuration of the drive. Configurations are cached in process and only fetched
+    /// from the BigDriveConfiguration COM object on a miss or after the Drives registry key changes.
     /// </summary>
     /// <param name="guid">Drive Guid</param>
-    /// <param name="pszConfiguration">Configuration</param>
+    /// <param name="pszConfiguration">Configuration, allocated with SysAllocString. The caller must free it.</param>
     static HRESULT GetDriveConfig(GUID guid, LPWSTR* pszConfiguration);
 
     /// <summary>
@@ -39,4 +41,31 @@ public:
     /// <param name="pDriveConfiguration">Configuration</param>
     static HRESULT GetDriveConfiguration(GUID guid, DriveConfiguration& driveConfiguration);
 
+    /// <summary>
+    /// Invalidates all cached drive configurations. Call after changing a drive's configuration in process.
+    /// </summary>
+    static void InvalidateCache();
+
+    /// <summary>
+    /// Gets the version stamp of the configuration cache, which changes every time cached configurations
+    /// are dropped. A caller that keeps a configuration gets it again once the stamp has changed.
+    /// </summary>
+    /// <returns>The version stamp.</returns>
+    static LONG GetConfigurationVersion();
+
+private:
+
+    /// <summary>
+    /// Retrieves the process-wide configuration cache. The instance is never destroyed so the
+    /// registry watch isn't torn down from DllMain during process detach.
+    /// </summary>
+    /// <returns>The configuration cache.</returns>
+    static BigDriveConfigurationCache& GetCache();
+
+    /// <summary>
+    /// Fetches the configuration from the registry by calling the BigDriveConfiguration COM object.
+    /// </summary>
+    /// <param name="guid">Drive Guid</param>
+    /// <param name="pszConfiguration">Configuration, allocated with CoTaskMemAlloc.</param>
+    static HRESULT FetchDriveConfig(const GUID& guid, LPWSTR& pszConfiguration);
 };
\ No newline at end of file
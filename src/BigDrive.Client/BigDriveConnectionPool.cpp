@@ -0,0 +1,678 @@
+// <copyright file="BigDriveConnectionPool.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveConnectionPool.h"
+
+// System
+#include <combaseapi.h>
+
+// Local
+#include "Interfaces/IBigDriveEnumerate.h"
+#include "Interfaces/IBigDriveEnumerateEx.h"
+#include "Interfaces/IBigDriveEnumeratePaged.h"
+#include "Interfaces/IBigDriveFileInfo.h"
+#include "Interfaces/IBigDriveFileInfoBatch.h"
+#include "Interfaces/IBigDriveFileData.h"
+#include "Interfaces/IBigDriveFileOperations.h"
+#include "BigDrivePerformanceCounters.h"
+
+// Initialize the default activator used by the process-wide pool
+BigDriveProviderActivator BigDriveConnectionPool::s_defaultActivator;
+
+namespace
+{
+    /// <summary>
+    /// Retrieves the process-wide Global Interface Table, which may be used from any apartment.
+    /// </summary>
+    HRESULT GetGlobalInterfaceTable(IGlobalInterfaceTable** ppGit)
+    {
+        return ::CoCreateInstance(CLSID_StdGlobalInterfaceTable, nullptr, CLSCTX_INPROC_SERVER, IID_IGlobalInterfaceTable, reinterpret_cast<void**>(ppGit));
+    }
+}
+
+/// <inheritdoc />
+BigDriveConnectionPool::BigDriveConnectionPool(IBigDriveProviderActivator* pActivator, ULONGLONG idleTimeoutMs)
+    : m_pActivator(pActivator),
+    m_ppEntries(nullptr),
+    m_count(0),
+    m_capacity(0),
+    m_idleTimeoutMs(idleTimeoutMs),
+    m_lastSweepTicks(static_cast<LONGLONG>(::GetTickCount64())),
+    m_hits(0),
+    m_misses(0),
+    m_reconnects(0),
+    m_evictions(0)
+{
+    ::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveConnectionPool::~BigDriveConnectionPool()
+{
+    Clear();
+
+    if (m_ppEntries)
+    {
+        delete[] m_ppEntries;
+        m_ppEntries = nullptr;
+    }
+}
+
+/// <inheritdoc />
+BigDriveConnectionPool& BigDriveConnectionPool::GetInstance()
+{
+    static BigDriveConnectionPool* s_pInstance = new BigDriveConnectionPool(&s_defaultActivator);
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::GetInterface(const GUID& driveGuid, const CLSID& clsid, const IID& iid, IUnknown** ppUnknown)
+{
+    HRESULT hr = S_OK;
+    IUnknown* pRoot = nullptr;
+    IUnknown* pInterface = nullptr;
+    BigDriveConnectionPoolEntry* pEntry = nullptr;
+    int slot = GetSlot(iid);
+    ULONG index = 0;
+    ULONG removed = 0;
+    ULONGLONG now = ::GetTickCount64();
+    DWORD dwInterfaceCookie = 0;
+    DWORD dwUnknownCookie = 0;
+    BOOL fNotImplemented = FALSE;
+
+    if (ppUnknown == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppUnknown = nullptr;
+
+    // Opportunistically release connections that have gone idle
+    if (now - static_cast<ULONGLONG>(m_lastSweepTicks) >= m_idleTimeoutMs)
+    {
+        ::InterlockedExchange64(&m_lastSweepTicks, static_cast<LONGLONG>(now));
+        EvictIdle();
+    }
+
+    ::AcquireSRWLockShared(&m_lock);
+
+    if ((FindEntry(driveGuid, index) == S_OK) && ::IsEqualCLSID(m_ppEntries[index]->clsid, clsid))
+    {
+        pEntry = m_ppEntries[index];
+        ::InterlockedExchange64(&pEntry->lastUsedTicks, static_cast<LONGLONG>(now));
+
+        if ((slot >= 0) && (pEntry->adwInterfaceCookies[slot] != 0))
+        {
+            dwInterfaceCookie = pEntry->adwInterfaceCookies[slot];
+        }
+        else if ((slot >= 0) && pEntry->afNotImplemented[slot])
+        {
+            fNotImplemented = TRUE;
+        }
+        else
+        {
+            dwUnknownCookie = pEntry->dwUnknownCookie;
+        }
+
+        pEntry = nullptr;
+    }
+
+    ::ReleaseSRWLockShared(&m_lock);
+
+    // Unmarshaled outside the lock, for the calling apartment
+    if (dwInterfaceCookie != 0)
+    {
+        hr = GetFromGlobal(dwInterfaceCookie, iid, &pInterface);
+    }
+    else if (dwUnknownCookie != 0)
+    {
+        hr = GetFromGlobal(dwUnknownCookie, IID_IUnknown, &pRoot);
+    }
+
+    if (FAILED(hr))
+    {
+        // The apartment that created the connection has ended and took its proxy with it;
+        // activate a new one rather than hand out a dead pointer
+        RemoveEntries(&driveGuid, 0, removed);
+        ::InterlockedIncrement(&m_reconnects);
+        hr = S_OK;
+    }
+
+    if (pInterface != nullptr)
+    {
+        ::InterlockedIncrement(&m_hits);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_ConnectionPoolHits);
+        goto End;
+    }
+
+    if (fNotImplemented)
+    {
+        ::InterlockedIncrement(&m_hits);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_ConnectionPoolHits);
+        hr = S_FALSE;
+        goto End;
+    }
+
+    ::InterlockedIncrement(&m_misses);
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_ConnectionPoolMisses);
+
+    if (pRoot == nullptr)
+    {
+        hr = AddEntry(driveGuid, clsid, pRoot);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+    }
+
+    hr = pRoot->QueryInterface(iid, reinterpret_cast<void**>(&pInterface));
+    if (FAILED(hr))
+    {
+        pInterface = nullptr;
+
+        if (Reconnect(driveGuid, hr) == S_OK)
+        {
+            goto End;
+        }
+
+        // Remember that the provider doesn't implement the interface
+        if (slot >= 0)
+        {
+            StoreInterface(driveGuid, iid, slot, nullptr);
+        }
+
+        hr = S_FALSE;
+        goto End;
+    }
+
+    if (slot >= 0)
+    {
+        StoreInterface(driveGuid, iid, slot, pInterface);
+    }
+
+End:
+
+    if (hr == S_OK)
+    {
+        *ppUnknown = pInterface;
+        pInterface = nullptr;
+    }
+
+    if (pInterface)
+    {
+        pInterface->Release();
+        pInterface = nullptr;
+    }
+
+    if (pRoot)
+    {
+        pRoot->Release();
+        pRoot = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::Reconnect(const GUID& driveGuid, HRESULT hrFailure)
+{
+    HRESULT hr = S_OK;
+    ULONG removed = 0;
+
+    if (!IsDisconnectedError(hrFailure))
+    {
+        return S_FALSE;
+    }
+
+    hr = RemoveEntries(&driveGuid, 0, removed);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    ::InterlockedIncrement(&m_reconnects);
+
+End:
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::EvictIdle()
+{
+    HRESULT hr = S_OK;
+    ULONG removed = 0;
+
+    hr = RemoveEntries(nullptr, m_idleTimeoutMs, removed);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    ::InterlockedExchangeAdd(&m_evictions, static_cast<LONG>(removed));
+
+End:
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::Clear()
+{
+    ULONG removed = 0;
+
+    return RemoveEntries(nullptr, 0, removed);
+}
+
+/// <inheritdoc />
+void BigDriveConnectionPool::GetStatistics(BigDriveConnectionPoolStatistics& statistics)
+{
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.reconnects = m_reconnects;
+    statistics.evictions = m_evictions;
+
+    ::AcquireSRWLockShared(&m_lock);
+    statistics.connections = m_count;
+    ::ReleaseSRWLockShared(&m_lock);
+}
+
+/// <inheritdoc />
+BOOL BigDriveConnectionPool::IsDisconnectedError(HRESULT hr)
+{
+    return (hr == RPC_E_DISCONNECTED) ||
+        (hr == CO_E_OBJNOTCONNECTED) ||
+        (hr == HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE)) ||
+        (hr == HRESULT_FROM_WIN32(RPC_S_CALL_FAILED));
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::FindEntry(const GUID& driveGuid, ULONG& index)
+{
+    for (ULONG i = 0; i < m_count; i++)
+    {
+        if (::IsEqualGUID(m_ppEntries[i]->driveGuid, driveGuid))
+        {
+            index = i;
+            return S_OK;
+        }
+    }
+
+    return S_FALSE;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::AddEntry(const GUID& driveGuid, const CLSID& clsid, IUnknown*& pRoot)
+{
+    HRESULT hr = S_OK;
+    IGlobalInterfaceTable* pGit = nullptr;
+    IUnknown* pUnknown = nullptr;
+    BigDriveConnectionPoolEntry* pEntry = nullptr;
+    BigDriveConnectionPoolEntry* pReplaced = nullptr;
+    BigDriveConnectionPoolEntry** ppEntries = nullptr;
+    DWORD dwExistingCookie = 0;
+    ULONG index = 0;
+
+    pRoot = nullptr;
+
+    if (m_pActivator == nullptr)
+    {
+        hr = E_UNEXPECTED;
+        goto End;
+    }
+
+    hr = GetGlobalInterfaceTable(&pGit);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // Activate outside the lock; activation is an out-of-process round trip
+    hr = m_pActivator->Activate(clsid, &pUnknown);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    if (pUnknown == nullptr)
+    {
+        hr = E_UNEXPECTED;
+        goto End;
+    }
+
+    pEntry = new BigDriveConnectionPoolEntry();
+    if (pEntry == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    ::ZeroMemory(pEntry, sizeof(BigDriveConnectionPoolEntry));
+    pEntry->driveGuid = driveGuid;
+    pEntry->clsid = clsid;
+    pEntry->lastUsedTicks = static_cast<LONGLONG>(::GetTickCount64());
+
+    hr = pGit->RegisterInterfaceInGlobal(pUnknown, IID_IUnknown, &pEntry->dwUnknownCookie);
+    if (FAILED(hr))
+    {
+        pEntry->dwUnknownCookie = 0;
+        goto End;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (FindEntry(driveGuid, index) == S_OK)
+    {
+        if (::IsEqualCLSID(m_ppEntries[index]->clsid, clsid))
+        {
+            // Another caller won the race; use its connection
+            dwExistingCookie = m_ppEntries[index]->dwUnknownCookie;
+            ::ReleaseSRWLockExclusive(&m_lock);
+
+            hr = GetFromGlobal(dwExistingCookie, IID_IUnknown, &pRoot);
+            goto End;
+        }
+
+        // The drive has been reconfigured with a different provider
+        pReplaced = m_ppEntries[index];
+        m_ppEntries[index] = pEntry;
+    }
+    else
+    {
+        if (m_count == m_capacity)
+        {
+            ULONG capacity = (m_capacity == 0) ? 4 : m_capacity * 2;
+
+            ppEntries = new BigDriveConnectionPoolEntry*[capacity];
+            if (ppEntries == nullptr)
+            {
+                ::ReleaseSRWLockExclusive(&m_lock);
+                hr = E_OUTOFMEMORY;
+                goto End;
+            }
+
+            for (ULONG i = 0; i < m_count; i++)
+            {
+                ppEntries[i] = m_ppEntries[i];
+            }
+
+            if (m_ppEntries)
+            {
+                delete[] m_ppEntries;
+            }
+
+            m_ppEntries = ppEntries;
+            m_capacity = capacity;
+            ppEntries = nullptr;
+        }
+
+        m_ppEntries[m_count++] = pEntry;
+    }
+
+    pEntry = nullptr;
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    // The table holds its own reference; this one is valid in the calling apartment
+    pRoot = pUnknown;
+    pUnknown = nullptr;
+
+End:
+
+    if (pReplaced)
+    {
+        FreeEntry(pReplaced);
+        pReplaced = nullptr;
+    }
+
+    if (pEntry)
+    {
+        FreeEntry(pEntry);
+        pEntry = nullptr;
+    }
+
+    if (pUnknown)
+    {
+        pUnknown->Release();
+        pUnknown = nullptr;
+    }
+
+    if (pGit)
+    {
+        pGit->Release();
+        pGit = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveConnectionPool::StoreInterface(const GUID& driveGuid, const IID& iid, int slot, IUnknown* pInterface)
+{
+    IGlobalInterfaceTable* pGit = nullptr;
+    DWORD dwCookie = 0;
+    ULONG index = 0;
+
+    // Registered outside the lock; if it fails the slot stays empty and the next request queries again
+    if (pInterface != nullptr)
+    {
+        if (FAILED(GetGlobalInterfaceTable(&pGit)))
+        {
+            goto End;
+        }
+
+        if (FAILED(pGit->RegisterInterfaceInGlobal(pInterface, iid, &dwCookie)))
+        {
+            dwCookie = 0;
+            goto End;
+        }
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (FindEntry(driveGuid, index) == S_OK)
+    {
+        BigDriveConnectionPoolEntry* pEntry = m_ppEntries[index];
+
+        if (pInterface == nullptr)
+        {
+            pEntry->afNotImplemented[slot] = TRUE;
+        }
+        else if (pEntry->adwInterfaceCookies[slot] == 0)
+        {
+            pEntry->adwInterfaceCookies[slot] = dwCookie;
+            dwCookie = 0;
+        }
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+End:
+
+    // Another caller filled the slot first, or the connection was dropped meanwhile
+    if (dwCookie != 0)
+    {
+        pGit->RevokeInterfaceFromGlobal(dwCookie);
+        dwCookie = 0;
+    }
+
+    if (pGit)
+    {
+        pGit->Release();
+        pGit = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::RemoveEntries(const GUID* pDriveGuid, ULONGLONG idleTimeoutMs, ULONG& removed)
+{
+    HRESULT hr = S_OK;
+    BigDriveConnectionPoolEntry** ppRemoved = nullptr;
+    ULONGLONG now = ::GetTickCount64();
+    ULONG kept = 0;
+
+    removed = 0;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (m_count == 0)
+    {
+        ::ReleaseSRWLockExclusive(&m_lock);
+        goto End;
+    }
+
+    ppRemoved = new BigDriveConnectionPoolEntry*[m_count];
+    if (ppRemoved == nullptr)
+    {
+        ::ReleaseSRWLockExclusive(&m_lock);
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    for (ULONG i = 0; i < m_count; i++)
+    {
+        BigDriveConnectionPoolEntry* pEntry = m_ppEntries[i];
+
+        if (((pDriveGuid == nullptr) || ::IsEqualGUID(pEntry->driveGuid, *pDriveGuid)) &&
+            (now - static_cast<ULONGLONG>(pEntry->lastUsedTicks) >= idleTimeoutMs))
+        {
+            ppRemoved[removed++] = pEntry;
+        }
+        else
+        {
+            m_ppEntries[kept++] = pEntry;
+        }
+    }
+
+    m_count = kept;
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    // Release outside the lock; releasing the last reference to a proxy is an out-of-process call
+    for (ULONG i = 0; i < removed; i++)
+    {
+        FreeEntry(ppRemoved[i]);
+        ppRemoved[i] = nullptr;
+    }
+
+End:
+
+    if (ppRemoved)
+    {
+        delete[] ppRemoved;
+        ppRemoved = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveConnectionPool::FreeEntry(BigDriveConnectionPoolEntry* pEntry)
+{
+    IGlobalInterfaceTable* pGit = nullptr;
+
+    if (pEntry == nullptr)
+    {
+        return;
+    }
+
+    // Cookies can be revoked from any apartment, including after the one that registered them has ended
+    if (SUCCEEDED(GetGlobalInterfaceTable(&pGit)))
+    {
+        for (int i = 0; i < BigDriveConnectionPoolSlot_Count; i++)
+        {
+            if (pEntry->adwInterfaceCookies[i] != 0)
+            {
+                pGit->RevokeInterfaceFromGlobal(pEntry->adwInterfaceCookies[i]);
+                pEntry->adwInterfaceCookies[i] = 0;
+            }
+        }
+
+        if (pEntry->dwUnknownCookie != 0)
+        {
+            pGit->RevokeInterfaceFromGlobal(pEntry->dwUnknownCookie);
+            pEntry->dwUnknownCookie = 0;
+        }
+
+        pGit->Release();
+        pGit = nullptr;
+    }
+
+    delete pEntry;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveConnectionPool::GetFromGlobal(DWORD dwCookie, const IID& iid, IUnknown** ppUnknown)
+{
+    HRESULT hr = S_OK;
+    IGlobalInterfaceTable* pGit = nullptr;
+
+    *ppUnknown = nullptr;
+
+    hr = GetGlobalInterfaceTable(&pGit);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = pGit->GetInterfaceFromGlobal(dwCookie, iid, reinterpret_cast<void**>(ppUnknown));
+    if (FAILED(hr))
+    {
+        *ppUnknown = nullptr;
+    }
+
+End:
+
+    if (pGit)
+    {
+        pGit->Release();
+        pGit = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+int BigDriveConnectionPool::GetSlot(const IID& iid)
+{
+    if (::IsEqualIID(iid, IID_IBigDriveEnumerate))
+    {
+        return BigDriveConnectionPoolSlot_Enumerate;
+    }
+
+    if (::IsEqualIID(iid, IID_IBigDriveFileInfo))
+    {
+        return BigDriveConnectionPoolSlot_FileInfo;
+    }
+
+    if (::IsEqualIID(iid, IID_IBigDriveFileData))
+    {
+        return BigDriveConnectionPoolSlot_FileData;
+    }
+
+    if (::IsEqualIID(iid, IID_IBigDriveFileOperations))
+    {
+        return BigDriveConnectionPoolSlot_FileOperations;
+    }
+
+    if (::IsEqualIID(iid, IID_IBigDriveEnumerateEx))
+    {
+        return BigDriveConnectionPoolSlot_EnumerateEx;
+    }
+
+    if (::IsEqualIID(iid, IID_IBigDriveEnumeratePaged))
+    {
+        return BigDriveConnectionPoolSlot_EnumeratePaged;
+    }
+
+    if (::IsEqualIID(iid, IID_IBigDriveFileInfoBatch))
+    {
+        return BigDriveConnectionPoolSlot_FileInfoBatch;
+    }
+
+    return -1;
+}
@@ -0,0 +1,307 @@
+// <copyright file="BigDriveConnectionPool.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <unknwn.h>
+
+// Local
+#include "BigDriveProviderActivator.h"
+
+/// <summary>
+/// The interfaces whose QueryInterface results are cached on a pooled connection.
+/// </summary>
+enum BigDriveConnectionPoolSlot
+{
+    BigDriveConnectionPoolSlot_Enumerate = 0,
+    BigDriveConnectionPoolSlot_FileInfo = 1,
+    BigDriveConnectionPoolSlot_FileData = 2,
+    BigDriveConnectionPoolSlot_FileOperations = 3,
+    BigDriveConnectionPoolSlot_EnumerateEx = 4,
+    BigDriveConnectionPoolSlot_EnumeratePaged = 5,
+    BigDriveConnectionPoolSlot_FileInfoBatch = 6,
+    BigDriveConnectionPoolSlot_Count = 7
+};
+
+/// <summary>
+/// A snapshot of the connection pool counters.
+/// </summary>
+struct BigDriveConnectionPoolStatistics
+{
+    /// <summary>
+    /// Number of requests served from a cached interface pointer.
+    /// </summary>
+    LONG hits;
+
+    /// <summary>
+    /// Number of requests that required an activation or a QueryInterface.
+    /// </summary>
+    LONG misses;
+
+    /// <summary>
+    /// Number of connections dropped because the provider was disconnected.
+    /// </summary>
+    LONG reconnects;
+
+    /// <summary>
+    /// Number of connections released because they were idle.
+    /// </summary>
+    LONG evictions;
+
+    /// <summary>
+    /// Number of connections currently held by the pool.
+    /// </summary>
+    ULONG connections;
+};
+
+/// <summary>
+/// A pooled connection to a provider for one drive. The interface pointers are held in the
+/// Global Interface Table, so the connection can be handed out to, and released from, any apartment.
+/// </summary>
+struct BigDriveConnectionPoolEntry
+{
+    /// <summary>
+    /// The drive the connection serves.
+    /// </summary>
+    GUID driveGuid;
+
+    /// <summary>
+    /// The CLSID of the provider that was activated.
+    /// </summary>
+    CLSID clsid;
+
+    /// <summary>
+    /// Global Interface Table cookie of the IUnknown returned by activation.
+    /// </summary>
+    DWORD dwUnknownCookie;
+
+    /// <summary>
+    /// Global Interface Table cookies of the cached QueryInterface results, indexed by
+    /// <see cref="BigDriveConnectionPoolSlot"/>; zero when the slot is empty.
+    /// </summary>
+    DWORD adwInterfaceCookies[BigDriveConnectionPoolSlot_Count];
+
+    /// <summary>
+    /// TRUE when the provider is known not to implement the interface in the slot.
+    /// </summary>
+    BOOL afNotImplemented[BigDriveConnectionPoolSlot_Count];
+
+    /// <summary>
+    /// GetTickCount64 value of the last time the connection was handed out.
+    /// </summary>
+    volatile LONGLONG lastUsedTicks;
+};
+
+/// <summary>
+/// Process-wide pool of provider connections keyed by drive GUID. Activating a COM+ provider
+/// out of process and querying its interfaces costs several round trips, so the pool keeps the
+/// activated object and its already-queried BigDrive interfaces and hands out AddRef'd pointers.
+/// Connections that have been idle longer than the idle timeout are released, and callers report
+/// RPC_E_DISCONNECTED / RPC_S_SERVER_UNAVAILABLE through <see cref="Reconnect"/> so the next request
+/// activates a fresh provider.
+///
+/// A proxy is only valid in the apartment that unmarshaled it, and Explorer creates and ends STA
+/// threads at will, so the pool keeps the interfaces in the Global Interface Table rather than
+/// keying raw pointers by thread: every apartment is handed a pointer valid for it, the idle sweep
+/// releases connections whatever apartment created them, and an entry whose creating apartment has
+/// gone is dropped and re-activated instead of handing out a dead proxy. Callers must have
+/// initialized COM.
+/// </summary>
+class BigDriveConnectionPool
+{
+private:
+
+    /// <summary>
+    /// Default activator used by the process-wide instance.
+    /// </summary>
+    static BigDriveProviderActivator s_defaultActivator;
+
+    /// <summary>
+    /// The activator used to create provider instances.
+    /// </summary>
+    IBigDriveProviderActivator* m_pActivator;
+
+    /// <summary>
+    /// Guards the entry array. Lookups take the lock shared.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// The pooled connections.
+    /// </summary>
+    BigDriveConnectionPoolEntry** m_ppEntries;
+
+    /// <summary>
+    /// Number of entries in use.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// Allocated capacity of the entry array.
+    /// </summary>
+    ULONG m_capacity;
+
+    /// <summary>
+    /// Milliseconds a connection may be idle before it is released.
+    /// </summary>
+    ULONGLONG m_idleTimeoutMs;
+
+    /// <summary>
+    /// GetTickCount64 value of the last idle sweep.
+    /// </summary>
+    volatile LONGLONG m_lastSweepTicks;
+
+    /// <summary>
+    /// Counter of requests served from the pool.
+    /// </summary>
+    volatile LONG m_hits;
+
+    /// <summary>
+    /// Counter of requests that were not served from the pool.
+    /// </summary>
+    volatile LONG m_misses;
+
+    /// <summary>
+    /// Counter of connections dropped because of disconnection.
+    /// </summary>
+    volatile LONG m_reconnects;
+
+    /// <summary>
+    /// Counter of connections released because they were idle.
+    /// </summary>
+    volatile LONG m_evictions;
+
+public:
+
+    /// <summary>
+    /// Default idle timeout. Kept below the default COM+ application idle shutdown of three minutes
+    /// so pooled proxies are normally released before their server goes away.
+    /// </summary>
+    static const ULONGLONG DefaultIdleTimeoutMs = 120000;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveConnectionPool"/> class.
+    /// </summary>
+    /// <param name="pActivator">The activator used to create providers. Not owned by the pool.</param>
+    /// <param name="idleTimeoutMs">Milliseconds a connection may be idle before it is released.</param>
+    BigDriveConnectionPool(IBigDriveProviderActivator* pActivator, ULONGLONG idleTimeoutMs = DefaultIdleTimeoutMs);
+
+    /// <summary>
+    /// Releases all pooled connections and frees the pool.
+    /// </summary>
+    ~BigDriveConnectionPool();
+
+    /// <summary>
+    /// Retrieves the process-wide pool. The instance is never destroyed so that proxies are not
+    /// released from DllMain during process detach.
+    /// </summary>
+    /// <returns>The process-wide pool.</returns>
+    static BigDriveConnectionPool& GetInstance();
+
+    /// <summary>
+    /// Retrieves an interface on the provider for a drive, activating the provider on first use.
+    /// </summary>
+    /// <param name="driveGuid">The drive the connection serves.</param>
+    /// <param name="clsid">The CLSID of the provider for the drive.</param>
+    /// <param name="iid">The interface to retrieve.</param>
+    /// <param name="ppUnknown">Receives an AddRef'd interface pointer. The caller must release it.</param>
+    /// <returns>S_OK on success, S_FALSE if the provider does not implement the interface; otherwise, an HRESULT error code.</returns>
+    HRESULT GetInterface(const GUID& driveGuid, const CLSID& clsid, const IID& iid, IUnknown** ppUnknown);
+
+    /// <summary>
+    /// Drops the connection for a drive if the failure indicates the provider was disconnected.
+    /// </summary>
+    /// <param name="driveGuid">The drive whose call failed.</param>
+    /// <param name="hrFailure">The HRESULT returned by the failed call.</param>
+    /// <returns>S_OK if the connection was dropped and the call should be retried; S_FALSE otherwise.</returns>
+    HRESULT Reconnect(const GUID& driveGuid, HRESULT hrFailure);
+
+    /// <summary>
+    /// Releases the connections that have been idle longer than the idle timeout, whatever apartment created them.
+    /// </summary>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT EvictIdle();
+
+    /// <summary>
+    /// Releases all connections.
+    /// </summary>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT Clear();
+
+    /// <summary>
+    /// Retrieves a snapshot of the pool counters.
+    /// </summary>
+    /// <param name="statistics">Receives the counters.</param>
+    void GetStatistics(BigDriveConnectionPoolStatistics& statistics);
+
+    /// <summary>
+    /// Determines whether an HRESULT indicates the provider process has gone away.
+    /// </summary>
+    /// <param name="hr">The HRESULT to test.</param>
+    /// <returns>TRUE if the connection should be re-established; otherwise, FALSE.</returns>
+    static BOOL IsDisconnectedError(HRESULT hr);
+
+private:
+
+    /// <summary>
+    /// Finds the entry for a drive. The caller must hold the lock.
+    /// </summary>
+    /// <param name="driveGuid">The drive to find.</param>
+    /// <param name="index">Receives the index of the entry.</param>
+    /// <returns>S_OK if found; S_FALSE otherwise.</returns>
+    HRESULT FindEntry(const GUID& driveGuid, ULONG& index);
+
+    /// <summary>
+    /// Activates a provider and inserts a new entry, unless another thread inserted one first.
+    /// An existing entry for the drive with a different CLSID is replaced.
+    /// </summary>
+    /// <param name="driveGuid">The drive the connection serves.</param>
+    /// <param name="clsid">The CLSID of the provider.</param>
+    /// <param name="pRoot">Receives an AddRef'd IUnknown of the pooled provider, valid in the calling apartment.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT AddEntry(const GUID& driveGuid, const CLSID& clsid, IUnknown*& pRoot);
+
+    /// <summary>
+    /// Caches a QueryInterface result in an entry's slot if the entry still exists and the slot is empty.
+    /// </summary>
+    /// <param name="driveGuid">The drive the connection serves.</param>
+    /// <param name="iid">The interface ID of the slot.</param>
+    /// <param name="slot">The slot to fill.</param>
+    /// <param name="pInterface">The interface to cache, or nullptr if the provider does not implement it.</param>
+    void StoreInterface(const GUID& driveGuid, const IID& iid, int slot, IUnknown* pInterface);
+
+    /// <summary>
+    /// Removes the entries selected by the predicate arguments and releases them outside the lock.
+    /// </summary>
+    /// <param name="pDriveGuid">If not null, only entries for this drive are removed.</param>
+    /// <param name="idleTimeoutMs">Only entries idle at least this long are removed.</param>
+    /// <param name="removed">Receives the number of entries removed.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT RemoveEntries(const GUID* pDriveGuid, ULONGLONG idleTimeoutMs, ULONG& removed);
+
+    /// <summary>
+    /// Revokes the interface pointers held by an entry from the Global Interface Table and frees it.
+    /// May be called from any apartment.
+    /// </summary>
+    /// <param name="pEntry">The entry to free.</param>
+    static void FreeEntry(BigDriveConnectionPoolEntry* pEntry);
+
+    /// <summary>
+    /// Retrieves an interface held in the Global Interface Table, for the calling apartment.
+    /// </summary>
+    /// <param name="dwCookie">The cookie of the interface.</param>
+    /// <param name="iid">The interface ID it was registered with.</param>
+    /// <param name="ppUnknown">Receives an AddRef'd interface pointer.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code, for example when the apartment that registered it has ended.</returns>
+    static HRESULT GetFromGlobal(DWORD dwCookie, const IID& iid, IUnknown** ppUnknown);
+
+    /// <summary>
+    /// Maps an IID to its cache slot.
+    /// </summary>
+    /// <param name="iid">The interface ID.</param>
+    /// <returns>The slot, or -1 if the interface is not cached.</returns>
+    static int GetSlot(const IID& iid);
+};
@@ -0,0 +1,219 @@
+// <copyright file="BigDriveEnumerationCursor.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveEnumerationCursor.h"
+
+// System
+#include <oleauto.h>
+
+/// <inheritdoc />
+BigDriveEnumerationCursor::BigDriveEnumerationCursor()
+    : m_pEnumeratePaged(nullptr),
+    m_driveGuid(GUID_NULL),
+    m_bstrPath(nullptr),
+    m_flags(0),
+    m_pageSize(DefaultPageSize),
+    m_bstrNextCursor(nullptr),
+    m_fStarted(FALSE),
+    m_psaPage(nullptr),
+    m_pageCount(0)
+{
+}
+
+/// <inheritdoc />
+BigDriveEnumerationCursor::~BigDriveEnumerationCursor()
+{
+    Reset();
+
+    if (m_bstrPath)
+    {
+        ::SysFreeString(m_bstrPath);
+        m_bstrPath = nullptr;
+    }
+
+    if (m_pEnumeratePaged)
+    {
+        m_pEnumeratePaged->Release();
+        m_pEnumeratePaged = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationCursor::Initialize(IBigDriveEnumeratePaged* pEnumeratePaged, REFGUID driveGuid, BSTR bstrPath, LONG flags, LONG pageSize)
+{
+    BSTR bstrPathCopy = nullptr;
+
+    if ((pEnumeratePaged == nullptr) || (bstrPath == nullptr) || (pageSize < 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    bstrPathCopy = ::SysAllocStringLen(bstrPath, ::SysStringLen(bstrPath));
+    if (bstrPathCopy == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    Reset();
+
+    if (m_bstrPath)
+    {
+        ::SysFreeString(m_bstrPath);
+    }
+
+    if (m_pEnumeratePaged)
+    {
+        m_pEnumeratePaged->Release();
+    }
+
+    m_pEnumeratePaged = pEnumeratePaged;
+    m_pEnumeratePaged->AddRef();
+    m_driveGuid = driveGuid;
+    m_bstrPath = bstrPathCopy;
+    m_flags = flags;
+    m_pageSize = (pageSize == 0) ? DefaultPageSize : pageSize;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationCursor::Next(BigDriveEnumerationEntry& entry)
+{
+    HRESULT hr = S_OK;
+
+    ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+
+    if (m_pEnumeratePaged == nullptr)
+    {
+        return E_UNEXPECTED;
+    }
+
+    for (;;)
+    {
+        if (m_psaPage != nullptr)
+        {
+            hr = m_reader.Next(entry);
+            if (hr != S_FALSE)
+            {
+                return hr;
+            }
+        }
+
+        // The current page is used up; stop after the last one
+        if (m_fStarted && (m_bstrNextCursor == nullptr))
+        {
+            return S_FALSE;
+        }
+
+        hr = FetchPage();
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationCursor::Reset()
+{
+    ReleasePage();
+
+    if (m_bstrNextCursor)
+    {
+        ::SysFreeString(m_bstrNextCursor);
+        m_bstrNextCursor = nullptr;
+    }
+
+    m_fStarted = FALSE;
+    m_pageCount = 0;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+ULONG BigDriveEnumerationCursor::GetPageCount()
+{
+    return m_pageCount;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationCursor::FetchPage()
+{
+    HRESULT hr = S_OK;
+    BSTR bstrNextCursor = nullptr;
+    SAFEARRAY* psaPage = nullptr;
+
+    hr = m_pEnumeratePaged->EnumerateEntriesPage(m_driveGuid, m_bstrPath, m_flags, m_bstrNextCursor, m_pageSize, &bstrNextCursor, &psaPage);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    if (psaPage == nullptr)
+    {
+        hr = E_FAIL;
+        goto End;
+    }
+
+    ReleasePage();
+
+    hr = m_reader.Initialize(psaPage);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // An empty cursor means the same as no cursor: this is the last page
+    if ((bstrNextCursor != nullptr) && (::SysStringLen(bstrNextCursor) == 0))
+    {
+        ::SysFreeString(bstrNextCursor);
+        bstrNextCursor = nullptr;
+    }
+
+    if (m_bstrNextCursor)
+    {
+        ::SysFreeString(m_bstrNextCursor);
+    }
+
+    m_bstrNextCursor = bstrNextCursor;
+    bstrNextCursor = nullptr;
+
+    m_psaPage = psaPage;
+    psaPage = nullptr;
+
+    m_fStarted = TRUE;
+    m_pageCount++;
+
+End:
+
+    if (psaPage)
+    {
+        ::SafeArrayDestroy(psaPage);
+        psaPage = nullptr;
+    }
+
+    if (bstrNextCursor)
+    {
+        ::SysFreeString(bstrNextCursor);
+        bstrNextCursor = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveEnumerationCursor::ReleasePage()
+{
+    // The array must be unlocked before it is destroyed
+    m_reader.Close();
+
+    if (m_psaPage)
+    {
+        ::SafeArrayDestroy(m_psaPage);
+        m_psaPage = nullptr;
+    }
+}
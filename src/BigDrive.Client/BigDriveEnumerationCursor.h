@@ -0,0 +1,135 @@
+// <copyright file="BigDriveEnumerationCursor.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <oaidl.h>
+
+// Local
+#include "BigDriveEnumerationReader.h"
+#include "Interfaces/IBigDriveEnumeratePaged.h"
+
+/// <summary>
+/// Forward-only cursor over the entries of a folder, read one page at a time through
+/// IBigDriveEnumeratePaged. Only the current page is held, so memory is bounded by the
+/// page size however large the folder is, and the first entries are available as soon as
+/// the first page arrives. The next page is requested when the current one is used up.
+/// </summary>
+class BigDriveEnumerationCursor
+{
+private:
+
+    /// <summary>
+    /// The provider interface. AddRef'd.
+    /// </summary>
+    IBigDriveEnumeratePaged* m_pEnumeratePaged;
+
+    /// <summary>
+    /// The drive being enumerated.
+    /// </summary>
+    GUID m_driveGuid;
+
+    /// <summary>
+    /// The path being enumerated.
+    /// </summary>
+    BSTR m_bstrPath;
+
+    /// <summary>
+    /// BigDriveEnumerateEntries flags.
+    /// </summary>
+    LONG m_flags;
+
+    /// <summary>
+    /// Number of entries requested per page.
+    /// </summary>
+    LONG m_pageSize;
+
+    /// <summary>
+    /// Cursor of the page after the current one, or nullptr if the current page is the last.
+    /// </summary>
+    BSTR m_bstrNextCursor;
+
+    /// <summary>
+    /// TRUE once the first page has been requested.
+    /// </summary>
+    BOOL m_fStarted;
+
+    /// <summary>
+    /// The current page, or nullptr before the first page.
+    /// </summary>
+    SAFEARRAY* m_psaPage;
+
+    /// <summary>
+    /// Reader over the current page.
+    /// </summary>
+    BigDriveEnumerationReader m_reader;
+
+    /// <summary>
+    /// Number of pages fetched since the cursor was initialized or reset.
+    /// </summary>
+    ULONG m_pageCount;
+
+public:
+
+    /// <summary>
+    /// Page size used when the caller passes zero.
+    /// </summary>
+    static const LONG DefaultPageSize = 1000;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveEnumerationCursor"/> class.
+    /// </summary>
+    BigDriveEnumerationCursor();
+
+    /// <summary>
+    /// Releases the current page and the provider interface.
+    /// </summary>
+    ~BigDriveEnumerationCursor();
+
+    /// <summary>
+    /// Prepares the cursor. No provider call is made until <see cref="Next"/>.
+    /// </summary>
+    /// <param name="pEnumeratePaged">The provider interface. The cursor AddRefs it.</param>
+    /// <param name="driveGuid">The drive to enumerate.</param>
+    /// <param name="bstrPath">The path to enumerate. The cursor keeps a copy.</param>
+    /// <param name="flags">BigDriveEnumerateEntries flags.</param>
+    /// <param name="pageSize">Entries per page, or zero for <see cref="DefaultPageSize"/>.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT Initialize(IBigDriveEnumeratePaged* pEnumeratePaged, REFGUID driveGuid, BSTR bstrPath, LONG flags, LONG pageSize);
+
+    /// <summary>
+    /// Reads the next entry, fetching the next page from the provider when the current one is used up.
+    /// The name and etag of the entry point into the current page and are only valid until the next call.
+    /// </summary>
+    /// <param name="entry">Receives the entry.</param>
+    /// <returns>S_OK if an entry was read; S_FALSE at the end; otherwise, the provider or reader error.</returns>
+    HRESULT Next(BigDriveEnumerationEntry& entry);
+
+    /// <summary>
+    /// Releases the current page so the next call to <see cref="Next"/> starts again from the first page.
+    /// </summary>
+    /// <returns>S_OK.</returns>
+    HRESULT Reset();
+
+    /// <summary>
+    /// Retrieves the number of pages fetched since the cursor was initialized or reset.
+    /// </summary>
+    /// <returns>The page count.</returns>
+    ULONG GetPageCount();
+
+private:
+
+    /// <summary>
+    /// Replaces the current page with the page named by <see cref="m_bstrNextCursor"/>.
+    /// </summary>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code. The cursor is unchanged on failure.</returns>
+    HRESULT FetchPage();
+
+    /// <summary>
+    /// Releases the current page.
+    /// </summary>
+    void ReleasePage();
+};
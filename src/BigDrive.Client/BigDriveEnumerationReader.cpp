@@ -0,0 +1,204 @@
+// <copyright file="BigDriveEnumerationReader.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveEnumerationReader.h"
+
+// System
+#include <oleauto.h>
+#include <string.h>
+
+namespace
+{
+    template <typename T>
+    inline T ReadValue(const BYTE* p)
+    {
+        T value;
+        ::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+}
+
+/// <inheritdoc />
+BigDriveEnumerationReader::BigDriveEnumerationReader()
+    : m_psa(nullptr),
+    m_pBuffer(nullptr),
+    m_cbBuffer(0),
+    m_offset(0),
+    m_count(0),
+    m_read(0)
+{
+}
+
+/// <inheritdoc />
+BigDriveEnumerationReader::~BigDriveEnumerationReader()
+{
+    Close();
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationReader::Initialize(SAFEARRAY* psa)
+{
+    HRESULT hr = S_OK;
+    VARTYPE vt = VT_EMPTY;
+    LONG lowerBound = 0;
+    LONG upperBound = 0;
+    void* pData = nullptr;
+
+    Close();
+
+    if ((psa == nullptr) || (::SafeArrayGetDim(psa) != 1))
+    {
+        return E_INVALIDARG;
+    }
+
+    hr = ::SafeArrayGetVartype(psa, &vt);
+    if (FAILED(hr) || (vt != VT_UI1))
+    {
+        return E_INVALIDARG;
+    }
+
+    ::SafeArrayGetLBound(psa, 1, &lowerBound);
+    ::SafeArrayGetUBound(psa, 1, &upperBound);
+
+    hr = ::SafeArrayAccessData(psa, &pData);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_psa = psa;
+
+    hr = Initialize(static_cast<const BYTE*>(pData), static_cast<ULONG>(upperBound - lowerBound + 1));
+    if (FAILED(hr))
+    {
+        Close();
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationReader::Initialize(const BYTE* pBuffer, ULONG cbBuffer)
+{
+    if ((pBuffer == nullptr) || (cbBuffer < HeaderSize))
+    {
+        return E_INVALIDARG;
+    }
+
+    if ((ReadValue<DWORD>(pBuffer) != BIGDRIVE_ENUMERATION_SIGNATURE) || (ReadValue<USHORT>(pBuffer + 4) < 1))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_pBuffer = pBuffer;
+    m_cbBuffer = cbBuffer;
+    m_offset = HeaderSize;
+    m_count = ReadValue<DWORD>(pBuffer + 8);
+    m_read = 0;
+
+    // Every record needs at least its fixed part
+    if (m_count > (cbBuffer - HeaderSize) / FixedRecordSize)
+    {
+        m_pBuffer = nullptr;
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+ULONG BigDriveEnumerationReader::GetCount()
+{
+    return m_count;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationReader::Next(BigDriveEnumerationEntry& entry)
+{
+    const BYTE* pRecord = nullptr;
+    ULONG cbRecord = 0;
+    ULONG cbStrings = 0;
+
+    ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+
+    if (m_pBuffer == nullptr)
+    {
+        return E_UNEXPECTED;
+    }
+
+    if (m_read >= m_count)
+    {
+        return S_FALSE;
+    }
+
+    if (m_cbBuffer - m_offset < FixedRecordSize)
+    {
+        return E_INVALIDARG;
+    }
+
+    pRecord = m_pBuffer + m_offset;
+    cbRecord = ReadValue<DWORD>(pRecord);
+
+    entry.uType = ReadValue<DWORD>(pRecord + 4);
+    entry.dwFields = ReadValue<DWORD>(pRecord + 8);
+    entry.dwAttributes = ReadValue<DWORD>(pRecord + 12);
+    entry.ullSize = ReadValue<ULONGLONG>(pRecord + 16);
+    entry.ftLastWrite = ReadValue<FILETIME>(pRecord + 24);
+    entry.cchName = ReadValue<USHORT>(pRecord + 32);
+    entry.cchETag = ReadValue<USHORT>(pRecord + 34);
+
+    cbStrings = (static_cast<ULONG>(entry.cchName) + entry.cchETag) * sizeof(WCHAR);
+
+    if ((cbRecord < FixedRecordSize + cbStrings) || (cbRecord > m_cbBuffer - m_offset) || (entry.cchName == 0) || (entry.uType > 1))
+    {
+        ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+        return E_INVALIDARG;
+    }
+
+    entry.pchName = reinterpret_cast<LPCWSTR>(pRecord + FixedRecordSize);
+    entry.pchETag = reinterpret_cast<LPCWSTR>(pRecord + FixedRecordSize + entry.cchName * sizeof(WCHAR));
+
+    m_offset += cbRecord;
+    m_read++;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+ULONGLONG BigDriveEnumerationReader::HashETag(LPCWSTR pchETag, USHORT cchETag)
+{
+    ULONGLONG hash = 14695981039346656037ULL;
+
+    if ((pchETag == nullptr) || (cchETag == 0))
+    {
+        return 0;
+    }
+
+    for (USHORT i = 0; i < cchETag; i++)
+    {
+        hash ^= static_cast<USHORT>(pchETag[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/// <inheritdoc />
+void BigDriveEnumerationReader::Close()
+{
+    if (m_psa != nullptr)
+    {
+        ::SafeArrayUnaccessData(m_psa);
+        m_psa = nullptr;
+    }
+
+    m_pBuffer = nullptr;
+    m_cbBuffer = 0;
+    m_offset = 0;
+    m_count = 0;
+    m_read = 0;
+}
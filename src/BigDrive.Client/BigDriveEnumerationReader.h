@@ -0,0 +1,190 @@
+// <copyright file="BigDriveEnumerationReader.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <oaidl.h>
+
+/// <summary>
+/// Signature of the packed buffer returned by IBigDriveEnumerateEx ('BDEN').
+/// </summary>
+#define BIGDRIVE_ENUMERATION_SIGNATURE 0x4E454442
+
+/// <summary>
+/// Bits of <see cref="BigDriveEnumerationEntry::dwFields"/> naming the values the provider supplied.
+/// The values match BigDriveItemField in BigDrive.ShellFolder.
+/// </summary>
+enum BigDriveEnumerationField
+{
+    BigDriveEnumerationField_Size = 0x01,
+    BigDriveEnumerationField_LastWriteTime = 0x02,
+    BigDriveEnumerationField_Attributes = 0x04,
+    BigDriveEnumerationField_ETag = 0x08,
+    BigDriveEnumerationField_HasChildren = 0x10,
+    BigDriveEnumerationField_NoChildren = 0x20
+};
+
+/// <summary>
+/// An entry read from the packed buffer. The name and etag point into the buffer and
+/// are NOT null terminated; they are only valid while the reader is.
+/// </summary>
+struct BigDriveEnumerationEntry
+{
+    /// <summary>
+    /// 0 for a file, 1 for a folder (the BigDriveItemType values).
+    /// </summary>
+    UINT uType;
+
+    /// <summary>
+    /// Combination of <see cref="BigDriveEnumerationField"/> bits.
+    /// </summary>
+    DWORD dwFields;
+
+    /// <summary>
+    /// FILE_ATTRIBUTE_* bits.
+    /// </summary>
+    DWORD dwAttributes;
+
+    /// <summary>
+    /// Size in bytes.
+    /// </summary>
+    ULONGLONG ullSize;
+
+    /// <summary>
+    /// Last write time, in UTC.
+    /// </summary>
+    FILETIME ftLastWrite;
+
+    /// <summary>
+    /// The name, cchName characters long.
+    /// </summary>
+    LPCWSTR pchName;
+
+    /// <summary>
+    /// Number of characters in the name.
+    /// </summary>
+    USHORT cchName;
+
+    /// <summary>
+    /// The etag, cchETag characters long.
+    /// </summary>
+    LPCWSTR pchETag;
+
+    /// <summary>
+    /// Number of characters in the etag.
+    /// </summary>
+    USHORT cchETag;
+};
+
+/// <summary>
+/// Forward-only reader over the packed entries returned by IBigDriveEnumerateEx::EnumerateEntries.
+/// The layout is defined by EnumerationEntrySerializer in BigDrive.Interfaces:
+///
+///   Header: [UINT32 signature][UINT16 version][UINT16 reserved][UINT32 count]
+///   Record: [UINT32 cbRecord][UINT32 type][UINT32 fields][UINT32 attributes]
+///           [UINT64 size][INT64 lastWrite][UINT16 cchName][UINT16 cchETag]
+///           [WCHAR name[cchName]][WCHAR etag[cchETag]]
+///
+/// Every record is bounds checked against the buffer; records larger than this version
+/// knows about are skipped using cbRecord.
+/// </summary>
+class BigDriveEnumerationReader
+{
+private:
+
+    /// <summary>
+    /// The SAFEARRAY whose data is locked, or nullptr when reading a raw buffer.
+    /// </summary>
+    SAFEARRAY* m_psa;
+
+    /// <summary>
+    /// Start of the packed buffer.
+    /// </summary>
+    const BYTE* m_pBuffer;
+
+    /// <summary>
+    /// Size of the packed buffer in bytes.
+    /// </summary>
+    ULONG m_cbBuffer;
+
+    /// <summary>
+    /// Offset of the next record.
+    /// </summary>
+    ULONG m_offset;
+
+    /// <summary>
+    /// Number of records in the buffer.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// Number of records read.
+    /// </summary>
+    ULONG m_read;
+
+public:
+
+    /// <summary>
+    /// Size in bytes of the header.
+    /// </summary>
+    static const ULONG HeaderSize = 12;
+
+    /// <summary>
+    /// Size in bytes of the fixed part of a record.
+    /// </summary>
+    static const ULONG FixedRecordSize = 36;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveEnumerationReader"/> class.
+    /// </summary>
+    BigDriveEnumerationReader();
+
+    /// <summary>
+    /// Unlocks the SAFEARRAY, if any. The SAFEARRAY is not destroyed.
+    /// </summary>
+    ~BigDriveEnumerationReader();
+
+    /// <summary>
+    /// Starts reading a SAFEARRAY of VT_UI1 returned by EnumerateEntries. The array stays locked until the reader is destroyed.
+    /// </summary>
+    /// <param name="psa">The array. The caller keeps ownership.</param>
+    /// <returns>S_OK on success; E_INVALIDARG if the array or its header is malformed.</returns>
+    HRESULT Initialize(SAFEARRAY* psa);
+
+    /// <summary>
+    /// Starts reading a raw packed buffer.
+    /// </summary>
+    /// <param name="pBuffer">The buffer. Must outlive the reader.</param>
+    /// <param name="cbBuffer">Size of the buffer in bytes.</param>
+    /// <returns>S_OK on success; E_INVALIDARG if the header is malformed.</returns>
+    HRESULT Initialize(const BYTE* pBuffer, ULONG cbBuffer);
+
+    /// <summary>
+    /// Retrieves the number of records declared by the header.
+    /// </summary>
+    /// <returns>The record count.</returns>
+    ULONG GetCount();
+
+    /// <summary>
+    /// Reads the next record.
+    /// </summary>
+    /// <param name="entry">Receives the record.</param>
+    /// <returns>S_OK if a record was read; S_FALSE at the end; E_INVALIDARG if the record is malformed.</returns>
+    HRESULT Next(BigDriveEnumerationEntry& entry);
+
+    /// <summary>
+    /// Computes a 64-bit change token from an etag (FNV-1a over the UTF-16 code units).
+    /// </summary>
+    /// <param name="pchETag">The etag.</param>
+    /// <param name="cchETag">Number of characters in the etag.</param>
+    /// <returns>The change token; zero for an empty etag.</returns>
+    static ULONGLONG HashETag(LPCWSTR pchETag, USHORT cchETag);
+
+    /// <summary>
+    /// Unlocks the SAFEARRAY and resets the reader. Call before destroying the array.
+    /// </summary>
+    void Close();
+};
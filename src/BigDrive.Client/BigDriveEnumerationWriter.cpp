@@ -0,0 +1,206 @@
+// <copyright file="BigDriveEnumerationWriter.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveEnumerationWriter.h"
+
+// System
+#include <limits.h>
+#include <string.h>
+#include <wchar.h>
+
+namespace
+{
+    // Size of the buffer allocated on first use
+    const ULONG InitialCapacity = 4096;
+
+    template <typename T>
+    inline void WriteValue(BYTE* p, T value)
+    {
+        ::memcpy(p, &value, sizeof(T));
+    }
+}
+
+/// <inheritdoc />
+BigDriveEnumerationWriter::BigDriveEnumerationWriter(ULONG cbLimit)
+    : m_pBuffer(nullptr),
+    m_cbBuffer(0),
+    m_cbCapacity(0),
+    m_cbLimit(cbLimit),
+    m_count(0)
+{
+}
+
+/// <inheritdoc />
+BigDriveEnumerationWriter::~BigDriveEnumerationWriter()
+{
+    if (m_pBuffer)
+    {
+        delete[] m_pBuffer;
+        m_pBuffer = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationWriter::Append(const BigDriveEnumerationEntry& entry)
+{
+    HRESULT hr = S_OK;
+    ULONG cbStrings = (static_cast<ULONG>(entry.cchName) + entry.cchETag) * sizeof(WCHAR);
+    ULONG cbRecord = BigDriveEnumerationReader::FixedRecordSize + cbStrings;
+    BYTE* pRecord = nullptr;
+
+    if ((entry.pchName == nullptr) || (entry.cchName == 0) || ((entry.pchETag == nullptr) && (entry.cchETag > 0)))
+    {
+        return E_INVALIDARG;
+    }
+
+    hr = Reserve(cbRecord);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    pRecord = m_pBuffer + m_cbBuffer;
+
+    WriteValue<DWORD>(pRecord, cbRecord);
+    WriteValue<DWORD>(pRecord + 4, entry.uType);
+    WriteValue<DWORD>(pRecord + 8, entry.dwFields);
+    WriteValue<DWORD>(pRecord + 12, entry.dwAttributes);
+    WriteValue<ULONGLONG>(pRecord + 16, entry.ullSize);
+    WriteValue<FILETIME>(pRecord + 24, entry.ftLastWrite);
+    WriteValue<USHORT>(pRecord + 32, entry.cchName);
+    WriteValue<USHORT>(pRecord + 34, entry.cchETag);
+
+    ::memcpy(pRecord + BigDriveEnumerationReader::FixedRecordSize, entry.pchName, entry.cchName * sizeof(WCHAR));
+
+    if (entry.cchETag > 0)
+    {
+        ::memcpy(pRecord + BigDriveEnumerationReader::FixedRecordSize + entry.cchName * sizeof(WCHAR), entry.pchETag, entry.cchETag * sizeof(WCHAR));
+    }
+
+    m_cbBuffer += cbRecord;
+    m_count++;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationWriter::AppendName(UINT uType, LPCWSTR szName)
+{
+    BigDriveEnumerationEntry entry;
+    size_t cchName = 0;
+
+    if (szName == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    cchName = ::wcslen(szName);
+    if ((cchName == 0) || (cchName > USHRT_MAX))
+    {
+        return E_INVALIDARG;
+    }
+
+    ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+    entry.uType = uType;
+    entry.pchName = szName;
+    entry.cchName = static_cast<USHORT>(cchName);
+
+    return Append(entry);
+}
+
+/// <inheritdoc />
+void BigDriveEnumerationWriter::Reset()
+{
+    // Keep the allocation for the next listing; only the header remains
+    m_cbBuffer = (m_pBuffer != nullptr) ? BigDriveEnumerationReader::HeaderSize : 0;
+    m_count = 0;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationWriter::GetBuffer(const BYTE** ppBuffer, ULONG& cbBuffer)
+{
+    HRESULT hr = S_OK;
+
+    *ppBuffer = nullptr;
+    cbBuffer = 0;
+
+    hr = Reserve(0);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    WriteValue<DWORD>(m_pBuffer + 8, m_count);
+
+    *ppBuffer = m_pBuffer;
+    cbBuffer = m_cbBuffer;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+ULONG BigDriveEnumerationWriter::GetCount()
+{
+    return m_count;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveEnumerationWriter::Reserve(ULONG cbRecord)
+{
+    ULONG cbNeeded = 0;
+    ULONG cbCapacity = 0;
+    BYTE* pBuffer = nullptr;
+
+    if (m_pBuffer == nullptr)
+    {
+        m_pBuffer = new BYTE[InitialCapacity];
+        if (m_pBuffer == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        m_cbCapacity = InitialCapacity;
+
+        // Header: signature, version 1, reserved, count
+        WriteValue<DWORD>(m_pBuffer, BIGDRIVE_ENUMERATION_SIGNATURE);
+        WriteValue<USHORT>(m_pBuffer + 4, 1);
+        WriteValue<USHORT>(m_pBuffer + 6, 0);
+        WriteValue<DWORD>(m_pBuffer + 8, 0);
+        m_cbBuffer = BigDriveEnumerationReader::HeaderSize;
+    }
+
+    if ((cbRecord > m_cbLimit) || (m_cbBuffer > m_cbLimit - cbRecord))
+    {
+        return E_NOT_SUFFICIENT_BUFFER;
+    }
+
+    cbNeeded = m_cbBuffer + cbRecord;
+    if (cbNeeded <= m_cbCapacity)
+    {
+        return S_OK;
+    }
+
+    cbCapacity = m_cbCapacity;
+    while (cbCapacity < cbNeeded)
+    {
+        cbCapacity = (cbCapacity > m_cbLimit / 2) ? m_cbLimit : cbCapacity * 2;
+    }
+
+    pBuffer = new BYTE[cbCapacity];
+    if (pBuffer == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    ::memcpy(pBuffer, m_pBuffer, m_cbBuffer);
+    delete[] m_pBuffer;
+
+    m_pBuffer = pBuffer;
+    m_cbCapacity = cbCapacity;
+
+    return S_OK;
+}
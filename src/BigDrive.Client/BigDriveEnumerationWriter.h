@@ -0,0 +1,102 @@
+// <copyright file="BigDriveEnumerationWriter.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveEnumerationReader.h"
+
+/// <summary>
+/// Builds a packed entry buffer in the layout read by <see cref="BigDriveEnumerationReader"/>, so
+/// listings that arrive a page or a name at a time can be kept in the same form as an
+/// IBigDriveEnumerateEx result. The buffer grows as entries are appended, up to a size limit.
+/// </summary>
+class BigDriveEnumerationWriter
+{
+private:
+
+    /// <summary>
+    /// The buffer, starting with the header.
+    /// </summary>
+    BYTE* m_pBuffer;
+
+    /// <summary>
+    /// Number of bytes written, including the header.
+    /// </summary>
+    ULONG m_cbBuffer;
+
+    /// <summary>
+    /// Number of bytes allocated.
+    /// </summary>
+    ULONG m_cbCapacity;
+
+    /// <summary>
+    /// Largest buffer the writer will build.
+    /// </summary>
+    ULONG m_cbLimit;
+
+    /// <summary>
+    /// Number of records written.
+    /// </summary>
+    ULONG m_count;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveEnumerationWriter"/> class.
+    /// </summary>
+    /// <param name="cbLimit">Largest buffer, in bytes, the writer will build.</param>
+    BigDriveEnumerationWriter(ULONG cbLimit);
+
+    /// <summary>
+    /// Frees the buffer.
+    /// </summary>
+    ~BigDriveEnumerationWriter();
+
+    /// <summary>
+    /// Appends a record. The name and etag are copied.
+    /// </summary>
+    /// <param name="entry">The entry to append.</param>
+    /// <returns>S_OK on success; E_NOT_SUFFICIENT_BUFFER if the record would pass the size limit; E_OUTOFMEMORY if the buffer could not grow.</returns>
+    HRESULT Append(const BigDriveEnumerationEntry& entry);
+
+    /// <summary>
+    /// Appends a record that carries a type and a name only, as returned by IBigDriveEnumerate.
+    /// </summary>
+    /// <param name="uType">0 for a file, 1 for a folder.</param>
+    /// <param name="szName">The null terminated name.</param>
+    /// <returns>See <see cref="Append(const BigDriveEnumerationEntry&)"/>; E_INVALIDARG if the name is empty or too long.</returns>
+    HRESULT AppendName(UINT uType, LPCWSTR szName);
+
+    /// <summary>
+    /// Discards every record.
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Retrieves the packed buffer. It stays owned by the writer and is invalidated by the next Append or Reset.
+    /// </summary>
+    /// <param name="ppBuffer">Receives the buffer.</param>
+    /// <param name="cbBuffer">Receives the size of the buffer in bytes.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY if the header could not be allocated.</returns>
+    HRESULT GetBuffer(const BYTE** ppBuffer, ULONG& cbBuffer);
+
+    /// <summary>
+    /// Retrieves the number of records written.
+    /// </summary>
+    /// <returns>The record count.</returns>
+    ULONG GetCount();
+
+private:
+
+    /// <summary>
+    /// Makes room for cbRecord more bytes, allocating the header on first use.
+    /// </summary>
+    /// <param name="cbRecord">Number of bytes needed.</param>
+    /// <returns>S_OK on success; E_NOT_SUFFICIENT_BUFFER past the size limit; E_OUTOFMEMORY if the buffer could not grow.</returns>
+    HRESULT Reserve(ULONG cbRecord);
+};
@@ -0,0 +1,259 @@
+// <copyright file="BigDriveIconCache.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveIconCache.h"
+
+// System
+#include <wchar.h>
+
+// Local
+#include "BigDrivePerformanceCounters.h"
+
+/// <inheritdoc />
+BigDriveIconCache::BigDriveIconCache()
+    : m_count(0),
+    m_watchCount(0),
+    m_hits(0),
+    m_misses(0),
+    m_clears(0)
+{
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        m_apBuckets[i] = nullptr;
+    }
+
+    ::ZeroMemory(m_apWatches, sizeof(m_apWatches));
+
+    ::InitializeSRWLock(&m_lock);
+    ::InitializeSRWLock(&m_watchLock);
+}
+
+/// <inheritdoc />
+BigDriveIconCache::~BigDriveIconCache()
+{
+    ::AcquireSRWLockExclusive(&m_watchLock);
+
+    for (ULONG i = 0; i < m_watchCount; i++)
+    {
+        delete m_apWatches[i];
+        m_apWatches[i] = nullptr;
+    }
+
+    m_watchCount = 0;
+
+    ::ReleaseSRWLockExclusive(&m_watchLock);
+
+    ::AcquireSRWLockExclusive(&m_lock);
+    FreeNodes();
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveIconCache& BigDriveIconCache::GetInstance()
+{
+    static BigDriveIconCache* s_pInstance = new BigDriveIconCache();
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveIconCache::GetIconLocation(LPCWSTR szExtension, BigDriveIconResolver pfnResolve, BigDriveIconLocation& location)
+{
+    HRESULT hr = S_OK;
+    size_t cchExtension = 0;
+    ULONG hash = 0;
+    BigDriveIconCacheNode* pNode = nullptr;
+
+    if ((szExtension == nullptr) || (pfnResolve == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    cchExtension = ::wcslen(szExtension);
+    if (cchExtension > MaxExtensionLength)
+    {
+        // Too long to be a real type; not worth a node
+        ::InterlockedIncrement(&m_misses);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_IconCacheMisses);
+        return pfnResolve(szExtension, location);
+    }
+
+    hash = Hash(szExtension, cchExtension);
+
+    ::AcquireSRWLockShared(&m_lock);
+
+    pNode = Find(szExtension, cchExtension, hash);
+    if (pNode != nullptr)
+    {
+        location = pNode->location;
+    }
+
+    ::ReleaseSRWLockShared(&m_lock);
+
+    if (pNode != nullptr)
+    {
+        ::InterlockedIncrement(&m_hits);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_IconCacheHits);
+        return S_OK;
+    }
+
+    ::InterlockedIncrement(&m_misses);
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_IconCacheMisses);
+
+    // Resolved outside the lock; two threads missing on the same extension both ask, and one stores
+    hr = pfnResolve(szExtension, location);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if ((m_count < MaxEntries) && (Find(szExtension, cchExtension, hash) == nullptr))
+    {
+        pNode = new BigDriveIconCacheNode();
+        if (pNode != nullptr)
+        {
+            ::wcscpy_s(pNode->szExtension, szExtension);
+            pNode->hash = hash;
+            pNode->location = location;
+            pNode->pNextInBucket = m_apBuckets[hash & (BucketCount - 1)];
+            m_apBuckets[hash & (BucketCount - 1)] = pNode;
+            m_count++;
+        }
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+void BigDriveIconCache::Clear()
+{
+    ::AcquireSRWLockExclusive(&m_lock);
+    FreeNodes();
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    ::InterlockedIncrement(&m_clears);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveIconCache::WatchRegistryKey(HKEY hRoot, LPCWSTR szSubKey)
+{
+    HRESULT hr = S_OK;
+    BigDriveRegistryWatch* pWatch = nullptr;
+
+    ::AcquireSRWLockExclusive(&m_watchLock);
+
+    if (m_watchCount >= MaxWatches)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pWatch = new BigDriveRegistryWatch(hRoot, szSubKey, 0, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, OnWatchKeyChanged, this);
+    if (pWatch == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = pWatch->EnsureArmed();
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    m_apWatches[m_watchCount++] = pWatch;
+    pWatch = nullptr;
+
+End:
+
+    if (pWatch != nullptr)
+    {
+        delete pWatch;
+        pWatch = nullptr;
+    }
+
+    ::ReleaseSRWLockExclusive(&m_watchLock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveIconCache::GetStatistics(LONG& hits, LONG& misses, LONG& clears, ULONG& count)
+{
+    hits = ::InterlockedCompareExchange(&m_hits, 0, 0);
+    misses = ::InterlockedCompareExchange(&m_misses, 0, 0);
+    clears = ::InterlockedCompareExchange(&m_clears, 0, 0);
+
+    ::AcquireSRWLockShared(&m_lock);
+    count = m_count;
+    ::ReleaseSRWLockShared(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveIconCacheNode* BigDriveIconCache::Find(LPCWSTR szExtension, size_t cchExtension, ULONG hash)
+{
+    BigDriveIconCacheNode* pNode = nullptr;
+
+    for (pNode = m_apBuckets[hash & (BucketCount - 1)]; pNode != nullptr; pNode = pNode->pNextInBucket)
+    {
+        if ((pNode->hash == hash) &&
+            (::CompareStringOrdinal(pNode->szExtension, -1, szExtension, static_cast<int>(cchExtension), TRUE) == CSTR_EQUAL))
+        {
+            return pNode;
+        }
+    }
+
+    return nullptr;
+}
+
+/// <inheritdoc />
+void BigDriveIconCache::FreeNodes()
+{
+    BigDriveIconCacheNode* pNode = nullptr;
+
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        while (m_apBuckets[i] != nullptr)
+        {
+            pNode = m_apBuckets[i];
+            m_apBuckets[i] = pNode->pNextInBucket;
+            delete pNode;
+        }
+    }
+
+    m_count = 0;
+}
+
+/// <inheritdoc />
+void BigDriveIconCache::OnWatchKeyChanged(PVOID pContext)
+{
+    static_cast<BigDriveIconCache*>(pContext)->Clear();
+}
+
+/// <inheritdoc />
+ULONG BigDriveIconCache::Hash(LPCWSTR szExtension, size_t cchExtension)
+{
+    ULONG hash = 2166136261UL;
+    WCHAR ch = 0;
+
+    for (size_t i = 0; i < cchExtension; i++)
+    {
+        ch = szExtension[i];
+        if ((ch >= L'a') && (ch <= L'z'))
+        {
+            ch = static_cast<WCHAR>(ch - L'a' + L'A');
+        }
+
+        hash ^= ch;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
@@ -0,0 +1,219 @@
+// <copyright file="BigDriveIconCache.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveRegistryWatch.h"
+
+/// <summary>
+/// Where the icon of a type of file is, as IExtractIcon::GetIconLocation returns it.
+/// </summary>
+struct BigDriveIconLocation
+{
+    /// <summary>
+    /// The icon file, or a module name when uFlags has GIL_NOTFILENAME.
+    /// </summary>
+    WCHAR szFile[MAX_PATH];
+
+    /// <summary>
+    /// Index of the icon in the file, or in the system image list with GIL_NOTFILENAME.
+    /// </summary>
+    int iIndex;
+
+    /// <summary>
+    /// GIL_* flags returned with the location.
+    /// </summary>
+    UINT uFlags;
+};
+
+/// <summary>
+/// Looks up the icon of an extension when the cache doesn't have it. Types the system doesn't
+/// know should get a default location and S_OK, so the answer is cached too.
+/// </summary>
+/// <param name="szExtension">The extension, including the leading dot.</param>
+/// <param name="location">Receives the icon location.</param>
+/// <returns>S_OK on success; otherwise, an HRESULT error code, and nothing is cached.</returns>
+typedef HRESULT (*BigDriveIconResolver)(LPCWSTR szExtension, BigDriveIconLocation& location);
+
+/// <summary>
+/// An extension's cached icon location and its place in the hash buckets.
+/// </summary>
+struct BigDriveIconCacheNode
+{
+    /// <summary>
+    /// The extension, including the leading dot.
+    /// </summary>
+    WCHAR szExtension[32];
+
+    /// <summary>
+    /// Hash of the extension.
+    /// </summary>
+    ULONG hash;
+
+    /// <summary>
+    /// The icon location.
+    /// </summary>
+    BigDriveIconLocation location;
+
+    /// <summary>
+    /// Next node in the bucket chain.
+    /// </summary>
+    BigDriveIconCacheNode* pNextInBucket;
+};
+
+/// <summary>
+/// Process-wide cache of icon locations keyed by file extension, so a folder of ten thousand
+/// .jpg files asks the system for the .jpg icon once rather than once per item drawn. Extensions
+/// are matched without regard to the case of ASCII letters. The cache holds a bounded number of
+/// extensions; past that, lookups go to the resolver without being stored.
+///
+/// Icon locations change when file associations or the icon theme change. A host with a window
+/// calls <see cref="Clear"/> on SHCNE_ASSOCCHANGED and WM_SETTINGCHANGE; for changes nothing
+/// announces, the cache can watch registry keys and is cleared whenever anything under one changes.
+/// </summary>
+class BigDriveIconCache
+{
+private:
+
+    /// <summary>
+    /// Number of hash buckets. Must be a power of two.
+    /// </summary>
+    static const ULONG BucketCount = 64;
+
+    /// <summary>
+    /// Most registry keys watched at once.
+    /// </summary>
+    static const ULONG MaxWatches = 8;
+
+    /// <summary>
+    /// Hash buckets.
+    /// </summary>
+    BigDriveIconCacheNode* m_apBuckets[BucketCount];
+
+    /// <summary>
+    /// Number of extensions held.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// Watches on the registry keys, which clear the cache.
+    /// </summary>
+    BigDriveRegistryWatch* m_apWatches[MaxWatches];
+
+    /// <summary>
+    /// Number of watched registry keys.
+    /// </summary>
+    ULONG m_watchCount;
+
+    /// <summary>
+    /// Guards the buckets and the count.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Guards the watches.
+    /// </summary>
+    SRWLOCK m_watchLock;
+
+    /// <summary>
+    /// Counter of lookups served from the cache.
+    /// </summary>
+    volatile LONG m_hits;
+
+    /// <summary>
+    /// Counter of lookups that went to the resolver.
+    /// </summary>
+    volatile LONG m_misses;
+
+    /// <summary>
+    /// Counter of times the cache was cleared.
+    /// </summary>
+    volatile LONG m_clears;
+
+public:
+
+    /// <summary>
+    /// Most extensions held.
+    /// </summary>
+    static const ULONG MaxEntries = 1024;
+
+    /// <summary>
+    /// Longest extension cached, in characters including the leading dot. Longer ones aren't cached.
+    /// </summary>
+    static const size_t MaxExtensionLength = 31;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveIconCache"/> class.
+    /// </summary>
+    BigDriveIconCache();
+
+    /// <summary>
+    /// Stops watching the registry and frees every entry.
+    /// </summary>
+    ~BigDriveIconCache();
+
+    /// <summary>
+    /// Retrieves the process-wide instance.
+    /// </summary>
+    /// <returns>The icon cache.</returns>
+    static BigDriveIconCache& GetInstance();
+
+    /// <summary>
+    /// Retrieves the icon location of an extension, asking the resolver on a miss and caching its answer.
+    /// </summary>
+    /// <param name="szExtension">The extension, including the leading dot.</param>
+    /// <param name="pfnResolve">Looks up the icon on a miss.</param>
+    /// <param name="location">Receives the icon location.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; otherwise, the error from the resolver.</returns>
+    HRESULT GetIconLocation(LPCWSTR szExtension, BigDriveIconResolver pfnResolve, BigDriveIconLocation& location);
+
+    /// <summary>
+    /// Drops every extension.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Clears the cache whenever a value or subkey under a registry key changes. The key is
+    /// watched until the cache is destroyed.
+    /// </summary>
+    /// <param name="hRoot">An open key, such as HKEY_CURRENT_USER.</param>
+    /// <param name="szSubKey">The key to watch, relative to hRoot. Must outlive the cache.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY if too many keys are watched; otherwise, an HRESULT error code.</returns>
+    HRESULT WatchRegistryKey(HKEY hRoot, LPCWSTR szSubKey);
+
+    /// <summary>
+    /// Retrieves the cache counters.
+    /// </summary>
+    /// <param name="hits">Receives the number of lookups served from the cache.</param>
+    /// <param name="misses">Receives the number of lookups that went to the resolver.</param>
+    /// <param name="clears">Receives the number of times the cache was cleared.</param>
+    /// <param name="count">Receives the number of extensions held.</param>
+    void GetStatistics(LONG& hits, LONG& misses, LONG& clears, ULONG& count);
+
+private:
+
+    /// <summary>
+    /// Finds the node of an extension. The caller must hold the lock.
+    /// </summary>
+    BigDriveIconCacheNode* Find(LPCWSTR szExtension, size_t cchExtension, ULONG hash);
+
+    /// <summary>
+    /// Frees every node. The caller must hold the lock exclusive.
+    /// </summary>
+    void FreeNodes();
+
+    /// <summary>
+    /// Registry watch callback: clears the cache.
+    /// </summary>
+    static void OnWatchKeyChanged(PVOID pContext);
+
+    /// <summary>
+    /// Hashes an extension without regard to the case of ASCII letters.
+    /// </summary>
+    static ULONG Hash(LPCWSTR szExtension, size_t cchExtension);
+};
@@ -13,20 +13,43 @@
 
 // Local
 #include "BigDriveClientEventLogger.h"
+#include "BigDriveConfigurationClient.h"
 #include "Interfaces/IBigDriveConfiguration.h"
 #include "Interfaces/IBigDriveEnumerate.h"
 #include "Interfaces/IBigDriveFileInfo.h"
 #include "Interfaces/IBigDriveFileOperations.h"
+#include "BigDrivePerformanceCounters.h"
 
 // Initialize the static EventLogger instance
 BigDriveClientEventLogger BigDriveInterfaceProvider::s_eventLogger(L"BigDrive.Client");
 
+/// <summary>
+/// A provider call handed to <see cref="BigDriveSingleFlight"/>.
+/// </summary>
+struct BigDriveProviderCall
+{
+    /// <summary>
+    /// The provider making the call.
+    /// </summary>
+    BigDriveInterfaceProvider* pInterfaceProvider;
+
+    /// <summary>
+    /// The call.
+    /// </summary>
+    BigDriveSingleFlightOperation operation;
+
+    /// <summary>
+    /// The path passed to the provider.
+    /// </summary>
+    BSTR bstrPath;
+};
+
 /// <summary>
 /// Initializes a new instance of the <see cref="BigDriveInterfaceProvider"/> class with the specified CLSID.
 /// </summary>
 /// <param name="clsid">The CLSID of the COM+ class.</param>
 BigDriveInterfaceProvider::BigDriveInterfaceProvider(const CLSID& clsid)
-    : m_clsid(clsid)
+    : m_clsid(clsid), m_driveGuid(GUID_NULL)
 {
 }
 
@@ -35,8 +58,23 @@ BigDriveInterfaceProvider::BigDriveInterfaceProvider(const CLSID& clsid)
 /// </summary>
 /// <param name="driveConfiguration">The drive configuration containing the CLSID of the COM+ class.</param>
 BigDriveInterfaceProvider::BigDriveInterfaceProvider(DriveConfiguration& driveConfiguration)
-    : m_clsid(driveConfiguration.clsid)
+    : m_clsid(driveConfiguration.clsid), m_driveGuid(driveConfiguration.id)
+{
+}
+
+/// <summary>
+/// Drops the pooled connection for the drive if the failure indicates the provider was disconnected.
+/// </summary>
+/// <param name="hrFailure">The HRESULT returned by the failed call.</param>
+/// <returns>S_OK if the call should be retried; S_FALSE otherwise.</returns>
+HRESULT BigDriveInterfaceProvider::Reconnect(HRESULT hrFailure)
 {
+    if (::IsEqualGUID(m_driveGuid, GUID_NULL))
+    {
+        return S_FALSE;
+    }
+
+    return BigDriveConnectionPool::GetInstance().Reconnect(m_driveGuid, hrFailure);
 }
 
 /// <summary>
@@ -55,6 +93,18 @@ HRESULT BigDriveInterfaceProvider::GetInterface(const IID& iid, IUnknown** ppIUn
         return E_POINTER; // Return an appropriate error code
     }
 
+    // Drive bound providers reuse the pooled connection for the drive
+    if (!::IsEqualGUID(m_driveGuid, GUID_NULL))
+    {
+        hr = BigDriveConnectionPool::GetInstance().GetInterface(m_driveGuid, m_clsid, iid, ppIUnknown);
+        if (FAILED(hr))
+        {
+            s_eventLogger.WriteErrorFormmated(L"Failed to get pooled COM instance. HRESULT: 0x%08X", hr);
+        }
+
+        goto End;
+    }
+
     // Create an instance of the COM class
     hr = ::CoCreateInstance(m_clsid, nullptr, CLSCTX_LOCAL_SERVER, iid, reinterpret_cast<void**>(&pIUnknown));
     if (FAILED(hr))
@@ -151,6 +201,78 @@ End:
     return hr;
 }
 
+/// <summary>
+/// Retrieves the optional IBigDriveEnumerateEx interface from the COM+ class instance.
+/// </summary>
+/// <param name="ppBigDriveEnumerateEx">A pointer to the IBigDriveEnumerateEx interface pointer to be populated.</param>
+/// <returns>S_OK if retrieved, S_FALSE if the provider doesn't implement it, otherwise an error.</returns>
+HRESULT BigDriveInterfaceProvider::GetIBigDriveEnumerateEx(IBigDriveEnumerateEx** ppBigDriveEnumerateEx)
+{
+    HRESULT hr = S_OK;
+
+    if (ppBigDriveEnumerateEx == nullptr)
+    {
+        return E_POINTER; // Return an appropriate error code
+    }
+
+    *ppBigDriveEnumerateEx = nullptr;
+
+    // The interface is optional, so a provider without it isn't an error
+    hr = GetInterface(IID_IBigDriveEnumerateEx, reinterpret_cast<IUnknown**>(ppBigDriveEnumerateEx));
+    if (hr == E_NOINTERFACE)
+    {
+        hr = S_FALSE;
+    }
+
+    switch (hr)
+    {
+    case S_OK:
+    case S_FALSE:
+        break;
+    default:
+        s_eventLogger.WriteErrorFormmated(L"Failed to get IBigDriveEnumerateEx interface. HRESULT: 0x%08X", hr);
+        break;
+    }
+
+    return hr;
+}
+
+/// <summary>
+/// Retrieves the optional IBigDriveEnumeratePaged interface from the COM+ class instance.
+/// </summary>
+/// <param name="ppBigDriveEnumeratePaged">A pointer to the IBigDriveEnumeratePaged interface pointer to be populated.</param>
+/// <returns>S_OK if retrieved, S_FALSE if the provider doesn't implement it, otherwise an error.</returns>
+HRESULT BigDriveInterfaceProvider::GetIBigDriveEnumeratePaged(IBigDriveEnumeratePaged** ppBigDriveEnumeratePaged)
+{
+    HRESULT hr = S_OK;
+
+    if (ppBigDriveEnumeratePaged == nullptr)
+    {
+        return E_POINTER; // Return an appropriate error code
+    }
+
+    *ppBigDriveEnumeratePaged = nullptr;
+
+    // The interface is optional, so a provider without it isn't an error
+    hr = GetInterface(IID_IBigDriveEnumeratePaged, reinterpret_cast<IUnknown**>(ppBigDriveEnumeratePaged));
+    if (hr == E_NOINTERFACE)
+    {
+        hr = S_FALSE;
+    }
+
+    switch (hr)
+    {
+    case S_OK:
+    case S_FALSE:
+        break;
+    default:
+        s_eventLogger.WriteErrorFormmated(L"Failed to get IBigDriveEnumeratePaged interface. HRESULT: 0x%08X", hr);
+        break;
+    }
+
+    return hr;
+}
+
 /// <summary>
 /// Retrieves the IBigDriveFileInfo interface from the COM+ class instance.
 /// </summary>
@@ -185,6 +307,42 @@ End:
     return hr;
 }
 
+/// <summary>
+/// Retrieves the optional IBigDriveFileInfoBatch interface from the COM+ class instance.
+/// </summary>
+/// <param name="ppBigDriveFileInfoBatch">A pointer to the IBigDriveFileInfoBatch interface pointer to be populated.</param>
+/// <returns>S_OK if retrieved, S_FALSE if the provider doesn't implement it, otherwise an error.</returns>
+HRESULT BigDriveInterfaceProvider::GetIBigDriveFileInfoBatch(IBigDriveFileInfoBatch** ppBigDriveFileInfoBatch)
+{
+    HRESULT hr = S_OK;
+
+    if (ppBigDriveFileInfoBatch == nullptr)
+    {
+        return E_POINTER; // Return an appropriate error code
+    }
+
+    *ppBigDriveFileInfoBatch = nullptr;
+
+    // The interface is optional, so a provider without it isn't an error
+    hr = GetInterface(IID_IBigDriveFileInfoBatch, reinterpret_cast<IUnknown**>(ppBigDriveFileInfoBatch));
+    if (hr == E_NOINTERFACE)
+    {
+        hr = S_FALSE;
+    }
+
+    switch (hr)
+    {
+    case S_OK:
+    case S_FALSE:
+        break;
+    default:
+        s_eventLogger.WriteErrorFormmated(L"Failed to get IBigDriveFileInfoBatch interface. HRESULT: 0x%08X", hr);
+        break;
+    }
+
+    return hr;
+}
+
 /// <summary>
 /// Retrieves the IBigDriveFileData interface from the COM+ class instance.
 /// </summary>
@@ -225,6 +383,365 @@ HRESULT BigDriveInterfaceProvider::GetIBigDriveFileOperations(IBigDriveFileOpera
     return GetInterface(IID_IBigDriveFileOperations, reinterpret_cast<IUnknown**>(ppBigDriveFileOperations));
 }
 
+/// <summary>
+/// Gets the drive's IBigDriveFileOperations for a transfer, dropping the pooled connection first if
+/// the last attempt lost the provider.
+/// </summary>
+/// <param name="driveGuid">The drive.</param>
+/// <param name="hrLastAttempt">The HRESULT of the last attempt, or S_OK.</param>
+/// <param name="pContext">Unused.</param>
+/// <param name="ppFileOperations">Receives the interface pointer.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::GetFileOperations(REFGUID driveGuid, HRESULT hrLastAttempt, void* pContext, IBigDriveFileOperations** ppFileOperations)
+{
+    HRESULT hr = S_OK;
+    DriveConfiguration driveConfig;
+    BigDriveInterfaceProvider* pProvider = nullptr;
+
+    if (ppFileOperations == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppFileOperations = nullptr;
+
+    hr = BigDriveConfigurationClient::GetDriveConfiguration(driveGuid, driveConfig);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    pProvider = new BigDriveInterfaceProvider(driveConfig);
+    if (pProvider == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    // Drops the pooled connection if the provider process went away during the last attempt
+    if (FAILED(hrLastAttempt))
+    {
+        pProvider->Reconnect(hrLastAttempt);
+    }
+
+    hr = pProvider->GetIBigDriveFileOperations(ppFileOperations);
+
+End:
+
+    if (pProvider)
+    {
+        delete pProvider;
+        pProvider = nullptr;
+    }
+
+    return hr;
+}
+
+/// <summary>
+/// Lists the folders of a path, sharing the call with identical requests in flight.
+/// </summary>
+/// <param name="bstrPath">The path of the folder.</param>
+/// <param name="ppsaFolders">Receives the folder names, or nullptr if there are none.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::EnumerateFolders(BSTR bstrPath, SAFEARRAY** ppsaFolders)
+{
+    HRESULT hr = S_OK;
+    VARIANT result;
+
+    if (ppsaFolders == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppsaFolders = nullptr;
+    ::VariantInit(&result);
+
+    hr = Call(BigDriveSingleFlightOperation_EnumerateFolders, bstrPath, &result);
+    if (SUCCEEDED(hr) && (result.vt == (VT_ARRAY | VT_BSTR)))
+    {
+        // The caller takes the copy
+        *ppsaFolders = result.parray;
+        result.vt = VT_EMPTY;
+        result.parray = nullptr;
+    }
+
+    ::VariantClear(&result);
+
+    return hr;
+}
+
+/// <summary>
+/// Lists the files of a path, sharing the call with identical requests in flight.
+/// </summary>
+/// <param name="bstrPath">The path of the folder.</param>
+/// <param name="ppsaFiles">Receives the file names, or nullptr if there are none.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::EnumerateFiles(BSTR bstrPath, SAFEARRAY** ppsaFiles)
+{
+    HRESULT hr = S_OK;
+    VARIANT result;
+
+    if (ppsaFiles == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppsaFiles = nullptr;
+    ::VariantInit(&result);
+
+    hr = Call(BigDriveSingleFlightOperation_EnumerateFiles, bstrPath, &result);
+    if (SUCCEEDED(hr) && (result.vt == (VT_ARRAY | VT_BSTR)))
+    {
+        // The caller takes the copy
+        *ppsaFiles = result.parray;
+        result.vt = VT_EMPTY;
+        result.parray = nullptr;
+    }
+
+    ::VariantClear(&result);
+
+    return hr;
+}
+
+/// <summary>
+/// Retrieves the size of a file, sharing the call with identical requests in flight.
+/// </summary>
+/// <param name="bstrPath">The path of the file.</param>
+/// <param name="pSize">Receives the size in bytes.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::GetFileSize(BSTR bstrPath, ULONGLONG* pSize)
+{
+    HRESULT hr = S_OK;
+    VARIANT result;
+
+    if (pSize == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *pSize = 0;
+    ::VariantInit(&result);
+
+    hr = Call(BigDriveSingleFlightOperation_GetFileSize, bstrPath, &result);
+    if (SUCCEEDED(hr) && (result.vt == VT_UI8))
+    {
+        *pSize = result.ullVal;
+    }
+
+    ::VariantClear(&result);
+
+    return hr;
+}
+
+/// <summary>
+/// Retrieves the last modified time of an item, sharing the call with identical requests in flight.
+/// </summary>
+/// <param name="bstrPath">The path of the item.</param>
+/// <param name="pDate">Receives the time.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::LastModifiedTime(BSTR bstrPath, DATE* pDate)
+{
+    HRESULT hr = S_OK;
+    VARIANT result;
+
+    if (pDate == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *pDate = 0;
+    ::VariantInit(&result);
+
+    hr = Call(BigDriveSingleFlightOperation_LastModifiedTime, bstrPath, &result);
+    if (SUCCEEDED(hr) && (result.vt == VT_DATE))
+    {
+        *pDate = result.date;
+    }
+
+    ::VariantClear(&result);
+
+    return hr;
+}
+
+/// <summary>
+/// Makes a provider call through the single-flight layer, or directly if the provider isn't bound to a drive.
+/// </summary>
+/// <param name="operation">The call.</param>
+/// <param name="bstrPath">The path.</param>
+/// <param name="pResult">Receives the result.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::Call(BigDriveSingleFlightOperation operation, BSTR bstrPath, VARIANT* pResult)
+{
+    BigDriveProviderCall call = { this, operation, bstrPath };
+
+    // Without a drive there is no key to share the call on
+    if (::IsEqualGUID(m_driveGuid, GUID_NULL))
+    {
+        ::VariantInit(pResult);
+        return CallProvider(&call, pResult);
+    }
+
+    return BigDriveSingleFlight::GetInstance().Call(m_driveGuid, operation, (bstrPath != nullptr) ? bstrPath : L"", CallProvider, &call, pResult);
+}
+
+/// <summary>
+/// Makes a call for BigDriveSingleFlight, retrying once on a new connection.
+/// </summary>
+/// <param name="pContext">The BigDriveProviderCall.</param>
+/// <param name="pResult">Receives the result.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::CallProvider(void* pContext, VARIANT* pResult)
+{
+    BigDriveProviderCall* pCall = static_cast<BigDriveProviderCall*>(pContext);
+    HRESULT hr = S_OK;
+
+    hr = pCall->pInterfaceProvider->CallProviderOnce(pCall->operation, pCall->bstrPath, pResult);
+    if (FAILED(hr) && (pCall->pInterfaceProvider->Reconnect(hr) == S_OK))
+    {
+        // The provider process went away, retry once on a new connection
+        hr = pCall->pInterfaceProvider->CallProviderOnce(pCall->operation, pCall->bstrPath, pResult);
+    }
+
+    return hr;
+}
+
+/// <summary>
+/// Makes a call on a newly retrieved interface and counts it.
+/// </summary>
+/// <param name="operation">The call.</param>
+/// <param name="bstrPath">The path.</param>
+/// <param name="pResult">Receives the result.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT BigDriveInterfaceProvider::CallProviderOnce(BigDriveSingleFlightOperation operation, BSTR bstrPath, VARIANT* pResult)
+{
+    static volatile LONG s_enumerateFoldersSlot = -1;
+    static volatile LONG s_enumerateFilesSlot = -1;
+    static volatile LONG s_getFileSizeSlot = -1;
+    static volatile LONG s_lastModifiedTimeSlot = -1;
+    HRESULT hr = S_OK;
+    IBigDriveEnumerate* pBigDriveEnumerate = nullptr;
+    IBigDriveFileInfo* pBigDriveFileInfo = nullptr;
+    SAFEARRAY* psaNames = nullptr;
+    ULONGLONG ullSize = 0;
+    DATE date = 0;
+
+    switch (operation)
+    {
+    case BigDriveSingleFlightOperation_EnumerateFolders:
+    case BigDriveSingleFlightOperation_EnumerateFiles:
+
+        hr = GetIBigDriveEnumerate(&pBigDriveEnumerate);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+
+        if (pBigDriveEnumerate == nullptr)
+        {
+            hr = E_FAIL;
+            goto End;
+        }
+
+        if (operation == BigDriveSingleFlightOperation_EnumerateFolders)
+        {
+            BigDrivePerformanceCounters::BeginProviderCall("IBigDriveEnumerate::EnumerateFolders", s_enumerateFoldersSlot);
+            hr = pBigDriveEnumerate->EnumerateFolders(m_driveGuid, bstrPath, &psaNames);
+            BigDrivePerformanceCounters::EndProviderCall(hr);
+        }
+        else
+        {
+            BigDrivePerformanceCounters::BeginProviderCall("IBigDriveEnumerate::EnumerateFiles", s_enumerateFilesSlot);
+            hr = pBigDriveEnumerate->EnumerateFiles(m_driveGuid, bstrPath, &psaNames);
+            BigDrivePerformanceCounters::EndProviderCall(hr);
+        }
+
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+
+        // A provider with nothing to list may return no array
+        if (psaNames != nullptr)
+        {
+            pResult->vt = VT_ARRAY | VT_BSTR;
+            pResult->parray = psaNames;
+            psaNames = nullptr;
+        }
+
+        break;
+
+    case BigDriveSingleFlightOperation_GetFileSize:
+    case BigDriveSingleFlightOperation_LastModifiedTime:
+
+        hr = GetIBigDriveFileInfo(&pBigDriveFileInfo);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+
+        if (pBigDriveFileInfo == nullptr)
+        {
+            hr = E_FAIL;
+            goto End;
+        }
+
+        if (operation == BigDriveSingleFlightOperation_GetFileSize)
+        {
+            BigDrivePerformanceCounters::BeginProviderCall("IBigDriveFileInfo::GetFileSize", s_getFileSizeSlot);
+            hr = pBigDriveFileInfo->GetFileSize(m_driveGuid, bstrPath, &ullSize);
+            BigDrivePerformanceCounters::EndProviderCall(hr);
+            if (FAILED(hr))
+            {
+                goto End;
+            }
+
+            pResult->vt = VT_UI8;
+            pResult->ullVal = ullSize;
+        }
+        else
+        {
+            BigDrivePerformanceCounters::BeginProviderCall("IBigDriveFileInfo::LastModifiedTime", s_lastModifiedTimeSlot);
+            hr = pBigDriveFileInfo->LastModifiedTime(m_driveGuid, bstrPath, &date);
+            BigDrivePerformanceCounters::EndProviderCall(hr);
+            if (FAILED(hr))
+            {
+                goto End;
+            }
+
+            pResult->vt = VT_DATE;
+            pResult->date = date;
+        }
+
+        break;
+
+    default:
+        hr = E_INVALIDARG;
+        break;
+    }
+
+End:
+
+    if (psaNames)
+    {
+        ::SafeArrayDestroy(psaNames);
+        psaNames = nullptr;
+    }
+
+    if (pBigDriveFileInfo)
+    {
+        pBigDriveFileInfo->Release();
+        pBigDriveFileInfo = nullptr;
+    }
+
+    if (pBigDriveEnumerate)
+    {
+        pBigDriveEnumerate->Release();
+        pBigDriveEnumerate = nullptr;
+    }
+
+    return hr;
+}
+
 /// <summary>
 /// Logs an error message with the CLSID of the provider.
 /// </summary>
@@ -11,11 +11,16 @@
 // Local
 #include "BigDriveClientEventLogger.h"
 #include "Interfaces/IBigDriveEnumerate.h"
+#include "Interfaces/IBigDriveEnumerateEx.h"
+#include "Interfaces/IBigDriveEnumeratePaged.h"
 #include "Interfaces/IBigDriveConfiguration.h"
 #include "Interfaces/IBigDriveFileInfo.h"
+#include "Interfaces/IBigDriveFileInfoBatch.h"
 #include "Interfaces/IBigDriveFileOperations.h"
 #include "Interfaces/IBigDriveFileData.h"
 
+#include "BigDriveConnectionPool.h"
+#include "BigDriveSingleFlight.h"
 #include "DriveConfiguration.h"
 
 /// <summary>
@@ -35,6 +40,12 @@ private:
 	/// </summary>
 	CLSID m_clsid;
 
+	/// <summary>
+	/// The drive served by the provider, or GUID_NULL if the provider isn't bound to a drive.
+	/// Interfaces for a drive are served from the <see cref="BigDriveConnectionPool"/>.
+	/// </summary>
+	GUID m_driveGuid;
+
 public:
 
 	/// <summary>
@@ -49,6 +60,13 @@ public:
 	/// <param name="driveConfiguration">Drive Configuration</param>
 	BigDriveInterfaceProvider(DriveConfiguration& driveConfiguration);
 
+	/// <summary>
+	/// Drops the pooled connection for the drive if a call failed because the provider was disconnected.
+	/// </summary>
+	/// <param name="hrFailure">The HRESULT returned by the failed call on a provider interface.</param>
+	/// <returns>S_OK if the connection was dropped and the call should be retried with a newly retrieved interface; S_FALSE otherwise.</returns>
+	HRESULT Reconnect(HRESULT hrFailure);
+
 	/// <summary>
 	/// Retrieves the requested interface from the COM+ class associated with this provider.
 	/// </summary>
@@ -73,6 +91,20 @@ public:
 	/// <returns>S_OK if the interface was successfully retrieved; otherwise, an HRESULT error code.</returns>
 	HRESULT GetIBigDriveEnumerate(IBigDriveEnumerate** ppBigDriveEnumerate);
 
+	/// <summary>
+	/// Retrieves the optional IBigDriveEnumerateEx interface from the COM+ class associated with this provider.
+	/// </summary>
+	/// <param name="ppBigDriveEnumerateEx">Address of a pointer that receives the IBigDriveEnumerateEx interface pointer on success. Set to nullptr otherwise.</param>
+	/// <returns>S_OK if the interface was successfully retrieved; S_FALSE if the provider doesn't implement it; otherwise, an HRESULT error code.</returns>
+	HRESULT GetIBigDriveEnumerateEx(IBigDriveEnumerateEx** ppBigDriveEnumerateEx);
+
+	/// <summary>
+	/// Retrieves the optional IBigDriveEnumeratePaged interface from the COM+ class associated with this provider.
+	/// </summary>
+	/// <param name="ppBigDriveEnumeratePaged">Address of a pointer that receives the IBigDriveEnumeratePaged interface pointer on success. Set to nullptr otherwise.</param>
+	/// <returns>S_OK if the interface was successfully retrieved; S_FALSE if the provider doesn't implement it; otherwise, an HRESULT error code.</returns>
+	HRESULT GetIBigDriveEnumeratePaged(IBigDriveEnumeratePaged** ppBigDriveEnumeratePaged);
+
 	/// <summary>
 	/// Retrieves the IBigDriveFileInfo interface from the COM+ class associated with this provider.
 	/// </summary>
@@ -80,6 +112,13 @@ public:
 	/// <returns>S_OK if the interface was successfully retrieved; otherwise, an HRESULT error code.</returns>
 	HRESULT GetIBigDriveFileInfo(IBigDriveFileInfo** ppBigDriveFileInfo);
 
+	/// <summary>
+	/// Retrieves the optional IBigDriveFileInfoBatch interface from the COM+ class associated with this provider.
+	/// </summary>
+	/// <param name="ppBigDriveFileInfoBatch">Address of a pointer that receives the IBigDriveFileInfoBatch interface pointer on success. Set to nullptr otherwise.</param>
+	/// <returns>S_OK if the interface was successfully retrieved; S_FALSE if the provider doesn't implement it; otherwise, an HRESULT error code.</returns>
+	HRESULT GetIBigDriveFileInfoBatch(IBigDriveFileInfoBatch** ppBigDriveFileInfoBatch);
+
 	/// <summary>
 	/// Retrieves the IBigDriveFileOperations interface from the COM+ class associated with this provider.
 	/// </summary>
@@ -87,6 +126,17 @@ public:
 	/// <returns>S_OK if the interface was successfully retrieved; otherwise, an HRESULT error code.</returns>
 	HRESULT GetIBigDriveFileOperations(IBigDriveFileOperations** ppBigDriveFileOperations);
 
+	/// <summary>
+	/// <see cref="BigDriveFileOperationsFactory"/> that gets the drive's IBigDriveFileOperations through the
+	/// connection pool for the caller's apartment, reconnecting when the last attempt lost the provider.
+	/// </summary>
+	/// <param name="driveGuid">The drive.</param>
+	/// <param name="hrLastAttempt">The HRESULT of the last attempt with an interface from this factory, or S_OK.</param>
+	/// <param name="pContext">Unused.</param>
+	/// <param name="ppFileOperations">Receives the interface pointer on success. Set to nullptr on failure.</param>
+	/// <returns>S_OK if the interface was successfully retrieved; otherwise, an HRESULT error code.</returns>
+	static HRESULT GetFileOperations(REFGUID driveGuid, HRESULT hrLastAttempt, void* pContext, IBigDriveFileOperations** ppFileOperations);
+
 	/// <summary>
 	/// Retrieves the IBigDriveFileData interface from the COM+ class associated with this provider.
 	/// </summary>
@@ -94,8 +144,72 @@ public:
 	/// <returns>S_OK if the interface was successfully retrieved; otherwise, an HRESULT error code.</returns>
 	HRESULT GetIBigDriveFileData(IBigDriveFileData** ppBigDriveFileData);
 
+	/// <summary>
+	/// Calls IBigDriveEnumerate::EnumerateFolders for the drive, sharing the call with identical requests
+	/// already in flight (see <see cref="BigDriveSingleFlight"/>). Retries once on a new connection if the
+	/// provider was disconnected.
+	/// </summary>
+	/// <param name="bstrPath">The path of the folder, as passed to providers.</param>
+	/// <param name="ppsaFolders">Receives the folder names, or nullptr if the provider returned none. The caller must destroy it.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	HRESULT EnumerateFolders(BSTR bstrPath, SAFEARRAY** ppsaFolders);
+
+	/// <summary>
+	/// Calls IBigDriveEnumerate::EnumerateFiles for the drive, sharing the call with identical requests
+	/// already in flight. Retries once on a new connection if the provider was disconnected.
+	/// </summary>
+	/// <param name="bstrPath">The path of the folder, as passed to providers.</param>
+	/// <param name="ppsaFiles">Receives the file names, or nullptr if the provider returned none. The caller must destroy it.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	HRESULT EnumerateFiles(BSTR bstrPath, SAFEARRAY** ppsaFiles);
+
+	/// <summary>
+	/// Calls IBigDriveFileInfo::GetFileSize for the drive, sharing the call with identical requests
+	/// already in flight. Retries once on a new connection if the provider was disconnected.
+	/// </summary>
+	/// <param name="bstrPath">The path of the file, as passed to providers.</param>
+	/// <param name="pSize">Receives the size in bytes.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	HRESULT GetFileSize(BSTR bstrPath, ULONGLONG* pSize);
+
+	/// <summary>
+	/// Calls IBigDriveFileInfo::LastModifiedTime for the drive, sharing the call with identical requests
+	/// already in flight. Retries once on a new connection if the provider was disconnected.
+	/// </summary>
+	/// <param name="bstrPath">The path of the item, as passed to providers.</param>
+	/// <param name="pDate">Receives the time the item was last modified.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	HRESULT LastModifiedTime(BSTR bstrPath, DATE* pDate);
+
 private:
 
+	/// <summary>
+	/// Makes a provider call through the process-wide <see cref="BigDriveSingleFlight"/>. Providers not
+	/// bound to a drive have no key to share on and call directly.
+	/// </summary>
+	/// <param name="operation">The call.</param>
+	/// <param name="bstrPath">The path.</param>
+	/// <param name="pResult">Receives the result. The caller must clear it with VariantClear.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	HRESULT Call(BigDriveSingleFlightOperation operation, BSTR bstrPath, VARIANT* pResult);
+
+	/// <summary>
+	/// The <see cref="BigDriveSingleFlightFunction"/> that makes a call, retrying once on a new connection.
+	/// </summary>
+	/// <param name="pContext">The BigDriveProviderCall to make.</param>
+	/// <param name="pResult">Receives the result.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	static HRESULT CallProvider(void* pContext, VARIANT* pResult);
+
+	/// <summary>
+	/// Makes a call on a newly retrieved interface and counts it in the performance counters.
+	/// </summary>
+	/// <param name="operation">The call.</param>
+	/// <param name="bstrPath">The path.</param>
+	/// <param name="pResult">Receives the result.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	HRESULT CallProviderOnce(BigDriveSingleFlightOperation operation, BSTR bstrPath, VARIANT* pResult);
+
 	/// <summary>
 	/// Writes an error message to the event log.
 	/// </summary>
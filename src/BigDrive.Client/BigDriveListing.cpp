@@ -0,0 +1,260 @@
+// <copyright file="BigDriveListing.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveListing.h"
+
+// System
+#include <string.h>
+
+namespace
+{
+    template <typename T>
+    inline T ReadValue(const BYTE* p)
+    {
+        T value;
+        ::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    // Number of index slots for a listing: a power of two at least twice the record count
+    ULONG GetIndexSlots(ULONG count)
+    {
+        ULONG slots = 16;
+
+        while (slots < count * 2)
+        {
+            slots *= 2;
+        }
+
+        return slots;
+    }
+}
+
+/// <inheritdoc />
+BigDriveListing::BigDriveListing()
+    : m_refCount(1),
+    m_pBuffer(nullptr),
+    m_cbBuffer(0),
+    m_flags(0),
+    m_count(0),
+    m_aIndex(nullptr),
+    m_cIndex(0)
+{
+    ::InitOnceInitialize(&m_indexInitOnce);
+}
+
+/// <inheritdoc />
+BigDriveListing::~BigDriveListing()
+{
+    if (m_aIndex)
+    {
+        delete[] m_aIndex;
+        m_aIndex = nullptr;
+    }
+
+    if (m_pBuffer)
+    {
+        delete[] m_pBuffer;
+        m_pBuffer = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListing::Create(const BYTE* pBuffer, ULONG cbBuffer, LONG flags, BigDriveListing** ppListing)
+{
+    HRESULT hr = S_OK;
+    BigDriveEnumerationReader reader;
+    BigDriveListing* pListing = nullptr;
+
+    if (ppListing == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppListing = nullptr;
+
+    // Validates the header; records are validated as they are read
+    hr = reader.Initialize(pBuffer, cbBuffer);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    pListing = new BigDriveListing();
+    if (pListing == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    pListing->m_pBuffer = new BYTE[cbBuffer];
+    if (pListing->m_pBuffer == nullptr)
+    {
+        pListing->Release();
+        return E_OUTOFMEMORY;
+    }
+
+    ::memcpy(pListing->m_pBuffer, pBuffer, cbBuffer);
+    pListing->m_cbBuffer = cbBuffer;
+    pListing->m_flags = flags;
+    pListing->m_count = reader.GetCount();
+    pListing->m_cIndex = GetIndexSlots(pListing->m_count);
+
+    *ppListing = pListing;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+ULONG BigDriveListing::AddRef()
+{
+    return ::InterlockedIncrement(&m_refCount);
+}
+
+/// <inheritdoc />
+ULONG BigDriveListing::Release()
+{
+    ULONG res = ::InterlockedDecrement(&m_refCount);
+    if (res == 0) delete this;
+    return res;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListing::Read(BigDriveEnumerationReader& reader)
+{
+    return reader.Initialize(m_pBuffer, m_cbBuffer);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListing::FindEntry(LPCWSTR pchName, size_t cchName, BigDriveEnumerationEntry& entry)
+{
+    ULONG slot = 0;
+    ULONG offset = 0;
+
+    ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+
+    if ((pchName == nullptr) || (cchName == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!::InitOnceExecuteOnce(&m_indexInitOnce, BuildIndexOnce, this, nullptr) || (m_aIndex == nullptr))
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for (slot = HashName(pchName, cchName) & (m_cIndex - 1); m_aIndex[slot] != 0; slot = (slot + 1) & (m_cIndex - 1))
+    {
+        offset = m_aIndex[slot] - 1;
+
+        if (FAILED(ReadAt(offset, entry)))
+        {
+            break;
+        }
+
+        if ((entry.cchName == cchName) &&
+            (::CompareStringOrdinal(entry.pchName, entry.cchName, pchName, static_cast<int>(cchName), TRUE) == CSTR_EQUAL))
+        {
+            return S_OK;
+        }
+    }
+
+    ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+    return S_FALSE;
+}
+
+/// <inheritdoc />
+LONG BigDriveListing::GetFlags()
+{
+    return m_flags;
+}
+
+/// <inheritdoc />
+SIZE_T BigDriveListing::GetMemorySize()
+{
+    return sizeof(BigDriveListing) + m_cbBuffer + static_cast<SIZE_T>(m_cIndex) * sizeof(ULONG);
+}
+
+/// <inheritdoc />
+BOOL CALLBACK BigDriveListing::BuildIndexOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext)
+{
+    BigDriveListing* pThis = static_cast<BigDriveListing*>(pParameter);
+    BigDriveEnumerationReader reader;
+    BigDriveEnumerationEntry entry;
+    ULONG* aIndex = nullptr;
+    ULONG slot = 0;
+    ULONG offset = 0;
+
+    aIndex = new ULONG[pThis->m_cIndex];
+    if (aIndex == nullptr)
+    {
+        return FALSE;
+    }
+
+    ::ZeroMemory(aIndex, pThis->m_cIndex * sizeof(ULONG));
+
+    if (FAILED(pThis->Read(reader)))
+    {
+        delete[] aIndex;
+        return FALSE;
+    }
+
+    // Malformed records end the index; the entries before them can still be found
+    while (reader.Next(entry) == S_OK)
+    {
+        offset = static_cast<ULONG>(reinterpret_cast<const BYTE*>(entry.pchName) - pThis->m_pBuffer) - BigDriveEnumerationReader::FixedRecordSize;
+
+        for (slot = HashName(entry.pchName, entry.cchName) & (pThis->m_cIndex - 1); aIndex[slot] != 0; slot = (slot + 1) & (pThis->m_cIndex - 1))
+        {
+        }
+
+        aIndex[slot] = offset + 1;
+    }
+
+    pThis->m_aIndex = aIndex;
+
+    return TRUE;
+}
+
+/// <inheritdoc />
+ULONG BigDriveListing::HashName(LPCWSTR pchName, size_t cchName)
+{
+    ULONG hash = 2166136261UL;
+    WCHAR ch = 0;
+
+    for (size_t i = 0; i < cchName; i++)
+    {
+        ch = pchName[i];
+        if ((ch >= L'a') && (ch <= L'z'))
+        {
+            ch = static_cast<WCHAR>(ch - L'a' + L'A');
+        }
+
+        hash ^= ch;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListing::ReadAt(ULONG offset, BigDriveEnumerationEntry& entry)
+{
+    const BYTE* pRecord = m_pBuffer + offset;
+
+    // Offsets come from records the reader has already bounds checked
+    entry.uType = ReadValue<DWORD>(pRecord + 4);
+    entry.dwFields = ReadValue<DWORD>(pRecord + 8);
+    entry.dwAttributes = ReadValue<DWORD>(pRecord + 12);
+    entry.ullSize = ReadValue<ULONGLONG>(pRecord + 16);
+    entry.ftLastWrite = ReadValue<FILETIME>(pRecord + 24);
+    entry.cchName = ReadValue<USHORT>(pRecord + 32);
+    entry.cchETag = ReadValue<USHORT>(pRecord + 34);
+    entry.pchName = reinterpret_cast<LPCWSTR>(pRecord + BigDriveEnumerationReader::FixedRecordSize);
+    entry.pchETag = reinterpret_cast<LPCWSTR>(pRecord + BigDriveEnumerationReader::FixedRecordSize + entry.cchName * sizeof(WCHAR));
+
+    return S_OK;
+}
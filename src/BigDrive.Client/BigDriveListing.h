@@ -0,0 +1,137 @@
+// <copyright file="BigDriveListing.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveEnumerationReader.h"
+
+/// <summary>
+/// An immutable, reference counted copy of a folder listing in the packed entry format. Readers
+/// hold a reference while they walk it, so the cache can drop or replace the listing at any time.
+/// </summary>
+class BigDriveListing
+{
+private:
+
+    /// <summary>
+    /// Reference count.
+    /// </summary>
+    volatile LONG m_refCount;
+
+    /// <summary>
+    /// The packed entries, as read by <see cref="BigDriveEnumerationReader"/>.
+    /// </summary>
+    BYTE* m_pBuffer;
+
+    /// <summary>
+    /// Size of the packed entries in bytes.
+    /// </summary>
+    ULONG m_cbBuffer;
+
+    /// <summary>
+    /// BigDriveEnumerateEntries flags the listing was fetched with.
+    /// </summary>
+    LONG m_flags;
+
+    /// <summary>
+    /// Number of records in the listing.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// Open addressing table of record offsets plus one, keyed by name. Built on the first <see cref="FindEntry"/>.
+    /// </summary>
+    ULONG* m_aIndex;
+
+    /// <summary>
+    /// Number of slots in the index. A power of two.
+    /// </summary>
+    ULONG m_cIndex;
+
+    /// <summary>
+    /// Ensures the index is built once.
+    /// </summary>
+    INIT_ONCE m_indexInitOnce;
+
+    /// <summary>
+    /// Use <see cref="Create"/>.
+    /// </summary>
+    BigDriveListing();
+
+    /// <summary>
+    /// Use <see cref="Release"/>.
+    /// </summary>
+    ~BigDriveListing();
+
+public:
+
+    /// <summary>
+    /// Creates a listing from a copy of a packed entry buffer.
+    /// </summary>
+    /// <param name="pBuffer">The packed entries. Copied.</param>
+    /// <param name="cbBuffer">Size of the packed entries in bytes.</param>
+    /// <param name="flags">BigDriveEnumerateEntries flags the entries were fetched with.</param>
+    /// <param name="ppListing">Receives the listing with a reference count of one.</param>
+    /// <returns>S_OK on success; E_INVALIDARG if the buffer is malformed; E_OUTOFMEMORY.</returns>
+    static HRESULT Create(const BYTE* pBuffer, ULONG cbBuffer, LONG flags, BigDriveListing** ppListing);
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG AddRef();
+
+    /// <summary>
+    /// Decrements the reference count and deletes the listing if it reaches zero.
+    /// </summary>
+    ULONG Release();
+
+    /// <summary>
+    /// Starts a reader over the listing. The reader is valid while the caller holds a reference.
+    /// </summary>
+    /// <param name="reader">The reader to initialize.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT Read(BigDriveEnumerationReader& reader);
+
+    /// <summary>
+    /// Finds an entry by name. Names are compared without regard to case.
+    /// </summary>
+    /// <param name="pchName">The name. Need not be null terminated.</param>
+    /// <param name="cchName">Number of characters in the name.</param>
+    /// <param name="entry">Receives the entry. Its strings point into the listing.</param>
+    /// <returns>S_OK if found; S_FALSE if not; E_OUTOFMEMORY if the index could not be built.</returns>
+    HRESULT FindEntry(LPCWSTR pchName, size_t cchName, BigDriveEnumerationEntry& entry);
+
+    /// <summary>
+    /// Retrieves the BigDriveEnumerateEntries flags the listing was fetched with.
+    /// </summary>
+    /// <returns>The flags.</returns>
+    LONG GetFlags();
+
+    /// <summary>
+    /// Retrieves the number of bytes the listing holds, including room for its name index.
+    /// </summary>
+    /// <returns>The size in bytes.</returns>
+    SIZE_T GetMemorySize();
+
+private:
+
+    /// <summary>
+    /// InitOnce callback that builds the name index.
+    /// </summary>
+    static BOOL CALLBACK BuildIndexOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext);
+
+    /// <summary>
+    /// Hashes a name without regard to the case of ASCII letters.
+    /// </summary>
+    static ULONG HashName(LPCWSTR pchName, size_t cchName);
+
+    /// <summary>
+    /// Reads the record at an offset.
+    /// </summary>
+    HRESULT ReadAt(ULONG offset, BigDriveEnumerationEntry& entry);
+};
@@ -0,0 +1,548 @@
+// <copyright file="BigDriveListingCache.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveListingCache.h"
+
+// System
+#include <string.h>
+#include <wchar.h>
+
+// Local
+#include "BigDrivePerformanceCounters.h"
+
+/// <inheritdoc />
+BigDriveListingCache::BigDriveListingCache(ULONGLONG ttlMs, SIZE_T cbBudget)
+    : m_pNewest(nullptr),
+    m_pOldest(nullptr),
+    m_ttlMs(ttlMs),
+    m_cbBudget(cbBudget),
+    m_cbUsed(0),
+    m_hits(0),
+    m_misses(0),
+    m_evictions(0)
+{
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        m_apBuckets[i] = nullptr;
+    }
+
+    ::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveListingCache::~BigDriveListingCache()
+{
+    Clear();
+}
+
+/// <inheritdoc />
+BigDriveListingCache& BigDriveListingCache::GetInstance()
+{
+    static BigDriveListingCache* s_pInstance = new BigDriveListingCache(DefaultTimeToLiveMs, DefaultBudget);
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListingCache::Lookup(REFGUID driveGuid, LPCWSTR szPath, LONG flags, BigDriveListing** ppListing)
+{
+    HRESULT hr = S_OK;
+    LPWSTR szNormalized = nullptr;
+    size_t cchNormalized = 0;
+    ULONG hash = 0;
+    BigDriveListingCacheNode* pNode = nullptr;
+
+    *ppListing = nullptr;
+
+    hr = NormalizePath(szPath, &szNormalized, cchNormalized);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hash = Hash(driveGuid, szNormalized, cchNormalized);
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    pNode = Find(driveGuid, szNormalized, cchNormalized, hash);
+    if ((pNode != nullptr) && (::GetTickCount64() >= pNode->ullExpires))
+    {
+        Remove(pNode);
+        pNode = nullptr;
+        ::InterlockedIncrement(&m_evictions);
+    }
+
+    if ((pNode != nullptr) && ((pNode->pListing->GetFlags() & flags) == flags))
+    {
+        Touch(pNode);
+        *ppListing = pNode->pListing;
+        (*ppListing)->AddRef();
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    delete[] szNormalized;
+
+    if (*ppListing == nullptr)
+    {
+        ::InterlockedIncrement(&m_misses);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_ListingCacheMisses);
+        return S_FALSE;
+    }
+
+    ::InterlockedIncrement(&m_hits);
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_ListingCacheHits);
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListingCache::LookupEntry(REFGUID driveGuid, LPCWSTR szFolderPath, LPCWSTR szName, BigDriveEnumerationEntry& entry)
+{
+    HRESULT hr = S_OK;
+    BigDriveListing* pListing = nullptr;
+
+    ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+
+    if (szName == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    hr = Lookup(driveGuid, szFolderPath, 0, &pListing);
+    if (hr != S_OK)
+    {
+        return hr;
+    }
+
+    hr = pListing->FindEntry(szName, ::wcslen(szName), entry);
+
+    // The strings live in the listing, which may be freed once released
+    entry.pchName = nullptr;
+    entry.pchETag = nullptr;
+
+    pListing->Release();
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListingCache::Store(REFGUID driveGuid, LPCWSTR szPath, LONG flags, const BYTE* pBuffer, ULONG cbBuffer)
+{
+    HRESULT hr = S_OK;
+    BigDriveListing* pListing = nullptr;
+    BigDriveListingCacheNode* pNode = nullptr;
+    BigDriveListingCacheNode* pExisting = nullptr;
+    LPWSTR szNormalized = nullptr;
+    size_t cchNormalized = 0;
+    ULONG bucket = 0;
+
+    if (cbBuffer > GetMaxListingSize())
+    {
+        return S_FALSE;
+    }
+
+    hr = NormalizePath(szPath, &szNormalized, cchNormalized);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = BigDriveListing::Create(pBuffer, cbBuffer, flags, &pListing);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    pNode = new BigDriveListingCacheNode();
+    if (pNode == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pNode->driveGuid = driveGuid;
+    pNode->szPath = szNormalized;
+    pNode->cchPath = cchNormalized;
+    pNode->hash = Hash(driveGuid, szNormalized, cchNormalized);
+    pNode->pListing = pListing;
+    pNode->ullExpires = ::GetTickCount64() + m_ttlMs;
+    pNode->cbCharge = sizeof(BigDriveListingCacheNode) + (cchNormalized + 1) * sizeof(WCHAR) + pListing->GetMemorySize();
+    pNode->pNewer = nullptr;
+    pNode->pOlder = nullptr;
+
+    szNormalized = nullptr;
+    pListing = nullptr;
+
+    bucket = pNode->hash & (BucketCount - 1);
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    pExisting = Find(driveGuid, pNode->szPath, pNode->cchPath, pNode->hash);
+    if (pExisting != nullptr)
+    {
+        Remove(pExisting);
+    }
+
+    pNode->pNextInBucket = m_apBuckets[bucket];
+    m_apBuckets[bucket] = pNode;
+
+    pNode->pOlder = m_pNewest;
+    if (m_pNewest != nullptr)
+    {
+        m_pNewest->pNewer = pNode;
+    }
+
+    m_pNewest = pNode;
+    if (m_pOldest == nullptr)
+    {
+        m_pOldest = pNode;
+    }
+
+    m_cbUsed += pNode->cbCharge;
+    pNode = nullptr;
+
+    Trim();
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+End:
+
+    if (pNode)
+    {
+        delete pNode;
+        pNode = nullptr;
+    }
+
+    if (pListing)
+    {
+        pListing->Release();
+        pListing = nullptr;
+    }
+
+    if (szNormalized)
+    {
+        delete[] szNormalized;
+        szNormalized = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListingCache::Update(REFGUID driveGuid, LPCWSTR szPath, BigDriveListing* pExpected, const BYTE* pBuffer, ULONG cbBuffer)
+{
+    HRESULT hr = S_OK;
+    BigDriveListing* pListing = nullptr;
+    BigDriveListingCacheNode* pNode = nullptr;
+    LPWSTR szNormalized = nullptr;
+    size_t cchNormalized = 0;
+    SIZE_T cbListing = 0;
+
+    if (pExpected == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (cbBuffer > GetMaxListingSize())
+    {
+        return S_FALSE;
+    }
+
+    hr = NormalizePath(szPath, &szNormalized, cchNormalized);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = BigDriveListing::Create(pBuffer, cbBuffer, pExpected->GetFlags(), &pListing);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    cbListing = pListing->GetMemorySize();
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    // A listing stored or invalidated meanwhile is newer than the one the update was built from
+    pNode = Find(driveGuid, szNormalized, cchNormalized, Hash(driveGuid, szNormalized, cchNormalized));
+    if ((pNode == nullptr) || (pNode->pListing != pExpected))
+    {
+        hr = S_FALSE;
+    }
+    else
+    {
+        m_cbUsed -= pNode->pListing->GetMemorySize();
+        pNode->cbCharge -= pNode->pListing->GetMemorySize();
+
+        // The node's reference moves to the new listing; readers holding the old one keep it alive
+        pNode->pListing->Release();
+        pNode->pListing = pListing;
+        pListing = nullptr;
+
+        pNode->cbCharge += cbListing;
+        m_cbUsed += cbListing;
+
+        Trim();
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+End:
+
+    if (pListing)
+    {
+        pListing->Release();
+        pListing = nullptr;
+    }
+
+    if (szNormalized)
+    {
+        delete[] szNormalized;
+        szNormalized = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveListingCache::Invalidate(REFGUID driveGuid, LPCWSTR szPath)
+{
+    LPWSTR szNormalized = nullptr;
+    size_t cchNormalized = 0;
+    BigDriveListingCacheNode* pNode = nullptr;
+    BigDriveListingCacheNode* pOlder = nullptr;
+    BOOL fMatch = FALSE;
+
+    if (FAILED(NormalizePath(szPath, &szNormalized, cchNormalized)))
+    {
+        // Without a path to compare, drop everything rather than serve a stale listing
+        Clear();
+        return;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    for (pNode = m_pNewest; pNode != nullptr; pNode = pOlder)
+    {
+        pOlder = pNode->pOlder;
+
+        if (!::IsEqualGUID(pNode->driveGuid, driveGuid) || (pNode->cchPath < cchNormalized))
+        {
+            continue;
+        }
+
+        // The folder itself, or a folder below it
+        fMatch = ((cchNormalized == 0) ||
+            (::CompareStringOrdinal(pNode->szPath, static_cast<int>(cchNormalized), szNormalized, static_cast<int>(cchNormalized), TRUE) == CSTR_EQUAL)) &&
+            ((pNode->cchPath == cchNormalized) || (pNode->szPath[cchNormalized] == L'\\'));
+
+        if (fMatch)
+        {
+            Remove(pNode);
+        }
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    delete[] szNormalized;
+}
+
+/// <inheritdoc />
+void BigDriveListingCache::Clear()
+{
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    while (m_pOldest != nullptr)
+    {
+        Remove(m_pOldest);
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+ULONG BigDriveListingCache::GetMaxListingSize()
+{
+    SIZE_T cbMax = m_cbBudget / 4;
+
+    // One listing may not crowd out every other folder
+    return (cbMax > MAXDWORD) ? MAXDWORD : static_cast<ULONG>(cbMax);
+}
+
+/// <inheritdoc />
+void BigDriveListingCache::GetStatistics(LONG& hits, LONG& misses, LONG& evictions, SIZE_T& cbUsed)
+{
+    hits = ::InterlockedCompareExchange(&m_hits, 0, 0);
+    misses = ::InterlockedCompareExchange(&m_misses, 0, 0);
+    evictions = ::InterlockedCompareExchange(&m_evictions, 0, 0);
+
+    ::AcquireSRWLockShared(&m_lock);
+    cbUsed = m_cbUsed;
+    ::ReleaseSRWLockShared(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveListingCacheNode* BigDriveListingCache::Find(REFGUID driveGuid, LPCWSTR szPath, size_t cchPath, ULONG hash)
+{
+    BigDriveListingCacheNode* pNode = nullptr;
+
+    for (pNode = m_apBuckets[hash & (BucketCount - 1)]; pNode != nullptr; pNode = pNode->pNextInBucket)
+    {
+        if ((pNode->hash == hash) &&
+            (pNode->cchPath == cchPath) &&
+            ::IsEqualGUID(pNode->driveGuid, driveGuid) &&
+            ((cchPath == 0) || (::CompareStringOrdinal(pNode->szPath, static_cast<int>(cchPath), szPath, static_cast<int>(cchPath), TRUE) == CSTR_EQUAL)))
+        {
+            return pNode;
+        }
+    }
+
+    return nullptr;
+}
+
+/// <inheritdoc />
+void BigDriveListingCache::Remove(BigDriveListingCacheNode* pNode)
+{
+    BigDriveListingCacheNode** ppLink = &m_apBuckets[pNode->hash & (BucketCount - 1)];
+
+    while (*ppLink != pNode)
+    {
+        ppLink = &(*ppLink)->pNextInBucket;
+    }
+
+    *ppLink = pNode->pNextInBucket;
+
+    if (pNode->pNewer != nullptr)
+    {
+        pNode->pNewer->pOlder = pNode->pOlder;
+    }
+    else
+    {
+        m_pNewest = pNode->pOlder;
+    }
+
+    if (pNode->pOlder != nullptr)
+    {
+        pNode->pOlder->pNewer = pNode->pNewer;
+    }
+    else
+    {
+        m_pOldest = pNode->pNewer;
+    }
+
+    m_cbUsed -= pNode->cbCharge;
+
+    // Readers holding the listing keep it alive
+    pNode->pListing->Release();
+    delete[] pNode->szPath;
+    delete pNode;
+}
+
+/// <inheritdoc />
+void BigDriveListingCache::Touch(BigDriveListingCacheNode* pNode)
+{
+    if (pNode == m_pNewest)
+    {
+        return;
+    }
+
+    // Unlink; pNode has a newer neighbour since it isn't the newest
+    pNode->pNewer->pOlder = pNode->pOlder;
+
+    if (pNode->pOlder != nullptr)
+    {
+        pNode->pOlder->pNewer = pNode->pNewer;
+    }
+    else
+    {
+        m_pOldest = pNode->pNewer;
+    }
+
+    pNode->pNewer = nullptr;
+    pNode->pOlder = m_pNewest;
+    m_pNewest->pNewer = pNode;
+    m_pNewest = pNode;
+}
+
+/// <inheritdoc />
+void BigDriveListingCache::Trim()
+{
+    while ((m_cbUsed > m_cbBudget) && (m_pOldest != nullptr))
+    {
+        Remove(m_pOldest);
+        ::InterlockedIncrement(&m_evictions);
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveListingCache::NormalizePath(LPCWSTR szPath, LPWSTR* pszNormalized, size_t& cchNormalized)
+{
+    size_t cch = 0;
+    LPWSTR sz = nullptr;
+
+    *pszNormalized = nullptr;
+    cchNormalized = 0;
+
+    if (szPath == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    cch = ::wcslen(szPath);
+
+    sz = new WCHAR[cch + 1];
+    if (sz == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for (size_t i = 0; i < cch; i++)
+    {
+        sz[i] = (szPath[i] == L'/') ? L'\\' : szPath[i];
+    }
+
+    // The root normalizes to the empty path
+    while ((cch > 0) && (sz[cch - 1] == L'\\'))
+    {
+        cch--;
+    }
+
+    sz[cch] = L'\0';
+
+    *pszNormalized = sz;
+    cchNormalized = cch;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+ULONG BigDriveListingCache::Hash(REFGUID driveGuid, LPCWSTR szPath, size_t cchPath)
+{
+    ULONG hash = 2166136261UL;
+    const BYTE* pGuid = reinterpret_cast<const BYTE*>(&driveGuid);
+    WCHAR ch = 0;
+
+    for (size_t i = 0; i < sizeof(GUID); i++)
+    {
+        hash ^= pGuid[i];
+        hash *= 16777619UL;
+    }
+
+    for (size_t i = 0; i < cchPath; i++)
+    {
+        ch = szPath[i];
+        if ((ch >= L'a') && (ch <= L'z'))
+        {
+            ch = static_cast<WCHAR>(ch - L'a' + L'A');
+        }
+
+        hash ^= ch;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
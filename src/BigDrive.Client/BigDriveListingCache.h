@@ -0,0 +1,273 @@
+// <copyright file="BigDriveListingCache.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveListing.h"
+
+/// <summary>
+/// A cached listing and its place in the hash buckets and the LRU list.
+/// </summary>
+struct BigDriveListingCacheNode
+{
+    /// <summary>
+    /// The drive the folder belongs to.
+    /// </summary>
+    GUID driveGuid;
+
+    /// <summary>
+    /// The normalized folder path.
+    /// </summary>
+    LPWSTR szPath;
+
+    /// <summary>
+    /// Number of characters in the path.
+    /// </summary>
+    size_t cchPath;
+
+    /// <summary>
+    /// Hash of the drive and path.
+    /// </summary>
+    ULONG hash;
+
+    /// <summary>
+    /// The listing. The node holds a reference.
+    /// </summary>
+    BigDriveListing* pListing;
+
+    /// <summary>
+    /// Tick count after which the listing is stale.
+    /// </summary>
+    ULONGLONG ullExpires;
+
+    /// <summary>
+    /// Bytes charged against the memory budget.
+    /// </summary>
+    SIZE_T cbCharge;
+
+    /// <summary>
+    /// Next node in the bucket chain.
+    /// </summary>
+    BigDriveListingCacheNode* pNextInBucket;
+
+    /// <summary>
+    /// More recently used neighbour in the LRU list.
+    /// </summary>
+    BigDriveListingCacheNode* pNewer;
+
+    /// <summary>
+    /// Less recently used neighbour in the LRU list.
+    /// </summary>
+    BigDriveListingCacheNode* pOlder;
+};
+
+/// <summary>
+/// Process-wide cache of folder listings keyed by drive GUID and folder path, shared by every
+/// BigDriveShellFolder so going back, the navigation pane and other windows don't re-enumerate
+/// the provider. Listings are kept in the packed IBigDriveEnumerateEx format, metadata and all.
+///
+/// A listing is served until its time to live passes or it is invalidated; the least recently
+/// used listings are evicted to keep the cache within its memory budget. Writes made through
+/// BigDrive invalidate the folders they touch. A listing fetched with more BigDriveEnumerateEntries
+/// flags than a lookup asks for serves the lookup; the caller skips the entries it didn't ask for.
+/// </summary>
+class BigDriveListingCache
+{
+private:
+
+    /// <summary>
+    /// Number of hash buckets. Must be a power of two.
+    /// </summary>
+    static const ULONG BucketCount = 64;
+
+    /// <summary>
+    /// Hash buckets.
+    /// </summary>
+    BigDriveListingCacheNode* m_apBuckets[BucketCount];
+
+    /// <summary>
+    /// Most recently used node.
+    /// </summary>
+    BigDriveListingCacheNode* m_pNewest;
+
+    /// <summary>
+    /// Least recently used node; evicted first.
+    /// </summary>
+    BigDriveListingCacheNode* m_pOldest;
+
+    /// <summary>
+    /// Milliseconds a listing is served after it is stored.
+    /// </summary>
+    ULONGLONG m_ttlMs;
+
+    /// <summary>
+    /// Maximum number of bytes held.
+    /// </summary>
+    SIZE_T m_cbBudget;
+
+    /// <summary>
+    /// Number of bytes held.
+    /// </summary>
+    SIZE_T m_cbUsed;
+
+    /// <summary>
+    /// Guards the buckets, the LRU list and the byte count.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Counter of lookups served from the cache.
+    /// </summary>
+    volatile LONG m_hits;
+
+    /// <summary>
+    /// Counter of lookups that missed.
+    /// </summary>
+    volatile LONG m_misses;
+
+    /// <summary>
+    /// Counter of listings evicted for the budget or for age.
+    /// </summary>
+    volatile LONG m_evictions;
+
+public:
+
+    /// <summary>
+    /// Default time to live of a listing.
+    /// </summary>
+    static const ULONGLONG DefaultTimeToLiveMs = 30000;
+
+    /// <summary>
+    /// Default memory budget of the process-wide cache.
+    /// </summary>
+    static const SIZE_T DefaultBudget = 16 * 1024 * 1024;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveListingCache"/> class.
+    /// </summary>
+    /// <param name="ttlMs">Milliseconds a listing is served after it is stored.</param>
+    /// <param name="cbBudget">Maximum number of bytes held.</param>
+    BigDriveListingCache(ULONGLONG ttlMs, SIZE_T cbBudget);
+
+    /// <summary>
+    /// Releases every listing.
+    /// </summary>
+    ~BigDriveListingCache();
+
+    /// <summary>
+    /// Retrieves the process-wide instance.
+    /// </summary>
+    /// <returns>The listing cache.</returns>
+    static BigDriveListingCache& GetInstance();
+
+    /// <summary>
+    /// Looks up the listing of a folder.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="szPath">The folder path, as passed to providers.</param>
+    /// <param name="flags">BigDriveEnumerateEntries flags the listing must include.</param>
+    /// <param name="ppListing">Receives the listing on a hit. The caller must release it.</param>
+    /// <returns>S_OK on a hit; S_FALSE on a miss.</returns>
+    HRESULT Lookup(REFGUID driveGuid, LPCWSTR szPath, LONG flags, BigDriveListing** ppListing);
+
+    /// <summary>
+    /// Looks up one item in the cached listing of its folder. The entry's strings are not returned.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="szFolderPath">The path of the folder holding the item.</param>
+    /// <param name="szName">The name of the item.</param>
+    /// <param name="entry">Receives the entry, with pchName and pchETag set to nullptr.</param>
+    /// <returns>S_OK on a hit; S_FALSE if the folder isn't cached or doesn't list the item.</returns>
+    HRESULT LookupEntry(REFGUID driveGuid, LPCWSTR szFolderPath, LPCWSTR szName, BigDriveEnumerationEntry& entry);
+
+    /// <summary>
+    /// Stores a copy of the listing of a folder, replacing any listing already held for it.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="szPath">The folder path, as passed to providers.</param>
+    /// <param name="flags">BigDriveEnumerateEntries flags the listing was fetched with.</param>
+    /// <param name="pBuffer">The packed entries.</param>
+    /// <param name="cbBuffer">Size of the packed entries in bytes.</param>
+    /// <returns>S_OK if stored; S_FALSE if the listing is too large to cache; otherwise, an HRESULT error code.</returns>
+    HRESULT Store(REFGUID driveGuid, LPCWSTR szPath, LONG flags, const BYTE* pBuffer, ULONG cbBuffer);
+
+    /// <summary>
+    /// Replaces a cached listing with a copy that carries more metadata, keeping its flags and its expiry,
+    /// so filling in a listing doesn't extend how long it is served.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="szPath">The folder path, as passed to providers.</param>
+    /// <param name="pExpected">The listing the update was built from, as returned by <see cref="Lookup"/>.</param>
+    /// <param name="pBuffer">The packed entries.</param>
+    /// <param name="cbBuffer">Size of the packed entries in bytes.</param>
+    /// <returns>S_OK if replaced; S_FALSE if the folder's listing was dropped or replaced since it was looked up; otherwise, an HRESULT error code.</returns>
+    HRESULT Update(REFGUID driveGuid, LPCWSTR szPath, BigDriveListing* pExpected, const BYTE* pBuffer, ULONG cbBuffer);
+
+    /// <summary>
+    /// Drops the listing of a folder and of every folder below it. Call after writing to the folder.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="szPath">The folder path, as passed to providers.</param>
+    void Invalidate(REFGUID driveGuid, LPCWSTR szPath);
+
+    /// <summary>
+    /// Drops every listing.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Retrieves the largest listing, in bytes, worth building for the cache.
+    /// </summary>
+    /// <returns>The size in bytes.</returns>
+    ULONG GetMaxListingSize();
+
+    /// <summary>
+    /// Retrieves the cache counters.
+    /// </summary>
+    /// <param name="hits">Receives the number of lookups served from the cache.</param>
+    /// <param name="misses">Receives the number of lookups that missed.</param>
+    /// <param name="evictions">Receives the number of listings evicted for the budget or for age.</param>
+    /// <param name="cbUsed">Receives the number of bytes held.</param>
+    void GetStatistics(LONG& hits, LONG& misses, LONG& evictions, SIZE_T& cbUsed);
+
+private:
+
+    /// <summary>
+    /// Finds the node of a folder. The caller must hold the lock.
+    /// </summary>
+    BigDriveListingCacheNode* Find(REFGUID driveGuid, LPCWSTR szPath, size_t cchPath, ULONG hash);
+
+    /// <summary>
+    /// Unlinks a node from its bucket and the LRU list and frees it. The caller must hold the lock exclusive.
+    /// </summary>
+    void Remove(BigDriveListingCacheNode* pNode);
+
+    /// <summary>
+    /// Moves a node to the newest end of the LRU list. The caller must hold the lock exclusive.
+    /// </summary>
+    void Touch(BigDriveListingCacheNode* pNode);
+
+    /// <summary>
+    /// Evicts the least recently used nodes until the cache is within its budget. The caller must hold the lock exclusive.
+    /// </summary>
+    void Trim();
+
+    /// <summary>
+    /// Normalizes a folder path: forward slashes become backslashes and trailing backslashes are removed.
+    /// </summary>
+    /// <param name="szPath">The path.</param>
+    /// <param name="pszNormalized">Receives the normalized path, allocated with new[]. The caller must delete[] it.</param>
+    /// <param name="cchNormalized">Receives the number of characters in the normalized path.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY.</returns>
+    static HRESULT NormalizePath(LPCWSTR szPath, LPWSTR* pszNormalized, size_t& cchNormalized);
+
+    /// <summary>
+    /// Hashes a drive and a normalized path without regard to the case of ASCII letters.
+    /// </summary>
+    static ULONG Hash(REFGUID driveGuid, LPCWSTR szPath, size_t cchPath);
+};
@@ -0,0 +1,366 @@
+// <copyright file="BigDriveMetadataCoalescer.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveMetadataCoalescer.h"
+
+// System
+#include <oleauto.h>
+
+// Local
+#include "BigDrivePerformanceCounters.h"
+
+/// <inheritdoc />
+BigDriveMetadataCoalescer::BigDriveMetadataCoalescer(DWORD windowMs, ULONG maxBatch)
+    : m_windowMs(windowMs),
+    m_maxBatch((maxBatch > 0) ? maxBatch : 1),
+    m_pOpen(nullptr),
+    m_requests(0),
+    m_calls(0)
+{
+    ::InitializeSRWLock(&m_lock);
+    ::InitializeConditionVariable(&m_changed);
+}
+
+/// <inheritdoc />
+BigDriveMetadataCoalescer::~BigDriveMetadataCoalescer()
+{
+    BigDriveMetadataBatch* pNext = nullptr;
+
+    // Open batches still have a leader waiting on them, unless the process is going away
+    while (m_pOpen)
+    {
+        pNext = m_pOpen->pNextOpen;
+        FreeBatch(m_pOpen);
+        m_pOpen = pNext;
+    }
+}
+
+/// <inheritdoc />
+BigDriveMetadataCoalescer& BigDriveMetadataCoalescer::GetInstance()
+{
+    static BigDriveMetadataCoalescer* s_pInstance = new BigDriveMetadataCoalescer(DefaultWindowMs, DefaultMaxBatch);
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveMetadataCoalescer::GetFileInfo(IBigDriveFileInfoBatch* pBatch, REFGUID driveGuid, LPCWSTR szPath, LONG fields, BigDriveEnumerationEntry& entry)
+{
+    HRESULT hr = S_OK;
+    BigDriveMetadataBatch* pMetadataBatch = nullptr;
+    BigDriveMetadataBatch* pFree = nullptr;
+    BSTR bstrPath = nullptr;
+    BOOL fLeader = FALSE;
+    ULONG index = 0;
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER now;
+    ULONGLONG elapsedMs = 0;
+
+    ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+
+    if ((pBatch == nullptr) || (szPath == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    // Allocated before the lock is taken
+    bstrPath = ::SysAllocString(szPath);
+    if (bstrPath == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    ::InterlockedIncrement(&m_requests);
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_MetadataRequests);
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    for (pMetadataBatch = m_pOpen; pMetadataBatch != nullptr; pMetadataBatch = pMetadataBatch->pNextOpen)
+    {
+        if (::IsEqualGUID(pMetadataBatch->driveGuid, driveGuid) && (pMetadataBatch->fields == fields))
+        {
+            break;
+        }
+    }
+
+    if (pMetadataBatch == nullptr)
+    {
+        pMetadataBatch = CreateBatch(driveGuid, fields, m_maxBatch);
+        if (pMetadataBatch == nullptr)
+        {
+            ::ReleaseSRWLockExclusive(&m_lock);
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        pMetadataBatch->pNextOpen = m_pOpen;
+        m_pOpen = pMetadataBatch;
+        fLeader = TRUE;
+    }
+
+    index = pMetadataBatch->count++;
+    pMetadataBatch->aPaths[index] = bstrPath;
+    pMetadataBatch->refCount++;
+    bstrPath = nullptr;
+
+    if (pMetadataBatch->count == m_maxBatch)
+    {
+        // Full: wakes the leader rather than have it wait out the window
+        CloseBatch(pMetadataBatch);
+        ::WakeAllConditionVariable(&m_changed);
+    }
+
+    if (fLeader)
+    {
+        ::QueryPerformanceFrequency(&frequency);
+        ::QueryPerformanceCounter(&start);
+
+        while (!pMetadataBatch->fClosed)
+        {
+            ::QueryPerformanceCounter(&now);
+            elapsedMs = static_cast<ULONGLONG>(now.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+            if (elapsedMs >= m_windowMs)
+            {
+                break;
+            }
+
+            ::SleepConditionVariableSRW(&m_changed, &m_lock, static_cast<DWORD>(m_windowMs - elapsedMs), 0);
+        }
+
+        CloseBatch(pMetadataBatch);
+
+        ::ReleaseSRWLockExclusive(&m_lock);
+
+        hr = Send(pBatch, pMetadataBatch);
+
+        ::InterlockedIncrement(&m_calls);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_MetadataBatches);
+
+        ::AcquireSRWLockExclusive(&m_lock);
+
+        pMetadataBatch->hrCall = hr;
+        pMetadataBatch->fDone = TRUE;
+        ::WakeAllConditionVariable(&m_changed);
+    }
+    else
+    {
+        while (!pMetadataBatch->fDone)
+        {
+            ::SleepConditionVariableSRW(&m_changed, &m_lock, INFINITE, 0);
+        }
+    }
+
+    hr = pMetadataBatch->hrCall;
+    if (SUCCEEDED(hr))
+    {
+        entry = pMetadataBatch->aResults[index];
+        hr = (entry.dwFields != 0) ? S_OK : S_FALSE;
+    }
+
+    if (--pMetadataBatch->refCount == 0)
+    {
+        pFree = pMetadataBatch;
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (pFree)
+    {
+        FreeBatch(pFree);
+        pFree = nullptr;
+    }
+
+End:
+
+    if (bstrPath)
+    {
+        ::SysFreeString(bstrPath);
+        bstrPath = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveMetadataCoalescer::GetStatistics(LONG& requests, LONG& calls)
+{
+    requests = ::InterlockedCompareExchange(&m_requests, 0, 0);
+    calls = ::InterlockedCompareExchange(&m_calls, 0, 0);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveMetadataCoalescer::Send(IBigDriveFileInfoBatch* pBatch, BigDriveMetadataBatch* pMetadataBatch)
+{
+    static volatile LONG s_counterSlot = -1;
+    HRESULT hr = S_OK;
+    SAFEARRAY* psaPaths = nullptr;
+    SAFEARRAY* psaRecords = nullptr;
+    BSTR* aPaths = nullptr;
+    BigDriveEnumerationReader reader;
+    BigDriveEnumerationEntry record;
+
+    psaPaths = ::SafeArrayCreateVector(VT_BSTR, 0, pMetadataBatch->count);
+    if (psaPaths == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = ::SafeArrayAccessData(psaPaths, reinterpret_cast<void**>(&aPaths));
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // The array takes the paths and frees them when it is destroyed
+    for (ULONG i = 0; i < pMetadataBatch->count; i++)
+    {
+        aPaths[i] = pMetadataBatch->aPaths[i];
+        pMetadataBatch->aPaths[i] = nullptr;
+    }
+
+    ::SafeArrayUnaccessData(psaPaths);
+    aPaths = nullptr;
+
+    BigDrivePerformanceCounters::BeginProviderCall("IBigDriveFileInfoBatch::GetFileInfoBatch", s_counterSlot);
+    hr = pBatch->GetFileInfoBatch(pMetadataBatch->driveGuid, psaPaths, pMetadataBatch->fields, &psaRecords);
+    BigDrivePerformanceCounters::EndProviderCall(hr);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    if (psaRecords == nullptr)
+    {
+        hr = E_FAIL;
+        goto End;
+    }
+
+    hr = reader.Initialize(psaRecords);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // One record per path, in the order sent; paths the provider left out stay unanswered
+    for (ULONG i = 0; i < pMetadataBatch->count; i++)
+    {
+        hr = reader.Next(record);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+
+        if (hr == S_FALSE)
+        {
+            hr = S_OK;
+            break;
+        }
+
+        record.dwFields &= BigDriveFileInfoFields_All;
+        record.pchName = nullptr;
+        record.cchName = 0;
+        record.pchETag = nullptr;
+        record.cchETag = 0;
+
+        pMetadataBatch->aResults[i] = record;
+    }
+
+End:
+
+    // The array must be unlocked before it is destroyed
+    reader.Close();
+
+    if (psaRecords)
+    {
+        ::SafeArrayDestroy(psaRecords);
+        psaRecords = nullptr;
+    }
+
+    if (psaPaths)
+    {
+        ::SafeArrayDestroy(psaPaths);
+        psaPaths = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+BigDriveMetadataBatch* BigDriveMetadataCoalescer::CreateBatch(REFGUID driveGuid, LONG fields, ULONG maxBatch)
+{
+    BigDriveMetadataBatch* pMetadataBatch = nullptr;
+
+    pMetadataBatch = new BigDriveMetadataBatch();
+    if (pMetadataBatch == nullptr)
+    {
+        return nullptr;
+    }
+
+    pMetadataBatch->driveGuid = driveGuid;
+    pMetadataBatch->fields = fields;
+    pMetadataBatch->hrCall = S_OK;
+    pMetadataBatch->aPaths = new BSTR[maxBatch]();
+    pMetadataBatch->aResults = new BigDriveEnumerationEntry[maxBatch]();
+
+    if ((pMetadataBatch->aPaths == nullptr) || (pMetadataBatch->aResults == nullptr))
+    {
+        FreeBatch(pMetadataBatch);
+        return nullptr;
+    }
+
+    return pMetadataBatch;
+}
+
+/// <inheritdoc />
+void BigDriveMetadataCoalescer::FreeBatch(BigDriveMetadataBatch* pMetadataBatch)
+{
+    if (pMetadataBatch->aPaths)
+    {
+        // Paths not handed to a provider call
+        for (ULONG i = 0; i < pMetadataBatch->count; i++)
+        {
+            ::SysFreeString(pMetadataBatch->aPaths[i]);
+        }
+
+        delete[] pMetadataBatch->aPaths;
+        pMetadataBatch->aPaths = nullptr;
+    }
+
+    if (pMetadataBatch->aResults)
+    {
+        delete[] pMetadataBatch->aResults;
+        pMetadataBatch->aResults = nullptr;
+    }
+
+    delete pMetadataBatch;
+}
+
+/// <inheritdoc />
+void BigDriveMetadataCoalescer::CloseBatch(BigDriveMetadataBatch* pMetadataBatch)
+{
+    BigDriveMetadataBatch** ppLink = &m_pOpen;
+
+    if (pMetadataBatch->fClosed)
+    {
+        return;
+    }
+
+    while (*ppLink != nullptr)
+    {
+        if (*ppLink == pMetadataBatch)
+        {
+            *ppLink = pMetadataBatch->pNextOpen;
+            break;
+        }
+
+        ppLink = &(*ppLink)->pNextOpen;
+    }
+
+    pMetadataBatch->pNextOpen = nullptr;
+    pMetadataBatch->fClosed = TRUE;
+}
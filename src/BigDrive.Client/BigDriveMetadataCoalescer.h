@@ -0,0 +1,200 @@
+// <copyright file="BigDriveMetadataCoalescer.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveEnumerationReader.h"
+#include "Interfaces/IBigDriveFileInfoBatch.h"
+
+/// <summary>
+/// Metadata requests for one drive gathered into a single IBigDriveFileInfoBatch call. Shared by
+/// the callers that joined it; the last one out frees it.
+/// </summary>
+struct BigDriveMetadataBatch
+{
+    /// <summary>
+    /// The drive the paths belong to.
+    /// </summary>
+    GUID driveGuid;
+
+    /// <summary>
+    /// BigDriveFileInfoFields asked of the provider.
+    /// </summary>
+    LONG fields;
+
+    /// <summary>
+    /// The paths, one per request, in the order they joined.
+    /// </summary>
+    BSTR* aPaths;
+
+    /// <summary>
+    /// The answers, indexed as the paths. Names and etags are not returned.
+    /// </summary>
+    BigDriveEnumerationEntry* aResults;
+
+    /// <summary>
+    /// Number of requests that joined.
+    /// </summary>
+    ULONG count;
+
+    /// <summary>
+    /// Number of callers still holding the batch.
+    /// </summary>
+    ULONG refCount;
+
+    /// <summary>
+    /// TRUE once no more requests may join.
+    /// </summary>
+    BOOL fClosed;
+
+    /// <summary>
+    /// TRUE once the provider call returned and the answers are filled in.
+    /// </summary>
+    BOOL fDone;
+
+    /// <summary>
+    /// The result of the provider call.
+    /// </summary>
+    HRESULT hrCall;
+
+    /// <summary>
+    /// Next batch open for requests.
+    /// </summary>
+    BigDriveMetadataBatch* pNextOpen;
+};
+
+/// <summary>
+/// Gathers the metadata requests that threads make one item at a time (Explorer calls GetDetailsEx
+/// from several threads) into one IBigDriveFileInfoBatch call per drive.
+///
+/// The first request for a drive opens a batch and leads it: it waits until the batch holds
+/// <c>maxBatch</c> requests or <c>windowMs</c> has passed, then makes the call on its own interface
+/// pointer, so the call is made from the apartment that owns it. Requests arriving meanwhile join
+/// the batch and wait for the leader to hand out their answers. The window trades the latency added
+/// to a lone request for fewer calls under load; the maximum caps the size of one call.
+/// </summary>
+class BigDriveMetadataCoalescer
+{
+private:
+
+    /// <summary>
+    /// Milliseconds a leader waits for more requests.
+    /// </summary>
+    DWORD m_windowMs;
+
+    /// <summary>
+    /// Number of requests that close a batch without waiting out the window.
+    /// </summary>
+    ULONG m_maxBatch;
+
+    /// <summary>
+    /// Batches still open for requests.
+    /// </summary>
+    BigDriveMetadataBatch* m_pOpen;
+
+    /// <summary>
+    /// Guards every batch and the open list.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Signaled when a batch fills up or its call returns.
+    /// </summary>
+    CONDITION_VARIABLE m_changed;
+
+    /// <summary>
+    /// Counter of requests made.
+    /// </summary>
+    volatile LONG m_requests;
+
+    /// <summary>
+    /// Counter of provider calls made for them.
+    /// </summary>
+    volatile LONG m_calls;
+
+public:
+
+    /// <summary>
+    /// Default number of milliseconds a leader waits for more requests.
+    /// </summary>
+    static const DWORD DefaultWindowMs = 2;
+
+    /// <summary>
+    /// Default number of requests that close a batch.
+    /// </summary>
+    static const ULONG DefaultMaxBatch = 64;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveMetadataCoalescer"/> class.
+    /// </summary>
+    /// <param name="windowMs">Milliseconds a leader waits for more requests; zero sends each request as it comes.
+    /// Waits are rounded up to the system timer resolution.</param>
+    /// <param name="maxBatch">Number of requests that close a batch without waiting out the window.</param>
+    BigDriveMetadataCoalescer(DWORD windowMs, ULONG maxBatch);
+
+    /// <summary>
+    /// Frees the open batches. No thread may be using the coalescer.
+    /// </summary>
+    ~BigDriveMetadataCoalescer();
+
+    /// <summary>
+    /// Retrieves the process-wide instance.
+    /// </summary>
+    /// <returns>The metadata coalescer.</returns>
+    static BigDriveMetadataCoalescer& GetInstance();
+
+    /// <summary>
+    /// Retrieves the metadata of one path, in a call shared with the requests other threads make meanwhile.
+    /// </summary>
+    /// <param name="pBatch">The provider, used if this request leads the batch.</param>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="szPath">The full path, as passed to providers.</param>
+    /// <param name="fields">Combination of <see cref="BigDriveFileInfoFields"/> values.</param>
+    /// <param name="entry">Receives the answer, with pchName and pchETag set to nullptr.</param>
+    /// <returns>S_OK if the provider supplied any field; S_FALSE if it knows no such path; otherwise, the failure of the shared call.</returns>
+    HRESULT GetFileInfo(IBigDriveFileInfoBatch* pBatch, REFGUID driveGuid, LPCWSTR szPath, LONG fields, BigDriveEnumerationEntry& entry);
+
+    /// <summary>
+    /// Retrieves the coalescer counters.
+    /// </summary>
+    /// <param name="requests">Receives the number of requests made.</param>
+    /// <param name="calls">Receives the number of provider calls made for them.</param>
+    void GetStatistics(LONG& requests, LONG& calls);
+
+private:
+
+    /// <summary>
+    /// Makes the provider call for a closed batch and fills in its answers. Called without the lock;
+    /// only the leader touches a closed batch until it is done.
+    /// </summary>
+    /// <param name="pBatch">The provider.</param>
+    /// <param name="pMetadataBatch">The batch.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    static HRESULT Send(IBigDriveFileInfoBatch* pBatch, BigDriveMetadataBatch* pMetadataBatch);
+
+    /// <summary>
+    /// Allocates an open batch.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="fields">BigDriveFileInfoFields asked of the provider.</param>
+    /// <param name="maxBatch">Number of requests the batch can hold.</param>
+    /// <returns>The batch, or nullptr if out of memory.</returns>
+    static BigDriveMetadataBatch* CreateBatch(REFGUID driveGuid, LONG fields, ULONG maxBatch);
+
+    /// <summary>
+    /// Frees a batch and its paths.
+    /// </summary>
+    /// <param name="pMetadataBatch">The batch.</param>
+    static void FreeBatch(BigDriveMetadataBatch* pMetadataBatch);
+
+    /// <summary>
+    /// Removes a batch from the open list so no more requests join it. Called with the lock held.
+    /// </summary>
+    /// <param name="pMetadataBatch">The batch.</param>
+    void CloseBatch(BigDriveMetadataBatch* pMetadataBatch);
+};
@@ -0,0 +1,250 @@
+// <copyright file="BigDrivePerformanceCounters.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDrivePerformanceCounters.h"
+
+// System
+#include <string.h>
+#include <strsafe.h>
+
+/// <inheritdoc />
+const WCHAR BigDrivePerformanceCounters::MappingNameFormat[] = L"Local\\BigDrive.Counters.%lu";
+
+/// <inheritdoc />
+void BigDrivePerformanceCounters::Increment(BigDriveCounter counter)
+{
+    // NoFence: a counter orders no other memory, so weakly ordered processors skip the barriers
+    ::InterlockedIncrementNoFence64(&GetBlock()->counters[counter]);
+}
+
+/// <inheritdoc />
+void BigDrivePerformanceCounters::Decrement(BigDriveCounter counter)
+{
+    ::InterlockedDecrementNoFence64(&GetBlock()->counters[counter]);
+}
+
+/// <inheritdoc />
+void BigDrivePerformanceCounters::Add(BigDriveCounter counter, LONGLONG value)
+{
+    ::InterlockedExchangeAddNoFence64(&GetBlock()->counters[counter], value);
+}
+
+/// <inheritdoc />
+LONGLONG BigDrivePerformanceCounters::GetValue(BigDriveCounter counter)
+{
+    return ::InterlockedCompareExchange64(&GetBlock()->counters[counter], 0, 0);
+}
+
+/// <inheritdoc />
+void BigDrivePerformanceCounters::BeginProviderCall(LPCSTR szCallName, volatile LONG& slot)
+{
+    BigDriveCounterBlock* pBlock = GetBlock();
+    LONG index = slot;
+
+    ::InterlockedIncrementNoFence64(&pBlock->counters[BigDriveCounter_ProviderCalls]);
+    ::InterlockedIncrementNoFence64(&pBlock->counters[BigDriveCounter_ProviderCallsInFlight]);
+
+    if (index < 0)
+    {
+        // First call from this call site; threads racing here all find the same slot
+        index = FindProviderCall(pBlock, szCallName, TRUE);
+        if (index < 0)
+        {
+            return;
+        }
+
+        slot = index;
+    }
+
+    ::InterlockedIncrementNoFence64(&pBlock->providerCalls[index].calls);
+}
+
+/// <inheritdoc />
+void BigDrivePerformanceCounters::EndProviderCall(HRESULT hr)
+{
+    BigDriveCounterBlock* pBlock = GetBlock();
+
+    ::InterlockedDecrementNoFence64(&pBlock->counters[BigDriveCounter_ProviderCallsInFlight]);
+
+    if (FAILED(hr))
+    {
+        ::InterlockedIncrementNoFence64(&pBlock->counters[BigDriveCounter_ProviderCallFailures]);
+    }
+}
+
+/// <inheritdoc />
+LONGLONG BigDrivePerformanceCounters::GetProviderCallCount(LPCSTR szCallName)
+{
+    BigDriveCounterBlock* pBlock = GetBlock();
+    LONG index = FindProviderCall(pBlock, szCallName, FALSE);
+
+    if (index < 0)
+    {
+        return 0;
+    }
+
+    return ::InterlockedCompareExchange64(&pBlock->providerCalls[index].calls, 0, 0);
+}
+
+/// <inheritdoc />
+HRESULT BigDrivePerformanceCounters::GetMappingName(DWORD processId, LPWSTR szName, size_t cchName)
+{
+    if (szName == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    return ::StringCchPrintfW(szName, cchName, MappingNameFormat, static_cast<unsigned long>(processId));
+}
+
+/// <inheritdoc />
+BigDriveCounterBlock* BigDrivePerformanceCounters::GetBlock()
+{
+    // Never unmapped, so objects released while the process shuts down still have somewhere to count
+    static BigDriveCounterBlock* s_pBlock = CreateBlock();
+    return s_pBlock;
+}
+
+/// <inheritdoc />
+BigDriveCounterBlock* BigDrivePerformanceCounters::CreateBlock()
+{
+    WCHAR szName[64];
+    HANDLE hMapping = nullptr;
+    BigDriveCounterBlock* pBlock = nullptr;
+    BOOL fCreated = TRUE;
+    FILETIME startTime;
+
+    if (SUCCEEDED(GetMappingName(::GetCurrentProcessId(), szName, ARRAYSIZE(szName))))
+    {
+        // Backed by the paging file and zero filled. Another module of this process may have created it first.
+        hMapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(BigDriveCounterBlock), szName);
+    }
+
+    if (hMapping != nullptr)
+    {
+        fCreated = (::GetLastError() != ERROR_ALREADY_EXISTS);
+
+        // The handle stays open for the life of the process, so the name stays resolvable
+        pBlock = static_cast<BigDriveCounterBlock*>(::MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, sizeof(BigDriveCounterBlock)));
+        if (pBlock == nullptr)
+        {
+            ::CloseHandle(hMapping);
+            hMapping = nullptr;
+            fCreated = TRUE;
+        }
+    }
+
+    if (pBlock == nullptr)
+    {
+        pBlock = new BigDriveCounterBlock();
+        if (pBlock == nullptr)
+        {
+            // Nowhere to count; callers assume a block, so give them one that is never read
+            static BigDriveCounterBlock s_discarded;
+            return &s_discarded;
+        }
+
+        ::ZeroMemory(pBlock, sizeof(BigDriveCounterBlock));
+    }
+
+    if (!fCreated)
+    {
+        return pBlock;
+    }
+
+    ::GetSystemTimeAsFileTime(&startTime);
+
+    pBlock->version = BigDriveCounterBlock::Version;
+    pBlock->cbSize = sizeof(BigDriveCounterBlock);
+    pBlock->processId = ::GetCurrentProcessId();
+    pBlock->startTime = (static_cast<LONGLONG>(startTime.dwHighDateTime) << 32) | startTime.dwLowDateTime;
+    pBlock->counterCount = BigDriveCounter_Count;
+
+    // Readers check the signature first, so it goes last
+    ::InterlockedExchange(reinterpret_cast<volatile LONG*>(&pBlock->signature), static_cast<LONG>(BigDriveCounterBlock::Signature));
+
+    return pBlock;
+}
+
+/// <inheritdoc />
+LONG BigDrivePerformanceCounters::FindProviderCall(BigDriveCounterBlock* pBlock, LPCSTR szCallName, BOOL fAdd)
+{
+    const size_t cchMaxName = sizeof(BigDriveProviderCallCounter::szName) - 1;
+    BigDriveProviderCallCounter* pCall = nullptr;
+    ULONG hash = 0;
+    ULONG slot = 0;
+    LONG existing = 0;
+
+    if (szCallName == nullptr)
+    {
+        return -1;
+    }
+
+    hash = Hash(szCallName);
+
+    for (ULONG i = 0; i < BigDriveCounterBlock::MaxProviderCalls; i++)
+    {
+        slot = (hash + i) & (BigDriveCounterBlock::MaxProviderCalls - 1);
+        pCall = &pBlock->providerCalls[slot];
+
+        if (fAdd)
+        {
+            // Claims the slot if it is free; slots are shared with the other modules of the process
+            existing = ::InterlockedCompareExchange(&pCall->hash, static_cast<LONG>(hash), 0);
+            if (existing == 0)
+            {
+                ::StringCchCopyNA(pCall->szName, ARRAYSIZE(pCall->szName), szCallName, cchMaxName);
+                ::InterlockedExchange(&pCall->fNamed, TRUE);
+                return static_cast<LONG>(slot);
+            }
+        }
+        else
+        {
+            existing = ::InterlockedCompareExchange(&pCall->hash, 0, 0);
+            if (existing == 0)
+            {
+                return -1;
+            }
+        }
+
+        if (static_cast<ULONG>(existing) != hash)
+        {
+            continue;
+        }
+
+        // The claiming thread writes the name right after the hash
+        while (::InterlockedCompareExchange(&pCall->fNamed, 0, 0) == 0)
+        {
+            ::YieldProcessor();
+        }
+
+        if (::strncmp(pCall->szName, szCallName, cchMaxName) == 0)
+        {
+            return static_cast<LONG>(slot);
+        }
+    }
+
+    // Table full: the call is counted in the totals only
+    return -1;
+}
+
+/// <inheritdoc />
+ULONG BigDrivePerformanceCounters::Hash(LPCSTR szName)
+{
+    const size_t cchMaxName = sizeof(BigDriveProviderCallCounter::szName) - 1;
+    ULONG hash = 2166136261UL;
+    size_t i = 0;
+
+    for (i = 0; (i < cchMaxName) && (szName[i] != '\0'); i++)
+    {
+        hash ^= static_cast<UCHAR>(szName[i]);
+        hash *= 16777619UL;
+    }
+
+    // Zero marks a free slot
+    return (hash == 0) ? 1 : hash;
+}
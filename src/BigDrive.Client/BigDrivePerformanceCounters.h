@@ -0,0 +1,262 @@
+// <copyright file="BigDrivePerformanceCounters.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+/// <summary>
+/// The counters of a <see cref="BigDriveCounterBlock"/>. Values are appended, never reordered,
+/// since readers in other processes index the block by them.
+/// </summary>
+enum BigDriveCounter
+{
+    /// <summary>
+    /// Calls made to the provider.
+    /// </summary>
+    BigDriveCounter_ProviderCalls = 0,
+
+    /// <summary>
+    /// Calls to the provider that have not returned yet.
+    /// </summary>
+    BigDriveCounter_ProviderCallsInFlight = 1,
+
+    /// <summary>
+    /// Calls to the provider that returned a failure HRESULT.
+    /// </summary>
+    BigDriveCounter_ProviderCallFailures = 2,
+
+    /// <summary>
+    /// Drive configurations asked of the configuration cache.
+    /// </summary>
+    BigDriveCounter_ConfigurationLookups = 3,
+
+    /// <summary>
+    /// Drive configurations served from the configuration cache.
+    /// </summary>
+    BigDriveCounter_ConfigurationCacheHits = 4,
+
+    /// <summary>
+    /// Drive configurations fetched from the configuration service.
+    /// </summary>
+    BigDriveCounter_ConfigurationCacheMisses = 5,
+
+    BigDriveCounter_ListingCacheHits = 6,
+    BigDriveCounter_ListingCacheMisses = 7,
+    BigDriveCounter_IconCacheHits = 8,
+    BigDriveCounter_IconCacheMisses = 9,
+    BigDriveCounter_ConnectionPoolHits = 10,
+    BigDriveCounter_ConnectionPoolMisses = 11,
+
+    /// <summary>
+    /// Bytes of file content read through read-ahead streams.
+    /// </summary>
+    BigDriveCounter_BytesStreamed = 12,
+
+    /// <summary>
+    /// BigDriveShellFolder objects alive.
+    /// </summary>
+    BigDriveCounter_LiveShellFolders = 13,
+
+    /// <summary>
+    /// Enumerators alive: BigDriveEnumIDList, BigDrivePagedEnumIDList and BigDriveAsyncEnumIDList.
+    /// </summary>
+    BigDriveCounter_LiveEnumIDLists = 14,
+
+    /// <summary>
+    /// BigDriveDataObject objects alive.
+    /// </summary>
+    BigDriveCounter_LiveDataObjects = 15,
+
+    /// <summary>
+    /// Metadata requests made through BigDriveMetadataCoalescer.
+    /// </summary>
+    BigDriveCounter_MetadataRequests = 16,
+
+    /// <summary>
+    /// IBigDriveFileInfoBatch calls BigDriveMetadataCoalescer made for them.
+    /// </summary>
+    BigDriveCounter_MetadataBatches = 17,
+
+    /// <summary>
+    /// Requests BigDriveSingleFlight answered from an identical provider call already in flight.
+    /// </summary>
+    BigDriveCounter_ProviderCallsShared = 18,
+
+    BigDriveCounter_Count = 19
+};
+
+/// <summary>
+/// Calls made to one provider method. 64 bytes, so each sits on its own cache line.
+/// </summary>
+struct BigDriveProviderCallCounter
+{
+    /// <summary>
+    /// Hash of the name, never zero; zero while the slot is free. Claimed with a compare-exchange.
+    /// </summary>
+    volatile LONG hash;
+
+    /// <summary>
+    /// Non-zero once szName has been written.
+    /// </summary>
+    volatile LONG fNamed;
+
+    /// <summary>
+    /// The call name ("IBigDriveFileInfo::GetFileSize"), truncated to fit and null terminated.
+    /// </summary>
+    CHAR szName[48];
+
+    /// <summary>
+    /// Calls made.
+    /// </summary>
+    volatile LONG64 calls;
+};
+
+/// <summary>
+/// Layout of the shared memory a process publishes its counters in. Read by BigDrive.Shell's
+/// stats command, which mirrors the offsets; change both together and bump Version.
+/// </summary>
+struct BigDriveCounterBlock
+{
+    /// <summary>
+    /// "BDPC".
+    /// </summary>
+    static const ULONG Signature = 0x43504442;
+
+    static const ULONG Version = 1;
+
+    /// <summary>
+    /// Counter slots reserved; BigDriveCounter_Count of them are used.
+    /// </summary>
+    static const ULONG MaxCounters = 32;
+
+    /// <summary>
+    /// Provider call slots. Must be a power of two.
+    /// </summary>
+    static const ULONG MaxProviderCalls = 64;
+
+    ULONG signature;
+    ULONG version;
+
+    /// <summary>
+    /// Size of the block in bytes.
+    /// </summary>
+    ULONG cbSize;
+
+    ULONG processId;
+
+    /// <summary>
+    /// When the block was created, as a FILETIME in UTC.
+    /// </summary>
+    LONGLONG startTime;
+
+    /// <summary>
+    /// Number of counters in use.
+    /// </summary>
+    ULONG counterCount;
+
+    ULONG reserved[9];
+
+    /// <summary>
+    /// Counter values, indexed by <see cref="BigDriveCounter"/>; at offset 64.
+    /// </summary>
+    volatile LONG64 counters[MaxCounters];
+
+    /// <summary>
+    /// Open-addressed table of provider calls, by name hash; at offset 320.
+    /// </summary>
+    BigDriveProviderCallCounter providerCalls[MaxProviderCalls];
+};
+
+/// <summary>
+/// Process-wide performance counters, published in a named shared-memory block
+/// (Local\BigDrive.Counters.&lt;process id&gt;) so a tool can attach to Explorer and sample them
+/// without a trace session. Updates are relaxed interlocked adds: a counter orders nothing, so
+/// readers see each value whole but not a consistent snapshot of all of them. Every module in
+/// the process that links the client opens the same block. If the block can't be created the
+/// counters are kept in private memory and still readable in process.
+/// </summary>
+class BigDrivePerformanceCounters
+{
+public:
+
+    /// <summary>
+    /// Format of the block's name; the argument is the process ID.
+    /// </summary>
+    static const WCHAR MappingNameFormat[];
+
+    /// <summary>
+    /// Adds one to a counter.
+    /// </summary>
+    static void Increment(BigDriveCounter counter);
+
+    /// <summary>
+    /// Subtracts one from a counter.
+    /// </summary>
+    static void Decrement(BigDriveCounter counter);
+
+    /// <summary>
+    /// Adds a value to a counter.
+    /// </summary>
+    static void Add(BigDriveCounter counter, LONGLONG value);
+
+    /// <summary>
+    /// Reads a counter.
+    /// </summary>
+    /// <returns>The counter's value.</returns>
+    static LONGLONG GetValue(BigDriveCounter counter);
+
+    /// <summary>
+    /// Counts the start of a call to the provider.
+    /// </summary>
+    /// <param name="szCallName">The interface and method called.</param>
+    /// <param name="slot">Per call site cache of the call's slot, initialized to -1; resolved on first use.</param>
+    static void BeginProviderCall(LPCSTR szCallName, volatile LONG& slot);
+
+    /// <summary>
+    /// Counts the end of a call to the provider.
+    /// </summary>
+    /// <param name="hr">The HRESULT the provider returned.</param>
+    static void EndProviderCall(HRESULT hr);
+
+    /// <summary>
+    /// Reads the calls made to one provider method.
+    /// </summary>
+    /// <returns>The number of calls; zero if none have been made.</returns>
+    static LONGLONG GetProviderCallCount(LPCSTR szCallName);
+
+    /// <summary>
+    /// Formats the name of the block a process publishes.
+    /// </summary>
+    /// <param name="processId">The process ID.</param>
+    /// <param name="szName">Receives the name.</param>
+    /// <param name="cchName">Size of szName in characters.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    static HRESULT GetMappingName(DWORD processId, LPWSTR szName, size_t cchName);
+
+private:
+
+    /// <summary>
+    /// Returns the process's block, creating it on first use.
+    /// </summary>
+    static BigDriveCounterBlock* GetBlock();
+
+    /// <summary>
+    /// Creates or opens the named block; falls back to private memory.
+    /// </summary>
+    static BigDriveCounterBlock* CreateBlock();
+
+    /// <summary>
+    /// Finds the slot of a provider call, claiming a free one if it has none.
+    /// </summary>
+    /// <param name="fAdd">TRUE to claim a slot for a name not in the table.</param>
+    /// <returns>The slot; -1 if the name is absent and not added, or the table is full.</returns>
+    static LONG FindProviderCall(BigDriveCounterBlock* pBlock, LPCSTR szCallName, BOOL fAdd);
+
+    /// <summary>
+    /// Computes the FNV-1a hash of a name, as far as it would be stored.
+    /// </summary>
+    static ULONG Hash(LPCSTR szName);
+};
@@ -0,0 +1,267 @@
+// <copyright file="BigDriveProducerConsumerQueue.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveProducerConsumerQueue.h"
+
+/// <inheritdoc />
+BigDriveProducerConsumerQueue::BigDriveProducerConsumerQueue(BigDriveQueueItemFree pfnFree)
+    : m_pfnFree(pfnFree),
+    m_apItems(nullptr),
+    m_capacity(0),
+    m_head(0),
+    m_count(0),
+    m_fCompleted(FALSE),
+    m_fCancelled(FALSE),
+    m_hrCompletion(S_OK),
+    m_producerWaits(0)
+{
+    ::InitializeSRWLock(&m_lock);
+    ::InitializeConditionVariable(&m_notEmpty);
+    ::InitializeConditionVariable(&m_notFull);
+}
+
+/// <inheritdoc />
+BigDriveProducerConsumerQueue::~BigDriveProducerConsumerQueue()
+{
+    if (m_apItems)
+    {
+        if (m_pfnFree)
+        {
+            for (ULONG i = 0; i < m_count; i++)
+            {
+                m_pfnFree(m_apItems[(m_head + i) % m_capacity]);
+            }
+        }
+
+        delete[] m_apItems;
+        m_apItems = nullptr;
+    }
+
+    m_count = 0;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveProducerConsumerQueue::Initialize(ULONG capacity)
+{
+    if ((capacity == 0) || (m_apItems != nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_apItems = new void*[capacity];
+    if (m_apItems == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    m_capacity = capacity;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveProducerConsumerQueue::Push(void* pItem, DWORD dwTimeoutMs)
+{
+    HRESULT hr = S_OK;
+    ULONGLONG ullStart = ::GetTickCount64();
+    BOOL fWaited = FALSE;
+
+    if (m_apItems == nullptr)
+    {
+        return E_UNEXPECTED;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    while (!m_fCancelled && !m_fCompleted && (m_count == m_capacity))
+    {
+        fWaited = TRUE;
+
+        if (!Wait(&m_notFull, dwTimeoutMs, ullStart))
+        {
+            break;
+        }
+    }
+
+    if (m_fCancelled)
+    {
+        hr = E_ABORT;
+        goto End;
+    }
+
+    if (m_fCompleted)
+    {
+        hr = E_UNEXPECTED;
+        goto End;
+    }
+
+    if (m_count == m_capacity)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+        goto End;
+    }
+
+    m_apItems[(m_head + m_count) % m_capacity] = pItem;
+    m_count++;
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (fWaited)
+    {
+        ::InterlockedIncrement(&m_producerWaits);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        ::WakeConditionVariable(&m_notEmpty);
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveProducerConsumerQueue::Pop(void** ppItems, ULONG cItems, ULONG& cPopped, DWORD dwTimeoutMs)
+{
+    HRESULT hr = S_OK;
+    ULONGLONG ullStart = ::GetTickCount64();
+
+    cPopped = 0;
+
+    if ((ppItems == nullptr) || (cItems == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (m_apItems == nullptr)
+    {
+        return E_UNEXPECTED;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    while ((m_count == 0) && !m_fCompleted)
+    {
+        if ((dwTimeoutMs == 0) || !Wait(&m_notEmpty, dwTimeoutMs, ullStart))
+        {
+            break;
+        }
+    }
+
+    // Queued items are handed out before the completion status, even after a cancel
+    while ((cPopped < cItems) && (m_count > 0))
+    {
+        ppItems[cPopped++] = m_apItems[m_head];
+        m_head = (m_head + 1) % m_capacity;
+        m_count--;
+    }
+
+    if (cPopped > 0)
+    {
+        hr = S_OK;
+    }
+    else if (m_fCompleted)
+    {
+        hr = FAILED(m_hrCompletion) ? m_hrCompletion : S_FALSE;
+    }
+    else
+    {
+        hr = E_PENDING;
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (cPopped > 0)
+    {
+        ::WakeConditionVariable(&m_notFull);
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveProducerConsumerQueue::Complete(HRESULT hrCompletion)
+{
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (!m_fCompleted)
+    {
+        m_fCompleted = TRUE;
+        m_hrCompletion = hrCompletion;
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    ::WakeAllConditionVariable(&m_notEmpty);
+}
+
+/// <inheritdoc />
+void BigDriveProducerConsumerQueue::Cancel()
+{
+    ::AcquireSRWLockExclusive(&m_lock);
+    m_fCancelled = TRUE;
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    ::WakeAllConditionVariable(&m_notFull);
+}
+
+/// <inheritdoc />
+BOOL BigDriveProducerConsumerQueue::IsCancelled()
+{
+    BOOL fCancelled = FALSE;
+
+    ::AcquireSRWLockShared(&m_lock);
+    fCancelled = m_fCancelled;
+    ::ReleaseSRWLockShared(&m_lock);
+
+    return fCancelled;
+}
+
+/// <inheritdoc />
+ULONG BigDriveProducerConsumerQueue::GetCount()
+{
+    ULONG count = 0;
+
+    ::AcquireSRWLockShared(&m_lock);
+    count = m_count;
+    ::ReleaseSRWLockShared(&m_lock);
+
+    return count;
+}
+
+/// <inheritdoc />
+LONG BigDriveProducerConsumerQueue::GetProducerWaits()
+{
+    return ::InterlockedCompareExchange(&m_producerWaits, 0, 0);
+}
+
+/// <inheritdoc />
+BOOL BigDriveProducerConsumerQueue::Wait(PCONDITION_VARIABLE pCondition, DWORD dwTimeoutMs, ULONGLONG ullStart)
+{
+    ULONGLONG ullElapsed = 0;
+    DWORD dwRemaining = INFINITE;
+
+    if (dwTimeoutMs != INFINITE)
+    {
+        ullElapsed = ::GetTickCount64() - ullStart;
+        if (ullElapsed >= dwTimeoutMs)
+        {
+            return FALSE;
+        }
+
+        dwRemaining = dwTimeoutMs - static_cast<DWORD>(ullElapsed);
+    }
+
+    // A spurious or timed out wake is re-checked by the caller's loop
+    if (!::SleepConditionVariableSRW(pCondition, &m_lock, dwRemaining, 0))
+    {
+        return ::GetLastError() != ERROR_TIMEOUT;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,168 @@
+// <copyright file="BigDriveProducerConsumerQueue.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+/// <summary>
+/// Frees an item left in a <see cref="BigDriveProducerConsumerQueue"/> when it is destroyed.
+/// </summary>
+/// <param name="pItem">The item to free.</param>
+typedef void (*BigDriveQueueItemFree)(void* pItem);
+
+/// <summary>
+/// Bounded first-in first-out queue that hands items from one producer thread to a consumer.
+/// The producer blocks while the queue is full, so a fast provider cannot run ahead of a slow
+/// view. The consumer polls or waits, and learns that the producer has finished from the
+/// status passed to <see cref="Complete"/>. <see cref="Cancel"/> tells the producer to stop;
+/// items already queued can still be popped. Items are opaque pointers owned by the queue
+/// until popped; those left when the queue is destroyed are freed with the free callback.
+/// </summary>
+class BigDriveProducerConsumerQueue
+{
+private:
+
+    /// <summary>
+    /// Frees items left in the queue on destruction. May be nullptr.
+    /// </summary>
+    BigDriveQueueItemFree m_pfnFree;
+
+    /// <summary>
+    /// Ring buffer of items.
+    /// </summary>
+    void** m_apItems;
+
+    /// <summary>
+    /// Number of slots in the ring buffer.
+    /// </summary>
+    ULONG m_capacity;
+
+    /// <summary>
+    /// Slot of the oldest item.
+    /// </summary>
+    ULONG m_head;
+
+    /// <summary>
+    /// Number of items in the ring buffer.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// TRUE once the producer has called <see cref="Complete"/>.
+    /// </summary>
+    BOOL m_fCompleted;
+
+    /// <summary>
+    /// TRUE once <see cref="Cancel"/> has been called.
+    /// </summary>
+    BOOL m_fCancelled;
+
+    /// <summary>
+    /// Status passed to <see cref="Complete"/>.
+    /// </summary>
+    HRESULT m_hrCompletion;
+
+    /// <summary>
+    /// Guards every field above.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Signaled when an item is pushed or the producer completes.
+    /// </summary>
+    CONDITION_VARIABLE m_notEmpty;
+
+    /// <summary>
+    /// Signaled when an item is popped or the queue is cancelled.
+    /// </summary>
+    CONDITION_VARIABLE m_notFull;
+
+    /// <summary>
+    /// Counter of pushes that had to wait for room.
+    /// </summary>
+    volatile LONG m_producerWaits;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveProducerConsumerQueue"/> class.
+    /// </summary>
+    /// <param name="pfnFree">Frees items left in the queue on destruction, or nullptr if items need no freeing.</param>
+    BigDriveProducerConsumerQueue(BigDriveQueueItemFree pfnFree);
+
+    /// <summary>
+    /// Frees the ring buffer and any items left in it. No thread may be using the queue.
+    /// </summary>
+    ~BigDriveProducerConsumerQueue();
+
+    /// <summary>
+    /// Allocates the ring buffer.
+    /// </summary>
+    /// <param name="capacity">Maximum number of items held before the producer blocks.</param>
+    /// <returns>S_OK on success; E_INVALIDARG if capacity is zero; E_OUTOFMEMORY if the buffer could not be allocated.</returns>
+    HRESULT Initialize(ULONG capacity);
+
+    /// <summary>
+    /// Adds an item, waiting for room if the queue is full.
+    /// </summary>
+    /// <param name="pItem">The item. The queue owns it on S_OK; the caller keeps it otherwise.</param>
+    /// <param name="dwTimeoutMs">Milliseconds to wait for room, or INFINITE.</param>
+    /// <returns>S_OK if queued; E_ABORT if the queue was cancelled; HRESULT_FROM_WIN32(ERROR_TIMEOUT) if no room was made in time; E_UNEXPECTED after <see cref="Complete"/>.</returns>
+    HRESULT Push(void* pItem, DWORD dwTimeoutMs);
+
+    /// <summary>
+    /// Removes up to cItems items, waiting for the first one if the queue is empty.
+    /// </summary>
+    /// <param name="ppItems">Array that receives the items. The caller owns them.</param>
+    /// <param name="cItems">Size of the array.</param>
+    /// <param name="cPopped">Receives the number of items removed.</param>
+    /// <param name="dwTimeoutMs">Milliseconds to wait for the first item, zero to poll, or INFINITE.</param>
+    /// <returns>
+    /// S_OK if at least one item was removed; E_PENDING if none arrived in time and the producer is still running;
+    /// S_FALSE if the producer completed successfully and the queue is drained; the producer's failure if it completed with one.
+    /// </returns>
+    HRESULT Pop(void** ppItems, ULONG cItems, ULONG& cPopped, DWORD dwTimeoutMs);
+
+    /// <summary>
+    /// Called by the producer when it has pushed its last item. Wakes a waiting consumer.
+    /// </summary>
+    /// <param name="hrCompletion">S_OK if the producer finished, or the error that stopped it.</param>
+    void Complete(HRESULT hrCompletion);
+
+    /// <summary>
+    /// Tells the producer to stop. Blocked and later pushes fail with E_ABORT.
+    /// </summary>
+    void Cancel();
+
+    /// <summary>
+    /// Determines whether the queue has been cancelled.
+    /// </summary>
+    /// <returns>TRUE if <see cref="Cancel"/> has been called.</returns>
+    BOOL IsCancelled();
+
+    /// <summary>
+    /// Retrieves the number of items waiting to be popped.
+    /// </summary>
+    /// <returns>The number of queued items.</returns>
+    ULONG GetCount();
+
+    /// <summary>
+    /// Retrieves the number of pushes that had to wait because the queue was full.
+    /// </summary>
+    /// <returns>The number of producer waits.</returns>
+    LONG GetProducerWaits();
+
+private:
+
+    /// <summary>
+    /// Waits on a condition variable, charging the time waited against a timeout. The caller holds the lock exclusive.
+    /// </summary>
+    /// <param name="pCondition">The condition variable.</param>
+    /// <param name="dwTimeoutMs">The total timeout, or INFINITE.</param>
+    /// <param name="ullStart">Tick count when the caller started waiting.</param>
+    /// <returns>TRUE if woken; FALSE if the timeout elapsed.</returns>
+    BOOL Wait(PCONDITION_VARIABLE pCondition, DWORD dwTimeoutMs, ULONGLONG ullStart);
+};
@@ -0,0 +1,24 @@
+// <copyright file="BigDriveProviderActivator.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveProviderActivator.h"
+
+// System
+#include <combaseapi.h>
+
+/// <inheritdoc />
+HRESULT BigDriveProviderActivator::Activate(const CLSID& clsid, IUnknown** ppUnknown)
+{
+    if (ppUnknown == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppUnknown = nullptr;
+
+    return ::CoCreateInstance(clsid, nullptr, CLSCTX_LOCAL_SERVER, IID_IUnknown, reinterpret_cast<void**>(ppUnknown));
+}
@@ -0,0 +1,50 @@
+// <copyright file="BigDriveProviderActivator.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <unknwn.h>
+
+/// <summary>
+/// Abstraction over the activation of a BigDrive provider object. The connection pool
+/// activates providers through this interface so it can be exercised with a fake activator
+/// in unit tests and benchmarks without a registered COM+ application.
+/// </summary>
+class IBigDriveProviderActivator
+{
+public:
+
+    /// <summary>
+    /// Virtual destructor.
+    /// </summary>
+    virtual ~IBigDriveProviderActivator()
+    {
+    }
+
+    /// <summary>
+    /// Activates a new instance of the provider identified by the CLSID.
+    /// </summary>
+    /// <param name="clsid">The CLSID of the provider to activate.</param>
+    /// <param name="ppUnknown">Receives the IUnknown of the new provider instance. The caller must release it.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    virtual HRESULT Activate(const CLSID& clsid, IUnknown** ppUnknown) = 0;
+};
+
+/// <summary>
+/// Default activator that creates the provider out of process in its COM+ application.
+/// </summary>
+class BigDriveProviderActivator : public IBigDriveProviderActivator
+{
+public:
+
+    /// <summary>
+    /// Activates a new instance of the provider using CoCreateInstance with CLSCTX_LOCAL_SERVER.
+    /// </summary>
+    /// <param name="clsid">The CLSID of the provider to activate.</param>
+    /// <param name="ppUnknown">Receives the IUnknown of the new provider instance. The caller must release it.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT Activate(const CLSID& clsid, IUnknown** ppUnknown) override;
+};
@@ -0,0 +1,652 @@
+// <copyright file="BigDriveReadAheadStream.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveReadAheadStream.h"
+
+// System
+#include <objbase.h>
+#include <string.h>
+
+// Local
+#include "BigDrivePerformanceCounters.h"
+
+namespace
+{
+    // Size of the buffer CopyTo moves data through
+    const ULONG CopyToBufferSize = 64 * 1024;
+
+    HRESULT GetGlobalInterfaceTable(IGlobalInterfaceTable** ppGit)
+    {
+        return ::CoCreateInstance(CLSID_StdGlobalInterfaceTable, nullptr, CLSCTX_INPROC_SERVER, IID_IGlobalInterfaceTable, reinterpret_cast<void**>(ppGit));
+    }
+}
+
+/// <inheritdoc />
+BigDriveReadAheadStream::BigDriveReadAheadStream()
+    : m_refCount(1),
+    m_dwSourceCookie(0),
+    m_cbChunk(0),
+    m_iRead(0),
+    m_iFill(0),
+    m_ullPosition(0),
+    m_ullSeekTo(ULLONG_MAX),
+    m_fReading(FALSE),
+    m_fStop(FALSE),
+    m_fEnd(FALSE),
+    m_hrEnd(S_OK)
+{
+    ::ZeroMemory(&m_statstg, sizeof(m_statstg));
+    ::ZeroMemory(m_chunks, sizeof(m_chunks));
+    ::InitializeSRWLock(&m_lock);
+    ::InitializeConditionVariable(&m_changed);
+}
+
+/// <inheritdoc />
+BigDriveReadAheadStream::~BigDriveReadAheadStream()
+{
+    IGlobalInterfaceTable* pGit = nullptr;
+
+    if (m_dwSourceCookie != 0)
+    {
+        if (SUCCEEDED(GetGlobalInterfaceTable(&pGit)))
+        {
+            pGit->RevokeInterfaceFromGlobal(m_dwSourceCookie);
+            pGit->Release();
+        }
+
+        m_dwSourceCookie = 0;
+    }
+
+    for (ULONG i = 0; i < ARRAYSIZE(m_chunks); i++)
+    {
+        if (m_chunks[i].pData)
+        {
+            delete[] m_chunks[i].pData;
+            m_chunks[i].pData = nullptr;
+        }
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveReadAheadStream::Create(IStream* pSource, ULONG cbWindow, IStream** ppStream)
+{
+    HRESULT hr = S_OK;
+    BigDriveReadAheadStream* pStream = nullptr;
+    IGlobalInterfaceTable* pGit = nullptr;
+    LARGE_INTEGER liZero = { 0 };
+    ULARGE_INTEGER uliPosition = { 0 };
+
+    if (ppStream == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppStream = nullptr;
+
+    if (pSource == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    pStream = new BigDriveReadAheadStream();
+    if (pStream == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pStream->m_cbChunk = ((cbWindow < MinimumWindowSize) ? MinimumWindowSize : cbWindow) / 2;
+
+    // Stat now so Stat and Seek from the end never call the source while the worker reads it
+    if (SUCCEEDED(pSource->Stat(&pStream->m_statstg, STATFLAG_NONAME)))
+    {
+        // A small file only needs a chunk its own size
+        if (pStream->m_statstg.cbSize.QuadPart < pStream->m_cbChunk)
+        {
+            pStream->m_cbChunk = static_cast<ULONG>(pStream->m_statstg.cbSize.QuadPart) + 1;
+        }
+    }
+    else
+    {
+        ::ZeroMemory(&pStream->m_statstg, sizeof(pStream->m_statstg));
+        pStream->m_statstg.type = STGTY_STREAM;
+    }
+
+    pStream->m_statstg.pwcsName = nullptr;
+    pStream->m_statstg.grfMode = STGM_READ;
+
+    if (SUCCEEDED(pSource->Seek(liZero, STREAM_SEEK_CUR, &uliPosition)))
+    {
+        pStream->m_ullPosition = uliPosition.QuadPart;
+    }
+
+    for (ULONG i = 0; i < ARRAYSIZE(pStream->m_chunks); i++)
+    {
+        pStream->m_chunks[i].pData = new BYTE[pStream->m_cbChunk];
+        if (pStream->m_chunks[i].pData == nullptr)
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+    }
+
+    // The worker runs in its own apartment and needs a proxy of its own
+    hr = GetGlobalInterfaceTable(&pGit);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = pGit->RegisterInterfaceInGlobal(pSource, IID_IStream, &pStream->m_dwSourceCookie);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    ::AcquireSRWLockExclusive(&pStream->m_lock);
+    pStream->StartReading();
+    ::ReleaseSRWLockExclusive(&pStream->m_lock);
+
+    *ppStream = pStream;
+    pStream = nullptr;
+
+End:
+
+    if (pGit)
+    {
+        pGit->Release();
+        pGit = nullptr;
+    }
+
+    if (pStream)
+    {
+        pStream->Release();
+        pStream = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::QueryInterface(REFIID riid, void** ppv)
+{
+    if (ppv == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    if ((riid == IID_IUnknown) || (riid == IID_ISequentialStream) || (riid == IID_IStream))
+    {
+        *ppv = static_cast<IStream*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    *ppv = nullptr;
+    return E_NOINTERFACE;
+}
+
+/// <inheritdoc />
+ULONG __stdcall BigDriveReadAheadStream::AddRef()
+{
+    return ::InterlockedIncrement(&m_refCount);
+}
+
+/// <inheritdoc />
+ULONG __stdcall BigDriveReadAheadStream::Release()
+{
+    ULONG res = ::InterlockedDecrement(&m_refCount);
+    if (res == 0) delete this;
+    return res;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::Read(void* pv, ULONG cb, ULONG* pcbRead)
+{
+    HRESULT hr = S_OK;
+    BYTE* pDest = static_cast<BYTE*>(pv);
+    ULONG cbCopied = 0;
+    ULONG cbAvailable = 0;
+
+    if (pv == nullptr)
+    {
+        return STG_E_INVALIDPOINTER;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    while (cbCopied < cb)
+    {
+        Chunk& chunk = m_chunks[m_iRead];
+
+        if (chunk.fFull)
+        {
+            cbAvailable = chunk.cbData - chunk.cbConsumed;
+            if (cbAvailable > cb - cbCopied)
+            {
+                cbAvailable = cb - cbCopied;
+            }
+
+            ::memcpy(pDest + cbCopied, chunk.pData + chunk.cbConsumed, cbAvailable);
+            chunk.cbConsumed += cbAvailable;
+            cbCopied += cbAvailable;
+            m_ullPosition += cbAvailable;
+
+            if (chunk.cbConsumed == chunk.cbData)
+            {
+                // Drained; hand it back to the worker
+                chunk.fFull = FALSE;
+                chunk.cbData = 0;
+                chunk.cbConsumed = 0;
+                m_iRead ^= 1;
+
+                StartReading();
+            }
+
+            continue;
+        }
+
+        // Chunks are filled and drained in turn, so an empty chunk here means nothing is buffered
+        if (m_fEnd)
+        {
+            if (FAILED(m_hrEnd) && (cbCopied == 0))
+            {
+                hr = m_hrEnd;
+            }
+
+            break;
+        }
+
+        StartReading();
+
+        if (m_fReading)
+        {
+            ::SleepConditionVariableSRW(&m_changed, &m_lock, INFINITE, 0);
+        }
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    BigDrivePerformanceCounters::Add(BigDriveCounter_BytesStreamed, cbCopied);
+
+    if (pcbRead)
+    {
+        *pcbRead = cbCopied;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::Write(const void* pv, ULONG cb, ULONG* pcbWritten)
+{
+    if (pcbWritten)
+    {
+        *pcbWritten = 0;
+    }
+
+    return STG_E_ACCESSDENIED;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::Seek(LARGE_INTEGER dlibMove, DWORD dwOrigin, ULARGE_INTEGER* plibNewPosition)
+{
+    HRESULT hr = S_OK;
+    LONGLONG llBase = 0;
+    LONGLONG llTarget = 0;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    switch (dwOrigin)
+    {
+    case STREAM_SEEK_SET:
+        llBase = 0;
+        break;
+    case STREAM_SEEK_CUR:
+        llBase = static_cast<LONGLONG>(m_ullPosition);
+        break;
+    case STREAM_SEEK_END:
+        llBase = static_cast<LONGLONG>(m_statstg.cbSize.QuadPart);
+        break;
+    default:
+        hr = STG_E_INVALIDFUNCTION;
+        goto End;
+    }
+
+    llTarget = llBase + dlibMove.QuadPart;
+    if (llTarget < 0)
+    {
+        hr = STG_E_INVALIDFUNCTION;
+        goto End;
+    }
+
+    // Callers ask for the current position often; only a real move drops the chunks
+    if (static_cast<ULONGLONG>(llTarget) != m_ullPosition)
+    {
+        StopReading();
+
+        m_ullPosition = static_cast<ULONGLONG>(llTarget);
+        m_ullSeekTo = m_ullPosition;
+
+        StartReading();
+    }
+
+    if (plibNewPosition)
+    {
+        plibNewPosition->QuadPart = m_ullPosition;
+    }
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::SetSize(ULARGE_INTEGER libNewSize)
+{
+    return STG_E_ACCESSDENIED;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::CopyTo(IStream* pstm, ULARGE_INTEGER cb, ULARGE_INTEGER* pcbRead, ULARGE_INTEGER* pcbWritten)
+{
+    HRESULT hr = S_OK;
+    BYTE* pBuffer = nullptr;
+    ULONGLONG cbTotalRead = 0;
+    ULONGLONG cbTotalWritten = 0;
+    ULONG cbRequest = 0;
+    ULONG cbRead = 0;
+    ULONG cbWritten = 0;
+
+    if (pstm == nullptr)
+    {
+        hr = STG_E_INVALIDPOINTER;
+        goto End;
+    }
+
+    pBuffer = new BYTE[CopyToBufferSize];
+    if (pBuffer == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    while (cbTotalRead < cb.QuadPart)
+    {
+        cbRequest = (cb.QuadPart - cbTotalRead < CopyToBufferSize) ? static_cast<ULONG>(cb.QuadPart - cbTotalRead) : CopyToBufferSize;
+
+        hr = Read(pBuffer, cbRequest, &cbRead);
+        if (FAILED(hr) || (cbRead == 0))
+        {
+            break;
+        }
+
+        cbTotalRead += cbRead;
+
+        hr = pstm->Write(pBuffer, cbRead, &cbWritten);
+        cbTotalWritten += cbWritten;
+        if (FAILED(hr))
+        {
+            break;
+        }
+    }
+
+End:
+
+    if (pcbRead)
+    {
+        pcbRead->QuadPart = cbTotalRead;
+    }
+
+    if (pcbWritten)
+    {
+        pcbWritten->QuadPart = cbTotalWritten;
+    }
+
+    if (pBuffer)
+    {
+        delete[] pBuffer;
+        pBuffer = nullptr;
+    }
+
+    return FAILED(hr) ? hr : S_OK;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::Commit(DWORD grfCommitFlags)
+{
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::Revert()
+{
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::LockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType)
+{
+    return STG_E_INVALIDFUNCTION;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::UnlockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType)
+{
+    return STG_E_INVALIDFUNCTION;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::Stat(STATSTG* pstatstg, DWORD grfStatFlag)
+{
+    if (pstatstg == nullptr)
+    {
+        return STG_E_INVALIDPOINTER;
+    }
+
+    *pstatstg = m_statstg;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT __stdcall BigDriveReadAheadStream::Clone(IStream** ppstm)
+{
+    if (ppstm)
+    {
+        *ppstm = nullptr;
+    }
+
+    return E_NOTIMPL;
+}
+
+/// <inheritdoc />
+void BigDriveReadAheadStream::StartReading()
+{
+    if (m_fReading || m_fEnd || m_chunks[m_iFill].fFull)
+    {
+        return;
+    }
+
+    // The worker holds a reference so the stream outlives the chunk it is reading
+    m_fReading = TRUE;
+    AddRef();
+
+    if (!::TrySubmitThreadpoolCallback(FillCallback, this, nullptr))
+    {
+        m_fReading = FALSE;
+        m_fEnd = TRUE;
+        m_hrEnd = HRESULT_FROM_WIN32(::GetLastError());
+
+        // The caller holds a reference, so this is never the last
+        Release();
+    }
+}
+
+/// <inheritdoc />
+void BigDriveReadAheadStream::StopReading()
+{
+    m_fStop = TRUE;
+
+    while (m_fReading)
+    {
+        ::SleepConditionVariableSRW(&m_changed, &m_lock, INFINITE, 0);
+    }
+
+    m_fStop = FALSE;
+
+    for (ULONG i = 0; i < ARRAYSIZE(m_chunks); i++)
+    {
+        m_chunks[i].cbData = 0;
+        m_chunks[i].cbConsumed = 0;
+        m_chunks[i].fFull = FALSE;
+    }
+
+    m_iRead = 0;
+    m_iFill = 0;
+    m_fEnd = FALSE;
+    m_hrEnd = S_OK;
+}
+
+/// <inheritdoc />
+VOID CALLBACK BigDriveReadAheadStream::FillCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext)
+{
+    BigDriveReadAheadStream* pThis = static_cast<BigDriveReadAheadStream*>(pContext);
+    HRESULT hrCoInit = S_OK;
+
+    // Provider reads can take a while; let the pool add threads rather than queue behind this one
+    ::CallbackMayRunLong(pInstance);
+
+    // The last reference may be the worker's, and the destructor needs COM to revoke the source
+    hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    pThis->Fill();
+    pThis->Release();
+
+    if (SUCCEEDED(hrCoInit))
+    {
+        ::CoUninitialize();
+    }
+}
+
+/// <inheritdoc />
+void BigDriveReadAheadStream::Fill()
+{
+    HRESULT hr = S_OK;
+    IGlobalInterfaceTable* pGit = nullptr;
+    IStream* pSource = nullptr;
+    LARGE_INTEGER liSeekTo = { 0 };
+    ULONGLONG ullSeekTo = ULLONG_MAX;
+    ULONG iChunk = 0;
+    ULONG cbRead = 0;
+
+    hr = GetGlobalInterfaceTable(&pGit);
+    if (SUCCEEDED(hr))
+    {
+        hr = pGit->GetInterfaceFromGlobal(m_dwSourceCookie, IID_IStream, reinterpret_cast<void**>(&pSource));
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (FAILED(hr))
+    {
+        m_fEnd = TRUE;
+        m_hrEnd = hr;
+    }
+
+    while (!m_fEnd && !m_fStop && !m_chunks[m_iFill].fFull)
+    {
+        // Nobody but the worker holds the stream; reading on is wasted
+        if (::InterlockedCompareExchange(&m_refCount, 0, 0) == 1)
+        {
+            break;
+        }
+
+        iChunk = m_iFill;
+        ullSeekTo = m_ullSeekTo;
+        m_ullSeekTo = ULLONG_MAX;
+
+        ::ReleaseSRWLockExclusive(&m_lock);
+
+        hr = S_OK;
+        if (ullSeekTo != ULLONG_MAX)
+        {
+            liSeekTo.QuadPart = static_cast<LONGLONG>(ullSeekTo);
+            hr = pSource->Seek(liSeekTo, STREAM_SEEK_SET, nullptr);
+        }
+
+        // The chunk is free, so the caller doesn't touch it until it is marked full
+        cbRead = 0;
+        if (SUCCEEDED(hr))
+        {
+            hr = ReadChunk(pSource, m_chunks[iChunk].pData, m_cbChunk, cbRead);
+        }
+
+        ::AcquireSRWLockExclusive(&m_lock);
+
+        m_chunks[iChunk].cbData = cbRead;
+        m_chunks[iChunk].cbConsumed = 0;
+        m_chunks[iChunk].fFull = TRUE;
+        m_iFill = iChunk ^ 1;
+
+        if (FAILED(hr) || (cbRead < m_cbChunk))
+        {
+            m_fEnd = TRUE;
+            m_hrEnd = FAILED(hr) ? hr : S_OK;
+        }
+
+        ::WakeAllConditionVariable(&m_changed);
+    }
+
+    m_fReading = FALSE;
+    ::WakeAllConditionVariable(&m_changed);
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (pSource)
+    {
+        pSource->Release();
+        pSource = nullptr;
+    }
+
+    if (pGit)
+    {
+        pGit->Release();
+        pGit = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveReadAheadStream::ReadChunk(IStream* pSource, BYTE* pData, ULONG cbChunk, ULONG& cbRead)
+{
+    HRESULT hr = S_OK;
+    ULONG cbOnce = 0;
+
+    cbRead = 0;
+
+    while (cbRead < cbChunk)
+    {
+        cbOnce = 0;
+
+        hr = pSource->Read(pData + cbRead, cbChunk - cbRead, &cbOnce);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        cbRead += cbOnce;
+
+        if (cbOnce == 0)
+        {
+            break;
+        }
+    }
+
+    return S_OK;
+}
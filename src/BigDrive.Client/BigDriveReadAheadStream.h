@@ -0,0 +1,204 @@
+// <copyright file="BigDriveReadAheadStream.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <objidl.h>
+
+/// <summary>
+/// Read-only IStream over a provider stream that reads ahead on a thread pool thread, so the
+/// provider call for the next chunk overlaps with the caller consuming the current one.
+///
+/// The stream holds two chunk buffers and never more: the worker fills one while the caller
+/// drains the other. When both are full the worker stops, and the caller restarts it as soon as
+/// it frees one, so a caller that stops reading holds no thread. The source is only read by the
+/// worker, which gets it through the global interface table, so the stream can be read from any
+/// apartment. Seek stops the worker and the next read starts again from the new position.
+/// </summary>
+class BigDriveReadAheadStream : public IStream
+{
+public:
+
+    /// <summary>
+    /// Default number of bytes held in memory: two chunks of 4 MB.
+    /// </summary>
+    static const ULONG DefaultWindowSize = 8 * 1024 * 1024;
+
+    /// <summary>
+    /// Smallest window accepted; smaller windows are rounded up.
+    /// </summary>
+    static const ULONG MinimumWindowSize = 128 * 1024;
+
+private:
+
+    /// <summary>
+    /// One of the two read-ahead buffers.
+    /// </summary>
+    struct Chunk
+    {
+        BYTE* pData;
+        ULONG cbData;       // Bytes the worker put in it
+        ULONG cbConsumed;   // Bytes the caller has read from it
+        BOOL fFull;         // Set by the worker, cleared by the caller once it is drained
+    };
+
+    LONG m_refCount;
+
+    /// <summary>
+    /// Global interface table cookie of the source stream.
+    /// </summary>
+    DWORD m_dwSourceCookie;
+
+    /// <summary>
+    /// Stat of the source, taken when the stream is created.
+    /// </summary>
+    STATSTG m_statstg;
+
+    /// <summary>
+    /// Size of each of the two buffers.
+    /// </summary>
+    ULONG m_cbChunk;
+
+    Chunk m_chunks[2];
+    ULONG m_iRead;      // Chunk the caller reads next
+    ULONG m_iFill;      // Chunk the worker fills next
+
+    /// <summary>
+    /// Position of the caller in the stream.
+    /// </summary>
+    ULONGLONG m_ullPosition;
+
+    /// <summary>
+    /// Position the worker must seek the source to before it reads; ULLONG_MAX if none.
+    /// </summary>
+    ULONGLONG m_ullSeekTo;
+
+    /// <summary>
+    /// Guards the chunks, the positions and the flags below.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Signaled when the worker fills a chunk or stops.
+    /// </summary>
+    CONDITION_VARIABLE m_changed;
+
+    /// <summary>
+    /// TRUE while a worker is queued or running.
+    /// </summary>
+    BOOL m_fReading;
+
+    /// <summary>
+    /// Set by Seek to have the worker stop after the chunk it is reading.
+    /// </summary>
+    BOOL m_fStop;
+
+    /// <summary>
+    /// TRUE once the worker has reached the end of the source or failed.
+    /// </summary>
+    BOOL m_fEnd;
+
+    /// <summary>
+    /// The error the worker failed with, returned by Read once the chunks before it are drained.
+    /// </summary>
+    HRESULT m_hrEnd;
+
+    /// <summary>
+    /// Constructs an empty stream. Use <see cref="Create"/>.
+    /// </summary>
+    BigDriveReadAheadStream();
+
+    /// <summary>
+    /// Frees the chunks and revokes the source from the global interface table.
+    /// </summary>
+    ~BigDriveReadAheadStream();
+
+public:
+
+    /// <summary>
+    /// Wraps a provider stream and starts reading ahead from its current position.
+    /// </summary>
+    /// <param name="pSource">The provider stream. The read-ahead stream holds a reference to it.</param>
+    /// <param name="cbWindow">Maximum number of bytes to hold in memory, split into two chunks.</param>
+    /// <param name="ppStream">Receives the stream.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or the error from the source or the global interface table.</returns>
+    static HRESULT Create(IStream* pSource, ULONG cbWindow, IStream** ppStream);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // IUnknown methods
+
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) override;
+    ULONG __stdcall AddRef() override;
+    ULONG __stdcall Release() override;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // ISequentialStream methods
+
+    /// <summary>
+    /// Copies bytes out of the read-ahead chunks, waiting for the worker when both are empty.
+    /// </summary>
+    HRESULT __stdcall Read(void* pv, ULONG cb, ULONG* pcbRead) override;
+
+    /// <summary>
+    /// The stream is read-only; returns STG_E_ACCESSDENIED.
+    /// </summary>
+    HRESULT __stdcall Write(const void* pv, ULONG cb, ULONG* pcbWritten) override;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // IStream methods
+
+    /// <summary>
+    /// Moves the read position. Seeking to the current position is free; any other seek drops the
+    /// read-ahead chunks.
+    /// </summary>
+    HRESULT __stdcall Seek(LARGE_INTEGER dlibMove, DWORD dwOrigin, ULARGE_INTEGER* plibNewPosition) override;
+
+    HRESULT __stdcall SetSize(ULARGE_INTEGER libNewSize) override;
+
+    /// <summary>
+    /// Reads from this stream and writes to another, one chunk at a time.
+    /// </summary>
+    HRESULT __stdcall CopyTo(IStream* pstm, ULARGE_INTEGER cb, ULARGE_INTEGER* pcbRead, ULARGE_INTEGER* pcbWritten) override;
+
+    HRESULT __stdcall Commit(DWORD grfCommitFlags) override;
+    HRESULT __stdcall Revert() override;
+    HRESULT __stdcall LockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType) override;
+    HRESULT __stdcall UnlockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType) override;
+
+    /// <summary>
+    /// Returns the stat of the source taken when the stream was created, without a name.
+    /// </summary>
+    HRESULT __stdcall Stat(STATSTG* pstatstg, DWORD grfStatFlag) override;
+
+    HRESULT __stdcall Clone(IStream** ppstm) override;
+
+private:
+
+    /// <summary>
+    /// Queues the worker if a chunk is free and it isn't running. Called with the lock held.
+    /// </summary>
+    void StartReading();
+
+    /// <summary>
+    /// Stops the worker and drops the chunks. Called with the lock held.
+    /// </summary>
+    void StopReading();
+
+    /// <summary>
+    /// Thread pool callback that runs <see cref="Fill"/> and drops the worker's reference.
+    /// </summary>
+    static VOID CALLBACK FillCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext);
+
+    /// <summary>
+    /// Fills free chunks from the source until both are full, the source ends, or it is told to stop.
+    /// </summary>
+    void Fill();
+
+    /// <summary>
+    /// Reads a full chunk from the source, calling Read until the chunk is full or the source ends.
+    /// </summary>
+    static HRESULT ReadChunk(IStream* pSource, BYTE* pData, ULONG cbChunk, ULONG& cbRead);
+};
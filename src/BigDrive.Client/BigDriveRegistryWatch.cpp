@@ -0,0 +1,150 @@
+// <copyright file="BigDriveRegistryWatch.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveRegistryWatch.h"
+
+/// <inheritdoc />
+BigDriveRegistryWatch::BigDriveRegistryWatch(HKEY hRoot, LPCWSTR szSubKey, REGSAM samFlags, DWORD dwNotifyFilter, BigDriveRegistryChanged pfnChanged, PVOID pContext)
+    : m_hRoot(hRoot),
+    m_szSubKey(szSubKey),
+    m_samFlags(samFlags),
+    m_dwNotifyFilter(dwNotifyFilter),
+    m_pfnChanged(pfnChanged),
+    m_pContext(pContext),
+    m_hrArmed(HRESULT_FROM_WIN32(ERROR_NOT_READY)),
+    m_hKey(nullptr),
+    m_hChangeEvent(nullptr),
+    m_hWait(nullptr)
+{
+    ::InitOnceInitialize(&m_initOnce);
+}
+
+/// <inheritdoc />
+BigDriveRegistryWatch::~BigDriveRegistryWatch()
+{
+    Stop();
+}
+
+/// <inheritdoc />
+HRESULT BigDriveRegistryWatch::EnsureArmed()
+{
+    ::InitOnceExecuteOnce(&m_initOnce, ArmOnce, this, nullptr);
+
+    return ::InterlockedCompareExchange(&m_hrArmed, 0, 0);
+}
+
+/// <inheritdoc />
+void BigDriveRegistryWatch::Stop()
+{
+    ::InterlockedExchange(&m_hrArmed, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+
+    if (m_hWait)
+    {
+        // Wait for a running callback to finish before the key and event go away
+        ::UnregisterWaitEx(m_hWait, INVALID_HANDLE_VALUE);
+        m_hWait = nullptr;
+    }
+
+    if (m_hChangeEvent)
+    {
+        ::CloseHandle(m_hChangeEvent);
+        m_hChangeEvent = nullptr;
+    }
+
+    if (m_hKey)
+    {
+        ::RegCloseKey(m_hKey);
+        m_hKey = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveRegistryWatch::Arm()
+{
+    HRESULT hr = S_OK;
+    LONG result = ERROR_SUCCESS;
+
+    result = ::RegOpenKeyExW(m_hRoot, m_szSubKey, 0, KEY_NOTIFY | m_samFlags, &m_hKey);
+    if (result != ERROR_SUCCESS)
+    {
+        hr = HRESULT_FROM_WIN32(result);
+        m_hKey = nullptr;
+        goto End;
+    }
+
+    m_hChangeEvent = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (m_hChangeEvent == nullptr)
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        goto End;
+    }
+
+    hr = RegisterNotification();
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // Armed before the wait is registered, so a callback that loses the watch isn't overwritten
+    ::InterlockedExchange(&m_hrArmed, S_OK);
+
+    if (!::RegisterWaitForSingleObject(&m_hWait, m_hChangeEvent, OnKeyChanged, this, INFINITE, WT_EXECUTEDEFAULT))
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        m_hWait = nullptr;
+        goto End;
+    }
+
+End:
+
+    if (FAILED(hr))
+    {
+        Stop();
+        ::InterlockedExchange(&m_hrArmed, hr);
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveRegistryWatch::RegisterNotification()
+{
+    // Thread agnostic, so the notification outlives the thread pool thread that registers it
+    LONG result = ::RegNotifyChangeKeyValue(
+        m_hKey,
+        TRUE,
+        m_dwNotifyFilter | REG_NOTIFY_THREAD_AGNOSTIC,
+        m_hChangeEvent,
+        TRUE);
+
+    return HRESULT_FROM_WIN32(result);
+}
+
+/// <inheritdoc />
+BOOL CALLBACK BigDriveRegistryWatch::ArmOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext)
+{
+    BigDriveRegistryWatch* pThis = static_cast<BigDriveRegistryWatch*>(pParameter);
+
+    pThis->Arm();
+
+    return TRUE;
+}
+
+/// <inheritdoc />
+VOID CALLBACK BigDriveRegistryWatch::OnKeyChanged(PVOID pParameter, BOOLEAN fTimedOut)
+{
+    BigDriveRegistryWatch* pThis = static_cast<BigDriveRegistryWatch*>(pParameter);
+    HRESULT hr = S_OK;
+
+    hr = pThis->RegisterNotification();
+    if (FAILED(hr))
+    {
+        ::InterlockedExchange(&pThis->m_hrArmed, hr);
+    }
+
+    pThis->m_pfnChanged(pThis->m_pContext);
+}
@@ -0,0 +1,137 @@
+// <copyright file="BigDriveRegistryWatch.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+/// <summary>
+/// Called on a thread pool thread when something under a watched key changes.
+/// </summary>
+/// <param name="pContext">The context given to the watch.</param>
+typedef void (*BigDriveRegistryChanged)(PVOID pContext);
+
+/// <summary>
+/// Watches a registry key and calls back whenever a value or subkey under it changes, so a cache
+/// can drop what it read from the key. The watch is armed on the first call to <see cref="EnsureArmed"/>,
+/// not when it is constructed, so an owner that is never used never opens the key.
+///
+/// The notification is re-registered before the callback runs, so a change made while the owner
+/// is invalidating signals again. If it can't be re-registered the watch is no longer armed; an
+/// owner that holds data only while the watch is armed stops holding it rather than going stale.
+/// </summary>
+class BigDriveRegistryWatch
+{
+private:
+
+    /// <summary>
+    /// Root of the watched key, such as HKEY_CURRENT_USER.
+    /// </summary>
+    HKEY m_hRoot;
+
+    /// <summary>
+    /// The watched key, relative to the root.
+    /// </summary>
+    LPCWSTR m_szSubKey;
+
+    /// <summary>
+    /// Extra access flags to open the key with, such as KEY_WOW64_64KEY.
+    /// </summary>
+    REGSAM m_samFlags;
+
+    /// <summary>
+    /// REG_NOTIFY_CHANGE_* flags of the changes to watch for.
+    /// </summary>
+    DWORD m_dwNotifyFilter;
+
+    /// <summary>
+    /// Called when the key changes.
+    /// </summary>
+    BigDriveRegistryChanged m_pfnChanged;
+
+    /// <summary>
+    /// Context passed to the callback.
+    /// </summary>
+    PVOID m_pContext;
+
+    /// <summary>
+    /// Ensures the watch is armed once.
+    /// </summary>
+    INIT_ONCE m_initOnce;
+
+    /// <summary>
+    /// S_OK while a change will be noticed; otherwise, the error that kept the watch from being armed or lost it.
+    /// </summary>
+    volatile LONG m_hrArmed;
+
+    /// <summary>
+    /// The open key.
+    /// </summary>
+    HKEY m_hKey;
+
+    /// <summary>
+    /// Event signaled by RegNotifyChangeKeyValue.
+    /// </summary>
+    HANDLE m_hChangeEvent;
+
+    /// <summary>
+    /// Thread pool wait registered on the change event.
+    /// </summary>
+    HANDLE m_hWait;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveRegistryWatch"/> class. Nothing is opened until it is armed.
+    /// </summary>
+    /// <param name="hRoot">An open key, such as HKEY_CURRENT_USER.</param>
+    /// <param name="szSubKey">The key to watch, relative to hRoot. Must outlive the watch.</param>
+    /// <param name="samFlags">Extra access flags to open the key with, such as KEY_WOW64_64KEY, or 0.</param>
+    /// <param name="dwNotifyFilter">REG_NOTIFY_CHANGE_* flags of the changes to watch for.</param>
+    /// <param name="pfnChanged">Called when the key changes.</param>
+    /// <param name="pContext">Context passed to the callback.</param>
+    BigDriveRegistryWatch(HKEY hRoot, LPCWSTR szSubKey, REGSAM samFlags, DWORD dwNotifyFilter, BigDriveRegistryChanged pfnChanged, PVOID pContext);
+
+    /// <summary>
+    /// Stops the watch.
+    /// </summary>
+    ~BigDriveRegistryWatch();
+
+    /// <summary>
+    /// Arms the watch on the first call; later calls only report whether it is still armed.
+    /// </summary>
+    /// <returns>S_OK if a change to the key will be noticed; otherwise, the error that kept the watch from being armed or lost it.</returns>
+    HRESULT EnsureArmed();
+
+    /// <summary>
+    /// Stops the watch, waiting for a running callback to return. An owner calls this before
+    /// freeing anything the callback touches.
+    /// </summary>
+    void Stop();
+
+private:
+
+    /// <summary>
+    /// Opens the key and registers the wait on its change event.
+    /// </summary>
+    /// <returns>S_OK if the watch is armed; otherwise, an HRESULT error code.</returns>
+    HRESULT Arm();
+
+    /// <summary>
+    /// Asks the registry to signal the change event on the next change under the key.
+    /// </summary>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT RegisterNotification();
+
+    /// <summary>
+    /// InitOnce callback that arms the watch. The InitOnce completes even if arming fails.
+    /// </summary>
+    static BOOL CALLBACK ArmOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext);
+
+    /// <summary>
+    /// Thread pool callback run when the change event is signaled.
+    /// </summary>
+    static VOID CALLBACK OnKeyChanged(PVOID pParameter, BOOLEAN fTimedOut);
+};
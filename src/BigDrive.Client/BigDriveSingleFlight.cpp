@@ -0,0 +1,327 @@
+// <copyright file="BigDriveSingleFlight.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveSingleFlight.h"
+
+// System
+#include <oleauto.h>
+
+// Local
+#include "BigDrivePerformanceCounters.h"
+
+/// <inheritdoc />
+BigDriveSingleFlight::BigDriveSingleFlight()
+    : m_calls(0),
+    m_shared(0)
+{
+    ::ZeroMemory(m_apBuckets, sizeof(m_apBuckets));
+    ::InitializeSRWLock(&m_lock);
+    ::InitializeConditionVariable(&m_callReturned);
+}
+
+/// <inheritdoc />
+BigDriveSingleFlight::~BigDriveSingleFlight()
+{
+    BigDriveSingleFlightNode* pNext = nullptr;
+
+    // Calls still in flight have a caller waiting on them, unless the process is going away
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        while (m_apBuckets[i])
+        {
+            pNext = m_apBuckets[i]->pNext;
+            FreeNode(m_apBuckets[i]);
+            m_apBuckets[i] = pNext;
+        }
+    }
+}
+
+/// <inheritdoc />
+BigDriveSingleFlight& BigDriveSingleFlight::GetInstance()
+{
+    static BigDriveSingleFlight* s_pInstance = new BigDriveSingleFlight();
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveSingleFlight::Call(REFGUID driveGuid, BigDriveSingleFlightOperation operation, LPCWSTR szPath, BigDriveSingleFlightFunction pfnCall, void* pContext, VARIANT* pResult)
+{
+    HRESULT hr = S_OK;
+    BigDriveSingleFlightNode* pNode = nullptr;
+    BigDriveSingleFlightNode* pNew = nullptr;
+    HANDLE hDone = nullptr;
+    DWORD index = 0;
+    size_t cchPath = 0;
+    ULONG hash = 0;
+
+    if (pResult == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    ::VariantInit(pResult);
+
+    if ((szPath == nullptr) || (pfnCall == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    cchPath = ::wcslen(szPath);
+    hash = Hash(driveGuid, operation, szPath, cchPath);
+
+    // Allocated before the lock is taken, and freed unused if the call is already in flight
+    pNew = new BigDriveSingleFlightNode();
+    if (pNew == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    pNew->szPath = new WCHAR[cchPath + 1];
+    if (pNew->szPath == nullptr)
+    {
+        FreeNode(pNew);
+        return E_OUTOFMEMORY;
+    }
+
+    ::CopyMemory(pNew->szPath, szPath, (cchPath + 1) * sizeof(WCHAR));
+    pNew->driveGuid = driveGuid;
+    pNew->operation = operation;
+    pNew->cchPath = cchPath;
+    pNew->hash = hash;
+    pNew->hrCall = S_OK;
+    pNew->refCount = 1;
+    pNew->leaderThreadId = ::GetCurrentThreadId();
+    ::VariantInit(&pNew->result);
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    pNode = Find(driveGuid, operation, szPath, cchPath, hash);
+    if ((pNode != nullptr) && (pNode->leaderThreadId == pNew->leaderThreadId))
+    {
+        ::ReleaseSRWLockExclusive(&m_lock);
+
+        // The call in flight pumped messages and re-entered; waiting on it here would never wake
+        hr = pfnCall(pContext, pResult);
+        if (FAILED(hr))
+        {
+            ::VariantClear(pResult);
+        }
+
+        ::InterlockedIncrement(&m_calls);
+
+        FreeNode(pNew);
+        pNew = nullptr;
+
+        return hr;
+    }
+
+    if (pNode != nullptr)
+    {
+        ::InterlockedIncrement(&pNode->refCount);
+        ::InterlockedIncrement(&m_shared);
+        BigDrivePerformanceCounters::Increment(BigDriveCounter_ProviderCallsShared);
+
+        if (IsSingleThreadedApartment())
+        {
+            if (pNode->hDone == nullptr)
+            {
+                pNode->hDone = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            }
+
+            hDone = pNode->hDone;
+        }
+
+        if (hDone != nullptr)
+        {
+            ::ReleaseSRWLockExclusive(&m_lock);
+
+            // Blocking the apartment would stall every call into it, the one in flight included
+            ::CoWaitForMultipleHandles(0, INFINITE, 1, &hDone, &index);
+
+            ::AcquireSRWLockExclusive(&m_lock);
+        }
+
+        // Also the wait when no event could be created, or the apartment wait failed
+        while (!pNode->fDone)
+        {
+            ::SleepConditionVariableSRW(&m_callReturned, &m_lock, INFINITE, 0);
+        }
+    }
+    else
+    {
+        pNode = pNew;
+        pNew = nullptr;
+
+        pNode->pNext = m_apBuckets[hash & (BucketCount - 1)];
+        m_apBuckets[hash & (BucketCount - 1)] = pNode;
+
+        ::ReleaseSRWLockExclusive(&m_lock);
+
+        // Only this caller writes the result until the call is marked done
+        hr = pfnCall(pContext, &pNode->result);
+
+        ::InterlockedIncrement(&m_calls);
+
+        ::AcquireSRWLockExclusive(&m_lock);
+
+        pNode->hrCall = hr;
+        pNode->fDone = TRUE;
+
+        // Requests made from now on call the provider again
+        Unlink(pNode);
+        ::WakeAllConditionVariable(&m_callReturned);
+
+        if (pNode->hDone)
+        {
+            ::SetEvent(pNode->hDone);
+        }
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    // The result is no longer modified, so it is copied without the lock
+    hr = pNode->hrCall;
+    if (SUCCEEDED(hr))
+    {
+        if (FAILED(::VariantCopy(pResult, &pNode->result)))
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    if (::InterlockedDecrement(&pNode->refCount) == 0)
+    {
+        FreeNode(pNode);
+    }
+
+    pNode = nullptr;
+
+    if (pNew)
+    {
+        FreeNode(pNew);
+        pNew = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveSingleFlight::GetStatistics(LONG& calls, LONG& shared)
+{
+    calls = ::InterlockedCompareExchange(&m_calls, 0, 0);
+    shared = ::InterlockedCompareExchange(&m_shared, 0, 0);
+}
+
+/// <inheritdoc />
+BigDriveSingleFlightNode* BigDriveSingleFlight::Find(REFGUID driveGuid, BigDriveSingleFlightOperation operation, LPCWSTR szPath, size_t cchPath, ULONG hash)
+{
+    BigDriveSingleFlightNode* pNode = nullptr;
+
+    for (pNode = m_apBuckets[hash & (BucketCount - 1)]; pNode != nullptr; pNode = pNode->pNext)
+    {
+        if ((pNode->hash == hash) &&
+            (pNode->operation == operation) &&
+            (pNode->cchPath == cchPath) &&
+            ::IsEqualGUID(pNode->driveGuid, driveGuid) &&
+            ((cchPath == 0) || (::CompareStringOrdinal(pNode->szPath, static_cast<int>(cchPath), szPath, static_cast<int>(cchPath), TRUE) == CSTR_EQUAL)))
+        {
+            return pNode;
+        }
+    }
+
+    return nullptr;
+}
+
+/// <inheritdoc />
+void BigDriveSingleFlight::Unlink(BigDriveSingleFlightNode* pNode)
+{
+    BigDriveSingleFlightNode** ppLink = &m_apBuckets[pNode->hash & (BucketCount - 1)];
+
+    while (*ppLink != nullptr)
+    {
+        if (*ppLink == pNode)
+        {
+            *ppLink = pNode->pNext;
+            break;
+        }
+
+        ppLink = &(*ppLink)->pNext;
+    }
+
+    pNode->pNext = nullptr;
+}
+
+/// <inheritdoc />
+void BigDriveSingleFlight::FreeNode(BigDriveSingleFlightNode* pNode)
+{
+    if (pNode->szPath)
+    {
+        delete[] pNode->szPath;
+        pNode->szPath = nullptr;
+    }
+
+    if (pNode->hDone)
+    {
+        ::CloseHandle(pNode->hDone);
+        pNode->hDone = nullptr;
+    }
+
+    ::VariantClear(&pNode->result);
+
+    delete pNode;
+}
+
+/// <inheritdoc />
+ULONG BigDriveSingleFlight::Hash(REFGUID driveGuid, BigDriveSingleFlightOperation operation, LPCWSTR szPath, size_t cchPath)
+{
+    ULONG hash = 2166136261UL;
+    const BYTE* pGuid = reinterpret_cast<const BYTE*>(&driveGuid);
+    WCHAR ch = 0;
+
+    for (size_t i = 0; i < sizeof(GUID); i++)
+    {
+        hash ^= pGuid[i];
+        hash *= 16777619UL;
+    }
+
+    hash ^= static_cast<ULONG>(operation);
+    hash *= 16777619UL;
+
+    for (size_t i = 0; i < cchPath; i++)
+    {
+        ch = szPath[i];
+        if ((ch >= L'a') && (ch <= L'z'))
+        {
+            ch = static_cast<WCHAR>(ch - L'a' + L'A');
+        }
+        else if (ch >= 0x80)
+        {
+            // The invariant uppercase mapping is the one CompareStringOrdinal ignores case with, so paths
+            // Find treats as equal hash alike
+            ::LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, &szPath[i], 1, &ch, 1, nullptr, nullptr, 0);
+        }
+
+        hash ^= ch;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/// <inheritdoc />
+BOOL BigDriveSingleFlight::IsSingleThreadedApartment()
+{
+    APTTYPE aptType = APTTYPE_MTA;
+    APTTYPEQUALIFIER aptQualifier = APTTYPEQUALIFIER_NONE;
+
+    if (FAILED(::CoGetApartmentType(&aptType, &aptQualifier)))
+    {
+        return FALSE;
+    }
+
+    return (aptType == APTTYPE_STA) || (aptType == APTTYPE_MAINSTA);
+}
\ No newline at end of file
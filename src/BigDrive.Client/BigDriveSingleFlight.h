@@ -0,0 +1,226 @@
+// <copyright file="BigDriveSingleFlight.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <oaidl.h>
+
+/// <summary>
+/// The provider calls that <see cref="BigDriveSingleFlight"/> shares.
+/// </summary>
+enum BigDriveSingleFlightOperation
+{
+    BigDriveSingleFlightOperation_EnumerateFolders = 0,
+    BigDriveSingleFlightOperation_EnumerateFiles = 1,
+    BigDriveSingleFlightOperation_GetFileSize = 2,
+    BigDriveSingleFlightOperation_LastModifiedTime = 3
+};
+
+/// <summary>
+/// Makes a provider call on behalf of every request waiting on it.
+/// </summary>
+/// <param name="pContext">The context passed to <see cref="BigDriveSingleFlight::Call"/> by the request making the call.</param>
+/// <param name="pResult">Receives the result. Initialized to VT_EMPTY.</param>
+/// <returns>S_OK on success; otherwise, an HRESULT error code, which every waiting request receives.</returns>
+typedef HRESULT (*BigDriveSingleFlightFunction)(void* pContext, VARIANT* pResult);
+
+/// <summary>
+/// A provider call in flight and the requests waiting on it. Unlinked from its bucket when the call
+/// returns; the last request out frees it.
+/// </summary>
+struct BigDriveSingleFlightNode
+{
+    /// <summary>
+    /// The drive the call is for.
+    /// </summary>
+    GUID driveGuid;
+
+    /// <summary>
+    /// The call.
+    /// </summary>
+    BigDriveSingleFlightOperation operation;
+
+    /// <summary>
+    /// The path the call is for.
+    /// </summary>
+    LPWSTR szPath;
+
+    /// <summary>
+    /// Number of characters in the path.
+    /// </summary>
+    size_t cchPath;
+
+    /// <summary>
+    /// Hash of the drive, the call and the path.
+    /// </summary>
+    ULONG hash;
+
+    /// <summary>
+    /// The result of the call. Not modified once the call returns.
+    /// </summary>
+    VARIANT result;
+
+    /// <summary>
+    /// The HRESULT of the call.
+    /// </summary>
+    HRESULT hrCall;
+
+    /// <summary>
+    /// TRUE once the call returned.
+    /// </summary>
+    BOOL fDone;
+
+    /// <summary>
+    /// The thread making the call. A request from this thread while the call is in flight was made
+    /// from within the call, while it pumped messages, and would wait on itself.
+    /// </summary>
+    DWORD leaderThreadId;
+
+    /// <summary>
+    /// Manual-reset event set when the call returns. Created by the first request that waits from a
+    /// single-threaded apartment, which must pump while it waits; nullptr until then.
+    /// </summary>
+    HANDLE hDone;
+
+    /// <summary>
+    /// Number of requests holding the node, the one making the call included.
+    /// </summary>
+    volatile LONG refCount;
+
+    /// <summary>
+    /// Next node in the bucket chain.
+    /// </summary>
+    BigDriveSingleFlightNode* pNext;
+};
+
+/// <summary>
+/// Shares a provider call among the identical requests made while it is in flight. When Explorer
+/// opens a folder the view, the navigation pane and the details pane often list or stat the same
+/// path at once; the first request makes the call and the others wait for it and receive a copy of
+/// its result. Requests are identical when they are for the same drive, call and path; paths are
+/// compared without regard to case, as the listing cache does.
+///
+/// Nothing is kept once the call returns, so a request made afterwards calls the provider again;
+/// caching is left to <see cref="BigDriveListingCache"/>. The call is made on the interface pointer
+/// of the request that makes it, so it stays in the apartment that owns the proxy.
+///
+/// A request waiting from a single-threaded apartment waits with CoWaitForMultipleHandles, so the
+/// apartment keeps dispatching calls. A request made on the thread already making the identical
+/// call, when that call pumped messages and re-entered, calls the provider itself.
+/// </summary>
+class BigDriveSingleFlight
+{
+private:
+
+    /// <summary>
+    /// Number of hash buckets. Must be a power of two.
+    /// </summary>
+    static const ULONG BucketCount = 64;
+
+    /// <summary>
+    /// Calls in flight.
+    /// </summary>
+    BigDriveSingleFlightNode* m_apBuckets[BucketCount];
+
+    /// <summary>
+    /// Guards the buckets and the state of every node.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Signaled when a call returns.
+    /// </summary>
+    CONDITION_VARIABLE m_callReturned;
+
+    /// <summary>
+    /// Counter of provider calls made.
+    /// </summary>
+    volatile LONG m_calls;
+
+    /// <summary>
+    /// Counter of requests that shared a call instead of making one.
+    /// </summary>
+    volatile LONG m_shared;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveSingleFlight"/> class.
+    /// </summary>
+    BigDriveSingleFlight();
+
+    /// <summary>
+    /// Frees the calls in flight. No thread may be using the instance.
+    /// </summary>
+    ~BigDriveSingleFlight();
+
+    /// <summary>
+    /// Retrieves the process-wide instance.
+    /// </summary>
+    /// <returns>The single-flight instance.</returns>
+    static BigDriveSingleFlight& GetInstance();
+
+    /// <summary>
+    /// Makes a provider call, or waits for the identical call already in flight.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="operation">The call.</param>
+    /// <param name="szPath">The path, as passed to providers.</param>
+    /// <param name="pfnCall">Makes the call if none is in flight.</param>
+    /// <param name="pContext">Passed to pfnCall.</param>
+    /// <param name="pResult">Receives a copy of the result. The caller must clear it with VariantClear.</param>
+    /// <returns>The HRESULT of the call; E_OUTOFMEMORY if the result could not be copied.</returns>
+    HRESULT Call(REFGUID driveGuid, BigDriveSingleFlightOperation operation, LPCWSTR szPath, BigDriveSingleFlightFunction pfnCall, void* pContext, VARIANT* pResult);
+
+    /// <summary>
+    /// Retrieves the counters.
+    /// </summary>
+    /// <param name="calls">Receives the number of provider calls made.</param>
+    /// <param name="shared">Receives the number of requests that shared a call instead of making one.
+    /// A request is counted as soon as it starts waiting.</param>
+    void GetStatistics(LONG& calls, LONG& shared);
+
+private:
+
+    /// <summary>
+    /// Finds the call in flight for a request. Called with the lock held.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="operation">The call.</param>
+    /// <param name="szPath">The path.</param>
+    /// <param name="cchPath">Number of characters in the path.</param>
+    /// <param name="hash">Hash of the drive, the call and the path.</param>
+    /// <returns>The node, or nullptr if no identical call is in flight.</returns>
+    BigDriveSingleFlightNode* Find(REFGUID driveGuid, BigDriveSingleFlightOperation operation, LPCWSTR szPath, size_t cchPath, ULONG hash);
+
+    /// <summary>
+    /// Removes a node from its bucket. Called with the lock held.
+    /// </summary>
+    /// <param name="pNode">The node.</param>
+    void Unlink(BigDriveSingleFlightNode* pNode);
+
+    /// <summary>
+    /// Frees a node, its path and its result.
+    /// </summary>
+    /// <param name="pNode">The node.</param>
+    static void FreeNode(BigDriveSingleFlightNode* pNode);
+
+    /// <summary>
+    /// Computes the FNV-1a hash of a drive, a call and a path.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="operation">The call.</param>
+    /// <param name="szPath">The path.</param>
+    /// <param name="cchPath">Number of characters in the path.</param>
+    /// <returns>The hash.</returns>
+    static ULONG Hash(REFGUID driveGuid, BigDriveSingleFlightOperation operation, LPCWSTR szPath, size_t cchPath);
+
+    /// <summary>
+    /// Determines whether the calling thread is in a single-threaded apartment.
+    /// </summary>
+    /// <returns>TRUE if the thread is in a single-threaded apartment; otherwise, FALSE.</returns>
+    static BOOL IsSingleThreadedApartment();
+};
@@ -0,0 +1,479 @@
+// <copyright file="BigDriveSortKeyCache.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveSortKeyCache.h"
+
+// System
+#include <string.h>
+#include <wchar.h>
+
+/// <inheritdoc />
+BigDriveSortKeyCache::BigDriveSortKeyCache(BOOL fLogical, ULONG maxEntries, LPCWSTR szWatchKey)
+    : m_dwMapFlags(LCMAP_SORTKEY | NORM_IGNORECASE),
+    m_maxEntries(maxEntries),
+    m_szWatchKey(szWatchKey),
+    m_apBuckets(nullptr),
+    m_apClock(nullptr),
+    m_clockHand(0),
+    m_count(0),
+    m_generation(0),
+    m_watch(HKEY_CURRENT_USER, szWatchKey, 0, REG_NOTIFY_CHANGE_LAST_SET, OnWatchKeyChanged, this),
+    m_hits(0),
+    m_misses(0),
+    m_keysBuilt(0)
+{
+    if (fLogical)
+    {
+        m_dwMapFlags |= SORT_DIGITSASNUMBERS;
+    }
+
+    // Too large to live inside the object; with no buckets every comparison builds its keys
+    if (m_maxEntries > 0)
+    {
+        m_apBuckets = new BigDriveSortKeyNode*[BucketCount]();
+        m_apClock = new BigDriveSortKeyNode*[m_maxEntries]();
+    }
+
+    if (m_apClock == nullptr)
+    {
+        delete[] m_apBuckets;
+        m_apBuckets = nullptr;
+    }
+
+    ::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveSortKeyCache::~BigDriveSortKeyCache()
+{
+    m_watch.Stop();
+
+    ::AcquireSRWLockExclusive(&m_lock);
+    FreeNodes();
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (m_apClock)
+    {
+        delete[] m_apClock;
+        m_apClock = nullptr;
+    }
+
+    if (m_apBuckets)
+    {
+        delete[] m_apBuckets;
+        m_apBuckets = nullptr;
+    }
+}
+
+/// <inheritdoc />
+BigDriveSortKeyCache& BigDriveSortKeyCache::GetInstance()
+{
+    static BigDriveSortKeyCache* s_pInstance = new BigDriveSortKeyCache(!IsLogicalOrderingDisabled(), DefaultMaxEntries,
+        L"Control Panel\\International");
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveSortKeyCache::Compare(LPCWSTR szName1, LPCWSTR szName2, int& result)
+{
+    HRESULT hr = S_OK;
+    size_t cchName1 = 0;
+    size_t cchName2 = 0;
+    ULONG hash1 = 0;
+    ULONG hash2 = 0;
+    ULONG generation = 0;
+    BigDriveSortKeyNode* pNode1 = nullptr;
+    BigDriveSortKeyNode* pNode2 = nullptr;
+    BOOL fHeld1 = FALSE;
+    BOOL fHeld2 = FALSE;
+    BOOL fCompared = FALSE;
+    BYTE* pbKey1 = nullptr;
+    BYTE* pbKey2 = nullptr;
+    ULONG cbKey1 = 0;
+    ULONG cbKey2 = 0;
+
+    result = 0;
+
+    if ((szName1 == nullptr) || (szName2 == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    cchName1 = ::wcslen(szName1);
+    cchName2 = ::wcslen(szName2);
+    hash1 = Hash(szName1, cchName1);
+    hash2 = Hash(szName2, cchName2);
+
+    // Steady state during a sort: both keys held, compared in place under a shared lock
+    ::AcquireSRWLockShared(&m_lock);
+
+    generation = m_generation;
+    pNode1 = Find(szName1, cchName1, hash1);
+    pNode2 = Find(szName2, cchName2, hash2);
+    fHeld1 = (pNode1 != nullptr);
+    fHeld2 = (pNode2 != nullptr);
+    if (fHeld1 && fHeld2)
+    {
+        result = CompareKeys(pNode1->pbKey, pNode1->cbKey, pNode2->pbKey, pNode2->cbKey);
+    }
+
+    ::ReleaseSRWLockShared(&m_lock);
+
+    if (fHeld1 && fHeld2)
+    {
+        ::InterlockedIncrement(&m_hits);
+        return S_OK;
+    }
+
+    ::InterlockedIncrement(&m_misses);
+
+    // Without the watch the keys still serve; only Clear drops them
+    if (m_szWatchKey != nullptr)
+    {
+        m_watch.EnsureArmed();
+    }
+
+    // Built outside the lock, and only for the names not held; two threads missing on the same
+    // name both build, and one stores
+    if (!fHeld1)
+    {
+        hr = CreateKey(szName1, cchName1, &pbKey1, cbKey1);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+    }
+
+    if (!fHeld2)
+    {
+        hr = CreateKey(szName2, cchName2, &pbKey2, cbKey2);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    // A held key may have been replaced or cleared while no lock was held
+    pNode1 = fHeld1 ? Find(szName1, cchName1, hash1) : nullptr;
+    pNode2 = fHeld2 ? Find(szName2, cchName2, hash2) : nullptr;
+    if ((!fHeld1 || (pNode1 != nullptr)) && (!fHeld2 || (pNode2 != nullptr)))
+    {
+        result = CompareKeys(fHeld1 ? pNode1->pbKey : pbKey1, fHeld1 ? pNode1->cbKey : cbKey1,
+            fHeld2 ? pNode2->pbKey : pbKey2, fHeld2 ? pNode2->cbKey : cbKey2);
+        fCompared = TRUE;
+    }
+
+    // Keys built before a Clear may be for the old locale
+    if (generation == m_generation)
+    {
+        Store(szName1, cchName1, hash1, pbKey1, cbKey1);
+        Store(szName2, cchName2, hash2, pbKey2, cbKey2);
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (!fCompared)
+    {
+        // Rare: build the keys that went away and compare without holding them
+        if (pbKey1 == nullptr)
+        {
+            hr = CreateKey(szName1, cchName1, &pbKey1, cbKey1);
+            if (FAILED(hr))
+            {
+                goto End;
+            }
+        }
+
+        if (pbKey2 == nullptr)
+        {
+            hr = CreateKey(szName2, cchName2, &pbKey2, cbKey2);
+            if (FAILED(hr))
+            {
+                goto End;
+            }
+        }
+
+        result = CompareKeys(pbKey1, cbKey1, pbKey2, cbKey2);
+    }
+
+End:
+
+    if (pbKey1)
+    {
+        delete[] pbKey1;
+        pbKey1 = nullptr;
+    }
+
+    if (pbKey2)
+    {
+        delete[] pbKey2;
+        pbKey2 = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveSortKeyCache::Clear()
+{
+    ::AcquireSRWLockExclusive(&m_lock);
+    FreeNodes();
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+void BigDriveSortKeyCache::GetStatistics(LONG& hits, LONG& misses, LONG& keysBuilt, ULONG& count)
+{
+    hits = ::InterlockedCompareExchange(&m_hits, 0, 0);
+    misses = ::InterlockedCompareExchange(&m_misses, 0, 0);
+    keysBuilt = ::InterlockedCompareExchange(&m_keysBuilt, 0, 0);
+
+    ::AcquireSRWLockShared(&m_lock);
+    count = m_count;
+    ::ReleaseSRWLockShared(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveSortKeyNode* BigDriveSortKeyCache::Find(LPCWSTR szName, size_t cchName, ULONG hash)
+{
+    BigDriveSortKeyNode* pNode = nullptr;
+
+    if (m_apBuckets == nullptr)
+    {
+        return nullptr;
+    }
+
+    for (pNode = m_apBuckets[hash & (BucketCount - 1)]; pNode != nullptr; pNode = pNode->pNextInBucket)
+    {
+        // Exact match: names differing only in case get the same key, but are held apart
+        if ((pNode->hash == hash) && (pNode->cchName == cchName) &&
+            (::wmemcmp(pNode->szName, szName, cchName) == 0))
+        {
+            // Readers race to set it, which is harmless; testing first keeps the line clean during a sort
+            if (!pNode->fReferenced)
+            {
+                pNode->fReferenced = TRUE;
+            }
+
+            return pNode;
+        }
+    }
+
+    return nullptr;
+}
+
+/// <inheritdoc />
+void BigDriveSortKeyCache::Store(LPCWSTR szName, size_t cchName, ULONG hash, BYTE*& pbKey, ULONG cbKey)
+{
+    BigDriveSortKeyNode* pNode = nullptr;
+    ULONG bucket = hash & (BucketCount - 1);
+
+    if ((pbKey == nullptr) || (m_apBuckets == nullptr) || (Find(szName, cchName, hash) != nullptr))
+    {
+        return;
+    }
+
+    pNode = new BigDriveSortKeyNode();
+    if (pNode == nullptr)
+    {
+        return;
+    }
+
+    pNode->szName = new WCHAR[cchName + 1];
+    if (pNode->szName == nullptr)
+    {
+        delete pNode;
+        return;
+    }
+
+    ::wmemcpy(pNode->szName, szName, cchName + 1);
+    pNode->cchName = cchName;
+    pNode->hash = hash;
+    pNode->pbKey = pbKey;
+    pNode->cbKey = cbKey;
+    pNode->fReferenced = FALSE;
+    pNode->pNextInBucket = m_apBuckets[bucket];
+    m_apBuckets[bucket] = pNode;
+
+    if (m_count < m_maxEntries)
+    {
+        m_apClock[m_count++] = pNode;
+    }
+    else
+    {
+        // Every name compared since the hand last passed gets one more lap; the sweep ends on the
+        // second pass at the latest
+        while (m_apClock[m_clockHand]->fReferenced)
+        {
+            m_apClock[m_clockHand]->fReferenced = FALSE;
+            m_clockHand = (m_clockHand + 1) % m_maxEntries;
+        }
+
+        Evict(m_apClock[m_clockHand]);
+        m_apClock[m_clockHand] = pNode;
+        m_clockHand = (m_clockHand + 1) % m_maxEntries;
+    }
+
+    // The node owns the key now
+    pbKey = nullptr;
+}
+
+/// <inheritdoc />
+void BigDriveSortKeyCache::Evict(BigDriveSortKeyNode* pNode)
+{
+    BigDriveSortKeyNode** ppLink = &m_apBuckets[pNode->hash & (BucketCount - 1)];
+
+    while (*ppLink != nullptr)
+    {
+        if (*ppLink == pNode)
+        {
+            *ppLink = pNode->pNextInBucket;
+            break;
+        }
+
+        ppLink = &(*ppLink)->pNextInBucket;
+    }
+
+    delete[] pNode->szName;
+    delete[] pNode->pbKey;
+    delete pNode;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveSortKeyCache::CreateKey(LPCWSTR szName, size_t cchName, BYTE** ppbKey, ULONG& cbKey)
+{
+    HRESULT hr = S_OK;
+    int cbRequired = 0;
+    BYTE* pbKey = nullptr;
+
+    *ppbKey = nullptr;
+    cbKey = 0;
+
+    cbRequired = ::LCMapStringEx(LOCALE_NAME_USER_DEFAULT, m_dwMapFlags, szName, static_cast<int>(cchName), nullptr, 0, nullptr, nullptr, 0);
+    if (cbRequired == 0)
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        goto End;
+    }
+
+    pbKey = new BYTE[cbRequired];
+    if (pbKey == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    // With LCMAP_SORTKEY the destination is a byte buffer and its size is in bytes
+    cbRequired = ::LCMapStringEx(LOCALE_NAME_USER_DEFAULT, m_dwMapFlags, szName, static_cast<int>(cchName), reinterpret_cast<LPWSTR>(pbKey), cbRequired, nullptr, nullptr, 0);
+    if (cbRequired == 0)
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        goto End;
+    }
+
+    *ppbKey = pbKey;
+    pbKey = nullptr;
+    cbKey = static_cast<ULONG>(cbRequired);
+
+    ::InterlockedIncrement(&m_keysBuilt);
+
+End:
+
+    if (pbKey)
+    {
+        delete[] pbKey;
+        pbKey = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveSortKeyCache::FreeNodes()
+{
+    BigDriveSortKeyNode* pNode = nullptr;
+
+    if (m_apBuckets == nullptr)
+    {
+        return;
+    }
+
+    for (ULONG i = 0; i < BucketCount; i++)
+    {
+        while (m_apBuckets[i] != nullptr)
+        {
+            pNode = m_apBuckets[i];
+            m_apBuckets[i] = pNode->pNextInBucket;
+            delete[] pNode->szName;
+            delete[] pNode->pbKey;
+            delete pNode;
+        }
+    }
+
+    m_count = 0;
+    m_clockHand = 0;
+    m_generation++;
+}
+
+/// <inheritdoc />
+void BigDriveSortKeyCache::OnWatchKeyChanged(PVOID pContext)
+{
+    // Any change to the regional settings may be a new locale, whose collation the keys no longer match
+    static_cast<BigDriveSortKeyCache*>(pContext)->Clear();
+}
+
+/// <inheritdoc />
+int BigDriveSortKeyCache::CompareKeys(const BYTE* pbKey1, ULONG cbKey1, const BYTE* pbKey2, ULONG cbKey2)
+{
+    int result = ::memcmp(pbKey1, pbKey2, (cbKey1 < cbKey2) ? cbKey1 : cbKey2);
+
+    if (result == 0)
+    {
+        result = (cbKey1 < cbKey2) ? -1 : (cbKey1 > cbKey2) ? 1 : 0;
+    }
+
+    return result;
+}
+
+/// <inheritdoc />
+ULONG BigDriveSortKeyCache::Hash(LPCWSTR szName, size_t cchName)
+{
+    ULONG hash = 2166136261UL;
+
+    for (size_t i = 0; i < cchName; i++)
+    {
+        hash ^= szName[i];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/// <inheritdoc />
+BOOL BigDriveSortKeyCache::IsLogicalOrderingDisabled()
+{
+    LPCWSTR szPolicyKey = L"Software\\Microsoft\\Windows\\CurrentVersion\\Policies\\Explorer";
+    DWORD dwValue = 0;
+    DWORD cbValue = sizeof(dwValue);
+
+    // Machine policy wins over user policy, as it does for Explorer
+    if (::RegGetValueW(HKEY_LOCAL_MACHINE, szPolicyKey, L"NoStrCmpLogical", RRF_RT_REG_DWORD, nullptr, &dwValue, &cbValue) == ERROR_SUCCESS)
+    {
+        return dwValue != 0;
+    }
+
+    cbValue = sizeof(dwValue);
+
+    if (::RegGetValueW(HKEY_CURRENT_USER, szPolicyKey, L"NoStrCmpLogical", RRF_RT_REG_DWORD, nullptr, &dwValue, &cbValue) == ERROR_SUCCESS)
+    {
+        return dwValue != 0;
+    }
+
+    return FALSE;
+}
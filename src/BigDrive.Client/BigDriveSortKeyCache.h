@@ -0,0 +1,242 @@
+// <copyright file="BigDriveSortKeyCache.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveRegistryWatch.h"
+
+/// <summary>
+/// A name's collation sort key and its place in the hash buckets.
+/// </summary>
+struct BigDriveSortKeyNode
+{
+    /// <summary>
+    /// The name, null terminated.
+    /// </summary>
+    LPWSTR szName;
+
+    /// <summary>
+    /// Number of characters in the name, excluding the terminator.
+    /// </summary>
+    size_t cchName;
+
+    /// <summary>
+    /// Hash of the name.
+    /// </summary>
+    ULONG hash;
+
+    /// <summary>
+    /// The sort key returned by LCMapStringEx with LCMAP_SORTKEY.
+    /// </summary>
+    BYTE* pbKey;
+
+    /// <summary>
+    /// Size of the sort key in bytes.
+    /// </summary>
+    ULONG cbKey;
+
+    /// <summary>
+    /// Set when a comparison uses the key, cleared as the clock hand passes; see <see cref="BigDriveSortKeyCache::Store"/>.
+    /// </summary>
+    volatile LONG fReferenced;
+
+    /// <summary>
+    /// Next node in the bucket chain.
+    /// </summary>
+    BigDriveSortKeyNode* pNextInBucket;
+};
+
+/// <summary>
+/// Process-wide cache of the collation sort keys of item names, so the many comparisons of a
+/// sort are memcmp calls on keys built once per name rather than a linguistic comparison each.
+/// Keys ignore case and, with logical ordering, compare runs of digits by value ("File2" before
+/// "File10"), as Explorer does. The cache holds a bounded number of names; past that, a new name
+/// replaces one not compared since the clock hand last passed it.
+///
+/// Keys are built for the user's locale. The cache is cleared when the watched regional settings
+/// key changes, and by <see cref="Clear"/>, which a host with a window calls on WM_SETTINGCHANGE.
+/// </summary>
+class BigDriveSortKeyCache
+{
+private:
+
+    /// <summary>
+    /// Number of hash buckets. Must be a power of two.
+    /// </summary>
+    static const ULONG BucketCount = 65536;
+
+    /// <summary>
+    /// LCMapStringEx flags the keys are built with.
+    /// </summary>
+    DWORD m_dwMapFlags;
+
+    /// <summary>
+    /// Most names held.
+    /// </summary>
+    ULONG m_maxEntries;
+
+    /// <summary>
+    /// Key under HKEY_CURRENT_USER whose changes clear the cache, or nullptr for none.
+    /// </summary>
+    LPCWSTR m_szWatchKey;
+
+    /// <summary>
+    /// Hash buckets, BucketCount of them.
+    /// </summary>
+    BigDriveSortKeyNode** m_apBuckets;
+
+    /// <summary>
+    /// The held nodes in the order the clock hand visits them, m_maxEntries of them.
+    /// </summary>
+    BigDriveSortKeyNode** m_apClock;
+
+    /// <summary>
+    /// Slot of m_apClock the clock hand is at.
+    /// </summary>
+    ULONG m_clockHand;
+
+    /// <summary>
+    /// Number of names held.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// Incremented each time the cache is cleared, so a key built before is not stored after.
+    /// </summary>
+    ULONG m_generation;
+
+    /// <summary>
+    /// Guards the buckets, the clock, the count, and the generation.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Watch on the key, which clears the cache.
+    /// </summary>
+    BigDriveRegistryWatch m_watch;
+
+    /// <summary>
+    /// Counter of comparisons served from held keys.
+    /// </summary>
+    volatile LONG m_hits;
+
+    /// <summary>
+    /// Counter of comparisons that built keys.
+    /// </summary>
+    volatile LONG m_misses;
+
+    /// <summary>
+    /// Counter of keys built.
+    /// </summary>
+    volatile LONG m_keysBuilt;
+
+public:
+
+    /// <summary>
+    /// Most names held by the process-wide instance.
+    /// </summary>
+    static const ULONG DefaultMaxEntries = 262144;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveSortKeyCache"/> class.
+    /// </summary>
+    /// <param name="fLogical">TRUE to compare runs of digits by value; FALSE for plain linguistic order.</param>
+    /// <param name="maxEntries">Most names held.</param>
+    /// <param name="szWatchKey">Key under HKEY_CURRENT_USER whose changes clear the cache, or nullptr to rely on <see cref="Clear"/> only.</param>
+    BigDriveSortKeyCache(BOOL fLogical, ULONG maxEntries = DefaultMaxEntries, LPCWSTR szWatchKey = nullptr);
+
+    /// <summary>
+    /// Stops the registry watch and frees every key.
+    /// </summary>
+    ~BigDriveSortKeyCache();
+
+    /// <summary>
+    /// Retrieves the process-wide instance. It uses logical ordering unless the NoStrCmpLogical
+    /// Explorer policy is set, and watches Control Panel\International for changes to the user's locale.
+    /// </summary>
+    /// <returns>The sort key cache.</returns>
+    static BigDriveSortKeyCache& GetInstance();
+
+    /// <summary>
+    /// Compares two names in collation order. Each name is looked up on its own; only the keys not
+    /// held are built, and then held.
+    /// </summary>
+    /// <param name="szName1">The first name.</param>
+    /// <param name="szName2">The second name.</param>
+    /// <param name="result">Receives a negative value, zero, or a positive value as the first name sorts before, with, or after the second.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; otherwise, an HRESULT error code.</returns>
+    HRESULT Compare(LPCWSTR szName1, LPCWSTR szName2, int& result);
+
+    /// <summary>
+    /// Drops every key, so the next comparisons build them for the current locale. Call on
+    /// WM_SETTINGCHANGE.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Retrieves the cache counters.
+    /// </summary>
+    /// <param name="hits">Receives the number of comparisons served from held keys.</param>
+    /// <param name="misses">Receives the number of comparisons that built keys.</param>
+    /// <param name="keysBuilt">Receives the number of keys built.</param>
+    /// <param name="count">Receives the number of names held.</param>
+    void GetStatistics(LONG& hits, LONG& misses, LONG& keysBuilt, ULONG& count);
+
+private:
+
+    /// <summary>
+    /// Finds a name in the buckets and marks it referenced. The caller must hold the lock.
+    /// </summary>
+    BigDriveSortKeyNode* Find(LPCWSTR szName, size_t cchName, ULONG hash);
+
+    /// <summary>
+    /// Holds a key built outside the lock, unless the name is already held. When the cache is full
+    /// the clock hand sweeps the held names, clearing the referenced bit of each it passes, and the
+    /// first it finds without one is replaced. The caller must hold the lock exclusive.
+    /// </summary>
+    /// <param name="pbKey">The key. Set to nullptr if the cache took ownership of it.</param>
+    void Store(LPCWSTR szName, size_t cchName, ULONG hash, BYTE*& pbKey, ULONG cbKey);
+
+    /// <summary>
+    /// Takes a node out of its bucket chain and frees it. The caller must hold the lock exclusive.
+    /// </summary>
+    void Evict(BigDriveSortKeyNode* pNode);
+
+    /// <summary>
+    /// Builds the sort key of a name.
+    /// </summary>
+    /// <param name="ppbKey">Receives the key, allocated with new[].</param>
+    /// <param name="cbKey">Receives the size of the key in bytes.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT CreateKey(LPCWSTR szName, size_t cchName, BYTE** ppbKey, ULONG& cbKey);
+
+    /// <summary>
+    /// Frees every node and starts a new generation. The caller must hold the lock exclusive.
+    /// </summary>
+    void FreeNodes();
+
+    /// <summary>
+    /// Registry watch callback: clears the cache.
+    /// </summary>
+    static void OnWatchKeyChanged(PVOID pContext);
+
+    /// <summary>
+    /// Compares two sort keys bytewise, as their documentation prescribes.
+    /// </summary>
+    static int CompareKeys(const BYTE* pbKey1, ULONG cbKey1, const BYTE* pbKey2, ULONG cbKey2);
+
+    /// <summary>
+    /// Computes the FNV-1a hash of a name.
+    /// </summary>
+    static ULONG Hash(LPCWSTR szName, size_t cchName);
+
+    /// <summary>
+    /// Determines whether the NoStrCmpLogical Explorer policy turns logical ordering off.
+    /// </summary>
+    static BOOL IsLogicalOrderingDisabled();
+};
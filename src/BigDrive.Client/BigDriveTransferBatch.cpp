@@ -0,0 +1,766 @@
+// <copyright file="BigDriveTransferBatch.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveTransferBatch.h"
+
+// Local
+#include "BigDriveTransferEngine.h"
+
+// System
+#include <objbase.h>
+#include <wchar.h>
+
+/// <summary>
+/// Duplicates a string into CoTaskMem.
+/// </summary>
+static LPWSTR DuplicateString(LPCWSTR sz)
+{
+    size_t cch = ::wcslen(sz) + 1;
+    LPWSTR szCopy = static_cast<LPWSTR>(::CoTaskMemAlloc(cch * sizeof(WCHAR)));
+
+    if (szCopy)
+    {
+        ::wcscpy_s(szCopy, cch, sz);
+    }
+
+    return szCopy;
+}
+
+/// <summary>
+/// Gets the process-wide Global Interface Table, through which workers read the streams.
+/// </summary>
+static HRESULT GetGlobalInterfaceTable(IGlobalInterfaceTable** ppGit)
+{
+    return ::CoCreateInstance(CLSID_StdGlobalInterfaceTable, nullptr, CLSCTX_INPROC_SERVER, IID_IGlobalInterfaceTable, reinterpret_cast<void**>(ppGit));
+}
+
+/// <inheritdoc />
+BigDriveTransferBatch::BigDriveTransferBatch()
+    : m_refCount(1),
+    m_driveGuid(GUID_NULL),
+    m_providerClsid(GUID_NULL),
+    m_szTargetPath(nullptr),
+    m_pfnFactory(nullptr),
+    m_pFactoryContext(nullptr),
+    m_ppItems(nullptr),
+    m_count(0),
+    m_capacity(0),
+    m_next(0),
+    m_pNextQueued(nullptr),
+    m_fSubmitted(FALSE),
+    m_pEngine(nullptr),
+    m_fOpen(FALSE),
+    m_fQueued(FALSE),
+    m_succeeded(0),
+    m_failed(0),
+    m_cancelled(0),
+    m_remaining(0),
+    m_cbDone(0),
+    m_cbTotal(0),
+    m_cbSkipped(0),
+    m_hCancel(nullptr),
+    m_hDone(nullptr)
+{
+}
+
+/// <inheritdoc />
+BigDriveTransferBatch::~BigDriveTransferBatch()
+{
+    for (ULONG i = 0; i < m_count; i++)
+    {
+        FreeItem(m_ppItems[i]);
+    }
+
+    if (m_ppItems)
+    {
+        ::CoTaskMemFree(m_ppItems);
+        m_ppItems = nullptr;
+    }
+
+    if (m_szTargetPath)
+    {
+        ::CoTaskMemFree(m_szTargetPath);
+        m_szTargetPath = nullptr;
+    }
+
+    if (m_hCancel)
+    {
+        ::CloseHandle(m_hCancel);
+        m_hCancel = nullptr;
+    }
+
+    if (m_hDone)
+    {
+        ::CloseHandle(m_hDone);
+        m_hDone = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::Create(REFGUID driveGuid, REFCLSID providerClsid, LPCWSTR szTargetPath, BigDriveFileOperationsFactory pfnFactory, void* pContext, BigDriveTransferBatch** ppBatch)
+{
+    HRESULT hr = S_OK;
+    BigDriveTransferBatch* pBatch = nullptr;
+
+    if (ppBatch == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppBatch = nullptr;
+
+    if ((szTargetPath == nullptr) || (pfnFactory == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    pBatch = new BigDriveTransferBatch();
+    if (pBatch == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pBatch->m_driveGuid = driveGuid;
+    pBatch->m_providerClsid = providerClsid;
+    pBatch->m_pfnFactory = pfnFactory;
+    pBatch->m_pFactoryContext = pContext;
+
+    pBatch->m_szTargetPath = DuplicateString(szTargetPath);
+    if (pBatch->m_szTargetPath == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pBatch->m_hCancel = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    pBatch->m_hDone = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if ((pBatch->m_hCancel == nullptr) || (pBatch->m_hDone == nullptr))
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        goto End;
+    }
+
+    *ppBatch = pBatch;
+    pBatch = nullptr;
+
+End:
+
+    if (pBatch)
+    {
+        pBatch->Release();
+        pBatch = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+ULONG BigDriveTransferBatch::AddRef()
+{
+    return ::InterlockedIncrement(&m_refCount);
+}
+
+/// <inheritdoc />
+ULONG BigDriveTransferBatch::Release()
+{
+    ULONG res = ::InterlockedDecrement(&m_refCount);
+    if (res == 0) delete this;
+    return res;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::AddFile(LPCWSTR szLocalPath)
+{
+    return AddFile(szLocalPath, nullptr);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::AddFile(LPCWSTR szLocalPath, LPCWSTR szTargetPath)
+{
+    HRESULT hr = S_OK;
+    WIN32_FILE_ATTRIBUTE_DATA data = {};
+    ULONGLONG cbSize = 0;
+    BigDriveTransferItem* pItem = nullptr;
+
+    if ((szLocalPath == nullptr) || (*szLocalPath == L'\0'))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (::GetFileAttributesExW(szLocalPath, GetFileExInfoStandard, &data))
+    {
+        cbSize = (static_cast<ULONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    }
+
+    pItem = CreateItem(szLocalPath, szTargetPath, cbSize);
+    if (pItem == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = AppendItems(&pItem, 1);
+    if (SUCCEEDED(hr))
+    {
+        pItem = nullptr;
+    }
+
+End:
+
+    if (pItem)
+    {
+        FreeItem(pItem);
+        pItem = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::AddStream(IStream* pStream, LPCWSTR szName, LPCWSTR szTargetPath, LONGLONG size, LONGLONG lastWriteTime)
+{
+    HRESULT hr = S_OK;
+    BigDriveTransferItem* pItem = nullptr;
+
+    hr = CreateRegisteredStreamItem(pStream, szName, szTargetPath, size, lastWriteTime, &pItem);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = AppendItems(&pItem, 1);
+    if (SUCCEEDED(hr))
+    {
+        pItem = nullptr;
+    }
+
+End:
+
+    if (pItem)
+    {
+        FreeItem(pItem);
+        pItem = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::AddRejected(LPCWSTR szName, HRESULT hrRejected)
+{
+    HRESULT hr = S_OK;
+    BigDriveTransferItem* pItem = nullptr;
+
+    if ((szName == nullptr) || SUCCEEDED(hrRejected))
+    {
+        return E_INVALIDARG;
+    }
+
+    pItem = CreateStreamItem(szName, nullptr, 0);
+    if (pItem == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    // Completed by the engine as it reaches it, without a worker
+    pItem->hrRejected = hrRejected;
+
+    hr = AppendItems(&pItem, 1);
+    if (SUCCEEDED(hr))
+    {
+        pItem = nullptr;
+    }
+
+End:
+
+    if (pItem)
+    {
+        FreeItem(pItem);
+        pItem = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::CreateRegisteredStreamItem(IStream* pStream, LPCWSTR szName, LPCWSTR szTargetPath, LONGLONG size, LONGLONG lastWriteTime, BigDriveTransferItem** ppItem)
+{
+    HRESULT hr = S_OK;
+    IGlobalInterfaceTable* pGit = nullptr;
+    STATSTG statstg = {};
+    LARGE_INTEGER liZero = { 0 };
+    ULARGE_INTEGER uliPosition = { 0 };
+    BigDriveTransferItem* pItem = nullptr;
+
+    *ppItem = nullptr;
+
+    if ((pStream == nullptr) || (szName == nullptr) || (*szName == L'\0') || (::wcschr(szName, L'\\') != nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    // A size the caller doesn't know may still be known to the stream
+    if ((size < 0) && SUCCEEDED(pStream->Stat(&statstg, STATFLAG_NONAME)))
+    {
+        size = static_cast<LONGLONG>(statstg.cbSize.QuadPart);
+    }
+
+    pItem = CreateStreamItem(szName, szTargetPath, (size < 0) ? 0 : static_cast<ULONGLONG>(size));
+    if (pItem == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pItem->fSizeKnown = (size >= 0);
+    pItem->lastWriteTime = lastWriteTime;
+
+    if (SUCCEEDED(pStream->Seek(liZero, STREAM_SEEK_CUR, &uliPosition)))
+    {
+        pItem->ullStreamStart = uliPosition.QuadPart;
+        pItem->fRewindable = TRUE;
+    }
+
+    // The worker runs in its own apartment and needs a proxy of its own
+    hr = GetGlobalInterfaceTable(&pGit);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = pGit->RegisterInterfaceInGlobal(pStream, IID_IStream, &pItem->dwStreamCookie);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    *ppItem = pItem;
+    pItem = nullptr;
+
+End:
+
+    if (pItem)
+    {
+        FreeItem(pItem);
+        pItem = nullptr;
+    }
+
+    if (pGit)
+    {
+        pGit->Release();
+        pGit = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::Seal()
+{
+    if (m_pEngine == nullptr)
+    {
+        return E_UNEXPECTED;
+    }
+
+    return m_pEngine->Seal(this);
+}
+
+/// <inheritdoc />
+void BigDriveTransferBatch::Cancel()
+{
+    ::SetEvent(m_hCancel);
+}
+
+/// <inheritdoc />
+BOOL BigDriveTransferBatch::IsCancelled()
+{
+    return ::WaitForSingleObject(m_hCancel, 0) == WAIT_OBJECT_0;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::Wait(DWORD dwMilliseconds)
+{
+    return (::WaitForSingleObject(m_hDone, dwMilliseconds) == WAIT_OBJECT_0) ? S_OK : S_FALSE;
+}
+
+/// <inheritdoc />
+HANDLE BigDriveTransferBatch::GetDoneEvent()
+{
+    return m_hDone;
+}
+
+/// <inheritdoc />
+void BigDriveTransferBatch::GetProgress(ULONG& succeeded, ULONG& failed, ULONG& cancelled, ULONGLONG& cbDone)
+{
+    succeeded = static_cast<ULONG>(::InterlockedCompareExchange(&m_succeeded, 0, 0));
+    failed = static_cast<ULONG>(::InterlockedCompareExchange(&m_failed, 0, 0));
+    cancelled = static_cast<ULONG>(::InterlockedCompareExchange(&m_cancelled, 0, 0));
+    cbDone = static_cast<ULONGLONG>(::InterlockedCompareExchange64(&m_cbDone, 0, 0));
+}
+
+/// <inheritdoc />
+ULONGLONG BigDriveTransferBatch::GetSkippedSize()
+{
+    return static_cast<ULONGLONG>(::InterlockedCompareExchange64(&m_cbSkipped, 0, 0));
+}
+
+/// <inheritdoc />
+ULONG BigDriveTransferBatch::GetCount()
+{
+    return m_count;
+}
+
+/// <inheritdoc />
+ULONGLONG BigDriveTransferBatch::GetTotalSize()
+{
+    return static_cast<ULONGLONG>(::InterlockedCompareExchange64(&m_cbTotal, 0, 0));
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::GetItem(ULONG index, BigDriveTransferItem& item)
+{
+    if (index >= m_count)
+    {
+        return E_INVALIDARG;
+    }
+
+    item = *m_ppItems[index];
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::CreateRetryBatch(BigDriveTransferBatch** ppRetry)
+{
+    HRESULT hr = S_OK;
+    BigDriveTransferBatch* pRetry = nullptr;
+
+    if (ppRetry == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppRetry = nullptr;
+
+    hr = Create(m_driveGuid, m_providerClsid, m_szTargetPath, m_pfnFactory, m_pFactoryContext, &pRetry);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    for (ULONG i = 0; i < m_count; i++)
+    {
+        if (FAILED(m_ppItems[i]->hr) && (m_ppItems[i]->hr != E_PENDING) && (m_ppItems[i]->hr != HRESULT_FROM_WIN32(ERROR_CANCELLED)) &&
+            SUCCEEDED(m_ppItems[i]->hrRejected))
+        {
+            hr = pRetry->AddRetry(m_ppItems[i]);
+            if (FAILED(hr))
+            {
+                goto End;
+            }
+        }
+    }
+
+    if (pRetry->m_count == 0)
+    {
+        hr = S_FALSE;
+        goto End;
+    }
+
+    hr = S_OK;
+    *ppRetry = pRetry;
+    pRetry = nullptr;
+
+End:
+
+    if (pRetry)
+    {
+        pRetry->Release();
+        pRetry = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+REFGUID BigDriveTransferBatch::GetDriveGuid()
+{
+    return m_driveGuid;
+}
+
+/// <inheritdoc />
+LPCWSTR BigDriveTransferBatch::GetTargetPath()
+{
+    return m_szTargetPath;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::AddRetry(const BigDriveTransferItem* pItem)
+{
+    HRESULT hr = S_OK;
+    IStream* pStream = nullptr;
+    LARGE_INTEGER liStart = { 0 };
+
+    if (pItem->dwStreamCookie == 0)
+    {
+        return AddFile(pItem->szLocalPath, pItem->szTargetPath);
+    }
+
+    // Read once already, so it can only be copied again from where its data starts
+    if (!pItem->fRewindable)
+    {
+        return S_FALSE;
+    }
+
+    hr = GetItemStream(pItem, &pStream);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    liStart.QuadPart = static_cast<LONGLONG>(pItem->ullStreamStart);
+
+    hr = pStream->Seek(liStart, STREAM_SEEK_SET, nullptr);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = AddStream(pStream, pItem->szName, pItem->szTargetPath, pItem->fSizeKnown ? static_cast<LONGLONG>(pItem->cbSize) : -1, pItem->lastWriteTime);
+
+End:
+
+    if (pStream)
+    {
+        pStream->Release();
+        pStream = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::GetItemStream(const BigDriveTransferItem* pItem, IStream** ppStream)
+{
+    HRESULT hr = S_OK;
+    IGlobalInterfaceTable* pGit = nullptr;
+
+    *ppStream = nullptr;
+
+    hr = GetGlobalInterfaceTable(&pGit);
+    if (SUCCEEDED(hr))
+    {
+        hr = pGit->GetInterfaceFromGlobal(pItem->dwStreamCookie, IID_IStream, reinterpret_cast<void**>(ppStream));
+        pGit->Release();
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::AppendItems(BigDriveTransferItem** ppItems, ULONG count)
+{
+    if (m_fSubmitted)
+    {
+        return m_pEngine->Append(this, ppItems, count);
+    }
+
+    return StoreItems(ppItems, count);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferBatch::StoreItems(BigDriveTransferItem** ppItems, ULONG count)
+{
+    ULONG capacity = m_capacity;
+    BigDriveTransferItem** ppGrown = nullptr;
+    ULONGLONG cbSize = 0;
+
+    while (m_count + count > capacity)
+    {
+        capacity = (capacity == 0) ? 16 : capacity * 2;
+    }
+
+    if (capacity > m_capacity)
+    {
+        ppGrown = static_cast<BigDriveTransferItem**>(::CoTaskMemRealloc(m_ppItems, capacity * sizeof(BigDriveTransferItem*)));
+        if (ppGrown == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        m_ppItems = ppGrown;
+        m_capacity = capacity;
+    }
+
+    for (ULONG i = 0; i < count; i++)
+    {
+        m_ppItems[m_count + i] = ppItems[i];
+        cbSize += ppItems[i]->cbSize;
+    }
+
+    ::InterlockedExchangeAdd64(&m_cbTotal, static_cast<LONGLONG>(cbSize));
+
+    // Published last, so a count read without the lock never covers a file not yet stored
+    m_count += count;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+void BigDriveTransferBatch::CompleteItem(BigDriveTransferItem* pItem, HRESULT hr, ULONG attempts)
+{
+    pItem->hr = hr;
+    pItem->attempts = attempts;
+
+    if (SUCCEEDED(hr))
+    {
+        ::InterlockedExchangeAdd64(&m_cbDone, static_cast<LONGLONG>(pItem->cbSize));
+        ::InterlockedIncrement(&m_succeeded);
+    }
+    else if (hr == HRESULT_FROM_WIN32(ERROR_CANCELLED))
+    {
+        ::InterlockedExchangeAdd64(&m_cbSkipped, static_cast<LONGLONG>(pItem->cbSize));
+        ::InterlockedIncrement(&m_cancelled);
+    }
+    else
+    {
+        ::InterlockedExchangeAdd64(&m_cbSkipped, static_cast<LONGLONG>(pItem->cbSize));
+        ::InterlockedIncrement(&m_failed);
+    }
+
+    DecrementRemaining();
+}
+
+/// <inheritdoc />
+void BigDriveTransferBatch::DecrementRemaining()
+{
+    if (::InterlockedDecrement(&m_remaining) == 0)
+    {
+        ::SetEvent(m_hDone);
+    }
+}
+
+/// <inheritdoc />
+BigDriveTransferItem* BigDriveTransferBatch::CreateItem(LPCWSTR szLocalPath, LPCWSTR szTargetPath, ULONGLONG cbSize)
+{
+    BigDriveTransferItem* pItem = nullptr;
+
+    pItem = new BigDriveTransferItem();
+    if (pItem == nullptr)
+    {
+        return nullptr;
+    }
+
+    pItem->szLocalPath = DuplicateString(szLocalPath);
+    if (szTargetPath)
+    {
+        pItem->szTargetPath = DuplicateString(szTargetPath);
+    }
+
+    if ((pItem->szLocalPath == nullptr) || (szTargetPath && (pItem->szTargetPath == nullptr)))
+    {
+        FreeItem(pItem);
+        return nullptr;
+    }
+
+    pItem->fSizeKnown = TRUE;
+    pItem->cbSize = cbSize;
+    pItem->hr = E_PENDING;
+
+    return pItem;
+}
+
+/// <inheritdoc />
+BigDriveTransferItem* BigDriveTransferBatch::CreateStreamItem(LPCWSTR szName, LPCWSTR szTargetPath, ULONGLONG cbSize)
+{
+    BigDriveTransferItem* pItem = nullptr;
+
+    pItem = new BigDriveTransferItem();
+    if (pItem == nullptr)
+    {
+        return nullptr;
+    }
+
+    pItem->szName = DuplicateString(szName);
+    if (szTargetPath)
+    {
+        pItem->szTargetPath = DuplicateString(szTargetPath);
+    }
+
+    if ((pItem->szName == nullptr) || (szTargetPath && (pItem->szTargetPath == nullptr)))
+    {
+        FreeItem(pItem);
+        return nullptr;
+    }
+
+    pItem->cbSize = cbSize;
+    pItem->hr = E_PENDING;
+
+    return pItem;
+}
+
+/// <inheritdoc />
+void BigDriveTransferBatch::FreeItem(BigDriveTransferItem* pItem)
+{
+    if (pItem->szLocalPath)
+    {
+        ::CoTaskMemFree(pItem->szLocalPath);
+        pItem->szLocalPath = nullptr;
+    }
+
+    if (pItem->szName)
+    {
+        ::CoTaskMemFree(pItem->szName);
+        pItem->szName = nullptr;
+    }
+
+    if (pItem->szTargetPath)
+    {
+        ::CoTaskMemFree(pItem->szTargetPath);
+        pItem->szTargetPath = nullptr;
+    }
+
+    if (pItem->dwStreamCookie != 0)
+    {
+        IGlobalInterfaceTable* pGit = nullptr;
+
+        if (SUCCEEDED(GetGlobalInterfaceTable(&pGit)))
+        {
+            pGit->RevokeInterfaceFromGlobal(pItem->dwStreamCookie);
+            pGit->Release();
+        }
+
+        pItem->dwStreamCookie = 0;
+    }
+
+    delete pItem;
+}
+
+/// <inheritdoc />
+LPWSTR BigDriveTransferBatch::CombinePath(LPCWSTR szFolder, LPCWSTR szName)
+{
+    size_t cchFolder = ::wcslen(szFolder);
+    BOOL fSeparator = (cchFolder == 0) || (szFolder[cchFolder - 1] != L'\\');
+    size_t cch = cchFolder + (fSeparator ? 1 : 0) + ::wcslen(szName) + 1;
+    LPWSTR szPath = static_cast<LPWSTR>(::CoTaskMemAlloc(cch * sizeof(WCHAR)));
+
+    if (szPath)
+    {
+        ::wcscpy_s(szPath, cch, szFolder);
+
+        if (fSeparator)
+        {
+            ::wcscat_s(szPath, cch, L"\\");
+        }
+
+        ::wcscat_s(szPath, cch, szName);
+    }
+
+    return szPath;
+}
@@ -0,0 +1,448 @@
+// <copyright file="BigDriveTransferBatch.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <objidl.h>
+
+// Local
+#include "Interfaces/IBigDriveFileOperations.h"
+
+class BigDriveTransferEngine;
+class BigDriveTreeUpload;
+
+/// <summary>
+/// Gets the file operations interface a transfer worker copies through. Called on the worker
+/// thread, once per attempt, so the connection pool hands out a proxy valid in the worker's apartment.
+/// </summary>
+/// <param name="driveGuid">The drive the files are copied to.</param>
+/// <param name="hrLastAttempt">S_OK on the first attempt; on a retry, the error the last attempt failed with, so a dropped provider connection can be re-established.</param>
+/// <param name="pContext">The context passed to <see cref="BigDriveTransferBatch::Create"/>.</param>
+/// <param name="ppFileOperations">Receives the interface. The caller must release it.</param>
+/// <returns>S_OK on success; otherwise, an HRESULT error code, which fails the attempt.</returns>
+typedef HRESULT (*BigDriveFileOperationsFactory)(REFGUID driveGuid, HRESULT hrLastAttempt, void* pContext, IBigDriveFileOperations** ppFileOperations);
+
+/// <summary>
+/// One file of a <see cref="BigDriveTransferBatch"/>.
+/// </summary>
+struct BigDriveTransferItem
+{
+    /// <summary>
+    /// The local path of the file; nullptr for a stream.
+    /// </summary>
+    LPWSTR szLocalPath;
+
+    /// <summary>
+    /// The name a stream is given on the drive; nullptr for a local file, which keeps its own.
+    /// </summary>
+    LPWSTR szName;
+
+    /// <summary>
+    /// The folder the file is copied to, as passed to providers; nullptr for the batch's folder.
+    /// </summary>
+    LPWSTR szTargetPath;
+
+    /// <summary>
+    /// Global Interface Table cookie of a stream, so a worker can read it from its own apartment;
+    /// 0 for a local file.
+    /// </summary>
+    DWORD dwStreamCookie;
+
+    /// <summary>
+    /// Where a stream's data starts, and whether the stream can be rewound there for another
+    /// attempt. A stream that can't be rewound gets one attempt.
+    /// </summary>
+    ULONGLONG ullStreamStart;
+    BOOL fRewindable;
+
+    /// <summary>
+    /// Last write time of a stream's source as a UTC FILETIME, or 0 if unknown.
+    /// </summary>
+    LONGLONG lastWriteTime;
+
+    /// <summary>
+    /// FALSE if the size of a stream isn't known, in which case cbSize is 0.
+    /// </summary>
+    BOOL fSizeKnown;
+
+    /// <summary>
+    /// Size of the file when it was added, for progress.
+    /// </summary>
+    ULONGLONG cbSize;
+
+    /// <summary>
+    /// E_PENDING until the file is done; then S_OK, the error of its last attempt, or
+    /// HRESULT_FROM_WIN32(ERROR_CANCELLED).
+    /// </summary>
+    HRESULT hr;
+
+    /// <summary>
+    /// The error a file failed with before it could be added, such as a dropped name that isn't
+    /// allowed; S_OK for a file to copy. A rejected file is never attempted or retried.
+    /// </summary>
+    HRESULT hrRejected;
+
+    /// <summary>
+    /// Number of times the copy was attempted.
+    /// </summary>
+    ULONG attempts;
+};
+
+/// <summary>
+/// The files of one upload, such as a drop, copied to a folder of one drive by the
+/// <see cref="BigDriveTransferEngine"/>. Each file succeeds or fails on its own: the batch keeps
+/// the outcome of every file, so the caller can report the failures and retry just those.
+///
+/// A file is either a local file or a stream, such as a virtual file dropped from another
+/// application, which providers that can take a stream read without a temp file.
+///
+/// Files are added before the batch is submitted or, if it was submitted open, until it is
+/// sealed, so files can be uploaded while more are still being found. The progress counters can
+/// be read from any thread; the outcome of each file once <see cref="Wait"/> returns S_OK.
+/// </summary>
+class BigDriveTransferBatch
+{
+    friend class BigDriveTransferEngine;
+    friend class BigDriveTreeUpload;
+
+private:
+
+    LONG m_refCount;
+
+    /// <summary>
+    /// The drive the files are copied to.
+    /// </summary>
+    GUID m_driveGuid;
+
+    /// <summary>
+    /// CLSID of the drive's provider; the engine limits concurrent copies per provider.
+    /// </summary>
+    CLSID m_providerClsid;
+
+    /// <summary>
+    /// The folder the files are copied to, as passed to providers.
+    /// </summary>
+    LPWSTR m_szTargetPath;
+
+    /// <summary>
+    /// Gets the file operations interface on the worker thread.
+    /// </summary>
+    BigDriveFileOperationsFactory m_pfnFactory;
+
+    /// <summary>
+    /// Passed to the factory. Must outlive the batch.
+    /// </summary>
+    void* m_pFactoryContext;
+
+    /// <summary>
+    /// The files, each allocated on its own so a worker's file stays put while more are added.
+    /// Once submitted, guarded by the engine lock.
+    /// </summary>
+    BigDriveTransferItem** m_ppItems;
+    volatile ULONG m_count;
+    ULONG m_capacity;
+
+    /// <summary>
+    /// Next file the engine starts. Guarded by the engine lock.
+    /// </summary>
+    ULONG m_next;
+
+    /// <summary>
+    /// Next batch in the engine queue. Guarded by the engine lock.
+    /// </summary>
+    BigDriveTransferBatch* m_pNextQueued;
+
+    /// <summary>
+    /// TRUE once the batch has been submitted; files can no longer be added.
+    /// </summary>
+    BOOL m_fSubmitted;
+
+    /// <summary>
+    /// The engine the batch was submitted to, which files added while open go through.
+    /// </summary>
+    BigDriveTransferEngine* m_pEngine;
+
+    /// <summary>
+    /// TRUE from an open submission until <see cref="Seal"/>. Guarded by the engine lock.
+    /// </summary>
+    BOOL m_fOpen;
+
+    /// <summary>
+    /// TRUE while the batch is in the engine queue. Guarded by the engine lock.
+    /// </summary>
+    BOOL m_fQueued;
+
+    volatile LONG m_succeeded;
+    volatile LONG m_failed;
+    volatile LONG m_cancelled;
+
+    /// <summary>
+    /// Number of files not yet done, plus one while the batch is open. Set by the engine when
+    /// the batch is submitted.
+    /// </summary>
+    volatile LONG m_remaining;
+
+    volatile LONGLONG m_cbDone;
+    volatile LONGLONG m_cbTotal;
+
+    /// <summary>
+    /// Size of the files that failed or were cancelled, which are done without being copied.
+    /// </summary>
+    volatile LONGLONG m_cbSkipped;
+
+    /// <summary>
+    /// Manual reset event signaled by <see cref="Cancel"/>; also wakes workers waiting to retry.
+    /// </summary>
+    HANDLE m_hCancel;
+
+    /// <summary>
+    /// Manual reset event signaled when every file is done.
+    /// </summary>
+    HANDLE m_hDone;
+
+    /// <summary>
+    /// Constructs an empty batch. Use <see cref="Create"/>.
+    /// </summary>
+    BigDriveTransferBatch();
+
+    /// <summary>
+    /// Frees the files and closes the events.
+    /// </summary>
+    ~BigDriveTransferBatch();
+
+public:
+
+    /// <summary>
+    /// Creates an empty batch.
+    /// </summary>
+    /// <param name="driveGuid">The drive the files are copied to.</param>
+    /// <param name="providerClsid">CLSID of the drive's provider.</param>
+    /// <param name="szTargetPath">The folder the files are copied to, as passed to providers.</param>
+    /// <param name="pfnFactory">Gets the file operations interface on the worker thread.</param>
+    /// <param name="pContext">Passed to the factory. Must outlive the batch.</param>
+    /// <param name="ppBatch">Receives the batch. The caller must release it.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or the error from creating the events.</returns>
+    static HRESULT Create(REFGUID driveGuid, REFCLSID providerClsid, LPCWSTR szTargetPath, BigDriveFileOperationsFactory pfnFactory, void* pContext, BigDriveTransferBatch** ppBatch);
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG AddRef();
+
+    /// <summary>
+    /// Decrements the reference count and deletes the batch if it reaches zero.
+    /// </summary>
+    ULONG Release();
+
+    /// <summary>
+    /// Adds a file to copy. The size is taken now, for progress; a file that can't be read is
+    /// still added and fails when it is copied.
+    /// </summary>
+    /// <param name="szLocalPath">The local path of the file.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or E_UNEXPECTED once the batch is submitted and not open.</returns>
+    HRESULT AddFile(LPCWSTR szLocalPath);
+
+    /// <summary>
+    /// Adds a file to copy to a folder other than the batch's, such as a subfolder of a dropped
+    /// folder. The folder must exist by the time the file is copied.
+    /// </summary>
+    /// <param name="szLocalPath">The local path of the file.</param>
+    /// <param name="szTargetPath">The folder the file is copied to, as passed to providers; nullptr for the batch's folder.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or E_UNEXPECTED once the batch is submitted and not open.</returns>
+    HRESULT AddFile(LPCWSTR szLocalPath, LPCWSTR szTargetPath);
+
+    /// <summary>
+    /// Adds data that isn't a local file, such as a virtual file dropped from another application.
+    /// Providers that implement IBigDriveStreamOperations read the stream as it is copied; for the
+    /// others it is written to a temp file first. The stream is registered in the Global Interface
+    /// Table, so it can be added from any apartment.
+    /// </summary>
+    /// <param name="pStream">The data, from its current position to its end.</param>
+    /// <param name="szName">The name of the file on the drive.</param>
+    /// <param name="szTargetPath">The folder the file is copied to, as passed to providers; nullptr for the batch's folder.</param>
+    /// <param name="size">Size of the data, or -1 to ask the stream.</param>
+    /// <param name="lastWriteTime">Last write time of the source as a UTC FILETIME, or 0 if unknown.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; the error from registering the stream; or E_UNEXPECTED once the batch is submitted and not open.</returns>
+    HRESULT AddStream(IStream* pStream, LPCWSTR szName, LPCWSTR szTargetPath, LONGLONG size, LONGLONG lastWriteTime);
+
+    /// <summary>
+    /// Adds a file that failed before it could be copied, such as a dropped virtual file whose name
+    /// isn't allowed or whose contents couldn't be read, so it is counted and reported with the
+    /// other failures of the batch.
+    /// </summary>
+    /// <param name="szName">The name of the file, as the user knows it.</param>
+    /// <param name="hrRejected">The error the file failed with.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or E_UNEXPECTED once the batch is submitted and not open.</returns>
+    HRESULT AddRejected(LPCWSTR szName, HRESULT hrRejected);
+
+    /// <summary>
+    /// Ends an open batch: no more files can be added, and <see cref="Wait"/> returns S_OK once
+    /// the files added so far are done.
+    /// </summary>
+    /// <returns>S_OK on success; S_FALSE if the batch was already sealed; E_UNEXPECTED if it wasn't submitted.</returns>
+    HRESULT Seal();
+
+    /// <summary>
+    /// Cancels the files not yet started. Copies already running finish.
+    /// </summary>
+    void Cancel();
+
+    /// <summary>
+    /// Determines whether the batch has been cancelled.
+    /// </summary>
+    BOOL IsCancelled();
+
+    /// <summary>
+    /// Waits for every file to be done.
+    /// </summary>
+    /// <param name="dwMilliseconds">Milliseconds to wait, or INFINITE.</param>
+    /// <returns>S_OK once every file is done; S_FALSE on timeout.</returns>
+    HRESULT Wait(DWORD dwMilliseconds);
+
+    /// <summary>
+    /// Retrieves the event signaled when every file is done, to wait on along with other handles.
+    /// The batch owns the handle.
+    /// </summary>
+    HANDLE GetDoneEvent();
+
+    /// <summary>
+    /// Retrieves the progress counters.
+    /// </summary>
+    /// <param name="succeeded">Receives the number of files copied.</param>
+    /// <param name="failed">Receives the number of files that failed every attempt.</param>
+    /// <param name="cancelled">Receives the number of files cancelled before they started.</param>
+    /// <param name="cbDone">Receives the size of the files copied.</param>
+    void GetProgress(ULONG& succeeded, ULONG& failed, ULONG& cancelled, ULONGLONG& cbDone);
+
+    /// <summary>
+    /// Retrieves the size of the files that failed or were cancelled. Together with the size
+    /// copied it is how far through the batch the engine is.
+    /// </summary>
+    ULONGLONG GetSkippedSize();
+
+    /// <summary>
+    /// Retrieves the number of files. Grows while the batch is open.
+    /// </summary>
+    ULONG GetCount();
+
+    /// <summary>
+    /// Retrieves the size of all the files. Grows while the batch is open.
+    /// </summary>
+    ULONGLONG GetTotalSize();
+
+    /// <summary>
+    /// Retrieves a file and its outcome. Outcomes are final once <see cref="Wait"/> returns S_OK;
+    /// not to be called while an open batch may still be growing.
+    /// </summary>
+    /// <param name="index">Index of the file, in the order added.</param>
+    /// <param name="item">Receives the file. The path is owned by the batch.</param>
+    /// <returns>S_OK on success; E_INVALIDARG if the index is out of range.</returns>
+    HRESULT GetItem(ULONG index, BigDriveTransferItem& item);
+
+    /// <summary>
+    /// Creates a batch of the files that failed, to the same folders, for the user to retry.
+    /// Cancelled files, rejected files, and streams that can't be rewound, aren't included.
+    /// </summary>
+    /// <param name="ppRetry">Receives the new batch, or nullptr if nothing failed.</param>
+    /// <returns>S_OK on success; S_FALSE if nothing failed; otherwise, an HRESULT error code.</returns>
+    HRESULT CreateRetryBatch(BigDriveTransferBatch** ppRetry);
+
+    /// <summary>
+    /// Retrieves the drive the files are copied to.
+    /// </summary>
+    REFGUID GetDriveGuid();
+
+    /// <summary>
+    /// Retrieves the folder the files are copied to. Owned by the batch.
+    /// </summary>
+    LPCWSTR GetTargetPath();
+
+private:
+
+    /// <summary>
+    /// Adds a failed file of another batch, rewinding a stream to where its data starts.
+    /// </summary>
+    /// <returns>S_OK on success; S_FALSE if the file can't be retried; otherwise, an HRESULT error code.</returns>
+    HRESULT AddRetry(const BigDriveTransferItem* pItem);
+
+    /// <summary>
+    /// Allocates a pending stream and registers the stream in the Global Interface Table.
+    /// </summary>
+    /// <param name="pStream">The data, from its current position to its end.</param>
+    /// <param name="szName">The name of the file on the drive; no backslash.</param>
+    /// <param name="szTargetPath">The folder the file is copied to, or nullptr for the batch's folder.</param>
+    /// <param name="size">Size of the data, or -1 to ask the stream.</param>
+    /// <param name="lastWriteTime">Last write time of the source as a UTC FILETIME, or 0 if unknown.</param>
+    /// <param name="ppItem">Receives the file. Free with <see cref="FreeItem"/>.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or the error from registering the stream.</returns>
+    static HRESULT CreateRegisteredStreamItem(IStream* pStream, LPCWSTR szName, LPCWSTR szTargetPath, LONGLONG size, LONGLONG lastWriteTime, BigDriveTransferItem** ppItem);
+
+    /// <summary>
+    /// Retrieves the stream of a file, for the calling apartment.
+    /// </summary>
+    /// <param name="pItem">A file added with <see cref="AddStream"/>.</param>
+    /// <param name="ppStream">Receives the stream. The caller must release it.</param>
+    /// <returns>S_OK on success; otherwise, the error from the Global Interface Table.</returns>
+    static HRESULT GetItemStream(const BigDriveTransferItem* pItem, IStream** ppStream);
+
+    /// <summary>
+    /// Adds files, directly before the batch is submitted and through the engine while it is open.
+    /// </summary>
+    /// <param name="ppItems">The files, pending. The batch takes all of them on success and none on failure.</param>
+    /// <param name="count">Number of files.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY; or E_UNEXPECTED once the batch is submitted and not open.</returns>
+    HRESULT AppendItems(BigDriveTransferItem** ppItems, ULONG count);
+
+    /// <summary>
+    /// Stores files at the end of the list. Once submitted, called with the engine lock held.
+    /// </summary>
+    /// <returns>S_OK on success; E_OUTOFMEMORY, in which case nothing is stored.</returns>
+    HRESULT StoreItems(BigDriveTransferItem** ppItems, ULONG count);
+
+    /// <summary>
+    /// Records the outcome of a file and signals the done event after the last one.
+    /// Each file is completed exactly once.
+    /// </summary>
+    /// <param name="pItem">The file.</param>
+    /// <param name="hr">S_OK, the error of the last attempt, or HRESULT_FROM_WIN32(ERROR_CANCELLED).</param>
+    /// <param name="attempts">Number of attempts made.</param>
+    void CompleteItem(BigDriveTransferItem* pItem, HRESULT hr, ULONG attempts);
+
+    /// <summary>
+    /// Counts down a file done or the batch sealed, and signals the done event at zero.
+    /// </summary>
+    void DecrementRemaining();
+
+    /// <summary>
+    /// Allocates a pending file.
+    /// </summary>
+    /// <param name="szLocalPath">The local path of the file.</param>
+    /// <param name="szTargetPath">The folder the file is copied to, or nullptr for the batch's folder.</param>
+    /// <param name="cbSize">Size of the file, for progress.</param>
+    /// <returns>The file, or nullptr if out of memory. Free with <see cref="FreeItem"/>.</returns>
+    static BigDriveTransferItem* CreateItem(LPCWSTR szLocalPath, LPCWSTR szTargetPath, ULONGLONG cbSize);
+
+    /// <summary>
+    /// Allocates a pending stream, without its stream; the caller registers it.
+    /// </summary>
+    /// <param name="szName">The name of the file on the drive.</param>
+    /// <param name="szTargetPath">The folder the file is copied to, or nullptr for the batch's folder.</param>
+    /// <param name="cbSize">Size of the data, for progress.</param>
+    /// <returns>The file, or nullptr if out of memory. Free with <see cref="FreeItem"/>.</returns>
+    static BigDriveTransferItem* CreateStreamItem(LPCWSTR szName, LPCWSTR szTargetPath, ULONGLONG cbSize);
+
+    /// <summary>
+    /// Frees a file and its paths, and revokes its stream.
+    /// </summary>
+    static void FreeItem(BigDriveTransferItem* pItem);
+
+    /// <summary>
+    /// Joins a folder and a name into a path in CoTaskMem, adding a backslash between them
+    /// unless the folder already ends with one.
+    /// </summary>
+    /// <returns>The path, or nullptr if out of memory. Free with CoTaskMemFree.</returns>
+    static LPWSTR CombinePath(LPCWSTR szFolder, LPCWSTR szName);
+};
@@ -0,0 +1,710 @@
+// <copyright file="BigDriveTransferEngine.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveTransferEngine.h"
+
+// System
+#include <objbase.h>
+
+/// <inheritdoc />
+BigDriveTransferEngine::BigDriveTransferEngine(ULONG maxWorkers, ULONG defaultProviderLimit, ULONG maxAttempts, ULONG retryDelayMs)
+    : m_maxWorkers((maxWorkers == 0) ? 1 : maxWorkers),
+    m_defaultProviderLimit((defaultProviderLimit == 0) ? 1 : defaultProviderLimit),
+    m_maxAttempts((maxAttempts == 0) ? 1 : maxAttempts),
+    m_retryDelayMs(retryDelayMs),
+    m_activeWorkers(0),
+    m_pFirst(nullptr),
+    m_pLast(nullptr),
+    m_pSlots(nullptr)
+{
+    ::InitializeSRWLock(&m_lock);
+    ::InitializeConditionVariable(&m_idle);
+}
+
+/// <inheritdoc />
+BigDriveTransferEngine::~BigDriveTransferEngine()
+{
+    BigDriveTransferProviderSlot* pSlot = nullptr;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    for (BigDriveTransferBatch* pBatch = m_pFirst; pBatch != nullptr; pBatch = pBatch->m_pNextQueued)
+    {
+        pBatch->Cancel();
+    }
+
+    // Completes the files of the cancelled batches and empties the queue
+    Dispatch();
+
+    while (m_activeWorkers > 0)
+    {
+        ::SleepConditionVariableSRW(&m_idle, &m_lock, INFINITE, 0);
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    while (m_pSlots)
+    {
+        pSlot = m_pSlots;
+        m_pSlots = pSlot->pNext;
+        delete pSlot;
+    }
+}
+
+/// <inheritdoc />
+BigDriveTransferEngine& BigDriveTransferEngine::GetInstance()
+{
+    // Never destroyed, so uploads still running at process exit aren't waited on
+    static BigDriveTransferEngine* s_pInstance = new BigDriveTransferEngine(DefaultMaxWorkers, DefaultProviderLimit, DefaultMaxAttempts, DefaultRetryDelayMs);
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::SetProviderLimit(REFCLSID providerClsid, ULONG limit)
+{
+    HRESULT hr = S_OK;
+    BigDriveTransferProviderSlot* pSlot = nullptr;
+
+    if (limit == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    hr = GetSlot(providerClsid, &pSlot);
+    if (SUCCEEDED(hr))
+    {
+        pSlot->limit = limit;
+
+        // A raised limit may let queued files start
+        Dispatch();
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::Submit(BigDriveTransferBatch* pBatch)
+{
+    return Queue(pBatch, FALSE);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::SubmitOpen(BigDriveTransferBatch* pBatch)
+{
+    return Queue(pBatch, TRUE);
+}
+
+/// <inheritdoc />
+void BigDriveTransferEngine::WaitForIdle()
+{
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    while ((m_activeWorkers > 0) || (m_pFirst != nullptr))
+    {
+        ::SleepConditionVariableSRW(&m_idle, &m_lock, INFINITE, 0);
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::GetSlot(REFCLSID providerClsid, BigDriveTransferProviderSlot** ppSlot)
+{
+    BigDriveTransferProviderSlot* pSlot = nullptr;
+
+    *ppSlot = nullptr;
+
+    for (pSlot = m_pSlots; pSlot != nullptr; pSlot = pSlot->pNext)
+    {
+        if (::IsEqualGUID(pSlot->clsid, providerClsid))
+        {
+            *ppSlot = pSlot;
+            return S_OK;
+        }
+    }
+
+    pSlot = new BigDriveTransferProviderSlot();
+    if (pSlot == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    pSlot->clsid = providerClsid;
+    pSlot->limit = m_defaultProviderLimit;
+    pSlot->active = 0;
+    pSlot->pNext = m_pSlots;
+    m_pSlots = pSlot;
+
+    *ppSlot = pSlot;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::Queue(BigDriveTransferBatch* pBatch, BOOL fOpen)
+{
+    HRESULT hr = S_OK;
+    BigDriveTransferProviderSlot* pSlot = nullptr;
+
+    if (pBatch == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (pBatch->m_fSubmitted)
+    {
+        hr = E_UNEXPECTED;
+        goto End;
+    }
+
+    // Make sure the provider has a slot before anything is queued
+    hr = GetSlot(pBatch->m_providerClsid, &pSlot);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    pBatch->m_fSubmitted = TRUE;
+    pBatch->m_pEngine = this;
+    pBatch->m_fOpen = fOpen;
+    pBatch->m_next = 0;
+
+    // An open batch counts as a file until it is sealed, so it can't be done before then
+    pBatch->m_remaining = static_cast<LONG>(pBatch->m_count) + (fOpen ? 1 : 0);
+
+    if (pBatch->m_remaining == 0)
+    {
+        ::SetEvent(pBatch->m_hDone);
+        goto End;
+    }
+
+    if (pBatch->m_count > 0)
+    {
+        Enqueue(pBatch);
+        Dispatch();
+    }
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveTransferEngine::Enqueue(BigDriveTransferBatch* pBatch)
+{
+    pBatch->AddRef();
+    pBatch->m_pNextQueued = nullptr;
+    pBatch->m_fQueued = TRUE;
+
+    if (m_pLast)
+    {
+        m_pLast->m_pNextQueued = pBatch;
+    }
+    else
+    {
+        m_pFirst = pBatch;
+    }
+
+    m_pLast = pBatch;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::Append(BigDriveTransferBatch* pBatch, BigDriveTransferItem** ppItems, ULONG count)
+{
+    HRESULT hr = S_OK;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (!pBatch->m_fOpen)
+    {
+        hr = E_UNEXPECTED;
+        goto End;
+    }
+
+    hr = pBatch->StoreItems(ppItems, count);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    ::InterlockedExchangeAdd(&pBatch->m_remaining, static_cast<LONG>(count));
+
+    if (!pBatch->m_fQueued)
+    {
+        Enqueue(pBatch);
+    }
+
+    Dispatch();
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::Seal(BigDriveTransferBatch* pBatch)
+{
+    BOOL fOpen = FALSE;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    fOpen = pBatch->m_fOpen;
+    pBatch->m_fOpen = FALSE;
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (!fOpen)
+    {
+        return S_FALSE;
+    }
+
+    // Drops the count the batch held while open; done now if its files are
+    pBatch->DecrementRemaining();
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+void BigDriveTransferEngine::Dispatch()
+{
+    HRESULT hr = S_OK;
+    BigDriveTransferBatch* pPrevious = nullptr;
+    BigDriveTransferBatch* pBatch = m_pFirst;
+    BigDriveTransferBatch* pNext = nullptr;
+    BigDriveTransferProviderSlot* pSlot = nullptr;
+    BigDriveTransferItem* pItem = nullptr;
+
+    // Every batch is visited, even with the workers all busy, so cancelled ones finish promptly
+    while (pBatch != nullptr)
+    {
+        pNext = pBatch->m_pNextQueued;
+
+        if (pBatch->IsCancelled())
+        {
+            while (pBatch->m_next < pBatch->m_count)
+            {
+                pItem = pBatch->m_ppItems[pBatch->m_next++];
+                pBatch->CompleteItem(pItem, FAILED(pItem->hrRejected) ? pItem->hrRejected : HRESULT_FROM_WIN32(ERROR_CANCELLED), 0);
+            }
+        }
+        else if ((m_activeWorkers < m_maxWorkers) && SUCCEEDED(GetSlot(pBatch->m_providerClsid, &pSlot)))
+        {
+            while ((pBatch->m_next < pBatch->m_count) && (m_activeWorkers < m_maxWorkers) && (pSlot->active < pSlot->limit))
+            {
+                // Failed before it was added; nothing to copy
+                pItem = pBatch->m_ppItems[pBatch->m_next];
+                if (FAILED(pItem->hrRejected))
+                {
+                    pBatch->CompleteItem(pItem, pItem->hrRejected, 0);
+                    pBatch->m_next++;
+                    continue;
+                }
+
+                hr = StartJob(pBatch, pItem, pSlot);
+                if (FAILED(hr))
+                {
+                    // Out of thread pool work items or memory; try again when a worker finishes
+                    if (m_activeWorkers > 0)
+                    {
+                        break;
+                    }
+
+                    pBatch->CompleteItem(pBatch->m_ppItems[pBatch->m_next], hr, 0);
+                }
+
+                pBatch->m_next++;
+            }
+        }
+
+        if (pBatch->m_next == pBatch->m_count)
+        {
+            if (pPrevious)
+            {
+                pPrevious->m_pNextQueued = pNext;
+            }
+            else
+            {
+                m_pFirst = pNext;
+            }
+
+            if (m_pLast == pBatch)
+            {
+                m_pLast = pPrevious;
+            }
+
+            pBatch->m_pNextQueued = nullptr;
+            pBatch->m_fQueued = FALSE;
+            pBatch->Release();
+        }
+        else
+        {
+            pPrevious = pBatch;
+        }
+
+        pBatch = pNext;
+    }
+
+    if ((m_activeWorkers == 0) && (m_pFirst == nullptr))
+    {
+        ::WakeAllConditionVariable(&m_idle);
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::StartJob(BigDriveTransferBatch* pBatch, BigDriveTransferItem* pItem, BigDriveTransferProviderSlot* pSlot)
+{
+    HRESULT hr = S_OK;
+    Job* pJob = nullptr;
+
+    pJob = new Job();
+    if (pJob == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    pJob->pEngine = this;
+    pJob->pBatch = pBatch;
+    pJob->pItem = pItem;
+    pJob->pSlot = pSlot;
+
+    pBatch->AddRef();
+    pSlot->active++;
+    m_activeWorkers++;
+
+    if (!::TrySubmitThreadpoolCallback(JobCallback, pJob, nullptr))
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+
+        m_activeWorkers--;
+        pSlot->active--;
+        pBatch->Release();
+        delete pJob;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+VOID CALLBACK BigDriveTransferEngine::JobCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext)
+{
+    Job* pJob = static_cast<Job*>(pContext);
+    BigDriveTransferEngine* pEngine = pJob->pEngine;
+    HRESULT hr = S_OK;
+    ULONG attempts = 0;
+
+    // Copies take as long as the provider does; let the pool add threads for other work
+    ::CallbackMayRunLong(pInstance);
+
+    hr = pEngine->TransferFile(pJob->pBatch, pJob->pItem, attempts);
+    pJob->pBatch->CompleteItem(pJob->pItem, hr, attempts);
+
+    ::AcquireSRWLockExclusive(&pEngine->m_lock);
+
+    pJob->pSlot->active--;
+    pEngine->m_activeWorkers--;
+
+    pEngine->Dispatch();
+
+    // The engine may be destroyed once the lock is released
+    ::ReleaseSRWLockExclusive(&pEngine->m_lock);
+
+    pJob->pBatch->Release();
+    delete pJob;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::TransferFile(BigDriveTransferBatch* pBatch, const BigDriveTransferItem* pItem, ULONG& attempts)
+{
+    HRESULT hr = S_OK;
+    HRESULT hrCoInit = S_OK;
+    IBigDriveFileOperations* pFileOperations = nullptr;
+    LPCWSTR szTargetPath = pItem->szTargetPath ? pItem->szTargetPath : pBatch->m_szTargetPath;
+
+    attempts = 0;
+
+    // The connection pool hands out provider proxies through the Global Interface Table, which needs COM
+    hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    while (attempts < m_maxAttempts)
+    {
+        // Waits out the delay before a retry; stops early on a cancel
+        if (::WaitForSingleObject(pBatch->m_hCancel, m_retryDelayMs * attempts) == WAIT_OBJECT_0)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+            break;
+        }
+
+        attempts++;
+
+        hr = pBatch->m_pfnFactory(pBatch->m_driveGuid, hr, pBatch->m_pFactoryContext, &pFileOperations);
+        if (SUCCEEDED(hr) && (pFileOperations == nullptr))
+        {
+            hr = E_NOINTERFACE;
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            if (pItem->dwStreamCookie != 0)
+            {
+                hr = TransferStream(pBatch, pItem, pFileOperations, szTargetPath);
+            }
+            else
+            {
+                hr = pFileOperations->CopyFileToBigDrive(pBatch->m_driveGuid, pItem->szLocalPath, szTargetPath);
+            }
+        }
+
+        if (pFileOperations)
+        {
+            pFileOperations->Release();
+            pFileOperations = nullptr;
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = S_OK;
+            break;
+        }
+
+        // A stream that can't be rewound may already be partly read
+        if ((pItem->dwStreamCookie != 0) && !pItem->fRewindable)
+        {
+            break;
+        }
+    }
+
+    if (SUCCEEDED(hrCoInit))
+    {
+        ::CoUninitialize();
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::TransferStream(BigDriveTransferBatch* pBatch, const BigDriveTransferItem* pItem, IBigDriveFileOperations* pFileOperations, LPCWSTR szTargetPath)
+{
+    HRESULT hr = S_OK;
+    IStream* pStream = nullptr;
+    IBigDriveStreamOperations* pStreamOperations = nullptr;
+    LPWSTR szPath = nullptr;
+    LARGE_INTEGER liStart = { 0 };
+
+    hr = BigDriveTransferBatch::GetItemStream(pItem, &pStream);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // Every attempt starts from the beginning of the data
+    if (pItem->fRewindable)
+    {
+        liStart.QuadPart = static_cast<LONGLONG>(pItem->ullStreamStart);
+
+        hr = pStream->Seek(liStart, STREAM_SEEK_SET, nullptr);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+    }
+
+    hr = pFileOperations->QueryInterface(IID_IBigDriveStreamOperations, reinterpret_cast<void**>(&pStreamOperations));
+    if (hr == E_NOINTERFACE)
+    {
+        hr = TransferViaTempFile(pBatch, pItem, pStream, pFileOperations, szTargetPath);
+        goto End;
+    }
+
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // A stream has no name of its own, so the provider gets the full path
+    szPath = BigDriveTransferBatch::CombinePath(szTargetPath, pItem->szName);
+    if (szPath == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = pStreamOperations->CopyStreamToBigDrive(pBatch->m_driveGuid, pStream, szPath, pItem->fSizeKnown ? static_cast<LONGLONG>(pItem->cbSize) : -1, pItem->lastWriteTime);
+
+End:
+
+    if (szPath)
+    {
+        ::CoTaskMemFree(szPath);
+        szPath = nullptr;
+    }
+
+    if (pStreamOperations)
+    {
+        pStreamOperations->Release();
+        pStreamOperations = nullptr;
+    }
+
+    if (pStream)
+    {
+        pStream->Release();
+        pStream = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferEngine::TransferViaTempFile(BigDriveTransferBatch* pBatch, const BigDriveTransferItem* pItem, IStream* pStream, IBigDriveFileOperations* pFileOperations, LPCWSTR szTargetPath)
+{
+    HRESULT hr = S_OK;
+    WCHAR szTempPath[MAX_PATH] = {};
+    WCHAR szGuid[40] = {};
+    GUID guid = GUID_NULL;
+    LPWSTR szFolder = nullptr;
+    LPWSTR szFile = nullptr;
+    BOOL fFolderCreated = FALSE;
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    BYTE* pBuffer = nullptr;
+    ULONG cbRead = 0;
+    DWORD cbWritten = 0;
+    FILETIME ftLastWrite = {};
+
+    if (::GetTempPathW(ARRAYSIZE(szTempPath), szTempPath) == 0)
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        goto End;
+    }
+
+    // A folder of its own, so the temp file can carry the file's name; some providers use it
+    hr = ::CoCreateGuid(&guid);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    ::StringFromGUID2(guid, szGuid, ARRAYSIZE(szGuid));
+
+    szFolder = BigDriveTransferBatch::CombinePath(szTempPath, szGuid);
+    if (szFolder == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    if (!::CreateDirectoryW(szFolder, nullptr))
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        goto End;
+    }
+
+    fFolderCreated = TRUE;
+
+    szFile = BigDriveTransferBatch::CombinePath(szFolder, pItem->szName);
+    if (szFile == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hFile = ::CreateFileW(szFile, GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        goto End;
+    }
+
+    pBuffer = new BYTE[TempFileBufferSize];
+    if (pBuffer == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    while (TRUE)
+    {
+        if (pBatch->IsCancelled())
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+            goto End;
+        }
+
+        cbRead = 0;
+        hr = pStream->Read(pBuffer, TempFileBufferSize, &cbRead);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+
+        if (cbRead == 0)
+        {
+            break;
+        }
+
+        if (!::WriteFile(hFile, pBuffer, cbRead, &cbWritten, nullptr))
+        {
+            hr = HRESULT_FROM_WIN32(::GetLastError());
+            goto End;
+        }
+    }
+
+    if (pItem->lastWriteTime != 0)
+    {
+        ftLastWrite.dwLowDateTime = static_cast<DWORD>(pItem->lastWriteTime);
+        ftLastWrite.dwHighDateTime = static_cast<DWORD>(pItem->lastWriteTime >> 32);
+        ::SetFileTime(hFile, nullptr, nullptr, &ftLastWrite);
+    }
+
+    // Closed first, so the provider process can open it
+    ::CloseHandle(hFile);
+    hFile = INVALID_HANDLE_VALUE;
+
+    hr = pFileOperations->CopyFileToBigDrive(pBatch->m_driveGuid, szFile, szTargetPath);
+
+End:
+
+    if (pBuffer)
+    {
+        delete[] pBuffer;
+        pBuffer = nullptr;
+    }
+
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        ::CloseHandle(hFile);
+        hFile = INVALID_HANDLE_VALUE;
+    }
+
+    if (szFile)
+    {
+        ::DeleteFileW(szFile);
+        ::CoTaskMemFree(szFile);
+        szFile = nullptr;
+    }
+
+    if (fFolderCreated)
+    {
+        ::RemoveDirectoryW(szFolder);
+    }
+
+    if (szFolder)
+    {
+        ::CoTaskMemFree(szFolder);
+        szFolder = nullptr;
+    }
+
+    return hr;
+}
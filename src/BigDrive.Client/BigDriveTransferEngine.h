@@ -0,0 +1,261 @@
+// <copyright file="BigDriveTransferEngine.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveTransferBatch.h"
+#include "Interfaces/IBigDriveStreamOperations.h"
+
+/// <summary>
+/// Number of copies running for one provider, and how many it may run at once.
+/// </summary>
+struct BigDriveTransferProviderSlot
+{
+    /// <summary>
+    /// CLSID of the provider.
+    /// </summary>
+    CLSID clsid;
+
+    /// <summary>
+    /// Maximum number of copies run at once.
+    /// </summary>
+    ULONG limit;
+
+    /// <summary>
+    /// Number of copies running.
+    /// </summary>
+    ULONG active;
+
+    /// <summary>
+    /// Next slot in the list.
+    /// </summary>
+    BigDriveTransferProviderSlot* pNext;
+};
+
+/// <summary>
+/// Copies the files of submitted <see cref="BigDriveTransferBatch"/>es to BigDrive in the
+/// background, several at a time. Each file is one thread pool work item; at most the worker
+/// limit run at once across all batches, and at most the provider's limit against any one
+/// provider, so a slow provider can't starve the others and a provider process isn't flooded.
+/// Batches are served in the order submitted.
+///
+/// A failed copy is retried, after a delay that grows with each attempt, until the attempt limit;
+/// the file then fails on its own and the rest of the batch carries on. Cancelling a batch cancels
+/// the files not yet started; copies already running finish, since a provider call can't be
+/// interrupted.
+///
+/// A batch submitted open keeps taking files until it is sealed; each file added starts as soon
+/// as the limits allow, so an upload can begin before all of its files are known.
+/// </summary>
+class BigDriveTransferEngine
+{
+    friend class BigDriveTransferBatch;
+
+public:
+
+    /// <summary>
+    /// Default maximum number of files copied at once across all providers.
+    /// </summary>
+    static const ULONG DefaultMaxWorkers = 8;
+
+    /// <summary>
+    /// Default maximum number of files copied at once to one provider.
+    /// </summary>
+    static const ULONG DefaultProviderLimit = 4;
+
+    /// <summary>
+    /// Default number of times a file is attempted before it fails.
+    /// </summary>
+    static const ULONG DefaultMaxAttempts = 3;
+
+    /// <summary>
+    /// Default delay before the first retry; each later retry waits this much longer.
+    /// </summary>
+    static const ULONG DefaultRetryDelayMs = 1000;
+
+    /// <summary>
+    /// Size of the buffer a stream is written to a temp file through, for providers that can't
+    /// take a stream.
+    /// </summary>
+    static const ULONG TempFileBufferSize = 1024 * 1024;
+
+private:
+
+    /// <summary>
+    /// A file handed to a worker.
+    /// </summary>
+    struct Job
+    {
+        BigDriveTransferEngine* pEngine;
+        BigDriveTransferBatch* pBatch;          // AddRef'd
+        BigDriveTransferItem* pItem;
+        BigDriveTransferProviderSlot* pSlot;
+    };
+
+    ULONG m_maxWorkers;
+    ULONG m_defaultProviderLimit;
+    ULONG m_maxAttempts;
+    ULONG m_retryDelayMs;
+
+    /// <summary>
+    /// Number of files being copied.
+    /// </summary>
+    ULONG m_activeWorkers;
+
+    /// <summary>
+    /// Batches with files not yet started, oldest first. The queue holds a reference to each.
+    /// An open batch leaves the queue when it runs out of files and rejoins it at the back when
+    /// more are added.
+    /// </summary>
+    BigDriveTransferBatch* m_pFirst;
+    BigDriveTransferBatch* m_pLast;
+
+    /// <summary>
+    /// Provider slots, one per provider seen or configured.
+    /// </summary>
+    BigDriveTransferProviderSlot* m_pSlots;
+
+    /// <summary>
+    /// Guards everything above and the queue fields of the batches.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Signaled when the last worker finishes and nothing is queued.
+    /// </summary>
+    CONDITION_VARIABLE m_idle;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveTransferEngine"/> class.
+    /// </summary>
+    /// <param name="maxWorkers">Maximum number of files copied at once across all providers.</param>
+    /// <param name="defaultProviderLimit">Maximum number of files copied at once to a provider without its own limit.</param>
+    /// <param name="maxAttempts">Number of times a file is attempted before it fails.</param>
+    /// <param name="retryDelayMs">Delay before the first retry; each later retry waits this much longer.</param>
+    BigDriveTransferEngine(ULONG maxWorkers, ULONG defaultProviderLimit, ULONG maxAttempts, ULONG retryDelayMs);
+
+    /// <summary>
+    /// Cancels the queued batches and waits for the running copies to finish.
+    /// </summary>
+    ~BigDriveTransferEngine();
+
+    /// <summary>
+    /// Retrieves the process-wide instance.
+    /// </summary>
+    /// <returns>The transfer engine.</returns>
+    static BigDriveTransferEngine& GetInstance();
+
+    /// <summary>
+    /// Sets how many files may be copied at once to a provider.
+    /// </summary>
+    /// <param name="providerClsid">CLSID of the provider.</param>
+    /// <param name="limit">Maximum number of copies at once; at least one.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; or E_OUTOFMEMORY.</returns>
+    HRESULT SetProviderLimit(REFCLSID providerClsid, ULONG limit);
+
+    /// <summary>
+    /// Queues the files of a batch and starts copying as many as the limits allow. Returns
+    /// without waiting; wait on the batch for the outcome.
+    /// </summary>
+    /// <param name="pBatch">The batch. The engine holds a reference until its files are done.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_UNEXPECTED if the batch was already submitted; or E_OUTOFMEMORY.</returns>
+    HRESULT Submit(BigDriveTransferBatch* pBatch);
+
+    /// <summary>
+    /// Submits a batch that files can still be added to, starting the files it has. The batch
+    /// isn't done until <see cref="BigDriveTransferBatch::Seal"/> is called.
+    /// </summary>
+    /// <param name="pBatch">The batch. The engine holds a reference while it has files queued.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_UNEXPECTED if the batch was already submitted; or E_OUTOFMEMORY.</returns>
+    HRESULT SubmitOpen(BigDriveTransferBatch* pBatch);
+
+    /// <summary>
+    /// Waits until no file is queued or being copied.
+    /// </summary>
+    void WaitForIdle();
+
+private:
+
+    /// <summary>
+    /// Finds or adds the slot of a provider. Called with the lock held.
+    /// </summary>
+    HRESULT GetSlot(REFCLSID providerClsid, BigDriveTransferProviderSlot** ppSlot);
+
+    /// <summary>
+    /// Submits a batch, open or not.
+    /// </summary>
+    HRESULT Queue(BigDriveTransferBatch* pBatch, BOOL fOpen);
+
+    /// <summary>
+    /// Puts a batch at the back of the queue and takes a reference to it. Called with the lock held.
+    /// </summary>
+    void Enqueue(BigDriveTransferBatch* pBatch);
+
+    /// <summary>
+    /// Adds files to an open batch and starts them as the limits allow.
+    /// </summary>
+    /// <returns>S_OK on success; E_OUTOFMEMORY; or E_UNEXPECTED if the batch is sealed.</returns>
+    HRESULT Append(BigDriveTransferBatch* pBatch, BigDriveTransferItem** ppItems, ULONG count);
+
+    /// <summary>
+    /// Closes an open batch to more files.
+    /// </summary>
+    /// <returns>S_OK on success; S_FALSE if the batch wasn't open.</returns>
+    HRESULT Seal(BigDriveTransferBatch* pBatch);
+
+    /// <summary>
+    /// Starts as many queued files as the limits allow, completes the files of cancelled batches,
+    /// and drops batches that have no files left to start. Called with the lock held.
+    /// </summary>
+    void Dispatch();
+
+    /// <summary>
+    /// Hands a file to a worker. Called with the lock held.
+    /// </summary>
+    /// <returns>S_OK if the worker was queued; otherwise, an HRESULT error code.</returns>
+    HRESULT StartJob(BigDriveTransferBatch* pBatch, BigDriveTransferItem* pItem, BigDriveTransferProviderSlot* pSlot);
+
+    /// <summary>
+    /// Thread pool callback that copies one file, frees its slots, and dispatches the next.
+    /// </summary>
+    static VOID CALLBACK JobCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext);
+
+    /// <summary>
+    /// Copies one file, retrying until it succeeds, runs out of attempts, or the batch is cancelled.
+    /// </summary>
+    /// <param name="pBatch">The batch.</param>
+    /// <param name="pItem">The file.</param>
+    /// <param name="attempts">Receives the number of attempts made.</param>
+    /// <returns>The outcome of the file.</returns>
+    HRESULT TransferFile(BigDriveTransferBatch* pBatch, const BigDriveTransferItem* pItem, ULONG& attempts);
+
+    /// <summary>
+    /// Makes one attempt at copying a stream: through IBigDriveStreamOperations when the provider
+    /// implements it, and otherwise through a temp file.
+    /// </summary>
+    /// <param name="pBatch">The batch.</param>
+    /// <param name="pItem">The file, added with <see cref="BigDriveTransferBatch::AddStream"/>.</param>
+    /// <param name="pFileOperations">The provider.</param>
+    /// <param name="szTargetPath">The folder the file is copied to.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    static HRESULT TransferStream(BigDriveTransferBatch* pBatch, const BigDriveTransferItem* pItem, IBigDriveFileOperations* pFileOperations, LPCWSTR szTargetPath);
+
+    /// <summary>
+    /// Writes a stream to a temp file with the file's name and copies that, for a provider
+    /// without IBigDriveStreamOperations. The temp file is deleted afterwards.
+    /// </summary>
+    /// <param name="pBatch">The batch.</param>
+    /// <param name="pItem">The file.</param>
+    /// <param name="pStream">Its stream, at the start of its data.</param>
+    /// <param name="pFileOperations">The provider.</param>
+    /// <param name="szTargetPath">The folder the file is copied to.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    static HRESULT TransferViaTempFile(BigDriveTransferBatch* pBatch, const BigDriveTransferItem* pItem, IStream* pStream, IBigDriveFileOperations* pFileOperations, LPCWSTR szTargetPath);
+};
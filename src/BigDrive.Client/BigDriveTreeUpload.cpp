@@ -0,0 +1,917 @@
+// <copyright file="BigDriveTreeUpload.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveTreeUpload.h"
+
+// System
+#include <objbase.h>
+#include <wchar.h>
+
+/// <inheritdoc />
+BigDriveTreeUpload::BigDriveTreeUpload(BigDriveTransferBatch* pBatch, ULONG maxWalkers)
+    : m_refCount(1),
+    m_pBatch(pBatch),
+    m_maxWalkers((maxWalkers == 0) ? 1 : maxWalkers),
+    m_pWalkFirst(nullptr),
+    m_pWalkLast(nullptr),
+    m_walkQueued(0),
+    m_pCreateFirst(nullptr),
+    m_pCreateLast(nullptr),
+    m_activeWalkers(0),
+    m_fCreating(FALSE),
+    m_fStarted(FALSE),
+    m_fSealed(FALSE),
+    m_skippedFolders(0),
+    m_hrSkipped(S_OK)
+{
+    m_pBatch->AddRef();
+
+    ::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveTreeUpload::~BigDriveTreeUpload()
+{
+    Folder* pFolder = nullptr;
+
+    // Once started, every folder is freed by the time the last thread lets go; before that, every
+    // folder added is in the creation queue
+    while (m_pCreateFirst)
+    {
+        pFolder = m_pCreateFirst;
+        m_pCreateFirst = pFolder->pNextCreate;
+        FreeFolder(pFolder);
+    }
+
+    if (m_pBatch)
+    {
+        m_pBatch->Release();
+        m_pBatch = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::Create(BigDriveTransferBatch* pBatch, ULONG maxWalkers, BigDriveTreeUpload** ppUpload)
+{
+    if (ppUpload == nullptr)
+    {
+        return E_POINTER;
+    }
+
+    *ppUpload = nullptr;
+
+    if (pBatch == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    *ppUpload = new BigDriveTreeUpload(pBatch, maxWalkers);
+    if (*ppUpload == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+ULONG BigDriveTreeUpload::AddRef()
+{
+    return ::InterlockedIncrement(&m_refCount);
+}
+
+/// <inheritdoc />
+ULONG BigDriveTreeUpload::Release()
+{
+    ULONG res = ::InterlockedDecrement(&m_refCount);
+    if (res == 0) delete this;
+    return res;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::Add(LPCWSTR szLocalPath)
+{
+    HRESULT hr = S_OK;
+    DWORD dwAttributes = INVALID_FILE_ATTRIBUTES;
+    LPWSTR szParent = nullptr;
+    LPWSTR szName = nullptr;
+    size_t cch = 0;
+    Folder* pFolder = nullptr;
+
+    if ((szLocalPath == nullptr) || (*szLocalPath == L'\0'))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (m_fStarted)
+    {
+        return E_UNEXPECTED;
+    }
+
+    // Anything that isn't a folder goes to the batch, which reports it if it can't be read
+    dwAttributes = ::GetFileAttributesW(szLocalPath);
+    if ((dwAttributes == INVALID_FILE_ATTRIBUTES) || !(dwAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        return m_pBatch->AddFile(szLocalPath);
+    }
+
+    cch = ::wcslen(szLocalPath) + 1;
+    szParent = static_cast<LPWSTR>(::CoTaskMemAlloc(cch * sizeof(WCHAR)));
+    if (szParent == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    ::wcscpy_s(szParent, cch, szLocalPath);
+
+    // Split "C:\Photos\2024\" into "C:\Photos" and "2024"; a drive root has no name to copy to
+    cch = ::wcslen(szParent);
+    while ((cch > 0) && (szParent[cch - 1] == L'\\'))
+    {
+        szParent[--cch] = L'\0';
+    }
+
+    szName = ::wcsrchr(szParent, L'\\');
+    if ((szName == nullptr) || (szName[1] == L'\0'))
+    {
+        hr = E_INVALIDARG;
+        goto End;
+    }
+
+    *szName++ = L'\0';
+
+    pFolder = CreateFolder(szParent, m_pBatch->GetTargetPath(), szName);
+    if (pFolder == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+    QueueFolder(pFolder);
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+End:
+
+    if (szParent)
+    {
+        ::CoTaskMemFree(szParent);
+        szParent = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::AddFolder(LPCWSTR szRelativePath)
+{
+    HRESULT hr = S_OK;
+    Folder* pFolder = nullptr;
+
+    if ((szRelativePath == nullptr) || (*szRelativePath == L'\0'))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (m_fStarted)
+    {
+        return E_UNEXPECTED;
+    }
+
+    ::AcquireSRWLockExclusive(&m_lock);
+    hr = FindOrQueueCreation(szRelativePath, &pFolder);
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::AddStream(IStream* pStream, LPCWSTR szRelativePath, LONGLONG size, LONGLONG lastWriteTime)
+{
+    HRESULT hr = S_OK;
+    LPWSTR szFolder = nullptr;
+    LPWSTR szName = nullptr;
+    size_t cch = 0;
+    Folder* pFolder = nullptr;
+    BigDriveTransferItem* pItem = nullptr;
+
+    if ((pStream == nullptr) || (szRelativePath == nullptr) || (*szRelativePath == L'\0'))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (m_fStarted)
+    {
+        return E_UNEXPECTED;
+    }
+
+    // A file at the top of the drop goes straight to the batch's folder, which exists
+    if (::wcsrchr(szRelativePath, L'\\') == nullptr)
+    {
+        return m_pBatch->AddStream(pStream, szRelativePath, nullptr, size, lastWriteTime);
+    }
+
+    cch = ::wcslen(szRelativePath) + 1;
+    szFolder = static_cast<LPWSTR>(::CoTaskMemAlloc(cch * sizeof(WCHAR)));
+    if (szFolder == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    ::wcscpy_s(szFolder, cch, szRelativePath);
+
+    // Split "Photos\2024\a.jpg" into "Photos\2024" and "a.jpg"
+    szName = ::wcsrchr(szFolder, L'\\');
+    *szName++ = L'\0';
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    hr = FindOrQueueCreation(szFolder, &pFolder);
+    if (SUCCEEDED(hr))
+    {
+        hr = BigDriveTransferBatch::CreateRegisteredStreamItem(pStream, szName, pFolder->szTargetPath, size, lastWriteTime, &pItem);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = HoldFile(pFolder, pItem);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        pItem = nullptr;
+    }
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+End:
+
+    if (pItem)
+    {
+        BigDriveTransferBatch::FreeItem(pItem);
+        pItem = nullptr;
+    }
+
+    if (szFolder)
+    {
+        ::CoTaskMemFree(szFolder);
+        szFolder = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+BigDriveTransferBatch* BigDriveTreeUpload::GetBatch()
+{
+    return m_pBatch;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::Start()
+{
+    HRESULT hr = S_OK;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    if (m_fStarted)
+    {
+        hr = E_UNEXPECTED;
+        goto End;
+    }
+
+    m_fStarted = TRUE;
+
+    Schedule();
+
+End:
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    return hr;
+}
+
+/// <inheritdoc />
+ULONG BigDriveTreeUpload::GetSkippedFolders(HRESULT& hrFirst)
+{
+    ULONG skipped = 0;
+
+    ::AcquireSRWLockShared(&m_lock);
+    skipped = m_skippedFolders;
+    hrFirst = m_hrSkipped;
+    ::ReleaseSRWLockShared(&m_lock);
+
+    return skipped;
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::Schedule()
+{
+    HRESULT hrStart = S_OK;
+    Folder* pFolder = nullptr;
+
+    // A walker per queued folder, up to the limit; the running walkers take queued folders too
+    while ((m_activeWalkers < m_maxWalkers) && (m_activeWalkers < m_walkQueued))
+    {
+        AddRef();
+        m_activeWalkers++;
+
+        if (!::TrySubmitThreadpoolCallback(WalkCallback, this, nullptr))
+        {
+            hrStart = HRESULT_FROM_WIN32(::GetLastError());
+
+            m_activeWalkers--;
+            Release();
+            break;
+        }
+    }
+
+    if ((m_pCreateFirst != nullptr) && !m_fCreating)
+    {
+        AddRef();
+        m_fCreating = TRUE;
+
+        if (!::TrySubmitThreadpoolCallback(CreateCallback, this, nullptr))
+        {
+            m_fCreating = FALSE;
+            Release();
+        }
+    }
+
+    // Without a thread to do the work, give up on it rather than leave the batch open for good:
+    // unlisted folders are skipped, and uncreated ones are left to fail their files' copies
+    if (m_activeWalkers == 0)
+    {
+        while (m_pWalkFirst)
+        {
+            pFolder = m_pWalkFirst;
+            m_pWalkFirst = pFolder->pNextWalk;
+            m_walkQueued--;
+
+            if (m_skippedFolders++ == 0)
+            {
+                m_hrSkipped = hrStart;
+            }
+
+            CompleteListing(pFolder, nullptr);
+        }
+
+        m_pWalkLast = nullptr;
+    }
+
+    if (!m_fCreating)
+    {
+        while (m_pCreateFirst)
+        {
+            pFolder = m_pCreateFirst;
+            m_pCreateFirst = pFolder->pNextCreate;
+
+            CompleteCreation(pFolder);
+        }
+
+        m_pCreateLast = nullptr;
+    }
+
+    if (m_fStarted && !m_fSealed && (m_activeWalkers == 0) && !m_fCreating)
+    {
+        m_fSealed = TRUE;
+        m_pBatch->Seal();
+    }
+}
+
+/// <inheritdoc />
+VOID CALLBACK BigDriveTreeUpload::WalkCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext)
+{
+    BigDriveTreeUpload* pThis = static_cast<BigDriveTreeUpload*>(pContext);
+
+    // A deep folder takes a while to list
+    ::CallbackMayRunLong(pInstance);
+
+    pThis->Walk();
+    pThis->Release();
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::Walk()
+{
+    HRESULT hr = S_OK;
+    Folder* pFolder = nullptr;
+    Folder* pChildren = nullptr;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    while (m_pWalkFirst)
+    {
+        pFolder = m_pWalkFirst;
+        m_pWalkFirst = pFolder->pNextWalk;
+        if (m_pWalkFirst == nullptr)
+        {
+            m_pWalkLast = nullptr;
+        }
+
+        m_walkQueued--;
+
+        ::ReleaseSRWLockExclusive(&m_lock);
+
+        pChildren = nullptr;
+        hr = ListFolder(pFolder, &pChildren);
+
+        ::AcquireSRWLockExclusive(&m_lock);
+
+        if (FAILED(hr) && (hr != HRESULT_FROM_WIN32(ERROR_CANCELLED)))
+        {
+            if (m_skippedFolders++ == 0)
+            {
+                m_hrSkipped = hr;
+            }
+        }
+
+        // What was listed before a failure is still uploaded
+        CompleteListing(pFolder, pChildren);
+
+        Schedule();
+    }
+
+    m_activeWalkers--;
+
+    Schedule();
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::ListFolder(Folder* pFolder, Folder** ppChildren)
+{
+    HRESULT hr = S_OK;
+    LPWSTR szPattern = nullptr;
+    LPWSTR szPath = nullptr;
+    HANDLE hFind = INVALID_HANDLE_VALUE;
+    WIN32_FIND_DATAW data = {};
+    Folder* pChild = nullptr;
+    Folder* pLastChild = nullptr;
+    BigDriveTransferItem* pItem = nullptr;
+    DWORD dwError = ERROR_SUCCESS;
+
+    *ppChildren = nullptr;
+
+    if (m_pBatch->IsCancelled())
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+        goto End;
+    }
+
+    szPattern = BigDriveTransferBatch::CombinePath(pFolder->szLocalPath, L"*");
+    if (szPattern == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    // Skipping the short names and fetching in large blocks keeps a folder of thousands of files cheap
+    hFind = ::FindFirstFileExW(szPattern, FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        dwError = ::GetLastError();
+        hr = (dwError == ERROR_FILE_NOT_FOUND) ? S_OK : HRESULT_FROM_WIN32(dwError);
+        goto End;
+    }
+
+    do
+    {
+        if ((::wcscmp(data.cFileName, L".") == 0) || (::wcscmp(data.cFileName, L"..") == 0))
+        {
+            continue;
+        }
+
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+            {
+                continue;
+            }
+
+            pChild = CreateFolder(pFolder->szLocalPath, pFolder->szTargetPath, data.cFileName);
+            if (pChild == nullptr)
+            {
+                hr = E_OUTOFMEMORY;
+                goto End;
+            }
+
+            if (pLastChild)
+            {
+                pLastChild->pNextWalk = pChild;
+            }
+            else
+            {
+                *ppChildren = pChild;
+            }
+
+            pLastChild = pChild;
+            pChild = nullptr;
+
+            continue;
+        }
+
+        szPath = BigDriveTransferBatch::CombinePath(pFolder->szLocalPath, data.cFileName);
+        if (szPath == nullptr)
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        // The size comes with the listing, so the batch doesn't have to ask for it again
+        pItem = BigDriveTransferBatch::CreateItem(szPath, pFolder->szTargetPath, (static_cast<ULONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+        if (pItem == nullptr)
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        hr = HoldFile(pFolder, pItem);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+
+        pItem = nullptr;
+
+        ::CoTaskMemFree(szPath);
+        szPath = nullptr;
+    }
+    while (::FindNextFileW(hFind, &data));
+
+    dwError = ::GetLastError();
+    if (dwError != ERROR_NO_MORE_FILES)
+    {
+        hr = HRESULT_FROM_WIN32(dwError);
+    }
+
+End:
+
+    if (pItem)
+    {
+        BigDriveTransferBatch::FreeItem(pItem);
+        pItem = nullptr;
+    }
+
+    if (szPath)
+    {
+        ::CoTaskMemFree(szPath);
+        szPath = nullptr;
+    }
+
+    if (hFind != INVALID_HANDLE_VALUE)
+    {
+        ::FindClose(hFind);
+        hFind = INVALID_HANDLE_VALUE;
+    }
+
+    if (szPattern)
+    {
+        ::CoTaskMemFree(szPattern);
+        szPattern = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+VOID CALLBACK BigDriveTreeUpload::CreateCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext)
+{
+    BigDriveTreeUpload* pThis = static_cast<BigDriveTreeUpload*>(pContext);
+
+    // Each folder is a call to the provider
+    ::CallbackMayRunLong(pInstance);
+
+    pThis->CreateFolders();
+    pThis->Release();
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::CreateFolders()
+{
+    HRESULT hr = S_OK;
+    HRESULT hrCoInit = S_OK;
+    HRESULT hrLastPass = S_OK;
+    HRESULT hrPreviousPass = S_OK;
+    IBigDriveFileOperations* pFileOperations = nullptr;
+    Folder* pPass = nullptr;
+    Folder* pFolder = nullptr;
+
+    // The connection pool hands out provider proxies through the Global Interface Table, which needs COM
+    hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    while (m_pCreateFirst)
+    {
+        // Takes every folder found so far in one pass, through one connection
+        pPass = m_pCreateFirst;
+        m_pCreateFirst = nullptr;
+        m_pCreateLast = nullptr;
+
+        ::ReleaseSRWLockExclusive(&m_lock);
+
+        // Lets the factory reconnect if the last pass lost the provider
+        hrPreviousPass = hrLastPass;
+        hrLastPass = S_OK;
+
+        if (!m_pBatch->IsCancelled())
+        {
+            hr = m_pBatch->m_pfnFactory(m_pBatch->m_driveGuid, hrPreviousPass, m_pBatch->m_pFactoryContext, &pFileOperations);
+            if (FAILED(hr))
+            {
+                hrLastPass = hr;
+            }
+        }
+
+        while (pPass)
+        {
+            pFolder = pPass;
+            pPass = pFolder->pNextCreate;
+
+            // A folder that couldn't be created fails its files' copies, which are reported with the rest
+            if (pFileOperations && !m_pBatch->IsCancelled())
+            {
+                hr = pFileOperations->CreateDirectory(m_pBatch->m_driveGuid, pFolder->szTargetPath);
+                if (FAILED(hr))
+                {
+                    hrLastPass = hr;
+                }
+            }
+
+            ::AcquireSRWLockExclusive(&m_lock);
+            CompleteCreation(pFolder);
+            ::ReleaseSRWLockExclusive(&m_lock);
+        }
+
+        if (pFileOperations)
+        {
+            pFileOperations->Release();
+            pFileOperations = nullptr;
+        }
+
+        ::AcquireSRWLockExclusive(&m_lock);
+    }
+
+    m_fCreating = FALSE;
+
+    Schedule();
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    if (SUCCEEDED(hrCoInit))
+    {
+        ::CoUninitialize();
+    }
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::QueueFolder(Folder* pFolder)
+{
+    pFolder->pNextWalk = nullptr;
+
+    if (m_pWalkLast)
+    {
+        m_pWalkLast->pNextWalk = pFolder;
+    }
+    else
+    {
+        m_pWalkFirst = pFolder;
+    }
+
+    m_pWalkLast = pFolder;
+    m_walkQueued++;
+
+    QueueCreation(pFolder);
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::QueueCreation(Folder* pFolder)
+{
+    pFolder->pNextCreate = nullptr;
+
+    if (m_pCreateLast)
+    {
+        m_pCreateLast->pNextCreate = pFolder;
+    }
+    else
+    {
+        m_pCreateFirst = pFolder;
+    }
+
+    m_pCreateLast = pFolder;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::FindOrQueueCreation(LPCWSTR szRelativePath, Folder** ppFolder)
+{
+    HRESULT hr = S_OK;
+    LPWSTR szPath = nullptr;
+    LPWSTR szSegment = nullptr;
+    LPWSTR szNext = nullptr;
+    LPCWSTR szParentTargetPath = m_pBatch->GetTargetPath();
+    size_t cch = ::wcslen(szRelativePath) + 1;
+    Folder* pFolder = nullptr;
+    Folder* pExisting = nullptr;
+
+    *ppFolder = nullptr;
+
+    szPath = static_cast<LPWSTR>(::CoTaskMemAlloc(cch * sizeof(WCHAR)));
+    if (szPath == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    ::wcscpy_s(szPath, cch, szRelativePath);
+
+    // One folder per segment, parents first, so each is created after its parent
+    for (szSegment = szPath; szSegment != nullptr; szSegment = szNext)
+    {
+        szNext = ::wcschr(szSegment, L'\\');
+        if (szNext)
+        {
+            *szNext++ = L'\0';
+        }
+
+        if (*szSegment == L'\0')
+        {
+            hr = E_INVALIDARG;
+            goto End;
+        }
+
+        pFolder = CreateFolder(nullptr, szParentTargetPath, szSegment);
+        if (pFolder == nullptr)
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        // Nothing has been created before the upload starts, so every folder added is still queued
+        for (pExisting = m_pCreateFirst; pExisting != nullptr; pExisting = pExisting->pNextCreate)
+        {
+            if (::CompareStringOrdinal(pExisting->szTargetPath, -1, pFolder->szTargetPath, -1, TRUE) == CSTR_EQUAL)
+            {
+                break;
+            }
+        }
+
+        if (pExisting)
+        {
+            FreeFolder(pFolder);
+            pFolder = pExisting;
+        }
+        else
+        {
+            // Only created; there is nothing local to list
+            pFolder->fListed = TRUE;
+            QueueCreation(pFolder);
+        }
+
+        szParentTargetPath = pFolder->szTargetPath;
+    }
+
+    *ppFolder = pFolder;
+
+End:
+
+    if (szPath)
+    {
+        ::CoTaskMemFree(szPath);
+        szPath = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTreeUpload::HoldFile(Folder* pFolder, BigDriveTransferItem* pItem)
+{
+    BigDriveTransferItem** ppFiles = nullptr;
+    ULONG capacity = 0;
+
+    if (pFolder->fileCount == pFolder->fileCapacity)
+    {
+        capacity = (pFolder->fileCapacity == 0) ? 16 : pFolder->fileCapacity * 2;
+
+        ppFiles = static_cast<BigDriveTransferItem**>(::CoTaskMemRealloc(pFolder->ppFiles, capacity * sizeof(BigDriveTransferItem*)));
+        if (ppFiles == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        pFolder->ppFiles = ppFiles;
+        pFolder->fileCapacity = capacity;
+    }
+
+    pFolder->ppFiles[pFolder->fileCount++] = pItem;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::CompleteListing(Folder* pFolder, Folder* pChildren)
+{
+    Folder* pNext = nullptr;
+
+    // Queued after the folder itself, so each subfolder is created after its parent
+    while (pChildren)
+    {
+        pNext = pChildren->pNextWalk;
+        QueueFolder(pChildren);
+        pChildren = pNext;
+    }
+
+    pFolder->fListed = TRUE;
+
+    if (pFolder->fCreated)
+    {
+        Flush(pFolder);
+    }
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::CompleteCreation(Folder* pFolder)
+{
+    pFolder->fCreated = TRUE;
+
+    if (pFolder->fListed)
+    {
+        Flush(pFolder);
+    }
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::Flush(Folder* pFolder)
+{
+    // The whole folder joins the batch under one engine lock; on failure the files are dropped
+    if ((pFolder->fileCount > 0) && SUCCEEDED(m_pBatch->AppendItems(pFolder->ppFiles, pFolder->fileCount)))
+    {
+        pFolder->fileCount = 0;
+    }
+
+    FreeFolder(pFolder);
+}
+
+/// <inheritdoc />
+BigDriveTreeUpload::Folder* BigDriveTreeUpload::CreateFolder(LPCWSTR szParentLocalPath, LPCWSTR szParentTargetPath, LPCWSTR szName)
+{
+    Folder* pFolder = nullptr;
+
+    pFolder = new Folder();
+    if (pFolder == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (szParentLocalPath)
+    {
+        pFolder->szLocalPath = BigDriveTransferBatch::CombinePath(szParentLocalPath, szName);
+    }
+
+    pFolder->szTargetPath = BigDriveTransferBatch::CombinePath(szParentTargetPath, szName);
+
+    if ((szParentLocalPath && (pFolder->szLocalPath == nullptr)) || (pFolder->szTargetPath == nullptr))
+    {
+        FreeFolder(pFolder);
+        return nullptr;
+    }
+
+    return pFolder;
+}
+
+/// <inheritdoc />
+void BigDriveTreeUpload::FreeFolder(Folder* pFolder)
+{
+    for (ULONG i = 0; i < pFolder->fileCount; i++)
+    {
+        BigDriveTransferBatch::FreeItem(pFolder->ppFiles[i]);
+    }
+
+    if (pFolder->ppFiles)
+    {
+        ::CoTaskMemFree(pFolder->ppFiles);
+        pFolder->ppFiles = nullptr;
+    }
+
+    if (pFolder->szLocalPath)
+    {
+        ::CoTaskMemFree(pFolder->szLocalPath);
+        pFolder->szLocalPath = nullptr;
+    }
+
+    if (pFolder->szTargetPath)
+    {
+        ::CoTaskMemFree(pFolder->szTargetPath);
+        pFolder->szTargetPath = nullptr;
+    }
+
+    delete pFolder;
+}
@@ -0,0 +1,271 @@
+// <copyright file="BigDriveTreeUpload.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+
+// Local
+#include "BigDriveTransferBatch.h"
+
+/// <summary>
+/// Feeds the dropped files and folders of one upload into a <see cref="BigDriveTransferBatch"/>.
+/// Files go straight into the batch. Folders are walked on thread pool threads, several folders
+/// at a time, while one creator makes the folders found so far on the drive in a single pass
+/// through one provider connection; the files of a folder join the batch as soon as the folder
+/// is both listed and created. The upload therefore starts with the first folder instead of after
+/// the whole tree has been walked, and no file is copied before its folder exists.
+///
+/// Folders are created in the order found, which puts every folder after its parent. Reparse
+/// points aren't followed, so a link can't walk the upload into a cycle. When the walk is done
+/// the batch is sealed; cancelling the batch stops the walk.
+///
+/// A drop of virtual files names its folders and files by paths relative to the drop instead;
+/// those folders are only created, by the same creator, and their files held until they are.
+/// </summary>
+class BigDriveTreeUpload
+{
+public:
+
+    /// <summary>
+    /// Default maximum number of folders listed at once.
+    /// </summary>
+    static const ULONG DefaultMaxWalkers = 4;
+
+private:
+
+    /// <summary>
+    /// A folder being uploaded. Freed once it is both listed and created and its files have been
+    /// handed to the batch.
+    /// </summary>
+    struct Folder
+    {
+        LPWSTR szLocalPath;                     // nullptr for a folder that is only created
+        LPWSTR szTargetPath;                    // As passed to providers
+
+        BigDriveTransferItem** ppFiles;         // Listed, waiting for the folder to be created
+        ULONG fileCount;
+        ULONG fileCapacity;
+
+        BOOL fListed;
+        BOOL fCreated;
+
+        Folder* pNextWalk;                      // Next folder to list
+        Folder* pNextCreate;                    // Next folder to create
+    };
+
+    LONG m_refCount;
+
+    /// <summary>
+    /// The batch the files are added to; AddRef'd.
+    /// </summary>
+    BigDriveTransferBatch* m_pBatch;
+
+    ULONG m_maxWalkers;
+
+    /// <summary>
+    /// Folders waiting to be listed, in the order found.
+    /// </summary>
+    Folder* m_pWalkFirst;
+    Folder* m_pWalkLast;
+    ULONG m_walkQueued;
+
+    /// <summary>
+    /// Folders waiting to be created, in the order found.
+    /// </summary>
+    Folder* m_pCreateFirst;
+    Folder* m_pCreateLast;
+
+    /// <summary>
+    /// Number of walkers running.
+    /// </summary>
+    ULONG m_activeWalkers;
+
+    /// <summary>
+    /// TRUE while the creator is running.
+    /// </summary>
+    BOOL m_fCreating;
+
+    BOOL m_fStarted;
+    BOOL m_fSealed;
+
+    /// <summary>
+    /// Number of folders that couldn't be listed, and the error of the first.
+    /// </summary>
+    ULONG m_skippedFolders;
+    HRESULT m_hrSkipped;
+
+    /// <summary>
+    /// Guards everything above and the folders. Taken before the engine lock, never after.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Constructs an upload with no folders. Use <see cref="Create"/>.
+    /// </summary>
+    BigDriveTreeUpload(BigDriveTransferBatch* pBatch, ULONG maxWalkers);
+
+    /// <summary>
+    /// Frees the folders of an upload that was never started and releases the batch.
+    /// </summary>
+    ~BigDriveTreeUpload();
+
+public:
+
+    /// <summary>
+    /// Creates an upload that feeds a batch.
+    /// </summary>
+    /// <param name="pBatch">The batch, not yet submitted. Folders are created through its factory.</param>
+    /// <param name="maxWalkers">Maximum number of folders listed at once.</param>
+    /// <param name="ppUpload">Receives the upload. The caller must release it.</param>
+    /// <returns>S_OK on success; E_POINTER; E_INVALIDARG; or E_OUTOFMEMORY.</returns>
+    static HRESULT Create(BigDriveTransferBatch* pBatch, ULONG maxWalkers, BigDriveTreeUpload** ppUpload);
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG AddRef();
+
+    /// <summary>
+    /// Decrements the reference count and deletes the upload if it reaches zero.
+    /// </summary>
+    ULONG Release();
+
+    /// <summary>
+    /// Adds a dropped file or folder. A file is added to the batch; a folder is copied, with
+    /// everything under it, into a folder of the same name in the batch's folder.
+    /// </summary>
+    /// <param name="szLocalPath">The local path of the file or folder.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or E_UNEXPECTED once started.</returns>
+    HRESULT Add(LPCWSTR szLocalPath);
+
+    /// <summary>
+    /// Adds a folder to create at a path relative to the batch's folder, such as a folder of a
+    /// virtual file drop. Nothing is walked. Its parents are added first if they weren't.
+    /// </summary>
+    /// <param name="szRelativePath">The path of the folder, as validated by the caller.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; or E_UNEXPECTED once started.</returns>
+    HRESULT AddFolder(LPCWSTR szRelativePath);
+
+    /// <summary>
+    /// Adds data to copy to a path relative to the batch's folder, such as a virtual file. A file
+    /// in a folder joins the batch once the folder is created, which is added if it wasn't.
+    /// </summary>
+    /// <param name="pStream">The data, from its current position to its end.</param>
+    /// <param name="szRelativePath">The path of the file, as validated by the caller.</param>
+    /// <param name="size">Size of the data, or -1 to ask the stream.</param>
+    /// <param name="lastWriteTime">Last write time of the source as a UTC FILETIME, or 0 if unknown.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY; the error from registering the stream; or E_UNEXPECTED once started.</returns>
+    HRESULT AddStream(IStream* pStream, LPCWSTR szRelativePath, LONGLONG size, LONGLONG lastWriteTime);
+
+    /// <summary>
+    /// Retrieves the batch. Not AddRef'd.
+    /// </summary>
+    BigDriveTransferBatch* GetBatch();
+
+    /// <summary>
+    /// Starts walking the folders. The batch must have been submitted open; it is sealed when
+    /// the walk is done, at once if there are no folders.
+    /// </summary>
+    /// <returns>S_OK on success; E_UNEXPECTED if already started.</returns>
+    HRESULT Start();
+
+    /// <summary>
+    /// Retrieves the number of folders that couldn't be listed, whose files weren't uploaded.
+    /// </summary>
+    /// <param name="hrFirst">Receives the error of the first such folder, or S_OK.</param>
+    ULONG GetSkippedFolders(HRESULT& hrFirst);
+
+private:
+
+    /// <summary>
+    /// Starts walkers for the queued folders and the creator for the folders to create, and
+    /// seals the batch when there is nothing left to do. Called with the lock held.
+    /// </summary>
+    void Schedule();
+
+    /// <summary>
+    /// Thread pool callback that runs <see cref="Walk"/> and drops the walker's reference.
+    /// </summary>
+    static VOID CALLBACK WalkCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext);
+
+    /// <summary>
+    /// Lists queued folders until there are none left.
+    /// </summary>
+    void Walk();
+
+    /// <summary>
+    /// Lists one folder, keeping its files and returning its subfolders. Called without the lock.
+    /// </summary>
+    /// <param name="pFolder">The folder.</param>
+    /// <param name="ppChildren">Receives the subfolders, linked through pNextWalk.</param>
+    /// <returns>S_OK on success; HRESULT_FROM_WIN32(ERROR_CANCELLED) if the batch was cancelled; otherwise, an HRESULT error code.</returns>
+    HRESULT ListFolder(Folder* pFolder, Folder** ppChildren);
+
+    /// <summary>
+    /// Thread pool callback that runs <see cref="CreateFolders"/> and drops the creator's reference.
+    /// </summary>
+    static VOID CALLBACK CreateCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext);
+
+    /// <summary>
+    /// Creates the queued folders, a whole queue per pass, until there are none left.
+    /// </summary>
+    void CreateFolders();
+
+    /// <summary>
+    /// Queues a folder to be listed and to be created. Called with the lock held.
+    /// </summary>
+    void QueueFolder(Folder* pFolder);
+
+    /// <summary>
+    /// Queues a folder to be created. Called with the lock held.
+    /// </summary>
+    void QueueCreation(Folder* pFolder);
+
+    /// <summary>
+    /// Finds the folder to create at a path relative to the batch's folder, queueing it and any
+    /// parent not yet queued. Called before the upload starts.
+    /// </summary>
+    /// <param name="szRelativePath">The path of the folder.</param>
+    /// <param name="ppFolder">Receives the folder, owned by the upload.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; or E_OUTOFMEMORY.</returns>
+    HRESULT FindOrQueueCreation(LPCWSTR szRelativePath, Folder** ppFolder);
+
+    /// <summary>
+    /// Adds a file to the files a folder holds until it is created.
+    /// </summary>
+    /// <returns>S_OK on success; E_OUTOFMEMORY, in which case the folder doesn't take the file.</returns>
+    static HRESULT HoldFile(Folder* pFolder, BigDriveTransferItem* pItem);
+
+    /// <summary>
+    /// Marks a folder listed, queueing its subfolders. Called with the lock held.
+    /// </summary>
+    void CompleteListing(Folder* pFolder, Folder* pChildren);
+
+    /// <summary>
+    /// Marks a folder created. Called with the lock held.
+    /// </summary>
+    void CompleteCreation(Folder* pFolder);
+
+    /// <summary>
+    /// Hands the files of a folder that is listed and created to the batch and frees the folder.
+    /// Called with the lock held.
+    /// </summary>
+    void Flush(Folder* pFolder);
+
+    /// <summary>
+    /// Allocates a folder.
+    /// </summary>
+    /// <param name="szParentLocalPath">The local folder it is in; nullptr for a folder that is only created.</param>
+    /// <param name="szParentTargetPath">The folder on the drive it is created in.</param>
+    /// <param name="szName">Its name.</param>
+    /// <returns>The folder, or nullptr if out of memory. Free with <see cref="FreeFolder"/>.</returns>
+    static Folder* CreateFolder(LPCWSTR szParentLocalPath, LPCWSTR szParentTargetPath, LPCWSTR szName);
+
+    /// <summary>
+    /// Frees a folder and the files it still holds.
+    /// </summary>
+    static void FreeFolder(Folder* pFolder);
+};
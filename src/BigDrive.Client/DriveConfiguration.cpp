@@ -149,3 +149,33 @@ End:
 
     return hr;
 }
+
+/// <summary>
+/// Copies the configuration into another, replacing its name.
+/// </summary>
+/// <param name="target">The configuration to copy into.</param>
+/// <returns>HRESULT indicating success or failure.</returns>
+HRESULT DriveConfiguration::CopyTo(DriveConfiguration& target) const
+{
+    BSTR nameCopy = nullptr;
+
+    if (name)
+    {
+        nameCopy = ::SysAllocString(name);
+        if (nameCopy == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    if (target.name)
+    {
+        ::SysFreeString(target.name);
+    }
+
+    target.id = id;
+    target.name = nameCopy;
+    target.clsid = clsid;
+
+    return S_OK;
+}
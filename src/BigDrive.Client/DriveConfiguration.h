@@ -69,4 +69,11 @@ public:
     /// <param name="jsonString">The JSON string containing the drive configuration.</param>
     /// <returns>HRESULT indicating success or failure.</returns>
     HRESULT ParseJson(LPCWSTR jsonString);
+
+    /// <summary>
+    /// Copies the configuration into another, replacing its name.
+    /// </summary>
+    /// <param name="target">The configuration to copy into.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY if the name couldn't be copied, which leaves the target unchanged.</returns>
+    HRESULT CopyTo(DriveConfiguration& target) const;
 };
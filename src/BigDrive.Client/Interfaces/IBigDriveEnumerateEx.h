@@ -0,0 +1,45 @@
+// <copyright file="IBigDriveEnumerateEx.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <windows.h>
+#include <Unknwn.h> // For IUnknown
+#include <guiddef.h> // For defining GUIDs
+
+/// <summary>
+/// The IID for the IBigDriveEnumerateEx interface.
+/// </summary>
+const IID IID_IBigDriveEnumerateEx = { 0x5C0E6B21, 0x7A43, 0x4F5D, { 0x9E, 0x8B, 0x2D, 0x1F, 0x3A, 0x6C, 0x8E, 0x94 } };
+
+/// <summary>
+/// Flags passed to <see cref="IBigDriveEnumerateEx::EnumerateEntries"/>. Mirrors EnumerateEntriesFlags in BigDrive.Interfaces.
+/// </summary>
+enum BigDriveEnumerateEntries
+{
+    BigDriveEnumerateEntries_Folders = 0x01,
+    BigDriveEnumerateEntries_Files = 0x02
+};
+
+/// <summary>
+/// Optional interface for enumerating folders and files, with their metadata, in a single call.
+/// </summary>
+class __declspec(uuid("5C0E6B21-7A43-4F5D-9E8B-2D1F3A6C8E94")) IBigDriveEnumerateEx : public IUnknown
+{
+public:
+
+    /// <summary>
+    /// Retrieves the folders and files of the path, with their metadata.
+    /// </summary>
+    /// <param name="driveGuid">The registered Drive Identifier.</param>
+    /// <param name="path">The path to enumerate.</param>
+    /// <param name="flags">Combination of <see cref="BigDriveEnumerateEntries"/> values.</param>
+    /// <param name="entries">Receives a SAFEARRAY of VT_UI1 holding the packed entries; read it with BigDriveEnumerationReader.</param>
+    /// <returns>HRESULT indicating success or failure.</returns>
+    virtual HRESULT STDMETHODCALLTYPE EnumerateEntries(
+        /* [in] */ REFGUID driveGuid,
+        /* [in] */ BSTR path,
+        /* [in] */ LONG flags,
+        /* [out] */ SAFEARRAY** entries) = 0;
+};
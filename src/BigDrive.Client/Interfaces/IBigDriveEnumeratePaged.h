@@ -0,0 +1,42 @@
+// <copyright file="IBigDriveEnumeratePaged.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <windows.h>
+#include <Unknwn.h> // For IUnknown
+#include <guiddef.h> // For defining GUIDs
+
+/// <summary>
+/// The IID for the IBigDriveEnumeratePaged interface.
+/// </summary>
+const IID IID_IBigDriveEnumeratePaged = { 0x8D4F2A63, 0x1B7E, 0x4C95, { 0xA3, 0xD0, 0x6E, 0x9B, 0x5F, 0x1C, 0x2A, 0x78 } };
+
+/// <summary>
+/// Optional interface for enumerating folders and files, with their metadata, one page at a time.
+/// </summary>
+class __declspec(uuid("8D4F2A63-1B7E-4C95-A3D0-6E9B5F1C2A78")) IBigDriveEnumeratePaged : public IUnknown
+{
+public:
+
+    /// <summary>
+    /// Retrieves a page of the folders and files of the path, with their metadata.
+    /// </summary>
+    /// <param name="driveGuid">The registered Drive Identifier.</param>
+    /// <param name="path">The path to enumerate.</param>
+    /// <param name="flags">Combination of BigDriveEnumerateEntries values.</param>
+    /// <param name="cursor">nullptr for the first page; otherwise the cursor returned with the previous page.</param>
+    /// <param name="pageSize">The maximum number of entries to return.</param>
+    /// <param name="nextCursor">Receives the cursor of the next page, or nullptr after the last page.</param>
+    /// <param name="entries">Receives a SAFEARRAY of VT_UI1 holding the packed entries; read it with BigDriveEnumerationReader.</param>
+    /// <returns>HRESULT indicating success or failure.</returns>
+    virtual HRESULT STDMETHODCALLTYPE EnumerateEntriesPage(
+        /* [in] */ REFGUID driveGuid,
+        /* [in] */ BSTR path,
+        /* [in] */ LONG flags,
+        /* [in] */ BSTR cursor,
+        /* [in] */ LONG pageSize,
+        /* [out] */ BSTR* nextCursor,
+        /* [out, retval] */ SAFEARRAY** entries) = 0;
+};
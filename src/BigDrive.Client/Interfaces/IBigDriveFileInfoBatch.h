@@ -0,0 +1,49 @@
+// <copyright file="IBigDriveFileInfoBatch.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <windows.h>
+#include <Unknwn.h> // For IUnknown
+#include <guiddef.h> // For defining GUIDs
+
+/// <summary>
+/// The IID for the IBigDriveFileInfoBatch interface.
+/// </summary>
+const IID IID_IBigDriveFileInfoBatch = { 0xE3A17C52, 0x9D4B, 0x4E08, { 0xB6, 0xF1, 0x7C, 0x2D, 0x5A, 0x8E, 0x4B, 0x19 } };
+
+/// <summary>
+/// Fields passed to <see cref="IBigDriveFileInfoBatch::GetFileInfoBatch"/>. Mirrors FileInfoFields in BigDrive.Interfaces;
+/// the values match BigDriveEnumerationField.
+/// </summary>
+enum BigDriveFileInfoFields
+{
+    BigDriveFileInfoFields_Size = 0x01,
+    BigDriveFileInfoFields_LastWriteTime = 0x02,
+    BigDriveFileInfoFields_Attributes = 0x04,
+    BigDriveFileInfoFields_All = 0x07
+};
+
+/// <summary>
+/// Optional interface for retrieving the metadata of many files in a single call.
+/// </summary>
+class __declspec(uuid("E3A17C52-9D4B-4E08-B6F1-7C2D5A8E4B19")) IBigDriveFileInfoBatch : public IUnknown
+{
+public:
+
+    /// <summary>
+    /// Retrieves the metadata of each of the paths.
+    /// </summary>
+    /// <param name="driveGuid">The registered Drive Identifier.</param>
+    /// <param name="paths">A SAFEARRAY of VT_BSTR holding the full paths.</param>
+    /// <param name="fields">Combination of <see cref="BigDriveFileInfoFields"/> values.</param>
+    /// <param name="records">Receives a SAFEARRAY of VT_UI1 holding one packed entry per path, in order; read it with BigDriveEnumerationReader.
+    /// An entry with no fields set names a path that doesn't exist.</param>
+    /// <returns>HRESULT indicating success or failure.</returns>
+    virtual HRESULT STDMETHODCALLTYPE GetFileInfoBatch(
+        /* [in] */ REFGUID driveGuid,
+        /* [in] */ SAFEARRAY* paths,
+        /* [in] */ LONG fields,
+        /* [out] */ SAFEARRAY** records) = 0;
+};
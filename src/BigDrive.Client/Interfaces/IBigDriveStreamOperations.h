@@ -0,0 +1,39 @@
+// <copyright file="IBigDriveStreamOperations.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <windows.h>
+#include <objidl.h> // For IStream
+#include <guiddef.h> // For defining GUIDs
+
+/// <summary>
+/// The IID for the IBigDriveStreamOperations interface.
+/// </summary>
+const IID IID_IBigDriveStreamOperations = { 0x4E6B9C21, 0x7D3A, 0x4F58, { 0xB1, 0xE2, 0x9A, 0x0C, 0x5D, 0x8F, 0x3B, 0x46 } };
+
+/// <summary>
+/// Optional interface for uploading file data from a stream, so data that isn't a local file
+/// doesn't have to go through a temp file.
+/// </summary>
+class __declspec(uuid("4E6B9C21-7D3A-4F58-B1E2-9A0C5D8F3B46")) IBigDriveStreamOperations : public IUnknown
+{
+public:
+
+    /// <summary>
+    /// Copies the data of a stream to a file in BigDrive storage, replacing it if it exists.
+    /// </summary>
+    /// <param name="driveGuid">The registered Drive Identifier.</param>
+    /// <param name="pStream">The data, read from its current position to its end.</param>
+    /// <param name="bigDriveTargetPath">The full path of the file in BigDrive, including its name.</param>
+    /// <param name="size">Size of the data in bytes, or -1 if unknown.</param>
+    /// <param name="lastWriteTime">Last write time of the source as a UTC FILETIME, or 0 if unknown.</param>
+    /// <returns>S_OK if successful; otherwise, an error code.</returns>
+    virtual HRESULT STDMETHODCALLTYPE CopyStreamToBigDrive(
+        /* [in] */ REFGUID driveGuid,
+        /* [in] */ IStream* pStream,
+        /* [in] */ LPCWSTR bigDriveTargetPath,
+        /* [in] */ LONGLONG size,
+        /* [in] */ LONGLONG lastWriteTime) = 0;
+};
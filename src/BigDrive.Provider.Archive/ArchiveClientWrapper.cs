@@ -12,6 +12,7 @@ namespace BigDrive.Provider.Archive
     using System.Threading;
 
     using BigDrive.ConfigProvider;
+    using BigDrive.Interfaces.Model;
     using SharpCompress.Archives;
     using SharpCompress.Common;
     using SharpCompress.Writers;
@@ -216,6 +217,83 @@ namespace BigDrive.Provider.Archive
             return files.ToArray();
         }
 
+        /// <summary>
+        /// Gets the folders and files at the specified path, with their metadata, reading the archive once.
+        /// </summary>
+        /// <param name="normalizedPath">The normalized path (forward slashes, no leading/trailing separators). Empty string for root.</param>
+        /// <param name="includeFolders">True to return folders.</param>
+        /// <param name="includeFiles">True to return files.</param>
+        /// <returns>The folders followed by the files at the specified path.</returns>
+        public List<EnumerationEntry> GetEntries(string normalizedPath, bool includeFolders, bool includeFiles)
+        {
+            List<EnumerationEntry> folders = new List<EnumerationEntry>();
+            List<EnumerationEntry> files = new List<EnumerationEntry>();
+
+            if (string.IsNullOrEmpty(_archiveFilePath) || !File.Exists(_archiveFilePath))
+            {
+                return folders;
+            }
+
+            string prefix = string.IsNullOrEmpty(normalizedPath) ? "" : normalizedPath + "/";
+            HashSet<string> folderNames = new HashSet<string>(StringComparer.OrdinalIgnoreCase);
+
+            try
+            {
+                using (var archive = ArchiveFactory.Open(_archiveFilePath))
+                {
+                    foreach (var entry in archive.Entries)
+                    {
+                        if (entry.IsDirectory)
+                        {
+                            continue;
+                        }
+
+                        string fullName = entry.Key.Replace('\\', '/');
+
+                        if (!string.IsNullOrEmpty(prefix) && !fullName.StartsWith(prefix, StringComparison.OrdinalIgnoreCase))
+                        {
+                            continue;
+                        }
+
+                        string relativePath = string.IsNullOrEmpty(prefix) ? fullName : fullName.Substring(prefix.Length);
+                        int slashIndex = relativePath.IndexOf('/');
+
+                        if (slashIndex > 0)
+                        {
+                            string folderName = SanitizeName(relativePath.Substring(0, slashIndex));
+                            if (includeFolders && folderNames.Add(folderName))
+                            {
+                                folders.Add(new EnumerationEntry
+                                {
+                                    Name = folderName,
+                                    IsFolder = true,
+                                    Attributes = FileAttributes.Directory,
+                                });
+                            }
+                        }
+                        else if (includeFiles && slashIndex < 0 && !string.IsNullOrEmpty(relativePath))
+                        {
+                            files.Add(new EnumerationEntry
+                            {
+                                Name = SanitizeName(relativePath),
+                                Size = (ulong)entry.Size,
+                                LastWriteTime = entry.LastModifiedTime,
+                                Attributes = FileAttributes.Archive,
+                                ETag = (entry.Crc != 0) ? entry.Crc.ToString("x8") : null,
+                            });
+                        }
+                    }
+                }
+            }
+            catch
+            {
+                return new List<EnumerationEntry>();
+            }
+
+            folders.AddRange(files);
+            return folders;
+        }
+
         /// <summary>
         /// Gets the last modified time for the specified file entry in the archive.
         /// </summary>
@@ -278,6 +356,87 @@ namespace BigDrive.Provider.Archive
             return 0;
         }
 
+        /// <summary>
+        /// Gets the metadata of each of the specified file entries, opening the archive and walking its entries once.
+        /// </summary>
+        /// <param name="normalizedPaths">The normalized file paths within the archive.</param>
+        /// <returns>The metadata of each path, at the same index, or null where the archive has no such entry.</returns>
+        public EnumerationEntry[] GetFileInfos(IList<string> normalizedPaths)
+        {
+            EnumerationEntry[] results = new EnumerationEntry[normalizedPaths.Count];
+
+            if (string.IsNullOrEmpty(_archiveFilePath) || !File.Exists(_archiveFilePath))
+            {
+                return results;
+            }
+
+            // The positions asking for each path; a FindEntry scan per path would read a solid or TAR archive once per file
+            Dictionary<string, List<int>> pending = new Dictionary<string, List<int>>(StringComparer.OrdinalIgnoreCase);
+            for (int i = 0; i < normalizedPaths.Count; i++)
+            {
+                if (string.IsNullOrEmpty(normalizedPaths[i]))
+                {
+                    continue;
+                }
+
+                List<int> indexes;
+                if (!pending.TryGetValue(normalizedPaths[i], out indexes))
+                {
+                    indexes = new List<int>();
+                    pending.Add(normalizedPaths[i], indexes);
+                }
+
+                indexes.Add(i);
+            }
+
+            try
+            {
+                using (var archive = ArchiveFactory.Open(_archiveFilePath))
+                {
+                    foreach (var entry in archive.Entries)
+                    {
+                        if (pending.Count == 0)
+                        {
+                            break;
+                        }
+
+                        if (entry.IsDirectory)
+                        {
+                            continue;
+                        }
+
+                        string entryPath = entry.Key.Replace('\\', '/');
+
+                        List<int> indexes;
+                        if (!pending.TryGetValue(entryPath, out indexes))
+                        {
+                            continue;
+                        }
+
+                        EnumerationEntry info = new EnumerationEntry
+                        {
+                            Size = (ulong)entry.Size,
+                            LastWriteTime = entry.LastModifiedTime,
+                            Attributes = FileAttributes.Archive,
+                        };
+
+                        foreach (int index in indexes)
+                        {
+                            results[index] = info;
+                        }
+
+                        pending.Remove(entryPath);
+                    }
+                }
+            }
+            catch
+            {
+                return new EnumerationEntry[normalizedPaths.Count];
+            }
+
+            return results;
+        }
+
         /// <summary>
         /// Gets the file data for the specified file entry in the archive.
         /// </summary>
@@ -0,0 +1,53 @@
+// <copyright file="Provider.IBigDriveEnumeratePaged.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Archive
+{
+    using System;
+
+    using BigDrive.Interfaces.Model;
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveEnumeratePaged"/> for the Archive provider.
+    /// The archive is read once for the first page; later pages come from the pager's snapshot.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <summary>
+        /// Enumerates a page of the folders and files at the specified path within the archive.
+        /// </summary>
+        /// <param name="driveGuid">The drive GUID.</param>
+        /// <param name="path">The path to enumerate.</param>
+        /// <param name="flags"><see cref="EnumerateEntriesFlags"/> bits.</param>
+        /// <param name="cursor">Null for the first page; otherwise the cursor returned with the previous page.</param>
+        /// <param name="pageSize">The maximum number of entries to return.</param>
+        /// <param name="nextCursor">Receives the cursor of the next page, or null after the last page.</param>
+        /// <returns>The packed entries.</returns>
+        public byte[] EnumerateEntriesPage(Guid driveGuid, string path, int flags, string cursor, int pageSize, out string nextCursor)
+        {
+            nextCursor = null;
+
+            try
+            {
+                DefaultTraceSource.TraceInformation($"EnumerateEntriesPage: driveGuid={driveGuid}, path={path}, flags={flags}, cursor={cursor}, pageSize={pageSize}");
+
+                EnumerateEntriesFlags entryFlags = (EnumerateEntriesFlags)flags;
+                ArchiveClientWrapper archiveClient = GetArchiveClient(driveGuid);
+                string normalizedPath = NormalizePath(path);
+
+                return EnumerationPager.GetPage(cursor, pageSize, () => archiveClient.GetEntries(
+                    normalizedPath,
+                    (entryFlags & EnumerateEntriesFlags.Folders) != 0,
+                    (entryFlags & EnumerateEntriesFlags.Files) != 0), out nextCursor);
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"EnumerateEntriesPage failed: {ex.Message}");
+                nextCursor = null;
+                return EnumerationEntrySerializer.Serialize(null);
+            }
+        }
+    }
+}
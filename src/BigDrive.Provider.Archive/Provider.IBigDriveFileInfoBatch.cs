@@ -0,0 +1,44 @@
+// <copyright file="Provider.IBigDriveFileInfoBatch.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Archive
+{
+    using System;
+    using System.Linq;
+
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveFileInfoBatch"/> for the Archive provider.
+    /// Answers the metadata of many entries from a single pass over the archive.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <summary>
+        /// Gets the size, last modified time and attributes of each of the specified paths within the archive.
+        /// </summary>
+        /// <param name="driveGuid">The drive GUID.</param>
+        /// <param name="paths">The file paths (e.g., "\folder\file.txt").</param>
+        /// <param name="fields"><see cref="BigDrive.Interfaces.Model.FileInfoFields"/> bits. All are always returned.</param>
+        /// <returns>The packed records, one per path.</returns>
+        public byte[] GetFileInfoBatch(Guid driveGuid, string[] paths, int fields)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"GetFileInfoBatch: driveGuid={driveGuid}, paths={paths?.Length ?? 0}, fields={fields}");
+
+                ArchiveClientWrapper archiveClient = GetArchiveClient(driveGuid);
+
+                return EnumerationEntrySerializer.SerializeFileInfo(
+                    paths,
+                    archiveClient.GetFileInfos((paths ?? new string[0]).Select(NormalizePath).ToList()));
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"GetFileInfoBatch failed: {ex.Message}");
+                return EnumerationEntrySerializer.SerializeFileInfo(paths, null);
+            }
+        }
+    }
+}
@@ -41,7 +41,10 @@ namespace BigDrive.Provider.Archive
         IProcessInitializer,
         IBigDriveRegistration,
         IBigDriveEnumerate,
+        IBigDriveEnumerateEx,
+        IBigDriveEnumeratePaged,
         IBigDriveFileInfo,
+        IBigDriveFileInfoBatch,
         IBigDriveFileData,
         IBigDriveFileOperations,
         IBigDriveDriveInfo,
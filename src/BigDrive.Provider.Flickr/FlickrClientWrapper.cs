@@ -291,6 +291,39 @@ namespace BigDrive.Provider.Flickr
                 SanitizeName(p.Title).Equals(photoName, StringComparison.OrdinalIgnoreCase));
         }
 
+        /// <summary>
+        /// Gets detailed information about several photos in a photoset from one photo listing.
+        /// </summary>
+        /// <param name="photosetName">The name of the photoset.</param>
+        /// <param name="photoNames">The names of the photos.</param>
+        /// <returns>Photo information for each name, at the same index, or null where the photoset has no such photo.</returns>
+        public PhotoInfo[] GetPhotoInfos(string photosetName, IList<string> photoNames)
+        {
+            PhotoInfo[] results = new PhotoInfo[photoNames.Count];
+            Dictionary<string, PhotoInfo> photosByName = new Dictionary<string, PhotoInfo>(StringComparer.OrdinalIgnoreCase);
+
+            // Indexed once, rather than a GetPhotoInfo scan of the listing per name; the first title wins as with GetPhotoInfo
+            foreach (var photo in GetPhotosInPhotoset(photosetName))
+            {
+                string name = SanitizeName(photo.Title);
+                if (!photosByName.ContainsKey(name))
+                {
+                    photosByName.Add(name, photo);
+                }
+            }
+
+            for (int i = 0; i < photoNames.Count; i++)
+            {
+                PhotoInfo photo;
+                if (!string.IsNullOrEmpty(photoNames[i]) && photosByName.TryGetValue(photoNames[i], out photo))
+                {
+                    results[i] = photo;
+                }
+            }
+
+            return results;
+        }
+
         /// <summary>
         /// Gets the raw photo data.
         /// </summary>
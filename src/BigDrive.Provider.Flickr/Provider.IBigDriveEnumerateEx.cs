@@ -0,0 +1,113 @@
+// <copyright file="Provider.IBigDriveEnumerateEx.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Flickr
+{
+    using System;
+    using System.Collections.Generic;
+    using System.IO;
+
+    using BigDrive.Interfaces.Model;
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveEnumerateEx"/> for the Flickr provider.
+    /// Photosets are returned as folders and photos as files, with the date and photo ID taken from the
+    /// listing the provider already fetches, so Explorer doesn't call back for each photo.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <summary>
+        /// Enumerates the photosets at the root, or the photos in a photoset.
+        /// </summary>
+        /// <param name="driveGuid">The drive GUID.</param>
+        /// <param name="path">The path to enumerate.</param>
+        /// <param name="flags"><see cref="EnumerateEntriesFlags"/> bits.</param>
+        /// <returns>The packed entries.</returns>
+        public byte[] EnumerateEntries(Guid driveGuid, string path, int flags)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"EnumerateEntries: driveGuid={driveGuid}, path={path}, flags={flags}");
+
+                FlickrClientWrapper flickrClient = GetFlickrClient(driveGuid);
+
+                return EnumerationEntrySerializer.Serialize(GetEntries(flickrClient, path, (EnumerateEntriesFlags)flags));
+            }
+            catch (BigDrive.Interfaces.BigDriveAuthenticationRequiredException)
+            {
+                throw;
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"EnumerateEntries failed: {ex.Message}");
+                return EnumerationEntrySerializer.Serialize(null);
+            }
+        }
+
+        /// <summary>
+        /// Builds the entries at a path from the photoset and photo listings.
+        /// </summary>
+        /// <param name="flickrClient">The Flickr client of the drive.</param>
+        /// <param name="path">The path to enumerate.</param>
+        /// <param name="entryFlags">Selects folders, files or both.</param>
+        /// <returns>The photosets at the root, or the photos in a photoset.</returns>
+        private static List<EnumerationEntry> GetEntries(FlickrClientWrapper flickrClient, string path, EnumerateEntriesFlags entryFlags)
+        {
+            List<EnumerationEntry> entries = new List<EnumerationEntry>();
+
+            if (IsRootPath(path))
+            {
+                // Root level has only photoset folders
+                if ((entryFlags & EnumerateEntriesFlags.Folders) != 0)
+                {
+                    foreach (var photoset in flickrClient.GetPhotosets())
+                    {
+                        entries.Add(new EnumerationEntry
+                        {
+                            Name = SanitizeFolderName(photoset.Title),
+                            IsFolder = true,
+                            Attributes = FileAttributes.Directory,
+                            ETag = photoset.Id,
+                        });
+                    }
+                }
+
+                return entries;
+            }
+
+            // Photosets don't have subfolders
+            string photosetName = GetPhotosetNameFromPath(path);
+            if (string.IsNullOrEmpty(photosetName) || (entryFlags & EnumerateEntriesFlags.Files) == 0)
+            {
+                return entries;
+            }
+
+            foreach (var photo in flickrClient.GetPhotosInPhotoset(photosetName))
+            {
+                EnumerationEntry entry = new EnumerationEntry
+                {
+                    Name = SanitizeFileName(photo.Title) + ".jpg",
+                    Attributes = FileAttributes.ReadOnly,
+                    ETag = photo.Id,
+                };
+
+                if (photo.DateUploaded != DateTime.MinValue)
+                {
+                    entry.LastWriteTime = photo.DateUploaded;
+                }
+
+                // The photo listing doesn't carry sizes; leave it to IBigDriveFileInfo when known
+                if (photo.FileSize != 0)
+                {
+                    entry.Size = photo.FileSize;
+                }
+
+                entries.Add(entry);
+            }
+
+            return entries;
+        }
+    }
+}
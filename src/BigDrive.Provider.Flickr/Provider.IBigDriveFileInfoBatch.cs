@@ -0,0 +1,97 @@
+// <copyright file="Provider.IBigDriveFileInfoBatch.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Flickr
+{
+    using System;
+    using System.Collections.Generic;
+    using System.IO;
+    using System.Linq;
+
+    using BigDrive.Interfaces.Model;
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveFileInfoBatch"/> for the Flickr provider.
+    /// Answers the metadata of many photos from one photo listing per photoset, rather than a listing
+    /// lookup per photo and per column.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <summary>
+        /// Gets the size and upload date of each of the photos at the specified paths.
+        /// </summary>
+        /// <param name="driveGuid">The drive GUID.</param>
+        /// <param name="paths">The file paths (e.g., "\Photoset\Photo.jpg").</param>
+        /// <param name="fields"><see cref="FileInfoFields"/> bits. All known values are always returned.</param>
+        /// <returns>The packed records, one per path.</returns>
+        public byte[] GetFileInfoBatch(Guid driveGuid, string[] paths, int fields)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"GetFileInfoBatch: driveGuid={driveGuid}, paths={paths?.Length ?? 0}, fields={fields}");
+
+                FlickrClientWrapper flickrClient = GetFlickrClient(driveGuid);
+
+                return EnumerationEntrySerializer.SerializeFileInfo(paths, GetFileInfos(flickrClient, paths ?? new string[0]));
+            }
+            catch (BigDrive.Interfaces.BigDriveAuthenticationRequiredException)
+            {
+                throw;
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"GetFileInfoBatch failed: {ex.Message}");
+                return EnumerationEntrySerializer.SerializeFileInfo(paths, null);
+            }
+        }
+
+        /// <summary>
+        /// Looks up the photos at the specified paths, listing each photoset once.
+        /// </summary>
+        /// <param name="flickrClient">The Flickr client of the drive.</param>
+        /// <param name="paths">The file paths.</param>
+        /// <returns>The metadata of each path, at the same index, or null where there is no such photo.</returns>
+        private static EnumerationEntry[] GetFileInfos(FlickrClientWrapper flickrClient, string[] paths)
+        {
+            EnumerationEntry[] results = new EnumerationEntry[paths.Length];
+
+            // The shell sends the files of one folder, so this is normally a single photoset
+            var photosets = Enumerable.Range(0, paths.Length)
+                .Where(i => !string.IsNullOrEmpty(GetPhotosetNameFromPath(paths[i])) && !string.IsNullOrEmpty(GetPhotoNameFromPath(paths[i])))
+                .GroupBy(i => GetPhotosetNameFromPath(paths[i]), StringComparer.OrdinalIgnoreCase);
+
+            foreach (var photoset in photosets)
+            {
+                List<int> indexes = photoset.ToList();
+                PhotoInfo[] photos = flickrClient.GetPhotoInfos(photoset.Key, indexes.Select(i => GetPhotoNameFromPath(paths[i])).ToList());
+
+                for (int j = 0; j < indexes.Count; j++)
+                {
+                    if (photos[j] == null)
+                    {
+                        continue;
+                    }
+
+                    // The size is what GetFileSize would answer, even when the listing doesn't carry it, so the
+                    // shell doesn't call back for it
+                    EnumerationEntry entry = new EnumerationEntry
+                    {
+                        Size = photos[j].FileSize,
+                        Attributes = FileAttributes.ReadOnly,
+                    };
+
+                    if (photos[j].DateUploaded != DateTime.MinValue)
+                    {
+                        entry.LastWriteTime = photos[j].DateUploaded;
+                    }
+
+                    results[indexes[j]] = entry;
+                }
+            }
+
+            return results;
+        }
+    }
+}
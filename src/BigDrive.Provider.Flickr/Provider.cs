@@ -35,7 +35,10 @@ namespace BigDrive.Provider.Flickr
         IBigDriveDriveInfo,
         IBigDriveCapabilities,
         IBigDriveEnumerate,
+        IBigDriveEnumerateEx,
+        IBigDriveEnumeratePaged,
         IBigDriveFileInfo,
+        IBigDriveFileInfoBatch,
         IBigDriveFileOperations,
         IBigDriveFileData
     {
@@ -12,6 +12,7 @@ namespace BigDrive.Provider.Iso
     using System.Threading;
 
     using BigDrive.ConfigProvider;
+    using BigDrive.Interfaces.Model;
     using DiscUtils.Iso9660;
 
     /// <summary>
@@ -154,6 +155,81 @@ namespace BigDrive.Provider.Iso
             }
         }
 
+        /// <summary>
+        /// Gets the folders and files at the specified path, with their metadata, opening the image once.
+        /// </summary>
+        /// <param name="normalizedPath">The normalized path (forward slashes, no leading/trailing separators). Empty string for root.</param>
+        /// <param name="includeFolders">True to return folders.</param>
+        /// <param name="includeFiles">True to return files.</param>
+        /// <returns>The folders followed by the files at the specified path.</returns>
+        public List<EnumerationEntry> GetEntries(string normalizedPath, bool includeFolders, bool includeFiles)
+        {
+            List<EnumerationEntry> entries = new List<EnumerationEntry>();
+
+            if (string.IsNullOrEmpty(m_isoFilePath) || !File.Exists(m_isoFilePath))
+            {
+                return entries;
+            }
+
+            try
+            {
+                using (FileStream isoStream = File.OpenRead(m_isoFilePath))
+                using (CDReader reader = new CDReader(isoStream, true))
+                {
+                    string isoPath = ConvertToIsoPath(normalizedPath);
+
+                    if (!reader.DirectoryExists(isoPath))
+                    {
+                        return entries;
+                    }
+
+                    DiscUtils.DiscDirectoryInfo directoryInfo = reader.GetDirectoryInfo(isoPath);
+
+                    if (includeFolders)
+                    {
+                        foreach (DiscUtils.DiscDirectoryInfo folder in directoryInfo.GetDirectories())
+                        {
+                            string folderName = folder.Name.TrimEnd('\\', '/');
+                            if (!string.IsNullOrEmpty(folderName))
+                            {
+                                entries.Add(new EnumerationEntry
+                                {
+                                    Name = SanitizeName(folderName),
+                                    IsFolder = true,
+                                    LastWriteTime = folder.LastWriteTimeUtc,
+                                    Attributes = FileAttributes.Directory | FileAttributes.ReadOnly,
+                                });
+                            }
+                        }
+                    }
+
+                    if (includeFiles)
+                    {
+                        foreach (DiscUtils.DiscFileInfo file in directoryInfo.GetFiles())
+                        {
+                            if (!string.IsNullOrEmpty(file.Name))
+                            {
+                                entries.Add(new EnumerationEntry
+                                {
+                                    Name = SanitizeName(file.Name),
+                                    Size = (ulong)file.Length,
+                                    LastWriteTime = file.LastWriteTimeUtc,
+                                    Attributes = FileAttributes.ReadOnly,
+                                });
+                            }
+                        }
+                    }
+                }
+            }
+            catch (Exception ex)
+            {
+                BigDriveTraceSource.Instance.TraceError($"IsoClientWrapper.GetEntries: Error reading ISO: {ex.Message}");
+                entries.Clear();
+            }
+
+            return entries;
+        }
+
         /// <summary>
         /// Gets the last modified time for the specified file in the ISO image.
         /// </summary>
@@ -223,6 +299,66 @@ namespace BigDrive.Provider.Iso
             }
         }
 
+        /// <summary>
+        /// Gets the metadata of each of the specified files, opening the ISO image once.
+        /// </summary>
+        /// <param name="normalizedPaths">The normalized file paths within the ISO image.</param>
+        /// <returns>The metadata of each path, at the same index, or null where the image has no such file.</returns>
+        public EnumerationEntry[] GetFileInfos(IList<string> normalizedPaths)
+        {
+            EnumerationEntry[] results = new EnumerationEntry[normalizedPaths.Count];
+
+            if (string.IsNullOrEmpty(m_isoFilePath) || !File.Exists(m_isoFilePath))
+            {
+                return results;
+            }
+
+            try
+            {
+                using (FileStream isoStream = File.OpenRead(m_isoFilePath))
+                using (CDReader reader = new CDReader(isoStream, true))
+                {
+                    for (int i = 0; i < normalizedPaths.Count; i++)
+                    {
+                        if (string.IsNullOrEmpty(normalizedPaths[i]))
+                        {
+                            continue;
+                        }
+
+                        string isoPath = ConvertToIsoPath(normalizedPaths[i]);
+
+                        if (reader.FileExists(isoPath))
+                        {
+                            DiscUtils.DiscFileInfo fileInfo = reader.GetFileInfo(isoPath);
+
+                            results[i] = new EnumerationEntry
+                            {
+                                Size = (ulong)fileInfo.Length,
+                                LastWriteTime = fileInfo.LastWriteTimeUtc,
+                                Attributes = FileAttributes.ReadOnly,
+                            };
+                        }
+                        else if (reader.DirectoryExists(isoPath))
+                        {
+                            results[i] = new EnumerationEntry
+                            {
+                                IsFolder = true,
+                                LastWriteTime = reader.GetLastWriteTimeUtc(isoPath),
+                                Attributes = FileAttributes.Directory | FileAttributes.ReadOnly,
+                            };
+                        }
+                    }
+                }
+            }
+            catch (Exception ex)
+            {
+                BigDriveTraceSource.Instance.TraceError($"IsoClientWrapper.GetFileInfos: Error reading ISO: {ex.Message}");
+                Array.Clear(results, 0, results.Length);
+            }
+
+            return results;
+        }
+
         /// <summary>
         /// Opens a file from the ISO image for reading.
         /// </summary>
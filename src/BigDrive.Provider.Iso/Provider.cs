@@ -36,7 +36,10 @@ namespace BigDrive.Provider.Iso
         IBigDriveDriveInfo,
         IBigDriveCapabilities,
         IBigDriveEnumerate,
+        IBigDriveEnumerateEx,
+        IBigDriveEnumeratePaged,
         IBigDriveFileInfo,
+        IBigDriveFileInfoBatch,
         IBigDriveFileData
     {
         /// <summary>
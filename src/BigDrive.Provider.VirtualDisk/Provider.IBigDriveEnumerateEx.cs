@@ -0,0 +1,42 @@
+// <copyright file="Provider.IBigDriveEnumerateEx.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.VirtualDisk
+{
+    using System;
+    using System.Collections.Generic;
+
+    using BigDrive.Interfaces.Model;
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveEnumerateEx"/> for the VirtualDisk provider.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <inheritdoc/>
+        public byte[] EnumerateEntries(Guid driveGuid, string path, int flags)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"EnumerateEntries: driveGuid={driveGuid}, path={path}, flags={flags}");
+
+                EnumerateEntriesFlags entryFlags = (EnumerateEntriesFlags)flags;
+                VirtualDiskClientWrapper client = GetClient(driveGuid);
+                List<EnumerationEntry> entries = client.GetEntries(
+                    NormalizePath(path),
+                    (entryFlags & EnumerateEntriesFlags.Folders) != 0,
+                    (entryFlags & EnumerateEntriesFlags.Files) != 0);
+
+                DefaultTraceSource.TraceInformation($"EnumerateEntries: returned {entries.Count} entries");
+                return EnumerationEntrySerializer.Serialize(entries);
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"EnumerateEntries failed: {ex.Message}");
+                return EnumerationEntrySerializer.Serialize(null);
+            }
+        }
+    }
+}
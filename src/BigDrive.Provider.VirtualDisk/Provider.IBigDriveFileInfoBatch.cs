@@ -0,0 +1,37 @@
+// <copyright file="Provider.IBigDriveFileInfoBatch.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.VirtualDisk
+{
+    using System;
+    using System.Linq;
+
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveFileInfoBatch"/> for the VirtualDisk provider.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <inheritdoc/>
+        public byte[] GetFileInfoBatch(Guid driveGuid, string[] paths, int fields)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"GetFileInfoBatch: driveGuid={driveGuid}, paths={paths?.Length ?? 0}, fields={fields}");
+
+                VirtualDiskClientWrapper client = GetClient(driveGuid);
+
+                return EnumerationEntrySerializer.SerializeFileInfo(
+                    paths,
+                    client.GetFileInfos((paths ?? new string[0]).Select(NormalizePath).ToList()));
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"GetFileInfoBatch failed: {ex.Message}");
+                return EnumerationEntrySerializer.SerializeFileInfo(paths, null);
+            }
+        }
+    }
+}
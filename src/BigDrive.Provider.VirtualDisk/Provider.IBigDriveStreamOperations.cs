@@ -0,0 +1,39 @@
+// <copyright file="Provider.IBigDriveStreamOperations.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.VirtualDisk
+{
+    using System;
+    using System.Runtime.InteropServices.ComTypes;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveStreamOperations"/> for the VirtualDisk provider.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <inheritdoc/>
+        public void CopyStreamToBigDrive(Guid driveGuid, IStream stream, string bigDriveTargetPath, long size, long lastWriteTime)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"CopyStreamToBigDrive: {bigDriveTargetPath}, size={size}");
+
+                VirtualDiskClientWrapper client = GetClient(driveGuid);
+                DateTime? lastWriteTimeUtc = lastWriteTime > 0 ? DateTime.FromFileTimeUtc(lastWriteTime) : (DateTime?)null;
+
+                using (ComReadStream sourceStream = new ComReadStream(stream, size))
+                {
+                    client.WriteFile(NormalizePath(bigDriveTargetPath), sourceStream, lastWriteTimeUtc);
+                }
+
+                DefaultTraceSource.TraceInformation("CopyStreamToBigDrive: succeeded");
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"CopyStreamToBigDrive failed: {ex.Message}");
+                throw;
+            }
+        }
+    }
+}
@@ -32,9 +32,13 @@ namespace BigDrive.Provider.VirtualDisk
         IBigDriveDriveInfo,
         IBigDriveCapabilities,
         IBigDriveEnumerate,
+        IBigDriveEnumerateEx,
+        IBigDriveEnumeratePaged,
         IBigDriveFileInfo,
+        IBigDriveFileInfoBatch,
         IBigDriveFileData,
-        IBigDriveFileOperations
+        IBigDriveFileOperations,
+        IBigDriveStreamOperations
     {
         /// <summary>
         /// The trace source for logging.
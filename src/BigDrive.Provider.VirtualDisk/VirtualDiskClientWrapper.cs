@@ -11,6 +11,7 @@ namespace BigDrive.Provider.VirtualDisk
     using System.Threading;
 
     using BigDrive.ConfigProvider;
+    using BigDrive.Interfaces.Model;
 
     using DiscUtils;
     using DiscUtils.Partitions;
@@ -135,6 +136,62 @@ namespace BigDrive.Provider.VirtualDisk
                 .ToArray();
         }
 
+        /// <summary>
+        /// Gets the folders and files at the specified path, with their metadata.
+        /// </summary>
+        /// <param name="path">The path to enumerate.</param>
+        /// <param name="includeFolders">True to return folders.</param>
+        /// <param name="includeFiles">True to return files.</param>
+        /// <returns>The folders followed by the files at the specified path.</returns>
+        public List<EnumerationEntry> GetEntries(string path, bool includeFolders, bool includeFiles)
+        {
+            List<EnumerationEntry> entries = new List<EnumerationEntry>();
+
+            if (!m_fileSystem.DirectoryExists(path))
+            {
+                return entries;
+            }
+
+            DiscDirectoryInfo directoryInfo = m_fileSystem.GetDirectoryInfo(path);
+
+            if (includeFolders)
+            {
+                foreach (DiscDirectoryInfo folder in directoryInfo.GetDirectories())
+                {
+                    string folderName = folder.Name.TrimEnd('\\');
+                    if (!string.IsNullOrEmpty(folderName))
+                    {
+                        entries.Add(new EnumerationEntry
+                        {
+                            Name = folderName,
+                            IsFolder = true,
+                            LastWriteTime = folder.LastWriteTimeUtc,
+                            Attributes = folder.Attributes,
+                        });
+                    }
+                }
+            }
+
+            if (includeFiles)
+            {
+                foreach (DiscFileInfo file in directoryInfo.GetFiles())
+                {
+                    if (!string.IsNullOrEmpty(file.Name))
+                    {
+                        entries.Add(new EnumerationEntry
+                        {
+                            Name = file.Name,
+                            Size = (ulong)file.Length,
+                            LastWriteTime = file.LastWriteTimeUtc,
+                            Attributes = file.Attributes,
+                        });
+                    }
+                }
+            }
+
+            return entries;
+        }
+
         /// <summary>
         /// Opens a file for reading.
         /// </summary>
@@ -180,12 +237,61 @@ namespace BigDrive.Provider.VirtualDisk
             return m_fileSystem.GetFileInfo(path).LastWriteTimeUtc;
         }
 
+        /// <summary>
+        /// Gets the metadata of each of the specified files from the mounted file system.
+        /// </summary>
+        /// <param name="paths">The file paths.</param>
+        /// <returns>The metadata of each path, at the same index, or null where the disk has no such file.</returns>
+        public EnumerationEntry[] GetFileInfos(IList<string> paths)
+        {
+            EnumerationEntry[] results = new EnumerationEntry[paths.Count];
+
+            for (int i = 0; i < paths.Count; i++)
+            {
+                if (m_fileSystem.FileExists(paths[i]))
+                {
+                    DiscFileInfo file = m_fileSystem.GetFileInfo(paths[i]);
+
+                    results[i] = new EnumerationEntry
+                    {
+                        Size = (ulong)file.Length,
+                        LastWriteTime = file.LastWriteTimeUtc,
+                        Attributes = file.Attributes,
+                    };
+                }
+                else if (m_fileSystem.DirectoryExists(paths[i]))
+                {
+                    DiscDirectoryInfo folder = m_fileSystem.GetDirectoryInfo(paths[i]);
+
+                    results[i] = new EnumerationEntry
+                    {
+                        IsFolder = true,
+                        LastWriteTime = folder.LastWriteTimeUtc,
+                        Attributes = folder.Attributes,
+                    };
+                }
+            }
+
+            return results;
+        }
+
         /// <summary>
         /// Writes a file to the virtual disk.
         /// </summary>
         /// <param name="path">The target path.</param>
         /// <param name="sourceStream">The source stream to copy from.</param>
         public void WriteFile(string path, Stream sourceStream)
+        {
+            WriteFile(path, sourceStream, null);
+        }
+
+        /// <summary>
+        /// Writes a file to the virtual disk and sets its last write time.
+        /// </summary>
+        /// <param name="path">The target path.</param>
+        /// <param name="sourceStream">The source stream to copy from, read to its end.</param>
+        /// <param name="lastWriteTimeUtc">The file's last write time, or null to leave it at now.</param>
+        public void WriteFile(string path, Stream sourceStream, DateTime? lastWriteTimeUtc)
         {
             if (m_readOnly)
             {
@@ -200,7 +306,12 @@ namespace BigDrive.Provider.VirtualDisk
 
             using (Stream targetStream = m_fileSystem.OpenFile(path, FileMode.Create, FileAccess.Write))
             {
-                sourceStream.CopyTo(targetStream);
+                sourceStream.CopyTo(targetStream, ComReadStream.CopyBufferSize);
+            }
+
+            if (lastWriteTimeUtc.HasValue)
+            {
+                m_fileSystem.SetLastWriteTimeUtc(path, lastWriteTimeUtc.Value);
             }
         }
 
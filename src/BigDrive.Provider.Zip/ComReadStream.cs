@@ -0,0 +1,169 @@
+// <copyright file="ComReadStream.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Zip
+{
+    using System;
+    using System.IO;
+    using System.Runtime.InteropServices;
+    using System.Runtime.InteropServices.ComTypes;
+
+    using ComStatStg = System.Runtime.InteropServices.ComTypes.STATSTG;
+
+    /// <summary>
+    /// Wraps a COM IStream as a read-only, forward-only .NET Stream, the reverse of
+    /// <see cref="ComStream"/>. Used to read the data handed to CopyStreamToBigDrive.
+    /// </summary>
+    public class ComReadStream : Stream
+    {
+        /// <summary>
+        /// Buffer size to copy this stream with. Each read is a call to the caller's process, so
+        /// reads are made large.
+        /// </summary>
+        public const int CopyBufferSize = 1024 * 1024;
+
+        private readonly IStream _stream;
+
+        private readonly long _length;
+
+        /// <summary>
+        /// Receives the byte count of each IStream.Read; allocated once.
+        /// </summary>
+        private IntPtr _pcbRead;
+
+        private byte[] _buffer;
+
+        private long _position;
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="ComReadStream"/> class.
+        /// </summary>
+        /// <param name="stream">The stream to read.</param>
+        /// <param name="size">Size of the data, or -1 to ask the stream.</param>
+        public ComReadStream(IStream stream, long size)
+        {
+            _stream = stream ?? throw new ArgumentNullException(nameof(stream));
+            _length = size >= 0 ? size : GetStreamSize(stream);
+            _pcbRead = Marshal.AllocCoTaskMem(sizeof(int));
+        }
+
+        /// <inheritdoc/>
+        public override bool CanRead => _pcbRead != IntPtr.Zero;
+
+        /// <inheritdoc/>
+        public override bool CanSeek => false;
+
+        /// <inheritdoc/>
+        public override bool CanWrite => false;
+
+        /// <inheritdoc/>
+        public override long Length
+        {
+            get
+            {
+                if (_length < 0)
+                {
+                    throw new NotSupportedException();
+                }
+
+                return _length;
+            }
+        }
+
+        /// <inheritdoc/>
+        public override long Position
+        {
+            get { return _position; }
+            set { throw new NotSupportedException(); }
+        }
+
+        /// <inheritdoc/>
+        public override int Read(byte[] buffer, int offset, int count)
+        {
+            byte[] target = buffer;
+            int bytesRead = 0;
+
+            if (_pcbRead == IntPtr.Zero)
+            {
+                throw new ObjectDisposedException(nameof(ComReadStream));
+            }
+
+            // IStream.Read fills from the start of the array
+            if (offset != 0)
+            {
+                if ((_buffer == null) || (_buffer.Length < count))
+                {
+                    _buffer = new byte[count];
+                }
+
+                target = _buffer;
+            }
+
+            _stream.Read(target, count, _pcbRead);
+            bytesRead = Marshal.ReadInt32(_pcbRead);
+
+            if (offset != 0)
+            {
+                Buffer.BlockCopy(_buffer, 0, buffer, offset, bytesRead);
+            }
+
+            _position += bytesRead;
+
+            return bytesRead;
+        }
+
+        /// <inheritdoc/>
+        public override void Flush()
+        {
+        }
+
+        /// <inheritdoc/>
+        public override long Seek(long offset, SeekOrigin origin)
+        {
+            throw new NotSupportedException();
+        }
+
+        /// <inheritdoc/>
+        public override void SetLength(long value)
+        {
+            throw new NotSupportedException();
+        }
+
+        /// <inheritdoc/>
+        public override void Write(byte[] buffer, int offset, int count)
+        {
+            throw new NotSupportedException();
+        }
+
+        /// <inheritdoc/>
+        protected override void Dispose(bool disposing)
+        {
+            if (_pcbRead != IntPtr.Zero)
+            {
+                Marshal.FreeCoTaskMem(_pcbRead);
+                _pcbRead = IntPtr.Zero;
+            }
+
+            base.Dispose(disposing);
+        }
+
+        /// <summary>
+        /// Gets the size a stream reports, or -1 if it doesn't.
+        /// </summary>
+        /// <param name="stream">The stream.</param>
+        /// <returns>The size in bytes, or -1.</returns>
+        private static long GetStreamSize(IStream stream)
+        {
+            try
+            {
+                stream.Stat(out ComStatStg statstg, 1); // STATFLAG_NONAME
+                return statstg.cbSize;
+            }
+            catch (Exception)
+            {
+                return -1;
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+// <copyright file="Provider.IBigDriveEnumerateEx.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Zip
+{
+    using System;
+
+    using BigDrive.Interfaces.Model;
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveEnumerateEx"/> for the Zip provider.
+    /// Returns the folders and files at a path, with sizes and timestamps, from a single pass over the archive.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <summary>
+        /// Enumerates the folders and files at the specified path within the ZIP archive.
+        /// </summary>
+        /// <param name="driveGuid">The drive GUID.</param>
+        /// <param name="path">The path to enumerate.</param>
+        /// <param name="flags"><see cref="EnumerateEntriesFlags"/> bits.</param>
+        /// <returns>The packed entries.</returns>
+        public byte[] EnumerateEntries(Guid driveGuid, string path, int flags)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"EnumerateEntries: driveGuid={driveGuid}, path={path}, flags={flags}");
+
+                EnumerateEntriesFlags entryFlags = (EnumerateEntriesFlags)flags;
+                ZipClientWrapper zipClient = GetZipClient(driveGuid);
+
+                return EnumerationEntrySerializer.Serialize(zipClient.GetEntries(
+                    NormalizePath(path),
+                    (entryFlags & EnumerateEntriesFlags.Folders) != 0,
+                    (entryFlags & EnumerateEntriesFlags.Files) != 0));
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"EnumerateEntries failed: {ex.Message}");
+                return EnumerationEntrySerializer.Serialize(null);
+            }
+        }
+    }
+}
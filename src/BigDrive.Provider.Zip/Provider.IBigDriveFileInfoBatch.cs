@@ -0,0 +1,44 @@
+// <copyright file="Provider.IBigDriveFileInfoBatch.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Zip
+{
+    using System;
+    using System.Linq;
+
+    using BigDrive.Interfaces.Serialization;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveFileInfoBatch"/> for the Zip provider.
+    /// Answers the metadata of many entries from a single read of the archive's central directory.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <summary>
+        /// Gets the size, last modified time and attributes of each of the specified paths within the ZIP archive.
+        /// </summary>
+        /// <param name="driveGuid">The drive GUID.</param>
+        /// <param name="paths">The file paths (e.g., "\folder\file.txt").</param>
+        /// <param name="fields"><see cref="BigDrive.Interfaces.Model.FileInfoFields"/> bits. All are always returned.</param>
+        /// <returns>The packed records, one per path.</returns>
+        public byte[] GetFileInfoBatch(Guid driveGuid, string[] paths, int fields)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"GetFileInfoBatch: driveGuid={driveGuid}, paths={paths?.Length ?? 0}, fields={fields}");
+
+                ZipClientWrapper zipClient = GetZipClient(driveGuid);
+
+                return EnumerationEntrySerializer.SerializeFileInfo(
+                    paths,
+                    zipClient.GetFileInfos((paths ?? new string[0]).Select(NormalizePath).ToList()));
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"GetFileInfoBatch failed: {ex.Message}");
+                return EnumerationEntrySerializer.SerializeFileInfo(paths, null);
+            }
+        }
+    }
+}
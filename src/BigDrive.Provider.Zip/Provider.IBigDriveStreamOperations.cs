@@ -0,0 +1,48 @@
+// <copyright file="Provider.IBigDriveStreamOperations.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Provider.Zip
+{
+    using System;
+    using System.Runtime.InteropServices.ComTypes;
+
+    /// <summary>
+    /// Implementation of <see cref="BigDrive.Interfaces.IBigDriveStreamOperations"/> for the Zip provider.
+    /// Adds an entry to the ZIP archive straight from the caller's stream, without a temp file.
+    /// </summary>
+    public partial class Provider
+    {
+        /// <summary>
+        /// Copies the data of a stream to a file in the ZIP archive.
+        /// </summary>
+        /// <param name="driveGuid">The registered Drive Identifier.</param>
+        /// <param name="stream">The data, read to its end.</param>
+        /// <param name="bigDriveTargetPath">The full path of the file in BigDrive.</param>
+        /// <param name="size">Size of the data in bytes, or -1 if unknown.</param>
+        /// <param name="lastWriteTime">Last write time as a UTC FILETIME, or 0 if unknown.</param>
+        public void CopyStreamToBigDrive(Guid driveGuid, IStream stream, string bigDriveTargetPath, long size, long lastWriteTime)
+        {
+            try
+            {
+                DefaultTraceSource.TraceInformation($"CopyStreamToBigDrive: driveGuid={driveGuid}, targetPath={bigDriveTargetPath}, size={size}");
+
+                ZipClientWrapper zipClient = GetZipClient(driveGuid);
+                string normalizedPath = NormalizePath(bigDriveTargetPath);
+                DateTime? entryTime = lastWriteTime > 0 ? DateTime.FromFileTimeUtc(lastWriteTime).ToLocalTime() : (DateTime?)null;
+
+                using (ComReadStream sourceStream = new ComReadStream(stream, size))
+                {
+                    zipClient.AddStream(sourceStream, normalizedPath, entryTime);
+                }
+
+                DefaultTraceSource.TraceInformation($"CopyStreamToBigDrive: File added to ZIP archive: {normalizedPath}");
+            }
+            catch (Exception ex)
+            {
+                DefaultTraceSource.TraceError($"CopyStreamToBigDrive failed: {ex.Message}");
+                throw;
+            }
+        }
+    }
+}
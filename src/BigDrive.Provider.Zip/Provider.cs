@@ -28,9 +28,13 @@ namespace BigDrive.Provider.Zip
         IProcessInitializer,
         IBigDriveRegistration,
         IBigDriveEnumerate,
+        IBigDriveEnumerateEx,
+        IBigDriveEnumeratePaged,
         IBigDriveFileInfo,
+        IBigDriveFileInfoBatch,
         IBigDriveFileData,
         IBigDriveFileOperations,
+        IBigDriveStreamOperations,
         IBigDriveDriveInfo,
         IBigDriveCapabilities
     {
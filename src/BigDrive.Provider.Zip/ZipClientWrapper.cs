@@ -13,6 +13,7 @@ namespace BigDrive.Provider.Zip
     using System.Threading;
 
     using BigDrive.ConfigProvider;
+    using BigDrive.Interfaces.Model;
 
     /// <summary>
     /// Wrapper for reading ZIP archive contents.
@@ -183,6 +184,72 @@ namespace BigDrive.Provider.Zip
             return files.ToArray();
         }
 
+        /// <summary>
+        /// Gets the folders and files at the specified path, with their metadata, reading the archive once.
+        /// </summary>
+        /// <param name="normalizedPath">The normalized path (forward slashes, no leading/trailing separators). Empty string for root.</param>
+        /// <param name="includeFolders">True to return folders.</param>
+        /// <param name="includeFiles">True to return files.</param>
+        /// <returns>The folders followed by the files at the specified path.</returns>
+        public List<EnumerationEntry> GetEntries(string normalizedPath, bool includeFolders, bool includeFiles)
+        {
+            List<EnumerationEntry> folders = new List<EnumerationEntry>();
+            List<EnumerationEntry> files = new List<EnumerationEntry>();
+
+            if (string.IsNullOrEmpty(_zipFilePath) || !File.Exists(_zipFilePath))
+            {
+                return folders;
+            }
+
+            string prefix = string.IsNullOrEmpty(normalizedPath) ? "" : normalizedPath + "/";
+            HashSet<string> folderNames = new HashSet<string>(StringComparer.OrdinalIgnoreCase);
+
+            using (ZipArchive archive = ZipFile.OpenRead(_zipFilePath))
+            {
+                foreach (ZipArchiveEntry entry in archive.Entries)
+                {
+                    string fullName = entry.FullName.Replace('\\', '/');
+
+                    // Skip entries that are not under the current path
+                    if (!string.IsNullOrEmpty(prefix) && !fullName.StartsWith(prefix, StringComparison.OrdinalIgnoreCase))
+                    {
+                        continue;
+                    }
+
+                    string relativePath = string.IsNullOrEmpty(prefix) ? fullName : fullName.Substring(prefix.Length);
+                    int slashIndex = relativePath.IndexOf('/');
+
+                    if (slashIndex > 0)
+                    {
+                        // The first segment is a folder at this level
+                        string folderName = SanitizeName(relativePath.Substring(0, slashIndex));
+                        if (includeFolders && folderNames.Add(folderName))
+                        {
+                            folders.Add(new EnumerationEntry
+                            {
+                                Name = folderName,
+                                IsFolder = true,
+                                Attributes = FileAttributes.Directory,
+                            });
+                        }
+                    }
+                    else if (includeFiles && slashIndex < 0 && !string.IsNullOrEmpty(relativePath))
+                    {
+                        files.Add(new EnumerationEntry
+                        {
+                            Name = SanitizeName(relativePath),
+                            Size = (ulong)entry.Length,
+                            LastWriteTime = entry.LastWriteTime.DateTime,
+                            Attributes = FileAttributes.Archive,
+                        });
+                    }
+                }
+            }
+
+            folders.AddRange(files);
+            return folders;
+        }
+
         /// <summary>
         /// Gets the last modified time for the specified file entry in the ZIP archive.
         /// </summary>
@@ -231,6 +298,56 @@ namespace BigDrive.Provider.Zip
             return 0;
         }
 
+        /// <summary>
+        /// Gets the metadata of each of the specified entries, reading the archive once.
+        /// </summary>
+        /// <param name="normalizedPaths">The normalized entry paths within the archive.</param>
+        /// <returns>The metadata of each path, at the same index, or null where the archive has no such entry.</returns>
+        public EnumerationEntry[] GetFileInfos(IList<string> normalizedPaths)
+        {
+            EnumerationEntry[] results = new EnumerationEntry[normalizedPaths.Count];
+
+            if (string.IsNullOrEmpty(_zipFilePath) || !File.Exists(_zipFilePath))
+            {
+                return results;
+            }
+
+            using (ZipArchive archive = ZipFile.OpenRead(_zipFilePath))
+            {
+                // One index of the central directory rather than a FindEntry scan per path
+                Dictionary<string, ZipArchiveEntry> entries = new Dictionary<string, ZipArchiveEntry>(StringComparer.OrdinalIgnoreCase);
+                foreach (ZipArchiveEntry entry in archive.Entries)
+                {
+                    string fullName = entry.FullName.Replace('\\', '/').TrimEnd('/');
+                    if (!entries.ContainsKey(fullName))
+                    {
+                        entries.Add(fullName, entry);
+                    }
+                }
+
+                for (int i = 0; i < normalizedPaths.Count; i++)
+                {
+                    ZipArchiveEntry entry;
+                    if (string.IsNullOrEmpty(normalizedPaths[i]) || !entries.TryGetValue(normalizedPaths[i], out entry))
+                    {
+                        continue;
+                    }
+
+                    bool isFolder = entry.FullName.EndsWith("/", StringComparison.Ordinal) || entry.FullName.EndsWith("\\", StringComparison.Ordinal);
+
+                    results[i] = new EnumerationEntry
+                    {
+                        IsFolder = isFolder,
+                        Size = isFolder ? (ulong?)null : (ulong)entry.Length,
+                        LastWriteTime = entry.LastWriteTime.DateTime,
+                        Attributes = isFolder ? FileAttributes.Directory : FileAttributes.Archive,
+                    };
+                }
+            }
+
+            return results;
+        }
+
         /// <summary>
         /// Gets the file data for the specified file entry in the ZIP archive.
         /// </summary>
@@ -317,6 +434,40 @@ namespace BigDrive.Provider.Zip
             }
         }
 
+        /// <summary>
+        /// Adds a file to the ZIP archive from a stream, replacing the entry if it exists.
+        /// </summary>
+        /// <param name="sourceStream">The data, read to its end.</param>
+        /// <param name="normalizedPath">The normalized path within the archive (forward slashes).</param>
+        /// <param name="lastWriteTime">The entry's last write time, or null for now.</param>
+        public void AddStream(Stream sourceStream, string normalizedPath, DateTime? lastWriteTime)
+        {
+            if (string.IsNullOrEmpty(_zipFilePath) || !File.Exists(_zipFilePath))
+            {
+                throw new FileNotFoundException("ZIP file not found: " + _zipFilePath);
+            }
+
+            using (ZipArchive archive = ZipFile.Open(_zipFilePath, ZipArchiveMode.Update))
+            {
+                ZipArchiveEntry existingEntry = archive.GetEntry(normalizedPath);
+                if (existingEntry != null)
+                {
+                    existingEntry.Delete();
+                }
+
+                ZipArchiveEntry entry = archive.CreateEntry(normalizedPath, CompressionLevel.Optimal);
+                if (lastWriteTime.HasValue)
+                {
+                    entry.LastWriteTime = lastWriteTime.Value;
+                }
+
+                using (Stream entryStream = entry.Open())
+                {
+                    sourceStream.CopyTo(entryStream, ComReadStream.CopyBufferSize);
+                }
+            }
+        }
+
         /// <summary>
         /// Deletes an entry (file or directory) from the ZIP archive.
         /// </summary>
@@ -194,6 +194,7 @@ namespace BigDrive.Shell
             RegisterCommand(new LabelCommand());
             RegisterCommand(new MountCommand());
             RegisterCommand(new UnmountCommand());
+            RegisterCommand(new StatsCommand());
         }
 
         /// <summary>
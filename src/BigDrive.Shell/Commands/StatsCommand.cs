@@ -0,0 +1,214 @@
+// <copyright file="StatsCommand.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Shell.Commands
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Diagnostics;
+    using System.Linq;
+    using System.Threading;
+
+    /// <summary>
+    /// Attaches to the performance counters published by processes running the BigDrive shell
+    /// folder (typically explorer.exe), samples them twice and prints totals and rates.
+    /// </summary>
+    public class StatsCommand : ICommand
+    {
+        /// <summary>
+        /// Seconds between the two samples when none is given.
+        /// </summary>
+        private const int DefaultIntervalSeconds = 1;
+
+        /// <summary>
+        /// Gets the primary name of the command.
+        /// </summary>
+        public string Name
+        {
+            get { return "stats"; }
+        }
+
+        /// <summary>
+        /// Gets the command aliases.
+        /// </summary>
+        public string[] Aliases
+        {
+            get { return new string[] { }; }
+        }
+
+        /// <summary>
+        /// Gets the command description.
+        /// </summary>
+        public string Description
+        {
+            get { return "Shows shell folder performance counters and rates"; }
+        }
+
+        /// <summary>
+        /// Gets the usage syntax.
+        /// </summary>
+        public string Usage
+        {
+            get { return "stats [process id] [-i seconds]"; }
+        }
+
+        /// <summary>
+        /// Executes the stats command.
+        /// </summary>
+        /// <param name="context">The shell context.</param>
+        /// <param name="args">The command arguments.</param>
+        public void Execute(ShellContext context, string[] args)
+        {
+            int processId = 0;
+            int intervalSeconds = DefaultIntervalSeconds;
+
+            for (int i = 0; i < args.Length; i++)
+            {
+                if (string.Equals(args[i], "-i", StringComparison.OrdinalIgnoreCase) && (i + 1 < args.Length))
+                {
+                    if (!int.TryParse(args[++i], out intervalSeconds) || (intervalSeconds < 1))
+                    {
+                        Console.WriteLine("Invalid interval: {0}", args[i]);
+                        Console.WriteLine("Usage: {0}", Usage);
+                        return;
+                    }
+                }
+                else if (!int.TryParse(args[i], out processId))
+                {
+                    Console.WriteLine("Invalid process id: {0}", args[i]);
+                    Console.WriteLine("Usage: {0}", Usage);
+                    return;
+                }
+            }
+
+            Dictionary<int, PerformanceCounterSnapshot> first = ReadSnapshots(processId);
+            if (first.Count == 0)
+            {
+                if (processId != 0)
+                {
+                    Console.WriteLine("Process {0} publishes no BigDrive counters.", processId);
+                }
+                else
+                {
+                    Console.WriteLine("No process publishes BigDrive counters.");
+                    Console.WriteLine("Counters appear once Explorer has loaded the shell folder.");
+                }
+
+                return;
+            }
+
+            Thread.Sleep(TimeSpan.FromSeconds(intervalSeconds));
+
+            Dictionary<int, PerformanceCounterSnapshot> second = ReadSnapshots(processId);
+
+            foreach (int id in first.Keys.OrderBy(id => id))
+            {
+                PerformanceCounterSnapshot after;
+                if (!second.TryGetValue(id, out after))
+                {
+                    Console.WriteLine("Process {0} exited while sampling.", id);
+                    Console.WriteLine();
+                    continue;
+                }
+
+                PrintSnapshot(first[id], after);
+            }
+        }
+
+        /// <summary>
+        /// Reads the counters of one process, or of every process that publishes them.
+        /// </summary>
+        /// <param name="processId">The process ID, or zero for every process.</param>
+        /// <returns>The snapshots, by process ID.</returns>
+        private static Dictionary<int, PerformanceCounterSnapshot> ReadSnapshots(int processId)
+        {
+            Dictionary<int, PerformanceCounterSnapshot> snapshots = new Dictionary<int, PerformanceCounterSnapshot>();
+            IEnumerable<int> processIds;
+
+            if (processId != 0)
+            {
+                processIds = new int[] { processId };
+            }
+            else
+            {
+                // Any process can host the shell folder (Explorer, file dialogs, dllhost)
+                processIds = Process.GetProcesses().Select(p => p.Id).ToList();
+            }
+
+            foreach (int id in processIds)
+            {
+                PerformanceCounterSnapshot snapshot = PerformanceCounterSnapshot.TryRead(id);
+                if (snapshot != null)
+                {
+                    snapshots[id] = snapshot;
+                }
+            }
+
+            return snapshots;
+        }
+
+        /// <summary>
+        /// Prints the counters of one process with their rates between two snapshots.
+        /// </summary>
+        /// <param name="before">The first snapshot.</param>
+        /// <param name="after">The second snapshot.</param>
+        private static void PrintSnapshot(PerformanceCounterSnapshot before, PerformanceCounterSnapshot after)
+        {
+            double seconds = (double)(after.Timestamp - before.Timestamp) / Stopwatch.Frequency;
+            TimeSpan uptime = DateTime.UtcNow - after.StartTime;
+
+            Console.WriteLine("{0} (pid {1}), counting for {2:%d}d {2:hh\\:mm\\:ss}", GetProcessName(after.ProcessId), after.ProcessId, uptime);
+            Console.WriteLine();
+            Console.WriteLine("  {0,-30} {1,16} {2,12}", "Counter", "Value", "Per second");
+
+            for (int i = 0; i < PerformanceCounterSnapshot.CounterNames.Length; i++)
+            {
+                if (PerformanceCounterSnapshot.IsGauge(i))
+                {
+                    Console.WriteLine("  {0,-30} {1,16:N0}", PerformanceCounterSnapshot.CounterNames[i], after.Counters[i]);
+                }
+                else
+                {
+                    Console.WriteLine("  {0,-30} {1,16:N0} {2,12:N1}", PerformanceCounterSnapshot.CounterNames[i], after.Counters[i], (after.Counters[i] - before.Counters[i]) / seconds);
+                }
+            }
+
+            if (after.ProviderCalls.Count > 0)
+            {
+                Console.WriteLine();
+                Console.WriteLine("  {0,-46} {1,16} {2,12}", "Provider call", "Calls", "Per second");
+
+                foreach (KeyValuePair<string, long> call in after.ProviderCalls.OrderByDescending(c => c.Value))
+                {
+                    long previous;
+                    before.ProviderCalls.TryGetValue(call.Key, out previous);
+
+                    Console.WriteLine("  {0,-46} {1,16:N0} {2,12:N1}", call.Key, call.Value, (call.Value - previous) / seconds);
+                }
+            }
+
+            Console.WriteLine();
+        }
+
+        /// <summary>
+        /// Gets the name of a process.
+        /// </summary>
+        /// <param name="processId">The process ID.</param>
+        /// <returns>The process name, or "?" if it has exited.</returns>
+        private static string GetProcessName(int processId)
+        {
+            try
+            {
+                using (Process process = Process.GetProcessById(processId))
+                {
+                    return process.ProcessName + ".exe";
+                }
+            }
+            catch (ArgumentException)
+            {
+                return "?";
+            }
+        }
+    }
+}
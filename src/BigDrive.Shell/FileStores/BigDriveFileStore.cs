@@ -56,6 +56,14 @@ namespace BigDrive.Shell.FileStores
             get { return ProviderFactory.GetFileOperationsProvider(m_config.Id) != null; }
         }
 
+        /// <summary>
+        /// Gets a value indicating whether this store can upload from a stream without a temp file.
+        /// </summary>
+        public bool SupportsStreamUpload
+        {
+            get { return ProviderFactory.GetStreamOperationsProvider(m_config.Id) != null; }
+        }
+
         /// <summary>
         /// Gets a value indicating whether this store supports file enumeration.
         /// </summary>
@@ -200,6 +208,81 @@ namespace BigDrive.Shell.FileStores
             ShellTrace.ComResult("IBigDriveFileOperations", "CopyFileToBigDrive", 0);
         }
 
+        /// <summary>
+        /// Opens a BigDrive file for reading through IBigDriveFileData.
+        /// </summary>
+        /// <param name="sourcePath">The source path within the BigDrive.</param>
+        /// <param name="size">Receives the file size, or -1 if the provider doesn't report it.</param>
+        /// <param name="lastWriteTime">Receives the last write time as a UTC FILETIME, or 0 if unknown.</param>
+        /// <returns>The stream, or null if the provider doesn't support IBigDriveFileData.</returns>
+        public IStream OpenRead(string sourcePath, out long size, out long lastWriteTime)
+        {
+            size = -1;
+            lastWriteTime = 0;
+
+            IBigDriveFileData fileData = ProviderFactory.GetFileDataProvider(m_config.Id);
+            if (fileData == null)
+            {
+                return null;
+            }
+
+            // Size and time are only hints for the destination; a provider that can't give them still copies
+            IBigDriveFileInfo fileInfo = ProviderFactory.GetFileInfoProvider(m_config.Id);
+            if (fileInfo != null)
+            {
+                try
+                {
+                    size = (long)fileInfo.GetFileSize(m_config.Id, sourcePath);
+
+                    DateTime lastModified = fileInfo.LastModifiedTime(m_config.Id, sourcePath);
+                    if (lastModified > DateTime.MinValue)
+                    {
+                        lastWriteTime = lastModified.ToFileTimeUtc();
+                    }
+                }
+                catch (Exception ex)
+                {
+                    ShellTrace.Verbose("File info unavailable for \"{0}\": {1}", sourcePath, ex.Message);
+                    size = -1;
+                    lastWriteTime = 0;
+                }
+            }
+
+            ShellTrace.ComCall("IBigDriveFileData", "GetFileData",
+                string.Format("driveGuid={0}, path=\"{1}\"", m_config.Id, sourcePath));
+            int hr = fileData.GetFileData(m_config.Id, sourcePath, out IStream stream);
+            ShellTrace.ComResult("IBigDriveFileData", "GetFileData", hr,
+                stream != null ? "stream returned" : "stream is null");
+
+            if (hr != 0)
+            {
+                throw new IOException("Failed to get file data. HRESULT: 0x" + hr.ToString("X8"));
+            }
+
+            return stream;
+        }
+
+        /// <summary>
+        /// Copies the data of a stream into the BigDrive, without a temp file.
+        /// </summary>
+        /// <param name="stream">The data, read to its end.</param>
+        /// <param name="destinationPath">The destination file path within the BigDrive.</param>
+        /// <param name="size">Size of the data, or -1 if unknown.</param>
+        /// <param name="lastWriteTime">Last write time as a UTC FILETIME, or 0 if unknown.</param>
+        public void CopyFromStream(IStream stream, string destinationPath, long size, long lastWriteTime)
+        {
+            IBigDriveStreamOperations streamOps = ProviderFactory.GetStreamOperationsProvider(m_config.Id);
+            if (streamOps == null)
+            {
+                throw new InvalidOperationException("Provider does not support stream uploads.");
+            }
+
+            ShellTrace.ComCall("IBigDriveStreamOperations", "CopyStreamToBigDrive",
+                string.Format("driveGuid={0}, destPath=\"{1}\", size={2}", m_config.Id, destinationPath, size));
+            streamOps.CopyStreamToBigDrive(m_config.Id, stream, destinationPath, size, lastWriteTime);
+            ShellTrace.ComResult("IBigDriveStreamOperations", "CopyStreamToBigDrive", 0);
+        }
+
         /// <summary>
         /// Deletes a file from the BigDrive.
         /// </summary>
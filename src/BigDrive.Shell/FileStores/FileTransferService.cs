@@ -8,6 +8,8 @@ namespace BigDrive.Shell.FileStores
     using System.Collections.Generic;
     using System.IO;
     using System.Linq;
+    using System.Runtime.InteropServices;
+    using System.Runtime.InteropServices.ComTypes;
 
     /// <summary>
     /// Performs file transfer operations between any two IFileStore instances.
@@ -18,7 +20,8 @@ namespace BigDrive.Shell.FileStores
     {
         /// <summary>
         /// Copies a single file from source store to destination store.
-        /// Uses a local temp file as intermediary when stores differ.
+        /// Between two BigDrives, streams from one provider to the other when the destination
+        /// supports it, and otherwise uses a local temp file as intermediary.
         /// </summary>
         /// <param name="source">The source file store.</param>
         /// <param name="sourcePath">The source file path within the store.</param>
@@ -49,6 +52,10 @@ namespace BigDrive.Shell.FileStores
                 string localFullPath = ((LocalFileStore)destination).ToPublicFullPath(destinationPath);
                 source.CopyToLocal(sourcePath, localFullPath);
             }
+            else if (TryCopyViaStream(source, sourcePath, destination, destinationPath))
+            {
+                // BigDrive to BigDrive: the destination read the source's stream directly
+            }
             else
             {
                 // BigDrive to BigDrive (same or cross-provider): use temp file as intermediary.
@@ -141,6 +148,46 @@ namespace BigDrive.Shell.FileStores
             return basePath.TrimEnd('\\') + "\\" + fileName;
         }
 
+        /// <summary>
+        /// Copies a file between two BigDrives by handing the source's IBigDriveFileData stream to
+        /// the destination's IBigDriveStreamOperations. The data goes from one provider to the
+        /// other without being written to and read back from a temp file.
+        /// </summary>
+        /// <param name="source">The source file store.</param>
+        /// <param name="sourcePath">The source path within the store.</param>
+        /// <param name="destination">The destination file store.</param>
+        /// <param name="destinationPath">The destination path within the store.</param>
+        /// <returns>True if copied; false if either provider lacks the interface it needs.</returns>
+        private static bool TryCopyViaStream(IFileStore source, string sourcePath, IFileStore destination, string destinationPath)
+        {
+            BigDriveFileStore sourceStore = source as BigDriveFileStore;
+            BigDriveFileStore destinationStore = destination as BigDriveFileStore;
+
+            if (sourceStore == null || destinationStore == null || !destinationStore.SupportsStreamUpload)
+            {
+                return false;
+            }
+
+            IStream stream = sourceStore.OpenRead(sourcePath, out long size, out long lastWriteTime);
+            if (stream == null)
+            {
+                return false;
+            }
+
+            try
+            {
+                ShellTrace.Verbose("Streaming \"{0}\" without a temp file, size={1}", sourcePath, size);
+                destinationStore.CopyFromStream(stream, destinationPath, size, lastWriteTime);
+            }
+            finally
+            {
+                // Frees the source provider's copy of the data now rather than at the next GC
+                Marshal.ReleaseComObject(stream);
+            }
+
+            return true;
+        }
+
         /// <summary>
         /// Copies a file via a local temp file, preserving the target filename.
         /// Creates a unique temp directory so the local file sent to the provider
@@ -0,0 +1,218 @@
+// <copyright file="PerformanceCounterSnapshot.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Shell
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Diagnostics;
+    using System.IO;
+    using System.IO.MemoryMappedFiles;
+    using System.Text;
+
+    /// <summary>
+    /// A copy of the performance counters a process running the BigDrive shell folder publishes in
+    /// shared memory (BigDrivePerformanceCounters in BigDrive.Client). The offsets mirror
+    /// BigDriveCounterBlock; change both together.
+    /// </summary>
+    public class PerformanceCounterSnapshot
+    {
+        /// <summary>
+        /// "BDPC", the block's signature.
+        /// </summary>
+        public const uint Signature = 0x43504442;
+
+        /// <summary>
+        /// The block layout this reader understands.
+        /// </summary>
+        public const uint Version = 1;
+
+        /// <summary>
+        /// Size of the block in bytes.
+        /// </summary>
+        public const int BlockSize = CountersOffset + (MaxCounters * 8) + (MaxProviderCalls * ProviderCallSize);
+
+        /// <summary>
+        /// Display names of the counters, in BigDriveCounter order.
+        /// </summary>
+        public static readonly string[] CounterNames = new string[]
+        {
+            "Provider calls",
+            "Provider calls in flight",
+            "Provider call failures",
+            "Config lookups",
+            "Config cache hits",
+            "Config cache misses",
+            "Listing cache hits",
+            "Listing cache misses",
+            "Icon cache hits",
+            "Icon cache misses",
+            "Connection pool hits",
+            "Connection pool misses",
+            "Bytes streamed",
+            "Live ShellFolders",
+            "Live EnumIDLists",
+            "Live DataObjects",
+            "Metadata requests",
+            "Metadata batches",
+            "Provider calls shared",
+        };
+
+        /// <summary>
+        /// Counters that hold a current level rather than a running total; they have no rate.
+        /// </summary>
+        private static readonly bool[] s_isGauge = new bool[]
+        {
+            false, true, false, false, false, false, false, false,
+            false, false, false, false, false, true, true, true,
+            false, false, false,
+        };
+
+        private const int CountersOffset = 64;
+        private const int MaxCounters = 32;
+        private const int MaxProviderCalls = 64;
+        private const int ProviderCallSize = 64;
+        private const int ProviderCallNameOffset = 8;
+        private const int ProviderCallNameSize = 48;
+        private const int ProviderCallCallsOffset = 56;
+
+        /// <summary>
+        /// Format of the block's name; the argument is the process ID.
+        /// </summary>
+        private const string MappingNameFormat = "Local\\BigDrive.Counters.{0}";
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="PerformanceCounterSnapshot"/> class.
+        /// </summary>
+        private PerformanceCounterSnapshot()
+        {
+            ProviderCalls = new Dictionary<string, long>(StringComparer.Ordinal);
+        }
+
+        /// <summary>
+        /// Gets the ID of the process that published the counters.
+        /// </summary>
+        public int ProcessId { get; private set; }
+
+        /// <summary>
+        /// Gets when the process created the counters, in UTC.
+        /// </summary>
+        public DateTime StartTime { get; private set; }
+
+        /// <summary>
+        /// Gets the counter values, indexed as <see cref="CounterNames"/>.
+        /// </summary>
+        public long[] Counters { get; private set; }
+
+        /// <summary>
+        /// Gets the calls made to each provider method, by "Interface::Method" name.
+        /// </summary>
+        public Dictionary<string, long> ProviderCalls { get; private set; }
+
+        /// <summary>
+        /// Gets the <see cref="Stopwatch"/> timestamp of when the snapshot was taken.
+        /// </summary>
+        public long Timestamp { get; private set; }
+
+        /// <summary>
+        /// Determines whether a counter holds a current level rather than a running total.
+        /// </summary>
+        /// <param name="index">The counter index.</param>
+        /// <returns>True for a level.</returns>
+        public static bool IsGauge(int index)
+        {
+            return (index >= 0) && (index < s_isGauge.Length) && s_isGauge[index];
+        }
+
+        /// <summary>
+        /// Reads the counters a process publishes.
+        /// </summary>
+        /// <param name="processId">The process ID.</param>
+        /// <returns>The snapshot, or null if the process publishes no counters this reader understands.</returns>
+        public static PerformanceCounterSnapshot TryRead(int processId)
+        {
+            string name = string.Format(MappingNameFormat, processId);
+            byte[] data = new byte[BlockSize];
+
+            try
+            {
+                using (MemoryMappedFile mappedFile = MemoryMappedFile.OpenExisting(name, MemoryMappedFileRights.Read))
+                using (MemoryMappedViewAccessor accessor = mappedFile.CreateViewAccessor(0, BlockSize, MemoryMappedFileAccess.Read))
+                {
+                    accessor.ReadArray(0, data, 0, data.Length);
+                }
+            }
+            catch (FileNotFoundException)
+            {
+                return null;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                // Another user's process, or an elevated one
+                return null;
+            }
+            catch (IOException)
+            {
+                return null;
+            }
+
+            return Parse(data);
+        }
+
+        /// <summary>
+        /// Parses a copy of a counter block.
+        /// </summary>
+        /// <param name="data">The block.</param>
+        /// <returns>The snapshot, or null if the block is too short or of another layout.</returns>
+        public static PerformanceCounterSnapshot Parse(byte[] data)
+        {
+            if ((data == null) || (data.Length < BlockSize))
+            {
+                return null;
+            }
+
+            if ((BitConverter.ToUInt32(data, 0) != Signature) || (BitConverter.ToUInt32(data, 4) != Version))
+            {
+                return null;
+            }
+
+            PerformanceCounterSnapshot snapshot = new PerformanceCounterSnapshot();
+            snapshot.Timestamp = Stopwatch.GetTimestamp();
+            snapshot.ProcessId = (int)BitConverter.ToUInt32(data, 12);
+            snapshot.StartTime = DateTime.FromFileTimeUtc(BitConverter.ToInt64(data, 16));
+
+            int counterCount = Math.Min((int)BitConverter.ToUInt32(data, 24), Math.Min(MaxCounters, CounterNames.Length));
+            snapshot.Counters = new long[CounterNames.Length];
+
+            for (int i = 0; i < counterCount; i++)
+            {
+                snapshot.Counters[i] = BitConverter.ToInt64(data, CountersOffset + (i * 8));
+            }
+
+            int providerCallsOffset = CountersOffset + (MaxCounters * 8);
+
+            for (int i = 0; i < MaxProviderCalls; i++)
+            {
+                int offset = providerCallsOffset + (i * ProviderCallSize);
+
+                // A slot is named once its flag is set; a free or half-written slot is skipped
+                if ((BitConverter.ToInt32(data, offset) == 0) || (BitConverter.ToInt32(data, offset + 4) == 0))
+                {
+                    continue;
+                }
+
+                int length = Array.IndexOf(data, (byte)0, offset + ProviderCallNameOffset, ProviderCallNameSize) - (offset + ProviderCallNameOffset);
+                if (length < 0)
+                {
+                    length = ProviderCallNameSize;
+                }
+
+                string callName = Encoding.ASCII.GetString(data, offset + ProviderCallNameOffset, length);
+                snapshot.ProviderCalls[callName] = BitConverter.ToInt64(data, offset + ProviderCallCallsOffset);
+            }
+
+            return snapshot;
+        }
+    }
+}
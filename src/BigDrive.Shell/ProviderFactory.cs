@@ -68,6 +68,20 @@ namespace BigDrive.Shell
             return fileOps;
         }
 
+        /// <summary>
+        /// Creates an IBigDriveStreamOperations instance for the specified drive.
+        /// </summary>
+        /// <param name="driveGuid">The drive GUID.</param>
+        /// <returns>The IBigDriveStreamOperations interface, or null if not available.</returns>
+        public static IBigDriveStreamOperations GetStreamOperationsProvider(Guid driveGuid)
+        {
+            ShellTrace.Verbose("GetStreamOperationsProvider(driveGuid={0})", driveGuid);
+            object provider = GetProviderInstance(driveGuid);
+            IBigDriveStreamOperations streamOps = provider as IBigDriveStreamOperations;
+            ShellTrace.Verbose("IBigDriveStreamOperations: {0}", streamOps != null ? "available" : "not supported");
+            return streamOps;
+        }
+
         /// <summary>
         /// Creates an IBigDriveFileData instance for the specified drive.
         /// </summary>
@@ -0,0 +1,139 @@
+// <copyright file="BigDriveAsyncEnumIDList-IEnumIDList.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements IEnumIDList for the BigDriveAsyncEnumIDList class.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDriveAsyncEnumIDList.h"
+#include "BigDriveAsyncEnumeration.h"
+#include <shlobj.h>
+
+/// <summary>
+/// Retrieves the PIDLs the worker has produced so far, up to celt.
+/// </summary>
+HRESULT __stdcall BigDriveAsyncEnumIDList::Next(ULONG celt, LPITEMIDLIST* rgelt, ULONG* pceltFetched)
+{
+    HRESULT hr = S_OK;
+    ULONG fetched = 0;
+
+    if (!rgelt) return E_POINTER;
+
+    if ((celt > 1) && (pceltFetched == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (pceltFetched)
+    {
+        *pceltFetched = 0;
+    }
+
+    if ((m_pEnumeration == nullptr) || (celt == 0))
+    {
+        return S_FALSE;
+    }
+
+    // Items an earlier Skip is still owed come off the queue first
+    hr = DiscardOwed();
+    if (hr != S_OK)
+    {
+        return hr;
+    }
+
+    hr = m_pEnumeration->Pop(celt, rgelt, fetched, PendingWaitMs);
+    switch (hr)
+    {
+    case S_OK:
+        // A short batch is still S_OK; S_FALSE would tell the view the folder has ended
+        break;
+    case E_PENDING:
+        m_fPending = TRUE;
+        break;
+    default:
+        m_fEnded = TRUE;
+        break;
+    }
+
+    if (pceltFetched)
+    {
+        *pceltFetched = fetched;
+    }
+
+    return hr;
+}
+
+/// <summary>
+/// Skips the specified number of items, returning E_PENDING rather than waiting for the worker.
+/// </summary>
+HRESULT __stdcall BigDriveAsyncEnumIDList::Skip(ULONG celt)
+{
+    if (m_pEnumeration == nullptr)
+    {
+        return S_FALSE;
+    }
+
+    m_cOwed = (celt > ULONG_MAX - m_cOwed) ? ULONG_MAX : m_cOwed + celt;
+
+    return DiscardOwed();
+}
+
+/// <summary>
+/// Not supported; the items already handed out are gone from the queue.
+/// </summary>
+HRESULT __stdcall BigDriveAsyncEnumIDList::Reset()
+{
+    return E_NOTIMPL;
+}
+
+/// <summary>
+/// Not supported; the worker feeds a single reader.
+/// </summary>
+HRESULT __stdcall BigDriveAsyncEnumIDList::Clone(IEnumIDList** ppenum)
+{
+    if (!ppenum) return E_POINTER;
+
+    *ppenum = nullptr;
+    return E_NOTIMPL;
+}
+
+/// <summary>
+/// Discards the items still owed to an earlier Skip.
+/// </summary>
+HRESULT BigDriveAsyncEnumIDList::DiscardOwed()
+{
+    HRESULT hr = S_OK;
+    LPITEMIDLIST apidl[SkipBatchSize] = {};
+    ULONG fetched = 0;
+
+    while (m_cOwed > 0)
+    {
+        hr = m_pEnumeration->Pop((m_cOwed < SkipBatchSize) ? m_cOwed : SkipBatchSize, apidl, fetched, PendingWaitMs);
+
+        for (ULONG i = 0; i < fetched; ++i)
+        {
+            ::ILFree(apidl[i]);
+            apidl[i] = nullptr;
+        }
+
+        m_cOwed -= fetched;
+
+        if (hr == E_PENDING)
+        {
+            m_fPending = TRUE;
+            return hr;
+        }
+
+        if (hr != S_OK)
+        {
+            // Nothing is left to skip once the worker is done
+            m_cOwed = 0;
+            m_fEnded = TRUE;
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,63 @@
+// <copyright file="BigDriveAsyncEnumIDList.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements the BigDriveAsyncEnumIDList class, the IEnumIDList handed to views that
+//   pass SHCONTF_ENABLE_ASYNC to EnumObjects.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDriveAsyncEnumIDList.h"
+#include "BigDriveAsyncEnumeration.h"
+#include "..\BigDrive.Client\BigDrivePerformanceCounters.h"
+
+/// <inheritdoc />
+BigDriveAsyncEnumIDList::BigDriveAsyncEnumIDList()
+    : m_refCount(1), m_pEnumeration(nullptr), m_fPending(FALSE), m_fEnded(FALSE), m_cOwed(0)
+{
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveEnumIDLists);
+}
+
+/// <inheritdoc />
+BigDriveAsyncEnumIDList::~BigDriveAsyncEnumIDList()
+{
+    BigDrivePerformanceCounters::Decrement(BigDriveCounter_LiveEnumIDLists);
+
+    if (m_pEnumeration)
+    {
+        // A view that was told E_PENDING and let go before the end is waiting on change notifications
+        m_pEnumeration->Abandon(m_fPending && !m_fEnded);
+        m_pEnumeration->Release();
+        m_pEnumeration = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveAsyncEnumIDList::Initialize(BigDriveShellFolder* pFolder, DWORD grfFlags)
+{
+    HRESULT hr = S_OK;
+    BigDriveAsyncEnumeration* pEnumeration = nullptr;
+
+    if ((pFolder == nullptr) || (m_pEnumeration != nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    pEnumeration = new BigDriveAsyncEnumeration();
+    if (pEnumeration == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    hr = pEnumeration->Start(pFolder, grfFlags);
+    if (FAILED(hr))
+    {
+        pEnumeration->Release();
+        return hr;
+    }
+
+    m_pEnumeration = pEnumeration;
+
+    return S_OK;
+}
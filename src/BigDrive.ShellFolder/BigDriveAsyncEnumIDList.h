@@ -0,0 +1,122 @@
+// <copyright file="BigDriveAsyncEnumIDList.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Declares the BigDriveAsyncEnumIDList class, the IEnumIDList handed to views that
+//   pass SHCONTF_ENABLE_ASYNC to EnumObjects.
+// </summary>
+
+#pragma once
+
+#include <shlobj.h>
+
+class BigDriveAsyncEnumeration;
+class BigDriveShellFolder;
+
+/// <summary>
+/// Implements IEnumIDList over a <see cref="BigDriveAsyncEnumeration"/>. EnumObjects returns as
+/// soon as the worker is queued; Next hands back whatever the worker has produced so far, returns
+/// E_PENDING while the provider call is still running, and S_FALSE (or the provider's error) once
+/// the worker has finished and everything has been read.
+/// </summary>
+class BigDriveAsyncEnumIDList : public IEnumIDList
+{
+    LONG m_refCount;
+    BigDriveAsyncEnumeration* m_pEnumeration;
+    BOOL m_fPending;    // Next has returned E_PENDING
+    BOOL m_fEnded;      // Next has returned the end of the enumeration
+    ULONG m_cOwed;      // Items a Skip that returned E_PENDING has yet to skip
+
+    /// <summary>
+    /// Discards the items still owed to an earlier Skip, waiting no longer than Next does for each batch.
+    /// </summary>
+    /// <returns>S_OK once none are owed; E_PENDING if the worker hasn't produced them yet; S_FALSE if the enumeration ended first; otherwise, the error that stopped the worker.</returns>
+    HRESULT DiscardOwed();
+
+public:
+
+    /// <summary>
+    /// Milliseconds Next waits for the worker before returning E_PENDING, so a provider that answers
+    /// quickly fills the view in the first pass.
+    /// </summary>
+    static const DWORD PendingWaitMs = 25;
+
+    /// <summary>
+    /// Number of skipped items discarded per pop.
+    /// </summary>
+    static const ULONG SkipBatchSize = 64;
+
+    /// <summary>
+    /// Default constructor. The enumerator is empty until <see cref="Initialize"/> is called.
+    /// </summary>
+    BigDriveAsyncEnumIDList();
+
+    /// <summary>
+    /// Destructor. Abandons the worker; see <see cref="BigDriveAsyncEnumeration::Abandon"/>.
+    /// </summary>
+    virtual ~BigDriveAsyncEnumIDList();
+
+    /// <summary>
+    /// Starts enumerating the folder on a thread pool thread.
+    /// </summary>
+    /// <param name="pFolder">The folder to enumerate.</param>
+    /// <param name="grfFlags">The SHCONTF flags passed to EnumObjects.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT Initialize(BigDriveShellFolder* pFolder, DWORD grfFlags);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // IUnknown methods
+
+    /// <summary>
+    /// Queries for a supported interface (IUnknown or IEnumIDList).
+    /// </summary>
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) override;
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG __stdcall AddRef() override;
+
+    /// <summary>
+    /// Decrements the reference count and deletes the object if it reaches zero.
+    /// </summary>
+    ULONG __stdcall Release() override;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // IEnumIDList methods
+
+    /// <summary>
+    /// Retrieves the PIDLs the worker has produced so far, up to celt.
+    /// </summary>
+    /// <param name="celt">Number of PIDLs to retrieve.</param>
+    /// <param name="rgelt">Array to receive the PIDLs.</param>
+    /// <param name="pceltFetched">Receives the number of PIDLs actually fetched.</param>
+    /// <returns>
+    /// S_OK if at least one PIDL was fetched, even fewer than celt, since more may follow; E_PENDING if none
+    /// are ready yet; S_FALSE at the end of the enumeration; otherwise, the error that stopped the worker.
+    /// </returns>
+    HRESULT __stdcall Next(ULONG celt, LPITEMIDLIST* rgelt, ULONG* pceltFetched) override;
+
+    /// <summary>
+    /// Skips the specified number of items, waiting for them no longer than Next does. Items the
+    /// worker hasn't produced yet are still skipped as they arrive, before Next hands out any more,
+    /// so a Skip that returned E_PENDING must not be repeated.
+    /// </summary>
+    /// <param name="celt">Number of items to skip.</param>
+    /// <returns>
+    /// S_OK if all were skipped; E_PENDING if some are still to come; S_FALSE if the end was reached
+    /// first; otherwise, the error that stopped the worker.
+    /// </returns>
+    HRESULT __stdcall Skip(ULONG celt) override;
+
+    /// <summary>
+    /// Not supported; the items already handed out are gone from the queue.
+    /// </summary>
+    HRESULT __stdcall Reset() override;
+
+    /// <summary>
+    /// Not supported; the worker feeds a single reader.
+    /// </summary>
+    /// <param name="ppenum">Set to nullptr.</param>
+    HRESULT __stdcall Clone(IEnumIDList** ppenum) override;
+};
@@ -0,0 +1,279 @@
+// <copyright file="BigDriveAsyncEnumeration.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements the BigDriveAsyncEnumeration class, the worker side of an asynchronous
+//   folder enumeration.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDriveAsyncEnumeration.h"
+#include "BigDriveItemId.h"
+#include "BigDriveItemType.h"
+#include "BigDriveShellFolder.h"
+#include <objbase.h>
+
+/// <inheritdoc />
+BigDriveAsyncEnumeration::BigDriveAsyncEnumeration()
+    : m_refCount(1), m_driveGuid(GUID_NULL), m_grfFlags(0), m_pidlFolder(nullptr), m_queue(FreePidl), m_fProducing(FALSE), m_fAnnounce(FALSE)
+{
+    ::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveAsyncEnumeration::~BigDriveAsyncEnumeration()
+{
+    if (m_pidlFolder)
+    {
+        ::ILFree(m_pidlFolder);
+        m_pidlFolder = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveAsyncEnumeration::Start(BigDriveShellFolder* pFolder, DWORD grfFlags)
+{
+    HRESULT hr = S_OK;
+
+    if ((pFolder == nullptr) || (m_pidlFolder != nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    hr = m_queue.Initialize(QueueCapacity);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = pFolder->GetPidlAbsolute(m_pidlFolder);
+    if (FAILED(hr) || (m_pidlFolder == nullptr))
+    {
+        return FAILED(hr) ? hr : E_OUTOFMEMORY;
+    }
+
+    m_driveGuid = pFolder->GetDriveGuid();
+    m_grfFlags = grfFlags & ~SHCONTF_ENABLE_ASYNC;
+    m_fProducing = TRUE;
+
+    // The worker holds its own reference until it returns
+    AddRef();
+
+    if (!::TrySubmitThreadpoolCallback(ProduceCallback, this, nullptr))
+    {
+        hr = HRESULT_FROM_WIN32(::GetLastError());
+        m_fProducing = FALSE;
+        Release();
+        return hr;
+    }
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveAsyncEnumeration::Pop(ULONG celt, LPITEMIDLIST* rgelt, ULONG& celtFetched, DWORD dwTimeoutMs)
+{
+    return m_queue.Pop(reinterpret_cast<void**>(rgelt), celt, celtFetched, dwTimeoutMs);
+}
+
+/// <inheritdoc />
+void BigDriveAsyncEnumeration::Abandon(BOOL fAnnounce)
+{
+    BOOL fProducing = FALSE;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+    m_fAnnounce = fAnnounce;
+    fProducing = m_fProducing;
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    m_queue.Cancel();
+
+    // A running worker announces the rest itself when it sees the cancel
+    if (fAnnounce && !fProducing)
+    {
+        AnnounceQueued();
+    }
+}
+
+/// <inheritdoc />
+ULONG BigDriveAsyncEnumeration::AddRef()
+{
+    return ::InterlockedIncrement(&m_refCount);
+}
+
+/// <inheritdoc />
+ULONG BigDriveAsyncEnumeration::Release()
+{
+    ULONG res = ::InterlockedDecrement(&m_refCount);
+    if (res == 0) delete this;
+    return res;
+}
+
+/// <inheritdoc />
+VOID CALLBACK BigDriveAsyncEnumeration::ProduceCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext)
+{
+    BigDriveAsyncEnumeration* pThis = static_cast<BigDriveAsyncEnumeration*>(pContext);
+
+    // Waits on the provider and on the view draining the queue
+    ::CallbackMayRunLong(pInstance);
+
+    pThis->Produce();
+    pThis->Release();
+}
+
+/// <inheritdoc />
+void BigDriveAsyncEnumeration::Produce()
+{
+    HRESULT hr = S_OK;
+    HRESULT hrCoInit = S_OK;
+    HRESULT hrPush = S_OK;
+    BigDriveShellFolder* pFolder = nullptr;
+    IEnumIDList* pEnum = nullptr;
+    LPITEMIDLIST apidl[BatchSize] = {};
+    ULONG fetched = 0;
+    BOOL fAnnounce = FALSE;
+
+    // The worker's folder and its provider connections belong to the multithreaded apartment
+    hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    // The view's folder lives in its single-threaded apartment and must not be called from here
+    hr = BigDriveShellFolder::Create(m_driveGuid, nullptr, m_pidlFolder, &pFolder);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = pFolder->EnumObjects(nullptr, m_grfFlags, &pEnum);
+    if (FAILED(hr) || (pEnum == nullptr))
+    {
+        goto End;
+    }
+
+    do
+    {
+        fetched = 0;
+        hr = pEnum->Next(BatchSize, apidl, &fetched);
+
+        for (ULONG i = 0; i < fetched; i++)
+        {
+            if (SUCCEEDED(hrPush))
+            {
+                hrPush = m_queue.Push(apidl[i], INFINITE);
+                if (SUCCEEDED(hrPush))
+                {
+                    apidl[i] = nullptr;
+                    continue;
+                }
+
+                ::AcquireSRWLockShared(&m_lock);
+                fAnnounce = m_fAnnounce;
+                ::ReleaseSRWLockShared(&m_lock);
+
+                if (fAnnounce)
+                {
+                    AnnounceQueued();
+                }
+            }
+
+            if (fAnnounce)
+            {
+                Announce(apidl[i]);
+            }
+
+            ::ILFree(apidl[i]);
+            apidl[i] = nullptr;
+        }
+
+        // Abandoned without a window to fill
+        if (FAILED(hrPush) && !fAnnounce)
+        {
+            break;
+        }
+
+    } while (hr == S_OK);
+
+End:
+
+    m_queue.Complete(FAILED(hr) ? hr : S_OK);
+
+    ::AcquireSRWLockExclusive(&m_lock);
+    m_fProducing = FALSE;
+    fAnnounce = m_fAnnounce;
+    ::ReleaseSRWLockExclusive(&m_lock);
+
+    // Abandoned after the last push; announce what the view left behind
+    if (fAnnounce)
+    {
+        AnnounceQueued();
+    }
+
+    if (pEnum)
+    {
+        pEnum->Release();
+        pEnum = nullptr;
+    }
+
+    if (pFolder)
+    {
+        pFolder->Release();
+        pFolder = nullptr;
+    }
+
+    if (SUCCEEDED(hrCoInit))
+    {
+        ::CoUninitialize();
+    }
+}
+
+/// <inheritdoc />
+void BigDriveAsyncEnumeration::AnnounceQueued()
+{
+    LPITEMIDLIST apidl[BatchSize] = {};
+    ULONG popped = 0;
+
+    while (m_queue.Pop(reinterpret_cast<void**>(apidl), BatchSize, popped, 0) == S_OK)
+    {
+        for (ULONG i = 0; i < popped; i++)
+        {
+            Announce(apidl[i]);
+            ::ILFree(apidl[i]);
+            apidl[i] = nullptr;
+        }
+    }
+}
+
+/// <inheritdoc />
+void BigDriveAsyncEnumeration::Announce(PCUITEMID_CHILD pidlChild)
+{
+    BigDriveItemIdView view;
+    PIDLIST_ABSOLUTE pidlItem = nullptr;
+    LONG wEventId = SHCNE_CREATE;
+
+    if (FAILED(BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pidlChild), view)))
+    {
+        return;
+    }
+
+    if (view.uType == BigDriveItemType_Folder)
+    {
+        wEventId = SHCNE_MKDIR;
+    }
+
+    pidlItem = ::ILCombine(m_pidlFolder, pidlChild);
+    if (pidlItem == nullptr)
+    {
+        return;
+    }
+
+    // Don't hold the worker up on the notification being delivered
+    ::SHChangeNotify(wEventId, SHCNF_IDLIST | SHCNF_FLUSHNOWAIT, pidlItem, nullptr);
+
+    ::ILFree(pidlItem);
+}
+
+/// <inheritdoc />
+void BigDriveAsyncEnumeration::FreePidl(void* pItem)
+{
+    ::ILFree(static_cast<LPITEMIDLIST>(pItem));
+}
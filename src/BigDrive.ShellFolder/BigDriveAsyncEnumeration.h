@@ -0,0 +1,140 @@
+// <copyright file="BigDriveAsyncEnumeration.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Declares the BigDriveAsyncEnumeration class, the worker side of an asynchronous
+//   folder enumeration.
+// </summary>
+
+#pragma once
+
+#include <shlobj.h>
+
+#include "..\BigDrive.Client\BigDriveProducerConsumerQueue.h"
+
+class BigDriveShellFolder;
+
+/// <summary>
+/// Enumerates a folder on a thread pool thread and hands the PIDLs to the view through a
+/// <see cref="BigDriveProducerConsumerQueue"/>. The object is shared by the worker and the
+/// <see cref="BigDriveAsyncEnumIDList"/> that reads from it, and lives until both release it,
+/// so the view can let go of the enumerator while a slow provider call is still running.
+///
+/// If the view lets go after being told E_PENDING, the items it didn't get are announced to
+/// the shell with SHCNE_CREATE / SHCNE_MKDIR as they arrive, so the open window still fills in.
+/// Otherwise the worker stops at its next push.
+/// </summary>
+class BigDriveAsyncEnumeration
+{
+public:
+
+    /// <summary>
+    /// Maximum number of PIDLs held between the worker and the view before the worker waits.
+    /// </summary>
+    static const ULONG QueueCapacity = 1024;
+
+    /// <summary>
+    /// Number of PIDLs the worker asks the inner enumerator for at a time.
+    /// </summary>
+    static const ULONG BatchSize = 64;
+
+private:
+
+    LONG m_refCount;
+    CLSID m_driveGuid;                  // Drive of the folder
+    DWORD m_grfFlags;                   // SHCONTF flags without SHCONTF_ENABLE_ASYNC
+    PIDLIST_ABSOLUTE m_pidlFolder;      // The folder; the worker's folder and the parent of announced items
+    BigDriveProducerConsumerQueue m_queue;
+
+    /// <summary>
+    /// Guards <see cref="m_fProducing"/> and <see cref="m_fAnnounce"/>, so exactly one of the worker
+    /// and <see cref="Abandon"/> announces what is left in the queue.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// TRUE from <see cref="Start"/> until the worker has completed the queue.
+    /// </summary>
+    BOOL m_fProducing;
+
+    /// <summary>
+    /// TRUE once the view has abandoned the enumeration and wants the rest announced.
+    /// </summary>
+    BOOL m_fAnnounce;
+
+public:
+
+    /// <summary>
+    /// Default constructor. Nothing runs until <see cref="Start"/> is called.
+    /// </summary>
+    BigDriveAsyncEnumeration();
+
+    /// <summary>
+    /// Frees the folder's PIDL. PIDLs left in the queue are freed by the queue.
+    /// </summary>
+    ~BigDriveAsyncEnumeration();
+
+    /// <summary>
+    /// Starts the worker. The folder belongs to the view's single-threaded apartment, so the worker
+    /// creates a folder of its own for the same drive and PIDL, calls EnumObjects on it without
+    /// SHCONTF_ENABLE_ASYNC and pushes the PIDLs it returns.
+    /// </summary>
+    /// <param name="pFolder">The folder to enumerate. Only its drive and PIDL are kept.</param>
+    /// <param name="grfFlags">The SHCONTF flags passed to EnumObjects.</param>
+    /// <returns>S_OK if the worker was queued; otherwise, an HRESULT error code.</returns>
+    HRESULT Start(BigDriveShellFolder* pFolder, DWORD grfFlags);
+
+    /// <summary>
+    /// Removes up to celt PIDLs queued by the worker.
+    /// </summary>
+    /// <param name="celt">Maximum number of PIDLs.</param>
+    /// <param name="rgelt">Array that receives the PIDLs. The caller owns them.</param>
+    /// <param name="celtFetched">Receives the number of PIDLs.</param>
+    /// <param name="dwTimeoutMs">Milliseconds to wait for the first PIDL.</param>
+    /// <returns>See <see cref="BigDriveProducerConsumerQueue::Pop"/>.</returns>
+    HRESULT Pop(ULONG celt, LPITEMIDLIST* rgelt, ULONG& celtFetched, DWORD dwTimeoutMs);
+
+    /// <summary>
+    /// Called when the view releases its enumerator. Stops the worker at its next push.
+    /// </summary>
+    /// <param name="fAnnounce">TRUE to announce the items the view didn't get to the shell instead of dropping them.</param>
+    void Abandon(BOOL fAnnounce);
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG AddRef();
+
+    /// <summary>
+    /// Decrements the reference count and deletes the object if it reaches zero.
+    /// </summary>
+    ULONG Release();
+
+private:
+
+    /// <summary>
+    /// Thread pool callback that runs <see cref="Produce"/> and drops the worker's reference.
+    /// </summary>
+    static VOID CALLBACK ProduceCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext);
+
+    /// <summary>
+    /// Runs the inner enumeration and feeds the queue until it ends, fails or is abandoned.
+    /// </summary>
+    void Produce();
+
+    /// <summary>
+    /// Pops whatever is queued and announces it.
+    /// </summary>
+    void AnnounceQueued();
+
+    /// <summary>
+    /// Tells the shell that an item has appeared in the folder.
+    /// </summary>
+    /// <param name="pidlChild">The item, relative to the folder.</param>
+    void Announce(PCUITEMID_CHILD pidlChild);
+
+    /// <summary>
+    /// Queue callback that frees a PIDL.
+    /// </summary>
+    static void FreePidl(void* pItem);
+};
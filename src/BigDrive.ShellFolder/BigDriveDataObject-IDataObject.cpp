@@ -93,8 +93,8 @@ HRESULT __stdcall BigDriveDataObject::GetData(FORMATETC* pformatetc, STGMEDIUM*
 	}
 	else if (pformatetc->cfFormat == g_cfFileContents)
 	{
-		// Verify the medium type is supported
-		if ((pformatetc->tymed & TYMED_HGLOBAL) == 0)
+		// Verify the medium type is supported; TYMED_ISTREAM is preferred so large files are never buffered whole
+		if ((pformatetc->tymed & (TYMED_ISTREAM | TYMED_HGLOBAL)) == 0)
 		{
 			hr = DV_E_TYMED;
 			goto End;
@@ -288,14 +288,15 @@ HRESULT __stdcall BigDriveDataObject::QueryGetData(FORMATETC* pformatetc)
 		goto End;
 	}
 
-	if ((pformatetc->tymed & TYMED_HGLOBAL) == 0)
+	cf = pformatetc->cfFormat;
+
+	// File contents can also be had as a stream; everything else is global memory only
+	if ((pformatetc->tymed & ((cf == g_cfFileContents) ? (TYMED_ISTREAM | TYMED_HGLOBAL) : TYMED_HGLOBAL)) == 0)
 	{
 		hr = DV_E_TYMED;
 		goto End;
 	}
 
-	cf = pformatetc->cfFormat;
-
 	if ((cf == g_cfShellIdList) ||
 		(cf == g_cfFileDescriptor) ||
 		(cf == g_cfFileContents) ||
@@ -492,7 +493,7 @@ HRESULT __stdcall BigDriveDataObject::EnumFormatEtc(DWORD dwDirection, IEnumFORM
 			nullptr,
 			DVASPECT_CONTENT,
 			-1,
-			TYMED_HGLOBAL
+			TYMED_ISTREAM | TYMED_HGLOBAL
 		},
 		{
 			g_cfDropDescription,
@@ -8,6 +8,8 @@
 #include "..\BigDrive.Client\BigDriveConfigurationClient.h"
 #include "..\BigDrive.Client\DriveConfiguration.h"
 #include "..\BigDrive.Client\BigDriveInterfaceProvider.h"
+#include "..\BigDrive.Client\BigDriveReadAheadStream.h"
+#include "..\BigDrive.Client\BigDrivePerformanceCounters.h"
 
 #include <shlwapi.h>
 
@@ -26,6 +28,8 @@ BigDriveDataObject::BigDriveDataObject(BigDriveShellFolder* pFolder, UINT cidl,
 {
 	m_traceLogger.Initialize(pFolder->GetDriveGuid());
 
+	BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveDataObjects);
+
 	// AddRef the folder object
 	if (m_pFolder)
 	{
@@ -57,6 +61,8 @@ BigDriveDataObject::BigDriveDataObject(BigDriveShellFolder* pFolder, UINT cidl,
 /// </summary>
 BigDriveDataObject::~BigDriveDataObject()
 {
+	BigDrivePerformanceCounters::Decrement(BigDriveCounter_LiveDataObjects);
+
 	// Free item IDs
 	if (m_apidl)
 	{
@@ -323,10 +329,14 @@ End:
 HRESULT BigDriveDataObject::CreateFileContents(FORMATETC* pformatetc, STGMEDIUM* pmedium)
 {
 	HRESULT hr = S_OK;
-	BYTE* pData = nullptr;
-	SIZE_T dataSize = 0;
+	IStream* pStream = nullptr;
+	IStream* pReadAheadStream = nullptr;
+	ULONGLONG cbSize = 0;
 	HGLOBAL hGlobal = nullptr;
-	void* pDest = nullptr;
+	BYTE* pDest = nullptr;
+	ULONGLONG cbCopied = 0;
+	ULONG cbRequest = 0;
+	ULONG cbRead = 0;
 
 	m_traceLogger.LogEnter(__FUNCTION__, *pformatetc);
 
@@ -337,42 +347,105 @@ HRESULT BigDriveDataObject::CreateFileContents(FORMATETC* pformatetc, STGMEDIUM*
 		goto End;
 	}
 
-	hr = GetFileDataFromPidl(m_apidl[fileIndex], &pData, dataSize);
-	if (FAILED(hr) || pData == nullptr)
+	hr = GetFileStreamFromPidl(m_apidl[fileIndex], &pStream, cbSize);
+	if (FAILED(hr) || pStream == nullptr)
+	{
+		goto End;
+	}
+
+	if (pformatetc->tymed & TYMED_ISTREAM)
+	{
+		// The caller reads the file as it copies it; only the read-ahead window is held in memory
+		hr = BigDriveReadAheadStream::Create(pStream, BigDriveReadAheadStream::DefaultWindowSize, &pReadAheadStream);
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+
+		pmedium->tymed = TYMED_ISTREAM;
+		pmedium->pstm = pReadAheadStream;
+		pmedium->pUnkForRelease = nullptr;
+		pReadAheadStream = nullptr;
+
+		goto End;
+	}
+
+	// Callers that only take an HGLOBAL get the whole file, read straight into the global memory
+	if (cbSize > static_cast<ULONGLONG>(static_cast<SIZE_T>(-1)))
 	{
+		hr = E_OUTOFMEMORY;
 		goto End;
 	}
 
-	hGlobal = ::GlobalAlloc(GMEM_MOVEABLE, dataSize);
+	hGlobal = ::GlobalAlloc(GMEM_MOVEABLE, (cbSize > 0) ? static_cast<SIZE_T>(cbSize) : 1);
 	if (!hGlobal)
 	{
 		hr = E_OUTOFMEMORY;
 		goto End;
 	}
 
-	pDest = ::GlobalLock(hGlobal);
+	pDest = static_cast<BYTE*>(::GlobalLock(hGlobal));
 	if (!pDest)
 	{
-		::GlobalFree(hGlobal);
 		hr = E_OUTOFMEMORY;
 		goto End;
 	}
 
-	::memcpy(pDest, pData, dataSize);
+	while (cbCopied < cbSize)
+	{
+		cbRequest = (cbSize - cbCopied < ULONG_MAX) ? static_cast<ULONG>(cbSize - cbCopied) : ULONG_MAX;
+
+		hr = pStream->Read(pDest + cbCopied, cbRequest, &cbRead);
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+
+		if (cbRead == 0)
+		{
+			// The file is shorter than the stream said
+			hr = E_FAIL;
+			goto End;
+		}
+
+		cbCopied += cbRead;
+	}
+
 	::GlobalUnlock(hGlobal);
+	pDest = nullptr;
 
 	pmedium->tymed = TYMED_HGLOBAL;
 	pmedium->hGlobal = hGlobal;
 	pmedium->pUnkForRelease = nullptr;
+	hGlobal = nullptr;
+	hr = S_OK;
 
 End:
 
 	m_traceLogger.LogExit(__FUNCTION__, hr);
 
-	if (pData != nullptr)
+	if (pDest != nullptr)
 	{
-		::CoTaskMemFree(pData);
-		pData = nullptr;
+		::GlobalUnlock(hGlobal);
+		pDest = nullptr;
+	}
+
+	if (hGlobal != nullptr)
+	{
+		::GlobalFree(hGlobal);
+		hGlobal = nullptr;
+	}
+
+	if (pReadAheadStream != nullptr)
+	{
+		pReadAheadStream->Release();
+		pReadAheadStream = nullptr;
+	}
+
+	if (pStream != nullptr)
+	{
+		pStream->Release();
+		pStream = nullptr;
 	}
 
 	return hr;
@@ -584,7 +657,7 @@ End:
 }
 
 /// <inheritdoc />
-HRESULT BigDriveDataObject::GetFileDataFromPidl(PCUITEMID_CHILD pidl, BYTE** ppData, SIZE_T& dataSize)
+HRESULT BigDriveDataObject::GetFileStreamFromPidl(PCUITEMID_CHILD pidl, IStream** ppStream, ULONGLONG& cbSize)
 {
 	HRESULT hr = S_OK;
 	STRRET strret = { 0 };
@@ -596,12 +669,14 @@ HRESULT BigDriveDataObject::GetFileDataFromPidl(PCUITEMID_CHILD pidl, BYTE** ppD
 	IStream* pStream = nullptr;
 	LARGE_INTEGER liZero = { 0 };
 	ULARGE_INTEGER uliSize = {};
-	ULONG bytesRead = 0;
 	PIDLIST_ABSOLUTE pidlFolder = nullptr;
 	IStream* pValidatedStream = nullptr;
 
 	m_traceLogger.LogEnter(__FUNCTION__, pidl);
 
+	*ppStream = nullptr;
+	cbSize = 0;
+
 	if (m_pFolder == nullptr || pidl == nullptr)
 	{
 		hr = E_INVALIDARG;
@@ -666,7 +741,9 @@ HRESULT BigDriveDataObject::GetFileDataFromPidl(PCUITEMID_CHILD pidl, BYTE** ppD
 
 	m_traceLogger.LogInfo(__FUNCTION__, L"Call IBigDriveFileData::GetFileData() for  %s", bstrPath);
 
+	BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileData::GetFileData");
 	hr = pBigDriveFileData->GetFileData(m_driveGuid, bstrPath, &pStream);
+	BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileData::GetFileData", hr);
 	if (FAILED(hr) || !pStream)
 	{
 		goto End;
@@ -701,35 +778,12 @@ HRESULT BigDriveDataObject::GetFileDataFromPidl(PCUITEMID_CHILD pidl, BYTE** ppD
 		goto End;
 	}
 
-	// Allocate buffer for the data
-	dataSize = static_cast<SIZE_T>(uliSize.QuadPart);
-	if (dataSize == 0)
-	{
-		hr = S_FALSE;
-		goto End;
-	}
+	cbSize = uliSize.QuadPart;
 
-	m_traceLogger.LogInfo(__FUNCTION__, L"IStream from IBigDriveFileData::GetFileData() returned %zu bytes.", dataSize);
+	m_traceLogger.LogInfo(__FUNCTION__, L"IStream from IBigDriveFileData::GetFileData() returned %llu bytes.", cbSize);
 
-	*ppData = (BYTE*)::CoTaskMemAlloc(dataSize);
-	if (!*ppData)
-	{
-		hr = E_OUTOFMEMORY;
-		goto End;
-	}
-
-	hr = pValidatedStream->Read(*ppData, static_cast<ULONG>(dataSize), &bytesRead);
-	if (FAILED(hr) || bytesRead != dataSize)
-	{
-		// Read failed or didn't read the expected amount of data
-		// Clean up the outputs so we don't leak memory
-
-		::CoTaskMemFree(*ppData);
-		*ppData = nullptr;
-		dataSize = 0;
-
-		goto End;
-	}
+	*ppStream = pValidatedStream;
+	pValidatedStream = nullptr;
 
 End:
 
@@ -212,6 +212,8 @@ private:
 
     /// <summary>
     /// Creates file contents in the specified storage medium according to the given format descriptor.
+    /// A caller that accepts TYMED_ISTREAM gets a read-ahead stream over the provider stream; otherwise
+    /// the whole file is read into global memory.
     /// </summary>
     /// <param name="pformatetc">A pointer to a FORMATETC structure that defines the format, medium, and target device for the data.</param>
     /// <param name="pmedium">A pointer to a STGMEDIUM structure that, on successful return, receives the created file contents.</param>
@@ -258,5 +260,12 @@ private:
     /// </remarks>
     HRESULT CreateHDrop(FORMATETC* pformatetc, STGMEDIUM* pmedium);
 
-    HRESULT GetFileDataFromPidl(PCUITEMID_CHILD pidl, BYTE** ppData, SIZE_T& dataSize);
+    /// <summary>
+    /// Opens the provider stream of a file, positioned at the start.
+    /// </summary>
+    /// <param name="pidl">The file, relative to the folder.</param>
+    /// <param name="ppStream">Receives the provider stream.</param>
+    /// <param name="cbSize">Receives the size of the file.</param>
+    /// <returns>S_OK if successful; S_FALSE if the provider doesn't implement IBigDriveFileData; otherwise, an error code.</returns>
+    HRESULT GetFileStreamFromPidl(PCUITEMID_CHILD pidl, IStream** ppStream, ULONGLONG& cbSize);
 };
\ No newline at end of file
@@ -10,7 +10,9 @@
 #include "..\BigDrive.Client\DriveConfiguration.h"
 #include "..\BigDrive.Client\BigDriveConfigurationClient.h"
 #include "..\BigDrive.Client\BigDriveInterfaceProvider.h"
-#include "..\BigDrive.Client\Interfaces\IBigDriveFileOperations.h"
+#include "..\BigDrive.Client\BigDriveTransferBatch.h"
+#include "..\BigDrive.Client\BigDriveTreeUpload.h"
+#include "BigDriveUploadOperation.h"
 #include "RegisterClipboardFormats.h"
 #include "Logging\BigDriveShellFolderTraceLogger.h"
 
@@ -20,8 +22,9 @@
 /// Constructor for BigDriveDropTarget.
 /// </summary>
 /// <param name="pFolder">Pointer to the parent shell folder.</param>
-BigDriveDropTarget::BigDriveDropTarget(BigDriveShellFolder* pFolder)
-	: m_cRef(1), m_pFolder(pFolder), m_fAllowDrop(FALSE), m_dwEffect(0), m_traceLogger()
+/// <param name="hwndOwner">The view window the drop target was created for.</param>
+BigDriveDropTarget::BigDriveDropTarget(BigDriveShellFolder* pFolder, HWND hwndOwner)
+	: m_cRef(1), m_pFolder(pFolder), m_hwndOwner(hwndOwner), m_fAllowDrop(FALSE), m_dwEffect(0), m_traceLogger()
 {
 	m_traceLogger.Initialize(pFolder->GetDriveGuid());
 
@@ -138,6 +141,16 @@ HRESULT BigDriveDropTarget::ProcessDrop(IDataObject* pIDataObject)
 		}
 	}
 
+	{
+		// Try virtual files; ahead of Shell IDList, whose items may not be on the file system
+		FORMATETC fmtec = { g_cfFileDescriptor, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+
+		if (SUCCEEDED(pIDataObject->QueryGetData(&fmtec)))
+		{
+			return ProcessFileContentsDrop(pIDataObject);
+		}
+	}
+
 	{
 		// Try Shell IDList format
 		FORMATETC fmtec = { g_cfShellIdList, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
@@ -152,18 +165,19 @@ HRESULT BigDriveDropTarget::ProcessDrop(IDataObject* pIDataObject)
 }
 
 /// <summary>
-/// Processes an HDROP data object, copying each dropped file to a target folder on a BigDrive volume using the BigDrive file operations interface.
+/// Processes an HDROP data object, queuing each dropped file and folder for upload to the target folder on a BigDrive volume.
+/// The files are copied in the background by the transfer engine, and dropped folders walked as they upload; the drop doesn't wait for them.
 /// </summary>
 /// <param name="pIDataObject">A pointer to an IDataObject containing the HDROP data representing the files to be processed.</param>
-/// <returns>Returns an HRESULT indicating success or failure. S_OK if all files were processed successfully; otherwise, an error code describing the failure.</returns>
+/// <returns>Returns an HRESULT indicating success or failure. S_OK if the upload was started; otherwise, an error code describing the failure.</returns>
 HRESULT BigDriveDropTarget::ProcessHDrop(IDataObject* pIDataObject)
 {
 	HRESULT hr = E_FAIL;
 	FORMATETC fmtec = { g_cfHDrop, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
 	STGMEDIUM stgmed = {};
 	DriveConfiguration driveConfig;
-	BigDriveInterfaceProvider* pProvider = nullptr;
-	IBigDriveFileOperations* pFileOps = nullptr;
+	BigDriveTransferBatch* pBatch = nullptr;
+	BigDriveTreeUpload* pUpload = nullptr;
 	PIDLIST_ABSOLUTE pidlFolder = nullptr;
 	BSTR bstrTargetFolder = nullptr;
 	HDROP hDrop = nullptr;
@@ -216,32 +230,31 @@ HRESULT BigDriveDropTarget::ProcessHDrop(IDataObject* pIDataObject)
 		goto End;
 	}
 
-	pProvider = new BigDriveInterfaceProvider(driveConfig);
-	if (pProvider == nullptr)
+	hr = BigDriveTransferBatch::Create(driveGuid, driveConfig.clsid, bstrTargetFolder, BigDriveInterfaceProvider::GetFileOperations, nullptr, &pBatch);
+	if (FAILED(hr))
 	{
-		WriteError(L"Failed to create BigDriveInterfaceProvider due to insufficient memory");
-		hr = E_OUTOFMEMORY;
+		WriteErrorFormatted(L"Failed to create the upload batch, hr=0x%08X", hr);
 		goto End;
 	}
 
-	hr = pProvider->GetIBigDriveFileOperations(&pFileOps);
-	if (FAILED(hr) || pFileOps == nullptr)
+	hr = BigDriveTreeUpload::Create(pBatch, BigDriveTreeUpload::DefaultMaxWalkers, &pUpload);
+	if (FAILED(hr))
 	{
-		WriteErrorFormatted(L"Failed to get IBigDriveFileOperations interface, hr=0x%08X", hr);
+		WriteErrorFormatted(L"Failed to create the upload, hr=0x%08X", hr);
 		goto End;
 	}
 
-	// Process each dropped file
-	for (UINT i = 0; i < fileCount && SUCCEEDED(hr); i++)
+	// Collect the dropped files; they are uploaded in the background
+	for (UINT i = 0; i < fileCount; i++)
 	{
 		WCHAR filePath[MAX_PATH] = {};
 		UINT cch = DragQueryFile(hDrop, i, filePath, ARRAYSIZE(filePath));
 		if (cch > 0 && cch < MAX_PATH)
 		{
-			hr = pFileOps->CopyFileToBigDrive(driveGuid, filePath, bstrTargetFolder);
+			hr = pUpload->Add(filePath);
 			if (FAILED(hr))
 			{
-				WriteErrorFormatted(L"Failed to copy file '%s' to BigDrive, hr=0x%08X", filePath, hr);
+				WriteErrorFormatted(L"Failed to add file '%s' to the upload, hr=0x%08X", filePath, hr);
 				goto End;
 			}
 		}
@@ -253,18 +266,25 @@ HRESULT BigDriveDropTarget::ProcessHDrop(IDataObject* pIDataObject)
 		}
 	}
 
+	hr = BigDriveUploadOperation::Start(pUpload, pidlFolder, m_hwndOwner);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"Failed to start the upload, hr=0x%08X", hr);
+		goto End;
+	}
+
 End:
 
-	if (pFileOps)
+	if (pUpload)
 	{
-		pFileOps->Release();
-		pFileOps = nullptr;
+		pUpload->Release();
+		pUpload = nullptr;
 	}
 
-	if (pProvider)
+	if (pBatch)
 	{
-		delete pProvider;
-		pProvider = nullptr;
+		pBatch->Release();
+		pBatch = nullptr;
 	}
 
 	if (bstrTargetFolder)
@@ -305,8 +325,8 @@ HRESULT BigDriveDropTarget::ProcessShellIdListDrop(IDataObject* pIDataObject)
 	FORMATETC fmtec = { g_cfShellIdList, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
 	STGMEDIUM stgmed = {};
 	DriveConfiguration driveConfig;
-	BigDriveInterfaceProvider* pProvider = nullptr;
-	IBigDriveFileOperations* pFileOps = nullptr;
+	BigDriveTransferBatch* pBatch = nullptr;
+	BigDriveTreeUpload* pUpload = nullptr;
 	PIDLIST_ABSOLUTE pidlFolder = nullptr;
 	BSTR bstrTargetFolder = nullptr;
 	LPIDA pida = nullptr;
@@ -357,18 +377,17 @@ HRESULT BigDriveDropTarget::ProcessShellIdListDrop(IDataObject* pIDataObject)
 		goto End;
 	}
 
-	pProvider = new BigDriveInterfaceProvider(driveConfig);
-	if (pProvider == nullptr)
+	hr = BigDriveTransferBatch::Create(driveGuid, driveConfig.clsid, bstrTargetFolder, BigDriveInterfaceProvider::GetFileOperations, nullptr, &pBatch);
+	if (FAILED(hr))
 	{
-		WriteError(L"Failed to create BigDriveInterfaceProvider due to insufficient memory");
-		hr = E_OUTOFMEMORY;
+		WriteErrorFormatted(L"Failed to create the upload batch, hr=0x%08X", hr);
 		goto End;
 	}
 
-	hr = pProvider->GetIBigDriveFileOperations(&pFileOps);
-	if (FAILED(hr) || pFileOps == nullptr)
+	hr = BigDriveTreeUpload::Create(pBatch, BigDriveTreeUpload::DefaultMaxWalkers, &pUpload);
+	if (FAILED(hr))
 	{
-		WriteErrorFormatted(L"Failed to get IBigDriveFileOperations interface, hr=0x%08X", hr);
+		WriteErrorFormatted(L"Failed to create the upload, hr=0x%08X", hr);
 		goto End;
 	}
 
@@ -416,10 +435,10 @@ HRESULT BigDriveDropTarget::ProcessShellIdListDrop(IDataObject* pIDataObject)
 			goto End;
 		}
 
-		hr = pFileOps->CopyFileToBigDrive(driveGuid, filePath, bstrTargetFolder);
+		hr = pUpload->Add(filePath);
 		if (FAILED(hr))
 		{
-			WriteErrorFormatted(L"Failed to copy file '%s' to BigDrive, hr=0x%08X", filePath, hr);
+			WriteErrorFormatted(L"Failed to add file '%s' to the upload, hr=0x%08X", filePath, hr);
 			goto End;
 		}
 
@@ -430,6 +449,13 @@ HRESULT BigDriveDropTarget::ProcessShellIdListDrop(IDataObject* pIDataObject)
 		}
 	}
 
+	hr = BigDriveUploadOperation::Start(pUpload, pidlFolder, m_hwndOwner);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"Failed to start the upload, hr=0x%08X", hr);
+		goto End;
+	}
+
 End:
 
 	if (pidlFull)
@@ -445,16 +471,16 @@ End:
 		bGlobalLocked = FALSE;
 	}
 
-	if (pFileOps)
+	if (pUpload)
 	{
-		pFileOps->Release();
-		pFileOps = nullptr;
+		pUpload->Release();
+		pUpload = nullptr;
 	}
 
-	if (pProvider)
+	if (pBatch)
 	{
-		delete pProvider;
-		pProvider = nullptr;
+		pBatch->Release();
+		pBatch = nullptr;
 	}
 
 	if (bstrTargetFolder)
@@ -484,6 +510,308 @@ End:
 	return hr;
 }
 
+/// <summary>
+/// Processes a drop of virtual files, queuing each file's CFSTR_FILECONTENTS stream for upload to the target folder.
+/// Folders in the descriptor are queued for the upload's folder creator, and the files under them wait for them; the
+/// files are copied in the background. An item that can't be queued fails on its own and is reported with the rest.
+/// </summary>
+/// <param name="pIDataObject">Pointer to an IDataObject containing the file group descriptor and the file contents.</param>
+/// <returns>S_OK if the upload was started; otherwise, an error code describing the failure.</returns>
+HRESULT BigDriveDropTarget::ProcessFileContentsDrop(IDataObject* pIDataObject)
+{
+	HRESULT hr = S_OK;
+	HRESULT hrItem = S_OK;
+	FORMATETC fmtec = { g_cfFileDescriptor, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+	STGMEDIUM stgmed = {};
+	DriveConfiguration driveConfig;
+	BigDriveTransferBatch* pBatch = nullptr;
+	BigDriveTreeUpload* pUpload = nullptr;
+	PIDLIST_ABSOLUTE pidlFolder = nullptr;
+	BSTR bstrTargetFolder = nullptr;
+	LPFILEGROUPDESCRIPTORW pfgd = nullptr;
+	CLSID driveGuid = GUID_NULL;
+	BOOL bGlobalLocked = FALSE;
+	WCHAR szName[MAX_PATH + 1] = {};
+
+	hr = pIDataObject->GetData(&fmtec, &stgmed);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"Failed to get file group descriptor from IDataObject, hr=0x%08X", hr);
+		goto End;
+	}
+
+	pfgd = (LPFILEGROUPDESCRIPTORW)::GlobalLock(stgmed.hGlobal);
+	if (!pfgd)
+	{
+		WriteError(L"Failed to lock global memory for file group descriptor");
+		hr = E_FAIL;
+		goto End;
+	}
+
+	bGlobalLocked = TRUE;
+
+	if (pfgd->cItems == 0)
+	{
+		WriteError(L"File group descriptor contains no items");
+		hr = E_FAIL;
+		goto End;
+	}
+
+	hr = m_pFolder->GetCurFolder(&pidlFolder);
+	if (FAILED(hr) || !pidlFolder)
+	{
+		WriteErrorFormatted(L"Failed to get current folder PIDL, hr=0x%08X", hr);
+		goto End;
+	}
+
+	hr = m_pFolder->GetPathForProviders(pidlFolder, bstrTargetFolder);
+	if (FAILED(hr) || !bstrTargetFolder)
+	{
+		WriteErrorFormatted(L"Failed to get target folder path, hr=0x%08X", hr);
+		goto End;
+	}
+
+	driveGuid = m_pFolder->GetDriveGuid();
+
+	hr = BigDriveConfigurationClient::GetDriveConfiguration(driveGuid, driveConfig);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"Failed to get drive configuration, hr=0x%08X", hr);
+		goto End;
+	}
+
+	hr = BigDriveTransferBatch::Create(driveGuid, driveConfig.clsid, bstrTargetFolder, BigDriveInterfaceProvider::GetFileOperations, nullptr, &pBatch);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"Failed to create the upload batch, hr=0x%08X", hr);
+		goto End;
+	}
+
+	hr = BigDriveTreeUpload::Create(pBatch, BigDriveTreeUpload::DefaultMaxWalkers, &pUpload);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"Failed to create the upload, hr=0x%08X", hr);
+		goto End;
+	}
+
+	for (UINT i = 0; i < pfgd->cItems; i++)
+	{
+		const FILEDESCRIPTORW& fd = pfgd->fgd[i];
+
+		// The name may not be terminated; the copy always is, and is only used once it checks out or to report it
+		::wcsncpy_s(szName, _countof(szName), fd.cFileName, _TRUNCATE);
+
+		hrItem = ValidateDescriptorName(fd.cFileName);
+		if (SUCCEEDED(hrItem))
+		{
+			hrItem = QueueDescriptorItem(pIDataObject, fd, i, szName, pUpload);
+		}
+
+		if (FAILED(hrItem))
+		{
+			WriteErrorFormatted(L"Failed to add dropped item '%s' to the upload, hr=0x%08X", szName, hrItem);
+
+			hr = pBatch->AddRejected(szName, hrItem);
+			if (FAILED(hr))
+			{
+				WriteErrorFormatted(L"Failed to record the failure of '%s', hr=0x%08X", szName, hr);
+				goto End;
+			}
+		}
+	}
+
+	// Seals the batch once the dropped folders are created
+	hr = BigDriveUploadOperation::Start(pUpload, pidlFolder, m_hwndOwner);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"Failed to start the upload, hr=0x%08X", hr);
+		goto End;
+	}
+
+End:
+
+	if (bGlobalLocked && stgmed.hGlobal)
+	{
+		::GlobalUnlock(stgmed.hGlobal);
+		bGlobalLocked = FALSE;
+	}
+
+	if (pUpload)
+	{
+		pUpload->Release();
+		pUpload = nullptr;
+	}
+
+	if (pBatch)
+	{
+		pBatch->Release();
+		pBatch = nullptr;
+	}
+
+	if (bstrTargetFolder)
+	{
+		::SysFreeString(bstrTargetFolder);
+		bstrTargetFolder = nullptr;
+	}
+
+	if (pidlFolder)
+	{
+		::ILFree(pidlFolder);
+		pidlFolder = nullptr;
+	}
+
+	if (stgmed.hGlobal)
+	{
+		ReleaseStgMedium(&stgmed);
+		stgmed.hGlobal = nullptr;
+	}
+
+	return hr;
+}
+
+/// <summary>
+/// Queues one item of a file group descriptor: a folder for the upload's folder creator, or a file's contents.
+/// </summary>
+/// <param name="pIDataObject">The dropped data object.</param>
+/// <param name="fd">The descriptor of the item.</param>
+/// <param name="index">Index of the item, which selects its CFSTR_FILECONTENTS.</param>
+/// <param name="szName">The validated name of the item, relative to the drop.</param>
+/// <param name="pUpload">The upload, not yet started.</param>
+/// <returns>S_OK if the item was queued; otherwise, the error the item fails with.</returns>
+HRESULT BigDriveDropTarget::QueueDescriptorItem(IDataObject* pIDataObject, const FILEDESCRIPTORW& fd, UINT index, LPCWSTR szName, BigDriveTreeUpload* pUpload)
+{
+	HRESULT hr = S_OK;
+	FORMATETC fmtecContents = { g_cfFileContents, nullptr, DVASPECT_CONTENT, static_cast<LONG>(index), TYMED_ISTREAM | TYMED_HGLOBAL };
+	STGMEDIUM stgmedContents = {};
+	IStream* pStream = nullptr;
+	LONGLONG size = -1;
+	LONGLONG lastWriteTime = 0;
+	SIZE_T cbGlobal = 0;
+	LPVOID pvGlobal = nullptr;
+
+	// A folder is listed ahead of the files under it; it is created before they are copied
+	if ((fd.dwFlags & FD_ATTRIBUTES) && (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return pUpload->AddFolder(szName);
+	}
+
+	size = (fd.dwFlags & FD_FILESIZE) ? static_cast<LONGLONG>((static_cast<ULONGLONG>(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow) : -1;
+	lastWriteTime = (fd.dwFlags & FD_WRITESTIME) ? static_cast<LONGLONG>((static_cast<ULONGLONG>(fd.ftLastWriteTime.dwHighDateTime) << 32) | fd.ftLastWriteTime.dwLowDateTime) : 0;
+
+	hr = pIDataObject->GetData(&fmtecContents, &stgmedContents);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	if (stgmedContents.tymed == TYMED_ISTREAM)
+	{
+		pStream = stgmedContents.pstm;
+		pStream->AddRef();
+	}
+	else
+	{
+		// Small sources hand over memory; it is copied, since the medium is released below
+		hr = ::CreateStreamOnHGlobal(nullptr, TRUE, &pStream);
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+
+		cbGlobal = ::GlobalSize(stgmedContents.hGlobal);
+		if ((size >= 0) && (static_cast<ULONGLONG>(size) < cbGlobal))
+		{
+			cbGlobal = static_cast<SIZE_T>(size);
+		}
+
+		pvGlobal = ::GlobalLock(stgmedContents.hGlobal);
+		if (pvGlobal)
+		{
+			hr = pStream->Write(pvGlobal, static_cast<ULONG>(cbGlobal), nullptr);
+			::GlobalUnlock(stgmedContents.hGlobal);
+			pvGlobal = nullptr;
+		}
+		else
+		{
+			hr = E_FAIL;
+		}
+
+		if (SUCCEEDED(hr))
+		{
+			LARGE_INTEGER liZero = {};
+			hr = pStream->Seek(liZero, STREAM_SEEK_SET, nullptr);
+		}
+
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+	}
+
+	hr = pUpload->AddStream(pStream, szName, size, lastWriteTime);
+
+End:
+
+	if (pStream)
+	{
+		pStream->Release();
+		pStream = nullptr;
+	}
+
+	if (stgmedContents.tymed != TYMED_NULL)
+	{
+		::ReleaseStgMedium(&stgmedContents);
+	}
+
+	return hr;
+}
+
+/// <summary>
+/// Checks a name from a file group descriptor, which comes from the drag source and can't be trusted, before it is
+/// used as a path under the target folder.
+/// </summary>
+/// <param name="cFileName">The cFileName of the descriptor, which may not be terminated.</param>
+/// <returns>S_OK if the name is a relative path that stays under the target folder; HRESULT_FROM_WIN32(ERROR_FILENAME_EXCED_RANGE)
+/// if it fills the field without a terminator; otherwise, HRESULT_FROM_WIN32(ERROR_INVALID_NAME).</returns>
+HRESULT BigDriveDropTarget::ValidateDescriptorName(const WCHAR (&cFileName)[MAX_PATH])
+{
+	size_t cch = ::wcsnlen(cFileName, MAX_PATH);
+	size_t cchSegment = 0;
+
+	// Would be cut short
+	if (cch == MAX_PATH)
+	{
+		return HRESULT_FROM_WIN32(ERROR_FILENAME_EXCED_RANGE);
+	}
+
+	// Rooted, drive-qualified, or a stream name; the shell itself only ever uses backslashes
+	if ((cch == 0) || (cFileName[0] == L'\\') || (::wcspbrk(cFileName, L":/") != nullptr))
+	{
+		return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
+	}
+
+	// Every segment must name something: no "\\", no trailing backslash, and no "." or ".." to climb out with
+	for (size_t i = 0; i <= cch; i++)
+	{
+		if ((i < cch) && (cFileName[i] != L'\\'))
+		{
+			cchSegment++;
+			continue;
+		}
+
+		if ((cchSegment == 0) ||
+			((cchSegment == 1) && (cFileName[i - 1] == L'.')) ||
+			((cchSegment == 2) && (cFileName[i - 1] == L'.') && (cFileName[i - 2] == L'.')))
+		{
+			return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
+		}
+
+		cchSegment = 0;
+	}
+
+	return S_OK;
+}
+
 /// <inheritdoc />
 HRESULT BigDriveDropTarget::WriteError(LPCWSTR szMessage)
 {
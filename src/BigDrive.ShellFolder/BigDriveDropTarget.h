@@ -27,6 +27,11 @@ private:
     /// </summary>
     class BigDriveShellFolder* m_pFolder;
 
+    /// <summary>
+    /// The view window the drop target was created for, which owns the upload's progress and summary.
+    /// </summary>
+    HWND m_hwndOwner;
+
     /// <summary>
     /// Indicates if the current drag operation is allowed.
     /// </summary>
@@ -48,7 +53,8 @@ public:
     /// Initializes a new instance of the <see cref="BigDriveDropTarget"/> class.
     /// </summary>
     /// <param name="pFolder">Pointer to the parent shell folder.</param>
-    BigDriveDropTarget(class BigDriveShellFolder* pFolder);
+    /// <param name="hwndOwner">The view window the drop target was created for, or nullptr.</param>
+    BigDriveDropTarget(class BigDriveShellFolder* pFolder, HWND hwndOwner);
 
     /// <summary>
     /// Destroys an instance of the <see cref="BigDriveDropTarget"/> class.
@@ -146,6 +152,32 @@ private:
     /// <returns>Returns an HRESULT indicating success or failure of the operation.</returns>
     HRESULT ProcessShellIdListDrop(IDataObject* pIDataObject);
 
+    /// <summary>
+    /// Processes a drop of virtual files (CFSTR_FILEDESCRIPTOR and CFSTR_FILECONTENTS), such as files
+    /// dragged from another BigDrive drive or from a compressed folder, uploading each file's stream.
+    /// </summary>
+    /// <param name="pIDataObject">A pointer to an IDataObject that contains the file descriptors and contents to process.</param>
+    /// <returns>Returns an HRESULT indicating success or failure of the operation.</returns>
+    HRESULT ProcessFileContentsDrop(IDataObject* pIDataObject);
+
+    /// <summary>
+    /// Queues one item of a file group descriptor for upload: a folder to create, or a file's contents.
+    /// </summary>
+    /// <param name="pIDataObject">The dropped data object.</param>
+    /// <param name="fd">The descriptor of the item.</param>
+    /// <param name="index">Index of the item, which selects its CFSTR_FILECONTENTS.</param>
+    /// <param name="szName">The validated name of the item, relative to the drop.</param>
+    /// <param name="pUpload">The upload, not yet started.</param>
+    /// <returns>S_OK if the item was queued; otherwise, the error the item fails with.</returns>
+    HRESULT QueueDescriptorItem(IDataObject* pIDataObject, const FILEDESCRIPTORW& fd, UINT index, LPCWSTR szName, class BigDriveTreeUpload* pUpload);
+
+    /// <summary>
+    /// Checks that a name from a file group descriptor is a relative path that stays under the target folder.
+    /// </summary>
+    /// <param name="cFileName">The name, which may not be terminated.</param>
+    /// <returns>S_OK if the name can be used; otherwise, the error the item fails with.</returns>
+    static HRESULT ValidateDescriptorName(const WCHAR (&cFileName)[MAX_PATH]);
+
     HRESULT WriteError(LPCWSTR szMessage);
 
     HRESULT WriteErrorFormatted(LPCWSTR formatter, ...);
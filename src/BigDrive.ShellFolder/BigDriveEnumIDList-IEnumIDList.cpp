@@ -18,11 +18,25 @@ HRESULT __stdcall BigDriveEnumIDList::Next(ULONG celt, LPITEMIDLIST* rgelt, ULON
 {
     if (!rgelt) return E_POINTER;
 
+    // Only a single item can be asked for without a count to say how many came back
+    if ((celt > 1) && (pceltFetched == nullptr))
+    {
+        return E_POINTER;
+    }
+
+    HRESULT hr = S_OK;
+    ULONG count = m_pSnapshot ? m_pSnapshot->GetCount() : 0;
     ULONG fetched = 0;
 
-    while (fetched < celt && m_index < m_count)
+    // The caller owns what it gets, so each PIDL handed out is a copy out of the snapshot
+    while (fetched < celt && m_index < count)
     {
-        rgelt[fetched] = ILClone(m_pidls[m_index]);
+        hr = m_pSnapshot->CopyItem(m_index, &rgelt[fetched]);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
         ++m_index;
         ++fetched;
     }
@@ -32,6 +46,11 @@ HRESULT __stdcall BigDriveEnumIDList::Next(ULONG celt, LPITEMIDLIST* rgelt, ULON
         *pceltFetched = fetched;
     }
 
+    if (FAILED(hr) && (fetched == 0))
+    {
+        return hr;
+    }
+
     return (fetched == celt) ? S_OK : S_FALSE;
 }
 
@@ -40,9 +59,17 @@ HRESULT __stdcall BigDriveEnumIDList::Next(ULONG celt, LPITEMIDLIST* rgelt, ULON
 /// </summary>
 HRESULT __stdcall BigDriveEnumIDList::Skip(ULONG celt)
 {
+    ULONG count = m_pSnapshot ? m_pSnapshot->GetCount() : 0;
+
+    // S_OK when all celt were skipped, even if that reaches the end; S_FALSE only when fewer remained
+    if (celt > count - m_index)
+    {
+        m_index = count;
+        return S_FALSE;
+    }
+
     m_index += celt;
-    if (m_index > m_count) m_index = m_count;
-    return (m_index < m_count) ? S_OK : S_FALSE;
+    return S_OK;
 }
 
 /// <summary>
@@ -55,13 +82,17 @@ HRESULT __stdcall BigDriveEnumIDList::Reset()
 }
 
 /// <summary>
-/// Creates a new enumerator with the same state as the current one.
+/// Creates a new enumerator with the same state as the current one, sharing its PIDLs.
 /// </summary>
 HRESULT __stdcall BigDriveEnumIDList::Clone(IEnumIDList** ppenum)
 {
     if (!ppenum) return E_POINTER;
-    BigDriveEnumIDList* pClone = new BigDriveEnumIDList(m_pidls, m_count);
-    pClone->m_index = m_index;
+
+    *ppenum = nullptr;
+
+    BigDriveEnumIDList* pClone = new BigDriveEnumIDList(m_pSnapshot, m_index);
+    if (!pClone) return E_OUTOFMEMORY;
+
     *ppenum = pClone;
     return S_OK;
-}
\ No newline at end of file
+}
@@ -9,117 +9,143 @@
 #include "pch.h"
 
 #include "BigDriveEnumIDList.h"
+#include "..\BigDrive.Client\BigDrivePerformanceCounters.h"
 #include <shlobj.h>
 
 /// <summary>
 /// Constructs a new BigDriveEnumIDList for the given array of PIDLs.
-/// The enumerator clones each PIDL and manages their lifetime.
+/// The enumerator copies each PIDL; the caller keeps the array.
 /// </summary>
 BigDriveEnumIDList::BigDriveEnumIDList(LPITEMIDLIST* pidls, ULONG count)
-    : m_refCount(1), m_index(0), m_count(count), m_capacity(count), m_pidls(nullptr)
+    : m_refCount(1), m_index(0), m_pSnapshot(nullptr)
 {
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveEnumIDLists);
+
+    if (FAILED(BigDriveItemIdSnapshot::Create(count, &m_pSnapshot)))
+    {
+        return;
+    }
+
     if (count > 0 && pidls)
     {
-        m_pidls = new LPITEMIDLIST[count];
         for (ULONG i = 0; i < count; ++i)
         {
-            m_pidls[i] = ILClone(pidls[i]);
+            m_pSnapshot->Append(pidls[i]);
         }
     }
 }
 
 /// <summary>
-/// Constructs a new BigDriveEnumIDList with a preallocated buffer for the specified number of PIDLs.
+/// Constructs a new BigDriveEnumIDList with room reserved for the specified number of PIDLs.
 /// </summary>
 BigDriveEnumIDList::BigDriveEnumIDList(ULONG initialCapacity)
-    : m_refCount(1), m_index(0), m_count(0), m_capacity(initialCapacity), m_pidls(nullptr)
+    : m_refCount(1), m_index(0), m_pSnapshot(nullptr)
 {
-    if (initialCapacity > 0)
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveEnumIDLists);
+
+    BigDriveItemIdSnapshot::Create(initialCapacity, &m_pSnapshot);
+}
+
+/// <summary>
+/// Constructs an enumerator over a snapshot shared with another enumerator.
+/// </summary>
+BigDriveEnumIDList::BigDriveEnumIDList(BigDriveItemIdSnapshot* pSnapshot, ULONG index)
+    : m_refCount(1), m_index(index), m_pSnapshot(pSnapshot)
+{
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveEnumIDLists);
+
+    if (m_pSnapshot)
     {
-        m_pidls = new LPITEMIDLIST[initialCapacity];
-        for (ULONG i = 0; i < initialCapacity; ++i)
-        {
-            m_pidls[i] = nullptr;
-        }
+        m_pSnapshot->AddRef();
     }
 }
 
 /// <summary>
-/// Destructor. Releases all cloned PIDLs and internal resources.
+/// Destructor. Releases the snapshot.
 /// </summary>
 BigDriveEnumIDList::~BigDriveEnumIDList()
 {
-    if (m_pidls)
-    {
-        for (ULONG i = 0; i < m_count; ++i)
-        {
-            if (m_pidls[i]) ILFree(m_pidls[i]);
-        }
+    BigDrivePerformanceCounters::Decrement(BigDriveCounter_LiveEnumIDLists);
 
-        delete[] m_pidls;
+    if (m_pSnapshot)
+    {
+        m_pSnapshot->Release();
+        m_pSnapshot = nullptr;
     }
 }
 
 /// <summary>
-/// Adds a new PIDL to the enumerator. The PIDL is cloned and managed by the enumerator.
+/// Adds a PIDL to the enumerator, which takes ownership of it.
 /// </summary>
-/// <param name="pidl">The PIDL to add. This method clones the PIDL.</param>
+/// <param name="pidl">The PIDL. Freed by the enumerator on S_OK; the caller keeps it otherwise.</param>
 /// <returns>S_OK if added successfully; E_OUTOFMEMORY if allocation fails; E_INVALIDARG if pidl is nullptr.</returns>
 HRESULT BigDriveEnumIDList::Add(LPITEMIDLIST pidl)
 {
+    HRESULT hr = S_OK;
+
     if (!pidl)
     {
         return E_INVALIDARG;
     }
 
-    if (m_count < m_capacity)
+    hr = PrepareToAdd();
+    if (FAILED(hr))
     {
-        m_pidls[m_count] = ::ILClone(pidl);
-        if (!m_pidls[m_count])
-        {
-            return E_OUTOFMEMORY;
-        }
-
-		// Successfully added the PIDL, increment the count
-        ++m_count;
-        return S_OK;
+        return hr;
     }
 
-    // Need to grow the buffer
-    ULONG newCapacity = (m_capacity == 0) ? 4 : m_capacity * 2;
-
-    LPITEMIDLIST* newArray = new LPITEMIDLIST[newCapacity];
-    if (!newArray)
+    hr = m_pSnapshot->Append(pidl);
+    if (FAILED(hr))
     {
-        return E_OUTOFMEMORY;
+        return hr;
     }
 
-    for (ULONG i = 0; i < m_count; ++i)
-    {
-        newArray[i] = m_pidls[i];
-    }
+    ::ILFree(pidl);
+
+    return S_OK;
+}
 
-    newArray[m_count] = ::ILClone(pidl);
-    if (!newArray[m_count])
+/// <summary>
+/// Adds a BigDrive item, encoding it straight into the enumerator's storage.
+/// </summary>
+HRESULT BigDriveEnumIDList::AddItem(UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata)
+{
+    HRESULT hr = S_OK;
+
+    hr = PrepareToAdd();
+    if (FAILED(hr))
     {
-        delete[] newArray;
-        return E_OUTOFMEMORY;
+        return hr;
     }
 
-    for (ULONG i = m_count + 1; i < newCapacity; ++i)
+    return m_pSnapshot->AppendItem(uType, szName, cchName, pMetadata);
+}
+
+/// <summary>
+/// Makes sure the enumerator has a snapshot of its own to add to.
+/// </summary>
+HRESULT BigDriveEnumIDList::PrepareToAdd()
+{
+    HRESULT hr = S_OK;
+    BigDriveItemIdSnapshot* pCopy = nullptr;
+
+    if (m_pSnapshot == nullptr)
     {
-        newArray[i] = nullptr;
+        return BigDriveItemIdSnapshot::Create(0, &m_pSnapshot);
     }
 
-    if (m_pidls)
+    // A clone may be reading the shared snapshot; leave it as it was
+    if (m_pSnapshot->IsShared())
     {
-        delete[] m_pidls;
-		m_pidls = nullptr;
-    }
+        hr = m_pSnapshot->Copy(&pCopy);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
 
-    m_pidls = newArray;
-    ++m_count;
-    m_capacity = newCapacity;
+        m_pSnapshot->Release();
+        m_pSnapshot = pCopy;
+    }
 
     return S_OK;
-}
\ No newline at end of file
+}
@@ -10,17 +10,25 @@
 
 #include <shlobj.h>
 
+#include "BigDriveItemIdSnapshot.h"
+
 /// <summary>
 /// Implements IEnumIDList for enumerating a known array of PIDLs.
-/// Each PIDL is cloned and managed by this enumerator.
+/// The PIDLs are held in a <see cref="BigDriveItemIdSnapshot"/> that Clone shares rather than copies;
+/// Next copies out only the PIDLs the caller asks for.
 /// </summary>
 class BigDriveEnumIDList : public IEnumIDList
 {
     LONG m_refCount;
     ULONG m_index;
-    ULONG m_count;      // Number of PIDLs currently stored
-    ULONG m_capacity;   // Size of the allocated buffer
-    LPITEMIDLIST* m_pidls;
+    BigDriveItemIdSnapshot* m_pSnapshot;    // Shared with clones; nullptr if it could not be allocated, retried by Add
+
+    /// <summary>
+    /// Constructs an enumerator over a snapshot shared with another enumerator.
+    /// </summary>
+    /// <param name="pSnapshot">The snapshot. The enumerator AddRefs it.</param>
+    /// <param name="index">The position of the enumerator.</param>
+    BigDriveEnumIDList(BigDriveItemIdSnapshot* pSnapshot, ULONG index);
 
 public:
 
@@ -28,26 +36,27 @@ public:
     /// Default constructor. Initializes an empty enumerator with no PIDLs.
     /// </summary>
     BigDriveEnumIDList()
-        : m_refCount(1), m_index(0), m_count(0), m_capacity(0), m_pidls(nullptr)
+        : m_refCount(1), m_index(0), m_pSnapshot(nullptr)
     {
+        BigDriveItemIdSnapshot::Create(0, &m_pSnapshot);
     }
 
     /// <summary>
     /// Constructs a new BigDriveEnumIDList for the given array of PIDLs.
-    /// The enumerator clones each PIDL and manages their lifetime.
+    /// The enumerator copies each PIDL; the caller keeps the array.
     /// </summary>
     /// <param name="pidls">Array of LPITEMIDLIST to enumerate.</param>
     /// <param name="count">Number of PIDLs in the array.</param>
     BigDriveEnumIDList(LPITEMIDLIST* pidls, ULONG count);
 
     /// <summary>
-    /// Constructs a new BigDriveEnumIDList with a preallocated buffer for the specified number of PIDLs.
+    /// Constructs a new BigDriveEnumIDList with room reserved for the specified number of PIDLs.
     /// </summary>
     /// <param name="initialCapacity">Initial buffer size for PIDLs.</param>
     BigDriveEnumIDList(ULONG initialCapacity);
 
     /// <summary>
-    /// Destructor. Releases all cloned PIDLs and internal resources.
+    /// Destructor. Releases the snapshot.
     /// </summary>
     virtual ~BigDriveEnumIDList();
 
@@ -94,12 +103,34 @@ public:
     HRESULT __stdcall Reset() override;
 
     /// <summary>
-    /// Creates a new enumerator with the same state as the current one.
+    /// Creates a new enumerator with the same state as the current one, sharing its PIDLs.
     /// </summary>
     /// <param name="ppenum">Receives the new enumerator instance.</param>
     HRESULT __stdcall Clone(IEnumIDList** ppenum) override;
 
 public:
 
+    /// <summary>
+    /// Adds a PIDL to the enumerator, which takes ownership of it.
+    /// </summary>
+    /// <param name="pidl">The PIDL, allocated with the COM task allocator. Freed by the enumerator on S_OK; the caller keeps it otherwise.</param>
+    /// <returns>S_OK if added; E_INVALIDARG if pidl is nullptr; E_OUTOFMEMORY.</returns>
     HRESULT Add(LPITEMIDLIST pidl);
+
+    /// <summary>
+    /// Adds a BigDrive item, encoding it straight into the enumerator's storage without allocating a PIDL.
+    /// </summary>
+    /// <param name="uType">The BigDriveItemType of the item.</param>
+    /// <param name="szName">The name of the item. Need not be null terminated.</param>
+    /// <param name="cchName">Number of characters of the name.</param>
+    /// <param name="pMetadata">The metadata, or nullptr to encode the name only.</param>
+    /// <returns>S_OK if added; E_INVALIDARG; E_OUTOFMEMORY.</returns>
+    HRESULT AddItem(UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata);
+
+private:
+
+    /// <summary>
+    /// Makes sure the enumerator has a snapshot of its own to add to, copying it if a clone shares it.
+    /// </summary>
+    HRESULT PrepareToAdd();
 };
\ No newline at end of file
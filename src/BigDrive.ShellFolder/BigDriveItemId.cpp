@@ -0,0 +1,261 @@
+// <copyright file="BigDriveItemId.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+// Header
+#include "BigDriveItemId.h"
+
+// System
+#include <limits.h>
+#include <oleauto.h>
+#include <string.h>
+
+// Local
+#include "BigDriveItemType.h"
+
+namespace
+{
+    // Offsets of the fixed prefix
+    const size_t OffsetType = sizeof(USHORT);
+    const size_t OffsetName = sizeof(USHORT) + sizeof(UINT);
+
+    // Offsets within the metadata block
+    const size_t BlockSignature = 0;
+    const size_t BlockVersion = 4;
+    const size_t BlockSize = 6;
+    const size_t BlockFields = 8;
+    const size_t BlockAttributes = 12;
+    const size_t BlockFileSize = 16;
+    const size_t BlockLastWrite = 24;
+    const size_t BlockChangeToken = 32;
+
+    // Smallest block header that identifies a block of any version
+    const size_t BlockHeaderSize = 8;
+
+    template <typename T>
+    inline T ReadValue(const BYTE* p)
+    {
+        T value;
+        ::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    inline void WriteValue(BYTE* p, T value)
+    {
+        ::memcpy(p, &value, sizeof(T));
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemId::GetEncodedSize(size_t cchName, USHORT& cbItem)
+{
+    size_t cb = OffsetName + (cchName + 1) * sizeof(WCHAR) + MetadataBlockSize + sizeof(USHORT);
+
+    // Leave room for the SHITEMID terminator of the list
+    if (cb > (USHRT_MAX - sizeof(USHORT)))
+    {
+        cbItem = 0;
+        return E_INVALIDARG;
+    }
+
+    cbItem = static_cast<USHORT>(cb);
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemId::Encode(BYTE* pBuffer, size_t cbBuffer, UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata, USHORT& cbItem)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemMetadata none = { 0 };
+    size_t offsetBlock = OffsetName + (cchName + 1) * sizeof(WCHAR);
+    BYTE* pBlock = nullptr;
+
+    cbItem = 0;
+
+    if ((pBuffer == nullptr) || ((szName == nullptr) && (cchName > 0)))
+    {
+        return E_INVALIDARG;
+    }
+
+    hr = GetEncodedSize(cchName, cbItem);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (cbBuffer < cbItem)
+    {
+        cbItem = 0;
+        return E_NOT_SUFFICIENT_BUFFER;
+    }
+
+    WriteValue<USHORT>(pBuffer, cbItem);
+    WriteValue<UINT>(pBuffer + OffsetType, uType);
+
+    if (cchName > 0)
+    {
+        ::memcpy(pBuffer + OffsetName, szName, cchName * sizeof(WCHAR));
+    }
+
+    WriteValue<WCHAR>(pBuffer + OffsetName + cchName * sizeof(WCHAR), L'\0');
+
+    // Every item carries the block, so the signature tells BigDrive items from anything else
+    if (pMetadata == nullptr)
+    {
+        pMetadata = &none;
+    }
+
+    pBlock = pBuffer + offsetBlock;
+
+    WriteValue<DWORD>(pBlock + BlockSignature, BIGDRIVE_ITEMID_SIGNATURE);
+    WriteValue<USHORT>(pBlock + BlockVersion, BIGDRIVE_ITEMID_VERSION);
+    WriteValue<USHORT>(pBlock + BlockSize, MetadataBlockSize);
+    WriteValue<DWORD>(pBlock + BlockFields, pMetadata->dwFields);
+    WriteValue<DWORD>(pBlock + BlockAttributes, pMetadata->dwAttributes);
+    WriteValue<ULONGLONG>(pBlock + BlockFileSize, pMetadata->ullSize);
+    WriteValue<FILETIME>(pBlock + BlockLastWrite, pMetadata->ftLastWrite);
+    WriteValue<ULONGLONG>(pBlock + BlockChangeToken, pMetadata->ullChangeToken);
+
+    WriteValue<USHORT>(pBlock + MetadataBlockSize, static_cast<USHORT>(offsetBlock));
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemId::Decode(const BYTE* pItem, BigDriveItemIdView& view)
+{
+    USHORT cb = 0;
+    USHORT offsetBlock = 0;
+    USHORT cbBlock = 0;
+    size_t nameLimit = 0;
+    size_t cch = 0;
+    const BYTE* pBlock = nullptr;
+
+    ::ZeroMemory(&view, sizeof(BigDriveItemIdView));
+
+    if (pItem == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Minimum size: [USHORT cb][UINT uType][at least one WCHAR for szName + null]
+    cb = ReadValue<USHORT>(pItem);
+    if (cb < OffsetName + 2 * sizeof(WCHAR))
+    {
+        return E_INVALIDARG;
+    }
+
+    view.uType = ReadValue<UINT>(pItem + OffsetType);
+    if ((view.uType != BigDriveItemType_File) && (view.uType != BigDriveItemType_Folder))
+    {
+        return E_INVALIDARG;
+    }
+
+    nameLimit = cb;
+
+    // Items with a metadata block end with the offset of the block; legacy items end with the name terminator
+    offsetBlock = ReadValue<USHORT>(pItem + cb - sizeof(USHORT));
+    if (offsetBlock != 0)
+    {
+        if ((offsetBlock < OffsetName + 2 * sizeof(WCHAR)) ||
+            (static_cast<size_t>(offsetBlock) + BlockHeaderSize > static_cast<size_t>(cb) - sizeof(USHORT)))
+        {
+            return E_INVALIDARG;
+        }
+
+        pBlock = pItem + offsetBlock;
+
+        if (ReadValue<DWORD>(pBlock + BlockSignature) != BIGDRIVE_ITEMID_SIGNATURE)
+        {
+            return E_INVALIDARG;
+        }
+
+        view.wVersion = ReadValue<USHORT>(pBlock + BlockVersion);
+        cbBlock = ReadValue<USHORT>(pBlock + BlockSize);
+
+        // Later versions may grow the block, but must keep the version 1 fields
+        if ((view.wVersion < BIGDRIVE_ITEMID_VERSION) ||
+            (cbBlock < MetadataBlockSize) ||
+            (static_cast<size_t>(offsetBlock) + cbBlock > static_cast<size_t>(cb) - sizeof(USHORT)))
+        {
+            return E_INVALIDARG;
+        }
+
+        view.metadata.dwFields = ReadValue<DWORD>(pBlock + BlockFields);
+        view.metadata.dwAttributes = ReadValue<DWORD>(pBlock + BlockAttributes);
+        view.metadata.ullSize = ReadValue<ULONGLONG>(pBlock + BlockFileSize);
+        view.metadata.ftLastWrite = ReadValue<FILETIME>(pBlock + BlockLastWrite);
+        view.metadata.ullChangeToken = ReadValue<ULONGLONG>(pBlock + BlockChangeToken);
+
+        nameLimit = offsetBlock;
+    }
+
+    // The name must be non-empty and null terminated before the block
+    view.szName = reinterpret_cast<LPCWSTR>(pItem + OffsetName);
+
+    for (cch = 0; OffsetName + (cch + 1) * sizeof(WCHAR) <= nameLimit; ++cch)
+    {
+        if (ReadValue<WCHAR>(pItem + OffsetName + cch * sizeof(WCHAR)) == L'\0')
+        {
+            break;
+        }
+    }
+
+    // The terminator ends the name part: right before the block, or the item itself for a legacy item
+    if ((OffsetName + (cch + 1) * sizeof(WCHAR) != nameLimit) || (cch == 0))
+    {
+        ::ZeroMemory(&view, sizeof(BigDriveItemIdView));
+        return E_INVALIDARG;
+    }
+
+    view.cchName = cch;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemId::GetMetadata(const BYTE* pItem, BigDriveItemMetadata& metadata)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemIdView view;
+
+    ::ZeroMemory(&metadata, sizeof(BigDriveItemMetadata));
+
+    hr = Decode(pItem, view);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (view.metadata.dwFields == BigDriveItemField_None)
+    {
+        return S_FALSE;
+    }
+
+    metadata = view.metadata;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemId::FileTimeToDate(const FILETIME& ft, DATE& date)
+{
+    SYSTEMTIME st = { 0 };
+
+    date = 0;
+
+    if (!::FileTimeToSystemTime(&ft, &st))
+    {
+        return HRESULT_FROM_WIN32(::GetLastError());
+    }
+
+    if (!::SystemTimeToVariantTime(&st, &date))
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
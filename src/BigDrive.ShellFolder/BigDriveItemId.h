@@ -0,0 +1,167 @@
+// <copyright file="BigDriveItemId.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <windows.h>
+
+/// <summary>
+/// Signature of the metadata block appended to a BIGDRIVE_ITEMID ('BDID').
+/// </summary>
+#define BIGDRIVE_ITEMID_SIGNATURE 0x44494442
+
+/// <summary>
+/// Current version of the metadata block.
+/// </summary>
+#define BIGDRIVE_ITEMID_VERSION 1
+
+/// <summary>
+/// Bits of <see cref="BigDriveItemMetadata::dwFields"/> that say which metadata fields are present.
+/// </summary>
+enum BigDriveItemField
+{
+    BigDriveItemField_None = 0x00,
+    BigDriveItemField_Size = 0x01,
+    BigDriveItemField_LastWriteTime = 0x02,
+    BigDriveItemField_Attributes = 0x04,
+    BigDriveItemField_ChangeToken = 0x08,
+
+    // Hints with no payload: the provider knows whether the folder has children
+    BigDriveItemField_HasChildren = 0x10,
+    BigDriveItemField_NoChildren = 0x20
+};
+
+/// <summary>
+/// Item metadata carried in a BIGDRIVE_ITEMID so the shell view can be answered without a provider call.
+/// </summary>
+struct BigDriveItemMetadata
+{
+    /// <summary>
+    /// Combination of <see cref="BigDriveItemField"/> bits naming the valid fields.
+    /// </summary>
+    DWORD dwFields;
+
+    /// <summary>
+    /// FILE_ATTRIBUTE_* bits of the item.
+    /// </summary>
+    DWORD dwAttributes;
+
+    /// <summary>
+    /// Size of the item in bytes.
+    /// </summary>
+    ULONGLONG ullSize;
+
+    /// <summary>
+    /// Last write time of the item, in UTC.
+    /// </summary>
+    FILETIME ftLastWrite;
+
+    /// <summary>
+    /// Provider change token (for example a hash of the etag), used to detect stale items.
+    /// </summary>
+    ULONGLONG ullChangeToken;
+};
+
+/// <summary>
+/// A decoded view of a BIGDRIVE_ITEMID. The name points into the item and is only valid while the item is.
+/// </summary>
+struct BigDriveItemIdView
+{
+    /// <summary>
+    /// The BigDriveItemType of the item.
+    /// </summary>
+    UINT uType;
+
+    /// <summary>
+    /// The null terminated name of the item.
+    /// </summary>
+    LPCWSTR szName;
+
+    /// <summary>
+    /// Number of characters in the name, excluding the terminator.
+    /// </summary>
+    size_t cchName;
+
+    /// <summary>
+    /// Version of the metadata block, or zero for items written before the block existed.
+    /// </summary>
+    USHORT wVersion;
+
+    /// <summary>
+    /// The metadata. dwFields is zero when the item carries none.
+    /// </summary>
+    BigDriveItemMetadata metadata;
+};
+
+/// <summary>
+/// Encoder and decoder for the BigDrive item ID. The encoder writes the original
+/// [USHORT cb][UINT uType][WCHAR szName[]] prefix, so code that reads the type and
+/// name keeps working, followed by a versioned metadata block on every item:
+///
+///   [USHORT cb][UINT uType][WCHAR szName[] + null]
+///   [DWORD signature][USHORT version][USHORT cbBlock][DWORD fields][DWORD attributes]
+///   [ULONGLONG size][FILETIME lastWrite][ULONGLONG changeToken]
+///   [USHORT offsetOfBlock]
+///
+/// The trailing USHORT holds the offset of the block from the start of the item, and the
+/// block's signature identifies the item as BigDrive's. An item without metadata carries a
+/// block with no fields. Items written before the block existed end with the name's null
+/// terminator, so the trailing USHORT reads as zero; they are only accepted, as version zero
+/// with no metadata, when the terminator is the last character of the item. All fields are
+/// little endian and read with unaligned copies; the codec has no shell dependencies.
+/// </summary>
+class BigDriveItemId
+{
+public:
+
+    /// <summary>
+    /// Size in bytes of the version 1 metadata block, excluding the trailing offset.
+    /// </summary>
+    static const USHORT MetadataBlockSize = 40;
+
+    /// <summary>
+    /// Computes the encoded size of an item, which is the same with or without metadata.
+    /// </summary>
+    /// <param name="cchName">Number of characters in the name, excluding the terminator.</param>
+    /// <param name="cbItem">Receives the size of the item in bytes, including cb.</param>
+    /// <returns>S_OK on success; E_INVALIDARG if the item would not fit in a SHITEMID.</returns>
+    static HRESULT GetEncodedSize(size_t cchName, USHORT& cbItem);
+
+    /// <summary>
+    /// Encodes an item into a buffer.
+    /// </summary>
+    /// <param name="pBuffer">The destination buffer.</param>
+    /// <param name="cbBuffer">Size of the destination buffer in bytes.</param>
+    /// <param name="uType">The BigDriveItemType of the item.</param>
+    /// <param name="szName">The name of the item. Need not be null terminated.</param>
+    /// <param name="cchName">Number of characters of the name to encode.</param>
+    /// <param name="pMetadata">The metadata, or nullptr to encode a metadata block with no fields.</param>
+    /// <param name="cbItem">Receives the number of bytes written.</param>
+    /// <returns>S_OK on success; E_NOT_SUFFICIENT_BUFFER if the buffer is too small.</returns>
+    static HRESULT Encode(BYTE* pBuffer, size_t cbBuffer, UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata, USHORT& cbItem);
+
+    /// <summary>
+    /// Decodes and validates an item.
+    /// </summary>
+    /// <param name="pItem">The item, starting at its cb field.</param>
+    /// <param name="view">Receives the decoded item.</param>
+    /// <returns>S_OK if the item is a well formed BigDrive item; E_INVALIDARG otherwise.</returns>
+    static HRESULT Decode(const BYTE* pItem, BigDriveItemIdView& view);
+
+    /// <summary>
+    /// Retrieves the metadata carried by an item.
+    /// </summary>
+    /// <param name="pItem">The item, starting at its cb field.</param>
+    /// <param name="metadata">Receives the metadata.</param>
+    /// <returns>S_OK if the item carries metadata; S_FALSE if it doesn't; E_INVALIDARG if the item is malformed.</returns>
+    static HRESULT GetMetadata(const BYTE* pItem, BigDriveItemMetadata& metadata);
+
+    /// <summary>
+    /// Converts a FILETIME to an OLE automation date.
+    /// </summary>
+    /// <param name="ft">The FILETIME.</param>
+    /// <param name="date">Receives the date.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    static HRESULT FileTimeToDate(const FILETIME& ft, DATE& date);
+};
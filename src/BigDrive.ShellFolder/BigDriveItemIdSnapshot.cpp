@@ -0,0 +1,297 @@
+// <copyright file="BigDriveItemIdSnapshot.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements the BigDriveItemIdSnapshot class, the shared PIDL storage behind
+//   BigDriveEnumIDList.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDriveItemIdSnapshot.h"
+#include <objbase.h>
+
+/// <inheritdoc />
+BigDriveItemIdSnapshot::BigDriveItemIdSnapshot()
+    : m_refCount(1), m_pArena(nullptr), m_cbArena(0), m_cbCapacity(0), m_pOffsets(nullptr), m_count(0), m_capacity(0)
+{
+}
+
+/// <inheritdoc />
+BigDriveItemIdSnapshot::~BigDriveItemIdSnapshot()
+{
+    if (m_pArena)
+    {
+        ::CoTaskMemFree(m_pArena);
+        m_pArena = nullptr;
+    }
+
+    if (m_pOffsets)
+    {
+        ::CoTaskMemFree(m_pOffsets);
+        m_pOffsets = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemIdSnapshot::Create(ULONG capacity, BigDriveItemIdSnapshot** ppSnapshot)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemIdSnapshot* pSnapshot = nullptr;
+
+    *ppSnapshot = nullptr;
+
+    pSnapshot = new BigDriveItemIdSnapshot();
+    if (pSnapshot == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    if ((capacity > 0) && (capacity <= ULONG_MAX / EstimatedItemSize))
+    {
+        pSnapshot->m_pOffsets = static_cast<ULONG*>(::CoTaskMemAlloc(capacity * sizeof(ULONG)));
+        pSnapshot->m_pArena = static_cast<BYTE*>(::CoTaskMemAlloc(capacity * EstimatedItemSize));
+        if ((pSnapshot->m_pOffsets == nullptr) || (pSnapshot->m_pArena == nullptr))
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        pSnapshot->m_capacity = capacity;
+        pSnapshot->m_cbCapacity = capacity * EstimatedItemSize;
+    }
+
+    *ppSnapshot = pSnapshot;
+    pSnapshot = nullptr;
+
+End:
+
+    if (pSnapshot)
+    {
+        pSnapshot->Release();
+        pSnapshot = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+ULONG BigDriveItemIdSnapshot::AddRef()
+{
+    return ::InterlockedIncrement(&m_refCount);
+}
+
+/// <inheritdoc />
+ULONG BigDriveItemIdSnapshot::Release()
+{
+    ULONG res = ::InterlockedDecrement(&m_refCount);
+    if (res == 0) delete this;
+    return res;
+}
+
+/// <inheritdoc />
+BOOL BigDriveItemIdSnapshot::IsShared()
+{
+    return ::InterlockedCompareExchange(&m_refCount, 0, 0) > 1;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemIdSnapshot::Append(PCUIDLIST_RELATIVE pidl)
+{
+    HRESULT hr = S_OK;
+    UINT cbPidl = 0;
+
+    if (pidl == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    // ILGetSize counts the terminator
+    cbPidl = ::ILGetSize(pidl);
+
+    hr = Reserve(cbPidl);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    ::memcpy(m_pArena + m_cbArena, pidl, cbPidl);
+
+    m_pOffsets[m_count++] = m_cbArena;
+    m_cbArena += cbPidl;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemIdSnapshot::AppendItem(UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata)
+{
+    HRESULT hr = S_OK;
+    USHORT cbItem = 0;
+
+    if ((szName == nullptr) || (cchName == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    hr = BigDriveItemId::GetEncodedSize(cchName, cbItem);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = Reserve(cbItem + sizeof(USHORT));
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = BigDriveItemId::Encode(m_pArena + m_cbArena, m_cbCapacity - m_cbArena, uType, szName, cchName, pMetadata, cbItem);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Terminate the list after the one item
+    ::ZeroMemory(m_pArena + m_cbArena + cbItem, sizeof(USHORT));
+
+    m_pOffsets[m_count++] = m_cbArena;
+    m_cbArena += cbItem + sizeof(USHORT);
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemIdSnapshot::Copy(BigDriveItemIdSnapshot** ppCopy)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemIdSnapshot* pCopy = nullptr;
+
+    *ppCopy = nullptr;
+
+    pCopy = new BigDriveItemIdSnapshot();
+    if (pCopy == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    if (m_count > 0)
+    {
+        pCopy->m_pOffsets = static_cast<ULONG*>(::CoTaskMemAlloc(m_count * sizeof(ULONG)));
+        pCopy->m_pArena = static_cast<BYTE*>(::CoTaskMemAlloc(m_cbArena));
+        if ((pCopy->m_pOffsets == nullptr) || (pCopy->m_pArena == nullptr))
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        ::memcpy(pCopy->m_pOffsets, m_pOffsets, m_count * sizeof(ULONG));
+        ::memcpy(pCopy->m_pArena, m_pArena, m_cbArena);
+
+        pCopy->m_count = pCopy->m_capacity = m_count;
+        pCopy->m_cbArena = pCopy->m_cbCapacity = m_cbArena;
+    }
+
+    *ppCopy = pCopy;
+    pCopy = nullptr;
+
+End:
+
+    if (pCopy)
+    {
+        pCopy->Release();
+        pCopy = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+ULONG BigDriveItemIdSnapshot::GetCount()
+{
+    return m_count;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemIdSnapshot::CopyItem(ULONG index, LPITEMIDLIST* ppidl)
+{
+    const BYTE* pItem = nullptr;
+    ULONG cbItem = 0;
+
+    *ppidl = nullptr;
+
+    if (index >= m_count)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Items are back to back, so the next offset (or the end of the arena) bounds this one
+    pItem = m_pArena + m_pOffsets[index];
+    cbItem = ((index + 1 < m_count) ? m_pOffsets[index + 1] : m_cbArena) - m_pOffsets[index];
+
+    *ppidl = static_cast<LPITEMIDLIST>(::CoTaskMemAlloc(cbItem));
+    if (*ppidl == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    ::memcpy(*ppidl, pItem, cbItem);
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveItemIdSnapshot::Reserve(ULONG cbItem)
+{
+    ULONG capacity = 0;
+    ULONG cbCapacity = 0;
+    ULONG* pOffsets = nullptr;
+    BYTE* pArena = nullptr;
+
+    if (m_count == m_capacity)
+    {
+        if (m_capacity > (ULONG_MAX / sizeof(ULONG)) / 2)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        capacity = (m_capacity == 0) ? 16 : m_capacity * 2;
+
+        pOffsets = static_cast<ULONG*>(::CoTaskMemRealloc(m_pOffsets, capacity * sizeof(ULONG)));
+        if (pOffsets == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        m_pOffsets = pOffsets;
+        m_capacity = capacity;
+    }
+
+    if (cbItem > ULONG_MAX - m_cbArena)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    if (m_cbArena + cbItem > m_cbCapacity)
+    {
+        // Offsets, not pointers, are kept, so the block is free to move
+        cbCapacity = (m_cbCapacity == 0) ? 16 * EstimatedItemSize : m_cbCapacity;
+        while (cbCapacity < m_cbArena + cbItem)
+        {
+            cbCapacity = (cbCapacity > ULONG_MAX / 2) ? ULONG_MAX : cbCapacity * 2;
+        }
+
+        pArena = static_cast<BYTE*>(::CoTaskMemRealloc(m_pArena, cbCapacity));
+        if (pArena == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        m_pArena = pArena;
+        m_cbCapacity = cbCapacity;
+    }
+
+    return S_OK;
+}
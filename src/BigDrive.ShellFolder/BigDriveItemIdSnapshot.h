@@ -0,0 +1,140 @@
+// <copyright file="BigDriveItemIdSnapshot.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Declares the BigDriveItemIdSnapshot class, the shared PIDL storage behind
+//   BigDriveEnumIDList.
+// </summary>
+
+#pragma once
+
+#include <shlobj.h>
+
+#include "BigDriveItemId.h"
+
+/// <summary>
+/// Reference counted list of PIDLs held back to back in one arena block, each followed by its
+/// two byte terminator so it can be copied out with a single allocation. Items are encoded
+/// straight into the arena or copied in from an existing PIDL, so building the list costs a
+/// handful of block growths rather than several heap operations per item.
+///
+/// A snapshot is appended to only while one enumerator holds it. Once shared by a clone it is
+/// immutable; an enumerator that needs to add to a shared snapshot takes a copy first.
+/// </summary>
+class BigDriveItemIdSnapshot
+{
+public:
+
+    /// <summary>
+    /// Arena bytes reserved per item when a capacity is given, enough for a name of about twenty characters and metadata.
+    /// </summary>
+    static const ULONG EstimatedItemSize = 96;
+
+private:
+
+    LONG m_refCount;
+
+    /// <summary>
+    /// The items, allocated with CoTaskMemRealloc.
+    /// </summary>
+    BYTE* m_pArena;
+
+    /// <summary>
+    /// Number of arena bytes in use.
+    /// </summary>
+    ULONG m_cbArena;
+
+    /// <summary>
+    /// Number of arena bytes allocated.
+    /// </summary>
+    ULONG m_cbCapacity;
+
+    /// <summary>
+    /// Offset of each item in the arena, allocated with CoTaskMemRealloc.
+    /// </summary>
+    ULONG* m_pOffsets;
+
+    /// <summary>
+    /// Number of items.
+    /// </summary>
+    ULONG m_count;
+
+    /// <summary>
+    /// Number of offsets allocated.
+    /// </summary>
+    ULONG m_capacity;
+
+    BigDriveItemIdSnapshot();
+    ~BigDriveItemIdSnapshot();
+
+public:
+
+    /// <summary>
+    /// Creates an empty snapshot.
+    /// </summary>
+    /// <param name="capacity">Number of items to reserve room for. Zero reserves nothing.</param>
+    /// <param name="ppSnapshot">Receives the snapshot with a reference count of one.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY.</returns>
+    static HRESULT Create(ULONG capacity, BigDriveItemIdSnapshot** ppSnapshot);
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG AddRef();
+
+    /// <summary>
+    /// Decrements the reference count and deletes the snapshot if it reaches zero.
+    /// </summary>
+    ULONG Release();
+
+    /// <summary>
+    /// Determines whether more than one enumerator holds the snapshot, in which case it must not change.
+    /// </summary>
+    /// <returns>TRUE if the snapshot is shared.</returns>
+    BOOL IsShared();
+
+    /// <summary>
+    /// Copies a PIDL into the arena.
+    /// </summary>
+    /// <param name="pidl">The PIDL. The caller keeps it.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY.</returns>
+    HRESULT Append(PCUIDLIST_RELATIVE pidl);
+
+    /// <summary>
+    /// Encodes a BigDrive item straight into the arena.
+    /// </summary>
+    /// <param name="uType">The BigDriveItemType of the item.</param>
+    /// <param name="szName">The name of the item. Need not be null terminated.</param>
+    /// <param name="cchName">Number of characters of the name.</param>
+    /// <param name="pMetadata">The metadata, or nullptr to encode the name only.</param>
+    /// <returns>S_OK on success; E_INVALIDARG; E_OUTOFMEMORY.</returns>
+    HRESULT AppendItem(UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata);
+
+    /// <summary>
+    /// Creates an unshared copy of the snapshot, for an enumerator that must add to a shared one.
+    /// </summary>
+    /// <param name="ppCopy">Receives the copy with a reference count of one.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY.</returns>
+    HRESULT Copy(BigDriveItemIdSnapshot** ppCopy);
+
+    /// <summary>
+    /// Retrieves the number of items.
+    /// </summary>
+    /// <returns>The number of items.</returns>
+    ULONG GetCount();
+
+    /// <summary>
+    /// Copies an item out of the arena into a PIDL the caller owns.
+    /// </summary>
+    /// <param name="index">The index of the item.</param>
+    /// <param name="ppidl">Receives the PIDL. The caller must free it with ILFree.</param>
+    /// <returns>S_OK on success; E_INVALIDARG if the index is out of range; E_OUTOFMEMORY.</returns>
+    HRESULT CopyItem(ULONG index, LPITEMIDLIST* ppidl);
+
+private:
+
+    /// <summary>
+    /// Makes room for one more item of the given size, terminator included.
+    /// </summary>
+    HRESULT Reserve(ULONG cbItem);
+};
@@ -0,0 +1,160 @@
+// <copyright file="BigDrivePagedEnumIDList-IEnumIDList.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements IEnumIDList for the BigDrivePagedEnumIDList class.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDrivePagedEnumIDList.h"
+#include "BigDriveShellFolder.h"
+#include <shlobj.h>
+
+/// <summary>
+/// Retrieves the next set of PIDLs, fetching pages from the provider as needed.
+/// </summary>
+HRESULT __stdcall BigDrivePagedEnumIDList::Next(ULONG celt, LPITEMIDLIST* rgelt, ULONG* pceltFetched)
+{
+    HRESULT hr = S_OK;
+    BigDriveEnumerationEntry entry;
+    ULONG fetched = 0;
+
+    if (!rgelt) return E_POINTER;
+
+    if ((celt > 1) && (pceltFetched == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (pceltFetched)
+    {
+        *pceltFetched = 0;
+    }
+
+    // A failure held back from the last batch is returned once; the call after it tries the page again
+    if (FAILED(m_hrDeferred))
+    {
+        hr = m_hrDeferred;
+        m_hrDeferred = S_OK;
+        return hr;
+    }
+
+    while (fetched < celt)
+    {
+        hr = NextEntry(entry);
+        if (hr != S_OK)
+        {
+            break;
+        }
+
+        hr = BigDriveShellFolder::AllocBigDrivePidl(entry, rgelt[fetched]);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        ++m_index;
+        ++fetched;
+    }
+
+    if (pceltFetched)
+    {
+        *pceltFetched = fetched;
+    }
+
+    if (FAILED(hr))
+    {
+        if (fetched == 0)
+        {
+            return hr;
+        }
+
+        // Hand back what was fetched before the failure as a full batch, so the caller asks again and
+        // gets the failure rather than taking S_FALSE for the end of the folder
+        m_hrDeferred = hr;
+        return S_OK;
+    }
+
+    return (fetched == celt) ? S_OK : S_FALSE;
+}
+
+/// <summary>
+/// Skips the specified number of items.
+/// </summary>
+HRESULT __stdcall BigDrivePagedEnumIDList::Skip(ULONG celt)
+{
+    HRESULT hr = S_OK;
+    BigDriveEnumerationEntry entry;
+
+    if (FAILED(m_hrDeferred))
+    {
+        hr = m_hrDeferred;
+        m_hrDeferred = S_OK;
+        return hr;
+    }
+
+    for (ULONG i = 0; i < celt; ++i)
+    {
+        hr = NextEntry(entry);
+        if (hr != S_OK)
+        {
+            return hr;
+        }
+
+        ++m_index;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Resets the enumeration to the beginning.
+/// </summary>
+HRESULT __stdcall BigDrivePagedEnumIDList::Reset()
+{
+    m_index = 0;
+    m_writer.Reset();
+    m_fCacheable = TRUE;
+    m_hrDeferred = S_OK;
+    return m_cursor.Reset();
+}
+
+/// <summary>
+/// Creates a new enumerator at the same position.
+/// </summary>
+HRESULT __stdcall BigDrivePagedEnumIDList::Clone(IEnumIDList** ppenum)
+{
+    HRESULT hr = S_OK;
+    BigDrivePagedEnumIDList* pClone = nullptr;
+
+    if (!ppenum) return E_POINTER;
+
+    *ppenum = nullptr;
+
+    if (m_pEnumeratePaged == nullptr)
+    {
+        return E_UNEXPECTED;
+    }
+
+    pClone = new BigDrivePagedEnumIDList();
+    if (pClone == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    hr = pClone->Initialize(m_pEnumeratePaged, m_driveGuid, m_bstrPath, m_flags);
+    if (SUCCEEDED(hr) && (m_index > 0))
+    {
+        hr = pClone->Skip(m_index);
+    }
+
+    if (FAILED(hr))
+    {
+        pClone->Release();
+        return hr;
+    }
+
+    *ppenum = pClone;
+    return S_OK;
+}
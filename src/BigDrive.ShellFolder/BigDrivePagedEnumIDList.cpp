@@ -0,0 +1,100 @@
+// <copyright file="BigDrivePagedEnumIDList.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements the BigDrivePagedEnumIDList class, an IEnumIDList that streams the items
+//   of a folder from the provider one page at a time.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDrivePagedEnumIDList.h"
+#include "..\BigDrive.Client\BigDriveListingCache.h"
+#include "..\BigDrive.Client\BigDrivePerformanceCounters.h"
+#include <oleauto.h>
+
+/// <inheritdoc />
+BigDrivePagedEnumIDList::BigDrivePagedEnumIDList()
+    : m_refCount(1), m_index(0), m_pEnumeratePaged(nullptr), m_driveGuid(GUID_NULL), m_bstrPath(nullptr), m_flags(0),
+    m_writer(BigDriveListingCache::GetInstance().GetMaxListingSize()), m_fCacheable(TRUE), m_hrDeferred(S_OK)
+{
+    BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveEnumIDLists);
+}
+
+/// <inheritdoc />
+BigDrivePagedEnumIDList::~BigDrivePagedEnumIDList()
+{
+    BigDrivePerformanceCounters::Decrement(BigDriveCounter_LiveEnumIDLists);
+
+    if (m_bstrPath)
+    {
+        ::SysFreeString(m_bstrPath);
+        m_bstrPath = nullptr;
+    }
+
+    if (m_pEnumeratePaged)
+    {
+        m_pEnumeratePaged->Release();
+        m_pEnumeratePaged = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDrivePagedEnumIDList::Initialize(IBigDriveEnumeratePaged* pEnumeratePaged, REFGUID driveGuid, BSTR bstrPath, LONG flags)
+{
+    HRESULT hr = S_OK;
+
+    if ((pEnumeratePaged == nullptr) || (bstrPath == nullptr) || (m_pEnumeratePaged != nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_bstrPath = ::SysAllocStringLen(bstrPath, ::SysStringLen(bstrPath));
+    if (m_bstrPath == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    hr = m_cursor.Initialize(pEnumeratePaged, driveGuid, m_bstrPath, flags, BigDriveEnumerationCursor::DefaultPageSize);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_pEnumeratePaged = pEnumeratePaged;
+    m_pEnumeratePaged->AddRef();
+    m_driveGuid = driveGuid;
+    m_flags = flags;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDrivePagedEnumIDList::NextEntry(BigDriveEnumerationEntry& entry)
+{
+    HRESULT hr = S_OK;
+    const BYTE* pListing = nullptr;
+    ULONG cbListing = 0;
+
+    hr = m_cursor.Next(entry);
+
+    if ((hr == S_OK) && m_fCacheable && FAILED(m_writer.Append(entry)))
+    {
+        // Too large to cache; stop copying
+        m_fCacheable = FALSE;
+        m_writer.Reset();
+    }
+
+    if ((hr == S_FALSE) && m_fCacheable)
+    {
+        if (SUCCEEDED(m_writer.GetBuffer(&pListing, cbListing)))
+        {
+            BigDriveListingCache::GetInstance().Store(m_driveGuid, m_bstrPath, m_flags, pListing, cbListing);
+        }
+
+        m_fCacheable = FALSE;
+        m_writer.Reset();
+    }
+
+    return hr;
+}
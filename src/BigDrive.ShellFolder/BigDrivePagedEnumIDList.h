@@ -0,0 +1,116 @@
+// <copyright file="BigDrivePagedEnumIDList.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Declares the BigDrivePagedEnumIDList class, an IEnumIDList that streams the items
+//   of a folder from the provider one page at a time.
+// </summary>
+
+#pragma once
+
+#include <shlobj.h>
+
+#include "..\BigDrive.Client\BigDriveEnumerationCursor.h"
+#include "..\BigDrive.Client\BigDriveEnumerationWriter.h"
+
+/// <summary>
+/// Implements IEnumIDList over a <see cref="BigDriveEnumerationCursor"/>. PIDLs are created
+/// as the view asks for them, and the next page is requested from the provider only when the
+/// current one is used up, so the first items appear after one page and memory is bounded by
+/// the page size rather than the size of the folder. Folders small enough for the listing cache
+/// are copied as they are read and stored in the cache once the last page has been read.
+/// </summary>
+class BigDrivePagedEnumIDList : public IEnumIDList
+{
+    LONG m_refCount;
+    ULONG m_index;      // Number of items returned or skipped since the start
+    IBigDriveEnumeratePaged* m_pEnumeratePaged;
+    GUID m_driveGuid;
+    BSTR m_bstrPath;
+    LONG m_flags;
+    BigDriveEnumerationCursor m_cursor;
+    BigDriveEnumerationWriter m_writer;     // Copy of the entries read so far, for the listing cache
+    BOOL m_fCacheable;                      // FALSE once the copy has been stored or outgrown the cache
+    HRESULT m_hrDeferred;                   // Failure held back from a partial batch, returned by the next call
+
+    /// <summary>
+    /// Reads the next entry from the cursor, copying it for the listing cache.
+    /// </summary>
+    /// <param name="entry">Receives the entry.</param>
+    /// <returns>S_OK if an entry was read; S_FALSE at the end; otherwise, the provider's error.</returns>
+    HRESULT NextEntry(BigDriveEnumerationEntry& entry);
+
+public:
+
+    /// <summary>
+    /// Default constructor. The enumerator is empty until <see cref="Initialize"/> is called.
+    /// </summary>
+    BigDrivePagedEnumIDList();
+
+    /// <summary>
+    /// Destructor. Releases the provider interface and the current page.
+    /// </summary>
+    virtual ~BigDrivePagedEnumIDList();
+
+    /// <summary>
+    /// Prepares the enumerator. No provider call is made until the first call to Next.
+    /// </summary>
+    /// <param name="pEnumeratePaged">The provider interface. The enumerator AddRefs it.</param>
+    /// <param name="driveGuid">The drive to enumerate.</param>
+    /// <param name="bstrPath">The path to enumerate, as passed to providers.</param>
+    /// <param name="flags">BigDriveEnumerateEntries flags.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT Initialize(IBigDriveEnumeratePaged* pEnumeratePaged, REFGUID driveGuid, BSTR bstrPath, LONG flags);
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // IUnknown methods
+
+    /// <summary>
+    /// Queries for a supported interface (IUnknown or IEnumIDList).
+    /// </summary>
+    HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) override;
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG __stdcall AddRef() override;
+
+    /// <summary>
+    /// Decrements the reference count and deletes the object if it reaches zero.
+    /// </summary>
+    ULONG __stdcall Release() override;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // IEnumIDList methods
+
+    /// <summary>
+    /// Retrieves the next set of PIDLs, fetching pages from the provider as needed.
+    /// </summary>
+    /// <param name="celt">Number of PIDLs to retrieve.</param>
+    /// <param name="rgelt">Array to receive the PIDLs.</param>
+    /// <param name="pceltFetched">Receives the number of PIDLs actually fetched.</param>
+    /// <returns>
+    /// S_OK if the requested number was fetched, or if a page failed after some were, in which case the
+    /// failure is returned by the next call; S_FALSE if fewer were available; otherwise, the provider's error.
+    /// </returns>
+    HRESULT __stdcall Next(ULONG celt, LPITEMIDLIST* rgelt, ULONG* pceltFetched) override;
+
+    /// <summary>
+    /// Skips the specified number of items.
+    /// </summary>
+    /// <param name="celt">Number of items to skip.</param>
+    /// <returns>S_OK if skipped, S_FALSE if the end was reached.</returns>
+    HRESULT __stdcall Skip(ULONG celt) override;
+
+    /// <summary>
+    /// Resets the enumeration to the beginning. The next call to Next requests the first page again.
+    /// </summary>
+    HRESULT __stdcall Reset() override;
+
+    /// <summary>
+    /// Creates a new enumerator at the same position. The clone pages through the folder on its own.
+    /// </summary>
+    /// <param name="ppenum">Receives the new enumerator instance.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY if the clone couldn't be allocated; otherwise, the error positioning it.</returns>
+    HRESULT __stdcall Clone(IEnumIDList** ppenum) override;
+};
@@ -14,6 +14,10 @@
 #include "..\BigDrive.Client\BigDriveInterfaceProvider.h"
 #include "BigDriveEnumIDList.h"
 #include "..\BigDrive.Client\BigDriveConfigurationClient.h"
+#include "..\BigDrive.Client\BigDriveEnumerationWriter.h"
+#include "..\BigDrive.Client\BigDriveListingCache.h"
+#include "..\BigDrive.Client\BigDriveReadAheadStream.h"
+#include "BigDriveShellFolderCache.h"
 #include "..\BigDrive.Client\DriveConfiguration.h"
 #include "BigDriveShellIcon.h"
 #include "ILExtensions.h"
@@ -204,15 +208,17 @@ HRESULT __stdcall BigDriveShellFolder::EnumObjects(HWND hwnd, DWORD grfFlags, IE
 	BigDriveInterfaceProvider* pInterfaceProvider = nullptr;
 	BSTR folderName = nullptr;
 	LONG lowerBound = 0, upperBound = 0;
-	IBigDriveEnumerate* pBigDriveEnumerate = nullptr;
 	SAFEARRAY* psafolders = nullptr;
 	SAFEARRAY* psaFiles = nullptr;
-	BSTR bstrPath = nullptr;
+	BSTR bstrPath = nullptr; // Owned by the folder
 	BSTR bstrFolderName = nullptr;
 	BSTR bstrFileName = nullptr;
-	LPITEMIDLIST pidl = nullptr;
 	BigDriveEnumIDList* pResult = nullptr;
 	LONG lCount = 0;
+	BigDriveEnumerationWriter writer(BigDriveListingCache::GetInstance().GetMaxListingSize());
+	BOOL fCacheable = TRUE;
+	const BYTE* pListing = nullptr;
+	ULONG cbListing = 0;
 
 	m_traceLogger.LogEnter(__FUNCTION__);
 
@@ -225,13 +231,38 @@ HRESULT __stdcall BigDriveShellFolder::EnumObjects(HWND hwnd, DWORD grfFlags, IE
 
 	*ppenumIDList = nullptr;
 
-	hr = BigDriveConfigurationClient::GetDriveConfiguration(m_driveGuid, driveConfiguration);
+	// The view can take items as they arrive; enumerate on a worker so the provider call doesn't block it
+	if (grfFlags & SHCONTF_ENABLE_ASYNC)
+	{
+		hr = EnumObjectsAsync(grfFlags, ppenumIDList);
+		if (FAILED(hr))
+		{
+			WriteErrorFormatted(L"EnumObjects: Failed to start asynchronous enumeration, HRESULT: 0x%08X", hr);
+		}
+
+		goto End;
+	}
+
+	hr = GetFolderState(&driveConfiguration, &bstrPath);
 	if (FAILED(hr))
 	{
-		WriteErrorFormatted(L"EnumObjects: Failed to get drive configuration. HRESULT: 0x%08X", hr);
+		WriteErrorFormatted(L"EnumObjects: Failed to get folder state. HRESULT: 0x%08X", hr);
 		goto End;
 	}
 
+	// Another window, the navigation pane or going back may have listed this folder recently
+	hr = EnumObjectsCached(bstrPath, grfFlags, &pResult);
+	if (FAILED(hr))
+	{
+		WriteErrorFormatted(L"EnumObjects: Cached listing failed, HRESULT: 0x%08X", hr);
+		goto End;
+	}
+
+	if (hr == S_OK)
+	{
+		goto Done;
+	}
+
 	pInterfaceProvider = new BigDriveInterfaceProvider(driveConfiguration);
 	if (pInterfaceProvider == nullptr)
 	{
@@ -240,37 +271,47 @@ HRESULT __stdcall BigDriveShellFolder::EnumObjects(HWND hwnd, DWORD grfFlags, IE
 		goto End;
 	}
 
-	hr = pInterfaceProvider->GetIBigDriveEnumerate(&pBigDriveEnumerate);
-	switch (hr)
+	// Prefer streaming the folder a page at a time, so large folders show their first items quickly
+	hr = EnumObjectsPaged(pInterfaceProvider, bstrPath, grfFlags, ppenumIDList);
+	if (FAILED(hr))
 	{
-	case S_OK:
-		break;
-	case S_FALSE:
-		// Interface isn't Implemented By The Provider
+		WriteErrorFormatted(L"EnumObjects: IBigDriveEnumeratePaged failed, HRESULT: 0x%08X", hr);
 		goto End;
-	default:
-		WriteErrorFormatted(L"EnumObjects: Failed to obtain IBigDriveEnumerate, HRESULT: 0x%08X", hr);
-		break;
 	}
 
-	if (pBigDriveEnumerate == nullptr)
+	if (hr == S_OK)
 	{
-		hr = E_FAIL;
-		WriteErrorFormatted(L"EnumObjects: Failed to obtain IBigDriveEnumerate, HRESULT: 0x%08X", hr);
+		m_traceLogger.LogResults(__FUNCTION__, *ppenumIDList);
 		goto End;
 	}
 
-	hr = GetPathForProviders(m_pidlAbsolute, bstrPath);
+	// Then the single call enumeration, which also returns the metadata of each item
+	hr = EnumObjectsEx(pInterfaceProvider, bstrPath, grfFlags, &pResult);
 	if (FAILED(hr))
 	{
+		WriteErrorFormatted(L"EnumObjects: IBigDriveEnumerateEx failed, HRESULT: 0x%08X", hr);
 		goto End;
 	}
 
-	/// Folders and Files are enumerated separately, so we need to check the flags
+	if (hr == S_OK)
+	{
+		goto Done;
+	}
+
+	/// Folders and Files are enumerated separately, so we need to check the flags. Identical requests
+	/// from other windows share the provider call, which retries once if the provider was disconnected.
 	if (grfFlags & SHCONTF_FOLDERS)
 	{
-		hr = pBigDriveEnumerate->EnumerateFolders(m_driveGuid, bstrPath, &psafolders);
-		if (FAILED(hr) || (psafolders == nullptr))
+		BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveEnumerate::EnumerateFolders");
+		hr = pInterfaceProvider->EnumerateFolders(bstrPath, &psafolders);
+		BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveEnumerate::EnumerateFolders", hr);
+		if (FAILED(hr))
+		{
+			WriteErrorFormatted(L"EnumObjects: EnumerateFolders failed, HRESULT: 0x%08X", hr);
+			goto End;
+		}
+
+		if (psafolders == nullptr)
 		{
 			goto End;
 		}
@@ -294,29 +335,16 @@ HRESULT __stdcall BigDriveShellFolder::EnumObjects(HWND hwnd, DWORD grfFlags, IE
 		{
 			::SafeArrayGetElement(psafolders, &i, &bstrFolderName);
 
-			// Allocate the Relative PIDL to pass back to 
-			hr = AllocBigDrivePidl(BigDriveItemType_Folder, bstrFolderName, pidl);
-			if (FAILED(hr) || (pidl == nullptr))
-			{
-				goto End;
-			}
-
-			if (pidl == nullptr)
-			{
-				hr = E_FAIL;
-				goto End;
-			}
-
-			hr = pResult->Add(pidl);
+			// Encoded straight into the enumerator's snapshot as the relative PIDL to pass back
+			hr = pResult->AddItem(BigDriveItemType_Folder, bstrFolderName, ::SysStringLen(bstrFolderName), nullptr);
 			if (FAILED(hr))
 			{
 				goto End;
 			}
 
-			if (pidl)
+			if (fCacheable && FAILED(writer.AppendName(BigDriveItemType_Folder, bstrFolderName)))
 			{
-				::CoTaskMemFree(pidl);
-				pidl = nullptr;
+				fCacheable = FALSE;
 			}
 
 			if (bstrFolderName)
@@ -329,8 +357,16 @@ HRESULT __stdcall BigDriveShellFolder::EnumObjects(HWND hwnd, DWORD grfFlags, IE
 
 	if (grfFlags & SHCONTF_NONFOLDERS)
 	{
-		hr = pBigDriveEnumerate->EnumerateFiles(m_driveGuid, bstrPath, &psaFiles);
-		if (FAILED(hr) || (psaFiles == nullptr))
+		BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveEnumerate::EnumerateFiles");
+		hr = pInterfaceProvider->EnumerateFiles(bstrPath, &psaFiles);
+		BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveEnumerate::EnumerateFiles", hr);
+		if (FAILED(hr))
+		{
+			WriteErrorFormatted(L"EnumObjects: EnumerateFiles failed, HRESULT: 0x%08X", hr);
+			goto End;
+		}
+
+		if (psaFiles == nullptr)
 		{
 			goto End;
 		}
@@ -354,29 +390,16 @@ HRESULT __stdcall BigDriveShellFolder::EnumObjects(HWND hwnd, DWORD grfFlags, IE
 		{
 			::SafeArrayGetElement(psaFiles, &i, &bstrFileName);
 
-			// Allocate the Relative PIDL to pass back to 
-			hr = AllocBigDrivePidl(BigDriveItemType_File, bstrFileName, pidl);
-			if (FAILED(hr) || (pidl == nullptr))
-			{
-				goto End;
-			}
-
-			if (pidl == nullptr)
-			{
-				hr = E_FAIL;
-				goto End;
-			}
-
-			hr = pResult->Add(pidl);
+			// Encoded straight into the enumerator's snapshot as the relative PIDL to pass back
+			hr = pResult->AddItem(BigDriveItemType_File, bstrFileName, ::SysStringLen(bstrFileName), nullptr);
 			if (FAILED(hr))
 			{
 				goto End;
 			}
 
-			if (pidl)
+			if (fCacheable && FAILED(writer.AppendName(BigDriveItemType_File, bstrFileName)))
 			{
-				::CoTaskMemFree(pidl);
-				pidl = nullptr;
+				fCacheable = FALSE;
 			}
 
 			if (bstrFileName)
@@ -387,6 +410,14 @@ HRESULT __stdcall BigDriveShellFolder::EnumObjects(HWND hwnd, DWORD grfFlags, IE
 		}
 	}
 
+	// Keep the names for the next window that opens this folder
+	if (fCacheable && (GetEnumerateEntriesFlags(grfFlags) != 0) && SUCCEEDED(writer.GetBuffer(&pListing, cbListing)))
+	{
+		BigDriveListingCache::GetInstance().Store(m_driveGuid, bstrPath, GetEnumerateEntriesFlags(grfFlags), pListing, cbListing);
+	}
+
+Done:
+
 	if (pResult == nullptr)
 	{
 		*ppenumIDList = new EmptyEnumIDList();
@@ -420,18 +451,6 @@ End:
 		psaFiles = nullptr;
 	}
 
-	if (pidl)
-	{
-		::CoTaskMemFree(pidl);
-		pidl = nullptr;
-	}
-
-	if (pBigDriveEnumerate)
-	{
-		pBigDriveEnumerate->Release();
-		pBigDriveEnumerate = nullptr;
-	}
-
 	if (bstrFolderName)
 	{
 		::SysFreeString(bstrFolderName);
@@ -444,12 +463,6 @@ End:
 		bstrFileName = nullptr;
 	}
 
-	if (bstrPath)
-	{
-		::SysFreeString(bstrPath);
-		bstrPath = nullptr;
-	}
-
 	if (pInterfaceProvider)
 	{
 		delete pInterfaceProvider;
@@ -520,12 +533,23 @@ HRESULT __stdcall BigDriveShellFolder::BindToObject(PCUIDLIST_RELATIVE pidl, LPB
 
 	*ppv = nullptr;
 
-	pidlSubFolder = ::ILCombine(m_pidlAbsolute, pidl);
-
-	hr = BigDriveShellFolder::Create(m_driveGuid, this, pidlSubFolder, &pSubFolder);
-	if (FAILED(hr))
+	// Explorer binds to the same subfolder many times while navigating; reuse it while it is alive
+	if (BigDriveShellFolderCache::GetInstance().Lookup(m_driveGuid, m_pidlAbsolute, pidl, &pSubFolder) != S_OK)
 	{
-		goto End;
+		pidlSubFolder = ::ILCombine(m_pidlAbsolute, pidl);
+		if (pidlSubFolder == nullptr)
+		{
+			hr = E_OUTOFMEMORY;
+			goto End;
+		}
+
+		hr = BigDriveShellFolder::Create(m_driveGuid, this, pidlSubFolder, &pSubFolder);
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+
+		BigDriveShellFolderCache::GetInstance().Add(pSubFolder);
 	}
 
 	hr = pSubFolder->QueryInterface(riid, ppv);
@@ -554,15 +578,157 @@ End:
 }
 
 /// <summary>
-/// Binds to the storage of a specified object in the folder.
+/// Binds to the storage of a specified object in the folder. For a file this is an IStream over the file's data,
+/// read from the provider's IBigDriveFileData behind a read-ahead window; it is what IShellItem::BindToHandler
+/// with BHID_Stream returns, and what the copy engine reads when it copies a file out of the drive.
+///
+/// <para><b>Return Value:</b></para>
+/// <returns>
+///   S_OK if the stream was opened. E_INVALIDARG if the item is a folder; E_NOINTERFACE if riid is not
+///   IStream or ISequentialStream, or the provider doesn't implement IBigDriveFileData.
+/// </returns>
 /// </summary>
 HRESULT __stdcall BigDriveShellFolder::BindToStorage(PCUIDLIST_RELATIVE pidl, LPBC pbc, REFIID riid, void** ppv)
 {
-	HRESULT hr = E_NOTIMPL;
+	HRESULT hr = S_OK;
+	BigDriveItemIdView view = {};
+	DriveConfiguration driveConfiguration;
+	BigDriveInterfaceProvider* pInterfaceProvider = nullptr;
+	IBigDriveFileData* pBigDriveFileData = nullptr;
+	PIDLIST_ABSOLUTE pidlAbsolute = nullptr;
+	BSTR bstrPath = nullptr;
+	IStream* pStream = nullptr;
+	IStream* pReadAheadStream = nullptr;
 
-	m_traceLogger.LogEnter(__FUNCTION__);
+	m_traceLogger.LogEnter(__FUNCTION__, riid, pidl);
 
-	// Placeholder implementation
+	if (!ppv)
+	{
+		hr = E_POINTER;
+		goto End;
+	}
+
+	*ppv = nullptr;
+
+	if (!pidl || ILIsEmpty(pidl))
+	{
+		hr = E_INVALIDARG;
+		goto End;
+	}
+
+	if (!IsEqualIID(riid, IID_IStream) && !IsEqualIID(riid, IID_ISequentialStream))
+	{
+		hr = E_NOINTERFACE;
+		goto End;
+	}
+
+	// Only files have data
+	hr = BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(::ILFindLastID(pidl)), view);
+	if (FAILED(hr) || (view.uType != BigDriveItemType_File))
+	{
+		hr = E_INVALIDARG;
+		goto End;
+	}
+
+	pidlAbsolute = ::ILCombine(m_pidlAbsolute, pidl);
+	if (!pidlAbsolute)
+	{
+		hr = E_OUTOFMEMORY;
+		goto End;
+	}
+
+	hr = GetPathForProviders(pidlAbsolute, bstrPath);
+	if (FAILED(hr))
+	{
+		s_eventLogger.WriteErrorFormmated(L"BindToStorage: Failed to get the path of the item. HRESULT: 0x%08X", hr);
+		goto End;
+	}
+
+	// Resolved once per folder, so a copy that opens many files doesn't fetch the configuration for each
+	hr = GetFolderState(&driveConfiguration, nullptr);
+	if (FAILED(hr))
+	{
+		s_eventLogger.WriteErrorFormmated(L"BindToStorage: Failed to get the drive configuration. HRESULT: 0x%08X", hr);
+		goto End;
+	}
+
+	pInterfaceProvider = new BigDriveInterfaceProvider(driveConfiguration);
+	if (pInterfaceProvider == nullptr)
+	{
+		hr = E_OUTOFMEMORY;
+		goto End;
+	}
+
+	hr = pInterfaceProvider->GetIBigDriveFileData(&pBigDriveFileData);
+	if (hr == S_FALSE)
+	{
+		// Interface isn't Implemented By The Provider
+		hr = E_NOINTERFACE;
+		goto End;
+	}
+
+	if (FAILED(hr))
+	{
+		s_eventLogger.WriteErrorFormmated(L"BindToStorage: Failed to get IBigDriveFileData. HRESULT: 0x%08X", hr);
+		goto End;
+	}
+
+	BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileData::GetFileData");
+	hr = pBigDriveFileData->GetFileData(m_driveGuid, bstrPath, &pStream);
+	BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileData::GetFileData", hr);
+	if (FAILED(hr) || !pStream)
+	{
+		s_eventLogger.WriteErrorFormmated(L"BindToStorage: Failed to open '%s'. HRESULT: 0x%08X", bstrPath, hr);
+		hr = FAILED(hr) ? hr : E_FAIL;
+		goto End;
+	}
+
+	// The caller reads the file as it copies it; only the read-ahead window is held in memory
+	hr = BigDriveReadAheadStream::Create(pStream, BigDriveReadAheadStream::DefaultWindowSize, &pReadAheadStream);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	hr = pReadAheadStream->QueryInterface(riid, ppv);
+
+End:
+
+	if (pReadAheadStream)
+	{
+		pReadAheadStream->Release();
+		pReadAheadStream = nullptr;
+	}
+
+	if (pStream)
+	{
+		pStream->Release();
+		pStream = nullptr;
+	}
+
+	if (pBigDriveFileData)
+	{
+		pBigDriveFileData->Release();
+		pBigDriveFileData = nullptr;
+	}
+
+	if (pInterfaceProvider)
+	{
+		delete pInterfaceProvider;
+		pInterfaceProvider = nullptr;
+	}
+
+	if (bstrPath)
+	{
+		::SysFreeString(bstrPath);
+		bstrPath = nullptr;
+	}
+
+	if (pidlAbsolute)
+	{
+		::ILFree(pidlAbsolute);
+		pidlAbsolute = nullptr;
+	}
 
 	m_traceLogger.LogExit(__FUNCTION__, hr);
 
@@ -576,8 +742,8 @@ HRESULT __stdcall BigDriveShellFolder::BindToStorage(PCUIDLIST_RELATIVE pidl, LP
 /// 
 /// <para><b>Parameters:</b></para>
 /// <param name="lParam">
-///   [in] A value that specifies the comparison criteria. For most shell extensions, this is 0,
-///   but it may be a column index or sort flag for custom views.
+///   [in] The column to sort by in the low word (0 name, 1 date modified, 2 size), combined with
+///   SHCIDS_CANONICALONLY (only equality matters) or SHCIDS_ALLFIELDS (items must match in every field).
 /// </param>
 /// <param name="pidl1">
 ///   [in] The first relative PIDL to compare. This PIDL is relative to the current folder.
@@ -597,12 +763,11 @@ HRESULT __stdcall BigDriveShellFolder::BindToStorage(PCUIDLIST_RELATIVE pidl, LP
 /// 
 /// <para><b>Behavior and Notes:</b></para>
 /// <list type="bullet">
-///   <item>For most extensions, comparison is based on the display name or a unique identifier in the PIDL.</item>
-///   <item>If the PIDLs are equal (refer to the same item), return 0.</item>
-///   <item>If sorting by name, use a case-insensitive comparison of the item names stored in the PIDLs.</item>
-///   <item>For custom columns or sort orders, use lParam to select the comparison criteria.</item>
-///   <item>Do not return E_NOTIMPL; the shell requires this method for sorting and grouping.</item>
-///   <item>Only compare the child (last) SHITEMID in each PIDL, not the full chain.</item>
+///   <item>Folders sort before files; the column's value comes from the metadata carried by the item IDs, so no provider call is made.</item>
+///   <item>Names compare in collation order with runs of digits compared by value, unless the NoStrCmpLogical policy is set.
+///         Sort keys are built once per name, so the many comparisons of a sort are memcmp calls.</item>
+///   <item>Names that differ only in case compare as different items.</item>
+///   <item>Multi-level PIDLs are compared level by level; a PIDL that is a prefix of the other sorts first.</item>
 /// </list>
 /// 
 /// <para><b>Typical Usage:</b></para>
@@ -613,12 +778,14 @@ HRESULT __stdcall BigDriveShellFolder::BindToStorage(PCUIDLIST_RELATIVE pidl, LP
 /// </summary>
 HRESULT __stdcall BigDriveShellFolder::CompareIDs(LPARAM lParam, PCUIDLIST_RELATIVE pidl1, PCUIDLIST_RELATIVE pidl2)
 {
-	HRESULT hr = E_NOTIMPL;
+	HRESULT hr = S_OK;
 	int cmpResult = 0;
-	const BIGDRIVE_ITEMID* pItem1;
-	const BIGDRIVE_ITEMID* pItem2;
+	BigDriveItemIdView view1;
+	BigDriveItemIdView view2;
+	PCUIDLIST_RELATIVE pidlNext1 = nullptr;
+	PCUIDLIST_RELATIVE pidlNext2 = nullptr;
 
-	m_traceLogger.LogEnter(__FUNCTION__, pidl1, pidl2);
+	BIGDRIVE_TRACE_ENTER(m_traceLogger, __FUNCTION__, pidl1, pidl2);
 
 	if (!pidl1 || !pidl2)
 	{
@@ -627,41 +794,43 @@ HRESULT __stdcall BigDriveShellFolder::CompareIDs(LPARAM lParam, PCUIDLIST_RELAT
 		goto End;
 	}
 
-	if (!::ILIsEqual(pidl1, pidl2))
+	while (true)
 	{
-		// If the PIDLs are equal, return 0
-		hr = S_OK;
-		goto End;
-	}
+		if (FAILED(BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pidl1), view1)) ||
+			FAILED(BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pidl2), view2)))
+		{
+			// Can only compare valid BigDrive item IDs
+			s_eventLogger.WriteErrorFormmated(L"CompareIDs: Invalid BigDrive item ID");
+			hr = E_INVALIDARG;
+			goto End;
+		}
 
-	if (!IsValidBigDriveItemId(pidl1) || !IsValidBigDriveItemId(pidl2))
-	{
-		// Can only compare valid BigDrive item IDs
-		hr = S_OK;
-		goto End;
-	}
+		cmpResult = CompareItemIds(lParam, view1, view2);
+		if (cmpResult != 0)
+		{
+			break;
+		}
 
-	// Cast to BIGDRIVE_ITEMID
-	pItem1 = reinterpret_cast<const BIGDRIVE_ITEMID*>(pidl1);
-	pItem2 = reinterpret_cast<const BIGDRIVE_ITEMID*>(pidl2);
+		// Same item at this level, the next one decides
+		pidlNext1 = ::ILNext(pidl1);
+		pidlNext2 = ::ILNext(pidl2);
 
-	if (!pItem1 || !pItem2 || !pItem1->szName || !pItem2->szName)
-	{
-		s_eventLogger.WriteErrorFormmated(L"Invalid PIDL or item name in CompareIDs");
+		if (::ILIsEmpty(pidlNext1) || ::ILIsEmpty(pidlNext2))
+		{
+			cmpResult = (::ILIsEmpty(pidlNext1) ? 0 : 1) - (::ILIsEmpty(pidlNext2) ? 0 : 1);
+			break;
+		}
 
-		// Treat as equal if invalid
-		return 0;
+		pidl1 = pidlNext1;
+		pidl2 = pidlNext2;
 	}
 
-	// Compare szName (case-insensitive)
-	cmpResult = ::lstrcmpiW(pItem1->szName, pItem2->szName);
-
 	// Return as required by IShellFolder: negative, zero, or positive in LOWORD
-	hr = HRESULT_FROM_WIN32((cmpResult < 0) ? -1 : (cmpResult > 0) ? 1 : 0);
+	hr = ResultFromShort((cmpResult < 0) ? -1 : (cmpResult > 0) ? 1 : 0);
 
 End:
 
-	m_traceLogger.LogExit(__FUNCTION__, hr);
+	BIGDRIVE_TRACE_EXIT(m_traceLogger, __FUNCTION__, hr);
 
 	return hr;
 }
@@ -718,6 +887,7 @@ HRESULT __stdcall BigDriveShellFolder::CreateViewObject(HWND hwndOwner, REFIID r
 {
 	HRESULT hr = E_NOINTERFACE;
 	BigDriveDropTarget* pDropTarget = nullptr;
+	BigDriveTransferSource* pTransferSource = nullptr;
 
 	if (IsEqualIID(riid, SDefined_ITopViewAwareItem) ||
 		IsEqualIID(riid, SDefined_ILibraryDescription))
@@ -755,7 +925,7 @@ HRESULT __stdcall BigDriveShellFolder::CreateViewObject(HWND hwndOwner, REFIID r
 	}
 	else if (IsEqualIID(riid, IID_IDropTarget))
 	{
-		BigDriveDropTarget* pDropTarget = new BigDriveDropTarget(this);
+		BigDriveDropTarget* pDropTarget = new BigDriveDropTarget(this, hwndOwner);
 		if (!pDropTarget)
 		{
 			hr = E_OUTOFMEMORY;
@@ -773,8 +943,7 @@ HRESULT __stdcall BigDriveShellFolder::CreateViewObject(HWND hwndOwner, REFIID r
 	}
 	else if (IsEqualIID(riid, IID_ITransferSource))
 	{
-		/*
-		BigDriveTransferSource* pTransferSource = new BigDriveTransferSource(this);
+		pTransferSource = new BigDriveTransferSource(this);
 		if (!pTransferSource)
 		{
 			hr = E_OUTOFMEMORY;
@@ -789,7 +958,6 @@ HRESULT __stdcall BigDriveShellFolder::CreateViewObject(HWND hwndOwner, REFIID r
 		}
 
 		goto End;
-		*/
 	}
 
 End:
@@ -800,6 +968,12 @@ End:
 		pDropTarget = nullptr;
 	}
 
+	if (pTransferSource != nullptr)
+	{
+		pTransferSource->Release();
+		pTransferSource = nullptr;
+	}
+
 	m_traceLogger.LogExit(__FUNCTION__, hr);
 
 	return hr;
@@ -843,6 +1017,7 @@ End:
 /// <list type="bullet">
 ///   <item><paramref name="rgfInOut"/> is set to a bitmask of SFGAO_* flags describing the items' attributes.</item>
 ///   <item>Common flags: SFGAO_FOLDER, SFGAO_FILESYSTEM, SFGAO_HASSUBFOLDER, SFGAO_FILESYSANCESTOR, SFGAO_STORAGE.</item>
+///   <item>SFGAO_HASSUBFOLDER is only worked out when the caller asks for it, since it may cost a provider call.</item>
 /// </list>
 ///
 /// <para><b>Notes:</b></para>
@@ -859,7 +1034,7 @@ HRESULT __stdcall BigDriveShellFolder::GetAttributesOf(UINT cidl, PCUITEMID_CHIL
 	// Start with all bits set for intersection
 	SFGAOF resultFlags = ~0ULL;
 
-	m_traceLogger.LogEnter(__FUNCTION__, cidl, apidl);
+	BIGDRIVE_TRACE_ENTER(m_traceLogger, __FUNCTION__, cidl, apidl);
 
 	if (cidl == 0 || !apidl || !rgfInOut)
 	{
@@ -871,6 +1046,8 @@ HRESULT __stdcall BigDriveShellFolder::GetAttributesOf(UINT cidl, PCUITEMID_CHIL
 	{
 		const BIGDRIVE_ITEMID* pItem = reinterpret_cast<const BIGDRIVE_ITEMID*>(apidl[i]);
 		SFGAOF itemFlags = 0;
+		BigDriveItemIdView view;
+		BigDriveItemMetadata metadata;
 
 		if (!pItem)
 		{
@@ -881,7 +1058,13 @@ HRESULT __stdcall BigDriveShellFolder::GetAttributesOf(UINT cidl, PCUITEMID_CHIL
 		switch (static_cast<BigDriveItemType>(pItem->uType))
 		{
 		case BigDriveItemType_Folder:
-			itemFlags = SFGAO_FOLDER | SFGAO_HASSUBFOLDER | SFGAO_FILESYSANCESTOR | SFGAO_BROWSABLE;
+			itemFlags = SFGAO_FOLDER | SFGAO_FILESYSANCESTOR | SFGAO_BROWSABLE;
+
+			// Only find out when asked: the navigation pane asks, a plain folder view doesn't
+			if ((*rgfInOut & SFGAO_HASSUBFOLDER) && (HasSubFolders(apidl[i]) != S_FALSE))
+			{
+				itemFlags |= SFGAO_HASSUBFOLDER;
+			}
 			break;
 		case BigDriveItemType_File:
 			itemFlags = SFGAO_FILESYSTEM | SFGAO_STREAM;
@@ -891,6 +1074,34 @@ HRESULT __stdcall BigDriveShellFolder::GetAttributesOf(UINT cidl, PCUITEMID_CHIL
 			break;
 		}
 
+		// Read-only and hidden come from the attributes the provider returned, when it returned them
+		if (SUCCEEDED(BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pItem), view)))
+		{
+			metadata = view.metadata;
+		}
+		else
+		{
+			metadata.dwFields = BigDriveItemField_None;
+		}
+
+		if (!(metadata.dwFields & BigDriveItemField_Attributes) && (*rgfInOut & (SFGAO_READONLY | SFGAO_HIDDEN)))
+		{
+			GetCachedItemMetadata(apidl[i], metadata);
+		}
+
+		if (metadata.dwFields & BigDriveItemField_Attributes)
+		{
+			if (metadata.dwAttributes & FILE_ATTRIBUTE_READONLY)
+			{
+				itemFlags |= SFGAO_READONLY;
+			}
+
+			if (metadata.dwAttributes & FILE_ATTRIBUTE_HIDDEN)
+			{
+				itemFlags |= SFGAO_HIDDEN;
+			}
+		}
+
 		resultFlags &= itemFlags;
 	}
 
@@ -898,7 +1109,7 @@ HRESULT __stdcall BigDriveShellFolder::GetAttributesOf(UINT cidl, PCUITEMID_CHIL
 
 End:
 
-	m_traceLogger.LogExit(__FUNCTION__, hr);
+	BIGDRIVE_TRACE_EXIT(m_traceLogger, __FUNCTION__, hr);
 	return hr;
 }
 
@@ -1078,7 +1289,7 @@ HRESULT __stdcall BigDriveShellFolder::GetDisplayNameOf(PCUITEMID_CHILD pidl, SH
 	HRESULT hr = E_NOTIMPL;
 	PIDLIST_ABSOLUTE pidlAbsolute = nullptr;
 
-	m_traceLogger.LogEnter(__FUNCTION__);
+	BIGDRIVE_TRACE_ENTER(m_traceLogger, __FUNCTION__);
 
 	if (!pidl || !pName)
 	{
@@ -1125,7 +1336,7 @@ End:
 		pidlAbsolute = nullptr;
 	}
 
-	m_traceLogger.LogExit(__FUNCTION__, hr);
+	BIGDRIVE_TRACE_EXIT(m_traceLogger, __FUNCTION__, hr);
 
 	return hr;
 }
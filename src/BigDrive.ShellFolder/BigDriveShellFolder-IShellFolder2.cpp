@@ -189,7 +189,7 @@ HRESULT __stdcall BigDriveShellFolder::GetDetailsOf(PCUITEMID_CHILD pidl, UINT i
 	HRESULT hr = S_OK;
 	VARIANT vt;
 
-	m_traceLogger.LogEnter(__FUNCTION__, pidl, iColumn);
+	BIGDRIVE_TRACE_ENTER(m_traceLogger, __FUNCTION__, pidl, iColumn);
 
 	::VariantInit(&vt);
 
@@ -285,7 +285,7 @@ End:
 
 	::VariantClear(&vt);
 
-	m_traceLogger.LogExit(__FUNCTION__, hr);
+	BIGDRIVE_TRACE_EXIT(m_traceLogger, __FUNCTION__, hr);
 	return hr;
 }
 
@@ -326,7 +326,7 @@ HRESULT __stdcall BigDriveShellFolder::GetDetailsEx(PCUITEMID_CHILD pidl, const
 {
 	HRESULT hr = E_NOTIMPL;
 	
-	m_traceLogger.LogEnter(__FUNCTION__, pidl, pscid);
+	BIGDRIVE_TRACE_ENTER(m_traceLogger, __FUNCTION__, pidl, pscid);
 
 	if (!pv)
 	{
@@ -361,7 +361,7 @@ HRESULT __stdcall BigDriveShellFolder::GetDetailsEx(PCUITEMID_CHILD pidl, const
 
 End:
 
-	m_traceLogger.LogExit(__FUNCTION__, hr);
+	BIGDRIVE_TRACE_EXIT(m_traceLogger, __FUNCTION__, hr);
 
 	return hr;
 }
@@ -378,7 +378,7 @@ HRESULT __stdcall BigDriveShellFolder::MapColumnToSCID(UINT iColumn, SHCOLUMNID*
 {
 	HRESULT hr = E_NOTIMPL;
 
-	m_traceLogger.LogEnter(__FUNCTION__, iColumn);
+	BIGDRIVE_TRACE_ENTER(m_traceLogger, __FUNCTION__, iColumn);
 
 	if (!pscid)
 	{
@@ -413,6 +413,6 @@ HRESULT __stdcall BigDriveShellFolder::MapColumnToSCID(UINT iColumn, SHCOLUMNID*
 	hr = E_NOTIMPL;
 
 End:
-	m_traceLogger.LogExit(__FUNCTION__, hr);
+	BIGDRIVE_TRACE_EXIT(m_traceLogger, __FUNCTION__, hr);
 	return hr;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "BigDriveShellFolder.h"
 
 // Local
+#include "BigDriveShellFolderCache.h"
 #include "LaunchDebugger.h"
 #include "Logging\BigDriveShellFolderTraceLogger.h"
 
@@ -89,7 +90,43 @@ ULONG __stdcall BigDriveShellFolder::Release()
     LONG ref = InterlockedDecrement(&m_refCount);
     if (ref == 0)
     {
-        delete this;
+        FinalRelease();
     }
     return ref;
+}
+
+/// <summary>
+/// Destroys the folder once its reference count has dropped to zero.
+/// </summary>
+void BigDriveShellFolder::FinalRelease()
+{
+    // Take the folder out of the cache before it goes, so no bind can find it
+    if (m_fInCache)
+    {
+        BigDriveShellFolderCache::GetInstance().Remove(this);
+    }
+
+    delete this;
+}
+
+/// <summary>
+/// Increments the reference count unless it has already dropped to zero.
+/// </summary>
+BOOL BigDriveShellFolder::TryAddRef()
+{
+    LONG ref = m_refCount;
+    LONG previous = 0;
+
+    while (ref > 0)
+    {
+        previous = InterlockedCompareExchange(&m_refCount, ref + 1, ref);
+        if (previous == ref)
+        {
+            return TRUE;
+        }
+
+        ref = previous;
+    }
+
+    return FALSE;
 }
\ No newline at end of file
@@ -12,6 +12,14 @@
 #include "BigDriveShellFolderStatic.h"
 #include "..\BigDrive.Client\BigDriveInterfaceProvider.h"
 #include "..\BigDrive.Client\BigDriveConfigurationClient.h"
+#include "..\BigDrive.Client\BigDriveEnumerationReader.h"
+#include "..\BigDrive.Client\BigDriveEnumerationWriter.h"
+#include "..\BigDrive.Client\BigDriveListingCache.h"
+#include "..\BigDrive.Client\BigDriveMetadataCoalescer.h"
+#include "..\BigDrive.Client\BigDriveSortKeyCache.h"
+#include "BigDriveEnumIDList.h"
+#include "BigDriveAsyncEnumIDList.h"
+#include "BigDrivePagedEnumIDList.h"
 
 #include <oleauto.h> 
 #include <shlguid.h>
@@ -32,6 +40,15 @@
 BigDriveShellFolderStatic BigDriveShellFolder::s_staticData;
 BigDriveShellFolderEventLogger BigDriveShellFolder::s_eventLogger(L"BigDrive.ShellFolder");
 
+/// <summary>
+/// Passed to <see cref="BigDriveShellFolder::InitializeStateOnce"/>: the folder to resolve and the result.
+/// </summary>
+struct BigDriveShellFolderState
+{
+    BigDriveShellFolder* pFolder;
+    HRESULT hr;
+};
+
 /// <inheritdoc />
 HRESULT BigDriveShellFolder::GetProviderCLSID(CLSID& clsidProvider) const
 {
@@ -244,6 +261,12 @@ HRESULT BigDriveShellFolder::GetPathForLogging(CLSID driveGuid, LPCITEMIDLIST pi
 
 /// <inheritdoc />
 HRESULT BigDriveShellFolder::AllocBigDrivePidl(BigDriveItemType nType, BSTR bstrPath, LPITEMIDLIST& ppidl)
+{
+    return AllocBigDrivePidl(nType, bstrPath, nullptr, ppidl);
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::AllocBigDrivePidl(BigDriveItemType nType, BSTR bstrPath, const BigDriveItemMetadata* pMetadata, LPITEMIDLIST& ppidl)
 {
     if (!bstrPath)
     {
@@ -301,12 +324,18 @@ HRESULT BigDriveShellFolder::AllocBigDrivePidl(BigDriveItemType nType, BSTR bstr
         ++idx;
     }
 
-    // Calculate total size for all SHITEMIDs
+    // Calculate total size for all SHITEMIDs; only the last item's block has metadata fields
     SIZE_T totalSize = 0;
     for (int i = 0; i < cComponents; ++i)
     {
-        SIZE_T nameLen = (componentLens[i] + 1) * sizeof(wchar_t);
-        SIZE_T cb = sizeof(USHORT) + sizeof(UINT) + nameLen;
+        USHORT cb = 0;
+        if (FAILED(BigDriveItemId::GetEncodedSize(componentLens[i], cb)))
+        {
+            ::CoTaskMemFree(componentPtrs);
+            ::CoTaskMemFree(componentLens);
+            return E_INVALIDARG;
+        }
+
         totalSize += cb;
     }
     totalSize += sizeof(USHORT); // zero terminator
@@ -321,21 +350,15 @@ HRESULT BigDriveShellFolder::AllocBigDrivePidl(BigDriveItemType nType, BSTR bstr
 
     // Fill each SHITEMID
     BYTE* dest = pidlMem;
+    BYTE* end = pidlMem + totalSize - sizeof(USHORT);
     for (int i = 0; i < cComponents; ++i)
     {
-        SIZE_T nameLen = (componentLens[i] + 1) * sizeof(wchar_t);
-        SIZE_T cb = sizeof(USHORT) + sizeof(UINT) + nameLen;
-        USHORT* pcb = (USHORT*)dest;
-        *pcb = (USHORT)cb;
-        UINT* puType = (UINT*)(dest + sizeof(USHORT));
-        *puType = (i == cComponents - 1) ? (UINT)nType : (UINT)BigDriveItemType_Folder;
-        wchar_t* pszName = (wchar_t*)(dest + sizeof(USHORT) + sizeof(UINT));
-        for (int j = 0; j < componentLens[i]; ++j)
-        {
-            pszName[j] = componentPtrs[i][j];
-        }
-
-        pszName[componentLens[i]] = L'\0';
+        bool fLast = (i == cComponents - 1);
+        USHORT cb = 0;
+        BigDriveItemId::Encode(dest, end - dest,
+            fLast ? (UINT)nType : (UINT)BigDriveItemType_Folder,
+            componentPtrs[i], componentLens[i],
+            fLast ? pMetadata : nullptr, cb);
         dest += cb;
     }
 
@@ -482,40 +505,9 @@ bool BigDriveShellFolder::IsValidBigDriveItemId(PCUIDLIST_RELATIVE pidl)
         return false;
     }
 
-    // Minimum size: [USHORT cb][UINT uType][at least one WCHAR for szName + null]
-    const USHORT cb = *(const USHORT*)pidl;
-    if (cb < sizeof(USHORT) + sizeof(UINT) + sizeof(WCHAR))
-    {
-        return false;
-    }
-
-    // Check uType is a known value
-    const BYTE* p = reinterpret_cast<const BYTE*>(pidl);
-    UINT uType = *(const UINT*)(p + sizeof(USHORT));
-    if (uType != BigDriveItemType_File && uType != BigDriveItemType_Folder)
-    {
-        return false;
-    }
-
-    // szName points just after [USHORT][UINT]
-    const WCHAR* szName = reinterpret_cast<const WCHAR*>(p + sizeof(USHORT) + sizeof(UINT));
-    if (!szName || szName[0] == L'\0')
-    {
-        return false;
-    }
-
-    // Defensive: ensure null-terminated within bounds
-    size_t maxChars = (cb - sizeof(USHORT) - sizeof(UINT)) / sizeof(WCHAR);
-    size_t i = 0;
-    for (; i < maxChars; ++i)
-    {
-        if (szName[i] == L'\0')
-        {
-            return true;
-        }
-    }
-
-    return false;
+    // Checks the size, the uType, the null-terminated szName and, if present, the metadata block
+    BigDriveItemIdView view;
+    return SUCCEEDED(BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pidl), view));
 }
 
 /// <inheritdoc />
@@ -602,7 +594,6 @@ HRESULT BigDriveShellFolder::GetShellDetailsProperty(PCUITEMID_CHILD pidl, const
     STRRET strret = { 0 };
     DriveConfiguration driveConfiguration;
     BigDriveInterfaceProvider* pInterfaceProvider = nullptr;
-    IBigDriveFileInfo* pBigDriveFileInfo = nullptr;
     BSTR bstrPath = nullptr;
     PIDLIST_ABSOLUTE pidlAbsolute = nullptr;
     ULONGLONG ullFileSize = 0;
@@ -650,7 +641,12 @@ HRESULT BigDriveShellFolder::GetShellDetailsProperty(PCUITEMID_CHILD pidl, const
             hr = S_OK;
             goto End;
         }
-        hr = BigDriveConfigurationClient::GetDriveConfiguration(m_driveGuid, driveConfiguration);
+        if (GetItemMetadataProperty(pidl, BigDriveItemField_Size, pv) == S_OK)
+        {
+            hr = S_OK;
+            goto End;
+        }
+        hr = GetFolderState(&driveConfiguration, nullptr);
         if (FAILED(hr))
         {
             goto End;
@@ -661,18 +657,15 @@ HRESULT BigDriveShellFolder::GetShellDetailsProperty(PCUITEMID_CHILD pidl, const
             hr = E_OUTOFMEMORY;
             goto End;
         }
-        hr = pInterfaceProvider->GetIBigDriveFileInfo(&pBigDriveFileInfo);
-        if (FAILED(hr) || !pBigDriveFileInfo)
-        {
-            goto End;
-        }
         pidlAbsolute = ::ILCombine(m_pidlAbsolute, pidl);
         hr = GetPathForProviders(pidlAbsolute, bstrPath);
         if (FAILED(hr))
         {
             goto End;
         }
-        hr = pBigDriveFileInfo->GetFileSize(m_driveGuid, bstrPath, &ullFileSize);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveFileInfo::GetFileSize");
+        hr = pInterfaceProvider->GetFileSize(bstrPath, &ullFileSize);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveFileInfo::GetFileSize", hr);
         if (FAILED(hr))
         {
             goto End;
@@ -683,7 +676,12 @@ HRESULT BigDriveShellFolder::GetShellDetailsProperty(PCUITEMID_CHILD pidl, const
     }
 
     case 3: // Date Modified
-        hr = BigDriveConfigurationClient::GetDriveConfiguration(m_driveGuid, driveConfiguration);
+        if (GetItemMetadataProperty(pidl, BigDriveItemField_LastWriteTime, pv) == S_OK)
+        {
+            hr = S_OK;
+            goto End;
+        }
+        hr = GetFolderState(&driveConfiguration, nullptr);
         if (FAILED(hr))
         {
             goto End;
@@ -694,18 +692,15 @@ HRESULT BigDriveShellFolder::GetShellDetailsProperty(PCUITEMID_CHILD pidl, const
             hr = E_OUTOFMEMORY;
             goto End;
         }
-        hr = pInterfaceProvider->GetIBigDriveFileInfo(&pBigDriveFileInfo);
-        if (FAILED(hr) || !pBigDriveFileInfo)
-        {
-            goto End;
-        }
         pidlAbsolute = ::ILCombine(m_pidlAbsolute, pidl);
         hr = GetPathForProviders(pidlAbsolute, bstrPath);
         if (FAILED(hr))
         {
             goto End;
         }
-        hr = pBigDriveFileInfo->LastModifiedTime(m_driveGuid, bstrPath, &dtLastModifiedTime);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveFileInfo::LastModifiedTime");
+        hr = pInterfaceProvider->LastModifiedTime(bstrPath, &dtLastModifiedTime);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveFileInfo::LastModifiedTime", hr);
         if (FAILED(hr))
         {
             goto End;
@@ -784,12 +779,6 @@ End:
         pInterfaceProvider = nullptr;
     }
 
-    if (pBigDriveFileInfo)
-    {
-        pBigDriveFileInfo->Release();
-        pBigDriveFileInfo = nullptr;
-    }
-
     return hr;
 
 }
@@ -800,7 +789,6 @@ HRESULT BigDriveShellFolder::GetStorageProperty(PCUITEMID_CHILD pidl, const SHCO
     HRESULT hr = E_NOTIMPL;
     DriveConfiguration driveConfiguration;
     BigDriveInterfaceProvider* pInterfaceProvider = nullptr;
-    IBigDriveFileInfo* pBigDriveFileInfo = nullptr;
     BSTR bstrPath = nullptr;
     DATE dtLastModifiedTime;
     PIDLIST_ABSOLUTE pidlAbsolute = nullptr;
@@ -813,38 +801,33 @@ HRESULT BigDriveShellFolder::GetStorageProperty(PCUITEMID_CHILD pidl, const SHCO
     case PID_STG_WRITETIME:
     case PID_STG_SIZE:
 
-        hr = BigDriveConfigurationClient::GetDriveConfiguration(m_driveGuid, driveConfiguration);
-        if (FAILED(hr))
+        // Answer from the item ID when the enumerator supplied the value
+        pItem = reinterpret_cast<const BIGDRIVE_ITEMID*>(pidl);
+        if ((pscid->pid == PID_STG_SIZE) && pItem && (pItem->uType == BigDriveItemType_Folder))
         {
-            WriteErrorFormatted(L"GetDetailsEx: Failed to get drive configuration. HRESULT: 0x%08X", hr);
+            pv->vt = VT_EMPTY;
+            hr = S_OK;
             goto End;
         }
 
-        pInterfaceProvider = new BigDriveInterfaceProvider(driveConfiguration);
-        if (pInterfaceProvider == nullptr)
+        if (GetItemMetadataProperty(pidl, (pscid->pid == PID_STG_SIZE) ? BigDriveItemField_Size : BigDriveItemField_LastWriteTime, pv) == S_OK)
         {
-            WriteError(L"GetDetailsEx: Failed to create BigDriveInterfaceProvider");
-            hr = E_OUTOFMEMORY;
+            hr = S_OK;
             goto End;
         }
 
-        hr = pInterfaceProvider->GetIBigDriveFileInfo(&pBigDriveFileInfo);
-        switch (hr)
+        hr = GetFolderState(&driveConfiguration, nullptr);
+        if (FAILED(hr))
         {
-        case S_OK:
-            break;
-        case S_FALSE:
-            // Interface isn't Implemented By The Provider
+            WriteErrorFormatted(L"GetDetailsEx: Failed to get drive configuration. HRESULT: 0x%08X", hr);
             goto End;
-        default:
-            WriteErrorFormatted(L"GetDetailsEx: Failed to obtain IBigDriveFileInfo, HRESULT: 0x%08X", hr);
-            break;
         }
 
-        if (pBigDriveFileInfo == nullptr)
+        pInterfaceProvider = new BigDriveInterfaceProvider(driveConfiguration);
+        if (pInterfaceProvider == nullptr)
         {
-            hr = E_FAIL;
-            WriteErrorFormatted(L"GetDetailsEx: Failed to obtain IBigDriveFileInfo, HRESULT: 0x%08X", hr);
+            WriteError(L"GetDetailsEx: Failed to create BigDriveInterfaceProvider");
+            hr = E_OUTOFMEMORY;
             goto End;
         }
 
@@ -864,7 +847,9 @@ HRESULT BigDriveShellFolder::GetStorageProperty(PCUITEMID_CHILD pidl, const SHCO
     {
     case  PID_STG_WRITETIME:
 
-        hr = pBigDriveFileInfo->LastModifiedTime(m_driveGuid, bstrPath, &dtLastModifiedTime);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveFileInfo::LastModifiedTime");
+        hr = pInterfaceProvider->LastModifiedTime(bstrPath, &dtLastModifiedTime);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveFileInfo::LastModifiedTime", hr);
         if (FAILED(hr))
         {
             goto End;
@@ -891,7 +876,9 @@ HRESULT BigDriveShellFolder::GetStorageProperty(PCUITEMID_CHILD pidl, const SHCO
         }
 
         // Get the file size from our provider
-        hr = pBigDriveFileInfo->GetFileSize(m_driveGuid, bstrPath, &ullFileSize);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveFileInfo::GetFileSize");
+        hr = pInterfaceProvider->GetFileSize(bstrPath, &ullFileSize);
+        BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveFileInfo::GetFileSize", hr);
         if (FAILED(hr))
         {
             goto End;
@@ -999,11 +986,1242 @@ End:
         pInterfaceProvider = nullptr;
     }
 
-    if (pBigDriveFileInfo)
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::GetItemMetadataProperty(PCUITEMID_CHILD pidl, BigDriveItemField field, VARIANT* pv)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemMetadata metadata;
+    DATE date = 0;
+
+    hr = BigDriveItemId::GetMetadata(reinterpret_cast<const BYTE*>(pidl), metadata);
+    if ((hr != S_OK) || ((metadata.dwFields & field) == 0))
+    {
+        // Item IDs from IBigDriveEnumerate or ParseDisplayName carry no metadata
+        hr = GetCachedItemMetadata(pidl, metadata);
+        if ((hr != S_OK) || ((metadata.dwFields & field) == 0))
+        {
+            hr = FetchItemMetadata(pidl, metadata);
+            if ((hr != S_OK) || ((metadata.dwFields & field) == 0))
+            {
+                return S_FALSE;
+            }
+        }
+    }
+
+    switch (field)
+    {
+    case BigDriveItemField_Size:
+        pv->vt = VT_UI8;
+        pv->ullVal = metadata.ullSize;
+        break;
+
+    case BigDriveItemField_LastWriteTime:
+        if (FAILED(BigDriveItemId::FileTimeToDate(metadata.ftLastWrite, date)))
+        {
+            return S_FALSE;
+        }
+
+        pv->vt = VT_DATE;
+        pv->date = date;
+        break;
+
+    default:
+        return S_FALSE;
+    }
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::GetCachedItemMetadata(PCUITEMID_CHILD pidl, BigDriveItemMetadata& metadata)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemIdView view;
+    BigDriveEnumerationEntry entry;
+    BSTR bstrFolderPath = nullptr; // Owned by the folder
+
+    ::ZeroMemory(&metadata, sizeof(BigDriveItemMetadata));
+
+    hr = BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pidl), view);
+    if (FAILED(hr))
+    {
+        hr = S_FALSE;
+        goto End;
+    }
+
+    hr = GetFolderState(nullptr, &bstrFolderPath);
+    if (FAILED(hr))
     {
-        pBigDriveFileInfo->Release();
-        pBigDriveFileInfo = nullptr;
+        hr = S_FALSE;
+        goto End;
+    }
+
+    hr = BigDriveListingCache::GetInstance().LookupEntry(m_driveGuid, bstrFolderPath, view.szName, entry);
+    if (hr != S_OK)
+    {
+        hr = S_FALSE;
+        goto End;
     }
 
+    // The entry field bits have the same values as BigDriveItemField
+    metadata.dwFields = entry.dwFields & (BigDriveItemField_Size | BigDriveItemField_LastWriteTime | BigDriveItemField_Attributes |
+        BigDriveItemField_HasChildren | BigDriveItemField_NoChildren);
+    metadata.dwAttributes = entry.dwAttributes;
+    metadata.ullSize = entry.ullSize;
+    metadata.ftLastWrite = entry.ftLastWrite;
+
+End:
+
     return hr;
-}
\ No newline at end of file
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::FetchItemMetadata(PCUITEMID_CHILD pidl, BigDriveItemMetadata& metadata)
+{
+    const DWORD dwFileInfoFields = BigDriveItemField_Size | BigDriveItemField_LastWriteTime | BigDriveItemField_Attributes;
+    HRESULT hr = S_OK;
+    BigDriveItemIdView view;
+    DriveConfiguration driveConfiguration;
+    BSTR bstrFolderPath = nullptr; // Owned by the folder
+    BigDriveInterfaceProvider* pInterfaceProvider = nullptr;
+    IBigDriveFileInfoBatch* pBigDriveFileInfoBatch = nullptr;
+    BigDriveListing* pListing = nullptr;
+    BigDriveEnumerationReader listingReader;
+    BigDriveEnumerationReader recordReader;
+    BigDriveEnumerationWriter writer(BigDriveListingCache::GetInstance().GetMaxListingSize());
+    BigDriveEnumerationEntry entry;
+    BigDriveEnumerationEntry record;
+    BigDriveEnumerationEntry itemRecord;
+    SAFEARRAY* psaPaths = nullptr;
+    SAFEARRAY* psaRecords = nullptr;
+    BSTR* aPaths = nullptr;
+    SAFEARRAYBOUND bound = { 0, 0 };
+    ULONG cPaths = 0;
+    BigDriveEnumerationEntry* aRecords = nullptr;
+    ULONG cRecords = 0;
+    ULONG iNextRecord = 0;
+    BOOL fListed = FALSE;
+    const BYTE* pBuffer = nullptr;
+    ULONG cbBuffer = 0;
+    BSTR bstrPath = nullptr;
+
+    ::ZeroMemory(&metadata, sizeof(BigDriveItemMetadata));
+
+    hr = BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pidl), view);
+    if (FAILED(hr))
+    {
+        hr = S_FALSE;
+        goto End;
+    }
+
+    hr = GetFolderState(&driveConfiguration, &bstrFolderPath);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    pInterfaceProvider = new BigDriveInterfaceProvider(driveConfiguration);
+    if (pInterfaceProvider == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    if (BigDriveListingCache::GetInstance().Lookup(m_driveGuid, bstrFolderPath, 0, &pListing) != S_OK)
+    {
+        // No listing to pick the item's neighbours from; batch it with the requests other threads make instead
+        hr = CreateChildPath(bstrFolderPath, view.szName, ::wcslen(view.szName), &bstrPath);
+        if (SUCCEEDED(hr))
+        {
+            hr = FetchCoalescedItemMetadata(pInterfaceProvider, bstrPath, metadata);
+        }
+
+        goto End;
+    }
+
+    hr = pInterfaceProvider->GetIBigDriveFileInfoBatch(&pBigDriveFileInfoBatch);
+    if (hr != S_OK)
+    {
+        // S_FALSE: the provider only implements IBigDriveFileInfo
+        goto End;
+    }
+
+    psaPaths = ::SafeArrayCreateVector(VT_BSTR, 0, MaxFileInfoBatch);
+    if (psaPaths == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = ::SafeArrayAccessData(psaPaths, reinterpret_cast<void**>(&aPaths));
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // The item asked for goes first, so it is answered even if the listing is gone
+    hr = CreateChildPath(bstrFolderPath, view.szName, ::wcslen(view.szName), &aPaths[cPaths++]);
+
+    // Then the files listed after it that are still missing values; the view asks for the items it shows
+    // in listing order, so these are the ones it is about to ask for
+    if (SUCCEEDED(hr) && SUCCEEDED(pListing->Read(listingReader)))
+    {
+        while (!fListed && (listingReader.Next(entry) == S_OK))
+        {
+            fListed = (::CompareStringOrdinal(entry.pchName, entry.cchName, view.szName, -1, TRUE) == CSTR_EQUAL);
+        }
+
+        // The reader is now just past the item; if the listing doesn't have it, only the item is asked for
+        while (fListed && SUCCEEDED(hr) && (cPaths < MaxFileInfoBatch) && (listingReader.Next(entry) == S_OK))
+        {
+            if (!NeedsFileInfo(entry))
+            {
+                continue;
+            }
+
+            hr = CreateChildPath(bstrFolderPath, entry.pchName, entry.cchName, &aPaths[cPaths++]);
+        }
+    }
+
+    ::SafeArrayUnaccessData(psaPaths);
+    aPaths = nullptr;
+
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    bound.cElements = cPaths;
+    hr = ::SafeArrayRedim(psaPaths, &bound);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileInfoBatch::GetFileInfoBatch");
+    hr = pBigDriveFileInfoBatch->GetFileInfoBatch(m_driveGuid, psaPaths, dwFileInfoFields, &psaRecords);
+    BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileInfoBatch::GetFileInfoBatch", hr);
+    if (FAILED(hr) && (pInterfaceProvider->Reconnect(hr) == S_OK))
+    {
+        // The provider process went away, retry once on a new connection
+        pBigDriveFileInfoBatch->Release();
+        pBigDriveFileInfoBatch = nullptr;
+
+        hr = pInterfaceProvider->GetIBigDriveFileInfoBatch(&pBigDriveFileInfoBatch);
+        if (hr != S_OK)
+        {
+            goto End;
+        }
+
+        BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileInfoBatch::GetFileInfoBatch");
+        hr = pBigDriveFileInfoBatch->GetFileInfoBatch(m_driveGuid, psaPaths, dwFileInfoFields, &psaRecords);
+        BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileInfoBatch::GetFileInfoBatch", hr);
+    }
+
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    if (psaRecords == nullptr)
+    {
+        hr = E_FAIL;
+        goto End;
+    }
+
+    hr = recordReader.Initialize(psaRecords);
+    if (FAILED(hr))
+    {
+        WriteErrorFormatted(L"FetchItemMetadata: Malformed IBigDriveFileInfoBatch records, HRESULT: 0x%08X", hr);
+        goto End;
+    }
+
+    aRecords = new BigDriveEnumerationEntry[cPaths];
+    if (aRecords == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    // The names point into psaRecords, which the reader keeps locked until it is closed
+    while (cRecords < cPaths)
+    {
+        hr = recordReader.Next(aRecords[cRecords]);
+        if (hr != S_OK)
+        {
+            break;
+        }
+
+        cRecords++;
+    }
+
+    if (FAILED(hr))
+    {
+        WriteErrorFormatted(L"FetchItemMetadata: Malformed IBigDriveFileInfoBatch records, HRESULT: 0x%08X", hr);
+        goto End;
+    }
+
+    // Records are matched by the path each is named with, so a provider that leaves paths out or answers
+    // in another order doesn't put one file's values on another
+    FindFileInfoRecord(aRecords, cRecords, bstrFolderPath, view.szName, ::wcslen(view.szName), iNextRecord, itemRecord);
+
+    metadata.dwFields = itemRecord.dwFields & dwFileInfoFields;
+    metadata.dwAttributes = itemRecord.dwAttributes;
+    metadata.ullSize = itemRecord.ullSize;
+    metadata.ftLastWrite = itemRecord.ftLastWrite;
+
+    hr = (metadata.dwFields != 0) ? S_OK : S_FALSE;
+
+    if (FAILED(pListing->Read(listingReader)))
+    {
+        goto End;
+    }
+
+    // Fill the answers into a copy of the listing
+    while (listingReader.Next(entry) == S_OK)
+    {
+        if (::CompareStringOrdinal(entry.pchName, entry.cchName, view.szName, -1, TRUE) == CSTR_EQUAL)
+        {
+            record = itemRecord;
+        }
+        else if (!NeedsFileInfo(entry) ||
+            !FindFileInfoRecord(aRecords, cRecords, bstrFolderPath, entry.pchName, entry.cchName, iNextRecord, record))
+        {
+            record.dwFields = 0;
+        }
+
+        record.dwFields &= dwFileInfoFields;
+
+        if (record.dwFields & BigDriveItemField_Size)
+        {
+            entry.ullSize = record.ullSize;
+        }
+
+        if (record.dwFields & BigDriveItemField_LastWriteTime)
+        {
+            entry.ftLastWrite = record.ftLastWrite;
+        }
+
+        if (record.dwFields & BigDriveItemField_Attributes)
+        {
+            entry.dwAttributes = record.dwAttributes;
+        }
+
+        entry.dwFields |= record.dwFields;
+
+        if (FAILED(writer.Append(entry)))
+        {
+            // Too large to cache; the item's own answer still stands
+            goto End;
+        }
+    }
+
+    if (SUCCEEDED(writer.GetBuffer(&pBuffer, cbBuffer)))
+    {
+        BigDriveListingCache::GetInstance().Update(m_driveGuid, bstrFolderPath, pListing, pBuffer, cbBuffer);
+    }
+
+End:
+
+    if (aPaths)
+    {
+        ::SafeArrayUnaccessData(psaPaths);
+        aPaths = nullptr;
+    }
+
+    if (aRecords)
+    {
+        delete[] aRecords;
+        aRecords = nullptr;
+    }
+
+    // The array must be unlocked before it is destroyed
+    recordReader.Close();
+
+    if (psaRecords)
+    {
+        ::SafeArrayDestroy(psaRecords);
+        psaRecords = nullptr;
+    }
+
+    if (psaPaths)
+    {
+        ::SafeArrayDestroy(psaPaths);
+        psaPaths = nullptr;
+    }
+
+    if (bstrPath)
+    {
+        ::SysFreeString(bstrPath);
+        bstrPath = nullptr;
+    }
+
+    if (pListing)
+    {
+        pListing->Release();
+        pListing = nullptr;
+    }
+
+    if (pBigDriveFileInfoBatch)
+    {
+        pBigDriveFileInfoBatch->Release();
+        pBigDriveFileInfoBatch = nullptr;
+    }
+
+    if (pInterfaceProvider)
+    {
+        delete pInterfaceProvider;
+        pInterfaceProvider = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::FetchCoalescedItemMetadata(BigDriveInterfaceProvider* pInterfaceProvider, BSTR bstrPath, BigDriveItemMetadata& metadata)
+{
+    const DWORD dwFileInfoFields = BigDriveItemField_Size | BigDriveItemField_LastWriteTime | BigDriveItemField_Attributes;
+    HRESULT hr = S_OK;
+    IBigDriveFileInfoBatch* pBigDriveFileInfoBatch = nullptr;
+    BigDriveEnumerationEntry record;
+
+    ::ZeroMemory(&metadata, sizeof(BigDriveItemMetadata));
+
+    hr = pInterfaceProvider->GetIBigDriveFileInfoBatch(&pBigDriveFileInfoBatch);
+    if (hr != S_OK)
+    {
+        // S_FALSE: the provider only implements IBigDriveFileInfo
+        goto End;
+    }
+
+    // The coalescer counts the provider call; the requests that share it are not calls of their own
+    hr = BigDriveMetadataCoalescer::GetInstance().GetFileInfo(pBigDriveFileInfoBatch, m_driveGuid, bstrPath, dwFileInfoFields, record);
+    if (FAILED(hr) && (pInterfaceProvider->Reconnect(hr) == S_OK))
+    {
+        // The provider process went away, retry once on a new connection
+        pBigDriveFileInfoBatch->Release();
+        pBigDriveFileInfoBatch = nullptr;
+
+        hr = pInterfaceProvider->GetIBigDriveFileInfoBatch(&pBigDriveFileInfoBatch);
+        if (hr != S_OK)
+        {
+            goto End;
+        }
+
+        hr = BigDriveMetadataCoalescer::GetInstance().GetFileInfo(pBigDriveFileInfoBatch, m_driveGuid, bstrPath, dwFileInfoFields, record);
+    }
+
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    metadata.dwFields = record.dwFields & dwFileInfoFields;
+    metadata.dwAttributes = record.dwAttributes;
+    metadata.ullSize = record.ullSize;
+    metadata.ftLastWrite = record.ftLastWrite;
+
+    hr = (metadata.dwFields != 0) ? S_OK : S_FALSE;
+
+End:
+
+    if (pBigDriveFileInfoBatch)
+    {
+        pBigDriveFileInfoBatch->Release();
+        pBigDriveFileInfoBatch = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+BOOL BigDriveShellFolder::NeedsFileInfo(const BigDriveEnumerationEntry& entry)
+{
+    const DWORD dwColumnFields = BigDriveEnumerationField_Size | BigDriveEnumerationField_LastWriteTime;
+
+    return (entry.uType == BigDriveItemType_File) && ((entry.dwFields & dwColumnFields) != dwColumnFields);
+}
+
+/// <inheritdoc />
+BOOL BigDriveShellFolder::FindFileInfoRecord(const BigDriveEnumerationEntry* aRecords, ULONG cRecords, BSTR bstrFolderPath,
+    LPCWSTR pchName, size_t cchName, ULONG& iNext, BigDriveEnumerationEntry& record)
+{
+    size_t cchFolderPath = ::SysStringLen(bstrFolderPath);
+
+    // A record is named "<folder>\<name>"; the root's path is "\", which puts nothing before the separator
+    if ((cchFolderPath > 0) && (bstrFolderPath[cchFolderPath - 1] == L'\\'))
+    {
+        cchFolderPath--;
+    }
+
+    // Providers answer in the order the paths were sent, so the record after the last one found is tried first
+    for (ULONG n = 0; n < cRecords; n++)
+    {
+        const BigDriveEnumerationEntry& candidate = aRecords[(iNext + n) % cRecords];
+
+        if ((candidate.pchName != nullptr) && (candidate.cchName == cchFolderPath + 1 + cchName) &&
+            (candidate.pchName[cchFolderPath] == L'\\') &&
+            ((cchFolderPath == 0) || (::CompareStringOrdinal(candidate.pchName, static_cast<int>(cchFolderPath),
+                bstrFolderPath, static_cast<int>(cchFolderPath), TRUE) == CSTR_EQUAL)) &&
+            (::CompareStringOrdinal(candidate.pchName + cchFolderPath + 1, static_cast<int>(cchName),
+                pchName, static_cast<int>(cchName), TRUE) == CSTR_EQUAL))
+        {
+            record = candidate;
+            iNext = (iNext + n + 1) % cRecords;
+            return TRUE;
+        }
+    }
+
+    record.dwFields = 0;
+
+    return FALSE;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::CreateChildPath(BSTR bstrFolderPath, LPCWSTR pchName, size_t cchName, BSTR* pbstrPath)
+{
+    size_t cchFolderPath = ::SysStringLen(bstrFolderPath);
+    size_t cchSeparator = ((cchFolderPath > 0) && (bstrFolderPath[cchFolderPath - 1] == L'\\')) ? 0 : 1;
+    BSTR bstrPath = nullptr;
+
+    *pbstrPath = nullptr;
+
+    bstrPath = ::SysAllocStringLen(nullptr, static_cast<UINT>(cchFolderPath + cchSeparator + cchName));
+    if (bstrPath == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    ::CopyMemory(bstrPath, bstrFolderPath, cchFolderPath * sizeof(WCHAR));
+
+    if (cchSeparator)
+    {
+        bstrPath[cchFolderPath] = L'\\';
+    }
+
+    ::CopyMemory(bstrPath + cchFolderPath + cchSeparator, pchName, cchName * sizeof(WCHAR));
+
+    *pbstrPath = bstrPath;
+
+    return S_OK;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::HasSubFolders(PCUITEMID_CHILD pidl)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemIdView view;
+    BigDriveItemMetadata metadata;
+    BigDriveEnumerationEntry entry;
+    DriveConfiguration driveConfiguration;
+    BigDriveInterfaceProvider* pInterfaceProvider = nullptr;
+    IBigDriveEnumeratePaged* pBigDriveEnumeratePaged = nullptr;
+    BigDriveListing* pListing = nullptr;
+    BigDriveEnumerationReader reader;
+    PIDLIST_ABSOLUTE pidlAbsolute = nullptr;
+    BSTR bstrPath = nullptr;
+    BSTR bstrNextCursor = nullptr;
+    SAFEARRAY* psaEntries = nullptr;
+    DWORD dwFields = BigDriveItemField_None;
+
+    // The hint the provider returned when it listed this folder, carried by the item or the cached listing
+    if (SUCCEEDED(BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(pidl), view)))
+    {
+        dwFields = view.metadata.dwFields;
+    }
+
+    if (((dwFields & (BigDriveItemField_HasChildren | BigDriveItemField_NoChildren)) == 0) &&
+        (GetCachedItemMetadata(pidl, metadata) == S_OK))
+    {
+        dwFields = metadata.dwFields;
+    }
+
+    if (dwFields & BigDriveItemField_NoChildren)
+    {
+        hr = S_FALSE;
+        goto End;
+    }
+
+    if (dwFields & BigDriveItemField_HasChildren)
+    {
+        hr = S_OK;
+        goto End;
+    }
+
+    pidlAbsolute = ::ILCombine(m_pidlAbsolute, pidl);
+    if (pidlAbsolute == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = GetPathForProviders(pidlAbsolute, bstrPath);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // The folder itself may already be listed, for example when it was opened before
+    if (BigDriveListingCache::GetInstance().Lookup(m_driveGuid, bstrPath, BigDriveEnumerateEntries_Folders, &pListing) == S_OK)
+    {
+        hr = pListing->Read(reader);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+
+        while ((hr = reader.Next(entry)) == S_OK)
+        {
+            if (entry.uType == BigDriveItemType_Folder)
+            {
+                break;
+            }
+        }
+
+        goto End;
+    }
+
+    // Ask for one folder; finding one is enough
+    hr = GetFolderState(&driveConfiguration, nullptr);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    pInterfaceProvider = new BigDriveInterfaceProvider(driveConfiguration);
+    if (pInterfaceProvider == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = pInterfaceProvider->GetIBigDriveEnumeratePaged(&pBigDriveEnumeratePaged);
+    if (hr != S_OK)
+    {
+        // Without paging the probe would list the whole folder; keep the expand arrow and let expansion find out
+        hr = S_OK;
+        goto End;
+    }
+
+    BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveEnumeratePaged::EnumerateEntriesPage");
+    hr = pBigDriveEnumeratePaged->EnumerateEntriesPage(m_driveGuid, bstrPath, BigDriveEnumerateEntries_Folders, nullptr, 1, &bstrNextCursor, &psaEntries);
+    BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveEnumeratePaged::EnumerateEntriesPage", hr);
+    if (FAILED(hr) || (psaEntries == nullptr))
+    {
+        WriteErrorFormatted(L"HasSubFolders: EnumerateEntriesPage failed, HRESULT: 0x%08X", hr);
+        hr = S_OK;
+        goto End;
+    }
+
+    hr = reader.Initialize(psaEntries);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = (reader.GetCount() > 0) ? S_OK : S_FALSE;
+
+End:
+
+    // The array must be unlocked before it is destroyed
+    reader.Close();
+
+    if (psaEntries)
+    {
+        ::SafeArrayDestroy(psaEntries);
+        psaEntries = nullptr;
+    }
+
+    if (bstrNextCursor)
+    {
+        ::SysFreeString(bstrNextCursor);
+        bstrNextCursor = nullptr;
+    }
+
+    if (pListing)
+    {
+        pListing->Release();
+        pListing = nullptr;
+    }
+
+    if (pBigDriveEnumeratePaged)
+    {
+        pBigDriveEnumeratePaged->Release();
+        pBigDriveEnumeratePaged = nullptr;
+    }
+
+    if (pInterfaceProvider)
+    {
+        delete pInterfaceProvider;
+        pInterfaceProvider = nullptr;
+    }
+
+    if (bstrPath)
+    {
+        ::SysFreeString(bstrPath);
+        bstrPath = nullptr;
+    }
+
+    if (pidlAbsolute)
+    {
+        ::ILFree(pidlAbsolute);
+        pidlAbsolute = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::EnumObjectsEx(BigDriveInterfaceProvider* pInterfaceProvider, BSTR bstrPath, DWORD grfFlags, BigDriveEnumIDList** ppResult)
+{
+    HRESULT hr = S_OK;
+    IBigDriveEnumerateEx* pBigDriveEnumerateEx = nullptr;
+    SAFEARRAY* psaEntries = nullptr;
+    BigDriveEnumerationReader reader;
+    LONG flags = GetEnumerateEntriesFlags(grfFlags);
+    LONG lowerBound = 0;
+    LONG upperBound = 0;
+    void* pData = nullptr;
+
+    *ppResult = nullptr;
+
+    hr = pInterfaceProvider->GetIBigDriveEnumerateEx(&pBigDriveEnumerateEx);
+    if (hr != S_OK)
+    {
+        // S_FALSE: the provider only implements IBigDriveEnumerate
+        goto End;
+    }
+
+    if (flags == 0)
+    {
+        hr = S_OK;
+        goto End;
+    }
+
+    BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveEnumerateEx::EnumerateEntries");
+    hr = pBigDriveEnumerateEx->EnumerateEntries(m_driveGuid, bstrPath, flags, &psaEntries);
+    BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveEnumerateEx::EnumerateEntries", hr);
+    if (FAILED(hr) && (pInterfaceProvider->Reconnect(hr) == S_OK))
+    {
+        // The provider process went away, retry once on a new connection
+        pBigDriveEnumerateEx->Release();
+        pBigDriveEnumerateEx = nullptr;
+
+        hr = pInterfaceProvider->GetIBigDriveEnumerateEx(&pBigDriveEnumerateEx);
+        if (hr != S_OK)
+        {
+            goto End;
+        }
+
+        BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveEnumerateEx::EnumerateEntries");
+        hr = pBigDriveEnumerateEx->EnumerateEntries(m_driveGuid, bstrPath, flags, &psaEntries);
+        BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveEnumerateEx::EnumerateEntries", hr);
+    }
+
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    if (psaEntries == nullptr)
+    {
+        hr = E_FAIL;
+        goto End;
+    }
+
+    hr = reader.Initialize(psaEntries);
+    if (FAILED(hr))
+    {
+        WriteErrorFormatted(L"EnumObjectsEx: Malformed IBigDriveEnumerateEx entries, HRESULT: 0x%08X", hr);
+        goto End;
+    }
+
+    hr = CreateEnumIDList(reader, flags, ppResult);
+    if (FAILED(hr))
+    {
+        WriteErrorFormatted(L"EnumObjectsEx: Malformed IBigDriveEnumerateEx entry, HRESULT: 0x%08X", hr);
+        goto End;
+    }
+
+    // The entries are well formed; keep them for the next window that opens this folder
+    if (SUCCEEDED(::SafeArrayGetLBound(psaEntries, 1, &lowerBound)) &&
+        SUCCEEDED(::SafeArrayGetUBound(psaEntries, 1, &upperBound)) &&
+        SUCCEEDED(::SafeArrayAccessData(psaEntries, &pData)))
+    {
+        BigDriveListingCache::GetInstance().Store(m_driveGuid, bstrPath, flags, static_cast<const BYTE*>(pData), static_cast<ULONG>(upperBound - lowerBound + 1));
+        ::SafeArrayUnaccessData(psaEntries);
+    }
+
+    hr = S_OK;
+
+End:
+
+    // The array must be unlocked before it is destroyed
+    reader.Close();
+
+    if (psaEntries)
+    {
+        ::SafeArrayDestroy(psaEntries);
+        psaEntries = nullptr;
+    }
+
+    if (pBigDriveEnumerateEx)
+    {
+        pBigDriveEnumerateEx->Release();
+        pBigDriveEnumerateEx = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::EnumObjectsCached(BSTR bstrPath, DWORD grfFlags, BigDriveEnumIDList** ppResult)
+{
+    HRESULT hr = S_OK;
+    BigDriveListing* pListing = nullptr;
+    BigDriveEnumerationReader reader;
+    LONG flags = GetEnumerateEntriesFlags(grfFlags);
+
+    *ppResult = nullptr;
+
+    hr = BigDriveListingCache::GetInstance().Lookup(m_driveGuid, bstrPath, flags, &pListing);
+    if (hr != S_OK)
+    {
+        goto End;
+    }
+
+    hr = pListing->Read(reader);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = CreateEnumIDList(reader, flags, ppResult);
+
+End:
+
+    reader.Close();
+
+    if (pListing)
+    {
+        pListing->Release();
+        pListing = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::CreateEnumIDList(BigDriveEnumerationReader& reader, LONG flags, BigDriveEnumIDList** ppResult)
+{
+    HRESULT hr = S_OK;
+    BigDriveEnumerationEntry entry;
+    BigDriveItemMetadata metadata;
+    BigDriveEnumIDList* pResult = nullptr;
+    LONG typeFlag = 0;
+
+    *ppResult = nullptr;
+
+    if (reader.GetCount() == 0)
+    {
+        return S_OK;
+    }
+
+    pResult = new BigDriveEnumIDList(reader.GetCount());
+    if (pResult == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    while ((hr = reader.Next(entry)) == S_OK)
+    {
+        // A cached listing may hold more types than the view asked for
+        typeFlag = (entry.uType == BigDriveItemType_Folder) ? BigDriveEnumerateEntries_Folders : BigDriveEnumerateEntries_Files;
+        if ((flags & typeFlag) == 0)
+        {
+            continue;
+        }
+
+        GetEntryMetadata(entry, metadata);
+
+        // Encoded straight into the enumerator's snapshot; no PIDL is allocated per item
+        hr = pResult->AddItem(entry.uType, entry.pchName, entry.cchName, &metadata);
+        if (FAILED(hr))
+        {
+            goto End;
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = S_OK;
+
+    *ppResult = pResult;
+    pResult = nullptr;
+
+End:
+
+    if (pResult)
+    {
+        delete pResult;
+        pResult = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+LONG BigDriveShellFolder::GetEnumerateEntriesFlags(DWORD grfFlags)
+{
+    LONG flags = 0;
+
+    if (grfFlags & SHCONTF_FOLDERS)
+    {
+        flags |= BigDriveEnumerateEntries_Folders;
+    }
+
+    if (grfFlags & SHCONTF_NONFOLDERS)
+    {
+        flags |= BigDriveEnumerateEntries_Files;
+    }
+
+    return flags;
+}
+
+/// <inheritdoc />
+void BigDriveShellFolder::GetEntryMetadata(const BigDriveEnumerationEntry& entry, BigDriveItemMetadata& metadata)
+{
+    // The entry field bits have the same values as BigDriveItemField
+    metadata.dwFields = entry.dwFields & (BigDriveItemField_Size | BigDriveItemField_LastWriteTime | BigDriveItemField_Attributes |
+        BigDriveItemField_HasChildren | BigDriveItemField_NoChildren);
+    metadata.dwAttributes = entry.dwAttributes;
+    metadata.ullSize = entry.ullSize;
+    metadata.ftLastWrite = entry.ftLastWrite;
+    metadata.ullChangeToken = 0;
+
+    if (entry.dwFields & BigDriveEnumerationField_ETag)
+    {
+        metadata.dwFields |= BigDriveItemField_ChangeToken;
+        metadata.ullChangeToken = BigDriveEnumerationReader::HashETag(entry.pchETag, entry.cchETag);
+    }
+}
+
+/// <inheritdoc />
+int BigDriveShellFolder::CompareItemIds(LPARAM lParam, const BigDriveItemIdView& view1, const BigDriveItemIdView& view2)
+{
+    int result = 0;
+    BOOL fHas1 = FALSE;
+    BOOL fHas2 = FALSE;
+
+    // Folders before files, whatever the column; a folder and a file of the same name are different items
+    if (view1.uType != view2.uType)
+    {
+        return (view1.uType == BigDriveItemType_Folder) ? -1 : 1;
+    }
+
+    if (lParam & SHCIDS_CANONICALONLY)
+    {
+        // Only equality matters, so no collation; the order is still consistent with the full compare below
+        result = ::CompareStringOrdinal(view1.szName, static_cast<int>(view1.cchName), view2.szName, static_cast<int>(view2.cchName), TRUE) - CSTR_EQUAL;
+        if (result == 0)
+        {
+            result = ::CompareStringOrdinal(view1.szName, static_cast<int>(view1.cchName), view2.szName, static_cast<int>(view2.cchName), FALSE) - CSTR_EQUAL;
+        }
+
+        return result;
+    }
+
+    switch (lParam & SHCIDS_COLUMNMASK)
+    {
+    case 1: // Date Modified
+        fHas1 = (view1.metadata.dwFields & BigDriveItemField_LastWriteTime) != 0;
+        fHas2 = (view2.metadata.dwFields & BigDriveItemField_LastWriteTime) != 0;
+        if (fHas1 && fHas2)
+        {
+            result = ::CompareFileTime(&view1.metadata.ftLastWrite, &view2.metadata.ftLastWrite);
+        }
+        else if (fHas1 != fHas2)
+        {
+            // Items without a date sort first
+            result = fHas1 ? 1 : -1;
+        }
+        break;
+
+    case 2: // Size
+        fHas1 = (view1.metadata.dwFields & BigDriveItemField_Size) != 0;
+        fHas2 = (view2.metadata.dwFields & BigDriveItemField_Size) != 0;
+        if (fHas1 && fHas2)
+        {
+            result = (view1.metadata.ullSize < view2.metadata.ullSize) ? -1 : (view1.metadata.ullSize > view2.metadata.ullSize) ? 1 : 0;
+        }
+        else if (fHas1 != fHas2)
+        {
+            result = fHas1 ? 1 : -1;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (result != 0)
+    {
+        return result;
+    }
+
+    if (FAILED(BigDriveSortKeyCache::GetInstance().Compare(view1.szName, view2.szName, result)))
+    {
+        result = ::CompareStringOrdinal(view1.szName, static_cast<int>(view1.cchName), view2.szName, static_cast<int>(view2.cchName), TRUE) - CSTR_EQUAL;
+    }
+
+    if (result == 0)
+    {
+        // Names that collate together ("a" and "A") are still different items
+        result = ::CompareStringOrdinal(view1.szName, static_cast<int>(view1.cchName), view2.szName, static_cast<int>(view2.cchName), FALSE) - CSTR_EQUAL;
+    }
+
+    if ((result == 0) && (lParam & SHCIDS_ALLFIELDS))
+    {
+        // Same item; the shell asks with SHCIDS_ALLFIELDS to find out whether it changed
+        if (view1.metadata.ullChangeToken != view2.metadata.ullChangeToken)
+        {
+            result = (view1.metadata.ullChangeToken < view2.metadata.ullChangeToken) ? -1 : 1;
+        }
+        else if (view1.metadata.ullSize != view2.metadata.ullSize)
+        {
+            result = (view1.metadata.ullSize < view2.metadata.ullSize) ? -1 : 1;
+        }
+        else
+        {
+            result = ::CompareFileTime(&view1.metadata.ftLastWrite, &view2.metadata.ftLastWrite);
+        }
+    }
+
+    return result;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::AllocBigDrivePidl(const BigDriveEnumerationEntry& entry, LPITEMIDLIST& ppidl)
+{
+    HRESULT hr = S_OK;
+    BigDriveItemMetadata metadata;
+    BSTR bstrName = nullptr;
+
+    ppidl = nullptr;
+
+    bstrName = ::SysAllocStringLen(entry.pchName, entry.cchName);
+    if (bstrName == nullptr)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    GetEntryMetadata(entry, metadata);
+
+    hr = AllocBigDrivePidl(static_cast<BigDriveItemType>(entry.uType), bstrName, &metadata, ppidl);
+
+    ::SysFreeString(bstrName);
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::EnumObjectsPaged(BigDriveInterfaceProvider* pInterfaceProvider, BSTR bstrPath, DWORD grfFlags, IEnumIDList** ppenumIDList)
+{
+    HRESULT hr = S_OK;
+    IBigDriveEnumeratePaged* pBigDriveEnumeratePaged = nullptr;
+    BigDrivePagedEnumIDList* pResult = nullptr;
+    LONG flags = GetEnumerateEntriesFlags(grfFlags);
+
+    *ppenumIDList = nullptr;
+
+    hr = pInterfaceProvider->GetIBigDriveEnumeratePaged(&pBigDriveEnumeratePaged);
+    if (hr != S_OK)
+    {
+        // S_FALSE: the provider doesn't page
+        goto End;
+    }
+
+    pResult = new BigDrivePagedEnumIDList();
+    if (pResult == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = pResult->Initialize(pBigDriveEnumeratePaged, m_driveGuid, bstrPath, flags);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    *ppenumIDList = pResult;
+    pResult = nullptr;
+
+End:
+
+    if (pResult)
+    {
+        pResult->Release();
+        pResult = nullptr;
+    }
+
+    if (pBigDriveEnumeratePaged)
+    {
+        pBigDriveEnumeratePaged->Release();
+        pBigDriveEnumeratePaged = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::EnumObjectsAsync(DWORD grfFlags, IEnumIDList** ppenumIDList)
+{
+    HRESULT hr = S_OK;
+    BigDriveAsyncEnumIDList* pResult = nullptr;
+
+    *ppenumIDList = nullptr;
+
+    pResult = new BigDriveAsyncEnumIDList();
+    if (pResult == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = pResult->Initialize(this, grfFlags);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    *ppenumIDList = pResult;
+    pResult = nullptr;
+
+End:
+
+    if (pResult)
+    {
+        pResult->Release();
+        pResult = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolder::GetFolderState(DriveConfiguration* pDriveConfiguration, BSTR* pbstrPath)
+{
+    HRESULT hr = S_OK;
+    BigDriveShellFolderState state = { this, S_OK };
+    DriveConfiguration driveConfiguration;
+    LONG version = 0;
+
+    if (pbstrPath)
+    {
+        *pbstrPath = nullptr;
+    }
+
+    if (!::InitOnceExecuteOnce(&m_initOnceState, InitializeStateOnce, &state, nullptr))
+    {
+        return FAILED(state.hr) ? state.hr : HRESULT_FROM_WIN32(::GetLastError());
+    }
+
+    if (pDriveConfiguration == nullptr)
+    {
+        goto End;
+    }
+
+    // Read before fetching, so a change during the fetch is caught by the next call
+    version = BigDriveConfigurationClient::GetConfigurationVersion();
+
+    ::AcquireSRWLockShared(&m_configurationLock);
+
+    if (m_configurationVersion == version)
+    {
+        hr = m_driveConfiguration.CopyTo(*pDriveConfiguration);
+        ::ReleaseSRWLockShared(&m_configurationLock);
+        goto End;
+    }
+
+    ::ReleaseSRWLockShared(&m_configurationLock);
+
+    hr = BigDriveConfigurationClient::GetDriveConfiguration(m_driveGuid, driveConfiguration);
+    if (FAILED(hr))
+    {
+        WriteErrorFormatted(L"GetFolderState: Failed to refresh drive configuration. HRESULT: 0x%08X", hr);
+        goto End;
+    }
+
+    ::AcquireSRWLockExclusive(&m_configurationLock);
+
+    // Left at the old version if it can't be kept, so the next call tries again
+    if (SUCCEEDED(driveConfiguration.CopyTo(m_driveConfiguration)))
+    {
+        m_configurationVersion = version;
+    }
+
+    ::ReleaseSRWLockExclusive(&m_configurationLock);
+
+    hr = driveConfiguration.CopyTo(*pDriveConfiguration);
+
+End:
+
+    if (SUCCEEDED(hr) && pbstrPath)
+    {
+        *pbstrPath = m_bstrPath;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+BOOL CALLBACK BigDriveShellFolder::InitializeStateOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext)
+{
+    BigDriveShellFolderState* pState = static_cast<BigDriveShellFolderState*>(pParameter);
+    BigDriveShellFolder* pThis = pState->pFolder;
+    BSTR bstrPath = nullptr;
+
+    // A root folder gets its PIDL from IPersistFolder::Initialize; don't resolve before then
+    if (pThis->m_pidlAbsolute == nullptr)
+    {
+        pState->hr = E_UNEXPECTED;
+        goto End;
+    }
+
+    pThis->m_configurationVersion = BigDriveConfigurationClient::GetConfigurationVersion();
+
+    pState->hr = BigDriveConfigurationClient::GetDriveConfiguration(pThis->m_driveGuid, pThis->m_driveConfiguration);
+    if (FAILED(pState->hr))
+    {
+        pThis->WriteErrorFormatted(L"GetFolderState: Failed to get drive configuration. HRESULT: 0x%08X", pState->hr);
+        goto End;
+    }
+
+    pState->hr = GetPathForProviders(pThis->m_pidlAbsolute, bstrPath);
+    if (FAILED(pState->hr))
+    {
+        goto End;
+    }
+
+    pThis->m_bstrPath = bstrPath;
+    bstrPath = nullptr;
+
+End:
+
+    if (bstrPath)
+    {
+        ::SysFreeString(bstrPath);
+        bstrPath = nullptr;
+    }
+
+    // Returning FALSE leaves the INIT_ONCE unresolved, so the next call tries again
+    return SUCCEEDED(pState->hr);
+}
@@ -5,15 +5,23 @@
 #pragma once
 
 #include "BigDriveItemType.h"
+#include "BigDriveItemId.h"
 
 #include "BigDriveShellFolderEventLogger.h"
 #include "BigDriveShellFolderStatic.h"
 #include "Logging\BigDriveShellFolderTraceLogger.h"
+#include "..\BigDrive.Client\DriveConfiguration.h"
 
 #include <shlobj.h> // For IShellFolder and related interfaces
 #include <objbase.h> // For COM initialization
 #include <string>
 
+class BigDriveInterfaceProvider;
+class BigDriveShellFolderCache;
+class BigDriveEnumIDList;
+struct BigDriveEnumerationEntry;
+class BigDriveEnumerationReader;
+
 /// <summary>
 /// Object identifiers in the explorer's name space (ItemID and IDList)
 ///
@@ -60,6 +68,7 @@ struct BIGDRIVE_ITEMID {
 	USHORT  cb;        // Size of this structure including cb
 	UINT    uType;     // Type Of Item (Folder, Files, Etc...)
 	wchar_t szName[1]; // Unique identifier
+	// Optionally followed by a versioned metadata block; see BigDriveItemId.h
 };
 #pragma pack(pop)
 
@@ -79,6 +88,11 @@ private:
 	static BigDriveShellFolderEventLogger s_eventLogger;
 	static BigDriveShellFolderStatic s_staticData;
 
+	/// <summary>
+	/// Most paths sent in one IBigDriveFileInfoBatch call.
+	/// </summary>
+	static const ULONG MaxFileInfoBatch = 256;
+
 private:
 
 	/// <summary>
@@ -106,6 +120,56 @@ private:
 	/// </summary>
 	BigDriveShellFolderTraceLogger m_traceLogger;
 
+	/// <summary>
+	/// Runs the resolution of <see cref="m_bstrPath"/> and the first <see cref="m_driveConfiguration"/> once.
+	/// </summary>
+	INIT_ONCE m_initOnceState;
+
+	/// <summary>
+	/// Guards <see cref="m_driveConfiguration"/> and <see cref="m_configurationVersion"/> once <see cref="m_initOnceState"/> has completed.
+	/// </summary>
+	SRWLOCK m_configurationLock;
+
+	/// <summary>
+	/// The drive configuration, resolved on first use and again whenever the configuration cache has changed since.
+	/// </summary>
+	DriveConfiguration m_driveConfiguration;
+
+	/// <summary>
+	/// The configuration cache version <see cref="m_driveConfiguration"/> was read at.
+	/// </summary>
+	LONG m_configurationVersion;
+
+	/// <summary>
+	/// The folder path passed to providers, resolved on first use. Valid once <see cref="m_initOnceState"/> has completed.
+	/// </summary>
+	BSTR m_bstrPath;
+
+	/// <summary>
+	/// Next folder in the same <see cref="BigDriveShellFolderCache"/> bucket. Guarded by the cache's lock.
+	/// </summary>
+	BigDriveShellFolder* m_pNextInCache;
+
+	/// <summary>
+	/// Hash of the drive and absolute PIDL, computed when the folder is added to the cache.
+	/// </summary>
+	ULONG m_cacheHash;
+
+	/// <summary>
+	/// TRUE if the folder was added to the <see cref="BigDriveShellFolderCache"/> and must be removed before it is deleted.
+	/// </summary>
+	BOOL m_fInCache;
+
+	/// <summary>
+	/// ID of the thread whose single-threaded apartment the folder was cached for.
+	/// </summary>
+	DWORD m_cacheThreadId;
+
+	/// <summary>
+	/// Creation time of that thread, which tells it apart from a later thread with the same ID.
+	/// </summary>
+	ULONGLONG m_cacheThreadCreated;
+
 public:
 
 	/// <summary>
@@ -117,18 +181,26 @@ public:
 	/// <param name="pParentShellFolder">Pointer to the parent shell folder, if any. Can be nullptr for root folders.</param>
 	/// <param name="pidl">The absolute PIDL identifying the folder's location within the shell namespace.</param>
 	BigDriveShellFolder(CLSID driveGuid, BigDriveShellFolder* pParentShellFolder, PCIDLIST_ABSOLUTE pidlAbsolute) :
-		m_driveGuid(driveGuid), m_pParentShellFolder(pParentShellFolder), m_pidlAbsolute(nullptr), m_refCount(1)
+		m_driveGuid(driveGuid), m_pParentShellFolder(pParentShellFolder), m_pidlAbsolute(nullptr), m_refCount(1),
+		m_configurationVersion(0), m_bstrPath(nullptr), m_pNextInCache(nullptr), m_cacheHash(0), m_fInCache(FALSE), m_cacheThreadId(0), m_cacheThreadCreated(0)
 	{
+		::InitOnceInitialize(&m_initOnceState);
+		::InitializeSRWLock(&m_configurationLock);
+
 		if (pidlAbsolute != nullptr)
 		{
 			m_pidlAbsolute = ::ILClone(pidlAbsolute);
 		}
 
 		m_traceLogger.Initialize(driveGuid);
+
+		BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveShellFolders);
 	}
 
 	~BigDriveShellFolder()
 	{
+		BigDrivePerformanceCounters::Decrement(BigDriveCounter_LiveShellFolders);
+
 		// Free the PIDL when the object is destroyed
 		if (m_pidlAbsolute != nullptr)
 		{
@@ -136,6 +208,12 @@ public:
 			m_pidlAbsolute = nullptr;
 		}
 
+		if (m_bstrPath != nullptr)
+		{
+			::SysFreeString(m_bstrPath);
+			m_bstrPath = nullptr;
+		}
+
 		m_traceLogger.Uninitialize();
 	}
 
@@ -607,6 +685,176 @@ private:
 
 	HRESULT GetStorageProperty(PCUITEMID_CHILD pidl, const SHCOLUMNID* pscid, VARIANT* pv);
 
+	/// <summary>
+	/// Answers a size or last write time property from the metadata carried in the item ID, from the
+	/// cached listing of this folder, or failing both from one IBigDriveFileInfoBatch call shared with
+	/// the folder's other items, avoiding a per-item, per-column IBigDriveFileInfo round trip.
+	/// </summary>
+	/// <param name="pidl">The item ID (relative PIDL).</param>
+	/// <param name="field">BigDriveItemField_Size or BigDriveItemField_LastWriteTime.</param>
+	/// <param name="pv">Pointer to a VARIANT to receive the value.</param>
+	/// <returns>S_OK if answered; S_FALSE if the field must be asked for through IBigDriveFileInfo.</returns>
+	HRESULT GetItemMetadataProperty(PCUITEMID_CHILD pidl, BigDriveItemField field, VARIANT* pv);
+
+	/// <summary>
+	/// Retrieves the metadata of an item from the cached listing of this folder.
+	/// </summary>
+	/// <param name="pidl">The item ID (relative PIDL).</param>
+	/// <param name="metadata">Receives the metadata.</param>
+	/// <returns>S_OK if the folder's listing is cached and lists the item; S_FALSE otherwise.</returns>
+	HRESULT GetCachedItemMetadata(PCUITEMID_CHILD pidl, BigDriveItemMetadata& metadata);
+
+	/// <summary>
+	/// Retrieves the metadata of an item with one IBigDriveFileInfoBatch call that also asks for the files listed
+	/// after it in the cached listing of this folder still missing their size or last write time, and fills the
+	/// answers into the listing by the path each record is named with. The view asks for the columns of every item it shows, so the rest are then answered from the cache.
+	/// Without a cached listing the item goes through <see cref="FetchCoalescedItemMetadata"/>.
+	/// </summary>
+	/// <param name="pidl">The item ID (relative PIDL).</param>
+	/// <param name="metadata">Receives the metadata.</param>
+	/// <returns>S_OK if the provider returned metadata for the item; S_FALSE if it doesn't implement IBigDriveFileInfoBatch
+	/// or doesn't know the item; otherwise, an HRESULT error code.</returns>
+	HRESULT FetchItemMetadata(PCUITEMID_CHILD pidl, BigDriveItemMetadata& metadata);
+
+	/// <summary>
+	/// Retrieves the metadata of an item whose folder listing isn't cached, through the process-wide
+	/// BigDriveMetadataCoalescer, so the items other threads ask for meanwhile share one IBigDriveFileInfoBatch call.
+	/// </summary>
+	/// <param name="pInterfaceProvider">The provider of this folder's drive.</param>
+	/// <param name="bstrPath">The path of the item, as passed to providers.</param>
+	/// <param name="metadata">Receives the metadata.</param>
+	/// <returns>S_OK if the provider returned metadata for the item; S_FALSE if it doesn't implement IBigDriveFileInfoBatch
+	/// or doesn't know the item; otherwise, an HRESULT error code.</returns>
+	HRESULT FetchCoalescedItemMetadata(BigDriveInterfaceProvider* pInterfaceProvider, BSTR bstrPath, BigDriveItemMetadata& metadata);
+
+	/// <summary>
+	/// Determines whether a listed entry is a file still missing its size or last write time.
+	/// </summary>
+	/// <param name="entry">The entry.</param>
+	/// <returns>TRUE if the entry should be sent in an IBigDriveFileInfoBatch call.</returns>
+	static BOOL NeedsFileInfo(const BigDriveEnumerationEntry& entry);
+
+	/// <summary>
+	/// Finds the IBigDriveFileInfoBatch record of a child of this folder by the path the record is named with.
+	/// </summary>
+	/// <param name="aRecords">The records returned.</param>
+	/// <param name="cRecords">Number of records.</param>
+	/// <param name="bstrFolderPath">The path of this folder.</param>
+	/// <param name="pchName">The name of the child. Need not be null terminated.</param>
+	/// <param name="cchName">Number of characters in the name.</param>
+	/// <param name="iNext">The record to look at first; updated to the one after the record found.</param>
+	/// <param name="record">Receives the record; its fields are zero if there is none.</param>
+	/// <returns>TRUE if the provider answered for the child.</returns>
+	static BOOL FindFileInfoRecord(const BigDriveEnumerationEntry* aRecords, ULONG cRecords, BSTR bstrFolderPath,
+		LPCWSTR pchName, size_t cchName, ULONG& iNext, BigDriveEnumerationEntry& record);
+
+	/// <summary>
+	/// Builds the path of a child of this folder, as passed to providers.
+	/// </summary>
+	/// <param name="bstrFolderPath">The path of this folder.</param>
+	/// <param name="pchName">The name of the child. Need not be null terminated.</param>
+	/// <param name="cchName">Number of characters in the name.</param>
+	/// <param name="pbstrPath">Receives the path. The caller must free it.</param>
+	/// <returns>S_OK on success; E_OUTOFMEMORY.</returns>
+	static HRESULT CreateChildPath(BSTR bstrFolderPath, LPCWSTR pchName, size_t cchName, BSTR* pbstrPath);
+
+	/// <summary>
+	/// Determines whether a child folder has subfolders, for SFGAO_HASSUBFOLDER. Uses the provider's
+	/// hint carried by the item or the cached listing of this folder, then a cached listing of the child,
+	/// and only then asks the provider for a single entry through IBigDriveEnumeratePaged.
+	/// </summary>
+	/// <param name="pidl">The item ID (relative PIDL) of the child folder.</param>
+	/// <returns>S_OK if it has or may have subfolders; S_FALSE if it has none; otherwise, an HRESULT error code.</returns>
+	HRESULT HasSubFolders(PCUITEMID_CHILD pidl);
+
+	/// <summary>
+	/// Enumerates the folder with a single IBigDriveEnumerateEx call, creating PIDLs that carry
+	/// the size, last write time, attributes and change token returned by the provider.
+	/// </summary>
+	/// <param name="pInterfaceProvider">The provider of the drive.</param>
+	/// <param name="bstrPath">The path of this folder, as passed to providers.</param>
+	/// <param name="grfFlags">The SHCONTF flags passed to EnumObjects.</param>
+	/// <param name="ppResult">Receives the enumerator, or nullptr if the folder is empty.</param>
+	/// <returns>S_OK on success; S_FALSE if the provider doesn't implement IBigDriveEnumerateEx; otherwise, an HRESULT error code.</returns>
+	HRESULT EnumObjectsEx(BigDriveInterfaceProvider* pInterfaceProvider, BSTR bstrPath, DWORD grfFlags, BigDriveEnumIDList** ppResult);
+
+	/// <summary>
+	/// Enumerates the folder from the process-wide listing cache, without calling the provider.
+	/// </summary>
+	/// <param name="bstrPath">The path of this folder, as passed to providers.</param>
+	/// <param name="grfFlags">The SHCONTF flags passed to EnumObjects.</param>
+	/// <param name="ppResult">Receives the enumerator, or nullptr if the folder is empty.</param>
+	/// <returns>S_OK on a cache hit; S_FALSE on a miss; otherwise, an HRESULT error code.</returns>
+	HRESULT EnumObjectsCached(BSTR bstrPath, DWORD grfFlags, BigDriveEnumIDList** ppResult);
+
+	/// <summary>
+	/// Creates PIDLs for the entries of a packed listing, skipping the types the view didn't ask for.
+	/// </summary>
+	/// <param name="reader">A reader positioned at the first entry.</param>
+	/// <param name="flags">BigDriveEnumerateEntries flags naming the types to include.</param>
+	/// <param name="ppResult">Receives the enumerator, or nullptr if no entry was included.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	static HRESULT CreateEnumIDList(BigDriveEnumerationReader& reader, LONG flags, BigDriveEnumIDList** ppResult);
+
+	/// <summary>
+	/// Converts SHCONTF flags to BigDriveEnumerateEntries flags.
+	/// </summary>
+	/// <param name="grfFlags">The SHCONTF flags passed to EnumObjects.</param>
+	/// <returns>The BigDriveEnumerateEntries flags.</returns>
+	static LONG GetEnumerateEntriesFlags(DWORD grfFlags);
+
+	/// <summary>
+	/// Creates an enumerator that pulls the folder from the provider one IBigDriveEnumeratePaged page
+	/// at a time as the view asks for items, so large folders start showing quickly and only one page
+	/// is held in memory.
+	/// </summary>
+	/// <param name="pInterfaceProvider">The provider of the drive.</param>
+	/// <param name="bstrPath">The path of this folder, as passed to providers.</param>
+	/// <param name="grfFlags">The SHCONTF flags passed to EnumObjects.</param>
+	/// <param name="ppenumIDList">Receives the enumerator.</param>
+	/// <returns>S_OK on success; S_FALSE if the provider doesn't implement IBigDriveEnumeratePaged; otherwise, an HRESULT error code.</returns>
+	HRESULT EnumObjectsPaged(BigDriveInterfaceProvider* pInterfaceProvider, BSTR bstrPath, DWORD grfFlags, IEnumIDList** ppenumIDList);
+
+	/// <summary>
+	/// Creates an enumerator for a view that passed SHCONTF_ENABLE_ASYNC. The folder is enumerated on a
+	/// thread pool thread and the enumerator returns E_PENDING until the first items arrive.
+	/// </summary>
+	/// <param name="grfFlags">The SHCONTF flags passed to EnumObjects.</param>
+	/// <param name="ppenumIDList">Receives the enumerator.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+	HRESULT EnumObjectsAsync(DWORD grfFlags, IEnumIDList** ppenumIDList);
+
+	/// <summary>
+	/// Retrieves the state derived from the folder's drive and PIDL: the drive configuration and the
+	/// path passed to providers. They are resolved the first time they are asked for, after the folder
+	/// has its PIDL, so repeat binds and enumerations don't redo them. The path is kept for the life of
+	/// the folder; the configuration is read again once the configuration cache version has changed,
+	/// so a drive moved to another provider is seen by folders that are already open.
+	/// </summary>
+	/// <param name="pDriveConfiguration">Receives a copy of the drive configuration. May be nullptr.</param>
+	/// <param name="pbstrPath">Receives the folder path, owned by the folder; don't free it. May be nullptr.</param>
+	/// <returns>S_OK on success; E_UNEXPECTED if the folder has no PIDL yet; otherwise, the error resolving the state.</returns>
+	HRESULT GetFolderState(DriveConfiguration* pDriveConfiguration, BSTR* pbstrPath);
+
+	/// <summary>
+	/// InitOnce callback that resolves the folder state. The parameter is a BigDriveShellFolderState that
+	/// names the folder and receives the HRESULT, so a failure is reported and retried on the next call.
+	/// </summary>
+	static BOOL CALLBACK InitializeStateOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext);
+
+	/// <summary>
+	/// Increments the reference count unless it has already dropped to zero. Used by
+	/// <see cref="BigDriveShellFolderCache"/> to hand out a folder it holds without a reference.
+	/// </summary>
+	/// <returns>TRUE if a reference was taken; FALSE if the folder is being destroyed.</returns>
+	BOOL TryAddRef();
+
+	/// <summary>
+	/// Destroys the folder once its reference count has dropped to zero, taking it out of the
+	/// <see cref="BigDriveShellFolderCache"/> first so no bind can find it.
+	/// </summary>
+	void FinalRelease();
+
 public:
 
 	/// <summary>
@@ -654,6 +902,47 @@ public:
 	/// <returns>S_OK if the PIDL was allocated successfully; E_INVALIDARG or E_OUTOFMEMORY on failure.</returns>
 	static HRESULT AllocBigDrivePidl(BigDriveItemType nType, BSTR bstrPath, LPITEMIDLIST& ppidl);
 
+	/// <summary>
+	/// Allocates a PIDL like <see cref="AllocBigDrivePidl"/>, appending a versioned metadata block
+	/// (size, last write time, attributes, change token) to the last item so details and sorting
+	/// can be answered from the PIDL without a provider round trip. Intermediate items carry no metadata.
+	/// </summary>
+	/// <param name="nType">The type of the last item (e.g., file or folder).</param>
+	/// <param name="bstrPath">The full path as a BSTR, with components separated by backslashes.</param>
+	/// <param name="pMetadata">The metadata of the last item, or nullptr for none.</param>
+	/// <param name="ppidl">[out] Receives the allocated PIDL on success, or nullptr on failure.</param>
+	/// <returns>S_OK if the PIDL was allocated successfully; E_INVALIDARG or E_OUTOFMEMORY on failure.</returns>
+	static HRESULT AllocBigDrivePidl(BigDriveItemType nType, BSTR bstrPath, const BigDriveItemMetadata* pMetadata, LPITEMIDLIST& ppidl);
+
+	/// <summary>
+	/// Allocates a single item PIDL for an entry returned by IBigDriveEnumerateEx or IBigDriveEnumeratePaged,
+	/// carrying the size, last write time, attributes and etag hash the provider supplied.
+	/// </summary>
+	/// <param name="entry">The entry.</param>
+	/// <param name="ppidl">[out] Receives the allocated PIDL on success, or nullptr on failure.</param>
+	/// <returns>S_OK if the PIDL was allocated successfully; E_INVALIDARG or E_OUTOFMEMORY on failure.</returns>
+	static HRESULT AllocBigDrivePidl(const BigDriveEnumerationEntry& entry, LPITEMIDLIST& ppidl);
+
+	/// <summary>
+	/// Converts the size, last write time, attributes and etag of an entry returned by IBigDriveEnumerateEx
+	/// or IBigDriveEnumeratePaged into the metadata carried by its item ID.
+	/// </summary>
+	/// <param name="entry">The entry.</param>
+	/// <param name="metadata">Receives the metadata.</param>
+	static void GetEntryMetadata(const BigDriveEnumerationEntry& entry, BigDriveItemMetadata& metadata);
+
+	/// <summary>
+	/// Compares two items of the same folder for CompareIDs. Folders sort before files; the column
+	/// in lParam picks the key (name, date modified or size) from the metadata the items carry, and
+	/// names break ties, in collation order through BigDriveSortKeyCache. With SHCIDS_CANONICALONLY
+	/// the names are compared ordinally, ignoring case first, after the type.
+	/// </summary>
+	/// <param name="lParam">The CompareIDs lParam: a column index and SHCIDS_* flags.</param>
+	/// <param name="view1">The first item.</param>
+	/// <param name="view2">The second item.</param>
+	/// <returns>A negative value, zero, or a positive value as the first item sorts before, with, or after the second.</returns>
+	static int CompareItemIds(LPARAM lParam, const BigDriveItemIdView& view1, const BigDriveItemIdView& view2);
+
 	/// <summary>
 	/// Extracts the Unicode name from the last BIGDRIVE_ITEMID in the given PIDL chain and returns it in a STRRET structure.
 	/// The method allocates a new string for STRRET_WSTR and returns it via the output parameter.
@@ -670,4 +959,6 @@ public:
 public:
 
 	friend class BigDriveDropTarget;
+	friend class BigDriveShellFolderCache;
+	friend struct BigDriveShellFolderCacheTestHooks;
 };
@@ -0,0 +1,228 @@
+// <copyright file="BigDriveShellFolderCache.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements the BigDriveShellFolderCache class, which lets BindToObject reuse live
+//   child folder objects.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDriveShellFolderCache.h"
+#include "BigDriveShellFolder.h"
+
+/// <inheritdoc />
+BigDriveShellFolderCache::BigDriveShellFolderCache()
+    : m_hits(0), m_misses(0)
+{
+    ::ZeroMemory(m_apBuckets, sizeof(m_apBuckets));
+    ::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveShellFolderCache& BigDriveShellFolderCache::GetInstance()
+{
+    // Never destroyed: folders may still be released while the DLL is unloading
+    static BigDriveShellFolderCache* s_pInstance = new BigDriveShellFolderCache();
+
+    return *s_pInstance;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellFolderCache::Lookup(REFGUID driveGuid, PCIDLIST_ABSOLUTE pidlParent, PCUIDLIST_RELATIVE pidlRelative, BigDriveShellFolder** ppFolder)
+{
+    HRESULT hr = S_FALSE;
+    const BYTE* pParent = reinterpret_cast<const BYTE*>(pidlParent);
+    const BYTE* pRelative = reinterpret_cast<const BYTE*>(pidlRelative);
+    UINT cbParent = GetPidlBytes(pidlParent);
+    UINT cbRelative = GetPidlBytes(pidlRelative);
+    ULONG hash = Hash(driveGuid, pParent, cbParent, pRelative, cbRelative);
+    BigDriveShellFolder* pFolder = nullptr;
+    const BYTE* pFolderPidl = nullptr;
+    DWORD threadId = 0;
+    ULONGLONG threadCreated = 0;
+
+    *ppFolder = nullptr;
+
+    if (!GetApartment(threadId, threadCreated))
+    {
+        ::InterlockedIncrement(&m_misses);
+        return S_FALSE;
+    }
+
+    ::AcquireSRWLockShared(&m_lock);
+
+    for (pFolder = m_apBuckets[hash & (BucketCount - 1)]; pFolder != nullptr; pFolder = pFolder->m_pNextInCache)
+    {
+        if ((pFolder->m_cacheHash != hash) || !::IsEqualGUID(pFolder->m_driveGuid, driveGuid))
+        {
+            continue;
+        }
+
+        // Another apartment's folder can't be used on this thread
+        if ((pFolder->m_cacheThreadId != threadId) || (pFolder->m_cacheThreadCreated != threadCreated))
+        {
+            continue;
+        }
+
+        pFolderPidl = reinterpret_cast<const BYTE*>(pFolder->m_pidlAbsolute);
+        if (GetPidlBytes(pFolder->m_pidlAbsolute) != cbParent + cbRelative)
+        {
+            continue;
+        }
+
+        if ((::memcmp(pFolderPidl, pParent, cbParent) != 0) || (::memcmp(pFolderPidl + cbParent, pRelative, cbRelative) != 0))
+        {
+            continue;
+        }
+
+        // A folder in its final Release is still listed until it removes itself
+        if (pFolder->TryAddRef())
+        {
+            *ppFolder = pFolder;
+            hr = S_OK;
+            break;
+        }
+    }
+
+    ::ReleaseSRWLockShared(&m_lock);
+
+    ::InterlockedIncrement((hr == S_OK) ? &m_hits : &m_misses);
+
+    return hr;
+}
+
+/// <inheritdoc />
+void BigDriveShellFolderCache::Add(BigDriveShellFolder* pFolder)
+{
+    ULONG bucket = 0;
+    DWORD threadId = 0;
+    ULONGLONG threadCreated = 0;
+
+    if ((pFolder == nullptr) || (pFolder->m_pidlAbsolute == nullptr) || pFolder->m_fInCache)
+    {
+        return;
+    }
+
+    if (!GetApartment(threadId, threadCreated))
+    {
+        return;
+    }
+
+    pFolder->m_cacheThreadId = threadId;
+    pFolder->m_cacheThreadCreated = threadCreated;
+
+    pFolder->m_cacheHash = Hash(pFolder->m_driveGuid, reinterpret_cast<const BYTE*>(pFolder->m_pidlAbsolute), GetPidlBytes(pFolder->m_pidlAbsolute), nullptr, 0);
+    bucket = pFolder->m_cacheHash & (BucketCount - 1);
+
+    // Two binds racing to the same folder both add theirs; lookups return whichever comes first
+    ::AcquireSRWLockExclusive(&m_lock);
+    pFolder->m_pNextInCache = m_apBuckets[bucket];
+    m_apBuckets[bucket] = pFolder;
+    pFolder->m_fInCache = TRUE;
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+void BigDriveShellFolderCache::Remove(BigDriveShellFolder* pFolder)
+{
+    BigDriveShellFolder** ppLink = nullptr;
+
+    ::AcquireSRWLockExclusive(&m_lock);
+
+    for (ppLink = &m_apBuckets[pFolder->m_cacheHash & (BucketCount - 1)]; *ppLink != nullptr; ppLink = &(*ppLink)->m_pNextInCache)
+    {
+        if (*ppLink == pFolder)
+        {
+            *ppLink = pFolder->m_pNextInCache;
+            break;
+        }
+    }
+
+    pFolder->m_pNextInCache = nullptr;
+    pFolder->m_fInCache = FALSE;
+
+    ::ReleaseSRWLockExclusive(&m_lock);
+}
+
+/// <inheritdoc />
+void BigDriveShellFolderCache::GetStatistics(LONG& hits, LONG& misses)
+{
+    hits = ::InterlockedCompareExchange(&m_hits, 0, 0);
+    misses = ::InterlockedCompareExchange(&m_misses, 0, 0);
+}
+
+/// <inheritdoc />
+ULONG BigDriveShellFolderCache::Hash(REFGUID driveGuid, const BYTE* pPrefix, UINT cbPrefix, const BYTE* pSuffix, UINT cbSuffix)
+{
+    // FNV-1a
+    const BYTE* pGuid = reinterpret_cast<const BYTE*>(&driveGuid);
+    ULONG hash = 2166136261UL;
+
+    for (UINT i = 0; i < sizeof(GUID); i++)
+    {
+        hash = (hash ^ pGuid[i]) * 16777619UL;
+    }
+
+    for (UINT i = 0; i < cbPrefix; i++)
+    {
+        hash = (hash ^ pPrefix[i]) * 16777619UL;
+    }
+
+    for (UINT i = 0; i < cbSuffix; i++)
+    {
+        hash = (hash ^ pSuffix[i]) * 16777619UL;
+    }
+
+    return hash;
+}
+
+/// <inheritdoc />
+UINT BigDriveShellFolderCache::GetPidlBytes(LPCITEMIDLIST pidl)
+{
+    UINT cb = 0;
+
+    if (pidl == nullptr)
+    {
+        return 0;
+    }
+
+    // ILGetSize counts the two byte terminator
+    cb = ::ILGetSize(pidl);
+
+    return (cb >= sizeof(USHORT)) ? cb - sizeof(USHORT) : 0;
+}
+
+/// <inheritdoc />
+BOOL BigDriveShellFolderCache::GetApartment(DWORD& threadId, ULONGLONG& threadCreated)
+{
+    APTTYPE aptType = APTTYPE_MTA;
+    APTTYPEQUALIFIER aptQualifier = APTTYPEQUALIFIER_NONE;
+    FILETIME ftCreation = { 0 };
+    FILETIME ftExit = { 0 };
+    FILETIME ftKernel = { 0 };
+    FILETIME ftUser = { 0 };
+
+    threadId = 0;
+    threadCreated = 0;
+
+    if (FAILED(::CoGetApartmentType(&aptType, &aptQualifier)))
+    {
+        return FALSE;
+    }
+
+    if ((aptType != APTTYPE_STA) && (aptType != APTTYPE_MAINSTA))
+    {
+        return FALSE;
+    }
+
+    if (!::GetThreadTimes(::GetCurrentThread(), &ftCreation, &ftExit, &ftKernel, &ftUser))
+    {
+        return FALSE;
+    }
+
+    threadId = ::GetCurrentThreadId();
+    threadCreated = (static_cast<ULONGLONG>(ftCreation.dwHighDateTime) << 32) | ftCreation.dwLowDateTime;
+
+    return TRUE;
+}
\ No newline at end of file
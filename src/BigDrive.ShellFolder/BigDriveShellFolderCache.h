@@ -0,0 +1,123 @@
+// <copyright file="BigDriveShellFolderCache.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Declares the BigDriveShellFolderCache class, which lets BindToObject reuse live
+//   child folder objects.
+// </summary>
+
+#pragma once
+
+#include <shlobj.h>
+
+class BigDriveShellFolder;
+
+/// <summary>
+/// Process-wide table of the child folders created by BindToObject, keyed by drive GUID, absolute
+/// PIDL and apartment. Explorer binds to the same subfolder many times while navigating (the view,
+/// the address bar, the navigation pane); a bind to a folder that is still alive gets the existing
+/// object, with its trace logger, PIDL and resolved state, instead of a new one.
+///
+/// The folder is registered with ThreadingModel=Apartment and its state is not guarded for
+/// concurrent use, so a folder is only handed out to the single-threaded apartment that created
+/// it; a bind on another Explorer thread gets a folder of its own. The apartment is identified by
+/// its thread's ID and creation time, so a thread that reuses the ID of an ended one can't match
+/// its folders. Binds from the multithreaded apartment are not cached.
+///
+/// The table holds no references. A folder stays in it while something else holds it and takes
+/// itself out in its final Release, before it is deleted. Lookups only hand out folders whose
+/// reference count they can raise from above zero, so a folder that is being destroyed is skipped.
+/// </summary>
+class BigDriveShellFolderCache
+{
+private:
+
+    /// <summary>
+    /// Number of hash buckets. Must be a power of two.
+    /// </summary>
+    static const ULONG BucketCount = 64;
+
+    /// <summary>
+    /// Hash buckets, chained through <see cref="BigDriveShellFolder::m_pNextInCache"/>.
+    /// </summary>
+    BigDriveShellFolder* m_apBuckets[BucketCount];
+
+    /// <summary>
+    /// Guards the buckets and the chain pointers in the folders.
+    /// </summary>
+    SRWLOCK m_lock;
+
+    /// <summary>
+    /// Counter of binds that reused a live folder.
+    /// </summary>
+    volatile LONG m_hits;
+
+    /// <summary>
+    /// Counter of binds that had to create a folder.
+    /// </summary>
+    volatile LONG m_misses;
+
+public:
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BigDriveShellFolderCache"/> class.
+    /// </summary>
+    BigDriveShellFolderCache();
+
+    /// <summary>
+    /// Retrieves the process-wide instance.
+    /// </summary>
+    /// <returns>The folder cache.</returns>
+    static BigDriveShellFolderCache& GetInstance();
+
+    /// <summary>
+    /// Finds the calling apartment's live folder at a PIDL relative to a parent, without combining the two.
+    /// </summary>
+    /// <param name="driveGuid">The drive.</param>
+    /// <param name="pidlParent">Absolute PIDL of the parent folder. May be nullptr.</param>
+    /// <param name="pidlRelative">PIDL of the folder relative to the parent.</param>
+    /// <param name="ppFolder">Receives the folder on a hit, AddRef'd.</param>
+    /// <returns>S_OK on a hit; S_FALSE on a miss.</returns>
+    HRESULT Lookup(REFGUID driveGuid, PCIDLIST_ABSOLUTE pidlParent, PCUIDLIST_RELATIVE pidlRelative, BigDriveShellFolder** ppFolder);
+
+    /// <summary>
+    /// Adds a folder so later binds to its PIDL from the calling apartment reuse it. The folder must
+    /// have its absolute PIDL and have been created by the calling thread. Does nothing outside a
+    /// single-threaded apartment.
+    /// </summary>
+    /// <param name="pFolder">The folder. The cache does not AddRef it.</param>
+    void Add(BigDriveShellFolder* pFolder);
+
+    /// <summary>
+    /// Removes a folder. Called from the folder's final Release.
+    /// </summary>
+    /// <param name="pFolder">The folder.</param>
+    void Remove(BigDriveShellFolder* pFolder);
+
+    /// <summary>
+    /// Retrieves the cache counters.
+    /// </summary>
+    /// <param name="hits">Receives the number of binds that reused a live folder.</param>
+    /// <param name="misses">Receives the number of binds that created a folder.</param>
+    void GetStatistics(LONG& hits, LONG& misses);
+
+private:
+
+    /// <summary>
+    /// Hashes a drive and the bytes of a PIDL given as a prefix and a suffix, without the terminator.
+    /// </summary>
+    static ULONG Hash(REFGUID driveGuid, const BYTE* pPrefix, UINT cbPrefix, const BYTE* pSuffix, UINT cbSuffix);
+
+    /// <summary>
+    /// Retrieves the size of a PIDL in bytes, without the terminator. Zero for nullptr.
+    /// </summary>
+    static UINT GetPidlBytes(LPCITEMIDLIST pidl);
+
+    /// <summary>
+    /// Identifies the calling thread's single-threaded apartment.
+    /// </summary>
+    /// <param name="threadId">Receives the ID of the thread.</param>
+    /// <param name="threadCreated">Receives the creation time of the thread, which tells it apart from an ended thread with the same ID.</param>
+    /// <returns>TRUE if the thread is in a single-threaded apartment; FALSE otherwise.</returns>
+    static BOOL GetApartment(DWORD& threadId, ULONGLONG& threadCreated);
+};
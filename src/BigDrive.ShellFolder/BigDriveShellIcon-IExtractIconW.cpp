@@ -15,6 +15,28 @@
 // Need this to link properly
 #pragma comment(lib, "comctl32.lib")
 
+extern "C" IMAGE_DOS_HEADER __ImageBase;
+
+/// <summary>
+/// Standard folder icon, used for every folder.
+/// </summary>
+static const BigDriveIconLocation s_folderIcon = { L"shell32.dll", 3, 0 };
+
+/// <summary>
+/// Generic document icon, used for files without an extension or of a type the system doesn't know.
+/// </summary>
+static const BigDriveIconLocation s_documentIcon = { L"shell32.dll", 1, 0 };
+
+/// <summary>
+/// Starts watching for icon changes the first time a file icon is asked for.
+/// </summary>
+static INIT_ONCE s_iconWatchInitOnce = INIT_ONCE_STATIC_INIT;
+
+/// <summary>
+/// Window class of the icon change window.
+/// </summary>
+static LPCWSTR s_szIconChangeWindowClass = L"BigDriveIconChangeWindow";
+
 /// <summary>
 /// Retrieves the location and index of the icon for a specified item in the BigDrive shell namespace.
 /// The Shell calls this method to determine which icon to display for a given item (file or folder).
@@ -78,76 +100,43 @@ HRESULT __stdcall BigDriveShellIcon::GetIconLocation(
 		case BigDriveItemType_Folder:
 
 			// For folders, use standard folder icon
-			hr = ::StringCchCopyW(pszFile, cchMax, L"shell32.dll");
+			hr = ::StringCchCopyW(pszFile, cchMax, s_folderIcon.szFile);
 			if (SUCCEEDED(hr))
 			{
-				*pIndex = 3;  // Standard folder icon
+				*pIndex = s_folderIcon.iIndex;
 			}
 			break;
 
 		case BigDriveItemType_File:
 		{
-			// For files, get the extension and ask the shell for the icon
-			WCHAR szExt[MAX_PATH] = L".";
-
 			// Extract extension from the name
 			LPCWSTR pszName = pItem->szName;
 			LPCWSTR pszExtension = wcsrchr(pszName, L'.');
+			BigDriveIconLocation location;
 
 			if (!pszExtension)
 			{
 				// No extension - use generic document icon
-				::StringCchCopyW(pszFile, cchMax, L"shell32.dll");
-				*pIndex = 1;
+				::StringCchCopyW(pszFile, cchMax, s_documentIcon.szFile);
+				*pIndex = s_documentIcon.iIndex;
 
 				goto End;
 			}
 
-			// Create dummy filename with extension
-			WCHAR szDummyFile[MAX_PATH] = L"dummy";
-			wcscat_s(szDummyFile, MAX_PATH, pszExtension);
-
-			// Query shell for icon
-			SHFILEINFO shfi = { 0 };
+			::InitOnceExecuteOnce(&s_iconWatchInitOnce, WatchIconChangesOnce, nullptr, nullptr);
 
-			DWORD_PTR result = ::SHGetFileInfo(
-				szDummyFile,
-				FILE_ATTRIBUTE_NORMAL,
-				&shfi,
-				sizeof(shfi),
-				SHGFI_ICONLOCATION | SHGFI_USEFILEATTRIBUTES
-			);
-
-			if (!result)
+			// Every file with this extension has the same icon, so the system is asked once per extension
+			hr = BigDriveIconCache::GetInstance().GetIconLocation(pszExtension, ResolveIconLocation, location);
+			if (FAILED(hr))
 			{
-				// Fallback to generic document icon
-				::StringCchCopyW(pszFile, cchMax, L"shell32.dll");
-				*pIndex = 1;
-
 				goto End;
 			}
 
-			if (shfi.szDisplayName[0] != L'\0')
-			{
-				// Normal case - icon location is in a specific file
-				::StringCchCopyW(pszFile, cchMax, shfi.szDisplayName);
-				*pIndex = shfi.iIcon;
-			}
-			else if (shfi.iIcon != 0)
-			{
-				// Special case - icon is in the system image list
-				// Use shell32.dll which is the main shell icon resource
-				::StringCchCopyW(pszFile, cchMax, L"shell32.dll");
-
-				// GIL_NOTFILENAME is set, the shell will calls the Extract() method
-				*pwFlags |= GIL_NOTFILENAME;  // Tell shell this isn't a real path
-				*pIndex = shfi.iIcon;  // Pass the system image list index
-			}
-			else
+			hr = ::StringCchCopyW(pszFile, cchMax, location.szFile);
+			if (SUCCEEDED(hr))
 			{
-				// Fallback - no icon found
-				::StringCchCopyW(pszFile, cchMax, L"shell32.dll");
-				*pIndex = 1;  // Generic document icon
+				*pIndex = location.iIndex;
+				*pwFlags |= location.uFlags;
 			}
 
 			break;
@@ -262,4 +251,160 @@ HRESULT __stdcall BigDriveShellIcon::Extract(
 	// For standard icons or if system image list extraction failed,
 	// let the Shell extract the icon using standard methods
 	return S_FALSE;
-}
\ No newline at end of file
+}
+
+/// <inheritdoc />
+HRESULT BigDriveShellIcon::ResolveIconLocation(LPCWSTR szExtension, BigDriveIconLocation& location)
+{
+	WCHAR szDummyFile[MAX_PATH] = L"dummy";
+	SHFILEINFO shfi = { 0 };
+	DWORD_PTR result = 0;
+
+	location = s_documentIcon;
+
+	// Create dummy filename with extension; the file doesn't have to exist
+	if (FAILED(::StringCchCatW(szDummyFile, ARRAYSIZE(szDummyFile), szExtension)))
+	{
+		return S_OK;
+	}
+
+	result = ::SHGetFileInfoW(
+		szDummyFile,
+		FILE_ATTRIBUTE_NORMAL,
+		&shfi,
+		sizeof(shfi),
+		SHGFI_ICONLOCATION | SHGFI_USEFILEATTRIBUTES);
+
+	if (!result)
+	{
+		return S_OK;
+	}
+
+	if (shfi.szDisplayName[0] != L'\0')
+	{
+		// Normal case - icon location is in a specific file
+		::StringCchCopyW(location.szFile, ARRAYSIZE(location.szFile), shfi.szDisplayName);
+		location.iIndex = shfi.iIcon;
+	}
+	else if (shfi.iIcon != 0)
+	{
+		// Special case - icon is in the system image list; GIL_NOTFILENAME makes the shell call Extract()
+		location.uFlags = GIL_NOTFILENAME;
+		location.iIndex = shfi.iIcon;
+	}
+
+	return S_OK;
+}
+
+/// <inheritdoc />
+BOOL CALLBACK BigDriveShellIcon::WatchIconChangesOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext)
+{
+	HANDLE hThread = nullptr;
+
+	// Nothing broadcasts a theme change that carries the new icons, so its key is watched; it is small
+	// and rarely written, unlike Software\Classes, whose changes arrive as SHCNE_ASSOCCHANGED instead
+	BigDriveIconCache::GetInstance().WatchRegistryKey(HKEY_CURRENT_USER, L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes");
+
+	// Without the thread, association and setting changes go unseen until the process restarts; the cache still works
+	hThread = ::CreateThread(nullptr, 0, IconChangeThreadProc, nullptr, 0, nullptr);
+	if (hThread != nullptr)
+	{
+		::CloseHandle(hThread);
+	}
+
+	return TRUE;
+}
+
+/// <inheritdoc />
+DWORD WINAPI BigDriveShellIcon::IconChangeThreadProc(LPVOID pParameter)
+{
+	HINSTANCE hInstance = reinterpret_cast<HINSTANCE>(&__ImageBase);
+	WNDCLASSEXW wc = {};
+	HWND hwnd = nullptr;
+	PIDLIST_ABSOLUTE pidlDesktop = nullptr;
+	SHChangeNotifyEntry entry = {};
+	ULONG notifyId = 0;
+	MSG msg = {};
+
+	wc.cbSize = sizeof(wc);
+	wc.lpfnWndProc = IconChangeWndProc;
+	wc.hInstance = hInstance;
+	wc.lpszClassName = s_szIconChangeWindowClass;
+
+	if (!::RegisterClassExW(&wc))
+	{
+		goto End;
+	}
+
+	// Top-level, since WM_SETTINGCHANGE is only sent to top-level windows; never shown
+	hwnd = ::CreateWindowExW(WS_EX_TOOLWINDOW, s_szIconChangeWindowClass, L"", WS_POPUP, 0, 0, 0, 0, nullptr, nullptr, hInstance, nullptr);
+	if (hwnd == nullptr)
+	{
+		goto End;
+	}
+
+	if (SUCCEEDED(::SHGetKnownFolderIDList(FOLDERID_Desktop, 0, nullptr, &pidlDesktop)))
+	{
+		entry.pidl = pidlDesktop;
+		entry.fRecursive = TRUE;
+
+		notifyId = ::SHChangeNotifyRegister(hwnd, SHCNRF_ShellLevel | SHCNRF_NewDelivery, SHCNE_ASSOCCHANGED, WM_ASSOCCHANGED, 1, &entry);
+
+		::CoTaskMemFree(pidlDesktop);
+		pidlDesktop = nullptr;
+	}
+
+	// A thread that doesn't pump would stall every WM_SETTINGCHANGE broadcast, so it never stops
+	while (::GetMessageW(&msg, nullptr, 0, 0) > 0)
+	{
+		::DispatchMessageW(&msg);
+	}
+
+	if (notifyId != 0)
+	{
+		::SHChangeNotifyDeregister(notifyId);
+	}
+
+End:
+
+	if (hwnd != nullptr)
+	{
+		::DestroyWindow(hwnd);
+	}
+
+	return 0;
+}
+
+/// <inheritdoc />
+LRESULT CALLBACK BigDriveShellIcon::IconChangeWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	HANDLE hLock = nullptr;
+	PIDLIST_ABSOLUTE* ppidl = nullptr;
+	LONG lEvent = 0;
+
+	switch (uMsg)
+	{
+	case WM_ASSOCCHANGED:
+
+		// The notification is in shared memory, which is freed when it is unlocked
+		hLock = ::SHChangeNotification_Lock(reinterpret_cast<HANDLE>(wParam), static_cast<DWORD>(lParam), &ppidl, &lEvent);
+		if (hLock != nullptr)
+		{
+			::SHChangeNotification_Unlock(hLock);
+		}
+
+		BigDriveIconCache::GetInstance().Clear();
+		return 0;
+
+	case WM_SETTINGCHANGE:
+
+		// Icon size, metrics and shell policies all arrive here, without saying which; clearing is cheap
+		BigDriveIconCache::GetInstance().Clear();
+		break;
+
+	default:
+		break;
+	}
+
+	return ::DefWindowProcW(hwnd, uMsg, wParam, lParam);
+}
@@ -8,6 +8,7 @@
 #include <shlobj.h> 
 
 #include "BigDriveShellFolder.h"
+#include "..\BigDrive.Client\BigDriveIconCache.h"
 
 class BigDriveShellIcon : public
 	IExtractIconW,
@@ -55,6 +56,39 @@ private:
 	/// </summary>
 	~BigDriveShellIcon();
 
+	/// <summary>
+	/// Asks the system for the icon of an extension. Called by the icon cache on a miss; types
+	/// the system doesn't know get the generic document icon, so they are cached too.
+	/// </summary>
+	/// <param name="szExtension">The extension, including the leading dot.</param>
+	/// <param name="location">Receives the icon location.</param>
+	/// <returns>S_OK.</returns>
+	static HRESULT ResolveIconLocation(LPCWSTR szExtension, BigDriveIconLocation& location);
+
+	/// <summary>
+	/// Message the shell posts to the icon change window on SHCNE_ASSOCCHANGED.
+	/// </summary>
+	static const UINT WM_ASSOCCHANGED = WM_APP + 1;
+
+	/// <summary>
+	/// Arranges for the icon cache to be cleared when file associations, the icon theme, or the
+	/// icon settings change: the theme key is watched, and a thread is started for the icon change
+	/// window. Run once per process.
+	/// </summary>
+	static BOOL CALLBACK WatchIconChangesOnce(PINIT_ONCE pInitOnce, PVOID pParameter, PVOID* ppContext);
+
+	/// <summary>
+	/// Thread that owns the icon change window: a hidden top-level window, so it is sent
+	/// WM_SETTINGCHANGE, registered with the shell for SHCNE_ASSOCCHANGED. Runs its message loop
+	/// for the life of the process.
+	/// </summary>
+	static DWORD WINAPI IconChangeThreadProc(LPVOID pParameter);
+
+	/// <summary>
+	/// Window procedure of the icon change window; clears the icon cache on either notification.
+	/// </summary>
+	static LRESULT CALLBACK IconChangeWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+
 public:
 
 	/// <summary>
@@ -5,28 +5,55 @@
 #include "pch.h"
 
 #include "BigDriveTransferSource.h"
+#include "..\BigDrive.Client\BigDriveInterfaceProvider.h"
 #include "Logging\BigDriveShellFolderTraceLogger.h"
 
-/// <inheritdoc/>
 /// <summary>
-/// Stub implementations for ITransferSource methods.
+/// Cookie handed out by Advise; the copy engine registers one sink per transfer source.
 /// </summary>
+static const DWORD AdviseCookie = 1;
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::Advise(
-    ITransferAdviseSink* /*psink*/,
-    DWORD* /*pdwCookie*/)
+    ITransferAdviseSink* psink,
+    DWORD* pdwCookie)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    if ((psink == nullptr) || (pdwCookie == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    *pdwCookie = 0;
+
+    if (m_pSink != nullptr)
+    {
+        return CONNECT_E_ADVISELIMIT;
+    }
+
+    m_pSink = psink;
+    m_pSink->AddRef();
+
+    *pdwCookie = AdviseCookie;
+
+    return S_OK;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::Unadvise(
-    DWORD /*dwCookie*/)
+    DWORD dwCookie)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    if ((dwCookie != AdviseCookie) || (m_pSink == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_pSink->Release();
+    m_pSink = nullptr;
+
+    return S_OK;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::SetProperties(
     IPropertyChangeArray* /*pproparray*/)
 {
@@ -34,55 +61,391 @@ HRESULT __stdcall BigDriveTransferSource::SetProperties(
     return E_NOTIMPL;
 }
 
+/// <inheritdoc/>
+/// <remarks>
+/// A file opens as the read-ahead stream of BigDriveShellFolder::BindToStorage, which the copy engine reads and
+/// writes to the destination itself. Folders have no stream; the engine enumerates them instead.
+/// </remarks>
 HRESULT __stdcall BigDriveTransferSource::OpenItem(
-    IShellItem* /*psi*/,
+    IShellItem* psi,
     TRANSFER_SOURCE_FLAGS /*flags*/,
-    REFIID /*riid*/,
-    void** /*ppv*/)
+    REFIID riid,
+    void** ppv)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    HRESULT hr = S_OK;
+
+    m_traceLogger.LogEnter(__FUNCTION__);
+
+    if (ppv == nullptr)
+    {
+        hr = E_POINTER;
+        goto End;
+    }
+
+    *ppv = nullptr;
+
+    if (psi == nullptr)
+    {
+        hr = E_INVALIDARG;
+        goto End;
+    }
+
+    hr = psi->BindToHandler(nullptr, BHID_Stream, riid, ppv);
+
+End:
+
+    m_traceLogger.LogExit(__FUNCTION__, hr);
+
+    return hr;
 }
 
+/// <inheritdoc/>
+/// <remarks>
+/// Moves within the drive are a provider MoveFile. A move to another drive or the file system returns
+/// ERROR_NOT_SAME_DEVICE, and the copy engine copies the item and then removes it. An item of the same name
+/// in the destination is only replaced with TSF_OVERWRITE_EXIST, and only once the move succeeds; see <see cref="PrepareDestination"/>.
+/// </remarks>
 HRESULT __stdcall BigDriveTransferSource::MoveItem(
-    IShellItem* /*psi*/,
-    IShellItem* /*psiParentDest*/,
-    LPCWSTR /*pszNewName*/,
-    TRANSFER_SOURCE_FLAGS /*flags*/,
-    IShellItem** /*ppsiNew*/)
+    IShellItem* psi,
+    IShellItem* psiParentDst,
+    LPCWSTR pszNameDst,
+    TRANSFER_SOURCE_FLAGS flags,
+    IShellItem** ppsiNew)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    HRESULT hr = S_OK;
+    PIDLIST_ABSOLUTE pidlSource = nullptr;
+    PIDLIST_ABSOLUTE pidlParent = nullptr;
+    BSTR bstrSource = nullptr;
+    BSTR bstrParent = nullptr;
+    BSTR bstrDestination = nullptr;
+    BSTR bstrName = nullptr;
+    BSTR bstrDisplaced = nullptr;
+    LPCWSTR szName = nullptr;
+    IBigDriveFileOperations* pFileOperations = nullptr;
+
+    m_traceLogger.LogEnter(__FUNCTION__);
+
+    if (ppsiNew)
+    {
+        *ppsiNew = nullptr;
+    }
+
+    hr = GetProviderPath(psi, FALSE, &pidlSource, bstrSource);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = GetProviderPath(psiParentDst, TRUE, &pidlParent, bstrParent);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    szName = pszNameDst ? pszNameDst : (::wcsrchr(bstrSource, L'\\') + 1);
+
+    hr = BigDriveInterfaceProvider::GetFileOperations(m_driveGuid, S_OK, nullptr, &pFileOperations);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = PrepareDestination(pFileOperations, bstrSource, bstrParent, szName, flags, bstrName, bstrDestination, bstrDisplaced);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileOperations::MoveFile");
+    hr = pFileOperations->MoveFile(m_driveGuid, bstrSource, bstrDestination);
+    BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileOperations::MoveFile", hr);
+
+    CompleteDestination(pFileOperations, bstrDisplaced, bstrDestination, hr);
+
+    if (FAILED(hr))
+    {
+        s_eventLogger.WriteErrorFormmated(L"MoveItem: Failed to move '%s' to '%s'. HRESULT: 0x%08X", bstrSource, bstrDestination, hr);
+        goto End;
+    }
+
+    NotifyParentChanged(pidlSource, bstrSource);
+    NotifyParentChanged(pidlParent, bstrDestination);
+
+    hr = CreateMovedItem(pidlSource, pidlParent, bstrName, ppsiNew);
+
+End:
+
+    if (pFileOperations)
+    {
+        pFileOperations->Release();
+        pFileOperations = nullptr;
+    }
+
+    if (bstrDisplaced)
+    {
+        ::SysFreeString(bstrDisplaced);
+        bstrDisplaced = nullptr;
+    }
+
+    if (bstrName)
+    {
+        ::SysFreeString(bstrName);
+        bstrName = nullptr;
+    }
+
+    if (bstrDestination)
+    {
+        ::SysFreeString(bstrDestination);
+        bstrDestination = nullptr;
+    }
+
+    if (bstrParent)
+    {
+        ::SysFreeString(bstrParent);
+        bstrParent = nullptr;
+    }
+
+    if (bstrSource)
+    {
+        ::SysFreeString(bstrSource);
+        bstrSource = nullptr;
+    }
+
+    if (pidlParent)
+    {
+        ::ILFree(pidlParent);
+        pidlParent = nullptr;
+    }
+
+    if (pidlSource)
+    {
+        ::ILFree(pidlSource);
+        pidlSource = nullptr;
+    }
+
+    m_traceLogger.LogExit(__FUNCTION__, hr);
+
+    return hr;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::RecycleItem(
     IShellItem* /*psi*/,
     IShellItem* /*psiParentDest*/,
     TRANSFER_SOURCE_FLAGS /*flags*/,
     IShellItem** /*ppsiNew*/)
 {
-    // Not implemented
+    // Providers have no recycle bin; the shell deletes the item with RemoveItem instead
     return E_NOTIMPL;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::RemoveItem(
-    IShellItem* /*psi*/,
+    IShellItem* psi,
     TRANSFER_SOURCE_FLAGS /*flags*/)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    HRESULT hr = S_OK;
+    PIDLIST_ABSOLUTE pidl = nullptr;
+    BSTR bstrPath = nullptr;
+    IBigDriveFileOperations* pFileOperations = nullptr;
+
+    m_traceLogger.LogEnter(__FUNCTION__);
+
+    hr = GetProviderPath(psi, FALSE, &pidl, bstrPath);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = BigDriveInterfaceProvider::GetFileOperations(m_driveGuid, S_OK, nullptr, &pFileOperations);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileOperations::DeleteFile");
+    hr = pFileOperations->DeleteFile(m_driveGuid, bstrPath);
+    BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileOperations::DeleteFile", hr);
+    if (FAILED(hr))
+    {
+        s_eventLogger.WriteErrorFormmated(L"RemoveItem: Failed to delete '%s'. HRESULT: 0x%08X", bstrPath, hr);
+        goto End;
+    }
+
+    NotifyParentChanged(pidl, bstrPath);
+
+End:
+
+    if (pFileOperations)
+    {
+        pFileOperations->Release();
+        pFileOperations = nullptr;
+    }
+
+    if (bstrPath)
+    {
+        ::SysFreeString(bstrPath);
+        bstrPath = nullptr;
+    }
+
+    if (pidl)
+    {
+        ::ILFree(pidl);
+        pidl = nullptr;
+    }
+
+    m_traceLogger.LogExit(__FUNCTION__, hr);
+
+    return hr;
 }
 
+/// <inheritdoc/>
+/// <remarks>
+/// A rename is a provider MoveFile within the item's folder. An item already holding the new name is only
+/// replaced with TSF_OVERWRITE_EXIST, and only once the rename succeeds; see <see cref="PrepareDestination"/>.
+/// </remarks>
 HRESULT __stdcall BigDriveTransferSource::RenameItem(
-    IShellItem* /*psi*/,
-    LPCWSTR /*pszNewName*/,
-    TRANSFER_SOURCE_FLAGS /*flags*/,
-    IShellItem** /*ppsiNew*/)
+    IShellItem* psi,
+    LPCWSTR pszNewName,
+    TRANSFER_SOURCE_FLAGS flags,
+    IShellItem** ppsiNew)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    HRESULT hr = S_OK;
+    PIDLIST_ABSOLUTE pidlSource = nullptr;
+    PIDLIST_ABSOLUTE pidlParent = nullptr;
+    BSTR bstrSource = nullptr;
+    BSTR bstrParent = nullptr;
+    BSTR bstrDestination = nullptr;
+    BSTR bstrName = nullptr;
+    BSTR bstrDisplaced = nullptr;
+    LPWSTR szSeparator = nullptr;
+    IBigDriveFileOperations* pFileOperations = nullptr;
+
+    m_traceLogger.LogEnter(__FUNCTION__);
+
+    if (ppsiNew)
+    {
+        *ppsiNew = nullptr;
+    }
+
+    if ((pszNewName == nullptr) || (*pszNewName == L'\0') || ::wcschr(pszNewName, L'\\'))
+    {
+        hr = E_INVALIDARG;
+        goto End;
+    }
+
+    hr = GetProviderPath(psi, FALSE, &pidlSource, bstrSource);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    // The new name goes in the folder the item is in; the drive's root is "\"
+    szSeparator = ::wcsrchr(bstrSource, L'\\');
+    if (szSeparator == nullptr)
+    {
+        hr = E_INVALIDARG;
+        goto End;
+    }
+
+    bstrParent = ::SysAllocStringLen(bstrSource, static_cast<UINT>((szSeparator == bstrSource) ? 1 : szSeparator - bstrSource));
+    if (bstrParent == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pidlParent = ::ILCloneFull(pidlSource);
+    if ((pidlParent == nullptr) || !::ILRemoveLastID(pidlParent))
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = BigDriveInterfaceProvider::GetFileOperations(m_driveGuid, S_OK, nullptr, &pFileOperations);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    hr = PrepareDestination(pFileOperations, bstrSource, bstrParent, pszNewName, flags, bstrName, bstrDestination, bstrDisplaced);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
+
+    BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileOperations::MoveFile");
+    hr = pFileOperations->MoveFile(m_driveGuid, bstrSource, bstrDestination);
+    BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileOperations::MoveFile", hr);
+
+    CompleteDestination(pFileOperations, bstrDisplaced, bstrDestination, hr);
+
+    if (FAILED(hr))
+    {
+        s_eventLogger.WriteErrorFormmated(L"RenameItem: Failed to rename '%s' to '%s'. HRESULT: 0x%08X", bstrSource, pszNewName, hr);
+        goto End;
+    }
+
+    NotifyParentChanged(pidlSource, bstrSource);
+
+    hr = CreateMovedItem(pidlSource, pidlParent, bstrName, ppsiNew);
+
+End:
+
+    if (pFileOperations)
+    {
+        pFileOperations->Release();
+        pFileOperations = nullptr;
+    }
+
+    if (bstrDisplaced)
+    {
+        ::SysFreeString(bstrDisplaced);
+        bstrDisplaced = nullptr;
+    }
+
+    if (bstrName)
+    {
+        ::SysFreeString(bstrName);
+        bstrName = nullptr;
+    }
+
+    if (bstrDestination)
+    {
+        ::SysFreeString(bstrDestination);
+        bstrDestination = nullptr;
+    }
+
+    if (bstrParent)
+    {
+        ::SysFreeString(bstrParent);
+        bstrParent = nullptr;
+    }
+
+    if (bstrSource)
+    {
+        ::SysFreeString(bstrSource);
+        bstrSource = nullptr;
+    }
+
+    if (pidlParent)
+    {
+        ::ILFree(pidlParent);
+        pidlParent = nullptr;
+    }
+
+    if (pidlSource)
+    {
+        ::ILFree(pidlSource);
+        pidlSource = nullptr;
+    }
+
+    m_traceLogger.LogExit(__FUNCTION__, hr);
+
+    return hr;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::LinkItem(
     IShellItem* /*psiSource*/,
     IShellItem* /*psiParentDest*/,
@@ -94,6 +457,7 @@ HRESULT __stdcall BigDriveTransferSource::LinkItem(
     return E_NOTIMPL;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::ApplyPropertiesToItem(
     IShellItem* /*psiSource*/,
     IShellItem** /*ppsiNew*/)
@@ -102,25 +466,33 @@ HRESULT __stdcall BigDriveTransferSource::ApplyPropertiesToItem(
     return E_NOTIMPL;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::GetDefaultDestinationName(
-    IShellItem* /*psiSource*/,
+    IShellItem* psiSource,
     IShellItem* /*psiParentDest*/,
-    LPWSTR* /*ppszDestinationName*/)
+    LPWSTR* ppszDestinationName)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    if ((psiSource == nullptr) || (ppszDestinationName == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    // Items keep their name wherever they are copied
+    return psiSource->GetDisplayName(SIGDN_PARENTRELATIVEPARSING, ppszDestinationName);
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::EnterFolder(
     IShellItem* /*psiChildFolderDest*/)
 {
-    // Not implemented
-    return E_NOTIMPL;
+    // Nothing to set up per folder
+    return S_OK;
 }
 
+/// <inheritdoc/>
 HRESULT __stdcall BigDriveTransferSource::LeaveFolder(
     IShellItem* /*psiChildFolderDest*/)
 {
-    // Not implemented
-    return E_NOTIMPL;
-}
\ No newline at end of file
+    // Nothing to set up per folder
+    return S_OK;
+}
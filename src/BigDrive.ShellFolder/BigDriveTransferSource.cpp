@@ -6,11 +6,16 @@
 #include "BigDriveTransferSource.h"
 
 #include "Logging\BigDriveShellFolderTraceLogger.h"
+#include "..\BigDrive.Client\BigDriveConfigurationClient.h"
+#include "..\BigDrive.Client\BigDriveInterfaceProvider.h"
+#include "..\BigDrive.Client\BigDriveListingCache.h"
 
 #include <shlwapi.h>
 
 #pragma comment(lib, "shlwapi.lib")
 
+BigDriveShellFolderEventLogger BigDriveTransferSource::s_eventLogger(L"BigDrive.ShellFolder");
+
 /// <summary>
 /// Constructor for BigDriveDataObject.
 /// </summary>
@@ -18,7 +23,7 @@
 /// <param name="cidl">Count of items.</param>
 /// <param name="apidl">Array of item IDs.</param>
 BigDriveTransferSource::BigDriveTransferSource(BigDriveShellFolder* pFolder)
-	: m_cRef(1), m_pFolder(pFolder)
+	: m_cRef(1), m_pFolder(pFolder), m_pSink(nullptr)
 {
 	m_traceLogger.Initialize(pFolder->GetDriveGuid());
 
@@ -36,6 +41,12 @@ BigDriveTransferSource::BigDriveTransferSource(BigDriveShellFolder* pFolder)
 /// </summary>
 BigDriveTransferSource::~BigDriveTransferSource()
 {
+	if (m_pSink)
+	{
+		m_pSink->Release();
+		m_pSink = nullptr;
+	}
+
 	// Release the folder object
 	if (m_pFolder)
 	{
@@ -50,4 +61,460 @@ HRESULT BigDriveTransferSource::PropertyFailure(IShellItem* psi, REFPROPERTYKEY
 {
 	// Implementation for handling property failures
 	return hr;
-}
\ No newline at end of file
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferSource::GetProviderPath(IShellItem* psi, BOOL fFolder, PIDLIST_ABSOLUTE* ppidl, BSTR& bstrPath)
+{
+	HRESULT hr = S_OK;
+	IPersist* pPersist = nullptr;
+	IParentAndItem* pParentAndItem = nullptr;
+	IShellFolder* pParent = nullptr;
+	CLSID clsid = GUID_NULL;
+
+	*ppidl = nullptr;
+	bstrPath = nullptr;
+
+	if (psi == nullptr)
+	{
+		hr = E_INVALIDARG;
+		goto End;
+	}
+
+	hr = ::SHGetIDListFromObject(psi, ppidl);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	// A folder on this drive, or an item in one, binds to a folder whose class is the drive
+	if (fFolder)
+	{
+		hr = psi->BindToHandler(nullptr, BHID_SFObject, IID_PPV_ARGS(&pPersist));
+	}
+	else if (SUCCEEDED(psi->QueryInterface(IID_PPV_ARGS(&pParentAndItem))) &&
+		SUCCEEDED(pParentAndItem->GetParentAndItem(nullptr, &pParent, nullptr)))
+	{
+		// The item already holds its parent folder; no need to bind down from the desktop again
+		hr = pParent->QueryInterface(IID_PPV_ARGS(&pPersist));
+	}
+	else
+	{
+		hr = ::SHBindToParent(*ppidl, IID_PPV_ARGS(&pPersist), nullptr);
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		hr = pPersist->GetClassID(&clsid);
+	}
+
+	if (FAILED(hr) || !IsEqualCLSID(clsid, m_driveGuid))
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_NOT_SAME_DEVICE);
+		goto End;
+	}
+
+	hr = BigDriveShellFolder::GetPathForProviders(*ppidl, bstrPath);
+
+End:
+
+	if (FAILED(hr) && *ppidl)
+	{
+		::ILFree(*ppidl);
+		*ppidl = nullptr;
+	}
+
+	if (pPersist)
+	{
+		pPersist->Release();
+		pPersist = nullptr;
+	}
+
+	if (pParent)
+	{
+		pParent->Release();
+		pParent = nullptr;
+	}
+
+	if (pParentAndItem)
+	{
+		pParentAndItem->Release();
+		pParentAndItem = nullptr;
+	}
+
+	return hr;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferSource::CreateMovedItem(PCIDLIST_ABSOLUTE pidlSource, PCIDLIST_ABSOLUTE pidlParent, LPCWSTR szName, IShellItem** ppsiNew)
+{
+	HRESULT hr = S_OK;
+	BigDriveItemIdView view = {};
+	BSTR bstrName = nullptr;
+	LPITEMIDLIST pidlChild = nullptr;
+
+	if (ppsiNew == nullptr)
+	{
+		goto End;
+	}
+
+	*ppsiNew = nullptr;
+
+	hr = BigDriveItemId::Decode(reinterpret_cast<const BYTE*>(::ILFindLastID(pidlSource)), view);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	bstrName = ::SysAllocString(szName);
+	if (bstrName == nullptr)
+	{
+		hr = E_OUTOFMEMORY;
+		goto End;
+	}
+
+	hr = BigDriveShellFolder::AllocBigDrivePidl(static_cast<BigDriveItemType>(view.uType), bstrName, &view.metadata, pidlChild);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	hr = ::SHCreateItemWithParent(pidlParent, nullptr, reinterpret_cast<PCUITEMID_CHILD>(pidlChild), IID_PPV_ARGS(ppsiNew));
+
+End:
+
+	if (pidlChild)
+	{
+		::CoTaskMemFree(pidlChild);
+		pidlChild = nullptr;
+	}
+
+	if (bstrName)
+	{
+		::SysFreeString(bstrName);
+		bstrName = nullptr;
+	}
+
+	return hr;
+}
+
+/// <inheritdoc />
+void BigDriveTransferSource::NotifyParentChanged(PCIDLIST_ABSOLUTE pidlItem, LPCWSTR szPath)
+{
+	WCHAR szParent[MAX_PATH] = {};
+	LPWSTR szSeparator = nullptr;
+	PIDLIST_ABSOLUTE pidlParent = nullptr;
+
+	::wcsncpy_s(szParent, szPath, _TRUNCATE);
+
+	// The drive's root is "\"
+	szSeparator = ::wcsrchr(szParent, L'\\');
+	if (szSeparator != nullptr)
+	{
+		szSeparator[(szSeparator == szParent) ? 1 : 0] = L'\0';
+	}
+
+	BigDriveListingCache::GetInstance().Invalidate(m_driveGuid, szParent);
+
+	pidlParent = ::ILCloneFull(pidlItem);
+	if (pidlParent && ::ILRemoveLastID(pidlParent))
+	{
+		::SHChangeNotify(SHCNE_UPDATEDIR, SHCNF_IDLIST, pidlParent, nullptr);
+	}
+
+	if (pidlParent)
+	{
+		::ILFree(pidlParent);
+		pidlParent = nullptr;
+	}
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferSource::CombineProviderPath(LPCWSTR szFolder, LPCWSTR szName, BSTR& bstrPath)
+{
+	WCHAR szPath[MAX_PATH] = {};
+	size_t cchFolder = ::wcslen(szFolder);
+
+	bstrPath = nullptr;
+
+	if (::_snwprintf_s(szPath, _countof(szPath), _TRUNCATE, L"%s%s%s", szFolder,
+		((cchFolder > 0) && (szFolder[cchFolder - 1] == L'\\')) ? L"" : L"\\", szName) < 0)
+	{
+		return HRESULT_FROM_WIN32(ERROR_FILENAME_EXCED_RANGE);
+	}
+
+	bstrPath = ::SysAllocString(szPath);
+
+	return (bstrPath != nullptr) ? S_OK : E_OUTOFMEMORY;
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferSource::PrepareDestination(IBigDriveFileOperations* pFileOperations, LPCWSTR szSource, BSTR bstrFolder, LPCWSTR szName,
+	TRANSFER_SOURCE_FLAGS flags, BSTR& bstrName, BSTR& bstrPath, BSTR& bstrDisplaced)
+{
+	HRESULT hr = S_OK;
+	SAFEARRAY* psaFolders = nullptr;
+	SAFEARRAY* psaFiles = nullptr;
+	WCHAR szUnique[MAX_PATH] = {};
+	WCHAR szGuid[40] = {};
+	GUID guid = GUID_NULL;
+	LPCWSTR szExtension = nullptr;
+	BOOL fExists = FALSE;
+
+	bstrName = nullptr;
+	bstrPath = nullptr;
+	bstrDisplaced = nullptr;
+
+	hr = CombineProviderPath(bstrFolder, szName, bstrPath);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	// Renaming an item to its own name in another case replaces nothing
+	if (::CompareStringOrdinal(szSource, -1, bstrPath, -1, TRUE) == CSTR_EQUAL)
+	{
+		goto Done;
+	}
+
+	hr = GetItemNames(bstrFolder, &psaFolders, &psaFiles);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	fExists = ContainsName(psaFolders, szName) || ContainsName(psaFiles, szName);
+
+	if (fExists && (flags & TSF_RENAME_EXIST))
+	{
+		// "Name (2).txt", "Name (3).txt", ... as Explorer names the copies it makes
+		szExtension = ::PathFindExtensionW(szName);
+
+		for (ULONG n = 2; fExists && (n <= MaxRenameAttempts); n++)
+		{
+			if (::_snwprintf_s(szUnique, _countof(szUnique), _TRUNCATE, L"%.*s (%lu)%s",
+				static_cast<int>(szExtension - szName), szName, n, szExtension) < 0)
+			{
+				hr = HRESULT_FROM_WIN32(ERROR_FILENAME_EXCED_RANGE);
+				goto End;
+			}
+
+			fExists = ContainsName(psaFolders, szUnique) || ContainsName(psaFiles, szUnique);
+		}
+
+		if (fExists)
+		{
+			hr = HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+			goto End;
+		}
+
+		szName = szUnique;
+
+		::SysFreeString(bstrPath);
+		bstrPath = nullptr;
+
+		hr = CombineProviderPath(bstrFolder, szName, bstrPath);
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+	}
+
+	if (fExists)
+	{
+		if (!(flags & TSF_OVERWRITE_EXIST))
+		{
+			hr = HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+			goto End;
+		}
+
+		// Providers don't replace an item in MoveFile, so the one being overwritten is moved aside to a
+		// name nothing else has; it is deleted only once the move has succeeded
+		hr = ::CoCreateGuid(&guid);
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+
+		if ((::StringFromGUID2(guid, szGuid, _countof(szGuid)) == 0) ||
+			(::_snwprintf_s(szUnique, _countof(szUnique), _TRUNCATE, L"~%s.tmp", szGuid) < 0))
+		{
+			hr = E_UNEXPECTED;
+			goto End;
+		}
+
+		hr = CombineProviderPath(bstrFolder, szUnique, bstrDisplaced);
+		if (FAILED(hr))
+		{
+			goto End;
+		}
+
+		BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileOperations::MoveFile");
+		hr = pFileOperations->MoveFile(m_driveGuid, bstrPath, bstrDisplaced);
+		BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileOperations::MoveFile", hr);
+		if (FAILED(hr))
+		{
+			s_eventLogger.WriteErrorFormmated(L"PrepareDestination: Failed to move '%s' aside to '%s'. HRESULT: 0x%08X", bstrPath, bstrDisplaced, hr);
+			goto End;
+		}
+	}
+
+Done:
+
+	bstrName = ::SysAllocString(szName);
+	if (bstrName == nullptr)
+	{
+		hr = E_OUTOFMEMORY;
+		goto End;
+	}
+
+End:
+
+	if (FAILED(hr) && bstrDisplaced)
+	{
+		::SysFreeString(bstrDisplaced);
+		bstrDisplaced = nullptr;
+	}
+
+	if (FAILED(hr) && bstrPath)
+	{
+		::SysFreeString(bstrPath);
+		bstrPath = nullptr;
+	}
+
+	if (psaFiles)
+	{
+		::SafeArrayDestroy(psaFiles);
+		psaFiles = nullptr;
+	}
+
+	if (psaFolders)
+	{
+		::SafeArrayDestroy(psaFolders);
+		psaFolders = nullptr;
+	}
+
+	return hr;
+}
+
+/// <inheritdoc />
+void BigDriveTransferSource::CompleteDestination(IBigDriveFileOperations* pFileOperations, BSTR bstrDisplaced, BSTR bstrPath, HRESULT hrMove)
+{
+	HRESULT hr = S_OK;
+
+	if (bstrDisplaced == nullptr)
+	{
+		return;
+	}
+
+	if (SUCCEEDED(hrMove))
+	{
+		BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileOperations::DeleteFile");
+		hr = pFileOperations->DeleteFile(m_driveGuid, bstrDisplaced);
+		BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileOperations::DeleteFile", hr);
+		if (FAILED(hr))
+		{
+			s_eventLogger.WriteErrorFormmated(L"CompleteDestination: Failed to delete the replaced item '%s'. HRESULT: 0x%08X", bstrDisplaced, hr);
+		}
+	}
+	else
+	{
+		BIGDRIVE_TRACE_PROVIDER_ENTER("IBigDriveFileOperations::MoveFile");
+		hr = pFileOperations->MoveFile(m_driveGuid, bstrDisplaced, bstrPath);
+		BIGDRIVE_TRACE_PROVIDER_EXIT("IBigDriveFileOperations::MoveFile", hr);
+		if (FAILED(hr))
+		{
+			s_eventLogger.WriteErrorFormmated(L"CompleteDestination: Failed to restore '%s' from '%s'. HRESULT: 0x%08X", bstrPath, bstrDisplaced, hr);
+		}
+	}
+}
+
+/// <inheritdoc />
+HRESULT BigDriveTransferSource::GetItemNames(BSTR bstrFolder, SAFEARRAY** ppsaFolders, SAFEARRAY** ppsaFiles)
+{
+	HRESULT hr = S_OK;
+	DriveConfiguration driveConfiguration;
+	BigDriveInterfaceProvider* pInterfaceProvider = nullptr;
+
+	*ppsaFolders = nullptr;
+	*ppsaFiles = nullptr;
+
+	hr = BigDriveConfigurationClient::GetDriveConfiguration(m_driveGuid, driveConfiguration);
+	if (FAILED(hr))
+	{
+		goto End;
+	}
+
+	pInterfaceProvider = new BigDriveInterfaceProvider(driveConfiguration);
+	if (pInterfaceProvider == nullptr)
+	{
+		hr = E_OUTOFMEMORY;
+		goto End;
+	}
+
+	// Asked of the provider rather than a cached listing, which may be older than the item it would overwrite
+	BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveEnumerate::EnumerateFolders");
+	hr = pInterfaceProvider->EnumerateFolders(bstrFolder, ppsaFolders);
+	BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveEnumerate::EnumerateFolders", hr);
+	if (FAILED(hr))
+	{
+		s_eventLogger.WriteErrorFormmated(L"GetItemNames: EnumerateFolders of '%s' failed. HRESULT: 0x%08X", bstrFolder, hr);
+		goto End;
+	}
+
+	BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER("IBigDriveEnumerate::EnumerateFiles");
+	hr = pInterfaceProvider->EnumerateFiles(bstrFolder, ppsaFiles);
+	BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT("IBigDriveEnumerate::EnumerateFiles", hr);
+	if (FAILED(hr))
+	{
+		s_eventLogger.WriteErrorFormmated(L"GetItemNames: EnumerateFiles of '%s' failed. HRESULT: 0x%08X", bstrFolder, hr);
+		goto End;
+	}
+
+End:
+
+	if (FAILED(hr) && *ppsaFolders)
+	{
+		::SafeArrayDestroy(*ppsaFolders);
+		*ppsaFolders = nullptr;
+	}
+
+	if (pInterfaceProvider)
+	{
+		delete pInterfaceProvider;
+		pInterfaceProvider = nullptr;
+	}
+
+	return hr;
+}
+
+/// <inheritdoc />
+BOOL BigDriveTransferSource::ContainsName(SAFEARRAY* psaNames, LPCWSTR szName)
+{
+	BSTR* pNames = nullptr;
+	LONG lowerBound = 0;
+	LONG upperBound = -1;
+	BOOL fFound = FALSE;
+
+	if ((psaNames == nullptr) || FAILED(::SafeArrayAccessData(psaNames, reinterpret_cast<void**>(&pNames))))
+	{
+		return FALSE;
+	}
+
+	::SafeArrayGetLBound(psaNames, 1, &lowerBound);
+	::SafeArrayGetUBound(psaNames, 1, &upperBound);
+
+	// Names on a drive compare as Windows file names do, ignoring case
+	for (LONG i = 0; i <= upperBound - lowerBound; i++)
+	{
+		if ((pNames[i] != nullptr) && (::CompareStringOrdinal(pNames[i], -1, szName, -1, TRUE) == CSTR_EQUAL))
+		{
+			fFound = TRUE;
+			break;
+		}
+	}
+
+	::SafeArrayUnaccessData(psaNames);
+
+	return fFound;
+}
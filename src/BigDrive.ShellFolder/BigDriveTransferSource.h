@@ -8,16 +8,27 @@
 #include <ShlObj.h>
 #include <objidl.h>
 #include "BigDriveShellFolder.h"
+#include "..\BigDrive.Client\Interfaces\IBigDriveFileOperations.h"
 
 /// <summary>
 /// Implements the ITransferSource interface to support file operations in the BigDrive shell namespace.
 /// This interface is used by the shell to perform file transfer operations such as copying and moving items.
+/// OpenItem hands the copy engine the file's stream from <see cref="BigDriveShellFolder::BindToStorage"/>, so
+/// copies out of the drive run through the engine's own pipelining and progress; moves within the drive,
+/// renames, and deletes map onto the provider's IBigDriveFileOperations.
 /// </summary>
 class BigDriveTransferSource : public ITransferSource
 {
 
 private:
 
+    /// <summary>
+    /// Largest number tried when TSF_RENAME_EXIST looks for a free "Name (n)".
+    /// </summary>
+    static const ULONG MaxRenameAttempts = 999;
+
+    static BigDriveShellFolderEventLogger s_eventLogger;
+
     /// <summary>
     /// Reference count for COM object lifetime management.
     /// </summary>
@@ -38,6 +49,11 @@ private:
     /// </summary>
     GUID m_driveGuid;
 
+    /// <summary>
+    /// The sink registered with Advise, or nullptr. AddRef'd.
+    /// </summary>
+    ITransferAdviseSink* m_pSink;
+
 public:
 
     /// <summary>
@@ -203,4 +219,86 @@ private:
     /// <param name="hrFailure">The HRESULT of the failure.</param>
     /// <returns>HRESULT indicating success or failure.</returns>
     HRESULT PropertyFailure(IShellItem* psi, REFPROPERTYKEY key, HRESULT hrFailure);
+
+    /// <summary>
+    /// Retrieves the absolute PIDL of an item and its path as passed to providers, checking it is on this drive.
+    /// </summary>
+    /// <param name="psi">The shell item.</param>
+    /// <param name="fFolder">TRUE if the item is a folder the caller will put items in; FALSE for an item to act on.</param>
+    /// <param name="ppidl">Receives the absolute PIDL of the item. Free with ILFree.</param>
+    /// <param name="bstrPath">Receives the path of the item. Free with SysFreeString.</param>
+    /// <returns>S_OK on success; HRESULT_FROM_WIN32(ERROR_NOT_SAME_DEVICE) if the item is not on this drive; otherwise, an HRESULT error code.</returns>
+    HRESULT GetProviderPath(IShellItem* psi, BOOL fFolder, PIDLIST_ABSOLUTE* ppidl, BSTR& bstrPath);
+
+    /// <summary>
+    /// Creates the shell item for an item moved or renamed by the provider, carrying over the type and metadata of the source item.
+    /// </summary>
+    /// <param name="pidlSource">Absolute PIDL of the item before the move.</param>
+    /// <param name="pidlParent">Absolute PIDL of the folder the item is now in.</param>
+    /// <param name="szName">The name of the item now.</param>
+    /// <param name="ppsiNew">Receives the shell item; may be nullptr if the caller doesn't want it.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT CreateMovedItem(PCIDLIST_ABSOLUTE pidlSource, PCIDLIST_ABSOLUTE pidlParent, LPCWSTR szName, IShellItem** ppsiNew);
+
+    /// <summary>
+    /// Drops the cached listing of the folder an item is in and tells the shell the folder changed.
+    /// </summary>
+    /// <param name="pidlItem">Absolute PIDL of the item.</param>
+    /// <param name="szPath">Path of the item, as passed to providers.</param>
+    void NotifyParentChanged(PCIDLIST_ABSOLUTE pidlItem, LPCWSTR szPath);
+
+    /// <summary>
+    /// Joins a folder path and a name, as passed to providers.
+    /// </summary>
+    /// <param name="szFolder">The folder.</param>
+    /// <param name="szName">The name.</param>
+    /// <param name="bstrPath">Receives the path. Free with SysFreeString.</param>
+    /// <returns>S_OK on success; E_OUTOFMEMORY; or HRESULT_FROM_WIN32(ERROR_FILENAME_EXCED_RANGE) if the path is too long.</returns>
+    static HRESULT CombineProviderPath(LPCWSTR szFolder, LPCWSTR szName, BSTR& bstrPath);
+
+    /// <summary>
+    /// Decides where an item moved or renamed into a folder goes, as the TRANSFER_SOURCE_FLAGS of the call ask.
+    /// When an item of that name exists, TSF_OVERWRITE_EXIST moves it aside to a temporary name and
+    /// TSF_RENAME_EXIST picks a free "Name (n)"; otherwise the move fails. An item moved aside is only
+    /// deleted by <see cref="CompleteDestination"/> once the move has succeeded.
+    /// </summary>
+    /// <param name="pFileOperations">The provider's file operations, to move aside an item being overwritten.</param>
+    /// <param name="szSource">Path of the item being moved, as passed to providers.</param>
+    /// <param name="bstrFolder">The destination folder, as passed to providers.</param>
+    /// <param name="szName">The name asked for.</param>
+    /// <param name="flags">The flags of the move or rename.</param>
+    /// <param name="bstrName">Receives the name the item will have. Free with SysFreeString.</param>
+    /// <param name="bstrPath">Receives the path the item will have. Free with SysFreeString.</param>
+    /// <param name="bstrDisplaced">Receives the temporary path of the item being overwritten, or nullptr if there is none. Free with SysFreeString.</param>
+    /// <returns>S_OK on success; HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS) if the name is taken and may not be replaced; otherwise, an HRESULT error code.</returns>
+    HRESULT PrepareDestination(IBigDriveFileOperations* pFileOperations, LPCWSTR szSource, BSTR bstrFolder, LPCWSTR szName,
+        TRANSFER_SOURCE_FLAGS flags, BSTR& bstrName, BSTR& bstrPath, BSTR& bstrDisplaced);
+
+    /// <summary>
+    /// Finishes the overwrite <see cref="PrepareDestination"/> started: deletes the item moved aside if the
+    /// move succeeded, or moves it back to its name if the move failed. Does nothing if no item was moved aside.
+    /// A failure here is logged, not returned; the result of the move stands.
+    /// </summary>
+    /// <param name="pFileOperations">The provider's file operations.</param>
+    /// <param name="bstrDisplaced">The temporary path of the item moved aside, or nullptr.</param>
+    /// <param name="bstrPath">The path the item had, and the moved item now has.</param>
+    /// <param name="hrMove">The result of the move.</param>
+    void CompleteDestination(IBigDriveFileOperations* pFileOperations, BSTR bstrDisplaced, BSTR bstrPath, HRESULT hrMove);
+
+    /// <summary>
+    /// Asks the provider for the names of the folders and files in a folder.
+    /// </summary>
+    /// <param name="bstrFolder">The folder, as passed to providers.</param>
+    /// <param name="ppsaFolders">Receives the folder names. Free with SafeArrayDestroy.</param>
+    /// <param name="ppsaFiles">Receives the file names. Free with SafeArrayDestroy.</param>
+    /// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
+    HRESULT GetItemNames(BSTR bstrFolder, SAFEARRAY** ppsaFolders, SAFEARRAY** ppsaFiles);
+
+    /// <summary>
+    /// Determines whether a list of names holds a name, ignoring case.
+    /// </summary>
+    /// <param name="psaNames">SAFEARRAY of BSTR names; may be nullptr.</param>
+    /// <param name="szName">The name.</param>
+    /// <returns>TRUE if the name is in the list.</returns>
+    static BOOL ContainsName(SAFEARRAY* psaNames, LPCWSTR szName);
 };
\ No newline at end of file
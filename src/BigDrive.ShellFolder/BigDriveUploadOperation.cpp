@@ -0,0 +1,352 @@
+// <copyright file="BigDriveUploadOperation.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Implements the BigDriveUploadOperation class, the progress and failure reporting side of
+//   a drop onto a BigDrive folder.
+// </summary>
+
+#include "pch.h"
+
+#include "BigDriveUploadOperation.h"
+#include "..\BigDrive.Client\BigDriveListingCache.h"
+#include "..\BigDrive.Client\BigDriveTransferEngine.h"
+#include <objbase.h>
+#include <wchar.h>
+
+BigDriveShellFolderEventLogger BigDriveUploadOperation::s_eventLogger(L"BigDrive.ShellFolder");
+
+/// <inheritdoc />
+BigDriveUploadOperation::BigDriveUploadOperation()
+    : m_refCount(1), m_pUpload(nullptr), m_pBatch(nullptr), m_pidlFolder(nullptr), m_hwndOwner(nullptr)
+{
+}
+
+/// <inheritdoc />
+BigDriveUploadOperation::~BigDriveUploadOperation()
+{
+    if (m_pidlFolder)
+    {
+        ::ILFree(m_pidlFolder);
+        m_pidlFolder = nullptr;
+    }
+
+    if (m_pBatch)
+    {
+        m_pBatch->Release();
+        m_pBatch = nullptr;
+    }
+
+    if (m_pUpload)
+    {
+        m_pUpload->Release();
+        m_pUpload = nullptr;
+    }
+}
+
+/// <inheritdoc />
+HRESULT BigDriveUploadOperation::Start(BigDriveTreeUpload* pUpload, PCIDLIST_ABSOLUTE pidlFolder, HWND hwndOwner)
+{
+    HRESULT hr = S_OK;
+    BigDriveUploadOperation* pOperation = nullptr;
+    HANDLE hThread = nullptr;
+
+    if ((pUpload == nullptr) || (pidlFolder == nullptr))
+    {
+        return E_INVALIDARG;
+    }
+
+    pOperation = new BigDriveUploadOperation();
+    if (pOperation == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pOperation->m_pidlFolder = ::ILCloneFull(pidlFolder);
+    if (pOperation->m_pidlFolder == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    pOperation->m_hwndOwner = hwndOwner;
+
+    pOperation->m_pUpload = pUpload;
+    pOperation->m_pUpload->AddRef();
+
+    pOperation->m_pBatch = pUpload->GetBatch();
+    pOperation->m_pBatch->AddRef();
+
+    // Open, so the dropped files start uploading while the dropped folders are still being walked
+    hr = BigDriveTransferEngine::GetInstance().SubmitOpen(pOperation->m_pBatch);
+    if (FAILED(hr))
+    {
+        s_eventLogger.WriteErrorFormmated(L"Start: Failed to submit the upload. HRESULT: 0x%08X", hr);
+        goto End;
+    }
+
+    hr = pUpload->Start();
+    if (FAILED(hr))
+    {
+        s_eventLogger.WriteErrorFormmated(L"Start: Failed to walk the dropped folders. HRESULT: 0x%08X", hr);
+        pOperation->m_pBatch->Seal();
+        goto End;
+    }
+
+    // The thread takes the reference; the files are uploaded whether or not it runs. Not a thread
+    // pool thread, since it shows windows and pumps their messages for as long as the upload lasts.
+    hThread = ::CreateThread(nullptr, 0, FollowThreadProc, pOperation, 0, nullptr);
+    if (hThread == nullptr)
+    {
+        s_eventLogger.WriteErrorFormmated(L"Start: Uploading without progress. HRESULT: 0x%08X", HRESULT_FROM_WIN32(::GetLastError()));
+        goto End;
+    }
+
+    ::CloseHandle(hThread);
+    pOperation = nullptr;
+
+End:
+
+    if (pOperation)
+    {
+        pOperation->Release();
+        pOperation = nullptr;
+    }
+
+    return hr;
+}
+
+/// <inheritdoc />
+ULONG BigDriveUploadOperation::AddRef()
+{
+    return ::InterlockedIncrement(&m_refCount);
+}
+
+/// <inheritdoc />
+ULONG BigDriveUploadOperation::Release()
+{
+    ULONG res = ::InterlockedDecrement(&m_refCount);
+    if (res == 0) delete this;
+    return res;
+}
+
+/// <inheritdoc />
+DWORD WINAPI BigDriveUploadOperation::FollowThreadProc(LPVOID pParameter)
+{
+    BigDriveUploadOperation* pThis = static_cast<BigDriveUploadOperation*>(pParameter);
+
+    pThis->Follow();
+    pThis->Release();
+
+    return 0;
+}
+
+/// <inheritdoc />
+void BigDriveUploadOperation::Follow()
+{
+    HRESULT hr = S_OK;
+    HRESULT hrCoInit = S_OK;
+    BigDriveTransferBatch* pRetry = nullptr;
+
+    // The progress dialog is apartment threaded, and its messages are dispatched on this thread
+    hrCoInit = ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+    ShowProgress();
+    LogSkippedFolders();
+
+    while (TRUE)
+    {
+        RefreshFolder();
+
+        if (!ReportFailures())
+        {
+            break;
+        }
+
+        hr = m_pBatch->CreateRetryBatch(&pRetry);
+        if (hr != S_OK)
+        {
+            break;
+        }
+
+        hr = BigDriveTransferEngine::GetInstance().Submit(pRetry);
+        if (FAILED(hr))
+        {
+            s_eventLogger.WriteErrorFormmated(L"Follow: Failed to submit the retry. HRESULT: 0x%08X", hr);
+            break;
+        }
+
+        m_pBatch->Release();
+        m_pBatch = pRetry;
+        pRetry = nullptr;
+
+        ShowProgress();
+    }
+
+    if (pRetry)
+    {
+        pRetry->Release();
+        pRetry = nullptr;
+    }
+
+    if (SUCCEEDED(hrCoInit))
+    {
+        ::CoUninitialize();
+    }
+}
+
+/// <inheritdoc />
+void BigDriveUploadOperation::ShowProgress()
+{
+    HRESULT hr = S_OK;
+    IOperationsProgressDialog* pDialog = nullptr;
+    PDOPSTATUS status = PDOPS_RUNNING;
+    ULONG count = 0;
+    ULONGLONG cbTotal = 0;
+    ULONG succeeded = 0;
+    ULONG failed = 0;
+    ULONG cancelled = 0;
+    ULONGLONG cbDone = 0;
+    ULONGLONG cbSkipped = 0;
+    ULONG done = 0;
+    HANDLE hDone = m_pBatch->GetDoneEvent();
+    DWORD index = 0;
+
+    hr = ::CoCreateInstance(CLSID_ProgressDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pDialog));
+    if (SUCCEEDED(hr))
+    {
+        hr = pDialog->StartProgressDialog(GetOwner(), OPPROGDLG_DEFAULT);
+    }
+
+    if (FAILED(hr))
+    {
+        s_eventLogger.WriteErrorFormmated(L"ShowProgress: Uploading without a progress dialog. HRESULT: 0x%08X", hr);
+        m_pBatch->Wait(INFINITE);
+        goto End;
+    }
+
+    pDialog->SetOperation(SPACTION_UPLOADING);
+    pDialog->SetMode(PDM_RUN);
+
+    // Pumps the dialog's messages between updates; it has no callback for cancel, so the status is read each time
+    while (::CoWaitForMultipleHandles(COWAIT_DISPATCH_WINDOW_MESSAGES | COWAIT_DISPATCH_CALLS, ProgressIntervalMs, 1, &hDone, &index) == RPC_S_CALLPENDING)
+    {
+        // The totals grow while dropped folders are still being walked
+        count = m_pBatch->GetCount();
+        cbTotal = m_pBatch->GetTotalSize();
+
+        m_pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+        cbSkipped = m_pBatch->GetSkippedSize();
+        done = succeeded + failed + cancelled;
+
+        // Files the size couldn't be read for count for nothing, so fall back to files when none could.
+        // Failed files move the bar on but aren't counted as copied.
+        if (cbTotal > 0)
+        {
+            pDialog->UpdateProgress(cbDone + cbSkipped, cbTotal, cbDone, cbTotal - cbSkipped, done, count);
+        }
+        else
+        {
+            pDialog->UpdateProgress(done, count, 0, 0, done, count);
+        }
+
+        if (SUCCEEDED(pDialog->GetOperationStatus(&status)) && (status == PDOPS_CANCELLED))
+        {
+            m_pBatch->Cancel();
+        }
+    }
+
+    pDialog->StopProgressDialog();
+
+End:
+
+    if (pDialog)
+    {
+        pDialog->Release();
+        pDialog = nullptr;
+    }
+}
+
+/// <inheritdoc />
+void BigDriveUploadOperation::LogSkippedFolders()
+{
+    HRESULT hrFirst = S_OK;
+    ULONG skipped = m_pUpload->GetSkippedFolders(hrFirst);
+
+    if (skipped > 0)
+    {
+        s_eventLogger.WriteErrorFormmated(L"LogSkippedFolders: %u dropped folders could not be read and were not copied. HRESULT: 0x%08X", skipped, hrFirst);
+    }
+}
+
+/// <inheritdoc />
+void BigDriveUploadOperation::RefreshFolder()
+{
+    // Even a partial upload changes the folder
+    BigDriveListingCache::GetInstance().Invalidate(m_pBatch->GetDriveGuid(), m_pBatch->GetTargetPath());
+
+    ::SHChangeNotify(SHCNE_UPDATEDIR, SHCNF_IDLIST, m_pidlFolder, nullptr);
+}
+
+/// <inheritdoc />
+BOOL BigDriveUploadOperation::ReportFailures()
+{
+    WCHAR szMessage[4096] = {};
+    size_t cchMessage = 0;
+    BigDriveTransferItem item = {};
+    ULONG succeeded = 0;
+    ULONG failed = 0;
+    ULONG cancelled = 0;
+    ULONGLONG cbDone = 0;
+    ULONG listed = 0;
+
+    m_pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+    if (failed == 0)
+    {
+        return FALSE;
+    }
+
+    ::_snwprintf_s(szMessage, _countof(szMessage), _TRUNCATE, L"%u of %u files could not be copied to BigDrive:\n\n", failed, m_pBatch->GetCount());
+
+    for (ULONG i = 0; i < m_pBatch->GetCount(); i++)
+    {
+        if (FAILED(m_pBatch->GetItem(i, item)) || SUCCEEDED(item.hr) || (item.hr == HRESULT_FROM_WIN32(ERROR_CANCELLED)))
+        {
+            continue;
+        }
+
+        s_eventLogger.WriteErrorFormmated(L"ReportFailures: Failed to copy file '%s' to BigDrive after %u attempts. HRESULT: 0x%08X", item.szLocalPath ? item.szLocalPath : item.szName, item.attempts, item.hr);
+
+        if (listed < MaxListedFailures)
+        {
+            cchMessage = ::wcslen(szMessage);
+            ::_snwprintf_s(szMessage + cchMessage, _countof(szMessage) - cchMessage, _TRUNCATE, L"%s (0x%08X)\n", item.szLocalPath ? item.szLocalPath : item.szName, item.hr);
+            listed++;
+        }
+    }
+
+    cchMessage = ::wcslen(szMessage);
+    if (failed > listed)
+    {
+        ::_snwprintf_s(szMessage + cchMessage, _countof(szMessage) - cchMessage, _TRUNCATE, L"...and %u more.\n\nRetry the failed files?", failed - listed);
+    }
+    else
+    {
+        ::_snwprintf_s(szMessage + cchMessage, _countof(szMessage) - cchMessage, _TRUNCATE, L"\nRetry the failed files?");
+    }
+
+    return ::MessageBoxW(GetOwner(), szMessage, L"BigDrive", MB_RETRYCANCEL | MB_ICONWARNING | MB_SETFOREGROUND) == IDRETRY;
+}
+
+/// <inheritdoc />
+HWND BigDriveUploadOperation::GetOwner()
+{
+    // The view may have been closed while the files were uploading
+    if ((m_hwndOwner != nullptr) && ::IsWindow(m_hwndOwner))
+    {
+        return m_hwndOwner;
+    }
+
+    return nullptr;
+}
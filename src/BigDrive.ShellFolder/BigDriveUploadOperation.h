@@ -0,0 +1,122 @@
+// <copyright file="BigDriveUploadOperation.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+// <summary>
+//   Declares the BigDriveUploadOperation class, which shows the progress of files dropped
+//   on a BigDrive folder while the transfer engine uploads them.
+// </summary>
+
+#pragma once
+
+#include <shlobj.h>
+#include <shobjidl.h>
+
+#include "..\BigDrive.Client\BigDriveTransferBatch.h"
+#include "..\BigDrive.Client\BigDriveTreeUpload.h"
+#include "BigDriveShellFolderEventLogger.h"
+
+/// <summary>
+/// Follows a dropped batch of files from a thread of its own, so the drop returns to Explorer
+/// at once. Shows an IOperationsProgressDialog owned by the window the files were dropped on
+/// while the <see cref="BigDriveTransferEngine"/> uploads the files, and while the
+/// <see cref="BigDriveTreeUpload"/> is still finding the files of dropped folders; cancelling the
+/// dialog cancels the batch. When the batch is done the folder is refreshed and, if any file
+/// failed, the failures are listed with the option to retry them. The thread is a single threaded
+/// apartment that dispatches window messages the whole time it shows either.
+/// </summary>
+class BigDriveUploadOperation
+{
+public:
+
+    /// <summary>
+    /// Milliseconds between progress updates.
+    /// </summary>
+    static const DWORD ProgressIntervalMs = 250;
+
+    /// <summary>
+    /// Maximum number of failed files named in the summary.
+    /// </summary>
+    static const ULONG MaxListedFailures = 10;
+
+private:
+
+    static BigDriveShellFolderEventLogger s_eventLogger;
+
+    LONG m_refCount;
+    BigDriveTreeUpload* m_pUpload;          // Feeds the first batch; AddRef'd
+    BigDriveTransferBatch* m_pBatch;        // The batch being followed; AddRef'd
+    PIDLIST_ABSOLUTE m_pidlFolder;          // The folder the files are copied to
+    HWND m_hwndOwner;                       // Owns the progress dialog and the summary, or nullptr
+
+    /// <summary>
+    /// Default constructor. Use <see cref="Start"/>.
+    /// </summary>
+    BigDriveUploadOperation();
+
+    /// <summary>
+    /// Releases the upload and the batch and frees the folder PIDL.
+    /// </summary>
+    ~BigDriveUploadOperation();
+
+public:
+
+    /// <summary>
+    /// Submits the upload's batch to the transfer engine, starts walking the dropped folders into
+    /// it, and follows it on a thread of its own.
+    /// </summary>
+    /// <param name="pUpload">The upload, not yet started.</param>
+    /// <param name="pidlFolder">Absolute PIDL of the folder the files are copied to.</param>
+    /// <param name="hwndOwner">The window the files were dropped on, which owns the progress dialog and the summary, or nullptr.</param>
+    /// <returns>S_OK if the batch was submitted; otherwise, an HRESULT error code.</returns>
+    static HRESULT Start(BigDriveTreeUpload* pUpload, PCIDLIST_ABSOLUTE pidlFolder, HWND hwndOwner);
+
+    /// <summary>
+    /// Increments the reference count.
+    /// </summary>
+    ULONG AddRef();
+
+    /// <summary>
+    /// Decrements the reference count and deletes the object if it reaches zero.
+    /// </summary>
+    ULONG Release();
+
+private:
+
+    /// <summary>
+    /// Thread procedure that runs <see cref="Follow"/> and drops the thread's reference.
+    /// </summary>
+    static DWORD WINAPI FollowThreadProc(LPVOID pParameter);
+
+    /// <summary>
+    /// Shows progress until the batch is done, refreshes the folder, and reports failures,
+    /// submitting a batch of the failed files for as long as the user asks to retry.
+    /// </summary>
+    void Follow();
+
+    /// <summary>
+    /// Shows the progress dialog until the batch is done, dispatching window messages while it
+    /// waits and cancelling the batch if the user cancels the dialog. Without a dialog it just waits.
+    /// </summary>
+    void ShowProgress();
+
+    /// <summary>
+    /// Logs the dropped folders that couldn't be listed, whose files weren't uploaded.
+    /// </summary>
+    void LogSkippedFolders();
+
+    /// <summary>
+    /// Drops the cached listing of the folder and tells the shell it changed.
+    /// </summary>
+    void RefreshFolder();
+
+    /// <summary>
+    /// Logs the failed files and lists them to the user in a message box owned by the drop window.
+    /// </summary>
+    /// <returns>TRUE if files failed and the user chose to retry them; otherwise, FALSE.</returns>
+    BOOL ReportFailures();
+
+    /// <summary>
+    /// Gets the window the files were dropped on, or nullptr if there was none or it has since been closed.
+    /// </summary>
+    HWND GetOwner();
+};
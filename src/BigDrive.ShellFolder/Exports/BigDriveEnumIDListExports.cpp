@@ -75,4 +75,10 @@ extern "C" {
         return pEnum->Add(pidl);
     }
 
+    HRESULT BigDriveEnumIDList_AddItem(BigDriveEnumIDList* pEnum, UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata)
+    {
+        if (!pEnum) return E_POINTER;
+        return pEnum->AddItem(uType, szName, cchName, pMetadata);
+    }
+
 } // extern "C"
\ No newline at end of file
@@ -25,6 +25,7 @@ extern "C" {
     __declspec(dllexport) HRESULT BigDriveEnumIDList_Clone(BigDriveEnumIDList* pEnum, IEnumIDList** ppenum);
 
     __declspec(dllexport) HRESULT BigDriveEnumIDList_Add(BigDriveEnumIDList* pEnum, LPITEMIDLIST pidl);
+    __declspec(dllexport) HRESULT BigDriveEnumIDList_AddItem(BigDriveEnumIDList* pEnum, UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata);
 
 #ifdef __cplusplus
 }
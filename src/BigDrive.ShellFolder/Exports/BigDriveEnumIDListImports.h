@@ -25,6 +25,7 @@ extern "C" {
     __declspec(dllimport) HRESULT BigDriveEnumIDList_Clone(BigDriveEnumIDList* pEnum, IEnumIDList** ppenum);
 
     __declspec(dllimport) HRESULT BigDriveEnumIDList_Add(BigDriveEnumIDList* pEnum, LPITEMIDLIST pidl);
+    __declspec(dllimport) HRESULT BigDriveEnumIDList_AddItem(BigDriveEnumIDList* pEnum, UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata);
 
 #ifdef __cplusplus
 }
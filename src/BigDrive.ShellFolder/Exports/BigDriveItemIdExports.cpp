@@ -0,0 +1,44 @@
+// <copyright file="BigDriveItemIdExports.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "BigDriveItemIdExports.h"
+
+extern "C" {
+
+    HRESULT EncodeBigDriveItemIdExport(BYTE* pBuffer, size_t cbBuffer, UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata, USHORT* pcbItem)
+    {
+        if (pcbItem == nullptr)
+        {
+            return E_POINTER;
+        }
+
+        return BigDriveItemId::Encode(pBuffer, cbBuffer, uType, szName, cchName, pMetadata, *pcbItem);
+    }
+
+    HRESULT DecodeBigDriveItemIdExport(const BYTE* pItem, BigDriveItemIdView* pView)
+    {
+        if (pView == nullptr)
+        {
+            return E_POINTER;
+        }
+
+        return BigDriveItemId::Decode(pItem, *pView);
+    }
+
+    HRESULT AllocBigDrivePidlWithMetadataExport(BigDriveItemType nType, BSTR bstrName, const BigDriveItemMetadata* pMetadata, LPITEMIDLIST* ppidl)
+    {
+        if (ppidl == nullptr)
+        {
+            return E_POINTER;
+        }
+
+        return BigDriveShellFolder::AllocBigDrivePidl(nType, bstrName, pMetadata, *ppidl);
+    }
+
+    BOOL IsValidBigDriveItemIdExport(PCUIDLIST_RELATIVE pidl)
+    {
+        return BigDriveShellFolder::IsValidBigDriveItemId(pidl) ? TRUE : FALSE;
+    }
+}
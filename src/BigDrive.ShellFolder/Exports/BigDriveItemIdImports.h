@@ -0,0 +1,36 @@
+// <copyright file="BigDriveItemIdImports.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include "..\BigDriveShellFolder.h"
+#include "..\BigDriveItemId.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /// <summary>
+    /// Encodes a single BIGDRIVE_ITEMID, optionally with a metadata block.
+    /// </summary>
+    __declspec(dllimport) HRESULT EncodeBigDriveItemIdExport(BYTE* pBuffer, size_t cbBuffer, UINT uType, LPCWSTR szName, size_t cchName, const BigDriveItemMetadata* pMetadata, USHORT* pcbItem);
+
+    /// <summary>
+    /// Decodes and validates a single BIGDRIVE_ITEMID.
+    /// </summary>
+    __declspec(dllimport) HRESULT DecodeBigDriveItemIdExport(const BYTE* pItem, BigDriveItemIdView* pView);
+
+    /// <summary>
+    /// Allocates a PIDL for a path whose last item carries the given metadata.
+    /// </summary>
+    __declspec(dllimport) HRESULT AllocBigDrivePidlWithMetadataExport(BigDriveItemType nType, BSTR bstrName, const BigDriveItemMetadata* pMetadata, LPITEMIDLIST* ppidl);
+
+    /// <summary>
+    /// Returns TRUE if the item is a well formed BIGDRIVE_ITEMID.
+    /// </summary>
+    __declspec(dllimport) BOOL IsValidBigDriveItemIdExport(PCUIDLIST_RELATIVE pidl);
+
+#ifdef __cplusplus
+}
+#endif
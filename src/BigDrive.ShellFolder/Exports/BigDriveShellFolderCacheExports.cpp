@@ -0,0 +1,118 @@
+// <copyright file="BigDriveShellFolderCacheExports.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "BigDriveShellFolderCacheExports.h"
+
+#include <crtdbg.h>
+
+#include "..\BigDriveShellFolder.h"
+#include "..\BigDriveShellFolderCache.h"
+
+/// <summary>
+/// Reaches the folder's reference count and final Release for the exports below.
+/// </summary>
+struct BigDriveShellFolderCacheTestHooks
+{
+    static LONG BeginFinalRelease(BigDriveShellFolder* pFolder)
+    {
+        return ::InterlockedDecrement(&pFolder->m_refCount);
+    }
+
+    static void EndFinalRelease(BigDriveShellFolder* pFolder)
+    {
+        pFolder->FinalRelease();
+    }
+};
+
+namespace
+{
+    volatile LONG s_heapAllocations = 0;
+
+#ifdef _DEBUG
+    _CRT_ALLOC_HOOK s_pfnPreviousAllocHook = nullptr;
+
+    int __cdecl CountingAllocHook(int allocType, void* pUserData, size_t size, int blockType, long requestNumber, const unsigned char* szFileName, int lineNumber)
+    {
+        if ((allocType == _HOOK_ALLOC) || (allocType == _HOOK_REALLOC))
+        {
+            ::InterlockedIncrement(&s_heapAllocations);
+        }
+
+        return TRUE;
+    }
+#endif
+}
+
+extern "C" {
+
+    HRESULT CreateBigDriveShellFolderExport(CLSID driveGuid, LPCITEMIDLIST pidlAbsolute, IShellFolder** ppFolder)
+    {
+        HRESULT hr = S_OK;
+        BigDriveShellFolder* pFolder = nullptr;
+
+        if (ppFolder == nullptr)
+        {
+            return E_POINTER;
+        }
+
+        *ppFolder = nullptr;
+
+        hr = BigDriveShellFolder::Create(driveGuid, nullptr, pidlAbsolute, &pFolder);
+        if (SUCCEEDED(hr))
+        {
+            *ppFolder = static_cast<IShellFolder*>(pFolder);
+        }
+
+        return hr;
+    }
+
+    void GetShellFolderCacheStatisticsExport(LONG* pHits, LONG* pMisses)
+    {
+        LONG hits = 0;
+        LONG misses = 0;
+
+        BigDriveShellFolderCache::GetInstance().GetStatistics(hits, misses);
+
+        if (pHits)
+        {
+            *pHits = hits;
+        }
+
+        if (pMisses)
+        {
+            *pMisses = misses;
+        }
+    }
+
+    LONG BeginFinalReleaseExport(IShellFolder* pFolder)
+    {
+        return BigDriveShellFolderCacheTestHooks::BeginFinalRelease(static_cast<BigDriveShellFolder*>(pFolder));
+    }
+
+    void EndFinalReleaseExport(IShellFolder* pFolder)
+    {
+        BigDriveShellFolderCacheTestHooks::EndFinalRelease(static_cast<BigDriveShellFolder*>(pFolder));
+    }
+
+    BOOL StartHeapAllocationCountExport()
+    {
+#ifdef _DEBUG
+        ::InterlockedExchange(&s_heapAllocations, 0);
+        s_pfnPreviousAllocHook = ::_CrtSetAllocHook(CountingAllocHook);
+        return TRUE;
+#else
+        return FALSE;
+#endif
+    }
+
+    LONG StopHeapAllocationCountExport()
+    {
+#ifdef _DEBUG
+        ::_CrtSetAllocHook(s_pfnPreviousAllocHook);
+        s_pfnPreviousAllocHook = nullptr;
+#endif
+        return ::InterlockedCompareExchange(&s_heapAllocations, 0, 0);
+    }
+}
@@ -0,0 +1,48 @@
+// <copyright file="BigDriveShellFolderCacheExports.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <shlobj.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /// <summary>
+    /// Creates a shell folder for a drive at an absolute PIDL, as the class factory and BindToObject do.
+    /// </summary>
+    __declspec(dllexport) HRESULT CreateBigDriveShellFolderExport(CLSID driveGuid, LPCITEMIDLIST pidlAbsolute, IShellFolder** ppFolder);
+
+    /// <summary>
+    /// Retrieves the hit and miss counters of the folder cache.
+    /// </summary>
+    __declspec(dllexport) void GetShellFolderCacheStatisticsExport(LONG* pHits, LONG* pMisses);
+
+    /// <summary>
+    /// Drops a reference to a folder without destroying it when it was the last, leaving the folder
+    /// where its final Release is between the decrement and taking itself out of the cache.
+    /// Returns the new reference count.
+    /// </summary>
+    __declspec(dllexport) LONG BeginFinalReleaseExport(IShellFolder* pFolder);
+
+    /// <summary>
+    /// Completes a final Release started by BeginFinalReleaseExport.
+    /// </summary>
+    __declspec(dllexport) void EndFinalReleaseExport(IShellFolder* pFolder);
+
+    /// <summary>
+    /// Starts counting the heap allocations the shell folder module makes through its C runtime.
+    /// Returns FALSE in release builds, whose runtime has no allocation hook.
+    /// </summary>
+    __declspec(dllexport) BOOL StartHeapAllocationCountExport();
+
+    /// <summary>
+    /// Stops counting and returns the heap allocations made since StartHeapAllocationCountExport.
+    /// </summary>
+    __declspec(dllexport) LONG StopHeapAllocationCountExport();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,48 @@
+// <copyright file="BigDriveShellFolderCacheImports.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <shlobj.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /// <summary>
+    /// Creates a shell folder for a drive at an absolute PIDL, as the class factory and BindToObject do.
+    /// </summary>
+    __declspec(dllimport) HRESULT CreateBigDriveShellFolderExport(CLSID driveGuid, LPCITEMIDLIST pidlAbsolute, IShellFolder** ppFolder);
+
+    /// <summary>
+    /// Retrieves the hit and miss counters of the folder cache.
+    /// </summary>
+    __declspec(dllimport) void GetShellFolderCacheStatisticsExport(LONG* pHits, LONG* pMisses);
+
+    /// <summary>
+    /// Drops a reference to a folder without destroying it when it was the last, leaving the folder
+    /// where its final Release is between the decrement and taking itself out of the cache.
+    /// Returns the new reference count.
+    /// </summary>
+    __declspec(dllimport) LONG BeginFinalReleaseExport(IShellFolder* pFolder);
+
+    /// <summary>
+    /// Completes a final Release started by BeginFinalReleaseExport.
+    /// </summary>
+    __declspec(dllimport) void EndFinalReleaseExport(IShellFolder* pFolder);
+
+    /// <summary>
+    /// Starts counting the heap allocations the shell folder module makes through its C runtime.
+    /// Returns FALSE in release builds, whose runtime has no allocation hook.
+    /// </summary>
+    __declspec(dllimport) BOOL StartHeapAllocationCountExport();
+
+    /// <summary>
+    /// Stops counting and returns the heap allocations made since StartHeapAllocationCountExport.
+    /// </summary>
+    __declspec(dllimport) LONG StopHeapAllocationCountExport();
+
+#ifdef __cplusplus
+}
+#endif
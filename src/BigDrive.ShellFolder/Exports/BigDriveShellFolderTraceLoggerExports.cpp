@@ -0,0 +1,103 @@
+// <copyright file="BigDriveShellFolderTraceLoggerExports.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "BigDriveShellFolderTraceLoggerExports.h"
+
+#include "..\BigDriveShellFolder.h"
+#include "..\Logging\BigDriveShellFolderTraceLogger.h"
+#include "..\Logging\BigDriveTraceLogger.h"
+#include "..\Logging\BigDriveLatencyHistograms.h"
+
+extern "C" {
+
+    void TraceGetDetailsExExport(CLSID driveGuid, LPCITEMIDLIST pidl, const SHCOLUMNID* pscid, HRESULT hr)
+    {
+        BigDriveShellFolderTraceLogger traceLogger;
+
+        traceLogger.Initialize(driveGuid);
+
+        BIGDRIVE_TRACE_ENTER(traceLogger, "BigDriveShellFolder::GetDetailsEx", pidl, pscid);
+        BIGDRIVE_TRACE_EXIT(traceLogger, "BigDriveShellFolder::GetDetailsEx", hr);
+
+        traceLogger.Uninitialize();
+    }
+
+    void FormatGetDetailsExTraceExport(CLSID driveGuid, LPCITEMIDLIST pidl, const SHCOLUMNID* pscid)
+    {
+        BSTR bstrPath = nullptr;
+        BSTR bstrFMTID = nullptr;
+
+        BigDriveShellFolder::GetPathForLogging(driveGuid, pidl, bstrPath);
+        BigDriveTraceLogger::GetFMTIDName(pscid->fmtid, bstrFMTID);
+
+        if (bstrPath != nullptr)
+        {
+            ::SysFreeString(bstrPath);
+            bstrPath = nullptr;
+        }
+
+        if (bstrFMTID != nullptr)
+        {
+            ::SysFreeString(bstrFMTID);
+            bstrFMTID = nullptr;
+        }
+    }
+
+    BOOL IsTraceEnabledExport()
+    {
+        return BigDriveTraceLogger::IsEnabled() ? TRUE : FALSE;
+    }
+
+    void EnableLatencyHistogramsExport(BOOL fEnable)
+    {
+        BigDriveTraceLogger::EnableHistograms(fEnable);
+    }
+
+    void ResetLatencyHistogramsExport()
+    {
+        BigDriveLatencyHistograms::GetInstance().Reset();
+    }
+
+    void TraceEnterExport(LPCSTR functionName)
+    {
+        BigDriveShellFolderTraceLogger traceLogger;
+
+        traceLogger.Initialize(GUID_NULL);
+        traceLogger.LogEnter(functionName);
+    }
+
+    void TraceExitExport(LPCSTR functionName, HRESULT hr)
+    {
+        BigDriveShellFolderTraceLogger traceLogger;
+
+        traceLogger.Initialize(GUID_NULL);
+        traceLogger.LogExit(functionName, hr);
+    }
+
+    void TraceProviderEnterExport(LPCSTR callName)
+    {
+        BIGDRIVE_TRACE_PROVIDER_ENTER(callName);
+    }
+
+    void TraceProviderExitExport(LPCSTR callName, HRESULT hr)
+    {
+        BIGDRIVE_TRACE_PROVIDER_EXIT(callName, hr);
+    }
+
+    void RecordLatencyExport(LPCSTR functionName, ULONGLONG elapsedMicroseconds)
+    {
+        BigDriveLatencyHistograms::GetInstance().Record(functionName, BigDriveSpanKind_ShellMethod, elapsedMicroseconds, 0);
+    }
+
+    HRESULT GetLatencySummaryExport(LPCSTR functionName, BigDriveLatencySummary* pSummary)
+    {
+        if (pSummary == nullptr)
+        {
+            return E_POINTER;
+        }
+
+        return BigDriveLatencyHistograms::GetInstance().GetSummary(functionName, *pSummary);
+    }
+}
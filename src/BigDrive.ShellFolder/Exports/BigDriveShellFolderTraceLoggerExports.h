@@ -0,0 +1,73 @@
+// <copyright file="BigDriveShellFolderTraceLoggerExports.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <shlobj.h>
+
+#include "..\Logging\BigDriveLatencyHistograms.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /// <summary>
+    /// Traces entry to and exit from GetDetailsEx for a column of an item, the way GetDetailsEx does.
+    /// </summary>
+    __declspec(dllexport) void TraceGetDetailsExExport(CLSID driveGuid, LPCITEMIDLIST pidl, const SHCOLUMNID* pscid, HRESULT hr);
+
+    /// <summary>
+    /// Formats the trace arguments of GetDetailsEx, the item path and the FMTID name, and frees them,
+    /// as every call did before tracing checked whether a session is listening.
+    /// </summary>
+    __declspec(dllexport) void FormatGetDetailsExTraceExport(CLSID driveGuid, LPCITEMIDLIST pidl, const SHCOLUMNID* pscid);
+
+    /// <summary>
+    /// Returns TRUE if a trace session is listening to the BigDrive provider.
+    /// </summary>
+    __declspec(dllexport) BOOL IsTraceEnabledExport();
+
+    /// <summary>
+    /// Turns the latency histograms on or off.
+    /// </summary>
+    __declspec(dllexport) void EnableLatencyHistogramsExport(BOOL fEnable);
+
+    /// <summary>
+    /// Zeroes every latency histogram.
+    /// </summary>
+    __declspec(dllexport) void ResetLatencyHistogramsExport();
+
+    /// <summary>
+    /// Opens a shell method span, as LogEnter does.
+    /// </summary>
+    __declspec(dllexport) void TraceEnterExport(LPCSTR functionName);
+
+    /// <summary>
+    /// Closes a shell method span, as LogExit does.
+    /// </summary>
+    __declspec(dllexport) void TraceExitExport(LPCSTR functionName, HRESULT hr);
+
+    /// <summary>
+    /// Opens a provider call span.
+    /// </summary>
+    __declspec(dllexport) void TraceProviderEnterExport(LPCSTR callName);
+
+    /// <summary>
+    /// Closes a provider call span.
+    /// </summary>
+    __declspec(dllexport) void TraceProviderExitExport(LPCSTR callName, HRESULT hr);
+
+    /// <summary>
+    /// Records one call of a shell method directly into its histogram.
+    /// </summary>
+    __declspec(dllexport) void RecordLatencyExport(LPCSTR functionName, ULONGLONG elapsedMicroseconds);
+
+    /// <summary>
+    /// Summarizes the latency histogram of a method.
+    /// </summary>
+    __declspec(dllexport) HRESULT GetLatencySummaryExport(LPCSTR functionName, BigDriveLatencySummary* pSummary);
+
+#ifdef __cplusplus
+}
+#endif
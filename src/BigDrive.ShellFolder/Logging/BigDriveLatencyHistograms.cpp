@@ -0,0 +1,341 @@
+// <copyright file="BigDriveLatencyHistograms.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+#include "BigDriveLatencyHistograms.h"
+
+#include <intrin.h>
+#include <math.h>
+#include <string.h>
+
+#include "BigDriveTraceLogger.h"
+
+/// <inheritdoc />
+BigDriveLatencyHistograms::BigDriveLatencyHistograms()
+{
+	for (ULONG i = 0; i < TableSize; i++)
+	{
+		m_apHistograms[i] = nullptr;
+	}
+
+	::InitializeSRWLock(&m_lock);
+}
+
+/// <inheritdoc />
+BigDriveLatencyHistograms& BigDriveLatencyHistograms::GetInstance()
+{
+	// Never destroyed, so spans ending while the process shuts down still have somewhere to go
+	static BigDriveLatencyHistograms* s_pInstance = new BigDriveLatencyHistograms();
+	return *s_pInstance;
+}
+
+/// <inheritdoc />
+void BigDriveLatencyHistograms::Record(LPCSTR szName, BigDriveSpanKind kind, ULONGLONG elapsedMicroseconds, ULONGLONG providerMicroseconds)
+{
+	BigDriveLatencyHistogram* pHistogram = nullptr;
+	LONG64 maxMicroseconds = 0;
+
+	pHistogram = Find(szName, kind, TRUE);
+	if (pHistogram == nullptr)
+	{
+		return;
+	}
+
+	::InterlockedIncrement64(&pHistogram->buckets[GetBucketIndex(elapsedMicroseconds)]);
+	::InterlockedIncrement64(&pHistogram->count);
+	::InterlockedExchangeAdd64(&pHistogram->totalMicroseconds, static_cast<LONG64>(elapsedMicroseconds));
+	::InterlockedExchangeAdd64(&pHistogram->providerMicroseconds, static_cast<LONG64>(providerMicroseconds));
+
+	maxMicroseconds = pHistogram->maxMicroseconds;
+	while (static_cast<LONG64>(elapsedMicroseconds) > maxMicroseconds)
+	{
+		maxMicroseconds = ::InterlockedCompareExchange64(&pHistogram->maxMicroseconds, static_cast<LONG64>(elapsedMicroseconds), maxMicroseconds);
+	}
+}
+
+/// <inheritdoc />
+HRESULT BigDriveLatencyHistograms::GetSummary(LPCSTR szName, BigDriveLatencySummary& summary)
+{
+	BigDriveLatencyHistogram* pHistogram = nullptr;
+
+	::ZeroMemory(&summary, sizeof(summary));
+
+	pHistogram = Find(szName, BigDriveSpanKind_ShellMethod, FALSE);
+	if (pHistogram == nullptr)
+	{
+		return S_FALSE;
+	}
+
+	Summarize(pHistogram, summary);
+	return S_OK;
+}
+
+/// <inheritdoc />
+ULONG BigDriveLatencyHistograms::GetSummaries(BigDriveLatencySummary* pSummaries, ULONG cSummaries)
+{
+	BigDriveLatencyHistogram* pHistogram = nullptr;
+	ULONG count = 0;
+
+	for (ULONG i = 0; i < TableSize; i++)
+	{
+		pHistogram = static_cast<BigDriveLatencyHistogram*>(::InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&m_apHistograms[i]), nullptr, nullptr));
+		if (pHistogram == nullptr)
+		{
+			continue;
+		}
+
+		if ((pSummaries != nullptr) && (count < cSummaries))
+		{
+			Summarize(pHistogram, pSummaries[count]);
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+/// <inheritdoc />
+void BigDriveLatencyHistograms::Reset()
+{
+	BigDriveLatencyHistogram* pHistogram = nullptr;
+
+	for (ULONG i = 0; i < TableSize; i++)
+	{
+		pHistogram = static_cast<BigDriveLatencyHistogram*>(::InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&m_apHistograms[i]), nullptr, nullptr));
+		if (pHistogram == nullptr)
+		{
+			continue;
+		}
+
+		::InterlockedExchange64(&pHistogram->count, 0);
+		::InterlockedExchange64(&pHistogram->totalMicroseconds, 0);
+		::InterlockedExchange64(&pHistogram->providerMicroseconds, 0);
+		::InterlockedExchange64(&pHistogram->maxMicroseconds, 0);
+
+		for (ULONG j = 0; j < BigDriveLatencyHistogram::BucketCount; j++)
+		{
+			::InterlockedExchange64(&pHistogram->buckets[j], 0);
+		}
+	}
+}
+
+/// <inheritdoc />
+void BigDriveLatencyHistograms::WriteTraceEvents()
+{
+	BigDriveLatencyHistogram* pHistogram = nullptr;
+	BigDriveLatencySummary summary;
+
+	for (ULONG i = 0; i < TableSize; i++)
+	{
+		pHistogram = static_cast<BigDriveLatencyHistogram*>(::InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&m_apHistograms[i]), nullptr, nullptr));
+		if (pHistogram == nullptr)
+		{
+			continue;
+		}
+
+		Summarize(pHistogram, summary);
+
+		TraceLoggingWrite(g_hBigDriveTraceProvider,
+			"LatencyHistogram",
+			TraceLoggingString(summary.szName, "FunctionName"),
+			TraceLoggingString((summary.kind == BigDriveSpanKind_ProviderCall) ? "Provider" : "Shell", "Kind"),
+			TraceLoggingInt64(summary.count, "Count"),
+			TraceLoggingValue(summary.p50Milliseconds, "P50Milliseconds"),
+			TraceLoggingValue(summary.p90Milliseconds, "P90Milliseconds"),
+			TraceLoggingValue(summary.p99Milliseconds, "P99Milliseconds"),
+			TraceLoggingValue(summary.maxMilliseconds, "MaxMilliseconds"),
+			TraceLoggingValue(summary.meanMilliseconds, "MeanMilliseconds"),
+			TraceLoggingValue(summary.providerMeanMilliseconds, "ProviderMeanMilliseconds"));
+	}
+}
+
+/// <inheritdoc />
+ULONG BigDriveLatencyHistograms::GetBucketIndex(ULONGLONG value)
+{
+	unsigned long msb = 0;
+	ULONG shift = 0;
+
+	if (value < BigDriveLatencyHistogram::SubBucketCount)
+	{
+		return static_cast<ULONG>(value);
+	}
+
+	if (value >= (1ULL << BigDriveLatencyHistogram::MaxValueBits))
+	{
+		return BigDriveLatencyHistogram::BucketCount - 1;
+	}
+
+	// _BitScanReverse64 isn't available to x86 builds
+	if ((value >> 32) != 0)
+	{
+		::_BitScanReverse(&msb, static_cast<unsigned long>(value >> 32));
+		msb += 32;
+	}
+	else
+	{
+		::_BitScanReverse(&msb, static_cast<unsigned long>(value));
+	}
+
+	shift = msb - BigDriveLatencyHistogram::SubBucketBits;
+
+	return (shift + 1) * BigDriveLatencyHistogram::SubBucketCount +
+		static_cast<ULONG>((value >> shift) - BigDriveLatencyHistogram::SubBucketCount);
+}
+
+/// <inheritdoc />
+ULONGLONG BigDriveLatencyHistograms::GetBucketValue(ULONG index)
+{
+	ULONG shift = 0;
+	ULONG subBucket = 0;
+
+	if (index < BigDriveLatencyHistogram::SubBucketCount)
+	{
+		return index;
+	}
+
+	shift = (index / BigDriveLatencyHistogram::SubBucketCount) - 1;
+	subBucket = index % BigDriveLatencyHistogram::SubBucketCount;
+
+	return (static_cast<ULONGLONG>(BigDriveLatencyHistogram::SubBucketCount + subBucket) << shift) + ((1ULL << shift) - 1);
+}
+
+/// <inheritdoc />
+BigDriveLatencyHistogram* BigDriveLatencyHistograms::Find(LPCSTR szName, BigDriveSpanKind kind, BOOL fAdd)
+{
+	BigDriveLatencyHistogram* pHistogram = nullptr;
+	ULONG hash = 0;
+	ULONG slot = 0;
+
+	if (szName == nullptr)
+	{
+		return nullptr;
+	}
+
+	hash = Hash(szName);
+
+	// Lock-free probe; a slot, once filled, never changes
+	for (ULONG i = 0; i < TableSize; i++)
+	{
+		slot = (hash + i) & (TableSize - 1);
+
+		pHistogram = static_cast<BigDriveLatencyHistogram*>(::InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&m_apHistograms[slot]), nullptr, nullptr));
+		if (pHistogram == nullptr)
+		{
+			break;
+		}
+
+		if ((pHistogram->hash == hash) && ((pHistogram->szName == szName) || (::strcmp(pHistogram->szName, szName) == 0)))
+		{
+			return pHistogram;
+		}
+	}
+
+	if (!fAdd)
+	{
+		return nullptr;
+	}
+
+	::AcquireSRWLockExclusive(&m_lock);
+
+	// Probe again: another thread may have added the name, or taken the empty slot
+	pHistogram = nullptr;
+	for (ULONG i = 0; i < TableSize; i++)
+	{
+		slot = (hash + i) & (TableSize - 1);
+
+		if (m_apHistograms[slot] == nullptr)
+		{
+			pHistogram = new BigDriveLatencyHistogram();
+			if (pHistogram != nullptr)
+			{
+				::ZeroMemory(pHistogram, sizeof(BigDriveLatencyHistogram));
+				pHistogram->szName = szName;
+				pHistogram->kind = kind;
+				pHistogram->hash = hash;
+
+				::InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&m_apHistograms[slot]), pHistogram);
+			}
+
+			break;
+		}
+
+		if ((m_apHistograms[slot]->hash == hash) && (::strcmp(m_apHistograms[slot]->szName, szName) == 0))
+		{
+			pHistogram = m_apHistograms[slot];
+			break;
+		}
+	}
+
+	::ReleaseSRWLockExclusive(&m_lock);
+
+	// nullptr when the table is full: the call goes unrecorded
+	return pHistogram;
+}
+
+/// <inheritdoc />
+void BigDriveLatencyHistograms::Summarize(const BigDriveLatencyHistogram* pHistogram, BigDriveLatencySummary& summary)
+{
+	LONGLONG count = ::InterlockedCompareExchange64(const_cast<volatile LONG64*>(&pHistogram->count), 0, 0);
+
+	::ZeroMemory(&summary, sizeof(summary));
+	summary.szName = pHistogram->szName;
+	summary.kind = pHistogram->kind;
+	summary.count = count;
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	summary.p50Milliseconds = GetPercentile(pHistogram, count, 50.0) / 1000.0;
+	summary.p90Milliseconds = GetPercentile(pHistogram, count, 90.0) / 1000.0;
+	summary.p99Milliseconds = GetPercentile(pHistogram, count, 99.0) / 1000.0;
+	summary.maxMilliseconds = pHistogram->maxMicroseconds / 1000.0;
+	summary.meanMilliseconds = pHistogram->totalMicroseconds / 1000.0 / count;
+	summary.providerMeanMilliseconds = pHistogram->providerMicroseconds / 1000.0 / count;
+}
+
+/// <inheritdoc />
+ULONGLONG BigDriveLatencyHistograms::GetPercentile(const BigDriveLatencyHistogram* pHistogram, LONGLONG count, double percentile)
+{
+	LONGLONG target = static_cast<LONGLONG>(::ceil(count * percentile / 100.0));
+	LONGLONG cumulative = 0;
+	ULONGLONG maxMicroseconds = static_cast<ULONGLONG>(pHistogram->maxMicroseconds);
+	ULONGLONG value = 0;
+
+	if (target < 1)
+	{
+		target = 1;
+	}
+
+	for (ULONG i = 0; i < BigDriveLatencyHistogram::BucketCount; i++)
+	{
+		cumulative += pHistogram->buckets[i];
+		if (cumulative >= target)
+		{
+			// The top of the bucket, but never past the largest value seen
+			value = GetBucketValue(i);
+			return (value < maxMicroseconds) ? value : maxMicroseconds;
+		}
+	}
+
+	// Buckets read while calls were recorded can trail the count
+	return maxMicroseconds;
+}
+
+/// <inheritdoc />
+ULONG BigDriveLatencyHistograms::Hash(LPCSTR szName)
+{
+	ULONG hash = 2166136261UL;
+
+	for (LPCSTR p = szName; *p != '\0'; p++)
+	{
+		hash ^= static_cast<UCHAR>(*p);
+		hash *= 16777619UL;
+	}
+
+	return hash;
+}
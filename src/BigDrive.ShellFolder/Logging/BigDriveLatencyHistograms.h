@@ -0,0 +1,202 @@
+// <copyright file="BigDriveLatencyHistograms.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <windows.h>
+
+/// <summary>
+/// What a timed span covers.
+/// </summary>
+enum BigDriveSpanKind
+{
+	/// <summary>
+	/// A method the shell calls on one of our objects (IShellFolder, IDataObject, ...).
+	/// </summary>
+	BigDriveSpanKind_ShellMethod = 0,
+
+	/// <summary>
+	/// A call out to the provider (IBigDriveFileInfo, IBigDriveEnumerate, ...).
+	/// </summary>
+	BigDriveSpanKind_ProviderCall = 1
+};
+
+/// <summary>
+/// Percentiles and totals of one histogram, in milliseconds.
+/// </summary>
+struct BigDriveLatencySummary
+{
+	/// <summary>
+	/// The method or provider call the histogram times.
+	/// </summary>
+	LPCSTR szName;
+
+	/// <summary>
+	/// Whether the histogram times a shell method or a provider call.
+	/// </summary>
+	BigDriveSpanKind kind;
+
+	/// <summary>
+	/// Number of calls recorded.
+	/// </summary>
+	LONGLONG count;
+
+	double p50Milliseconds;
+	double p90Milliseconds;
+	double p99Milliseconds;
+	double maxMilliseconds;
+	double meanMilliseconds;
+
+	/// <summary>
+	/// Mean time per call spent in provider calls made inside it. For a provider call, its own mean.
+	/// </summary>
+	double providerMeanMilliseconds;
+};
+
+/// <summary>
+/// Latency histogram of one method, in microseconds. Buckets are log-linear, as in an HDR
+/// histogram: values below SubBucketCount are held exactly, and each power of two above that is
+/// split into SubBucketCount buckets, so a reported percentile is within 1/SubBucketCount of
+/// the true value. Recording is lock free.
+/// </summary>
+struct BigDriveLatencyHistogram
+{
+	/// <summary>
+	/// Bits of precision kept below the leading bit.
+	/// </summary>
+	static const ULONG SubBucketBits = 4;
+
+	static const ULONG SubBucketCount = 1 << SubBucketBits;
+
+	/// <summary>
+	/// Powers of two covered; larger values land in the last bucket (about 25 days).
+	/// </summary>
+	static const ULONG MaxValueBits = 41;
+
+	static const ULONG BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+	/// <summary>
+	/// The method name, static storage (typically __FUNCTION__ or a literal).
+	/// </summary>
+	LPCSTR szName;
+
+	BigDriveSpanKind kind;
+
+	/// <summary>
+	/// FNV-1a hash of the name.
+	/// </summary>
+	ULONG hash;
+
+	volatile LONG64 count;
+	volatile LONG64 totalMicroseconds;
+	volatile LONG64 providerMicroseconds;
+	volatile LONG64 maxMicroseconds;
+	volatile LONG64 buckets[BucketCount];
+};
+
+/// <summary>
+/// Process-wide table of latency histograms, one per shell method and per provider call, fed by
+/// the trace layer's spans. Read with GetSummaries, or written to a trace session as
+/// LatencyHistogram events when the session requests a state capture.
+/// </summary>
+class BigDriveLatencyHistograms
+{
+private:
+
+	/// <summary>
+	/// Most histograms held. Must be a power of two.
+	/// </summary>
+	static const ULONG TableSize = 256;
+
+	/// <summary>
+	/// Open-addressed table of histograms, allocated on first use of each name and never freed,
+	/// so recording threads can hold a pointer without a lock.
+	/// </summary>
+	BigDriveLatencyHistogram* volatile m_apHistograms[TableSize];
+
+	/// <summary>
+	/// Serializes adding histograms.
+	/// </summary>
+	SRWLOCK m_lock;
+
+public:
+
+	/// <summary>
+	/// Initializes a new instance of the <see cref="BigDriveLatencyHistograms"/> class.
+	/// </summary>
+	BigDriveLatencyHistograms();
+
+	/// <summary>
+	/// Retrieves the process-wide instance.
+	/// </summary>
+	/// <returns>The histograms.</returns>
+	static BigDriveLatencyHistograms& GetInstance();
+
+	/// <summary>
+	/// Records one call.
+	/// </summary>
+	/// <param name="szName">The method name; must have static storage.</param>
+	/// <param name="kind">Whether the call is a shell method or a provider call.</param>
+	/// <param name="elapsedMicroseconds">How long the call took.</param>
+	/// <param name="providerMicroseconds">How much of that was spent in provider calls.</param>
+	void Record(LPCSTR szName, BigDriveSpanKind kind, ULONGLONG elapsedMicroseconds, ULONGLONG providerMicroseconds);
+
+	/// <summary>
+	/// Summarizes the histogram of one method.
+	/// </summary>
+	/// <param name="szName">The method name.</param>
+	/// <param name="summary">Receives the summary.</param>
+	/// <returns>S_OK if the method has been recorded; S_FALSE if not.</returns>
+	HRESULT GetSummary(LPCSTR szName, BigDriveLatencySummary& summary);
+
+	/// <summary>
+	/// Summarizes every histogram.
+	/// </summary>
+	/// <param name="pSummaries">Receives up to cSummaries summaries; may be nullptr to count.</param>
+	/// <param name="cSummaries">Number of summaries pSummaries can hold.</param>
+	/// <returns>The number of histograms held.</returns>
+	ULONG GetSummaries(BigDriveLatencySummary* pSummaries, ULONG cSummaries);
+
+	/// <summary>
+	/// Zeroes every histogram. Calls recorded at the same time may be partly lost.
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Writes a LatencyHistogram event for each histogram to the trace provider.
+	/// </summary>
+	void WriteTraceEvents();
+
+	/// <summary>
+	/// Maps a value to its bucket.
+	/// </summary>
+	static ULONG GetBucketIndex(ULONGLONG value);
+
+	/// <summary>
+	/// Returns the highest value a bucket holds.
+	/// </summary>
+	static ULONGLONG GetBucketValue(ULONG index);
+
+private:
+
+	/// <summary>
+	/// Finds the histogram of a name, adding it if allowed and absent.
+	/// </summary>
+	BigDriveLatencyHistogram* Find(LPCSTR szName, BigDriveSpanKind kind, BOOL fAdd);
+
+	/// <summary>
+	/// Summarizes one histogram.
+	/// </summary>
+	static void Summarize(const BigDriveLatencyHistogram* pHistogram, BigDriveLatencySummary& summary);
+
+	/// <summary>
+	/// Returns the value at a percentile of a histogram, in microseconds.
+	/// </summary>
+	static ULONGLONG GetPercentile(const BigDriveLatencyHistogram* pHistogram, LONGLONG count, double percentile);
+
+	/// <summary>
+	/// Computes the FNV-1a hash of a name.
+	/// </summary>
+	static ULONG Hash(LPCSTR szName);
+};
@@ -9,8 +9,6 @@
 #include "BigDriveTraceLogger.h"
 #include "..\BigDriveShellFolder.h"
 
-__declspec(thread) LARGE_INTEGER BigDriveShellFolderTraceLogger::s_startTime = { 0 };
-
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::Initialize(CLSID driveGuid)
 {
@@ -25,21 +23,34 @@ void BigDriveShellFolderTraceLogger::Uninitialize()
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogEvent(const char* message)
 {
+	if (!BigDriveTraceLogger::IsEnabled())
+	{
+		return;
+	}
+
 	TraceLoggingWrite(g_hBigDriveTraceProvider, "BigDriveShellFolderEvent", TraceLoggingValue(message, "Message"));
 }
 
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName)
 {
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"));
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"));
 }
 
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, UINT iColumn)
 {
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingValue(iColumn, "Column"));
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingValue(iColumn, "Column"));
 }
 
 /// <inheritdoc />
@@ -48,16 +59,19 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, LPCITEMIDLIST
 	HRESULT hr = S_OK;
 	BSTR bstrPath = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	hr = BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl, bstrPath);
 	if (SUCCEEDED(hr))
 	{
-		TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"));
+		TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"));
 		goto End;
 	}
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"));
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"));
 
 End:
 
@@ -76,16 +90,19 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, LPCITEMIDLIST
 	HRESULT hr = S_OK;
 	BSTR bstrPath = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	hr = BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl, bstrPath);
 	if (SUCCEEDED(hr))
 	{
-		TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"), TraceLoggingValue(iColumn, "Column"));
+		TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"), TraceLoggingValue(iColumn, "Column"));
 		goto End;
 	}
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingValue(iColumn, "Column"));
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingValue(iColumn, "Column"));
 
 End:
 
@@ -104,13 +121,18 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, LPCITEMIDLIST
 	BSTR bstrPath = nullptr;
 	BSTR bstrFMTID = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl, bstrPath);
 	BigDriveTraceLogger::GetFMTIDName(pscid->fmtid, bstrFMTID);
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider,
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider,
 		"Enter",
+		BigDriveTraceLogger::GetSpanActivityId(),
+		BigDriveTraceLogger::GetParentSpanActivityId(),
 		TraceLoggingString(functionName, "FunctionName"),
 		TraceLoggingWideString(bstrPath, "Path"),
 		TraceLoggingWideString(bstrFMTID, "fmtid"),
@@ -139,9 +161,14 @@ void BigDriveShellFolderTraceLogger::LogResults(LPCSTR functionName, IEnumIDList
 	LPITEMIDLIST pidl = nullptr;
 	ULONG fetched = 0;
 
+	if (!BigDriveTraceLogger::IsEnabled())
+	{
+		return;
+	}
+
 	if (pEnumIdList == nullptr)
 	{
-		TraceLoggingWrite(g_hBigDriveTraceProvider, "Result", TraceLoggingString(functionName, "FunctionName"), TraceLoggingString("Invalid enumerator", "Error"));
+		TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Result", BigDriveTraceLogger::GetSpanActivityId(), nullptr, TraceLoggingString(functionName, "FunctionName"), TraceLoggingString("Invalid enumerator", "Error"));
 		return;
 	}
 
@@ -153,11 +180,11 @@ void BigDriveShellFolderTraceLogger::LogResults(LPCSTR functionName, IEnumIDList
 		hr = BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl, bstrPath);
 		if (SUCCEEDED(hr))
 		{
-			TraceLoggingWrite(g_hBigDriveTraceProvider, "Result", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"));
+			TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Result", BigDriveTraceLogger::GetSpanActivityId(), nullptr, TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"));
 		}
 		else
 		{
-			TraceLoggingWrite(g_hBigDriveTraceProvider, "Result", TraceLoggingString(functionName, "FunctionName"));
+			TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Result", BigDriveTraceLogger::GetSpanActivityId(), nullptr, TraceLoggingString(functionName, "FunctionName"));
 		}
 
 		if (bstrPath != nullptr)
@@ -196,14 +223,17 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, REFIID riid,
 	BSTR bstrPath = nullptr;
 	BSTR bstrIIDName = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	LPCITEMIDLIST pidlCombine = ::ILCombine(pidl1, pidl2);
 
 	BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidlCombine, bstrPath);
 	BigDriveTraceLogger::GetShellIIDName(riid, bstrIIDName);
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter",
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(),
 		TraceLoggingString(functionName, "FunctionName"),
 		TraceLoggingWideString(bstrIIDName, "IID"),
 		TraceLoggingWideString(bstrPath, "Path"));
@@ -235,12 +265,15 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, REFIID riid,
 	BSTR bstrPath = nullptr;
 	BSTR bstrIIDName = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl, bstrPath);
 	BigDriveTraceLogger::GetShellIIDName(riid, bstrIIDName);
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"), TraceLoggingWideString(bstrPath, "Path"));
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"), TraceLoggingWideString(bstrPath, "Path"));
 
 	if (bstrPath != nullptr)
 	{
@@ -265,21 +298,24 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, PCUIDLIST_REL
 	BSTR bstrPath1 = nullptr;
 	BSTR bstrPath2 = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	hr1 = BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl1, bstrPath1);
 	hr2 = BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl2, bstrPath2);
 
 	if (SUCCEEDED(hr1) && SUCCEEDED(hr2) && (bstrPath1 != nullptr) && (bstrPath2 != nullptr))
 	{
-		TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter",
+		TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(),
 			TraceLoggingString(functionName, "FunctionName"),
 			TraceLoggingWideString(bstrPath1, "Path1"),
 			TraceLoggingWideString(bstrPath2, "Path2"));
 		goto End;
 	}
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"));
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"));
 
 End:
 
@@ -304,6 +340,11 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, UINT cidl, PC
 	HRESULT hr = S_OK;
 	BSTR bstrPath = nullptr;
 
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
 	for (UINT i = 0; i < cidl; ++i)
 	{
 		PCUITEMID_CHILD pidl = apidl[i];
@@ -311,11 +352,11 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, UINT cidl, PC
 		hr = BigDriveShellFolder::GetPathForLogging(m_driveGuid, apidl[i], bstrPath);
 		if (SUCCEEDED(hr))
 		{
-			TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"));
+			TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrPath, "Path"));
 		}
 		else
 		{
-			TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"));
+			TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"));
 
 		}
 
@@ -334,6 +375,11 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, REFIID riid,
 	BSTR bstrIIDName = nullptr;
 	BSTR bstrPath = nullptr;
 
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
 	BigDriveTraceLogger::GetShellIIDName(riid, bstrIIDName);
 
 	for (UINT i = 0; i < cidl; ++i)
@@ -343,11 +389,11 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, REFIID riid,
 		hr = BigDriveShellFolder::GetPathForLogging(m_driveGuid, apidl[i], bstrPath);
 		if (SUCCEEDED(hr))
 		{
-			TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"), TraceLoggingWideString(bstrPath, "Path"));
+			TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"), TraceLoggingWideString(bstrPath, "Path"));
 		}
 		else
 		{
-			TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"));
+			TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"));
 		}
 
 		if (bstrPath != nullptr)
@@ -369,8 +415,12 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, REFIID riid,
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, CLSID* pClassID)
 {
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingGuid(*pClassID, "CLSID"));
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingGuid(*pClassID, "CLSID"));
 }
 
 /// <inheritdoc />
@@ -379,11 +429,14 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, REFCLSID clsi
 	HRESULT hr = S_OK;
 	BSTR bstrIIDName = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	BigDriveTraceLogger::GetShellIIDName(riid, bstrIIDName);
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter",
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(),
 		TraceLoggingString(functionName, "FunctionName"),
 		TraceLoggingGuid(clsid, "CLSID"),
 		TraceLoggingWideString(bstrIIDName, "IID"));
@@ -400,10 +453,14 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, REFIID riid)
 {
 	BSTR bstrIIDName = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
 	BigDriveTraceLogger::GetShellIIDName(riid, bstrIIDName);
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"));
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"));
 
 	if (bstrIIDName != nullptr)
 	{
@@ -420,6 +477,11 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, const FORMATE
 	char buf[256] = { 0 };
 	WCHAR formatName[128] = { 0 };
 
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
 	// Try to get the clipboard format name if possible
 	if (::GetClipboardFormatNameW(formatetc.cfFormat, formatName, ARRAYSIZE(formatName)))
 	{
@@ -478,9 +540,11 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, const FORMATE
 		);
 	}
 
-	TraceLoggingWrite(
+	TraceLoggingWriteActivity(
 		g_hBigDriveTraceProvider,
 		"Enter",
+		BigDriveTraceLogger::GetSpanActivityId(),
+		BigDriveTraceLogger::GetParentSpanActivityId(),
 		TraceLoggingString(functionName, "FunctionName"),
 		TraceLoggingString(buf, "FORMATETC")
 	);
@@ -490,49 +554,75 @@ void BigDriveShellFolderTraceLogger::LogEnter(LPCSTR functionName, const FORMATE
 void BigDriveShellFolderTraceLogger::LogParseDisplayName(LPCSTR functionName, LPOLESTR pszDisplayName)
 {
 	HRESULT hr = S_OK;
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
 
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(pszDisplayName, "DisplayName"));
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(pszDisplayName, "DisplayName"));
 }
 
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogExit(LPCSTR functionName, HRESULT hr)
 {
-	double elapsedMillisSeconds = BigDriveTraceLogger::GetElapsedSecondsSinceStoredTime() * 1000.0; // Convert to milliseconds
+	GUID activityId = GUID_NULL;
+	double elapsedMillisSeconds = 0.0;
+	double providerMilliseconds = 0.0;
+
+	if (!BigDriveTraceLogger::EndSpan(functionName, activityId, elapsedMillisSeconds, providerMilliseconds))
+	{
+		return;
+	}
 
-	TraceLoggingWrite(
+	TraceLoggingWriteActivity(
 		g_hBigDriveTraceProvider,
 		"Exit",
+		&activityId,
+		nullptr,
 		TraceLoggingString(functionName, "FunctionName"),
 		TraceLoggingValue(elapsedMillisSeconds, "Milliseconds"),
+		TraceLoggingValue(providerMilliseconds, "ProviderMilliseconds"),
 		TraceLoggingHexUInt32(hr, "HRESULT"));
 }
 
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogExit(LPCSTR functionName, LPCITEMIDLIST pidl, HRESULT hr)
 {
+	GUID activityId = GUID_NULL;
+	double elapsedMillisSeconds = 0.0;
+	double providerMilliseconds = 0.0;
 	BSTR bstrPath = nullptr;
 
-	double elapsedMillisSeconds = BigDriveTraceLogger::GetElapsedSecondsSinceStoredTime() * 1000.0; // Convert to milliseconds
+	if (!BigDriveTraceLogger::EndSpan(functionName, activityId, elapsedMillisSeconds, providerMilliseconds))
+	{
+		return;
+	}
 
 	HRESULT hrInternal = BigDriveShellFolder::GetPathForLogging(m_driveGuid, pidl, bstrPath);
 	if (SUCCEEDED(hrInternal))
 	{
-		TraceLoggingWrite(g_hBigDriveTraceProvider,
+		TraceLoggingWriteActivity(g_hBigDriveTraceProvider,
 			"Exit",
+			&activityId,
+			nullptr,
 			TraceLoggingString(functionName, "FunctionName"),
 			TraceLoggingWideString(bstrPath, "Path"),
 			TraceLoggingValue(elapsedMillisSeconds, "Milliseconds"),
+			TraceLoggingValue(providerMilliseconds, "ProviderMilliseconds"),
 			TraceLoggingHexUInt32(hr, "HRESULT"));
 
 		goto End;
 	}
 
-	TraceLoggingWrite(
+	TraceLoggingWriteActivity(
 		g_hBigDriveTraceProvider,
 		"Exit",
+		&activityId,
+		nullptr,
 		TraceLoggingString(functionName, "FunctionName"),
 		TraceLoggingValue(elapsedMillisSeconds, "Milliseconds"),
+		TraceLoggingValue(providerMilliseconds, "ProviderMilliseconds"),
 		TraceLoggingHexUInt32(hr, "HRESULT"));
 
 End:
@@ -549,12 +639,22 @@ End:
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogInfo(const char* message)
 {
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Info", TraceLoggingValue(message, "Message"));
+	if (!BigDriveTraceLogger::IsEnabled())
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Info", BigDriveTraceLogger::GetSpanActivityId(), nullptr, TraceLoggingValue(message, "Message"));
 }
 
 /// <inheritdoc />
 void BigDriveShellFolderTraceLogger::LogInfo(LPCSTR functionName, LPCWSTR format, ...)
 {
+	if (!BigDriveTraceLogger::IsEnabled())
+	{
+		return;
+	}
+
 	// Buffer for the formatted message
 	WCHAR szBuffer[1024] = { 0 };
 
@@ -565,5 +665,5 @@ void BigDriveShellFolderTraceLogger::LogInfo(LPCSTR functionName, LPCWSTR format
 	va_end(args);
 
 	// Log the final message
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Info", TraceLoggingString(functionName, "FunctionName"), TraceLoggingValue(szBuffer, "Message"));
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Info", BigDriveTraceLogger::GetSpanActivityId(), nullptr, TraceLoggingString(functionName, "FunctionName"), TraceLoggingValue(szBuffer, "Message"));
 }
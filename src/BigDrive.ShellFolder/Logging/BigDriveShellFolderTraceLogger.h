@@ -9,9 +9,27 @@
 #include <TraceLoggingProvider.h>
 #include <shlobj.h> 
 
+#include "BigDriveTraceLogger.h"
+
+/// <summary>
+/// Logs entry through a BigDriveShellFolderTraceLogger only when spans are timed (a session is listening,
+/// or latency histograms are on), so the call is skipped otherwise. With no session and histograms off
+/// it costs one test of the provider's enable state. Use on paths the shell calls per item.
+/// </summary>
+#define BIGDRIVE_TRACE_ENTER(logger, ...) \
+	do { if (BigDriveTraceLogger::IsTimingEnabled()) { (logger).LogEnter(__VA_ARGS__); } } while (0)
+
+/// <summary>
+/// Logs exit through a BigDriveShellFolderTraceLogger only when spans are timed.
+/// </summary>
+#define BIGDRIVE_TRACE_EXIT(logger, ...) \
+	do { if (BigDriveTraceLogger::IsTimingEnabled()) { (logger).LogExit(__VA_ARGS__); } } while (0)
+
 /// <summary>
 /// Provides static, thread-safe methods for trace logging events and diagnostics related to the BigDrive Shell Folder.
 /// Supports logging function entry/exit, method parameters, and duration tracking for performance analysis.
+/// Every method returns before formatting its arguments when no session is listening. LogEnter and LogExit
+/// open and close a span on BigDriveTraceLogger's per-thread stack.
 /// </summary>
 class BigDriveShellFolderTraceLogger
 {
@@ -22,11 +40,6 @@ private:
 	/// </summary>
 	CLSID m_driveGuid;
 
-	/// <summary>
-	/// Thread-local storage for high-resolution timing, used to track method durations.
-	/// </summary>
-	static __declspec(thread) LARGE_INTEGER s_startTime;
-
 public:
 
 	/// <summary>
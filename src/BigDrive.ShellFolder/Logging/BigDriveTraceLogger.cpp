@@ -8,6 +8,7 @@
 
 #include <shlguid.h>      // For PSGUIDs
 #include <combaseapi.h>   // For StringFromGUID2
+#include <string.h>
 
 // Provider Id: {A356D4CC-CDAC-4894-A93D-35C4C3F84944}
 TRACELOGGING_DEFINE_PROVIDER(
@@ -16,12 +17,22 @@ TRACELOGGING_DEFINE_PROVIDER(
 	(0xa356d4cc, 0xcdac, 0x4894, 0xa9, 0x3d, 0x35, 0xc4, 0xc3, 0xf8, 0x49, 0x44)
 );
 
-__declspec(thread) LARGE_INTEGER BigDriveTraceLogger::s_startTime = { 0 };
+__declspec(thread) BigDriveTraceSpan BigDriveTraceLogger::s_spans[BigDriveTraceLogger::MaxSpanDepth] = { 0 };
+__declspec(thread) ULONG BigDriveTraceLogger::s_spanDepth = 0;
+volatile LONG BigDriveTraceLogger::s_fHistogramsEnabled = 0;
+LARGE_INTEGER BigDriveTraceLogger::s_frequency = { 0 };
 
 /// <inheritdoc />
 void BigDriveTraceLogger::Initialize()
 {
-	TraceLoggingRegister(g_hBigDriveTraceProvider);
+	::QueryPerformanceFrequency(&s_frequency);
+
+	if (IsHistogramsConfigured())
+	{
+		EnableHistograms(TRUE);
+	}
+
+	TraceLoggingRegisterEx(g_hBigDriveTraceProvider, ProviderEnableCallback, nullptr);
 }
 
 /// <inheritdoc />
@@ -30,17 +41,32 @@ void BigDriveTraceLogger::Uninitialize()
 	TraceLoggingUnregister(g_hBigDriveTraceProvider);
 }
 
+/// <inheritdoc />
+void BigDriveTraceLogger::EnableHistograms(BOOL fEnable)
+{
+	::InterlockedExchange(&s_fHistogramsEnabled, fEnable ? 1 : 0);
+}
+
 /// <inheritdoc />
 void BigDriveTraceLogger::LogEvent(const char* message)
 {
+	if (!BigDriveTraceLogger::IsEnabled())
+	{
+		return;
+	}
+
 	TraceLoggingWrite(g_hBigDriveTraceProvider, "BigDriveShellFolderEvent", TraceLoggingValue(message, "Message"));
 }
 
 /// <inheritdoc />
 void BigDriveTraceLogger::LogEnter(LPCSTR functionName)
 {
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
-	TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"));
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"));
 }
 
 /// <inheritdoc />
@@ -49,13 +75,16 @@ void BigDriveTraceLogger::LogEnter(LPCSTR functionName, REFIID refiid)
 	HRESULT hr = S_OK;
 	BSTR bstrIIDName = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	hr = BigDriveTraceLogger::GetShellIIDName(refiid, bstrIIDName);
 	switch (hr)
 	{
 	case S_OK:
-		TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"));
+		TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingWideString(bstrIIDName, "IID"));
 		::SysFreeString(bstrIIDName);
 		break;
 	default:
@@ -71,13 +100,16 @@ void BigDriveTraceLogger::LogEnter(LPCSTR functionName, REFCLSID clsid, REFIID r
 	HRESULT hr = S_OK;
 	BSTR bstrIIDName = nullptr;
 
-	BigDriveTraceLogger::StoreCurrentTimeForDurationTracking();
+	if (!BigDriveTraceLogger::BeginSpan(functionName, BigDriveSpanKind_ShellMethod))
+	{
+		return;
+	}
 
 	hr = BigDriveTraceLogger::GetShellIIDName(riid, bstrIIDName);
 	switch (hr)
 	{
 	case S_OK:
-		TraceLoggingWrite(g_hBigDriveTraceProvider, "Enter", TraceLoggingString(functionName, "FunctionName"), TraceLoggingGuid(clsid, "CLSID"), TraceLoggingWideString(bstrIIDName, "IID"));
+		TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "Enter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(functionName, "FunctionName"), TraceLoggingGuid(clsid, "CLSID"), TraceLoggingWideString(bstrIIDName, "IID"));
 		::SysFreeString(bstrIIDName);
 		break;
 	default:
@@ -88,39 +120,204 @@ void BigDriveTraceLogger::LogEnter(LPCSTR functionName, REFCLSID clsid, REFIID r
 /// <inheritdoc />
 void BigDriveTraceLogger::LogExit(LPCSTR functionName, HRESULT hr)
 {
-	double elapsedMillisSeconds = BigDriveTraceLogger::GetElapsedSecondsSinceStoredTime() * 1000.0; // Convert to milliseconds
+	GUID activityId = GUID_NULL;
+	double elapsedMillisSeconds = 0.0;
+	double providerMilliseconds = 0.0;
 
-	TraceLoggingWrite(
+	if (!BigDriveTraceLogger::EndSpan(functionName, activityId, elapsedMillisSeconds, providerMilliseconds))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(
 		g_hBigDriveTraceProvider,
 		"Exit",
+		&activityId,
+		nullptr,
 		TraceLoggingString(functionName, "FunctionName"),
 		TraceLoggingValue(elapsedMillisSeconds, "Milliseconds"),
+		TraceLoggingValue(providerMilliseconds, "ProviderMilliseconds"),
 		TraceLoggingHexUInt32(hr, "HRESULT"));
 }
 
+/// <inheritdoc />
+void BigDriveTraceLogger::LogProviderEnter(LPCSTR callName)
+{
+	if (!BigDriveTraceLogger::BeginSpan(callName, BigDriveSpanKind_ProviderCall))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_hBigDriveTraceProvider, "ProviderEnter", BigDriveTraceLogger::GetSpanActivityId(), BigDriveTraceLogger::GetParentSpanActivityId(), TraceLoggingString(callName, "FunctionName"));
+}
+
+/// <inheritdoc />
+void BigDriveTraceLogger::LogProviderExit(LPCSTR callName, HRESULT hr)
+{
+	GUID activityId = GUID_NULL;
+	double elapsedMillisSeconds = 0.0;
+	double providerMilliseconds = 0.0;
+
+	if (!BigDriveTraceLogger::EndSpan(callName, activityId, elapsedMillisSeconds, providerMilliseconds))
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(
+		g_hBigDriveTraceProvider,
+		"ProviderExit",
+		&activityId,
+		nullptr,
+		TraceLoggingString(callName, "FunctionName"),
+		TraceLoggingValue(elapsedMillisSeconds, "Milliseconds"),
+		TraceLoggingHexUInt32(hr, "HRESULT"));
+}
 
 /// <inheritdoc />
-void BigDriveTraceLogger::StoreCurrentTimeForDurationTracking()
+bool BigDriveTraceLogger::BeginSpan(LPCSTR functionName, BigDriveSpanKind kind)
 {
-	::QueryPerformanceCounter(&s_startTime);
+	LARGE_INTEGER now;
+	BigDriveTraceSpan* pSpan = nullptr;
+	bool fEnabled = IsEnabled();
+
+	if (!fEnabled && (s_fHistogramsEnabled == 0))
+	{
+		return false;
+	}
+
+	if (s_spanDepth >= MaxSpanDepth)
+	{
+		return fEnabled;
+	}
+
+	::QueryPerformanceCounter(&now);
+
+	pSpan = &s_spans[s_spanDepth];
+	pSpan->szName = functionName;
+	pSpan->kind = kind;
+	pSpan->startTicks = now.QuadPart;
+	pSpan->providerTicks = 0;
+	pSpan->activityId = GUID_NULL;
+
+	// Activity IDs only matter to a listening session
+	if (fEnabled)
+	{
+		::EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID, &pSpan->activityId);
+	}
+
+	s_spanDepth++;
+
+	return fEnabled;
 }
 
 /// <inheritdoc />
-double BigDriveTraceLogger::GetElapsedSecondsSinceStoredTime()
+bool BigDriveTraceLogger::EndSpan(LPCSTR functionName, GUID& activityId, double& elapsedMilliseconds, double& providerMilliseconds)
 {
-	LARGE_INTEGER now, freq;
+	LARGE_INTEGER now;
+	BigDriveTraceSpan* pSpan = nullptr;
+	LONGLONG elapsedTicks = 0;
+	LONGLONG providerTicks = 0;
+	ULONG index = 0;
+	bool fFound = false;
+
+	activityId = GUID_NULL;
+	elapsedMilliseconds = 0.0;
+	providerMilliseconds = 0.0;
 
 	::QueryPerformanceCounter(&now);
-	::QueryPerformanceFrequency(&freq);
 
-	if (freq.QuadPart == 0)
+	// Innermost span of this function; spans above it were opened while tracing was off at exit
+	for (index = s_spanDepth; index > 0; index--)
+	{
+		pSpan = &s_spans[index - 1];
+		if ((pSpan->szName == functionName) || (::strcmp(pSpan->szName, functionName) == 0))
+		{
+			fFound = true;
+			break;
+		}
+	}
+
+	if (!fFound || (s_frequency.QuadPart == 0))
 	{
-		return 0.0;
+		return IsEnabled();
 	}
 
-	double result = (double)(now.QuadPart - s_startTime.QuadPart) / (double)freq.QuadPart;
+	s_spanDepth = index - 1;
+
+	elapsedTicks = now.QuadPart - pSpan->startTicks;
+	providerTicks = (pSpan->kind == BigDriveSpanKind_ProviderCall) ? elapsedTicks : pSpan->providerTicks;
+
+	// Provider time rolls up into every enclosing span
+	if (s_spanDepth > 0)
+	{
+		s_spans[s_spanDepth - 1].providerTicks += providerTicks;
+	}
+
+	activityId = pSpan->activityId;
+	elapsedMilliseconds = elapsedTicks * 1000.0 / s_frequency.QuadPart;
+	providerMilliseconds = providerTicks * 1000.0 / s_frequency.QuadPart;
+
+	BigDriveLatencyHistograms::GetInstance().Record(
+		pSpan->szName,
+		pSpan->kind,
+		static_cast<ULONGLONG>(elapsedTicks * 1000000 / s_frequency.QuadPart),
+		static_cast<ULONGLONG>(providerTicks * 1000000 / s_frequency.QuadPart));
+
+	return IsEnabled();
+}
+
+/// <inheritdoc />
+const GUID* BigDriveTraceLogger::GetSpanActivityId()
+{
+	if ((s_spanDepth == 0) || ::IsEqualGUID(s_spans[s_spanDepth - 1].activityId, GUID_NULL))
+	{
+		return nullptr;
+	}
+
+	return &s_spans[s_spanDepth - 1].activityId;
+}
+
+/// <inheritdoc />
+const GUID* BigDriveTraceLogger::GetParentSpanActivityId()
+{
+	if ((s_spanDepth < 2) || ::IsEqualGUID(s_spans[s_spanDepth - 2].activityId, GUID_NULL))
+	{
+		return nullptr;
+	}
+
+	return &s_spans[s_spanDepth - 2].activityId;
+}
+
+/// <inheritdoc />
+void NTAPI BigDriveTraceLogger::ProviderEnableCallback(LPCGUID pSourceId, ULONG isEnabled, UCHAR level, ULONGLONG matchAnyKeyword,
+	ULONGLONG matchAllKeyword, PEVENT_FILTER_DESCRIPTOR pFilterData, PVOID pCallbackContext)
+{
+	UNREFERENCED_PARAMETER(pSourceId);
+	UNREFERENCED_PARAMETER(level);
+	UNREFERENCED_PARAMETER(matchAnyKeyword);
+	UNREFERENCED_PARAMETER(matchAllKeyword);
+	UNREFERENCED_PARAMETER(pFilterData);
+	UNREFERENCED_PARAMETER(pCallbackContext);
+
+	// e.g. "xperf -capturestate BigDrive BigDrive.ShellFolder" dumps the histograms on demand
+	if (isEnabled == EVENT_CONTROL_CODE_CAPTURE_STATE)
+	{
+		BigDriveLatencyHistograms::GetInstance().WriteTraceEvents();
+	}
+}
+
+/// <inheritdoc />
+BOOL BigDriveTraceLogger::IsHistogramsConfigured()
+{
+	DWORD dwValue = 0;
+	DWORD cbValue = sizeof(dwValue);
+
+	if (::RegGetValueW(HKEY_LOCAL_MACHINE, L"SOFTWARE\\BigDrive\\ShellFolder", L"LatencyHistograms", RRF_RT_REG_DWORD, nullptr, &dwValue, &cbValue) != ERROR_SUCCESS)
+	{
+		return FALSE;
+	}
 
-	return result;
+	return dwValue != 0;
 }
 
 /// <inheritdoc />
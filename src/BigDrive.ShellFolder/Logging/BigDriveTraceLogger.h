@@ -7,30 +7,85 @@
 #include <TraceLoggingProvider.h>
 #include <shlobj.h> 
 
+#include "BigDriveLatencyHistograms.h"
+#include "..\..\BigDrive.Client\BigDrivePerformanceCounters.h"
+
 /// <summary>
 /// Hanldes the trace logging provider for the BigDrive Shell Folder.
 /// </summary>
 /// <param name=""></param>
 TRACELOGGING_DECLARE_PROVIDER(g_hBigDriveTraceProvider);
 
+/// <summary>
+/// A timed call on the current thread, from LogEnter to its LogExit.
+/// </summary>
+struct BigDriveTraceSpan
+{
+	/// <summary>
+	/// The function name passed to LogEnter.
+	/// </summary>
+	LPCSTR szName;
+
+	BigDriveSpanKind kind;
+
+	/// <summary>
+	/// Performance counter value at entry.
+	/// </summary>
+	LONGLONG startTicks;
+
+	/// <summary>
+	/// Performance counter ticks spent in provider calls made inside the span so far.
+	/// </summary>
+	LONGLONG providerTicks;
+
+	/// <summary>
+	/// ETW activity ID of the span; GUID_NULL when no session was listening at entry.
+	/// </summary>
+	GUID activityId;
+};
+
 /// <summary>
 /// Provides static, thread-safe methods for trace logging events and diagnostics related to the BigDrive Shell Folder.
 /// Supports logging function entry/exit, method parameters, and duration tracking for performance analysis.
+/// Each LogEnter opens a span on a per-thread stack, so nested calls keep their own start time, and Enter
+/// events carry the span's activity ID with the enclosing span's as the related activity ID. Spans feed
+/// BigDriveLatencyHistograms when a session is listening or histograms are turned on.
 /// </summary>
 class BigDriveTraceLogger
 {
 private:
 
 	/// <summary>
-	/// Thread-local storage for high-resolution timing, used to track method durations.
+	/// Deepest nesting of spans tracked; calls nested deeper are not timed.
+	/// </summary>
+	static const ULONG MaxSpanDepth = 32;
+
+	/// <summary>
+	/// The current thread's open spans, outermost first.
+	/// </summary>
+	static __declspec(thread) BigDriveTraceSpan s_spans[MaxSpanDepth];
+
+	/// <summary>
+	/// Number of open spans on the current thread.
+	/// </summary>
+	static __declspec(thread) ULONG s_spanDepth;
+
+	/// <summary>
+	/// Non-zero to time spans with no session listening, for the latency histograms.
+	/// </summary>
+	static volatile LONG s_fHistogramsEnabled;
+
+	/// <summary>
+	/// Performance counter frequency.
 	/// </summary>
-	static __declspec(thread) LARGE_INTEGER s_startTime;
+	static LARGE_INTEGER s_frequency;
 
 public:
 
 	/// <summary>
 	/// Registers the trace logging provider for the BigDrive Shell Folder.
-	/// Call this before any logging is performed.
+	/// Call this before any logging is performed. Latency histograms are turned on if the
+	/// LatencyHistograms value under HKLM\SOFTWARE\BigDrive\ShellFolder is non-zero.
 	/// </summary>
 	static void Initialize();
 
@@ -40,6 +95,32 @@ public:
 	/// </summary>
 	static void Uninitialize();
 
+	/// <summary>
+	/// Determines whether an ETW session is listening to the provider at the level and keyword the
+	/// events are written with (verbose, any keyword). It reads the enable state the provider keeps
+	/// in process, so callers can test it before formatting any arguments.
+	/// </summary>
+	/// <returns>true if events would be written; false otherwise.</returns>
+	static bool IsEnabled()
+	{
+		return TraceLoggingProviderEnabled(g_hBigDriveTraceProvider, WINEVENT_LEVEL_VERBOSE, 0) != FALSE;
+	}
+
+	/// <summary>
+	/// Determines whether spans are timed: a session is listening, or latency histograms are on.
+	/// </summary>
+	/// <returns>true if LogEnter and LogExit do any work; false otherwise.</returns>
+	static bool IsTimingEnabled()
+	{
+		return IsEnabled() || (s_fHistogramsEnabled != 0);
+	}
+
+	/// <summary>
+	/// Turns the latency histograms on or off for spans timed with no session listening.
+	/// </summary>
+	/// <param name="fEnable">TRUE to time every span.</param>
+	static void EnableHistograms(BOOL fEnable);
+
 	/// <summary>
 	/// Logs a custom informational event message.
 	/// </summary>
@@ -74,19 +155,63 @@ public:
 	/// <param name="hr">The HRESULT returned by the function.</param>
 	static void LogExit(LPCSTR functionName, HRESULT hr);
 
+	/// <summary>
+	/// Logs the start of a call to the provider, timed into the enclosing span's provider time.
+	/// </summary>
+	/// <param name="callName">The provider method, e.g. "IBigDriveFileInfo::GetFileSize".</param>
+	static void LogProviderEnter(LPCSTR callName);
+
+	/// <summary>
+	/// Logs the end of a call to the provider.
+	/// </summary>
+	/// <param name="callName">The provider method passed to LogProviderEnter.</param>
+	/// <param name="hr">The HRESULT the provider returned.</param>
+	static void LogProviderExit(LPCSTR callName, HRESULT hr);
+
 private:
 
 	/// <summary>
-	/// Stores the current high-resolution time in thread-local storage for duration tracking.
-	/// Called at function entry to enable later measurement of elapsed time.
+	/// Opens a span on the current thread, with a new activity ID if a session is listening.
+	/// </summary>
+	/// <param name="functionName">The function name; must have static storage.</param>
+	/// <param name="kind">Whether the span is a shell method or a provider call.</param>
+	/// <returns>true if a session is listening and the Enter event should be written; false otherwise.</returns>
+	static bool BeginSpan(LPCSTR functionName, BigDriveSpanKind kind);
+
+	/// <summary>
+	/// Closes the innermost open span of a function, dropping any spans opened inside it that
+	/// were never closed, and records it in the latency histograms.
+	/// </summary>
+	/// <param name="functionName">The function name passed to BeginSpan.</param>
+	/// <param name="activityId">Receives the span's activity ID; GUID_NULL if no span was open.</param>
+	/// <param name="elapsedMilliseconds">Receives the span's duration; zero if no span was open.</param>
+	/// <param name="providerMilliseconds">Receives the time spent in provider calls inside the span.</param>
+	/// <returns>true if a session is listening and the Exit event should be written; false otherwise.</returns>
+	static bool EndSpan(LPCSTR functionName, GUID& activityId, double& elapsedMilliseconds, double& providerMilliseconds);
+
+	/// <summary>
+	/// Returns the activity ID of the current thread's innermost span, or nullptr if it has none.
+	/// </summary>
+	static const GUID* GetSpanActivityId();
+
+	/// <summary>
+	/// Returns the activity ID of the span enclosing the innermost span, or nullptr if it has none.
+	/// </summary>
+	static const GUID* GetParentSpanActivityId();
+
+	/// <summary>
+	/// Receives enable, disable and capture-state requests from trace sessions. A capture-state
+	/// request writes the latency histograms.
 	/// </summary>
-	static void StoreCurrentTimeForDurationTracking();
+	static void NTAPI ProviderEnableCallback(LPCGUID pSourceId, ULONG isEnabled, UCHAR level, ULONGLONG matchAnyKeyword,
+		ULONGLONG matchAllKeyword, PEVENT_FILTER_DESCRIPTOR pFilterData, PVOID pCallbackContext);
 
 	/// <summary>
-	/// Gets the elapsed time in seconds since the last call to StoreCurrentTimeForDurationTracking on the current thread.
+	/// Reads the LatencyHistograms registry value.
 	/// </summary>
-	/// <returns>Elapsed time in seconds as a double.</returns>
-	static double GetElapsedSecondsSinceStoredTime();
+	static BOOL IsHistogramsConfigured();
+
+public:
 
 	/// <summary>
 	/// Attempts to map a well-known shell IID to its common name as a BSTR.
@@ -99,10 +224,55 @@ private:
 	/// <returns>S_OK if found, S_FALSE if not found.</returns>
 	static HRESULT GetShellIIDName(REFIID riid, BSTR& bstrIIDName);
 
+	/// <summary>
+	/// Attempts to map a well-known property set GUID to its name as a BSTR.
+	/// The caller is responsible for freeing bstrPSGUID with ::SysFreeString.
+	/// </summary>
+	/// <param name="guid">The FMTID to look up.</param>
+	/// <param name="bstrPSGUID">[out] Receives the allocated BSTR with the name.</param>
+	/// <returns>S_OK on success; otherwise, an HRESULT error code.</returns>
 	static HRESULT GetFMTIDName(REFGUID guid, BSTR& bstrPSGUID);
 
 private:
 
 	// Grant access to all private/protected members
 	friend class BigDriveShellFolderTraceLogger;
-};
\ No newline at end of file
+};
+
+/// <summary>
+/// Counts a call to the provider in the shared performance counters, and times it when spans are
+/// timed. With no session listening and histograms off it costs three relaxed interlocked adds and
+/// one test; the call's counter slot is looked up once per call site.
+/// </summary>
+#define BIGDRIVE_TRACE_PROVIDER_ENTER(callName) \
+	do { \
+		static volatile LONG s_counterSlot = -1; \
+		BigDrivePerformanceCounters::BeginProviderCall(callName, s_counterSlot); \
+		if (BigDriveTraceLogger::IsTimingEnabled()) { BigDriveTraceLogger::LogProviderEnter(callName); } \
+	} while (0)
+
+/// <summary>
+/// Ends the count and timing of a call to the provider.
+/// </summary>
+#define BIGDRIVE_TRACE_PROVIDER_EXIT(callName, hr) \
+	do { \
+		BigDrivePerformanceCounters::EndProviderCall(hr); \
+		if (BigDriveTraceLogger::IsTimingEnabled()) { BigDriveTraceLogger::LogProviderExit(callName, hr); } \
+	} while (0)
+
+/// <summary>
+/// Times a call made through BigDriveInterfaceProvider, which counts it in BigDrive.Client. The time
+/// includes any wait on an identical call already in flight.
+/// </summary>
+#define BIGDRIVE_TRACE_SHARED_PROVIDER_ENTER(callName) \
+	do { \
+		if (BigDriveTraceLogger::IsTimingEnabled()) { BigDriveTraceLogger::LogProviderEnter(callName); } \
+	} while (0)
+
+/// <summary>
+/// Ends the timing of a call made through BigDriveInterfaceProvider.
+/// </summary>
+#define BIGDRIVE_TRACE_SHARED_PROVIDER_EXIT(callName, hr) \
+	do { \
+		if (BigDriveTraceLogger::IsTimingEnabled()) { BigDriveTraceLogger::LogProviderExit(callName, hr); } \
+	} while (0)
@@ -30,6 +30,7 @@
 // BigDrive.Client
 #include "..\BigDrive.Client\BigDriveClientConfigurationManager.h"
 #include "..\BigDrive.Client\BigDriveConfigurationClient.h"
+#include "..\BigDrive.Client\BigDriveClsidSetCache.h"
 
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 BigDriveShellFolderEventLogger RegistrationManager::s_eventLogger(L"BigDrive.ShellFolder");
@@ -664,6 +665,9 @@ HRESULT RegistrationManager::CleanUpShellFolders()
 		hKey = nullptr;
 	}
 
+	// Drives may have been unregistered; the next class-object request reads the set again
+	BigDriveClsidSetCache::GetInstance().Invalidate();
+
 	return hr;
 }
 
@@ -17,6 +17,7 @@
 #include "RegistrationManager.h"
 #include "Logging\BigDriveTraceLogger.h"
 #include "..\BigDrive.Client\ApplicationManager.h"
+#include "..\BigDrive.Client\BigDriveClsidSetCache.h"
 
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 
@@ -87,6 +88,9 @@ extern "C" HRESULT __stdcall DllRegisterServer()
         goto End;
     }
 
+    // Registration changes the set of drives; the next class-object request reads it again
+    BigDriveClsidSetCache::GetInstance().Invalidate();
+
     /*
     // Registers all COM+ applications (providers) and their components that support the IBigDriveRegistration interface.
     // This method enumerates applications and their components using the COMAdminCatalog, queries for the
@@ -153,8 +157,6 @@ extern "C" HRESULT __stdcall DllUnregisterServer()
 extern "C" HRESULT __stdcall DllGetClassObject(_In_ REFCLSID rclsid, _In_ REFIID riid, _Outptr_ LPVOID* ppv)
 {
     HRESULT hr = S_OK;
-    CLSID* pclsid = nullptr;
-    DWORD dwSize = 0;
     BigDriveShellFolderFactory* pFactory = nullptr;
 
     BigDriveTraceLogger::LogEnter(__FUNCTION__, rclsid, riid);
@@ -168,36 +170,33 @@ extern "C" HRESULT __stdcall DllGetClassObject(_In_ REFCLSID rclsid, _In_ REFIID
     // Ensure the output pointer is initialized to nullptr.
     *ppv = nullptr;
 
-    hr = RegistrationManager::GetRegisteredCLSIDs(&pclsid, dwSize);
+    // Explorer asks on every This PC refresh and new window; the set is read from the registry once
+    hr = BigDriveClsidSetCache::GetInstance().Contains(rclsid);
     if (FAILED(hr))
     {
         goto End;
     }
 
-    for (int i = 0; pclsid[i] != GUID_NULL; i++)
+    if (hr == S_FALSE)
     {
-        if (pclsid[i] == rclsid)
-        {
-            // The CLSID matches, create the factory, with the CLSID as the drive guid
-            // the Shell Folder is registered as a COM component using the drive guid.
-            pFactory = new BigDriveShellFolderFactory(rclsid);
-            if (!pFactory)
-            {
-                hr = E_OUTOFMEMORY;
-                goto End;
-            }
-
-            hr = pFactory->QueryInterface(riid, ppv);
-            if (FAILED(hr))
-            {
-                goto End;
-            }
-
-            goto End;
-        }
+        hr = CLASS_E_CLASSNOTAVAILABLE;
+        goto End;
     }
 
-    hr = CLASS_E_CLASSNOTAVAILABLE;
+    // The CLSID matches, create the factory, with the CLSID as the drive guid
+    // the Shell Folder is registered as a COM component using the drive guid.
+    pFactory = new BigDriveShellFolderFactory(rclsid);
+    if (!pFactory)
+    {
+        hr = E_OUTOFMEMORY;
+        goto End;
+    }
+
+    hr = pFactory->QueryInterface(riid, ppv);
+    if (FAILED(hr))
+    {
+        goto End;
+    }
 
 End:
 
@@ -209,12 +208,6 @@ End:
         pFactory = nullptr;
     }
 
-    if (pclsid)
-    {
-        CoTaskMemFree(pclsid);
-        pclsid = nullptr;
-    }
-
     BigDriveTraceLogger::LogExit(__FUNCTION__, hr);
 
     return hr;
@@ -0,0 +1,56 @@
+// <copyright file="IBigDriveEnumerateEx.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces
+{
+    using System;
+    using System.Runtime.InteropServices;
+
+    /// <summary>
+    /// Interface for enumerating folders and files, with their metadata, in a single call.
+    /// </summary>
+    /// <remarks>
+    /// <para>
+    /// <see cref="IBigDriveEnumerate"/> returns names only, so opening a folder costs two
+    /// calls plus two <see cref="IBigDriveFileInfo"/> calls per file to fill the Size and
+    /// Date Modified columns. This interface returns every entry and its metadata in one
+    /// round trip.
+    /// </para>
+    /// <para>
+    /// This interface is optional. The shell queries for it first and falls back to
+    /// <see cref="IBigDriveEnumerate"/> when the provider does not implement it.
+    /// </para>
+    /// <para>
+    /// <strong>COM Marshaling Note:</strong> Entries are returned as a packed <c>byte[]</c>
+    /// produced by <see cref="Serialization.EnumerationEntrySerializer"/>, because arrays of
+    /// structs do not marshal across the out-of-process IUnknown boundary. The flags are an
+    /// <c>int</c> rather than the <see cref="Model.EnumerateEntriesFlags"/> enum for the same reason.
+    /// </para>
+    /// <para>
+    /// This is a separate interface from <see cref="IBigDriveEnumerate"/> because adding
+    /// methods to an existing COM interface changes its vtable layout.
+    /// </para>
+    /// </remarks>
+    [ComVisible(true)]
+    [Guid("5C0E6B21-7A43-4F5D-9E8B-2D1F3A6C8E94")]
+    [InterfaceType(ComInterfaceType.InterfaceIsIUnknown)]
+    public interface IBigDriveEnumerateEx
+    {
+        /// <summary>
+        /// Returns the folders and files in the specified path, with their metadata.
+        /// </summary>
+        /// <param name="driveGuid">Registered Drive Identifier.</param>
+        /// <param name="path">
+        /// Path to enumerate. Uses backslash separator, starts with "\" (e.g., "\", "\FolderName").
+        /// </param>
+        /// <param name="flags">
+        /// <see cref="Model.EnumerateEntriesFlags"/> bits selecting folders, files or both.
+        /// </param>
+        /// <returns>
+        /// The entries packed by <see cref="Serialization.EnumerationEntrySerializer.Serialize"/>.
+        /// Entry names are names only, not full paths, as with <see cref="IBigDriveEnumerate"/>.
+        /// </returns>
+        byte[] EnumerateEntries(Guid driveGuid, string path, int flags);
+    }
+}
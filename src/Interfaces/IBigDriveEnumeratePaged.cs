@@ -0,0 +1,58 @@
+// <copyright file="IBigDriveEnumeratePaged.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces
+{
+    using System;
+    using System.Runtime.InteropServices;
+
+    /// <summary>
+    /// Interface for enumerating folders and files, with their metadata, one page at a time.
+    /// </summary>
+    /// <remarks>
+    /// <para>
+    /// <see cref="IBigDriveEnumerateEx"/> returns a whole folder in one call, so the shell
+    /// view shows nothing until the last entry has been listed and explorer.exe holds every
+    /// entry at once. This interface returns a page of entries and a continuation cursor;
+    /// the shell asks for the next page only when the view has consumed the current one.
+    /// </para>
+    /// <para>
+    /// This interface is optional. The shell queries for it first, then for
+    /// <see cref="IBigDriveEnumerateEx"/>, then falls back to <see cref="IBigDriveEnumerate"/>.
+    /// </para>
+    /// <para>
+    /// The cursor is opaque to the shell. Providers that cannot page at the source can use
+    /// <see cref="Serialization.EnumerationPager"/>, which keeps a short-lived snapshot of the
+    /// listing so every page is read from the same listing.
+    /// </para>
+    /// </remarks>
+    [ComVisible(true)]
+    [Guid("8D4F2A63-1B7E-4C95-A3D0-6E9B5F1C2A78")]
+    [InterfaceType(ComInterfaceType.InterfaceIsIUnknown)]
+    public interface IBigDriveEnumeratePaged
+    {
+        /// <summary>
+        /// Returns a page of the folders and files in the specified path, with their metadata.
+        /// </summary>
+        /// <param name="driveGuid">Registered Drive Identifier.</param>
+        /// <param name="path">
+        /// Path to enumerate. Uses backslash separator, starts with "\" (e.g., "\", "\FolderName").
+        /// </param>
+        /// <param name="flags">
+        /// <see cref="Model.EnumerateEntriesFlags"/> bits selecting folders, files or both.
+        /// </param>
+        /// <param name="cursor">
+        /// Null or empty for the first page; otherwise the <paramref name="nextCursor"/> returned
+        /// with the previous page.
+        /// </param>
+        /// <param name="pageSize">The maximum number of entries to return.</param>
+        /// <param name="nextCursor">
+        /// Receives the cursor of the next page, or null when this is the last page.
+        /// </param>
+        /// <returns>
+        /// The entries packed by <see cref="Serialization.EnumerationEntrySerializer.Serialize"/>.
+        /// </returns>
+        byte[] EnumerateEntriesPage(Guid driveGuid, string path, int flags, string cursor, int pageSize, out string nextCursor);
+    }
+}
@@ -0,0 +1,57 @@
+// <copyright file="IBigDriveFileInfoBatch.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces
+{
+    using System;
+    using System.Runtime.InteropServices;
+
+    /// <summary>
+    /// Interface for retrieving the metadata of many files in a single call.
+    /// </summary>
+    /// <remarks>
+    /// <para>
+    /// <see cref="IBigDriveFileInfo"/> answers one field of one path per call, so filling the
+    /// Size and Date Modified columns of a folder listed by <see cref="IBigDriveEnumerate"/>
+    /// costs two round trips per file. This interface answers every requested field of a
+    /// batch of paths in one round trip, and lets the provider open its backing store once
+    /// for the whole batch.
+    /// </para>
+    /// <para>
+    /// This interface is optional. The shell queries for it when an item's metadata is not
+    /// already known and falls back to <see cref="IBigDriveFileInfo"/> when the provider does
+    /// not implement it.
+    /// </para>
+    /// <para>
+    /// <strong>COM Marshaling Note:</strong> Records are returned as a packed <c>byte[]</c>
+    /// produced by <see cref="Serialization.EnumerationEntrySerializer"/>, because arrays of
+    /// structs do not marshal across the out-of-process IUnknown boundary. The fields are an
+    /// <c>int</c> rather than the <see cref="Model.FileInfoFields"/> enum for the same reason.
+    /// </para>
+    /// </remarks>
+    [ComVisible(true)]
+    [Guid("E3A17C52-9D4B-4E08-B6F1-7C2D5A8E4B19")]
+    [InterfaceType(ComInterfaceType.InterfaceIsIUnknown)]
+    public interface IBigDriveFileInfoBatch
+    {
+        /// <summary>
+        /// Returns the metadata of each of the specified paths.
+        /// </summary>
+        /// <param name="driveGuid">Registered Drive Identifier.</param>
+        /// <param name="paths">
+        /// Full paths within the drive. Use backslash separator and start with "\"
+        /// (e.g., "\FolderName\File.txt").
+        /// </param>
+        /// <param name="fields">
+        /// <see cref="Model.FileInfoFields"/> bits naming the values the shell needs. A provider
+        /// may return more than it was asked for.
+        /// </param>
+        /// <returns>
+        /// One entry per path, in the order of <paramref name="paths"/>, packed by
+        /// <see cref="Serialization.EnumerationEntrySerializer.Serialize"/>. Each entry's name
+        /// is the path it answers. A path that does not exist is returned with no values set.
+        /// </returns>
+        byte[] GetFileInfoBatch(Guid driveGuid, string[] paths, int fields);
+    }
+}
@@ -0,0 +1,56 @@
+// <copyright file="IBigDriveStreamOperations.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces
+{
+    using System;
+    using System.Runtime.InteropServices;
+    using System.Runtime.InteropServices.ComTypes;
+
+    /// <summary>
+    /// Interface for uploading file data to BigDrive storage from a COM stream.
+    /// </summary>
+    /// <remarks>
+    /// <para>
+    /// <see cref="IBigDriveFileOperations.CopyFileToBigDrive"/> takes a local file path, so data
+    /// that isn't a local file (a virtual file dragged from another application, a file on another
+    /// BigDrive drive) first has to be written to a temp file and then read back by the provider.
+    /// This interface hands the provider the source stream instead; the provider reads it as the
+    /// data arrives and nothing touches the local disk.
+    /// </para>
+    /// <para>
+    /// This interface is optional. Callers query for it and fall back to a temp file and
+    /// <see cref="IBigDriveFileOperations.CopyFileToBigDrive"/> when the provider doesn't
+    /// implement it.
+    /// </para>
+    /// <para>
+    /// <strong>Path Format:</strong> <c>bigDriveTargetPath</c> is the full path of the file
+    /// to create, including its name, since a stream has no file name of its own. It follows the
+    /// conventions of <see cref="IBigDriveFileOperations"/>.
+    /// </para>
+    /// </remarks>
+    [ComVisible(true)]
+    [Guid("4E6B9C21-7D3A-4F58-B1E2-9A0C5D8F3B46")]
+    [InterfaceType(ComInterfaceType.InterfaceIsIUnknown)]
+    public interface IBigDriveStreamOperations
+    {
+        /// <summary>
+        /// Copies the data of a stream to a file in BigDrive storage, replacing it if it exists.
+        /// </summary>
+        /// <param name="driveGuid">The registered Drive Identifier.</param>
+        /// <param name="stream">
+        /// The data, read from its current position to its end. The stream may not be seekable;
+        /// providers should read it once, front to back.
+        /// </param>
+        /// <param name="bigDriveTargetPath">The full path of the file in BigDrive (e.g., "\folder\file.txt").</param>
+        /// <param name="size">Size of the data in bytes, or -1 if unknown. A hint; the stream's end is authoritative.</param>
+        /// <param name="lastWriteTime">Last write time of the source as a UTC FILETIME, or 0 if unknown.</param>
+        void CopyStreamToBigDrive(
+            [MarshalAs(UnmanagedType.LPStruct)] Guid driveGuid,
+            [MarshalAs(UnmanagedType.Interface)] IStream stream,
+            [MarshalAs(UnmanagedType.LPWStr)] string bigDriveTargetPath,
+            long size,
+            long lastWriteTime);
+    }
+}
@@ -0,0 +1,31 @@
+// <copyright file="EnumerateEntriesFlags.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces.Model
+{
+    using System;
+
+    /// <summary>
+    /// Flags selecting which entries <see cref="IBigDriveEnumerateEx.EnumerateEntries"/> returns.
+    /// Passed as an <c>int</c> across COM.
+    /// </summary>
+    [Flags]
+    public enum EnumerateEntriesFlags
+    {
+        /// <summary>
+        /// Return folders.
+        /// </summary>
+        Folders = 1,
+
+        /// <summary>
+        /// Return files.
+        /// </summary>
+        Files = 2,
+
+        /// <summary>
+        /// Return folders and files.
+        /// </summary>
+        All = Folders | Files
+    }
+}
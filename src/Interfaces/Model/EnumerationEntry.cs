@@ -0,0 +1,59 @@
+// <copyright file="EnumerationEntry.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces.Model
+{
+    using System;
+    using System.IO;
+
+    /// <summary>
+    /// A folder or file returned by <see cref="IBigDriveEnumerateEx.EnumerateEntries"/>.
+    /// </summary>
+    /// <remarks>
+    /// Optional values left null are omitted from the packed record, and the shell
+    /// falls back to <see cref="IBigDriveFileInfo"/> for them.
+    /// Use <see cref="Serialization.EnumerationEntrySerializer.Serialize"/> to pack
+    /// an array of entries.
+    /// </remarks>
+    public class EnumerationEntry
+    {
+        /// <summary>
+        /// Gets or sets the entry name (not the full path).
+        /// </summary>
+        public string Name { get; set; }
+
+        /// <summary>
+        /// Gets or sets a value indicating whether the entry is a folder.
+        /// </summary>
+        public bool IsFolder { get; set; }
+
+        /// <summary>
+        /// Gets or sets the size in bytes, or null if unknown.
+        /// </summary>
+        public ulong? Size { get; set; }
+
+        /// <summary>
+        /// Gets or sets the last write time, or null if unknown.
+        /// </summary>
+        public DateTime? LastWriteTime { get; set; }
+
+        /// <summary>
+        /// Gets or sets the file attributes, or null if unknown.
+        /// </summary>
+        public FileAttributes? Attributes { get; set; }
+
+        /// <summary>
+        /// Gets or sets an opaque version tag (for example an HTTP ETag or a CRC) that
+        /// changes when the entry changes, or null if the provider has none.
+        /// </summary>
+        public string ETag { get; set; }
+
+        /// <summary>
+        /// Gets or sets a value indicating whether a folder has children, or null if the
+        /// provider doesn't know cheaply. Explorer uses it to decide whether to draw an
+        /// expand arrow without listing the folder.
+        /// </summary>
+        public bool? HasChildren { get; set; }
+    }
+}
@@ -0,0 +1,37 @@
+// <copyright file="FileInfoFields.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces.Model
+{
+    using System;
+
+    /// <summary>
+    /// Flags naming the values <see cref="IBigDriveFileInfoBatch.GetFileInfoBatch"/> is asked for.
+    /// Passed as an <c>int</c> across COM. The values match the record field bits of
+    /// <see cref="Serialization.EnumerationEntrySerializer"/>.
+    /// </summary>
+    [Flags]
+    public enum FileInfoFields
+    {
+        /// <summary>
+        /// The size in bytes.
+        /// </summary>
+        Size = 1,
+
+        /// <summary>
+        /// The last write time.
+        /// </summary>
+        LastWriteTime = 2,
+
+        /// <summary>
+        /// The file attributes.
+        /// </summary>
+        Attributes = 4,
+
+        /// <summary>
+        /// Every value.
+        /// </summary>
+        All = Size | LastWriteTime | Attributes
+    }
+}
@@ -0,0 +1,177 @@
+// <copyright file="EnumerationEntrySerializer.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces.Serialization
+{
+    using System;
+    using System.Collections.Generic;
+    using System.IO;
+    using System.Text;
+
+    using BigDrive.Interfaces.Model;
+
+    /// <summary>
+    /// Zero-dependency packer for <see cref="EnumerationEntry"/> arrays returned by
+    /// <see cref="IBigDriveEnumerateEx.EnumerateEntries"/>.
+    /// </summary>
+    /// <remarks>
+    /// <para>
+    /// The layout is little endian and must match BigDriveEnumerationReader in BigDrive.Client:
+    /// </para>
+    /// <code>
+    /// Header:  UInt32 signature ('BDEN')  UInt16 version  UInt16 reserved  UInt32 count
+    /// Record:  UInt32 cbRecord  UInt32 type (0 file, 1 folder)  UInt32 fields  UInt32 attributes
+    ///          UInt64 size  Int64 lastWrite (FILETIME, UTC)  UInt16 cchName  UInt16 cchETag
+    ///          UTF-16 name[cchName]  UTF-16 etag[cchETag]
+    /// </code>
+    /// <para>
+    /// <c>fields</c> says which optional values are present (1 size, 2 last write time,
+    /// 4 attributes, 8 etag, 0x10 has children, 0x20 has no children; the last two carry no
+    /// value). <c>cbRecord</c> lets later versions append fields that older
+    /// readers skip.
+    /// </para>
+    /// </remarks>
+    public static class EnumerationEntrySerializer
+    {
+        /// <summary>
+        /// Signature of the packed buffer ('BDEN').
+        /// </summary>
+        public const uint Signature = 0x4E454442;
+
+        /// <summary>
+        /// Version of the packed buffer.
+        /// </summary>
+        public const ushort Version = 1;
+
+        /// <summary>
+        /// Size in bytes of the fixed part of a record.
+        /// </summary>
+        public const int FixedRecordSize = 36;
+
+        private const uint FieldSize = 0x01;
+        private const uint FieldLastWriteTime = 0x02;
+        private const uint FieldAttributes = 0x04;
+        private const uint FieldETag = 0x08;
+        private const uint FieldHasChildren = 0x10;
+        private const uint FieldNoChildren = 0x20;
+
+        /// <summary>
+        /// Packs the entries into the buffer returned by <see cref="IBigDriveEnumerateEx.EnumerateEntries"/>.
+        /// </summary>
+        /// <param name="entries">The entries to pack. Null packs an empty buffer.</param>
+        /// <returns>The packed buffer.</returns>
+        public static byte[] Serialize(ICollection<EnumerationEntry> entries)
+        {
+            int count = (entries == null) ? 0 : entries.Count;
+
+            using (MemoryStream stream = new MemoryStream(12 + (count * (FixedRecordSize + 32))))
+            using (BinaryWriter writer = new BinaryWriter(stream, Encoding.Unicode))
+            {
+                writer.Write(Signature);
+                writer.Write(Version);
+                writer.Write((ushort)0);
+                writer.Write((uint)count);
+
+                if (entries != null)
+                {
+                    foreach (EnumerationEntry entry in entries)
+                    {
+                        WriteRecord(writer, entry);
+                    }
+                }
+
+                writer.Flush();
+                return stream.ToArray();
+            }
+        }
+
+        /// <summary>
+        /// Packs the answers to <see cref="IBigDriveFileInfoBatch.GetFileInfoBatch"/>: one record per path, in order,
+        /// named by the path. A path without an answer gets a record with no values set.
+        /// </summary>
+        /// <param name="paths">The paths that were asked for.</param>
+        /// <param name="entries">
+        /// The metadata of each path, at the same index, or null where the path was not found. The entries'
+        /// names are ignored. Null answers no path.
+        /// </param>
+        /// <returns>The packed buffer.</returns>
+        public static byte[] SerializeFileInfo(IList<string> paths, IList<EnumerationEntry> entries)
+        {
+            int count = (paths == null) ? 0 : paths.Count;
+            List<EnumerationEntry> records = new List<EnumerationEntry>(count);
+
+            for (int i = 0; i < count; i++)
+            {
+                EnumerationEntry entry = ((entries != null) && (i < entries.Count)) ? entries[i] : null;
+
+                records.Add(new EnumerationEntry
+                {
+                    Name = paths[i],
+                    IsFolder = (entry != null) && entry.IsFolder,
+                    Size = entry?.Size,
+                    LastWriteTime = entry?.LastWriteTime,
+                    Attributes = entry?.Attributes,
+                });
+            }
+
+            return Serialize(records);
+        }
+
+        /// <summary>
+        /// Writes a single record.
+        /// </summary>
+        /// <param name="writer">The writer to append to.</param>
+        /// <param name="entry">The entry to write.</param>
+        private static void WriteRecord(BinaryWriter writer, EnumerationEntry entry)
+        {
+            string name = entry.Name ?? string.Empty;
+            string etag = entry.ETag ?? string.Empty;
+
+            if (name.Length > ushort.MaxValue || etag.Length > ushort.MaxValue)
+            {
+                throw new ArgumentException($"Entry name or etag is too long: {name}");
+            }
+
+            uint fields = 0;
+            long lastWrite = 0;
+
+            if (entry.Size.HasValue)
+            {
+                fields |= FieldSize;
+            }
+
+            if (entry.LastWriteTime.HasValue && entry.LastWriteTime.Value.Year >= 1601)
+            {
+                fields |= FieldLastWriteTime;
+                lastWrite = entry.LastWriteTime.Value.ToFileTimeUtc();
+            }
+
+            if (entry.Attributes.HasValue)
+            {
+                fields |= FieldAttributes;
+            }
+
+            if (etag.Length > 0)
+            {
+                fields |= FieldETag;
+            }
+
+            if (entry.HasChildren.HasValue)
+            {
+                fields |= entry.HasChildren.Value ? FieldHasChildren : FieldNoChildren;
+            }
+
+            writer.Write((uint)(FixedRecordSize + ((name.Length + etag.Length) * 2)));
+            writer.Write(entry.IsFolder ? 1u : 0u);
+            writer.Write(fields);
+            writer.Write(entry.Attributes.HasValue ? (uint)entry.Attributes.Value : 0u);
+            writer.Write(entry.Size ?? 0UL);
+            writer.Write(lastWrite);
+            writer.Write((ushort)name.Length);
+            writer.Write((ushort)etag.Length);
+            writer.Write(name.ToCharArray());
+            writer.Write(etag.ToCharArray());
+        }
+    }
+}
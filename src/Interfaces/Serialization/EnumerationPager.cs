@@ -0,0 +1,227 @@
+// <copyright file="EnumerationPager.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Interfaces.Serialization
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Globalization;
+
+    using BigDrive.Interfaces.Model;
+
+    /// <summary>
+    /// Pages a listing for <see cref="IBigDriveEnumeratePaged.EnumerateEntriesPage"/> on behalf of
+    /// providers that can only list a folder in one go (archives, disk images, cached albums).
+    /// </summary>
+    /// <remarks>
+    /// <para>
+    /// The first page loads the listing. If it doesn't fit in one page, the listing is kept as a
+    /// snapshot in the provider process and the cursor names the snapshot and the offset of the
+    /// next page ("snapshot:offset"), so later pages are sliced from the same listing instead of
+    /// reading the source again.
+    /// </para>
+    /// <para>
+    /// Snapshots are dropped when their last page is served, when they have not been read for
+    /// <see cref="SnapshotLifetime"/>, or when more than <see cref="MaxSnapshots"/> are open. A
+    /// cursor whose snapshot is gone reloads the listing and resumes at the same offset.
+    /// </para>
+    /// </remarks>
+    public static class EnumerationPager
+    {
+        /// <summary>
+        /// Page size used when the caller passes zero or less.
+        /// </summary>
+        public const int DefaultPageSize = 1000;
+
+        /// <summary>
+        /// Largest page the pager returns, whatever the caller asks for.
+        /// </summary>
+        public const int MaxPageSize = 10000;
+
+        /// <summary>
+        /// Maximum number of snapshots kept open at once.
+        /// </summary>
+        public const int MaxSnapshots = 16;
+
+        /// <summary>
+        /// Time after which a snapshot that has not been read is dropped.
+        /// </summary>
+        public static readonly TimeSpan SnapshotLifetime = TimeSpan.FromMinutes(2);
+
+        private static readonly object SyncRoot = new object();
+
+        private static readonly Dictionary<string, Snapshot> Snapshots = new Dictionary<string, Snapshot>(StringComparer.Ordinal);
+
+        /// <summary>
+        /// Returns the page named by the cursor.
+        /// </summary>
+        /// <param name="cursor">Null or empty for the first page; otherwise a cursor returned by this method.</param>
+        /// <param name="pageSize">The maximum number of entries to return.</param>
+        /// <param name="load">Loads the whole listing. Called for the first page and when a snapshot has expired.</param>
+        /// <param name="nextCursor">Receives the cursor of the next page, or null when this is the last page.</param>
+        /// <returns>The page packed by <see cref="EnumerationEntrySerializer.Serialize"/>.</returns>
+        public static byte[] GetPage(string cursor, int pageSize, Func<List<EnumerationEntry>> load, out string nextCursor)
+        {
+            if (load == null)
+            {
+                throw new ArgumentNullException(nameof(load));
+            }
+
+            nextCursor = null;
+            pageSize = (pageSize <= 0) ? DefaultPageSize : Math.Min(pageSize, MaxPageSize);
+
+            string snapshotId = null;
+            int offset = 0;
+            List<EnumerationEntry> entries = null;
+
+            if (!string.IsNullOrEmpty(cursor))
+            {
+                if (!TryParseCursor(cursor, out snapshotId, out offset))
+                {
+                    throw new ArgumentException("The cursor was not returned by this provider.", nameof(cursor));
+                }
+
+                entries = GetSnapshot(snapshotId);
+            }
+
+            if (entries == null)
+            {
+                entries = load() ?? new List<EnumerationEntry>();
+            }
+
+            if (offset >= entries.Count)
+            {
+                RemoveSnapshot(snapshotId);
+                return EnumerationEntrySerializer.Serialize(null);
+            }
+
+            int count = Math.Min(pageSize, entries.Count - offset);
+
+            if (offset + count < entries.Count)
+            {
+                if (snapshotId == null)
+                {
+                    snapshotId = Guid.NewGuid().ToString("N");
+                }
+
+                AddSnapshot(snapshotId, entries);
+                nextCursor = snapshotId + ":" + (offset + count).ToString(CultureInfo.InvariantCulture);
+            }
+            else
+            {
+                RemoveSnapshot(snapshotId);
+            }
+
+            return EnumerationEntrySerializer.Serialize(entries.GetRange(offset, count));
+        }
+
+        private static bool TryParseCursor(string cursor, out string snapshotId, out int offset)
+        {
+            snapshotId = null;
+            offset = 0;
+
+            int separator = cursor.LastIndexOf(':');
+            if (separator <= 0)
+            {
+                return false;
+            }
+
+            snapshotId = cursor.Substring(0, separator);
+            return int.TryParse(cursor.Substring(separator + 1), NumberStyles.None, CultureInfo.InvariantCulture, out offset);
+        }
+
+        private static List<EnumerationEntry> GetSnapshot(string snapshotId)
+        {
+            lock (SyncRoot)
+            {
+                RemoveExpired(DateTime.UtcNow);
+
+                if (Snapshots.TryGetValue(snapshotId, out Snapshot snapshot))
+                {
+                    snapshot.LastReadUtc = DateTime.UtcNow;
+                    return snapshot.Entries;
+                }
+
+                return null;
+            }
+        }
+
+        private static void AddSnapshot(string snapshotId, List<EnumerationEntry> entries)
+        {
+            lock (SyncRoot)
+            {
+                DateTime now = DateTime.UtcNow;
+
+                if (Snapshots.TryGetValue(snapshotId, out Snapshot snapshot))
+                {
+                    snapshot.LastReadUtc = now;
+                    return;
+                }
+
+                RemoveExpired(now);
+
+                // Drop the least recently read snapshot to stay within the limit
+                while (Snapshots.Count >= MaxSnapshots)
+                {
+                    string oldestId = null;
+                    DateTime oldest = DateTime.MaxValue;
+
+                    foreach (KeyValuePair<string, Snapshot> pair in Snapshots)
+                    {
+                        if (pair.Value.LastReadUtc < oldest)
+                        {
+                            oldest = pair.Value.LastReadUtc;
+                            oldestId = pair.Key;
+                        }
+                    }
+
+                    Snapshots.Remove(oldestId);
+                }
+
+                Snapshots.Add(snapshotId, new Snapshot { Entries = entries, LastReadUtc = now });
+            }
+        }
+
+        private static void RemoveSnapshot(string snapshotId)
+        {
+            if (snapshotId == null)
+            {
+                return;
+            }
+
+            lock (SyncRoot)
+            {
+                Snapshots.Remove(snapshotId);
+            }
+        }
+
+        private static void RemoveExpired(DateTime now)
+        {
+            List<string> expired = null;
+
+            foreach (KeyValuePair<string, Snapshot> pair in Snapshots)
+            {
+                if (now - pair.Value.LastReadUtc > SnapshotLifetime)
+                {
+                    (expired ?? (expired = new List<string>())).Add(pair.Key);
+                }
+            }
+
+            if (expired != null)
+            {
+                foreach (string snapshotId in expired)
+                {
+                    Snapshots.Remove(snapshotId);
+                }
+            }
+        }
+
+        private class Snapshot
+        {
+            public List<EnumerationEntry> Entries { get; set; }
+
+            public DateTime LastReadUtc { get; set; }
+        }
+    }
+}
@@ -0,0 +1,357 @@
+// <copyright file="BigDriveCallSchedulerTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "BigDriveCallScheduler.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const CLSID SchedulerTestProvider = { 0xE0E0E0E0, 0x000B, 0x4E00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0B } };
+
+    struct SchedulerOrderContext
+    {
+        BigDriveCallScheduler* pScheduler;
+        volatile LONG next;
+        BigDriveCallPriority order[8];
+    };
+
+    struct SchedulerRequestContext
+    {
+        SchedulerOrderContext* pOrder;
+        BigDriveCallPriority priority;
+        HRESULT hr;
+    };
+
+    struct SchedulerLoadContext
+    {
+        BigDriveCallScheduler* pScheduler;
+        volatile LONG fStop;
+        ULONG callMs;
+        ULONG foregroundCalls;
+        double totalWaitMs;
+        double maxWaitMs;
+    };
+
+    /// <summary>
+    /// Enters, records its place in the order of admission, and leaves.
+    /// </summary>
+    static DWORD WINAPI SchedulerRequestThread(LPVOID pParameter)
+    {
+        SchedulerRequestContext* pContext = static_cast<SchedulerRequestContext*>(pParameter);
+        LONG index = 0;
+
+        pContext->hr = pContext->pOrder->pScheduler->Enter(SchedulerTestProvider, pContext->priority, INFINITE);
+        if (SUCCEEDED(pContext->hr))
+        {
+            index = ::InterlockedIncrement(&pContext->pOrder->next) - 1;
+            pContext->pOrder->order[index] = pContext->priority;
+            pContext->pOrder->pScheduler->Leave(SchedulerTestProvider);
+        }
+
+        return 0;
+    }
+
+    /// <summary>
+    /// Makes bulk calls of callMs each until told to stop.
+    /// </summary>
+    static DWORD WINAPI SchedulerBulkThread(LPVOID pParameter)
+    {
+        SchedulerLoadContext* pContext = static_cast<SchedulerLoadContext*>(pParameter);
+
+        while (::InterlockedCompareExchange(&pContext->fStop, 0, 0) == 0)
+        {
+            if (SUCCEEDED(pContext->pScheduler->Enter(SchedulerTestProvider, BigDriveCallPriority_Bulk, INFINITE)))
+            {
+                ::Sleep(pContext->callMs);
+                pContext->pScheduler->Leave(SchedulerTestProvider);
+            }
+        }
+
+        return 0;
+    }
+
+    TEST_CLASS(BigDriveCallSchedulerTests)
+    {
+    private:
+
+        /// <summary>
+        /// Waits up to ten seconds for the number of requests that had to wait to reach a value.
+        /// </summary>
+        static bool WaitForWaited(BigDriveCallScheduler& scheduler, LONG expected)
+        {
+            LONG admitted = 0, waited = 0, promoted = 0, timedOut = 0;
+
+            for (int i = 0; i < 10000; i++)
+            {
+                scheduler.GetStatistics(admitted, waited, promoted, timedOut);
+                if (waited == expected)
+                {
+                    return true;
+                }
+
+                ::Sleep(1);
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Starts a request thread and waits until it is queued.
+        /// </summary>
+        static HANDLE StartQueuedRequest(BigDriveCallScheduler& scheduler, SchedulerRequestContext& request, LONG waited)
+        {
+            HANDLE hThread = ::CreateThread(nullptr, 0, SchedulerRequestThread, &request, 0, nullptr);
+
+            Assert::IsTrue(WaitForWaited(scheduler, waited));
+
+            return hThread;
+        }
+
+    public:
+
+        /// <summary>
+        /// Tests that no more calls than the provider's limit are admitted at once, and that a Leave admits the next.
+        /// </summary>
+        TEST_METHOD(Enter_ProviderFull_AdmittedAfterLeave)
+        {
+            // Arrange
+            BigDriveCallScheduler scheduler(BigDriveCallScheduler::DefaultProviderLimit, BigDriveCallScheduler::DefaultAgingMs);
+            LONG admitted = 0, waited = 0, promoted = 0, timedOut = 0;
+
+            Assert::AreEqual(S_OK, scheduler.SetProviderLimits(SchedulerTestProvider, 2, 0, 0));
+
+            // Act
+            HRESULT hr1 = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 0);
+            HRESULT hr2 = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 0);
+            HRESULT hrFull = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 20);
+
+            scheduler.Leave(SchedulerTestProvider);
+
+            HRESULT hr3 = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 0);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr1);
+            Assert::AreEqual(S_OK, hr2);
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_TIMEOUT), hrFull);
+            Assert::AreEqual(S_OK, hr3);
+
+            scheduler.GetStatistics(admitted, waited, promoted, timedOut);
+            Assert::AreEqual(3L, admitted);
+            Assert::AreEqual(1L, timedOut);
+
+            // Cleanup
+            scheduler.Leave(SchedulerTestProvider);
+            scheduler.Leave(SchedulerTestProvider);
+        }
+
+        /// <summary>
+        /// Tests that a rate limited provider admits its burst at once, then waits for the bucket to refill.
+        /// </summary>
+        TEST_METHOD(Enter_RateLimited_BurstThenWaitsForToken)
+        {
+            // Arrange
+            BigDriveCallScheduler scheduler(BigDriveCallScheduler::DefaultProviderLimit, BigDriveCallScheduler::DefaultAgingMs);
+
+            Assert::AreEqual(S_OK, scheduler.SetProviderLimits(SchedulerTestProvider, 8, 1, 2));
+
+            // Act
+            HRESULT hr1 = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 0);
+            HRESULT hr2 = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 0);
+            HRESULT hrEmpty = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 0);
+
+            ULONGLONG ullStart = ::GetTickCount64();
+            HRESULT hr3 = scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 5000);
+            ULONGLONG ullElapsed = ::GetTickCount64() - ullStart;
+
+            // Assert
+            Assert::AreEqual(S_OK, hr1);
+            Assert::AreEqual(S_OK, hr2);
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_TIMEOUT), hrEmpty);
+            Assert::AreEqual(S_OK, hr3);
+
+            // One call a second: the third token arrives a second after the burst was taken
+            Assert::IsTrue(ullElapsed >= 500);
+
+            // Cleanup
+            for (int i = 0; i < 3; i++)
+            {
+                scheduler.Leave(SchedulerTestProvider);
+            }
+        }
+
+        /// <summary>
+        /// Tests that waiting requests are admitted most urgent class first, whatever the order they arrived in.
+        /// </summary>
+        TEST_METHOD(Enter_WaitingClasses_ForegroundFirst)
+        {
+            // Arrange
+            BigDriveCallScheduler scheduler(1, 60000);
+            SchedulerOrderContext order = { &scheduler, 0, {} };
+            SchedulerRequestContext requests[3] =
+            {
+                { &order, BigDriveCallPriority_Bulk, E_FAIL },
+                { &order, BigDriveCallPriority_Background, E_FAIL },
+                { &order, BigDriveCallPriority_Foreground, E_FAIL },
+            };
+            HANDLE threads[3] = {};
+            LONG admitted = 0, waited = 0, promoted = 0, timedOut = 0;
+
+            Assert::AreEqual(S_OK, scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Bulk, 0));
+
+            for (ULONG i = 0; i < ARRAYSIZE(requests); i++)
+            {
+                threads[i] = StartQueuedRequest(scheduler, requests[i], static_cast<LONG>(i + 1));
+            }
+
+            // Act
+            scheduler.Leave(SchedulerTestProvider);
+            ::WaitForMultipleObjects(ARRAYSIZE(threads), threads, TRUE, INFINITE);
+
+            // Assert
+            Assert::AreEqual(3L, static_cast<LONG>(order.next));
+            Assert::AreEqual(static_cast<int>(BigDriveCallPriority_Foreground), static_cast<int>(order.order[0]));
+            Assert::AreEqual(static_cast<int>(BigDriveCallPriority_Background), static_cast<int>(order.order[1]));
+            Assert::AreEqual(static_cast<int>(BigDriveCallPriority_Bulk), static_cast<int>(order.order[2]));
+
+            scheduler.GetStatistics(admitted, waited, promoted, timedOut);
+            Assert::AreEqual(0L, promoted);
+
+            // Cleanup
+            for (ULONG i = 0; i < ARRAYSIZE(threads); i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+        }
+
+        /// <summary>
+        /// Tests that a bulk request that waited two aging intervals is admitted ahead of a newer foreground request.
+        /// </summary>
+        TEST_METHOD(Enter_AgedBulkRequest_AdmittedBeforeNewerForeground)
+        {
+            // Arrange
+            BigDriveCallScheduler scheduler(1, 50);
+            SchedulerOrderContext order = { &scheduler, 0, {} };
+            SchedulerRequestContext requests[2] =
+            {
+                { &order, BigDriveCallPriority_Bulk, E_FAIL },
+                { &order, BigDriveCallPriority_Foreground, E_FAIL },
+            };
+            HANDLE threads[2] = {};
+            LONG admitted = 0, waited = 0, promoted = 0, timedOut = 0;
+
+            Assert::AreEqual(S_OK, scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, 0));
+
+            threads[0] = StartQueuedRequest(scheduler, requests[0], 1);
+
+            // Two intervals raise bulk to foreground, where it is the older request
+            ::Sleep(200);
+
+            threads[1] = StartQueuedRequest(scheduler, requests[1], 2);
+
+            // Act
+            scheduler.Leave(SchedulerTestProvider);
+            ::WaitForMultipleObjects(ARRAYSIZE(threads), threads, TRUE, INFINITE);
+
+            // Assert
+            Assert::AreEqual(static_cast<int>(BigDriveCallPriority_Bulk), static_cast<int>(order.order[0]));
+            Assert::AreEqual(static_cast<int>(BigDriveCallPriority_Foreground), static_cast<int>(order.order[1]));
+
+            scheduler.GetStatistics(admitted, waited, promoted, timedOut);
+            Assert::AreEqual(1L, promoted);
+
+            // Cleanup
+            for (ULONG i = 0; i < ARRAYSIZE(threads); i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+        }
+
+        /// <summary>
+        /// Benchmark: a foreground request every 5 ms against a provider limited to four calls at once,
+        /// while eight threads keep it busy with 2 ms bulk calls. Arrival order (aging of zero) makes the
+        /// foreground request queue behind the bulk calls; priority lets it take the next free slot.
+        /// </summary>
+        TEST_METHOD(Benchmark_ForegroundUnderBulkLoad)
+        {
+            // Arrange
+            const ULONG bulkThreadCount = 8;
+            const ULONG foregroundCalls = 100;
+            const DWORD agings[] = { 0, BigDriveCallScheduler::DefaultAgingMs };
+            LARGE_INTEGER frequency, start, end;
+            wchar_t message[256];
+            double fifoMeanMs = 0.0;
+            double priorityMeanMs = 0.0;
+
+            ::QueryPerformanceFrequency(&frequency);
+
+            for (ULONG a = 0; a < ARRAYSIZE(agings); a++)
+            {
+                BigDriveCallScheduler scheduler(4, agings[a]);
+                SchedulerLoadContext context = { &scheduler, 0, 2, 0, 0.0, 0.0 };
+                HANDLE threads[bulkThreadCount] = {};
+                LONG admitted = 0, waited = 0, promoted = 0, timedOut = 0;
+
+                for (ULONG i = 0; i < bulkThreadCount; i++)
+                {
+                    threads[i] = ::CreateThread(nullptr, 0, SchedulerBulkThread, &context, 0, nullptr);
+                }
+
+                // Let the bulk threads fill the queue
+                ::Sleep(50);
+
+                // Act
+                for (ULONG i = 0; i < foregroundCalls; i++)
+                {
+                    ::QueryPerformanceCounter(&start);
+                    Assert::AreEqual(S_OK, scheduler.Enter(SchedulerTestProvider, BigDriveCallPriority_Foreground, INFINITE));
+                    ::QueryPerformanceCounter(&end);
+
+                    double waitMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+                    context.totalWaitMs += waitMs;
+                    if (waitMs > context.maxWaitMs)
+                    {
+                        context.maxWaitMs = waitMs;
+                    }
+
+                    context.foregroundCalls++;
+
+                    ::Sleep(context.callMs);
+                    scheduler.Leave(SchedulerTestProvider);
+                    ::Sleep(5);
+                }
+
+                ::InterlockedExchange(&context.fStop, 1);
+                ::WaitForMultipleObjects(bulkThreadCount, threads, TRUE, INFINITE);
+
+                scheduler.GetStatistics(admitted, waited, promoted, timedOut);
+
+                double meanMs = context.totalWaitMs / context.foregroundCalls;
+                ::swprintf_s(message, L"aging %lu ms: foreground wait mean %.2f ms, max %.2f ms; %ld admitted, %ld waited, %ld promoted\n",
+                    agings[a], meanMs, context.maxWaitMs, admitted, waited, promoted);
+                Logger::WriteMessage(message);
+
+                if (agings[a] == 0)
+                {
+                    fifoMeanMs = meanMs;
+                }
+                else
+                {
+                    priorityMeanMs = meanMs;
+                }
+
+                for (ULONG i = 0; i < bulkThreadCount; i++)
+                {
+                    ::CloseHandle(threads[i]);
+                }
+            }
+
+            // Assert
+            Assert::IsTrue(priorityMeanMs < fifoMeanMs);
+        }
+    };
+}
@@ -0,0 +1,330 @@
+// <copyright file="BigDriveClsidSetCacheTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <objbase.h>
+
+#include "BigDriveClsidSetCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID ClsidSetTestDrive = { 0xC15D5E70, 0x0000, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } };
+    const GUID ClsidSetOtherDrive = { 0xC15D5E70, 0xFFFF, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF } };
+
+    /// <summary>
+    /// Key under HKEY_CURRENT_USER laid out like Software\BigDrive\Drives: one subkey per drive GUID.
+    /// </summary>
+    static LPCWSTR ClsidSetTestKey = L"Software\\BigDrive\\ClsidSetCacheTests";
+
+    static volatile LONG s_clsidFetchCount = 0;
+    static DWORD s_clsidFetchSize = 1;
+
+    /// <summary>
+    /// Makes the GUID of the test drive with an index.
+    /// </summary>
+    static GUID MakeClsidSetDrive(DWORD index)
+    {
+        GUID guid = ClsidSetTestDrive;
+        guid.Data2 = static_cast<USHORT>(index);
+        guid.Data4[7] = static_cast<BYTE>(index);
+        return guid;
+    }
+
+    /// <summary>
+    /// Fetch stand-in that returns s_clsidFetchSize drives.
+    /// </summary>
+    static HRESULT MockClsidFetch(GUID** ppClsids, DWORD& size)
+    {
+        ::InterlockedIncrement(&s_clsidFetchCount);
+
+        *ppClsids = static_cast<GUID*>(::CoTaskMemAlloc(sizeof(GUID) * (s_clsidFetchSize + 1)));
+        if (*ppClsids == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        for (DWORD i = 0; i < s_clsidFetchSize; i++)
+        {
+            (*ppClsids)[i] = MakeClsidSetDrive(i);
+        }
+
+        size = s_clsidFetchSize;
+        return S_OK;
+    }
+
+    /// <summary>
+    /// Fetch stand-in for a registry that can't be read.
+    /// </summary>
+    static HRESULT FailingClsidFetch(GUID** ppClsids, DWORD& size)
+    {
+        ::InterlockedIncrement(&s_clsidFetchCount);
+        *ppClsids = nullptr;
+        size = 0;
+        return E_ACCESSDENIED;
+    }
+
+    /// <summary>
+    /// Fetch that enumerates the test key the way GetDriveGuids enumerates the Drives key.
+    /// </summary>
+    static HRESULT RegistryClsidFetch(GUID** ppClsids, DWORD& size)
+    {
+        HRESULT hr = S_OK;
+        HKEY hKey = nullptr;
+        DWORD count = 0;
+        WCHAR szName[64];
+        DWORD cchName = ARRAYSIZE(szName);
+        LONG result = ERROR_SUCCESS;
+
+        ::InterlockedIncrement(&s_clsidFetchCount);
+
+        *ppClsids = nullptr;
+        size = 0;
+
+        result = ::RegOpenKeyExW(HKEY_CURRENT_USER, ClsidSetTestKey, 0, KEY_READ, &hKey);
+        if (result != ERROR_SUCCESS)
+        {
+            return HRESULT_FROM_WIN32(result);
+        }
+
+        result = ::RegQueryInfoKeyW(hKey, nullptr, nullptr, nullptr, &count, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+        if (result != ERROR_SUCCESS)
+        {
+            hr = HRESULT_FROM_WIN32(result);
+            goto End;
+        }
+
+        *ppClsids = static_cast<GUID*>(::CoTaskMemAlloc(sizeof(GUID) * (count + 1)));
+        if (*ppClsids == nullptr)
+        {
+            hr = E_OUTOFMEMORY;
+            goto End;
+        }
+
+        while (::RegEnumKeyExW(hKey, size, szName, &cchName, nullptr, nullptr, nullptr, nullptr) == ERROR_SUCCESS)
+        {
+            if (size < count)
+            {
+                hr = ::CLSIDFromString(szName, &(*ppClsids)[size]);
+                if (FAILED(hr))
+                {
+                    goto End;
+                }
+            }
+
+            cchName = ARRAYSIZE(szName);
+            size++;
+        }
+
+    End:
+
+        ::RegCloseKey(hKey);
+        return hr;
+    }
+
+    TEST_CLASS(BigDriveClsidSetCacheTests)
+    {
+    private:
+
+        /// <summary>
+        /// Creates the test key with a subkey for each of count drives.
+        /// </summary>
+        static void CreateTestDrives(DWORD count)
+        {
+            WCHAR szKey[128];
+            WCHAR szGuid[39];
+            HKEY hKey = nullptr;
+
+            for (DWORD i = 0; i < count; i++)
+            {
+                ::StringFromGUID2(MakeClsidSetDrive(i), szGuid, ARRAYSIZE(szGuid));
+                ::swprintf_s(szKey, L"%s\\%s", ClsidSetTestKey, szGuid);
+                Assert::AreEqual(ERROR_SUCCESS, ::RegCreateKeyExW(HKEY_CURRENT_USER, szKey, 0, nullptr, 0, KEY_WRITE, nullptr, &hKey, nullptr));
+                ::RegCloseKey(hKey);
+            }
+        }
+
+    public:
+
+        TEST_METHOD_INITIALIZE(ResetMockFetch)
+        {
+            s_clsidFetchCount = 0;
+            s_clsidFetchSize = 1;
+        }
+
+        TEST_METHOD_CLEANUP(DeleteTestKey)
+        {
+            ::RegDeleteTreeW(HKEY_CURRENT_USER, ClsidSetTestKey);
+        }
+
+        /// <summary>
+        /// Tests that repeated lookups, registered or not, read the set once.
+        /// </summary>
+        TEST_METHOD(Contains_RepeatedLookups_FetchOnce)
+        {
+            // Arrange
+            BigDriveClsidSetCache cache(MockClsidFetch, nullptr);
+            LONG hits = 0, loads = 0, invalidations = 0;
+
+            s_clsidFetchSize = 50;
+
+            // Act
+            for (DWORD i = 0; i < 50; i++)
+            {
+                Assert::AreEqual(S_OK, cache.Contains(MakeClsidSetDrive(i)));
+            }
+
+            Assert::AreEqual(S_FALSE, cache.Contains(ClsidSetOtherDrive));
+            cache.GetStatistics(hits, loads, invalidations);
+
+            // Assert
+            Assert::AreEqual(1L, s_clsidFetchCount);
+            Assert::AreEqual(1L, loads);
+            Assert::AreEqual(50L, hits);
+        }
+
+        /// <summary>
+        /// Tests that an invalidated set is read again and sees new drives.
+        /// </summary>
+        TEST_METHOD(Invalidate_ReadsAgain)
+        {
+            // Arrange
+            BigDriveClsidSetCache cache(MockClsidFetch, nullptr);
+
+            Assert::AreEqual(S_FALSE, cache.Contains(MakeClsidSetDrive(1)));
+            s_clsidFetchSize = 2;
+
+            // Act
+            cache.Invalidate();
+
+            // Assert
+            Assert::AreEqual(S_OK, cache.Contains(MakeClsidSetDrive(1)));
+            Assert::AreEqual(2L, s_clsidFetchCount);
+        }
+
+        /// <summary>
+        /// Tests that a failed read is returned and not held.
+        /// </summary>
+        TEST_METHOD(Contains_FetchFails_ReturnsErrorAndRetries)
+        {
+            // Arrange
+            BigDriveClsidSetCache cache(FailingClsidFetch, nullptr);
+
+            // Act and Assert
+            Assert::AreEqual(E_ACCESSDENIED, cache.Contains(ClsidSetTestDrive));
+            Assert::AreEqual(E_ACCESSDENIED, cache.Contains(ClsidSetTestDrive));
+            Assert::AreEqual(2L, s_clsidFetchCount);
+        }
+
+        /// <summary>
+        /// Tests that a drive added under the watched key is seen without an explicit invalidation.
+        /// </summary>
+        TEST_METHOD(Contains_WatchedKeyChanged_Invalidates)
+        {
+            // Arrange
+            BigDriveClsidSetCache* pCache = nullptr;
+            LONG hits = 0, loads = 0, invalidations = 0;
+
+            CreateTestDrives(1);
+            pCache = new BigDriveClsidSetCache(RegistryClsidFetch, ClsidSetTestKey);
+            Assert::AreEqual(S_FALSE, pCache->Contains(MakeClsidSetDrive(1)));
+
+            // Act
+            CreateTestDrives(2);
+
+            for (int i = 0; i < 100; i++)
+            {
+                pCache->GetStatistics(hits, loads, invalidations);
+                if (invalidations > 0)
+                {
+                    break;
+                }
+
+                ::Sleep(20);
+            }
+
+            // Assert
+            Assert::IsTrue(invalidations > 0);
+            Assert::AreEqual(S_OK, pCache->Contains(MakeClsidSetDrive(1)));
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Benchmark: class-object lookups with 50 registered drives, enumerating the registry on every
+        /// request as DllGetClassObject did, and through the cache.
+        /// </summary>
+        TEST_METHOD(Benchmark_ActivationWithFiftyDrives)
+        {
+            // Arrange
+            const DWORD drives = 50;
+            const ULONG requests = 1000;
+            BigDriveClsidSetCache* pCache = nullptr;
+            LARGE_INTEGER frequency, start, middle, end;
+            LONG hits = 0, loads = 0, invalidations = 0;
+            GUID* pClsids = nullptr;
+            DWORD size = 0;
+            GUID requested = MakeClsidSetDrive(drives - 1);
+            ULONG found = 0;
+            wchar_t message[256];
+
+            CreateTestDrives(drives);
+            pCache = new BigDriveClsidSetCache(RegistryClsidFetch, ClsidSetTestKey);
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: every request enumerates the registry and scans the list
+            ::QueryPerformanceCounter(&start);
+
+            for (ULONG i = 0; i < requests; i++)
+            {
+                if (SUCCEEDED(RegistryClsidFetch(&pClsids, size)))
+                {
+                    for (DWORD j = 0; j < size; j++)
+                    {
+                        if (::IsEqualGUID(pClsids[j], requested))
+                        {
+                            found++;
+                            break;
+                        }
+                    }
+                }
+
+                ::CoTaskMemFree(pClsids);
+                pClsids = nullptr;
+            }
+
+            ::QueryPerformanceCounter(&middle);
+
+            // Act: requests go through the cache
+            for (ULONG i = 0; i < requests; i++)
+            {
+                if (pCache->Contains(requested) == S_OK)
+                {
+                    found++;
+                }
+            }
+
+            ::QueryPerformanceCounter(&end);
+            pCache->GetStatistics(hits, loads, invalidations);
+
+            double uncachedUs = (middle.QuadPart - start.QuadPart) * 1000000.0 / frequency.QuadPart / requests;
+            double cachedUs = (end.QuadPart - middle.QuadPart) * 1000000.0 / frequency.QuadPart / requests;
+            ::swprintf_s(message, L"%lu drives, %lu requests: uncached %.2f us/request, cached %.3f us/request (%ld loads)\n",
+                drives, requests, uncachedUs, cachedUs, loads);
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(2 * requests, found);
+            Assert::AreEqual(1L, loads);
+            Assert::IsTrue(cachedUs < uncachedUs);
+
+            // Cleanup
+            delete pCache;
+        }
+    };
+}
@@ -0,0 +1,260 @@
+// <copyright file="BigDriveConfigurationCacheTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <objbase.h>
+#include <oleauto.h>
+#include <corerror.h>
+
+#include "BigDriveConfigurationCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID CacheTestDriveA = { 0xC0F16CAC, 0x0001, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+    const GUID CacheTestDriveB = { 0xC0F16CAC, 0x0002, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+
+    static volatile LONG s_fetchCount = 0;
+    static DWORD s_fetchLatencyMs = 0;
+
+    /// <summary>
+    /// Fetch stand-in for the BigDriveConfiguration COM object.
+    /// </summary>
+    static HRESULT MockFetch(const GUID& driveGuid, LPWSTR& pszConfiguration)
+    {
+        LONG count = ::InterlockedIncrement(&s_fetchCount);
+        wchar_t json[128];
+
+        if (s_fetchLatencyMs > 0)
+        {
+            ::Sleep(s_fetchLatencyMs);
+        }
+
+        ::swprintf_s(json, L"{\"id\":\"%08lx\",\"fetch\":%ld}", driveGuid.Data1 + driveGuid.Data2, count);
+
+        size_t cb = (::wcslen(json) + 1) * sizeof(WCHAR);
+        pszConfiguration = static_cast<LPWSTR>(::CoTaskMemAlloc(cb));
+        if (pszConfiguration == nullptr)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        ::CopyMemory(pszConfiguration, json, cb);
+        return S_OK;
+    }
+
+    /// <summary>
+    /// Fetch stand-in for a drive that isn't registered.
+    /// </summary>
+    static HRESULT FailingFetch(const GUID& driveGuid, LPWSTR& pszConfiguration)
+    {
+        ::InterlockedIncrement(&s_fetchCount);
+        pszConfiguration = nullptr;
+        return COR_E_INVALIDOPERATION;
+    }
+
+    struct ConcurrentMissContext
+    {
+        BigDriveConfigurationCache* pCache;
+        HANDLE hStart;
+        volatile LONG failures;
+    };
+
+    static DWORD WINAPI ConcurrentMissThread(LPVOID pParameter)
+    {
+        ConcurrentMissContext* pContext = static_cast<ConcurrentMissContext*>(pParameter);
+        LPWSTR pszConfiguration = nullptr;
+
+        ::WaitForSingleObject(pContext->hStart, INFINITE);
+
+        if (pContext->pCache->GetConfiguration(CacheTestDriveA, pszConfiguration) != S_OK)
+        {
+            ::InterlockedIncrement(&pContext->failures);
+        }
+
+        ::SysFreeString(pszConfiguration);
+        return 0;
+    }
+
+    TEST_CLASS(BigDriveConfigurationCacheTests)
+    {
+    public:
+
+        TEST_METHOD_INITIALIZE(ResetMockFetch)
+        {
+            s_fetchCount = 0;
+            s_fetchLatencyMs = 0;
+        }
+
+        /// <summary>
+        /// Tests that repeated lookups for a drive fetch once.
+        /// </summary>
+        TEST_METHOD(GetConfiguration_RepeatedLookups_FetchOnce)
+        {
+            // Arrange
+            BigDriveConfigurationCache cache(MockFetch, FALSE);
+            LPWSTR pszFirst = nullptr;
+            LPWSTR pszSecond = nullptr;
+            LONG hits = 0, fetches = 0;
+
+            // Act
+            HRESULT hr1 = cache.GetConfiguration(CacheTestDriveA, pszFirst);
+            HRESULT hr2 = cache.GetConfiguration(CacheTestDriveA, pszSecond);
+            cache.GetStatistics(hits, fetches);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr1);
+            Assert::AreEqual(S_OK, hr2);
+            Assert::AreEqual(0, ::wcscmp(pszFirst, pszSecond));
+            Assert::IsTrue(pszFirst != pszSecond, L"Each caller should receive its own copy.");
+            Assert::AreEqual(1L, static_cast<long>(s_fetchCount));
+            Assert::AreEqual(1L, static_cast<long>(hits));
+            Assert::AreEqual(1L, static_cast<long>(fetches));
+
+            // Cleanup
+            ::SysFreeString(pszFirst);
+            ::SysFreeString(pszSecond);
+        }
+
+        /// <summary>
+        /// Tests that each drive is cached independently.
+        /// </summary>
+        TEST_METHOD(GetConfiguration_TwoDrives_CachedIndependently)
+        {
+            // Arrange
+            BigDriveConfigurationCache cache(MockFetch, FALSE);
+            LPWSTR psz = nullptr;
+
+            // Act
+            for (int i = 0; i < 3; i++)
+            {
+                cache.GetConfiguration(CacheTestDriveA, psz);
+                ::SysFreeString(psz);
+                cache.GetConfiguration(CacheTestDriveB, psz);
+                ::SysFreeString(psz);
+            }
+
+            // Assert
+            Assert::AreEqual(2L, static_cast<long>(s_fetchCount));
+        }
+
+        /// <summary>
+        /// Tests that advancing the version stamp forces a fetch.
+        /// </summary>
+        TEST_METHOD(Invalidate_AdvancesVersion_ForcesFetch)
+        {
+            // Arrange
+            BigDriveConfigurationCache cache(MockFetch, FALSE);
+            LPWSTR pszBefore = nullptr;
+            LPWSTR pszAfter = nullptr;
+            LONG versionBefore = cache.GetVersion();
+
+            cache.GetConfiguration(CacheTestDriveA, pszBefore);
+
+            // Act
+            cache.Invalidate();
+            cache.GetConfiguration(CacheTestDriveA, pszAfter);
+
+            // Assert
+            Assert::AreNotEqual(versionBefore, cache.GetVersion());
+            Assert::AreEqual(2L, static_cast<long>(s_fetchCount));
+            Assert::AreNotEqual(0, ::wcscmp(pszBefore, pszAfter), L"The configuration should come from the second fetch.");
+
+            // Cleanup
+            ::SysFreeString(pszBefore);
+            ::SysFreeString(pszAfter);
+        }
+
+        /// <summary>
+        /// Tests that concurrent misses for the same drive are served by a single fetch.
+        /// </summary>
+        TEST_METHOD(GetConfiguration_ConcurrentMisses_SingleFetch)
+        {
+            // Arrange
+            const int threadCount = 8;
+            BigDriveConfigurationCache cache(MockFetch, FALSE);
+            ConcurrentMissContext context = { &cache, ::CreateEventW(nullptr, TRUE, FALSE, nullptr), 0 };
+            HANDLE threads[threadCount] = {};
+
+            s_fetchLatencyMs = 50;
+
+            for (int i = 0; i < threadCount; i++)
+            {
+                threads[i] = ::CreateThread(nullptr, 0, ConcurrentMissThread, &context, 0, nullptr);
+            }
+
+            // Act
+            ::SetEvent(context.hStart);
+            ::WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+
+            // Assert
+            Assert::AreEqual(0L, static_cast<long>(context.failures));
+            Assert::AreEqual(1L, static_cast<long>(s_fetchCount));
+
+            // Cleanup
+            for (int i = 0; i < threadCount; i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+
+            ::CloseHandle(context.hStart);
+        }
+
+        /// <summary>
+        /// Tests that a failed fetch is not cached and the next lookup fetches again.
+        /// </summary>
+        TEST_METHOD(GetConfiguration_FetchFails_NotCached)
+        {
+            // Arrange
+            BigDriveConfigurationCache cache(FailingFetch, FALSE);
+            LPWSTR psz = nullptr;
+
+            // Act
+            HRESULT hr1 = cache.GetConfiguration(CacheTestDriveA, psz);
+            HRESULT hr2 = cache.GetConfiguration(CacheTestDriveA, psz);
+
+            // Assert
+            Assert::AreEqual(COR_E_INVALIDOPERATION, hr1);
+            Assert::AreEqual(COR_E_INVALIDOPERATION, hr2);
+            Assert::IsNull(psz);
+            Assert::AreEqual(2L, static_cast<long>(s_fetchCount));
+        }
+
+        /// <summary>
+        /// Benchmark: cached lookups against a fetch with a simulated 1 ms round trip.
+        /// </summary>
+        TEST_METHOD(Benchmark_CachedLookup)
+        {
+            // Arrange
+            const int iterations = 100000;
+            BigDriveConfigurationCache cache(MockFetch, FALSE);
+            LARGE_INTEGER frequency, start, end;
+            LPWSTR psz = nullptr;
+            wchar_t message[256];
+
+            s_fetchLatencyMs = 1;
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act
+            ::QueryPerformanceCounter(&start);
+            for (int i = 0; i < iterations; i++)
+            {
+                cache.GetConfiguration(CacheTestDriveA, psz);
+                ::SysFreeString(psz);
+            }
+            ::QueryPerformanceCounter(&end);
+
+            double elapsedMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%d cached lookups: %.2f ms (%.3f us each), fetches: %ld\n",
+                iterations, elapsedMs, elapsedMs * 1000.0 / iterations, static_cast<long>(s_fetchCount));
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(1L, static_cast<long>(s_fetchCount));
+        }
+    };
+}
@@ -0,0 +1,359 @@
+// <copyright file="BigDriveConnectionPoolTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "BigDriveConnectionPool.h"
+#include "Interfaces/IBigDriveEnumerate.h"
+#include "Interfaces/IBigDriveFileData.h"
+#include "MockBigDriveProvider.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID PoolTestDriveA = { 0x5A1D7E01, 0x0001, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+    const GUID PoolTestDriveB = { 0x5A1D7E01, 0x0002, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+    const CLSID PoolTestProvider = { 0x5A1D7E01, 0x00FF, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF } };
+
+    struct PoolApartmentContext
+    {
+        BigDriveConnectionPool* pPool;
+        HRESULT hr;
+        IUnknown* pInterface;
+    };
+
+    /// <summary>
+    /// Requests an interface from a single-threaded apartment of its own, which ends when the thread exits.
+    /// The pointer is kept only to compare it; it is released before the apartment ends.
+    /// </summary>
+    static DWORD WINAPI PoolApartmentThread(LPVOID pParameter)
+    {
+        PoolApartmentContext* pContext = static_cast<PoolApartmentContext*>(pParameter);
+        IUnknown* pUnknown = nullptr;
+        HRESULT hrCoInit = ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+        pContext->hr = pContext->pPool->GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pUnknown);
+        pContext->pInterface = pUnknown;
+
+        if (pUnknown)
+        {
+            pUnknown->Release();
+            pUnknown = nullptr;
+        }
+
+        if (SUCCEEDED(hrCoInit))
+        {
+            ::CoUninitialize();
+        }
+
+        return 0;
+    }
+
+    TEST_CLASS(BigDriveConnectionPoolTests)
+    {
+    public:
+
+        TEST_METHOD_INITIALIZE(Initialize)
+        {
+            // The pool holds connections in the Global Interface Table
+            m_hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            if (SUCCEEDED(m_hrCoInit))
+            {
+                ::CoUninitialize();
+            }
+        }
+
+        /// <summary>
+        /// Tests that a second request for the same interface is served from the pool without activating again.
+        /// </summary>
+        TEST_METHOD(GetInterface_SecondRequest_IsHit)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator);
+            IUnknown* pFirst = nullptr;
+            IUnknown* pSecond = nullptr;
+            BigDriveConnectionPoolStatistics statistics = {};
+
+            // Act
+            HRESULT hr1 = pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pFirst);
+            HRESULT hr2 = pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pSecond);
+            pool.GetStatistics(statistics);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr1);
+            Assert::AreEqual(S_OK, hr2);
+            Assert::IsTrue(pFirst == pSecond, L"Both requests should return the cached interface.");
+            Assert::AreEqual(1L, static_cast<long>(activator.activationCount));
+            Assert::AreEqual(1L, static_cast<long>(statistics.hits));
+            Assert::AreEqual(1L, static_cast<long>(statistics.misses));
+            Assert::AreEqual(1UL, static_cast<unsigned long>(statistics.connections));
+
+            // Cleanup
+            pFirst->Release();
+            pSecond->Release();
+            pool.Clear();
+            Assert::AreEqual(0L, static_cast<long>(activator.liveCount), L"Clear should release the provider.");
+        }
+
+        /// <summary>
+        /// Tests that an interface the provider doesn't implement returns S_FALSE and the answer is cached.
+        /// </summary>
+        TEST_METHOD(GetInterface_NotImplemented_ReturnsFalseAndIsCached)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator);
+            IUnknown* pUnknown = nullptr;
+            BigDriveConnectionPoolStatistics statistics = {};
+
+            // Act
+            HRESULT hr1 = pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveFileData, &pUnknown);
+            HRESULT hr2 = pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveFileData, &pUnknown);
+            pool.GetStatistics(statistics);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr1);
+            Assert::AreEqual(S_FALSE, hr2);
+            Assert::IsNull(pUnknown);
+            Assert::AreEqual(1L, static_cast<long>(statistics.hits));
+        }
+
+        /// <summary>
+        /// Tests that each drive gets its own connection.
+        /// </summary>
+        TEST_METHOD(GetInterface_DifferentDrives_ActivateSeparately)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator);
+            IUnknown* pA = nullptr;
+            IUnknown* pB = nullptr;
+
+            // Act
+            pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pA);
+            pool.GetInterface(PoolTestDriveB, PoolTestProvider, IID_IBigDriveEnumerate, &pB);
+
+            // Assert
+            Assert::AreEqual(2L, static_cast<long>(activator.activationCount));
+            Assert::IsTrue(pA != pB);
+
+            // Cleanup
+            pA->Release();
+            pB->Release();
+        }
+
+        /// <summary>
+        /// Tests that reporting RPC_E_DISCONNECTED drops the connection and the next request activates a new provider.
+        /// </summary>
+        TEST_METHOD(Reconnect_Disconnected_ActivatesNewProvider)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator);
+            IBigDriveEnumerate* pEnumerate = nullptr;
+            SAFEARRAY* psa = nullptr;
+            BigDriveConnectionPoolStatistics statistics = {};
+
+            pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, reinterpret_cast<IUnknown**>(&pEnumerate));
+            activator.pLastProvider->failWith = RPC_E_DISCONNECTED;
+
+            // Act
+            HRESULT hrCall = pEnumerate->EnumerateFolders(PoolTestDriveA, nullptr, &psa);
+            HRESULT hrReconnect = pool.Reconnect(PoolTestDriveA, hrCall);
+            pEnumerate->Release();
+            pEnumerate = nullptr;
+
+            HRESULT hrRetry = pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, reinterpret_cast<IUnknown**>(&pEnumerate));
+            HRESULT hrCallRetry = pEnumerate->EnumerateFolders(PoolTestDriveA, nullptr, &psa);
+            pool.GetStatistics(statistics);
+
+            // Assert
+            Assert::AreEqual(RPC_E_DISCONNECTED, hrCall);
+            Assert::AreEqual(S_OK, hrReconnect);
+            Assert::AreEqual(S_OK, hrRetry);
+            Assert::AreEqual(S_OK, hrCallRetry);
+            Assert::AreEqual(2L, static_cast<long>(activator.activationCount));
+            Assert::AreEqual(1L, static_cast<long>(statistics.reconnects));
+            Assert::AreEqual(1L, static_cast<long>(activator.liveCount), L"The disconnected provider should be released.");
+
+            // Cleanup
+            ::SafeArrayDestroy(psa);
+            pEnumerate->Release();
+        }
+
+        /// <summary>
+        /// Tests that an error that doesn't indicate disconnection keeps the pooled connection.
+        /// </summary>
+        TEST_METHOD(Reconnect_OtherError_KeepsConnection)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator);
+            IUnknown* pUnknown = nullptr;
+            BigDriveConnectionPoolStatistics statistics = {};
+
+            pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pUnknown);
+
+            // Act
+            HRESULT hr = pool.Reconnect(PoolTestDriveA, E_FAIL);
+            pool.GetStatistics(statistics);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr);
+            Assert::AreEqual(1UL, static_cast<unsigned long>(statistics.connections));
+            Assert::IsTrue(BigDriveConnectionPool::IsDisconnectedError(HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE)) == TRUE);
+
+            // Cleanup
+            pUnknown->Release();
+        }
+
+        /// <summary>
+        /// Tests that connections idle past the timeout are released.
+        /// </summary>
+        TEST_METHOD(EvictIdle_ReleasesIdleConnections)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator, 1);
+            IUnknown* pUnknown = nullptr;
+            BigDriveConnectionPoolStatistics statistics = {};
+
+            pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pUnknown);
+            pUnknown->Release();
+            pUnknown = nullptr;
+
+            // Act
+            ::Sleep(50);
+            HRESULT hr = pool.EvictIdle();
+            pool.GetStatistics(statistics);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr);
+            Assert::AreEqual(1L, static_cast<long>(statistics.evictions));
+            Assert::AreEqual(0UL, static_cast<unsigned long>(statistics.connections));
+            Assert::AreEqual(0L, static_cast<long>(activator.liveCount));
+        }
+
+        /// <summary>
+        /// Tests that a connection created by a single-threaded apartment is evicted by the idle sweep of another
+        /// apartment once the creating thread has exited.
+        /// </summary>
+        TEST_METHOD(EvictIdle_CreatingThreadExited_ReleasesConnection)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator, 1);
+            PoolApartmentContext context = { &pool, E_FAIL, nullptr };
+            BigDriveConnectionPoolStatistics statistics = {};
+            HANDLE hThread = ::CreateThread(nullptr, 0, PoolApartmentThread, &context, 0, nullptr);
+
+            ::WaitForSingleObject(hThread, INFINITE);
+            ::CloseHandle(hThread);
+
+            // Act
+            ::Sleep(50);
+            HRESULT hr = pool.EvictIdle();
+            pool.GetStatistics(statistics);
+
+            // Assert
+            Assert::AreEqual(S_OK, context.hr);
+            Assert::AreEqual(S_OK, hr);
+            Assert::AreEqual(1L, static_cast<long>(statistics.evictions));
+            Assert::AreEqual(0UL, static_cast<unsigned long>(statistics.connections));
+            Assert::AreEqual(0L, static_cast<long>(activator.liveCount), L"The provider should be released although its apartment has ended.");
+        }
+
+        /// <summary>
+        /// Tests that a connection created by a single-threaded apartment that has since ended is handed out to
+        /// another apartment rather than activated again.
+        /// </summary>
+        TEST_METHOD(GetInterface_CreatingThreadExited_SharesConnection)
+        {
+            // Arrange
+            MockBigDriveProviderActivator activator;
+            BigDriveConnectionPool pool(&activator);
+            PoolApartmentContext context = { &pool, E_FAIL, nullptr };
+            IUnknown* pUnknown = nullptr;
+            BigDriveConnectionPoolStatistics statistics = {};
+            HANDLE hThread = ::CreateThread(nullptr, 0, PoolApartmentThread, &context, 0, nullptr);
+
+            ::WaitForSingleObject(hThread, INFINITE);
+            ::CloseHandle(hThread);
+
+            // Act
+            HRESULT hr = pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pUnknown);
+            pool.GetStatistics(statistics);
+
+            // Assert
+            Assert::AreEqual(S_OK, context.hr);
+            Assert::AreEqual(S_OK, hr);
+            Assert::IsTrue(pUnknown == context.pInterface, L"The free-threaded provider should be handed out as is.");
+            Assert::AreEqual(1L, static_cast<long>(activator.activationCount));
+            Assert::AreEqual(1L, static_cast<long>(statistics.hits));
+            Assert::AreEqual(1UL, static_cast<unsigned long>(statistics.connections));
+
+            // Cleanup
+            pUnknown->Release();
+            pool.Clear();
+            Assert::AreEqual(0L, static_cast<long>(activator.liveCount));
+        }
+
+        /// <summary>
+        /// Benchmark: compares requesting an interface per call through the pool against activating per call,
+        /// with a simulated 5 ms out-of-process activation.
+        /// </summary>
+        TEST_METHOD(Benchmark_PooledVersusActivatePerCall)
+        {
+            // Arrange
+            const int iterations = 100;
+            MockBigDriveProviderActivator activator(5, 0);
+            BigDriveConnectionPool pool(&activator);
+            LARGE_INTEGER frequency, start, end;
+            IUnknown* pUnknown = nullptr;
+            wchar_t message[256];
+
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: activate per call
+            ::QueryPerformanceCounter(&start);
+            for (int i = 0; i < iterations; i++)
+            {
+                IUnknown* pProvider = nullptr;
+                activator.Activate(PoolTestProvider, &pProvider);
+                pProvider->QueryInterface(IID_IBigDriveEnumerate, reinterpret_cast<void**>(&pUnknown));
+                pUnknown->Release();
+                pProvider->Release();
+            }
+            ::QueryPerformanceCounter(&end);
+            double unpooledMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+            // Act: pooled
+            ::QueryPerformanceCounter(&start);
+            for (int i = 0; i < iterations; i++)
+            {
+                pool.GetInterface(PoolTestDriveA, PoolTestProvider, IID_IBigDriveEnumerate, &pUnknown);
+                pUnknown->Release();
+            }
+            ::QueryPerformanceCounter(&end);
+            double pooledMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+            ::swprintf_s(message, L"Activate per call: %.2f ms, pooled: %.2f ms for %d requests\n", unpooledMs, pooledMs, iterations);
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::IsTrue(pooledMs < unpooledMs, L"Pooled requests should be faster than activating per call.");
+        }
+
+    private:
+
+        HRESULT m_hrCoInit = S_OK;
+    };
+}
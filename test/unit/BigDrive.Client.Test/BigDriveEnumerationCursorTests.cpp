@@ -0,0 +1,297 @@
+// <copyright file="BigDriveEnumerationCursorTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <objbase.h>
+#include <oleauto.h>
+
+#include "BigDriveEnumerationCursor.h"
+#include "MockBigDriveProvider.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID CursorTestDrive = { 0xE0E0E0E0, 0x0002, 0x4E00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+
+    const LONG CursorTestAllEntries = BigDriveEnumerateEntries_Folders | BigDriveEnumerateEntries_Files;
+
+    TEST_CLASS(BigDriveEnumerationCursorTests)
+    {
+    public:
+
+        /// <summary>
+        /// Tests that every entry is read once, in order, a page at a time.
+        /// </summary>
+        TEST_METHOD(Next_ManyPages_ReturnsEveryEntry)
+        {
+            // Arrange
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            BSTR bstrPath = ::SysAllocString(L"\\");
+            BigDriveEnumerationCursor cursor;
+            BigDriveEnumerationEntry entry;
+            ULONG folders = 0, files = 0;
+            HRESULT hr = S_OK;
+
+            pProvider->entryCount = 2500;
+            cursor.Initialize(pProvider, CursorTestDrive, bstrPath, CursorTestAllEntries, 1000);
+
+            // Act
+            while ((hr = cursor.Next(entry)) == S_OK)
+            {
+                if (entry.uType == 1)
+                {
+                    Assert::AreEqual(0UL, files, L"Folders should come before files.");
+                    folders++;
+                }
+                else
+                {
+                    Assert::AreEqual(1024ULL * (files + 1), entry.ullSize);
+                    files++;
+                }
+            }
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr);
+            Assert::AreEqual(2500UL, folders);
+            Assert::AreEqual(2500UL, files);
+            Assert::AreEqual(5UL, cursor.GetPageCount());
+            Assert::AreEqual(1000UL, pProvider->largestPage);
+            Assert::AreEqual(S_FALSE, cursor.Next(entry), L"The cursor should stay at the end.");
+            Assert::AreEqual(5L, static_cast<long>(pProvider->callCount));
+
+            // Cleanup
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Tests that no provider call is made until the first entry is read.
+        /// </summary>
+        TEST_METHOD(Initialize_NoProviderCall)
+        {
+            // Arrange
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            BSTR bstrPath = ::SysAllocString(L"\\");
+            BigDriveEnumerationCursor cursor;
+
+            // Act
+            HRESULT hr = cursor.Initialize(pProvider, CursorTestDrive, bstrPath, CursorTestAllEntries, 0);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr);
+            Assert::AreEqual(0L, static_cast<long>(pProvider->callCount));
+
+            // Cleanup
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Tests that Reset starts again from the first page.
+        /// </summary>
+        TEST_METHOD(Reset_AfterSecondPage_RestartsFromFirstEntry)
+        {
+            // Arrange
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            BSTR bstrPath = ::SysAllocString(L"\\");
+            BigDriveEnumerationCursor cursor;
+            BigDriveEnumerationEntry entry;
+
+            pProvider->entryCount = 5;
+            cursor.Initialize(pProvider, CursorTestDrive, bstrPath, CursorTestAllEntries, 4);
+
+            for (int i = 0; i < 6; i++)
+            {
+                cursor.Next(entry);
+            }
+
+            // Act
+            cursor.Reset();
+            HRESULT hr = cursor.Next(entry);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr);
+            Assert::AreEqual(0, ::wcsncmp(L"Folder0", entry.pchName, entry.cchName));
+            Assert::AreEqual(1UL, cursor.GetPageCount());
+
+            // Cleanup
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Tests that a provider failure is returned and the page can be requested again.
+        /// </summary>
+        TEST_METHOD(Next_ProviderFails_ReturnsErrorAndRetries)
+        {
+            // Arrange
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            BSTR bstrPath = ::SysAllocString(L"\\");
+            BigDriveEnumerationCursor cursor;
+            BigDriveEnumerationEntry entry;
+
+            cursor.Initialize(pProvider, CursorTestDrive, bstrPath, CursorTestAllEntries, 10);
+            pProvider->failWith = RPC_E_DISCONNECTED;
+
+            // Act
+            HRESULT hrFailed = cursor.Next(entry);
+            pProvider->failWith = S_OK;
+            HRESULT hrRetried = cursor.Next(entry);
+
+            // Assert
+            Assert::AreEqual(RPC_E_DISCONNECTED, hrFailed);
+            Assert::AreEqual(S_OK, hrRetried);
+            Assert::AreEqual(0, ::wcsncmp(L"Folder0", entry.pchName, entry.cchName));
+
+            // Cleanup
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Benchmark: time to the first item and to the last item of a 200,000 entry folder, paged against a
+        /// single IBigDriveEnumerateEx call. Each provider call sleeps 2 ms to stand in for the RPC.
+        /// </summary>
+        TEST_METHOD(Benchmark_TimeToFirstItem_200kEntries)
+        {
+            // Arrange
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 2);
+            BSTR bstrPath = ::SysAllocString(L"\\Big");
+            BigDriveEnumerationCursor cursor;
+            BigDriveEnumerationReader reader;
+            BigDriveEnumerationEntry entry;
+            SAFEARRAY* psaEntries = nullptr;
+            LARGE_INTEGER frequency, start, first, end;
+            ULONG read = 0;
+            wchar_t message[256];
+
+            pProvider->entryCount = 100000;
+            ::QueryPerformanceFrequency(&frequency);
+            cursor.Initialize(pProvider, CursorTestDrive, bstrPath, CursorTestAllEntries, 0);
+
+            // Act: paged
+            ::QueryPerformanceCounter(&start);
+            cursor.Next(entry);
+            ::QueryPerformanceCounter(&first);
+
+            for (read = 1; cursor.Next(entry) == S_OK; read++)
+            {
+            }
+
+            ::QueryPerformanceCounter(&end);
+
+            double pagedFirstMs = (first.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double pagedTotalMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+            // Act: single call
+            ::QueryPerformanceCounter(&start);
+            pProvider->EnumerateEntries(CursorTestDrive, bstrPath, CursorTestAllEntries, &psaEntries);
+            reader.Initialize(psaEntries);
+            reader.Next(entry);
+            ::QueryPerformanceCounter(&first);
+
+            while (reader.Next(entry) == S_OK)
+            {
+            }
+
+            ::QueryPerformanceCounter(&end);
+
+            double singleFirstMs = (first.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double singleTotalMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+            ::swprintf_s(message, L"%lu entries, %lu pages: paged first item %.2f ms, total %.2f ms; single call first item %.2f ms, total %.2f ms\n",
+                read, cursor.GetPageCount(), pagedFirstMs, pagedTotalMs, singleFirstMs, singleTotalMs);
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(200000UL, read);
+            Assert::AreEqual(200UL, cursor.GetPageCount());
+            Assert::IsTrue(pagedFirstMs < singleFirstMs, L"The first page should arrive before the whole listing.");
+
+            // Cleanup
+            reader.Close();
+            ::SafeArrayDestroy(psaEntries);
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Benchmark: navigation pane expansion down a deep tree. At each level the pane asks whether each of
+        /// the visible child folders has subfolders; answered by listing every child, as expanding it would,
+        /// against a probe for a single folder. Each provider call sleeps 2 ms to stand in for the RPC.
+        /// </summary>
+        TEST_METHOD(Benchmark_NavigationPaneExpansion_DeepTree)
+        {
+            // Arrange
+            const ULONG depth = 8;
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 2);
+            BSTR bstrPath = ::SysAllocString(L"\\Deep");
+            BSTR bstrNextCursor = nullptr;
+            SAFEARRAY* psaEntries = nullptr;
+            BigDriveEnumerationReader reader;
+            LARGE_INTEGER frequency, start, middle, end;
+            ULONG listed = 0;
+            ULONG probed = 0;
+            wchar_t message[256];
+
+            pProvider->entryCount = 2000;
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: every child folder is listed in full
+            ::QueryPerformanceCounter(&start);
+
+            for (ULONG level = 0; level < depth; level++)
+            {
+                for (ULONG child = 0; child < 10; child++)
+                {
+                    pProvider->EnumerateEntries(CursorTestDrive, bstrPath, CursorTestAllEntries, &psaEntries);
+                    reader.Initialize(psaEntries);
+                    listed += (reader.GetCount() > 0) ? 1 : 0;
+                    reader.Close();
+                    ::SafeArrayDestroy(psaEntries);
+                    psaEntries = nullptr;
+                }
+            }
+
+            ::QueryPerformanceCounter(&middle);
+
+            // Act: every child folder is probed for one subfolder
+            for (ULONG level = 0; level < depth; level++)
+            {
+                for (ULONG child = 0; child < 10; child++)
+                {
+                    pProvider->EnumerateEntriesPage(CursorTestDrive, bstrPath, BigDriveEnumerateEntries_Folders, nullptr, 1, &bstrNextCursor, &psaEntries);
+                    reader.Initialize(psaEntries);
+                    probed += (reader.GetCount() > 0) ? 1 : 0;
+                    reader.Close();
+                    ::SafeArrayDestroy(psaEntries);
+                    psaEntries = nullptr;
+                    ::SysFreeString(bstrNextCursor);
+                    bstrNextCursor = nullptr;
+                }
+            }
+
+            ::QueryPerformanceCounter(&end);
+
+            double listedMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double probedMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%lu levels of 10 folders with %lu entries each: listed %.2f ms, probed %.2f ms (largest page %lu)\n",
+                depth, 2 * pProvider->entryCount, listedMs, probedMs, pProvider->largestPage);
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(depth * 10, listed);
+            Assert::AreEqual(depth * 10, probed);
+            Assert::AreEqual(1UL, pProvider->largestPage);
+            Assert::IsTrue(probedMs < listedMs, L"Probing for one subfolder should cost less than listing the folder.");
+
+            // Cleanup
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+    };
+}
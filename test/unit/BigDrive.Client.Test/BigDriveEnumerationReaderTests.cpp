@@ -0,0 +1,226 @@
+// <copyright file="BigDriveEnumerationReaderTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <objbase.h>
+#include <oleauto.h>
+
+#include "BigDriveEnumerationReader.h"
+#include "MockBigDriveProvider.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID EnumerationTestDrive = { 0xE0E0E0E0, 0x0001, 0x4E00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+
+    TEST_CLASS(BigDriveEnumerationReaderTests)
+    {
+    public:
+
+        /// <summary>
+        /// Tests that every record packed by the provider is read back with its metadata.
+        /// </summary>
+        TEST_METHOD(Next_PackedEntries_RoundTrip)
+        {
+            // Arrange
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            SAFEARRAY* psa = nullptr;
+            BigDriveEnumerationReader reader;
+            BigDriveEnumerationEntry entry;
+            BSTR bstrPath = ::SysAllocString(L"\\");
+            ULONG folders = 0, files = 0;
+
+            pProvider->entryCount = 3;
+            pProvider->EnumerateEntries(EnumerationTestDrive, bstrPath, BigDriveEnumerateEntries_Folders | BigDriveEnumerateEntries_Files, &psa);
+
+            // Act
+            HRESULT hrInit = reader.Initialize(psa);
+
+            // Assert
+            Assert::AreEqual(S_OK, hrInit);
+            Assert::AreEqual(6UL, reader.GetCount());
+
+            while (reader.Next(entry) == S_OK)
+            {
+                if (entry.uType == 1)
+                {
+                    Assert::AreEqual(0, ::wcsncmp(L"Folder", entry.pchName, 6));
+                    Assert::AreEqual(static_cast<DWORD>(FILE_ATTRIBUTE_DIRECTORY), entry.dwAttributes);
+                    Assert::AreEqual(0, static_cast<int>(files), L"Folders should come before files.");
+                    folders++;
+                }
+                else
+                {
+                    Assert::AreEqual(0, ::wcsncmp(L"File", entry.pchName, 4));
+                    Assert::AreEqual(static_cast<DWORD>(0x0F), entry.dwFields);
+                    Assert::AreEqual(1024ULL * (files + 1), entry.ullSize);
+                    Assert::AreEqual(1, static_cast<int>(entry.cchETag));
+                    Assert::AreEqual(L'e', entry.pchETag[0]);
+                    files++;
+                }
+            }
+
+            Assert::AreEqual(3UL, folders);
+            Assert::AreEqual(3UL, files);
+            Assert::AreEqual(S_FALSE, reader.Next(entry));
+
+            // Cleanup
+            reader.Close();
+            ::SafeArrayDestroy(psa);
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Tests that a buffer without the signature is rejected.
+        /// </summary>
+        TEST_METHOD(Initialize_BadSignature_Rejected)
+        {
+            // Arrange
+            BYTE buffer[BigDriveEnumerationReader::HeaderSize] = { 'N', 'O', 'P', 'E', 1, 0, 0, 0, 0, 0, 0, 0 };
+            BigDriveEnumerationReader reader;
+
+            // Act
+            HRESULT hr = reader.Initialize(buffer, sizeof(buffer));
+
+            // Assert
+            Assert::AreEqual(E_INVALIDARG, hr);
+        }
+
+        /// <summary>
+        /// Tests that a header claiming more records than the buffer can hold is rejected.
+        /// </summary>
+        TEST_METHOD(Initialize_CountExceedsBuffer_Rejected)
+        {
+            // Arrange
+            BYTE buffer[BigDriveEnumerationReader::HeaderSize] = { 'B', 'D', 'E', 'N', 1, 0, 0, 0, 1, 0, 0, 0 };
+            BigDriveEnumerationReader reader;
+
+            // Act
+            HRESULT hr = reader.Initialize(buffer, sizeof(buffer));
+
+            // Assert
+            Assert::AreEqual(E_INVALIDARG, hr);
+        }
+
+        /// <summary>
+        /// Tests that a record whose size runs past the end of the buffer is rejected.
+        /// </summary>
+        TEST_METHOD(Next_TruncatedRecord_Rejected)
+        {
+            // Arrange
+            BYTE buffer[BigDriveEnumerationReader::HeaderSize + BigDriveEnumerationReader::FixedRecordSize + 2] = { 'B', 'D', 'E', 'N', 1, 0, 0, 0, 1, 0, 0, 0 };
+            BYTE* pRecord = buffer + BigDriveEnumerationReader::HeaderSize;
+            BigDriveEnumerationReader reader;
+            BigDriveEnumerationEntry entry;
+
+            // cbRecord says 40 bytes, cchName says 2 characters, but only 38 bytes follow the header
+            pRecord[0] = 40;
+            pRecord[32] = 2;
+
+            // Act
+            HRESULT hrInit = reader.Initialize(buffer, sizeof(buffer));
+            HRESULT hrNext = reader.Next(entry);
+
+            // Assert
+            Assert::AreEqual(S_OK, hrInit);
+            Assert::AreEqual(E_INVALIDARG, hrNext);
+            Assert::IsNull(entry.pchName);
+        }
+
+        /// <summary>
+        /// Tests that the etag hash is stable, distinguishes etags and is zero without an etag.
+        /// </summary>
+        TEST_METHOD(HashETag_DistinctETags_DistinctTokens)
+        {
+            // Act
+            ULONGLONG first = BigDriveEnumerationReader::HashETag(L"abc", 3);
+            ULONGLONG again = BigDriveEnumerationReader::HashETag(L"abc", 3);
+            ULONGLONG other = BigDriveEnumerationReader::HashETag(L"abd", 3);
+
+            // Assert
+            Assert::AreEqual(first, again);
+            Assert::AreNotEqual(first, other);
+            Assert::AreEqual(0ULL, BigDriveEnumerationReader::HashETag(nullptr, 0));
+        }
+
+        /// <summary>
+        /// Benchmark: provider calls needed to list a 10,000 file directory with sizes and dates,
+        /// through IBigDriveEnumerate + IBigDriveFileInfo against a single EnumerateEntries call.
+        /// </summary>
+        TEST_METHOD(Benchmark_RoundTrips_10kEntries)
+        {
+            // Arrange
+            const ULONG entryCount = 10000;
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            BSTR bstrPath = ::SysAllocString(L"\\Big");
+            SAFEARRAY* psaFolders = nullptr;
+            SAFEARRAY* psaFiles = nullptr;
+            SAFEARRAY* psaEntries = nullptr;
+            BigDriveEnumerationReader reader;
+            BigDriveEnumerationEntry entry;
+            LARGE_INTEGER frequency, start, middle, end;
+            LONG legacyCalls = 0, exCalls = 0;
+            ULONG read = 0;
+            wchar_t message[256];
+
+            pProvider->entryCount = entryCount;
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: legacy path, names then two calls per file
+            ::QueryPerformanceCounter(&start);
+            pProvider->EnumerateFolders(EnumerationTestDrive, bstrPath, &psaFolders);
+            pProvider->EnumerateFiles(EnumerationTestDrive, bstrPath, &psaFiles);
+
+            for (LONG i = 0; i < static_cast<LONG>(entryCount); i++)
+            {
+                BSTR bstrName = nullptr;
+                ULONGLONG size = 0;
+                DATE date = 0;
+
+                ::SafeArrayGetElement(psaFiles, &i, &bstrName);
+                pProvider->GetFileSize(EnumerationTestDrive, bstrName, &size);
+                pProvider->LastModifiedTime(EnumerationTestDrive, bstrName, &date);
+                ::SysFreeString(bstrName);
+            }
+
+            ::QueryPerformanceCounter(&middle);
+            legacyCalls = pProvider->callCount;
+
+            // Act: single call
+            pProvider->EnumerateEntries(EnumerationTestDrive, bstrPath, BigDriveEnumerateEntries_Folders | BigDriveEnumerateEntries_Files, &psaEntries);
+            reader.Initialize(psaEntries);
+
+            while (reader.Next(entry) == S_OK)
+            {
+                read++;
+            }
+
+            ::QueryPerformanceCounter(&end);
+            exCalls = pProvider->callCount - legacyCalls;
+
+            double legacyMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double exMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%lu folders + %lu files: IBigDriveEnumerate %ld calls (%.2f ms), IBigDriveEnumerateEx %ld call (%.2f ms)\n",
+                entryCount, entryCount, legacyCalls, legacyMs, exCalls, exMs);
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(static_cast<LONG>(2 + 2 * entryCount), legacyCalls);
+            Assert::AreEqual(1L, exCalls);
+            Assert::AreEqual(2 * entryCount, read);
+
+            // Cleanup
+            reader.Close();
+            ::SafeArrayDestroy(psaFolders);
+            ::SafeArrayDestroy(psaFiles);
+            ::SafeArrayDestroy(psaEntries);
+            ::SysFreeString(bstrPath);
+            pProvider->Release();
+        }
+    };
+}
@@ -0,0 +1,246 @@
+// <copyright file="BigDriveIconCacheTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <shlobj.h>
+#include <strsafe.h>
+
+#include "BigDriveIconCache.h"
+
+#pragma comment(lib, "shell32.lib")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    /// <summary>
+    /// Number of times the test resolvers were called.
+    /// </summary>
+    static volatile LONG s_iconResolveCount = 0;
+
+    /// <summary>
+    /// Registry key the watch test writes under.
+    /// </summary>
+    static LPCWSTR IconCacheTestKey = L"Software\\BigDrive\\IconCacheTests";
+
+    TEST_CLASS(BigDriveIconCacheTests)
+    {
+    private:
+
+        /// <summary>
+        /// Resolver that counts its calls and answers with the length of the extension as the index.
+        /// </summary>
+        static HRESULT CountingResolver(LPCWSTR szExtension, BigDriveIconLocation& location)
+        {
+            ::InterlockedIncrement(&s_iconResolveCount);
+
+            ::StringCchCopyW(location.szFile, ARRAYSIZE(location.szFile), L"shell32.dll");
+            location.iIndex = static_cast<int>(::wcslen(szExtension));
+            location.uFlags = GIL_NOTFILENAME;
+
+            return S_OK;
+        }
+
+        /// <summary>
+        /// Resolver that counts its calls and fails.
+        /// </summary>
+        static HRESULT FailingResolver(LPCWSTR szExtension, BigDriveIconLocation& location)
+        {
+            ::InterlockedIncrement(&s_iconResolveCount);
+            return E_FAIL;
+        }
+
+        /// <summary>
+        /// Resolver that asks the system, as the shell folder does.
+        /// </summary>
+        static HRESULT SystemResolver(LPCWSTR szExtension, BigDriveIconLocation& location)
+        {
+            WCHAR szDummyFile[MAX_PATH] = L"dummy";
+            SHFILEINFOW shfi = { 0 };
+
+            ::StringCchCatW(szDummyFile, ARRAYSIZE(szDummyFile), szExtension);
+            ::SHGetFileInfoW(szDummyFile, FILE_ATTRIBUTE_NORMAL, &shfi, sizeof(shfi), SHGFI_ICONLOCATION | SHGFI_USEFILEATTRIBUTES);
+
+            ::StringCchCopyW(location.szFile, ARRAYSIZE(location.szFile), shfi.szDisplayName);
+            location.iIndex = shfi.iIcon;
+            location.uFlags = 0;
+
+            return S_OK;
+        }
+
+    public:
+
+        /// <summary>
+        /// Tests that repeated lookups of an extension, in any case, go to the resolver once.
+        /// </summary>
+        TEST_METHOD(GetIconLocation_SameExtension_ResolvesOnce)
+        {
+            // Arrange
+            BigDriveIconCache cache;
+            BigDriveIconLocation location;
+            LONG hits = 0, misses = 0, clears = 0;
+            ULONG count = 0;
+
+            s_iconResolveCount = 0;
+
+            // Act
+            Assert::AreEqual(S_OK, cache.GetIconLocation(L".jpg", CountingResolver, location));
+            Assert::AreEqual(S_OK, cache.GetIconLocation(L".JPG", CountingResolver, location));
+            Assert::AreEqual(S_OK, cache.GetIconLocation(L".Jpg", CountingResolver, location));
+            Assert::AreEqual(S_OK, cache.GetIconLocation(L".jpeg", CountingResolver, location));
+            cache.GetStatistics(hits, misses, clears, count);
+
+            // Assert
+            Assert::AreEqual(2L, s_iconResolveCount);
+            Assert::AreEqual(5, location.iIndex);
+            Assert::AreEqual(static_cast<UINT>(GIL_NOTFILENAME), location.uFlags);
+            Assert::AreEqual(L"shell32.dll", location.szFile);
+            Assert::AreEqual(2L, hits);
+            Assert::AreEqual(2L, misses);
+            Assert::AreEqual(2UL, count);
+        }
+
+        /// <summary>
+        /// Tests that a cleared cache asks the resolver again.
+        /// </summary>
+        TEST_METHOD(Clear_ResolvesAgain)
+        {
+            // Arrange
+            BigDriveIconCache cache;
+            BigDriveIconLocation location;
+            LONG hits = 0, misses = 0, clears = 0;
+            ULONG count = 0;
+
+            s_iconResolveCount = 0;
+            Assert::AreEqual(S_OK, cache.GetIconLocation(L".txt", CountingResolver, location));
+
+            // Act
+            cache.Clear();
+            Assert::AreEqual(S_OK, cache.GetIconLocation(L".txt", CountingResolver, location));
+            cache.GetStatistics(hits, misses, clears, count);
+
+            // Assert
+            Assert::AreEqual(2L, s_iconResolveCount);
+            Assert::AreEqual(1L, clears);
+            Assert::AreEqual(1UL, count);
+        }
+
+        /// <summary>
+        /// Tests that a failed resolve is returned and not cached.
+        /// </summary>
+        TEST_METHOD(GetIconLocation_ResolverFails_NotCached)
+        {
+            // Arrange
+            BigDriveIconCache cache;
+            BigDriveIconLocation location;
+            LONG hits = 0, misses = 0, clears = 0;
+            ULONG count = 0;
+
+            s_iconResolveCount = 0;
+
+            // Act
+            Assert::AreEqual(E_FAIL, cache.GetIconLocation(L".bin", FailingResolver, location));
+            Assert::AreEqual(E_FAIL, cache.GetIconLocation(L".bin", FailingResolver, location));
+            cache.GetStatistics(hits, misses, clears, count);
+
+            // Assert
+            Assert::AreEqual(2L, s_iconResolveCount);
+            Assert::AreEqual(0UL, count);
+        }
+
+        /// <summary>
+        /// Tests that a change under a watched registry key clears the cache.
+        /// </summary>
+        TEST_METHOD(WatchRegistryKey_ValueChanged_Clears)
+        {
+            // Arrange
+            BigDriveIconCache* pCache = new BigDriveIconCache();
+            BigDriveIconLocation location;
+            HKEY hKey = nullptr;
+            DWORD value = 1;
+            LONG hits = 0, misses = 0, clears = 0;
+            ULONG count = 0;
+
+            Assert::AreEqual(ERROR_SUCCESS, ::RegCreateKeyExW(HKEY_CURRENT_USER, IconCacheTestKey, 0, nullptr, 0, KEY_ALL_ACCESS, nullptr, &hKey, nullptr));
+            Assert::AreEqual(S_OK, pCache->WatchRegistryKey(HKEY_CURRENT_USER, IconCacheTestKey));
+            Assert::AreEqual(S_OK, pCache->GetIconLocation(L".png", CountingResolver, location));
+
+            // Act
+            Assert::AreEqual(ERROR_SUCCESS, ::RegSetValueExW(hKey, L"Changed", 0, REG_DWORD, reinterpret_cast<const BYTE*>(&value), sizeof(value)));
+
+            for (int i = 0; i < 100; i++)
+            {
+                pCache->GetStatistics(hits, misses, clears, count);
+                if (clears > 0)
+                {
+                    break;
+                }
+
+                ::Sleep(20);
+            }
+
+            // Assert
+            Assert::IsTrue(clears > 0);
+            Assert::AreEqual(0UL, count);
+
+            // Cleanup
+            delete pCache;
+            ::RegCloseKey(hKey);
+            ::RegDeleteKeyW(HKEY_CURRENT_USER, IconCacheTestKey);
+        }
+
+        /// <summary>
+        /// Benchmark: the icon lookups of a folder of 10,000 .jpg files, asking the system for each
+        /// item and through the cache.
+        /// </summary>
+        TEST_METHOD(Benchmark_TenThousandJpegIcons)
+        {
+            // Arrange
+            const ULONG items = 10000;
+            BigDriveIconCache cache;
+            BigDriveIconLocation uncached;
+            BigDriveIconLocation cached;
+            LARGE_INTEGER frequency, start, middle, end;
+            LONG hits = 0, misses = 0, clears = 0;
+            ULONG count = 0;
+            wchar_t message[256];
+
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: every item asks the system
+            ::QueryPerformanceCounter(&start);
+
+            for (ULONG i = 0; i < items; i++)
+            {
+                SystemResolver(L".jpg", uncached);
+            }
+
+            ::QueryPerformanceCounter(&middle);
+
+            // Act: the system is asked on a miss
+            for (ULONG i = 0; i < items; i++)
+            {
+                cache.GetIconLocation(L".jpg", SystemResolver, cached);
+            }
+
+            ::QueryPerformanceCounter(&end);
+            cache.GetStatistics(hits, misses, clears, count);
+
+            double uncachedMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double cachedMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%lu icons: uncached %.2f ms, cached %.2f ms (%ld misses)\n",
+                items, uncachedMs, cachedMs, misses);
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(1L, misses);
+            Assert::AreEqual(static_cast<LONG>(items - 1), hits);
+            Assert::AreEqual(uncached.iIndex, cached.iIndex);
+            Assert::AreEqual(uncached.szFile, cached.szFile);
+            Assert::IsTrue(cachedMs < uncachedMs);
+        }
+    };
+}
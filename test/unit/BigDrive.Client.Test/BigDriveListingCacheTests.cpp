@@ -0,0 +1,455 @@
+// <copyright file="BigDriveListingCacheTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <objbase.h>
+#include <oleauto.h>
+
+#include "BigDriveEnumerationReader.h"
+#include "BigDriveEnumerationWriter.h"
+#include "BigDriveListing.h"
+#include "BigDriveListingCache.h"
+#include "MockBigDriveProvider.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID ListingCacheTestDrive = { 0xE0E0E0E0, 0x0007, 0x4E00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07 } };
+    const GUID ListingCacheOtherDrive = { 0xE0E0E0E0, 0x0007, 0x4E00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08 } };
+    const LONG ListingCacheAllEntries = BigDriveEnumerateEntries_Folders | BigDriveEnumerateEntries_Files;
+
+    TEST_CLASS(BigDriveListingCacheTests)
+    {
+    private:
+
+        /// <summary>
+        /// Packs count folders named Folder0, Folder1, ... into the writer.
+        /// </summary>
+        static void WriteFolders(BigDriveEnumerationWriter& writer, ULONG count)
+        {
+            wchar_t name[32];
+
+            for (ULONG i = 0; i < count; i++)
+            {
+                ::swprintf_s(name, L"Folder%lu", i);
+                Assert::AreEqual(S_OK, writer.AppendName(1, name));
+            }
+        }
+
+        /// <summary>
+        /// Stores a listing of count folders for the path.
+        /// </summary>
+        static void StoreFolders(BigDriveListingCache& cache, REFGUID driveGuid, LPCWSTR szPath, LONG flags, ULONG count)
+        {
+            BigDriveEnumerationWriter writer(MAXDWORD);
+            const BYTE* pBuffer = nullptr;
+            ULONG cbBuffer = 0;
+
+            WriteFolders(writer, count);
+            Assert::AreEqual(S_OK, writer.GetBuffer(&pBuffer, cbBuffer));
+            Assert::AreEqual(S_OK, cache.Store(driveGuid, szPath, flags, pBuffer, cbBuffer));
+        }
+
+        /// <summary>
+        /// Looks up a path and releases the listing on a hit.
+        /// </summary>
+        static HRESULT LookupAndRelease(BigDriveListingCache& cache, REFGUID driveGuid, LPCWSTR szPath, LONG flags)
+        {
+            BigDriveListing* pListing = nullptr;
+            HRESULT hr = cache.Lookup(driveGuid, szPath, flags, &pListing);
+
+            if (pListing)
+            {
+                pListing->Release();
+            }
+
+            return hr;
+        }
+
+    public:
+
+        /// <summary>
+        /// Tests that entries packed by the writer are read back unchanged by the reader.
+        /// </summary>
+        TEST_METHOD(Writer_Entries_RoundTrip)
+        {
+            // Arrange
+            BigDriveEnumerationWriter writer(MAXDWORD);
+            BigDriveEnumerationReader reader;
+            BigDriveEnumerationEntry entry;
+            const BYTE* pBuffer = nullptr;
+            ULONG cbBuffer = 0;
+
+            ::ZeroMemory(&entry, sizeof(BigDriveEnumerationEntry));
+            entry.uType = 2;
+            entry.dwFields = 0x0F;
+            entry.ullSize = 4096;
+            entry.ftLastWrite.dwLowDateTime = 7;
+            entry.pchName = L"Report.docx";
+            entry.cchName = 11;
+            entry.pchETag = L"etag";
+            entry.cchETag = 4;
+
+            // Act
+            Assert::AreEqual(S_OK, writer.AppendName(1, L"Folder"));
+            Assert::AreEqual(S_OK, writer.Append(entry));
+            Assert::AreEqual(S_OK, writer.GetBuffer(&pBuffer, cbBuffer));
+
+            // Assert
+            Assert::AreEqual(S_OK, reader.Initialize(pBuffer, cbBuffer));
+            Assert::AreEqual(2UL, reader.GetCount());
+
+            Assert::AreEqual(S_OK, reader.Next(entry));
+            Assert::AreEqual(1U, entry.uType);
+            Assert::AreEqual(0, ::wcsncmp(L"Folder", entry.pchName, entry.cchName));
+
+            Assert::AreEqual(S_OK, reader.Next(entry));
+            Assert::AreEqual(2U, entry.uType);
+            Assert::AreEqual(4096ULL, entry.ullSize);
+            Assert::AreEqual(7UL, entry.ftLastWrite.dwLowDateTime);
+            Assert::AreEqual(0, ::wcsncmp(L"Report.docx", entry.pchName, entry.cchName));
+            Assert::AreEqual(0, ::wcsncmp(L"etag", entry.pchETag, entry.cchETag));
+
+            Assert::AreEqual(S_FALSE, reader.Next(entry));
+
+            // Cleanup
+            reader.Close();
+        }
+
+        /// <summary>
+        /// Tests that the writer refuses to grow past its limit.
+        /// </summary>
+        TEST_METHOD(Writer_OverLimit_Refused)
+        {
+            // Arrange
+            BigDriveEnumerationWriter writer(BigDriveEnumerationReader::HeaderSize + BigDriveEnumerationReader::FixedRecordSize + 16);
+
+            // Act
+            HRESULT hrFirst = writer.AppendName(1, L"A");
+            HRESULT hrSecond = writer.AppendName(1, L"B");
+
+            // Assert
+            Assert::AreEqual(S_OK, hrFirst);
+            Assert::AreEqual(E_NOT_SUFFICIENT_BUFFER, hrSecond);
+            Assert::AreEqual(1UL, writer.GetCount());
+        }
+
+        /// <summary>
+        /// Tests that a stored listing is served for the same folder regardless of case and slashes.
+        /// </summary>
+        TEST_METHOD(Lookup_AfterStore_Hit)
+        {
+            // Arrange
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, BigDriveListingCache::DefaultBudget);
+            BigDriveListing* pListing = nullptr;
+            BigDriveEnumerationReader reader;
+            LONG hits = 0, misses = 0, evictions = 0;
+            SIZE_T cbUsed = 0;
+
+            StoreFolders(cache, ListingCacheTestDrive, L"\\Photos\\2024", ListingCacheAllEntries, 5);
+
+            // Act
+            HRESULT hr = cache.Lookup(ListingCacheTestDrive, L"/photos/2024/", ListingCacheAllEntries, &pListing);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr);
+            Assert::IsNotNull(pListing);
+            Assert::AreEqual(S_OK, pListing->Read(reader));
+            Assert::AreEqual(5UL, reader.GetCount());
+
+            Assert::AreEqual(S_FALSE, LookupAndRelease(cache, ListingCacheOtherDrive, L"\\Photos\\2024", ListingCacheAllEntries));
+            Assert::AreEqual(S_FALSE, LookupAndRelease(cache, ListingCacheTestDrive, L"\\Photos", ListingCacheAllEntries));
+
+            cache.GetStatistics(hits, misses, evictions, cbUsed);
+            Assert::AreEqual(1L, hits);
+            Assert::AreEqual(2L, misses);
+            Assert::AreEqual(0L, evictions);
+            Assert::IsTrue(cbUsed > 0);
+
+            // Cleanup
+            reader.Close();
+            pListing->Release();
+        }
+
+        /// <summary>
+        /// Tests that a listing serves lookups for a subset of its flags but not a superset.
+        /// </summary>
+        TEST_METHOD(Lookup_Flags_SupersetServesSubset)
+        {
+            // Arrange
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, BigDriveListingCache::DefaultBudget);
+
+            StoreFolders(cache, ListingCacheTestDrive, L"\\All", ListingCacheAllEntries, 2);
+            StoreFolders(cache, ListingCacheTestDrive, L"\\FoldersOnly", BigDriveEnumerateEntries_Folders, 2);
+
+            // Act & Assert
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\All", BigDriveEnumerateEntries_Folders));
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\All", BigDriveEnumerateEntries_Files));
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\FoldersOnly", BigDriveEnumerateEntries_Folders));
+            Assert::AreEqual(S_FALSE, LookupAndRelease(cache, ListingCacheTestDrive, L"\\FoldersOnly", ListingCacheAllEntries));
+        }
+
+        /// <summary>
+        /// Tests that a listing is dropped once its time to live passes.
+        /// </summary>
+        TEST_METHOD(Lookup_Expired_Miss)
+        {
+            // Arrange
+            BigDriveListingCache cache(50, BigDriveListingCache::DefaultBudget);
+            LONG hits = 0, misses = 0, evictions = 0;
+            SIZE_T cbUsed = 0;
+
+            StoreFolders(cache, ListingCacheTestDrive, L"\\Stale", ListingCacheAllEntries, 3);
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\Stale", ListingCacheAllEntries));
+
+            // Act
+            ::Sleep(100);
+            HRESULT hr = LookupAndRelease(cache, ListingCacheTestDrive, L"\\Stale", ListingCacheAllEntries);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr);
+
+            cache.GetStatistics(hits, misses, evictions, cbUsed);
+            Assert::AreEqual(1L, evictions);
+            Assert::AreEqual(static_cast<SIZE_T>(0), cbUsed);
+        }
+
+        /// <summary>
+        /// Tests that the least recently used listing is evicted when the budget is exceeded.
+        /// </summary>
+        TEST_METHOD(Store_OverBudget_EvictsLeastRecentlyUsed)
+        {
+            // Arrange: measure the charge of one listing, then allow four
+            BigDriveListingCache probe(BigDriveListingCache::DefaultTimeToLiveMs, BigDriveListingCache::DefaultBudget);
+            LONG hits = 0, misses = 0, evictions = 0;
+            SIZE_T cbCharge = 0;
+
+            StoreFolders(probe, ListingCacheTestDrive, L"\\A", ListingCacheAllEntries, 10);
+            probe.GetStatistics(hits, misses, evictions, cbCharge);
+
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, 4 * cbCharge);
+            SIZE_T cbUsed = 0;
+
+            StoreFolders(cache, ListingCacheTestDrive, L"\\A", ListingCacheAllEntries, 10);
+            StoreFolders(cache, ListingCacheTestDrive, L"\\B", ListingCacheAllEntries, 10);
+            StoreFolders(cache, ListingCacheTestDrive, L"\\C", ListingCacheAllEntries, 10);
+            StoreFolders(cache, ListingCacheTestDrive, L"\\D", ListingCacheAllEntries, 10);
+
+            // A becomes the most recently used, leaving B the oldest
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\A", ListingCacheAllEntries));
+
+            // Act
+            StoreFolders(cache, ListingCacheTestDrive, L"\\E", ListingCacheAllEntries, 10);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, LookupAndRelease(cache, ListingCacheTestDrive, L"\\B", ListingCacheAllEntries));
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\A", ListingCacheAllEntries));
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\E", ListingCacheAllEntries));
+
+            cache.GetStatistics(hits, misses, evictions, cbUsed);
+            Assert::AreEqual(1L, evictions);
+            Assert::IsTrue(cbUsed <= 4 * cbCharge);
+        }
+
+        /// <summary>
+        /// Tests that a listing larger than the cache is willing to hold is not stored.
+        /// </summary>
+        TEST_METHOD(Store_TooLarge_NotCached)
+        {
+            // Arrange
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, 4096);
+            BigDriveEnumerationWriter writer(MAXDWORD);
+            const BYTE* pBuffer = nullptr;
+            ULONG cbBuffer = 0;
+
+            WriteFolders(writer, 100);
+            writer.GetBuffer(&pBuffer, cbBuffer);
+
+            // Act
+            HRESULT hr = cache.Store(ListingCacheTestDrive, L"\\Huge", ListingCacheAllEntries, pBuffer, cbBuffer);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr);
+            Assert::AreEqual(S_FALSE, LookupAndRelease(cache, ListingCacheTestDrive, L"\\Huge", ListingCacheAllEntries));
+        }
+
+        /// <summary>
+        /// Tests that invalidating a folder drops it and the folders below it, but not its siblings or other drives.
+        /// </summary>
+        TEST_METHOD(Invalidate_Folder_DropsDescendants)
+        {
+            // Arrange
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, BigDriveListingCache::DefaultBudget);
+
+            StoreFolders(cache, ListingCacheTestDrive, L"\\", ListingCacheAllEntries, 1);
+            StoreFolders(cache, ListingCacheTestDrive, L"\\Docs", ListingCacheAllEntries, 1);
+            StoreFolders(cache, ListingCacheTestDrive, L"\\Docs\\Old", ListingCacheAllEntries, 1);
+            StoreFolders(cache, ListingCacheTestDrive, L"\\Docs2", ListingCacheAllEntries, 1);
+            StoreFolders(cache, ListingCacheOtherDrive, L"\\Docs", ListingCacheAllEntries, 1);
+
+            // Act
+            cache.Invalidate(ListingCacheTestDrive, L"\\DOCS\\");
+
+            // Assert
+            Assert::AreEqual(S_FALSE, LookupAndRelease(cache, ListingCacheTestDrive, L"\\Docs", ListingCacheAllEntries));
+            Assert::AreEqual(S_FALSE, LookupAndRelease(cache, ListingCacheTestDrive, L"\\Docs\\Old", ListingCacheAllEntries));
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\", ListingCacheAllEntries));
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheTestDrive, L"\\Docs2", ListingCacheAllEntries));
+            Assert::AreEqual(S_OK, LookupAndRelease(cache, ListingCacheOtherDrive, L"\\Docs", ListingCacheAllEntries));
+        }
+
+        /// <summary>
+        /// Tests that one item is found in its folder's listing by name, without regard to case.
+        /// </summary>
+        TEST_METHOD(LookupEntry_CachedFolder_FindsItem)
+        {
+            // Arrange
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, BigDriveListingCache::DefaultBudget);
+            BigDriveEnumerationEntry entry;
+
+            StoreFolders(cache, ListingCacheTestDrive, L"\\Music", ListingCacheAllEntries, 200);
+
+            // Act
+            HRESULT hrFound = cache.LookupEntry(ListingCacheTestDrive, L"\\Music", L"FOLDER123", entry);
+            HRESULT hrMissing = cache.LookupEntry(ListingCacheTestDrive, L"\\Music", L"Folder200", entry);
+            HRESULT hrUncached = cache.LookupEntry(ListingCacheTestDrive, L"\\Video", L"Folder1", entry);
+
+            // Assert
+            Assert::AreEqual(S_OK, hrFound);
+            Assert::AreEqual(S_FALSE, hrMissing);
+            Assert::AreEqual(S_FALSE, hrUncached);
+        }
+
+        /// <summary>
+        /// Tests that an update replaces the listing it was built from, and is refused once that listing is replaced.
+        /// </summary>
+        TEST_METHOD(Update_ExpectedListing_Replaced)
+        {
+            // Arrange
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, BigDriveListingCache::DefaultBudget);
+            BigDriveEnumerationWriter writer(MAXDWORD);
+            BigDriveListing* pListing = nullptr;
+            BigDriveListing* pUpdated = nullptr;
+            BigDriveEnumerationReader reader;
+            const BYTE* pBuffer = nullptr;
+            ULONG cbBuffer = 0;
+
+            StoreFolders(cache, ListingCacheTestDrive, L"\\Books", ListingCacheAllEntries, 3);
+            Assert::AreEqual(S_OK, cache.Lookup(ListingCacheTestDrive, L"\\Books", ListingCacheAllEntries, &pListing));
+
+            WriteFolders(writer, 4);
+            Assert::AreEqual(S_OK, writer.GetBuffer(&pBuffer, cbBuffer));
+
+            // Act
+            HRESULT hrUpdate = cache.Update(ListingCacheTestDrive, L"\\Books", pListing, pBuffer, cbBuffer);
+            HRESULT hrStale = cache.Update(ListingCacheTestDrive, L"\\Books", pListing, pBuffer, cbBuffer);
+
+            // Assert
+            Assert::AreEqual(S_OK, hrUpdate);
+            Assert::AreEqual(S_FALSE, hrStale);
+            Assert::AreEqual(S_OK, cache.Lookup(ListingCacheTestDrive, L"\\Books", ListingCacheAllEntries, &pUpdated));
+            Assert::AreEqual(S_OK, pUpdated->Read(reader));
+            Assert::AreEqual(4UL, reader.GetCount());
+
+            // Cleanup
+            reader.Close();
+            pUpdated->Release();
+            pListing->Release();
+        }
+
+        /// <summary>
+        /// Benchmark: replays a navigation session (open a folder, drill in, go back, revisit) against a
+        /// provider that takes 2 ms a call, with and without the listing cache, and reports the hit rate.
+        /// </summary>
+        TEST_METHOD(Benchmark_NavigationSession)
+        {
+            // Arrange
+            LPCWSTR session[] =
+            {
+                L"\\", L"\\Docs", L"\\Docs\\2023", L"\\Docs", L"\\Docs\\2024", L"\\Docs", L"\\",
+                L"\\Photos", L"\\Photos\\Trip", L"\\Photos", L"\\", L"\\Docs", L"\\Docs\\2024", L"\\Docs\\2023",
+                L"\\Docs", L"\\", L"\\Photos", L"\\Photos\\Trip", L"\\Photos", L"\\"
+            };
+            const ULONG rounds = 5;
+            const ULONG visits = rounds * ARRAYSIZE(session);
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 2);
+            BigDriveListingCache cache(BigDriveListingCache::DefaultTimeToLiveMs, BigDriveListingCache::DefaultBudget);
+            LARGE_INTEGER frequency, start, middle, end;
+            LONG uncachedCalls = 0, cachedCalls = 0;
+            LONG hits = 0, misses = 0, evictions = 0;
+            SIZE_T cbUsed = 0;
+            wchar_t message[256];
+
+            pProvider->entryCount = 500;
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: every visit goes to the provider
+            ::QueryPerformanceCounter(&start);
+
+            for (ULONG i = 0; i < visits; i++)
+            {
+                BSTR bstrPath = ::SysAllocString(session[i % ARRAYSIZE(session)]);
+                SAFEARRAY* psa = nullptr;
+
+                pProvider->EnumerateEntries(ListingCacheTestDrive, bstrPath, ListingCacheAllEntries, &psa);
+                ::SafeArrayDestroy(psa);
+                ::SysFreeString(bstrPath);
+            }
+
+            ::QueryPerformanceCounter(&middle);
+            uncachedCalls = pProvider->callCount;
+
+            // Act: visits go to the provider only on a miss
+            for (ULONG i = 0; i < visits; i++)
+            {
+                LPCWSTR szPath = session[i % ARRAYSIZE(session)];
+                BigDriveListing* pListing = nullptr;
+                BSTR bstrPath = nullptr;
+                SAFEARRAY* psa = nullptr;
+                BYTE* pData = nullptr;
+
+                if (cache.Lookup(ListingCacheTestDrive, szPath, ListingCacheAllEntries, &pListing) == S_OK)
+                {
+                    pListing->Release();
+                    continue;
+                }
+
+                bstrPath = ::SysAllocString(szPath);
+                pProvider->EnumerateEntries(ListingCacheTestDrive, bstrPath, ListingCacheAllEntries, &psa);
+
+                if (SUCCEEDED(::SafeArrayAccessData(psa, reinterpret_cast<void**>(&pData))))
+                {
+                    cache.Store(ListingCacheTestDrive, szPath, ListingCacheAllEntries, pData, psa->rgsabound[0].cElements);
+                    ::SafeArrayUnaccessData(psa);
+                }
+
+                ::SafeArrayDestroy(psa);
+                ::SysFreeString(bstrPath);
+            }
+
+            ::QueryPerformanceCounter(&end);
+            cachedCalls = pProvider->callCount - uncachedCalls;
+            cache.GetStatistics(hits, misses, evictions, cbUsed);
+
+            double uncachedMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double cachedMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%lu visits: uncached %ld calls (%.2f ms), cached %ld calls (%.2f ms), hit rate %.1f%%, %Iu bytes held\n",
+                visits, uncachedCalls, uncachedMs, cachedCalls, cachedMs, 100.0 * hits / (hits + misses), cbUsed);
+            Logger::WriteMessage(message);
+
+            // Assert: six distinct folders, each fetched once
+            Assert::AreEqual(static_cast<LONG>(visits), uncachedCalls);
+            Assert::AreEqual(6L, cachedCalls);
+            Assert::AreEqual(6L, misses);
+            Assert::AreEqual(static_cast<LONG>(visits - 6), hits);
+            Assert::IsTrue(cachedMs < uncachedMs);
+
+            // Cleanup
+            pProvider->Release();
+        }
+    };
+}
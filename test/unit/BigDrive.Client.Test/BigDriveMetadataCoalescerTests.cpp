@@ -0,0 +1,262 @@
+// <copyright file="BigDriveMetadataCoalescerTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <objbase.h>
+#include <oleauto.h>
+
+#include "BigDriveMetadataCoalescer.h"
+#include "MockBigDriveProvider.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID CoalescerTestDrive = { 0xE0E0E0E0, 0x0009, 0x4E00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09 } };
+
+    struct CoalescerRequestContext
+    {
+        BigDriveMetadataCoalescer* pCoalescer;
+        MockBigDriveProvider* pProvider;
+        HANDLE hStart;
+        ULONG requestsPerThread;
+        volatile LONG nextThread;
+        volatile LONG wrongAnswers;
+        volatile LONG failures;
+        HRESULT hrFailure;
+    };
+
+    /// <summary>
+    /// Asks for the metadata of requestsPerThread paths unique to the thread and checks each answer is its own.
+    /// </summary>
+    static DWORD WINAPI CoalescerRequestThread(LPVOID pParameter)
+    {
+        CoalescerRequestContext* pContext = static_cast<CoalescerRequestContext*>(pParameter);
+        LONG thread = ::InterlockedIncrement(&pContext->nextThread);
+        BigDriveEnumerationEntry entry;
+        wchar_t path[64];
+        HRESULT hr = S_OK;
+
+        ::WaitForSingleObject(pContext->hStart, INFINITE);
+
+        for (ULONG i = 0; i < pContext->requestsPerThread; i++)
+        {
+            ::swprintf_s(path, L"\\Photos\\Thread%ld\\IMG_%0*lu.jpg", thread, static_cast<int>(thread), i);
+
+            hr = pContext->pCoalescer->GetFileInfo(pContext->pProvider, CoalescerTestDrive, path, BigDriveFileInfoFields_All, entry);
+            if (FAILED(hr))
+            {
+                pContext->hrFailure = hr;
+                ::InterlockedIncrement(&pContext->failures);
+            }
+            else if ((hr != S_OK) || (entry.ullSize != ::wcslen(path)))
+            {
+                // The mock answers with the path's length, which differs between threads
+                ::InterlockedIncrement(&pContext->wrongAnswers);
+            }
+        }
+
+        return 0;
+    }
+
+    TEST_CLASS(BigDriveMetadataCoalescerTests)
+    {
+    private:
+
+        /// <summary>
+        /// Runs threadCount threads of requestsPerThread requests each, released together.
+        /// </summary>
+        static void RunThreads(CoalescerRequestContext& context, ULONG threadCount)
+        {
+            HANDLE threads[16] = {};
+
+            Assert::IsTrue(threadCount <= ARRAYSIZE(threads));
+
+            context.hStart = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                threads[i] = ::CreateThread(nullptr, 0, CoalescerRequestThread, &context, 0, nullptr);
+            }
+
+            ::SetEvent(context.hStart);
+            ::WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+
+            ::CloseHandle(context.hStart);
+            context.hStart = nullptr;
+        }
+
+    public:
+
+        /// <summary>
+        /// Tests that a lone request is sent once its window passes and gets its own answer.
+        /// </summary>
+        TEST_METHOD(GetFileInfo_LoneRequest_SentAfterWindow)
+        {
+            // Arrange
+            BigDriveMetadataCoalescer coalescer(1, BigDriveMetadataCoalescer::DefaultMaxBatch);
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            BigDriveEnumerationEntry entry;
+            LONG requests = 0, calls = 0;
+
+            // Act
+            HRESULT hr = coalescer.GetFileInfo(pProvider, CoalescerTestDrive, L"\\Docs\\a.txt", BigDriveFileInfoFields_All, entry);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr);
+            Assert::AreEqual(static_cast<DWORD>(BigDriveFileInfoFields_All), entry.dwFields);
+            Assert::AreEqual(11ULL, entry.ullSize);
+            Assert::IsNull(entry.pchName);
+
+            coalescer.GetStatistics(requests, calls);
+            Assert::AreEqual(1L, requests);
+            Assert::AreEqual(1L, calls);
+            Assert::AreEqual(1L, static_cast<LONG>(pProvider->callCount));
+
+            // Cleanup
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Tests that a path the provider doesn't know is answered with S_FALSE.
+        /// </summary>
+        TEST_METHOD(GetFileInfo_MissingPath_False)
+        {
+            // Arrange
+            BigDriveMetadataCoalescer coalescer(0, BigDriveMetadataCoalescer::DefaultMaxBatch);
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            BigDriveEnumerationEntry entry;
+
+            // Act
+            HRESULT hr = coalescer.GetFileInfo(pProvider, CoalescerTestDrive, L"\\Docs\\Missing.txt", BigDriveFileInfoFields_All, entry);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr);
+            Assert::AreEqual(0UL, entry.dwFields);
+
+            // Cleanup
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Tests that concurrent requests are sent in one call that fills the batch, and each caller gets its own answer.
+        /// The window is longer than the test, so only a full batch sends it.
+        /// </summary>
+        TEST_METHOD(GetFileInfo_ConcurrentRequests_OneCall)
+        {
+            // Arrange
+            const ULONG threadCount = 8;
+            BigDriveMetadataCoalescer coalescer(60000, threadCount);
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 1);
+            CoalescerRequestContext context = { &coalescer, pProvider, nullptr, 1, 0, 0, 0, S_OK };
+            LONG requests = 0, calls = 0;
+
+            // Act
+            RunThreads(context, threadCount);
+
+            // Assert
+            Assert::AreEqual(0L, static_cast<LONG>(context.failures));
+            Assert::AreEqual(0L, static_cast<LONG>(context.wrongAnswers));
+            Assert::AreEqual(1L, static_cast<LONG>(pProvider->callCount));
+            Assert::AreEqual(static_cast<LONG>(threadCount), static_cast<LONG>(pProvider->largestBatch));
+
+            coalescer.GetStatistics(requests, calls);
+            Assert::AreEqual(static_cast<LONG>(threadCount), requests);
+            Assert::AreEqual(1L, calls);
+
+            // Cleanup
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Tests that a failed call fails every request that joined it, so each caller can reconnect.
+        /// </summary>
+        TEST_METHOD(GetFileInfo_CallFails_EveryRequestFails)
+        {
+            // Arrange
+            const ULONG threadCount = 4;
+            BigDriveMetadataCoalescer coalescer(60000, threadCount);
+            MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 0);
+            CoalescerRequestContext context = { &coalescer, pProvider, nullptr, 1, 0, 0, 0, S_OK };
+
+            pProvider->failWith = RPC_E_DISCONNECTED;
+
+            // Act
+            RunThreads(context, threadCount);
+
+            // Assert
+            Assert::AreEqual(static_cast<LONG>(threadCount), static_cast<LONG>(context.failures));
+            Assert::AreEqual(RPC_E_DISCONNECTED, context.hrFailure);
+            Assert::AreEqual(1L, static_cast<LONG>(pProvider->callCount));
+
+            // Cleanup
+            pProvider->Release();
+        }
+
+        /// <summary>
+        /// Benchmark: eight threads asking for the metadata of 50 items each, one at a time as GetDetailsEx does,
+        /// against a provider that takes 1 ms a call. A zero window sends each request on its own; the others
+        /// trade up to one window of added latency for fewer, larger calls.
+        /// </summary>
+        TEST_METHOD(Benchmark_ConcurrentDetails_1msProvider)
+        {
+            // Arrange
+            const ULONG threadCount = 8;
+            const ULONG requestsPerThread = 50;
+            const DWORD windows[] = { 0, 1, 2, 5 };
+            LARGE_INTEGER frequency, start, end;
+            wchar_t message[256];
+            LONG uncoalescedCalls = 0;
+            LONG coalescedCalls = 0;
+
+            ::QueryPerformanceFrequency(&frequency);
+
+            for (ULONG w = 0; w < ARRAYSIZE(windows); w++)
+            {
+                BigDriveMetadataCoalescer coalescer(windows[w], BigDriveMetadataCoalescer::DefaultMaxBatch);
+                MockBigDriveProvider* pProvider = new MockBigDriveProvider(nullptr, 1);
+                CoalescerRequestContext context = { &coalescer, pProvider, nullptr, requestsPerThread, 0, 0, 0, S_OK };
+                LONG requests = 0, calls = 0;
+
+                // Act
+                ::QueryPerformanceCounter(&start);
+                RunThreads(context, threadCount);
+                ::QueryPerformanceCounter(&end);
+
+                coalescer.GetStatistics(requests, calls);
+
+                double elapsedMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+                ::swprintf_s(message, L"window %lu ms: %ld requests in %ld provider calls (largest %ld), %.2f ms, %.0f requests/s, %.0f calls/s\n",
+                    windows[w], requests, calls, static_cast<LONG>(pProvider->largestBatch), elapsedMs,
+                    requests * 1000.0 / elapsedMs, calls * 1000.0 / elapsedMs);
+                Logger::WriteMessage(message);
+
+                Assert::AreEqual(0L, static_cast<LONG>(context.failures));
+                Assert::AreEqual(0L, static_cast<LONG>(context.wrongAnswers));
+
+                if (windows[w] == 0)
+                {
+                    uncoalescedCalls = calls;
+                }
+                else if (windows[w] == BigDriveMetadataCoalescer::DefaultWindowMs)
+                {
+                    coalescedCalls = calls;
+                }
+
+                pProvider->Release();
+            }
+
+            // Assert
+            Assert::AreEqual(static_cast<LONG>(threadCount * requestsPerThread), uncoalescedCalls);
+            Assert::IsTrue(coalescedCalls < uncoalescedCalls);
+        }
+    };
+}
@@ -0,0 +1,104 @@
+// <copyright file="BigDrivePerformanceCountersTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "BigDrivePerformanceCounters.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    TEST_CLASS(BigDrivePerformanceCountersTests)
+    {
+    public:
+
+        /// <summary>
+        /// Tests that the counters are published in the named block another process would open.
+        /// </summary>
+        TEST_METHOD(Increment_VisibleThroughNamedBlock)
+        {
+            // Arrange
+            WCHAR szName[64];
+            HANDLE hMapping = nullptr;
+            const BigDriveCounterBlock* pBlock = nullptr;
+            LONGLONG before = 0;
+
+            BigDrivePerformanceCounters::Increment(BigDriveCounter_LiveShellFolders);
+            Assert::AreEqual(S_OK, BigDrivePerformanceCounters::GetMappingName(::GetCurrentProcessId(), szName, ARRAYSIZE(szName)));
+
+            hMapping = ::OpenFileMappingW(FILE_MAP_READ, FALSE, szName);
+            Assert::IsNotNull(hMapping);
+
+            pBlock = static_cast<const BigDriveCounterBlock*>(::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, sizeof(BigDriveCounterBlock)));
+            Assert::IsNotNull(pBlock);
+
+            before = pBlock->counters[BigDriveCounter_BytesStreamed];
+
+            // Act
+            BigDrivePerformanceCounters::Add(BigDriveCounter_BytesStreamed, 4096);
+
+            // Assert
+            Assert::AreEqual(BigDriveCounterBlock::Signature, pBlock->signature);
+            Assert::AreEqual(BigDriveCounterBlock::Version, pBlock->version);
+            Assert::AreEqual(static_cast<ULONG>(sizeof(BigDriveCounterBlock)), pBlock->cbSize);
+            Assert::AreEqual(static_cast<ULONG>(::GetCurrentProcessId()), pBlock->processId);
+            Assert::AreEqual(static_cast<ULONG>(BigDriveCounter_Count), pBlock->counterCount);
+            Assert::AreEqual(before + 4096, static_cast<LONGLONG>(pBlock->counters[BigDriveCounter_BytesStreamed]));
+
+            // Cleanup
+            BigDrivePerformanceCounters::Decrement(BigDriveCounter_LiveShellFolders);
+            ::UnmapViewOfFile(pBlock);
+            ::CloseHandle(hMapping);
+        }
+
+        /// <summary>
+        /// Tests that provider calls are counted in total, per name, in flight and by failure.
+        /// </summary>
+        TEST_METHOD(ProviderCall_CountedByNameAndInFlight)
+        {
+            // Arrange
+            volatile LONG slot = -1;
+            LONGLONG calls = BigDrivePerformanceCounters::GetValue(BigDriveCounter_ProviderCalls);
+            LONGLONG inFlight = BigDrivePerformanceCounters::GetValue(BigDriveCounter_ProviderCallsInFlight);
+            LONGLONG failures = BigDrivePerformanceCounters::GetValue(BigDriveCounter_ProviderCallFailures);
+
+            // Act and Assert
+            BigDrivePerformanceCounters::BeginProviderCall("ITest::CountedByName", slot);
+            Assert::IsTrue(slot >= 0);
+            Assert::AreEqual(inFlight + 1, BigDrivePerformanceCounters::GetValue(BigDriveCounter_ProviderCallsInFlight));
+            BigDrivePerformanceCounters::EndProviderCall(S_OK);
+
+            BigDrivePerformanceCounters::BeginProviderCall("ITest::CountedByName", slot);
+            BigDrivePerformanceCounters::EndProviderCall(E_FAIL);
+
+            Assert::AreEqual(calls + 2, BigDrivePerformanceCounters::GetValue(BigDriveCounter_ProviderCalls));
+            Assert::AreEqual(inFlight, BigDrivePerformanceCounters::GetValue(BigDriveCounter_ProviderCallsInFlight));
+            Assert::AreEqual(failures + 1, BigDrivePerformanceCounters::GetValue(BigDriveCounter_ProviderCallFailures));
+            Assert::AreEqual(2LL, BigDrivePerformanceCounters::GetProviderCallCount("ITest::CountedByName"));
+            Assert::AreEqual(0LL, BigDrivePerformanceCounters::GetProviderCallCount("ITest::NeverCalled"));
+        }
+
+        /// <summary>
+        /// Tests that call sites naming the same call share its slot.
+        /// </summary>
+        TEST_METHOD(ProviderCall_SameNameSharesSlot)
+        {
+            // Arrange
+            volatile LONG slot1 = -1;
+            volatile LONG slot2 = -1;
+
+            // Act
+            BigDrivePerformanceCounters::BeginProviderCall("ITest::SharedSlot", slot1);
+            BigDrivePerformanceCounters::EndProviderCall(S_OK);
+            BigDrivePerformanceCounters::BeginProviderCall("ITest::SharedSlot", slot2);
+            BigDrivePerformanceCounters::EndProviderCall(S_OK);
+
+            // Assert
+            Assert::AreEqual(static_cast<LONG>(slot1), static_cast<LONG>(slot2));
+            Assert::AreEqual(2LL, BigDrivePerformanceCounters::GetProviderCallCount("ITest::SharedSlot"));
+        }
+    };
+}
@@ -0,0 +1,393 @@
+// <copyright file="BigDriveProducerConsumerQueueTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "BigDriveProducerConsumerQueue.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    static volatile LONG s_freedItems = 0;
+
+    /// <summary>
+    /// Free callback that counts the items it is given.
+    /// </summary>
+    static void CountingFree(void* pItem)
+    {
+        ::InterlockedIncrement(&s_freedItems);
+    }
+
+    /// <summary>
+    /// Converts an index into a queue item. Item zero would look like nullptr, so indexes start at one.
+    /// </summary>
+    static void* ToItem(ULONG_PTR index)
+    {
+        return reinterpret_cast<void*>(index + 1);
+    }
+
+    /// <summary>
+    /// Converts a queue item back into its index.
+    /// </summary>
+    static ULONG_PTR FromItem(void* pItem)
+    {
+        return reinterpret_cast<ULONG_PTR>(pItem) - 1;
+    }
+
+    struct QueueProducerContext
+    {
+        BigDriveProducerConsumerQueue* pQueue;
+        ULONG itemCount;
+        DWORD delayMs;
+        LONGLONG* pPushTimes;
+        volatile LONG pushed;
+        HRESULT hrLastPush;
+    };
+
+    /// <summary>
+    /// Producer thread: pushes itemCount items, stamping each with the time it was pushed, then completes the queue.
+    /// </summary>
+    static DWORD WINAPI QueueProducerThread(LPVOID pParameter)
+    {
+        QueueProducerContext* pContext = static_cast<QueueProducerContext*>(pParameter);
+        LARGE_INTEGER now;
+        HRESULT hr = S_OK;
+
+        for (ULONG i = 0; i < pContext->itemCount; i++)
+        {
+            if (pContext->delayMs > 0)
+            {
+                ::Sleep(pContext->delayMs);
+            }
+
+            if (pContext->pPushTimes)
+            {
+                ::QueryPerformanceCounter(&now);
+                pContext->pPushTimes[i] = now.QuadPart;
+            }
+
+            hr = pContext->pQueue->Push(ToItem(i), INFINITE);
+            if (FAILED(hr))
+            {
+                break;
+            }
+
+            ::InterlockedIncrement(&pContext->pushed);
+        }
+
+        pContext->hrLastPush = hr;
+        pContext->pQueue->Complete(hr == E_ABORT ? S_OK : hr);
+        return 0;
+    }
+
+    TEST_CLASS(BigDriveProducerConsumerQueueTests)
+    {
+    public:
+
+        TEST_METHOD_INITIALIZE(ResetFreeCount)
+        {
+            s_freedItems = 0;
+        }
+
+        /// <summary>
+        /// Tests that items come out in the order they went in, across the end of the ring buffer.
+        /// </summary>
+        TEST_METHOD(Pop_AfterPush_ReturnsItemsInOrder)
+        {
+            // Arrange
+            BigDriveProducerConsumerQueue queue(nullptr);
+            void* apItems[3] = {};
+            ULONG popped = 0;
+            ULONG next = 0;
+
+            queue.Initialize(4);
+
+            // Act / Assert: wrap the ring buffer several times
+            for (ULONG round = 0; round < 5; round++)
+            {
+                for (ULONG i = 0; i < 3; i++)
+                {
+                    Assert::AreEqual(S_OK, queue.Push(ToItem(round * 3 + i), 0));
+                }
+
+                Assert::AreEqual(S_OK, queue.Pop(apItems, 3, popped, 0));
+                Assert::AreEqual(3UL, popped);
+
+                for (ULONG i = 0; i < popped; i++)
+                {
+                    Assert::AreEqual(static_cast<ULONG_PTR>(next++), FromItem(apItems[i]));
+                }
+            }
+        }
+
+        /// <summary>
+        /// Tests that polling an empty queue whose producer is running returns E_PENDING.
+        /// </summary>
+        TEST_METHOD(Pop_EmptyAndRunning_ReturnsPending)
+        {
+            // Arrange
+            BigDriveProducerConsumerQueue queue(nullptr);
+            void* pItem = nullptr;
+            ULONG popped = 0;
+
+            queue.Initialize(4);
+
+            // Act
+            HRESULT hrPoll = queue.Pop(&pItem, 1, popped, 0);
+            HRESULT hrWait = queue.Pop(&pItem, 1, popped, 10);
+
+            // Assert
+            Assert::AreEqual(E_PENDING, hrPoll);
+            Assert::AreEqual(E_PENDING, hrWait);
+            Assert::AreEqual(0UL, popped);
+        }
+
+        /// <summary>
+        /// Tests that a partial batch is returned as S_OK and the end is reported only once the queue is drained.
+        /// </summary>
+        TEST_METHOD(Pop_AfterComplete_DrainsThenReturnsFalse)
+        {
+            // Arrange
+            BigDriveProducerConsumerQueue queue(nullptr);
+            void* apItems[8] = {};
+            ULONG popped = 0;
+
+            queue.Initialize(8);
+            queue.Push(ToItem(0), 0);
+            queue.Push(ToItem(1), 0);
+            queue.Complete(S_OK);
+
+            // Act
+            HRESULT hrFirst = queue.Pop(apItems, 8, popped, 0);
+            ULONG firstPopped = popped;
+            HRESULT hrSecond = queue.Pop(apItems, 8, popped, INFINITE);
+
+            // Assert
+            Assert::AreEqual(S_OK, hrFirst);
+            Assert::AreEqual(2UL, firstPopped);
+            Assert::AreEqual(S_FALSE, hrSecond);
+            Assert::AreEqual(0UL, popped);
+            Assert::AreEqual(E_UNEXPECTED, queue.Push(ToItem(2), 0), L"Pushing after Complete should fail.");
+        }
+
+        /// <summary>
+        /// Tests that a producer failure is reported to the consumer after the queued items.
+        /// </summary>
+        TEST_METHOD(Pop_ProducerFailed_ReturnsFailureAfterItems)
+        {
+            // Arrange
+            BigDriveProducerConsumerQueue queue(nullptr);
+            void* pItem = nullptr;
+            ULONG popped = 0;
+
+            queue.Initialize(4);
+            queue.Push(ToItem(0), 0);
+            queue.Complete(E_ACCESSDENIED);
+
+            // Act
+            HRESULT hrFirst = queue.Pop(&pItem, 1, popped, 0);
+            HRESULT hrSecond = queue.Pop(&pItem, 1, popped, 0);
+
+            // Assert
+            Assert::AreEqual(S_OK, hrFirst);
+            Assert::AreEqual(E_ACCESSDENIED, hrSecond);
+        }
+
+        /// <summary>
+        /// Tests that a full queue makes the producer wait, and times the push out if nothing is popped.
+        /// </summary>
+        TEST_METHOD(Push_Full_WaitsAndTimesOut)
+        {
+            // Arrange
+            BigDriveProducerConsumerQueue queue(nullptr);
+
+            queue.Initialize(2);
+            queue.Push(ToItem(0), 0);
+            queue.Push(ToItem(1), 0);
+
+            // Act
+            HRESULT hrPoll = queue.Push(ToItem(2), 0);
+            HRESULT hrWait = queue.Push(ToItem(2), 20);
+
+            // Assert
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_TIMEOUT), hrPoll);
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_TIMEOUT), hrWait);
+            Assert::AreEqual(2UL, queue.GetCount());
+        }
+
+        /// <summary>
+        /// Tests that a consumer keeps a producer with a small queue moving, and every item arrives.
+        /// </summary>
+        TEST_METHOD(Push_SmallQueue_ProducerWaitsForConsumer)
+        {
+            // Arrange
+            const ULONG itemCount = 1000;
+            BigDriveProducerConsumerQueue queue(nullptr);
+            QueueProducerContext context = { &queue, itemCount, 0, nullptr, 0, S_OK };
+            void* apItems[16] = {};
+            ULONG popped = 0;
+            ULONG received = 0;
+            HRESULT hr = S_OK;
+
+            queue.Initialize(4);
+            HANDLE hThread = ::CreateThread(nullptr, 0, QueueProducerThread, &context, 0, nullptr);
+
+            // Act
+            while ((hr = queue.Pop(apItems, 16, popped, INFINITE)) == S_OK)
+            {
+                for (ULONG i = 0; i < popped; i++)
+                {
+                    Assert::AreEqual(static_cast<ULONG_PTR>(received++), FromItem(apItems[i]));
+                }
+            }
+
+            ::WaitForSingleObject(hThread, INFINITE);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr);
+            Assert::AreEqual(itemCount, received);
+            Assert::IsTrue(queue.GetProducerWaits() > 0, L"A four item queue should have made the producer wait.");
+
+            // Cleanup
+            ::CloseHandle(hThread);
+        }
+
+        /// <summary>
+        /// Tests that Cancel releases a producer blocked on a full queue, and queued items can still be popped.
+        /// </summary>
+        TEST_METHOD(Cancel_BlockedProducer_ReturnsAbort)
+        {
+            // Arrange
+            BigDriveProducerConsumerQueue queue(nullptr);
+            QueueProducerContext context = { &queue, 100, 0, nullptr, 0, S_OK };
+            void* apItems[4] = {};
+            ULONG popped = 0;
+
+            queue.Initialize(2);
+            HANDLE hThread = ::CreateThread(nullptr, 0, QueueProducerThread, &context, 0, nullptr);
+
+            while (queue.GetCount() < 2)
+            {
+                ::Sleep(1);
+            }
+
+            // Act
+            queue.Cancel();
+            DWORD dwWait = ::WaitForSingleObject(hThread, 5000);
+
+            // Assert
+            Assert::AreEqual(static_cast<DWORD>(WAIT_OBJECT_0), dwWait, L"The producer should be released by Cancel.");
+            Assert::AreEqual(E_ABORT, context.hrLastPush);
+            Assert::IsTrue(queue.IsCancelled() == TRUE);
+            Assert::AreEqual(S_OK, queue.Pop(apItems, 4, popped, 0));
+            Assert::AreEqual(2UL, popped);
+            Assert::AreEqual(S_FALSE, queue.Pop(apItems, 4, popped, 0));
+
+            // Cleanup
+            ::CloseHandle(hThread);
+        }
+
+        /// <summary>
+        /// Tests that items left in the queue are freed when it is destroyed.
+        /// </summary>
+        TEST_METHOD(Destructor_ItemsLeft_FreesThem)
+        {
+            // Arrange
+            void* pItem = nullptr;
+            ULONG popped = 0;
+
+            {
+                BigDriveProducerConsumerQueue queue(CountingFree);
+                queue.Initialize(4);
+                queue.Push(ToItem(0), 0);
+                queue.Push(ToItem(1), 0);
+                queue.Push(ToItem(2), 0);
+                queue.Pop(&pItem, 1, popped, 0);
+
+                // Act: leave scope
+            }
+
+            // Assert
+            Assert::AreEqual(2L, static_cast<long>(s_freedItems));
+        }
+
+        /// <summary>
+        /// Benchmark: latency from Push to Pop for a producer that trickles items out, and throughput for one that doesn't.
+        /// </summary>
+        TEST_METHOD(Benchmark_PushToPopLatency)
+        {
+            // Arrange
+            const ULONG trickleCount = 200;
+            const ULONG floodCount = 1000000;
+            LONGLONG* pPushTimes = new LONGLONG[trickleCount];
+            BigDriveProducerConsumerQueue trickle(nullptr);
+            BigDriveProducerConsumerQueue flood(nullptr);
+            QueueProducerContext trickleContext = { &trickle, trickleCount, 1, pPushTimes, 0, S_OK };
+            QueueProducerContext floodContext = { &flood, floodCount, 0, nullptr, 0, S_OK };
+            LARGE_INTEGER frequency, now, start, end;
+            void* apItems[64] = {};
+            ULONG popped = 0;
+            ULONG received = 0;
+            double totalUs = 0;
+            double maxUs = 0;
+            wchar_t message[256];
+
+            ::QueryPerformanceFrequency(&frequency);
+            trickle.Initialize(64);
+            flood.Initialize(1024);
+
+            // Act: latency, one item per millisecond
+            HANDLE hThread = ::CreateThread(nullptr, 0, QueueProducerThread, &trickleContext, 0, nullptr);
+
+            while (trickle.Pop(apItems, 64, popped, INFINITE) == S_OK)
+            {
+                ::QueryPerformanceCounter(&now);
+
+                for (ULONG i = 0; i < popped; i++)
+                {
+                    double us = (now.QuadPart - pPushTimes[FromItem(apItems[i])]) * 1000000.0 / frequency.QuadPart;
+                    totalUs += us;
+                    maxUs = (us > maxUs) ? us : maxUs;
+                    received++;
+                }
+            }
+
+            ::WaitForSingleObject(hThread, INFINITE);
+            ::CloseHandle(hThread);
+
+            ::swprintf_s(message, L"Push to Pop latency over %lu items: %.1f us average, %.1f us max\n",
+                received, totalUs / received, maxUs);
+            Logger::WriteMessage(message);
+
+            Assert::AreEqual(trickleCount, received);
+
+            // Act: throughput
+            received = 0;
+            ::QueryPerformanceCounter(&start);
+            hThread = ::CreateThread(nullptr, 0, QueueProducerThread, &floodContext, 0, nullptr);
+
+            while (flood.Pop(apItems, 64, popped, INFINITE) == S_OK)
+            {
+                received += popped;
+            }
+
+            ::QueryPerformanceCounter(&end);
+            ::WaitForSingleObject(hThread, INFINITE);
+            ::CloseHandle(hThread);
+
+            double elapsedMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%lu items through a 1024 slot queue: %.2f ms (%.0f items/ms), producer waits: %ld\n",
+                received, elapsedMs, received / elapsedMs, flood.GetProducerWaits());
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(floodCount, received);
+
+            // Cleanup
+            delete[] pPushTimes;
+        }
+    };
+}
@@ -0,0 +1,349 @@
+// <copyright file="BigDriveReadAheadStreamTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <psapi.h>
+
+#include "BigDriveReadAheadStream.h"
+#include "MockStream.h"
+
+#pragma comment(lib, "psapi.lib")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    /// <summary>
+    /// Spins for the given number of microseconds per megabyte of cb, simulating a consumer
+    /// such as the copy engine writing what it read to disk.
+    /// </summary>
+    static void SpinConsumer(ULONG cb, ULONG microsecondsPerMegabyte)
+    {
+        LARGE_INTEGER frequency, start, now;
+        LONGLONG ticks = 0;
+
+        ::QueryPerformanceFrequency(&frequency);
+        ::QueryPerformanceCounter(&start);
+
+        ticks = static_cast<LONGLONG>(cb) * microsecondsPerMegabyte * frequency.QuadPart / (1000000LL * 1024 * 1024);
+
+        do
+        {
+            ::QueryPerformanceCounter(&now);
+        } while (now.QuadPart - start.QuadPart < ticks);
+    }
+
+    /// <summary>
+    /// Retrieves the working set of the process.
+    /// </summary>
+    static SIZE_T GetWorkingSet()
+    {
+        PROCESS_MEMORY_COUNTERS counters = { sizeof(PROCESS_MEMORY_COUNTERS) };
+
+        ::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters));
+
+        return counters.WorkingSetSize;
+    }
+
+    TEST_CLASS(BigDriveReadAheadStreamTests)
+    {
+    public:
+
+        TEST_METHOD_INITIALIZE(Initialize)
+        {
+            m_hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            if (SUCCEEDED(m_hrCoInit))
+            {
+                ::CoUninitialize();
+            }
+        }
+
+        /// <summary>
+        /// Reads a file that is not a whole number of chunks with an odd request size and checks
+        /// every byte arrives in order, followed by a zero byte read at the end.
+        /// </summary>
+        TEST_METHOD(Read_ReturnsSourceBytesInOrder)
+        {
+            // Arrange
+            const ULONGLONG size = 1000003;
+            MockStream* pSource = new MockStream(size);
+            IStream* pStream = nullptr;
+            BYTE buffer[7919];
+            ULONGLONG offset = 0;
+            ULONG cbRead = 0;
+            BOOL fMatches = TRUE;
+
+            Assert::AreEqual(S_OK, BigDriveReadAheadStream::Create(pSource, BigDriveReadAheadStream::MinimumWindowSize, &pStream));
+
+            // Act
+            do
+            {
+                Assert::AreEqual(S_OK, pStream->Read(buffer, sizeof(buffer), &cbRead));
+
+                for (ULONG i = 0; i < cbRead; i++)
+                {
+                    fMatches = fMatches && (buffer[i] == MockStream::ExpectedByte(offset + i));
+                }
+
+                offset += cbRead;
+            } while (cbRead > 0);
+
+            // Assert
+            Assert::AreEqual(size, offset);
+            Assert::IsTrue(fMatches == TRUE, L"Bytes arrived out of order.");
+            Assert::IsTrue(pSource->largestRead <= BigDriveReadAheadStream::MinimumWindowSize / 2, L"Source was asked for more than a chunk.");
+
+            // Cleanup
+            pStream->Release();
+            pSource->Release();
+        }
+
+        /// <summary>
+        /// Tests that the worker never runs more than the window ahead of the reader.
+        /// </summary>
+        TEST_METHOD(Read_StaysWithinWindow)
+        {
+            // Arrange
+            const ULONG window = 256 * 1024;
+            MockStream* pSource = new MockStream(16 * 1024 * 1024);
+            IStream* pStream = nullptr;
+            BYTE buffer[4096];
+            ULONGLONG offset = 0;
+            LONGLONG ahead = 0;
+            LONGLONG largestAhead = 0;
+            ULONG cbRead = 0;
+
+            Assert::AreEqual(S_OK, BigDriveReadAheadStream::Create(pSource, window, &pStream));
+
+            // Act: read slowly so the worker has every chance to run ahead
+            do
+            {
+                Assert::AreEqual(S_OK, pStream->Read(buffer, sizeof(buffer), &cbRead));
+                offset += cbRead;
+
+                SpinConsumer(cbRead, 2000);
+
+                ahead = pSource->position - static_cast<LONGLONG>(offset);
+                if (ahead > largestAhead)
+                {
+                    largestAhead = ahead;
+                }
+            } while (cbRead > 0);
+
+            // Assert
+            Assert::IsTrue(largestAhead <= window, L"Worker read further ahead than the window.");
+            Assert::IsTrue(largestAhead > 0, L"Worker never read ahead.");
+
+            // Cleanup
+            pStream->Release();
+            pSource->Release();
+        }
+
+        /// <summary>
+        /// Tests that Seek to the current position is free and any other seek reads from the new position.
+        /// </summary>
+        TEST_METHOD(Seek_ReadsFromNewPosition)
+        {
+            // Arrange
+            MockStream* pSource = new MockStream(1024 * 1024);
+            IStream* pStream = nullptr;
+            BYTE buffer[1000];
+            LARGE_INTEGER liMove = { 0 };
+            ULARGE_INTEGER uliPosition = { 0 };
+            ULONG cbRead = 0;
+            LONG seekCount = 0;
+
+            Assert::AreEqual(S_OK, BigDriveReadAheadStream::Create(pSource, BigDriveReadAheadStream::MinimumWindowSize, &pStream));
+            Assert::AreEqual(S_OK, pStream->Read(buffer, sizeof(buffer), &cbRead));
+            seekCount = pSource->seekCount;
+
+            // Act: ask for the position
+            Assert::AreEqual(S_OK, pStream->Seek(liMove, STREAM_SEEK_CUR, &uliPosition));
+
+            // Assert
+            Assert::AreEqual(1000ULL, uliPosition.QuadPart);
+            Assert::AreEqual(seekCount, static_cast<LONG>(pSource->seekCount));
+
+            // Act: move back into the middle
+            liMove.QuadPart = 500000;
+            Assert::AreEqual(S_OK, pStream->Seek(liMove, STREAM_SEEK_SET, &uliPosition));
+            Assert::AreEqual(S_OK, pStream->Read(buffer, sizeof(buffer), &cbRead));
+
+            // Assert
+            Assert::AreEqual(500000ULL, uliPosition.QuadPart);
+            Assert::AreEqual(1000UL, cbRead);
+            Assert::AreEqual(MockStream::ExpectedByte(500000), buffer[0]);
+            Assert::AreEqual(MockStream::ExpectedByte(500999), buffer[999]);
+
+            // Act: move relative to the end
+            liMove.QuadPart = -10;
+            Assert::AreEqual(S_OK, pStream->Seek(liMove, STREAM_SEEK_END, &uliPosition));
+            Assert::AreEqual(S_OK, pStream->Read(buffer, sizeof(buffer), &cbRead));
+
+            // Assert
+            Assert::AreEqual(10UL, cbRead);
+            Assert::AreEqual(MockStream::ExpectedByte(1024 * 1024 - 10), buffer[0]);
+
+            // Cleanup
+            pStream->Release();
+            pSource->Release();
+        }
+
+        /// <summary>
+        /// Tests that a source error is returned once the bytes read before it have been delivered.
+        /// </summary>
+        TEST_METHOD(Read_SourceErrorAfterBufferedBytes)
+        {
+            // Arrange
+            MockStream* pSource = new MockStream(1024 * 1024);
+            IStream* pStream = nullptr;
+            BYTE buffer[4096];
+            ULONGLONG offset = 0;
+            ULONG cbRead = 0;
+            HRESULT hr = S_OK;
+
+            pSource->failAt = 200000;
+            pSource->failWith = RPC_E_DISCONNECTED;
+
+            Assert::AreEqual(S_OK, BigDriveReadAheadStream::Create(pSource, BigDriveReadAheadStream::MinimumWindowSize, &pStream));
+
+            // Act
+            while ((hr = pStream->Read(buffer, sizeof(buffer), &cbRead)) == S_OK && (cbRead > 0))
+            {
+                offset += cbRead;
+            }
+
+            // Assert
+            Assert::AreEqual(RPC_E_DISCONNECTED, hr);
+            Assert::AreEqual(200000ULL, offset);
+
+            // Cleanup
+            pStream->Release();
+            pSource->Release();
+        }
+
+        /// <summary>
+        /// Tests that releasing the stream part way through lets the worker finish and frees it.
+        /// </summary>
+        TEST_METHOD(Release_WhileReadingAhead)
+        {
+            // Arrange
+            MockStream* pSource = new MockStream(64 * 1024 * 1024);
+            IStream* pStream = nullptr;
+            BYTE buffer[4096];
+            ULONG cbRead = 0;
+
+            pSource->microsecondsPerMegabyte = 2000;
+
+            Assert::AreEqual(S_OK, BigDriveReadAheadStream::Create(pSource, BigDriveReadAheadStream::DefaultWindowSize, &pStream));
+            Assert::AreEqual(S_OK, pStream->Read(buffer, sizeof(buffer), &cbRead));
+
+            // Act
+            pStream->Release();
+
+            // Assert: the worker drops its proxy once its chunk is read, leaving only ours
+            for (int i = 0; (i < 100) && (pSource->AddRef() > 2); i++)
+            {
+                pSource->Release();
+                ::Sleep(20);
+            }
+
+            Assert::AreEqual(1UL, pSource->Release());
+            Assert::IsTrue(pSource->position < 64 * 1024 * 1024, L"Worker kept reading after the stream was released.");
+
+            // Cleanup
+            pSource->Release();
+        }
+
+        /// <summary>
+        /// Benchmark: copies a 1 GB file from a provider that delivers 1 GB/s to a consumer that
+        /// writes 1 GB/s, reading the provider directly and through the read-ahead stream, and reports
+        /// the throughput and the peak working set growth. Buffering the file whole, as FileContents
+        /// did before, takes twice the file size: the read buffer and the HGLOBAL it is copied into.
+        /// </summary>
+        TEST_METHOD(Benchmark_OneGigabyteFile)
+        {
+            // Arrange
+            const ULONGLONG size = 1024ULL * 1024 * 1024;
+            const ULONG requestSize = 1024 * 1024;
+            const ULONG microsecondsPerMegabyte = 1000;
+            MockStream* pSource = new MockStream(size);
+            IStream* pStream = nullptr;
+            BYTE* pBuffer = new BYTE[requestSize];
+            LARGE_INTEGER frequency, start, middle, end;
+            SIZE_T workingSetBefore = 0, workingSet = 0, peakGrowth = 0;
+            ULONGLONG directBytes = 0, readAheadBytes = 0;
+            ULONG cbRead = 0;
+            LARGE_INTEGER liZero = { 0 };
+            wchar_t message[256];
+
+            pSource->fillPattern = FALSE;
+            pSource->microsecondsPerMegabyte = microsecondsPerMegabyte;
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: read the provider directly
+            ::QueryPerformanceCounter(&start);
+
+            do
+            {
+                pSource->Read(pBuffer, requestSize, &cbRead);
+                SpinConsumer(cbRead, microsecondsPerMegabyte);
+                directBytes += cbRead;
+            } while (cbRead > 0);
+
+            ::QueryPerformanceCounter(&middle);
+
+            // Act: read through the read-ahead stream
+            pSource->Seek(liZero, STREAM_SEEK_SET, nullptr);
+            workingSetBefore = GetWorkingSet();
+
+            Assert::AreEqual(S_OK, BigDriveReadAheadStream::Create(pSource, BigDriveReadAheadStream::DefaultWindowSize, &pStream));
+
+            do
+            {
+                pStream->Read(pBuffer, requestSize, &cbRead);
+                SpinConsumer(cbRead, microsecondsPerMegabyte);
+                readAheadBytes += cbRead;
+
+                workingSet = GetWorkingSet();
+                if ((workingSet > workingSetBefore) && (workingSet - workingSetBefore > peakGrowth))
+                {
+                    peakGrowth = workingSet - workingSetBefore;
+                }
+            } while (cbRead > 0);
+
+            ::QueryPerformanceCounter(&end);
+
+            double directMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double readAheadMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"1 GB, provider and consumer at 1 GB/s: direct %.0f MB/s, read-ahead %.0f MB/s\n",
+                1024.0 * 1000.0 / directMs, 1024.0 * 1000.0 / readAheadMs);
+            Logger::WriteMessage(message);
+            ::swprintf_s(message, L"Peak working set growth %.1f MB with a %u MB window; buffering the file whole needs %.0f MB\n",
+                peakGrowth / (1024.0 * 1024.0), BigDriveReadAheadStream::DefaultWindowSize / (1024 * 1024), 2.0 * size / (1024.0 * 1024.0));
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(size, directBytes);
+            Assert::AreEqual(size, readAheadBytes);
+            Assert::IsTrue(peakGrowth < 64 * 1024 * 1024, L"Working set grew well past the read-ahead window.");
+            Assert::IsTrue(readAheadMs < directMs, L"Read-ahead did not overlap the provider with the consumer.");
+
+            // Cleanup
+            pStream->Release();
+            pSource->Release();
+            delete[] pBuffer;
+        }
+
+    private:
+
+        HRESULT m_hrCoInit = S_OK;
+    };
+}
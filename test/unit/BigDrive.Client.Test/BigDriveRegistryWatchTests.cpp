@@ -0,0 +1,117 @@
+// <copyright file="BigDriveRegistryWatchTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "BigDriveRegistryWatch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    /// <summary>
+    /// Registry key the watch tests write under.
+    /// </summary>
+    static LPCWSTR RegistryWatchTestKey = L"Software\\BigDrive\\RegistryWatchTests";
+
+    TEST_CLASS(BigDriveRegistryWatchTests)
+    {
+    private:
+
+        /// <summary>
+        /// Watch callback that counts its calls in the LONG it is given.
+        /// </summary>
+        static void CountChange(PVOID pContext)
+        {
+            ::InterlockedIncrement(static_cast<volatile LONG*>(pContext));
+        }
+
+        /// <summary>
+        /// Writes a DWORD value under the test key.
+        /// </summary>
+        static void SetTestValue(HKEY hKey, DWORD value)
+        {
+            Assert::AreEqual(ERROR_SUCCESS, ::RegSetValueExW(hKey, L"Changed", 0, REG_DWORD, reinterpret_cast<const BYTE*>(&value), sizeof(value)));
+        }
+
+        /// <summary>
+        /// Waits up to two seconds for a counter to reach a value.
+        /// </summary>
+        static void WaitForCount(volatile LONG& count, LONG expected)
+        {
+            for (int i = 0; (i < 100) && (::InterlockedCompareExchange(&count, 0, 0) < expected); i++)
+            {
+                ::Sleep(20);
+            }
+        }
+
+    public:
+
+        /// <summary>
+        /// Tests that nothing is watched until the watch is armed, and that once armed every change
+        /// calls back, not only the first.
+        /// </summary>
+        TEST_METHOD(EnsureArmed_ValueChangedTwice_CallsBackTwice)
+        {
+            // Arrange
+            volatile LONG changes = 0;
+            HKEY hKey = nullptr;
+            BigDriveRegistryWatch* pWatch = nullptr;
+
+            Assert::AreEqual(ERROR_SUCCESS, ::RegCreateKeyExW(HKEY_CURRENT_USER, RegistryWatchTestKey, 0, nullptr, 0, KEY_ALL_ACCESS, nullptr, &hKey, nullptr));
+            pWatch = new BigDriveRegistryWatch(HKEY_CURRENT_USER, RegistryWatchTestKey, 0, REG_NOTIFY_CHANGE_LAST_SET, CountChange, const_cast<LONG*>(&changes));
+
+            SetTestValue(hKey, 1);
+            ::Sleep(100);
+            Assert::AreEqual(0L, static_cast<LONG>(changes));
+
+            // Act
+            Assert::AreEqual(S_OK, pWatch->EnsureArmed());
+            SetTestValue(hKey, 2);
+            WaitForCount(changes, 1);
+            SetTestValue(hKey, 3);
+            WaitForCount(changes, 2);
+
+            // Assert
+            Assert::AreEqual(2L, static_cast<LONG>(changes));
+            Assert::AreEqual(S_OK, pWatch->EnsureArmed());
+
+            // Cleanup
+            delete pWatch;
+            ::RegCloseKey(hKey);
+            ::RegDeleteKeyW(HKEY_CURRENT_USER, RegistryWatchTestKey);
+        }
+
+        /// <summary>
+        /// Tests that a key that doesn't exist leaves the watch unarmed with the error from opening it,
+        /// and that stopping an armed watch means later changes don't call back.
+        /// </summary>
+        TEST_METHOD(EnsureArmed_MissingKeyOrStopped_NotArmed)
+        {
+            // Arrange
+            volatile LONG changes = 0;
+            HKEY hKey = nullptr;
+            BigDriveRegistryWatch missing(HKEY_CURRENT_USER, L"Software\\BigDrive\\RegistryWatchTests\\Missing", 0, REG_NOTIFY_CHANGE_LAST_SET, CountChange, const_cast<LONG*>(&changes));
+            BigDriveRegistryWatch stopped(HKEY_CURRENT_USER, RegistryWatchTestKey, 0, REG_NOTIFY_CHANGE_LAST_SET, CountChange, const_cast<LONG*>(&changes));
+
+            Assert::AreEqual(ERROR_SUCCESS, ::RegCreateKeyExW(HKEY_CURRENT_USER, RegistryWatchTestKey, 0, nullptr, 0, KEY_ALL_ACCESS, nullptr, &hKey, nullptr));
+            Assert::AreEqual(S_OK, stopped.EnsureArmed());
+
+            // Act
+            stopped.Stop();
+            SetTestValue(hKey, 4);
+            ::Sleep(100);
+
+            // Assert
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), missing.EnsureArmed());
+            Assert::IsTrue(FAILED(stopped.EnsureArmed()));
+            Assert::AreEqual(0L, static_cast<LONG>(changes));
+
+            // Cleanup
+            ::RegCloseKey(hKey);
+            ::RegDeleteKeyW(HKEY_CURRENT_USER, RegistryWatchTestKey);
+        }
+    };
+}
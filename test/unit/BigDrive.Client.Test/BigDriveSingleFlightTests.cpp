@@ -0,0 +1,465 @@
+// <copyright file="BigDriveSingleFlightTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <oleauto.h>
+
+#include "BigDriveSingleFlight.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    const GUID SingleFlightTestDrive = { 0xE0E0E0E0, 0x000A, 0x4E00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A } };
+
+    struct SingleFlightCallContext
+    {
+        HANDLE hRelease;
+        volatile LONG started;
+        HRESULT hrReturn;
+        LPCWSTR szResult;
+    };
+
+    struct SingleFlightRequestContext
+    {
+        BigDriveSingleFlight* pSingleFlight;
+        SingleFlightCallContext* pCall;
+        BigDriveSingleFlightOperation operation;
+        LPCWSTR szPath;
+        HRESULT hr;
+        BOOL fRightAnswer;
+    };
+
+    /// <summary>
+    /// Stands in for a provider call: counts itself, blocks until released, then answers with szResult.
+    /// </summary>
+    static HRESULT GatedProviderCall(void* pContext, VARIANT* pResult)
+    {
+        SingleFlightCallContext* pCall = static_cast<SingleFlightCallContext*>(pContext);
+
+        ::InterlockedIncrement(&pCall->started);
+        ::WaitForSingleObject(pCall->hRelease, INFINITE);
+
+        if (FAILED(pCall->hrReturn))
+        {
+            return pCall->hrReturn;
+        }
+
+        pResult->vt = VT_BSTR;
+        pResult->bstrVal = ::SysAllocString(pCall->szResult);
+
+        return (pResult->bstrVal != nullptr) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    /// <summary>
+    /// Makes one request and checks it received its own copy of the answer.
+    /// </summary>
+    static DWORD WINAPI SingleFlightRequestThread(LPVOID pParameter)
+    {
+        SingleFlightRequestContext* pContext = static_cast<SingleFlightRequestContext*>(pParameter);
+        VARIANT result;
+
+        ::VariantInit(&result);
+
+        pContext->hr = pContext->pSingleFlight->Call(SingleFlightTestDrive, pContext->operation, pContext->szPath, GatedProviderCall, pContext->pCall, &result);
+        pContext->fRightAnswer = SUCCEEDED(pContext->hr) && (result.vt == VT_BSTR) && (::wcscmp(result.bstrVal, pContext->pCall->szResult) == 0);
+
+        ::VariantClear(&result);
+
+        return 0;
+    }
+
+    struct SingleFlightReentryContext
+    {
+        BigDriveSingleFlight* pSingleFlight;
+        volatile LONG depth;
+        HRESULT hrInner;
+    };
+
+    /// <summary>
+    /// Stands in for a provider call that pumps messages and is re-entered with the same request, once.
+    /// </summary>
+    static HRESULT ReentrantProviderCall(void* pContext, VARIANT* pResult)
+    {
+        SingleFlightReentryContext* pReentry = static_cast<SingleFlightReentryContext*>(pContext);
+        VARIANT inner;
+
+        if (::InterlockedIncrement(&pReentry->depth) == 1)
+        {
+            ::VariantInit(&inner);
+            pReentry->hrInner = pReentry->pSingleFlight->Call(SingleFlightTestDrive, BigDriveSingleFlightOperation_EnumerateFiles, L"\\Docs", ReentrantProviderCall, pContext, &inner);
+            ::VariantClear(&inner);
+        }
+
+        pResult->vt = VT_I4;
+        pResult->lVal = 42;
+
+        return S_OK;
+    }
+
+    /// <summary>
+    /// Makes one request from a single-threaded apartment of its own.
+    /// </summary>
+    static DWORD WINAPI SingleFlightStaRequestThread(LPVOID pParameter)
+    {
+        HRESULT hrCoInit = ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+        SingleFlightRequestThread(pParameter);
+
+        if (SUCCEEDED(hrCoInit))
+        {
+            ::CoUninitialize();
+        }
+
+        return 0;
+    }
+
+    TEST_CLASS(BigDriveSingleFlightTests)
+    {
+    private:
+
+        /// <summary>
+        /// Waits up to ten seconds for a counter to reach a value.
+        /// </summary>
+        static bool WaitForCount(volatile LONG* pValue, LONG expected)
+        {
+            for (int i = 0; i < 10000; i++)
+            {
+                if (::InterlockedCompareExchange(pValue, 0, 0) == expected)
+                {
+                    return true;
+                }
+
+                ::Sleep(1);
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Waits up to ten seconds for the number of requests waiting on a call in flight to reach a value.
+        /// </summary>
+        static bool WaitForShared(BigDriveSingleFlight& singleFlight, LONG expected)
+        {
+            LONG calls = 0, shared = 0;
+
+            for (int i = 0; i < 10000; i++)
+            {
+                singleFlight.GetStatistics(calls, shared);
+                if (shared == expected)
+                {
+                    return true;
+                }
+
+                ::Sleep(1);
+            }
+
+            return false;
+        }
+
+    public:
+
+        /// <summary>
+        /// Tests that identical requests made while a call is in flight wait for it and each receive a copy of its answer.
+        /// The call is held until every other request is waiting, so exactly one call is made.
+        /// </summary>
+        TEST_METHOD(Call_ConcurrentIdenticalRequests_OneCall)
+        {
+            // Arrange
+            const ULONG threadCount = 8;
+            BigDriveSingleFlight singleFlight;
+            SingleFlightCallContext call = { ::CreateEventW(nullptr, TRUE, FALSE, nullptr), 0, S_OK, L"Photos" };
+            SingleFlightRequestContext requests[threadCount];
+            HANDLE threads[threadCount] = {};
+            LONG calls = 0, shared = 0;
+
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                // Paths that differ only in case are the same path
+                requests[i] = { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFolders, (i % 2) ? L"\\Photos" : L"\\PHOTOS", E_FAIL, FALSE };
+            }
+
+            // Act
+            threads[0] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[0], 0, nullptr);
+            Assert::IsTrue(WaitForCount(&call.started, 1));
+
+            for (ULONG i = 1; i < threadCount; i++)
+            {
+                threads[i] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[i], 0, nullptr);
+            }
+
+            Assert::IsTrue(WaitForShared(singleFlight, threadCount - 1));
+
+            ::SetEvent(call.hRelease);
+            ::WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+
+            // Assert
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                Assert::AreEqual(S_OK, requests[i].hr);
+                Assert::IsTrue(requests[i].fRightAnswer == TRUE);
+            }
+
+            singleFlight.GetStatistics(calls, shared);
+            Assert::AreEqual(1L, calls);
+            Assert::AreEqual(static_cast<LONG>(threadCount - 1), shared);
+            Assert::AreEqual(1L, static_cast<LONG>(call.started));
+
+            // Cleanup
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+
+            ::CloseHandle(call.hRelease);
+        }
+
+        /// <summary>
+        /// Tests that requests for another path or another call don't wait on a call in flight.
+        /// Each call must start while the others are still held, which only happens if none waits.
+        /// </summary>
+        TEST_METHOD(Call_DifferentPathOrOperation_SeparateCalls)
+        {
+            // Arrange
+            BigDriveSingleFlight singleFlight;
+            SingleFlightCallContext call = { ::CreateEventW(nullptr, TRUE, FALSE, nullptr), 0, S_OK, L"Docs" };
+            SingleFlightRequestContext requests[3] =
+            {
+                { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFolders, L"\\Docs", E_FAIL, FALSE },
+                { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFolders, L"\\Music", E_FAIL, FALSE },
+                { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFiles, L"\\Docs", E_FAIL, FALSE },
+            };
+            HANDLE threads[3] = {};
+            LONG calls = 0, shared = 0;
+
+            // Act
+            for (ULONG i = 0; i < ARRAYSIZE(requests); i++)
+            {
+                threads[i] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[i], 0, nullptr);
+                Assert::IsTrue(WaitForCount(&call.started, static_cast<LONG>(i + 1)));
+            }
+
+            ::SetEvent(call.hRelease);
+            ::WaitForMultipleObjects(ARRAYSIZE(threads), threads, TRUE, INFINITE);
+
+            // Assert
+            for (ULONG i = 0; i < ARRAYSIZE(requests); i++)
+            {
+                Assert::AreEqual(S_OK, requests[i].hr);
+                Assert::IsTrue(requests[i].fRightAnswer == TRUE);
+            }
+
+            singleFlight.GetStatistics(calls, shared);
+            Assert::AreEqual(3L, calls);
+            Assert::AreEqual(0L, shared);
+
+            // Cleanup
+            for (ULONG i = 0; i < ARRAYSIZE(threads); i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+
+            ::CloseHandle(call.hRelease);
+        }
+
+        /// <summary>
+        /// Tests that nothing is kept once a call returns: the same request made afterwards calls again.
+        /// </summary>
+        TEST_METHOD(Call_AfterCallReturns_CallsAgain)
+        {
+            // Arrange
+            BigDriveSingleFlight singleFlight;
+            SingleFlightCallContext call = { ::CreateEventW(nullptr, TRUE, TRUE, nullptr), 0, S_OK, L"Docs" };
+            VARIANT result;
+            LONG calls = 0, shared = 0;
+            HRESULT hr = S_OK;
+
+            ::VariantInit(&result);
+
+            // Act
+            for (int i = 0; i < 2; i++)
+            {
+                hr = singleFlight.Call(SingleFlightTestDrive, BigDriveSingleFlightOperation_GetFileSize, L"\\Docs\\a.txt", GatedProviderCall, &call, &result);
+                Assert::AreEqual(S_OK, hr);
+                Assert::AreEqual(static_cast<VARTYPE>(VT_BSTR), result.vt);
+                ::VariantClear(&result);
+            }
+
+            // Assert
+            singleFlight.GetStatistics(calls, shared);
+            Assert::AreEqual(2L, calls);
+            Assert::AreEqual(0L, shared);
+            Assert::AreEqual(2L, static_cast<LONG>(call.started));
+
+            // Cleanup
+            ::CloseHandle(call.hRelease);
+        }
+
+        /// <summary>
+        /// Tests that a failed call fails every request that waited on it with the same HRESULT.
+        /// </summary>
+        TEST_METHOD(Call_CallFails_EveryRequestFails)
+        {
+            // Arrange
+            const ULONG threadCount = 4;
+            BigDriveSingleFlight singleFlight;
+            SingleFlightCallContext call = { ::CreateEventW(nullptr, TRUE, FALSE, nullptr), 0, RPC_E_DISCONNECTED, L"" };
+            SingleFlightRequestContext requests[threadCount];
+            HANDLE threads[threadCount] = {};
+            LONG calls = 0, shared = 0;
+
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                requests[i] = { &singleFlight, &call, BigDriveSingleFlightOperation_LastModifiedTime, L"\\Docs\\a.txt", S_OK, FALSE };
+            }
+
+            // Act
+            threads[0] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[0], 0, nullptr);
+            Assert::IsTrue(WaitForCount(&call.started, 1));
+
+            for (ULONG i = 1; i < threadCount; i++)
+            {
+                threads[i] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[i], 0, nullptr);
+            }
+
+            Assert::IsTrue(WaitForShared(singleFlight, threadCount - 1));
+
+            ::SetEvent(call.hRelease);
+            ::WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+
+            // Assert
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                Assert::AreEqual(RPC_E_DISCONNECTED, requests[i].hr);
+            }
+
+            singleFlight.GetStatistics(calls, shared);
+            Assert::AreEqual(1L, calls);
+
+            // Cleanup
+            for (ULONG i = 0; i < threadCount; i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+
+            ::CloseHandle(call.hRelease);
+        }
+
+        /// <summary>
+        /// Tests that a call re-entered on its own thread with the same request calls the provider instead of
+        /// waiting on itself.
+        /// </summary>
+        TEST_METHOD(Call_ReenteredOnLeaderThread_CallsDirectly)
+        {
+            // Arrange
+            BigDriveSingleFlight singleFlight;
+            SingleFlightReentryContext reentry = { &singleFlight, 0, E_FAIL };
+            VARIANT result;
+            LONG calls = 0, shared = 0;
+
+            ::VariantInit(&result);
+
+            // Act
+            HRESULT hr = singleFlight.Call(SingleFlightTestDrive, BigDriveSingleFlightOperation_EnumerateFiles, L"\\Docs", ReentrantProviderCall, &reentry, &result);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr);
+            Assert::AreEqual(S_OK, reentry.hrInner);
+            Assert::AreEqual(2L, static_cast<LONG>(reentry.depth));
+            Assert::AreEqual(static_cast<VARTYPE>(VT_I4), result.vt);
+
+            singleFlight.GetStatistics(calls, shared);
+            Assert::AreEqual(2L, calls);
+            Assert::AreEqual(0L, shared);
+
+            // Cleanup
+            ::VariantClear(&result);
+        }
+
+        /// <summary>
+        /// Tests that a request waiting from a single-threaded apartment receives the answer of the call in flight.
+        /// </summary>
+        TEST_METHOD(Call_WaiterInSingleThreadedApartment_SharesCall)
+        {
+            // Arrange
+            BigDriveSingleFlight singleFlight;
+            SingleFlightCallContext call = { ::CreateEventW(nullptr, TRUE, FALSE, nullptr), 0, S_OK, L"Docs" };
+            SingleFlightRequestContext requests[2] =
+            {
+                { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFolders, L"\\Docs", E_FAIL, FALSE },
+                { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFolders, L"\\Docs", E_FAIL, FALSE },
+            };
+            HANDLE threads[2] = {};
+            LONG calls = 0, shared = 0;
+
+            // Act
+            threads[0] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[0], 0, nullptr);
+            Assert::IsTrue(WaitForCount(&call.started, 1));
+
+            threads[1] = ::CreateThread(nullptr, 0, SingleFlightStaRequestThread, &requests[1], 0, nullptr);
+            Assert::IsTrue(WaitForShared(singleFlight, 1));
+
+            ::SetEvent(call.hRelease);
+            ::WaitForMultipleObjects(ARRAYSIZE(threads), threads, TRUE, INFINITE);
+
+            // Assert
+            Assert::AreEqual(S_OK, requests[1].hr);
+            Assert::IsTrue(requests[1].fRightAnswer == TRUE);
+
+            singleFlight.GetStatistics(calls, shared);
+            Assert::AreEqual(1L, calls);
+            Assert::AreEqual(1L, shared);
+
+            // Cleanup
+            for (ULONG i = 0; i < ARRAYSIZE(threads); i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+
+            ::CloseHandle(call.hRelease);
+        }
+
+        /// <summary>
+        /// Tests that paths differing only in the case of letters outside ASCII are the same request.
+        /// </summary>
+        TEST_METHOD(Call_NonAsciiCaseDifference_SharesCall)
+        {
+            // Arrange
+            BigDriveSingleFlight singleFlight;
+            SingleFlightCallContext call = { ::CreateEventW(nullptr, TRUE, FALSE, nullptr), 0, S_OK, L"Fotos" };
+            SingleFlightRequestContext requests[2] =
+            {
+                { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFolders, L"\\\u00C4rger", E_FAIL, FALSE },
+                { &singleFlight, &call, BigDriveSingleFlightOperation_EnumerateFolders, L"\\\u00E4rger", E_FAIL, FALSE },
+            };
+            HANDLE threads[2] = {};
+            LONG calls = 0, shared = 0;
+
+            // Act
+            threads[0] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[0], 0, nullptr);
+            Assert::IsTrue(WaitForCount(&call.started, 1));
+
+            threads[1] = ::CreateThread(nullptr, 0, SingleFlightRequestThread, &requests[1], 0, nullptr);
+            Assert::IsTrue(WaitForShared(singleFlight, 1));
+
+            ::SetEvent(call.hRelease);
+            ::WaitForMultipleObjects(ARRAYSIZE(threads), threads, TRUE, INFINITE);
+
+            // Assert
+            singleFlight.GetStatistics(calls, shared);
+            Assert::AreEqual(1L, calls);
+            Assert::IsTrue(requests[1].fRightAnswer == TRUE);
+
+            // Cleanup
+            for (ULONG i = 0; i < ARRAYSIZE(threads); i++)
+            {
+                ::CloseHandle(threads[i]);
+            }
+
+            ::CloseHandle(call.hRelease);
+        }
+    };
+}
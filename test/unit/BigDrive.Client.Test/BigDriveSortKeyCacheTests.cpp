@@ -0,0 +1,326 @@
+// <copyright file="BigDriveSortKeyCacheTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <stdlib.h>
+
+#include "BigDriveSortKeyCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    /// <summary>
+    /// Cache used by the qsort comparator of the benchmark.
+    /// </summary>
+    static BigDriveSortKeyCache* s_pSortCache = nullptr;
+
+    /// <summary>
+    /// Number of comparisons made by the benchmark comparators.
+    /// </summary>
+    static ULONG s_sortCompareCount = 0;
+
+    /// <summary>
+    /// qsort comparator that compares names with CompareStringEx, as a sort without keys does.
+    /// </summary>
+    static int __cdecl CompareNamesUncached(const void* p1, const void* p2)
+    {
+        LPCWSTR szName1 = *static_cast<const LPCWSTR*>(p1);
+        LPCWSTR szName2 = *static_cast<const LPCWSTR*>(p2);
+
+        s_sortCompareCount++;
+
+        return ::CompareStringEx(LOCALE_NAME_USER_DEFAULT, NORM_IGNORECASE | SORT_DIGITSASNUMBERS, szName1, -1, szName2, -1, nullptr, nullptr, 0) - CSTR_EQUAL;
+    }
+
+    /// <summary>
+    /// qsort comparator that compares names through the sort key cache.
+    /// </summary>
+    static int __cdecl CompareNamesCached(const void* p1, const void* p2)
+    {
+        int result = 0;
+
+        s_sortCompareCount++;
+
+        s_pSortCache->Compare(*static_cast<const LPCWSTR*>(p1), *static_cast<const LPCWSTR*>(p2), result);
+        return result;
+    }
+
+    TEST_CLASS(BigDriveSortKeyCacheTests)
+    {
+    public:
+
+        /// <summary>
+        /// Tests that logical ordering compares runs of digits by value.
+        /// </summary>
+        TEST_METHOD(Compare_Logical_NumbersByValue)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(TRUE);
+            int result = 0;
+
+            // Act and Assert
+            Assert::AreEqual(S_OK, pCache->Compare(L"File2.txt", L"File10.txt", result));
+            Assert::IsTrue(result < 0);
+
+            Assert::AreEqual(S_OK, pCache->Compare(L"File10.txt", L"File2.txt", result));
+            Assert::IsTrue(result > 0);
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Tests that without logical ordering digits compare as characters.
+        /// </summary>
+        TEST_METHOD(Compare_NotLogical_NumbersAsText)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(FALSE);
+            int result = 0;
+
+            // Act
+            Assert::AreEqual(S_OK, pCache->Compare(L"File2.txt", L"File10.txt", result));
+
+            // Assert
+            Assert::IsTrue(result > 0);
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Tests that case is ignored, and that names differing in case are held as separate names.
+        /// </summary>
+        TEST_METHOD(Compare_IgnoresCase)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(TRUE);
+            int result = 1;
+            LONG hits = 0, misses = 0, keysBuilt = 0;
+            ULONG count = 0;
+
+            // Act
+            Assert::AreEqual(S_OK, pCache->Compare(L"report", L"REPORT", result));
+            pCache->GetStatistics(hits, misses, keysBuilt, count);
+
+            // Assert
+            Assert::AreEqual(0, result);
+            Assert::AreEqual(2UL, count);
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Tests that keys are built once per name and then compared from the cache.
+        /// </summary>
+        TEST_METHOD(Compare_Repeated_ServedFromKeys)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(TRUE);
+            int result = 0;
+            LONG hits = 0, misses = 0, keysBuilt = 0;
+            ULONG count = 0;
+
+            // Act
+            for (int i = 0; i < 10; i++)
+            {
+                Assert::AreEqual(S_OK, pCache->Compare(L"alpha", L"beta", result));
+                Assert::IsTrue(result < 0);
+            }
+
+            pCache->Clear();
+            Assert::AreEqual(S_OK, pCache->Compare(L"beta", L"alpha", result));
+            pCache->GetStatistics(hits, misses, keysBuilt, count);
+
+            // Assert
+            Assert::IsTrue(result > 0);
+            Assert::AreEqual(9L, hits);
+            Assert::AreEqual(2L, misses);
+            Assert::AreEqual(4L, keysBuilt, L"Clear should drop the keys, so both are built again.");
+            Assert::AreEqual(2UL, count);
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Tests that a miss builds only the key of the name not held.
+        /// </summary>
+        TEST_METHOD(Compare_OneNameHeld_BuildsOnlyOther)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(TRUE);
+            int result = 0;
+            LONG hits = 0, misses = 0, keysBuilt = 0;
+            ULONG count = 0;
+
+            Assert::AreEqual(S_OK, pCache->Compare(L"alpha", L"beta", result));
+
+            // Act
+            Assert::AreEqual(S_OK, pCache->Compare(L"alpha", L"gamma", result));
+            pCache->GetStatistics(hits, misses, keysBuilt, count);
+
+            // Assert
+            Assert::IsTrue(result < 0);
+            Assert::AreEqual(0L, hits);
+            Assert::AreEqual(2L, misses);
+            Assert::AreEqual(3L, keysBuilt, L"The key of alpha should not be built again.");
+            Assert::AreEqual(3UL, count);
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Tests that a full cache replaces names instead of refusing new ones.
+        /// </summary>
+        TEST_METHOD(Compare_PastMaxEntries_KeepsCaching)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(TRUE, 4);
+            int result = 0;
+            LONG hits = 0, misses = 0, keysBuilt = 0;
+            ULONG count = 0;
+
+            Assert::AreEqual(S_OK, pCache->Compare(L"a", L"b", result));
+            Assert::AreEqual(S_OK, pCache->Compare(L"c", L"d", result));
+
+            // Act
+            Assert::AreEqual(S_OK, pCache->Compare(L"e", L"f", result));
+            Assert::AreEqual(S_OK, pCache->Compare(L"e", L"f", result));
+            pCache->GetStatistics(hits, misses, keysBuilt, count);
+
+            // Assert
+            Assert::IsTrue(result < 0);
+            Assert::AreEqual(1L, hits, L"The names stored past the limit should be held.");
+            Assert::AreEqual(3L, misses);
+            Assert::AreEqual(6L, keysBuilt);
+            Assert::AreEqual(4UL, count);
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Tests that names compared since the clock hand last passed them are kept, and the others replaced.
+        /// </summary>
+        TEST_METHOD(Compare_ReferencedKeys_SurviveEviction)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(TRUE, 4);
+            int result = 0;
+            LONG hits = 0, misses = 0, keysBuilt = 0;
+            ULONG count = 0;
+
+            Assert::AreEqual(S_OK, pCache->Compare(L"a", L"b", result));
+            Assert::AreEqual(S_OK, pCache->Compare(L"c", L"d", result));
+            Assert::AreEqual(S_OK, pCache->Compare(L"a", L"b", result));
+
+            // Act
+            Assert::AreEqual(S_OK, pCache->Compare(L"e", L"f", result));
+            Assert::AreEqual(S_OK, pCache->Compare(L"a", L"b", result));
+            Assert::AreEqual(S_OK, pCache->Compare(L"c", L"d", result));
+            pCache->GetStatistics(hits, misses, keysBuilt, count);
+
+            // Assert
+            Assert::AreEqual(2L, hits, L"a and b were compared again and should have been kept.");
+            Assert::AreEqual(4L, misses, L"c and d were not compared again and should have been replaced.");
+            Assert::AreEqual(8L, keysBuilt);
+            Assert::AreEqual(4UL, count);
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Tests that null names are rejected.
+        /// </summary>
+        TEST_METHOD(Compare_NullName_InvalidArg)
+        {
+            // Arrange
+            BigDriveSortKeyCache* pCache = new BigDriveSortKeyCache(TRUE);
+            int result = 0;
+
+            // Act and Assert
+            Assert::AreEqual(E_INVALIDARG, pCache->Compare(nullptr, L"beta", result));
+
+            // Cleanup
+            delete pCache;
+        }
+
+        /// <summary>
+        /// Benchmark: sorting 100,000 names, comparing with CompareStringEx each time and through the sort keys.
+        /// </summary>
+        TEST_METHOD(Benchmark_Sort100kItems)
+        {
+            // Arrange
+            const ULONG items = 100000;
+            LPWSTR* pNames = new LPWSTR[items];
+            LPCWSTR* pUncached = new LPCWSTR[items];
+            LPCWSTR* pCached = new LPCWSTR[items];
+            LARGE_INTEGER frequency, start, middle, end;
+            ULONG uncachedCompares = 0;
+            ULONG cachedCompares = 0;
+            wchar_t message[256];
+
+            s_pSortCache = new BigDriveSortKeyCache(TRUE);
+
+            for (ULONG i = 0; i < items; i++)
+            {
+                // Scrambled order, with numbers that only sort right by value
+                pNames[i] = new WCHAR[40];
+                ::swprintf_s(pNames[i], 40, L"Photo %lu from Trip.jpg", (i * 7919) % items);
+                pUncached[i] = pNames[i];
+                pCached[i] = pNames[i];
+            }
+
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act: every comparison is linguistic
+            s_sortCompareCount = 0;
+            ::QueryPerformanceCounter(&start);
+            ::qsort(pUncached, items, sizeof(LPCWSTR), CompareNamesUncached);
+            ::QueryPerformanceCounter(&middle);
+            uncachedCompares = s_sortCompareCount;
+
+            // Act: every comparison is a memcmp of held keys
+            s_sortCompareCount = 0;
+            ::qsort(pCached, items, sizeof(LPCWSTR), CompareNamesCached);
+            ::QueryPerformanceCounter(&end);
+            cachedCompares = s_sortCompareCount;
+
+            double uncachedMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double cachedMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%lu items: CompareStringEx %.2f ms (%lu comparisons), sort keys %.2f ms (%lu comparisons)\n",
+                items, uncachedMs, uncachedCompares, cachedMs, cachedCompares);
+            Logger::WriteMessage(message);
+
+            // Assert
+            for (ULONG i = 0; i < items; i++)
+            {
+                Assert::AreEqual(pUncached[i], pCached[i]);
+            }
+
+            Assert::AreEqual(L"Photo 2 from Trip.jpg", pCached[2]);
+            Assert::AreEqual(L"Photo 10 from Trip.jpg", pCached[10]);
+            Assert::IsTrue(cachedMs < uncachedMs);
+
+            // Cleanup
+            for (ULONG i = 0; i < items; i++)
+            {
+                delete[] pNames[i];
+            }
+
+            delete[] pNames;
+            delete[] pUncached;
+            delete[] pCached;
+            delete s_pSortCache;
+            s_pSortCache = nullptr;
+        }
+    };
+}
@@ -0,0 +1,634 @@
+// <copyright file="BigDriveTransferEngineTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "BigDriveTransferEngine.h"
+#include "MockBigDriveFileOperations.h"
+#include "MockStream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    // {5D0A8A7E-3C0B-4F59-9A43-2B7E1C9D6F01}
+    static const CLSID CLSID_FirstProvider =
+        { 0x5d0a8a7e, 0x3c0b, 0x4f59, { 0x9a, 0x43, 0x2b, 0x7e, 0x1c, 0x9d, 0x6f, 0x01 } };
+
+    // {5D0A8A7E-3C0B-4F59-9A43-2B7E1C9D6F02}
+    static const CLSID CLSID_SecondProvider =
+        { 0x5d0a8a7e, 0x3c0b, 0x4f59, { 0x9a, 0x43, 0x2b, 0x7e, 0x1c, 0x9d, 0x6f, 0x02 } };
+
+    // {0E6C3B44-71D2-4C8E-8F15-6A9B2D4E7C10}
+    static const GUID DriveGuid =
+        { 0x0e6c3b44, 0x71d2, 0x4c8e, { 0x8f, 0x15, 0x6a, 0x9b, 0x2d, 0x4e, 0x7c, 0x10 } };
+
+    /// <summary>
+    /// Creates a batch of files named IMG_0000.jpg onwards, copied through the mock.
+    /// </summary>
+    static BigDriveTransferBatch* CreateBatch(REFCLSID providerClsid, MockBigDriveFileOperations* pMock, ULONG count)
+    {
+        BigDriveTransferBatch* pBatch = nullptr;
+        wchar_t path[MAX_PATH];
+
+        Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(DriveGuid, providerClsid, L"\\Photos", MockBigDriveFileOperations::Factory, pMock, &pBatch));
+
+        for (ULONG i = 0; i < count; i++)
+        {
+            ::swprintf_s(path, L"C:\\Upload\\IMG_%04u.jpg", i);
+            Assert::AreEqual(S_OK, pBatch->AddFile(path));
+        }
+
+        return pBatch;
+    }
+
+    /// <summary>
+    /// Sums the bytes the process has read and written through I/O calls.
+    /// </summary>
+    static ULONGLONG GetProcessIoBytes()
+    {
+        IO_COUNTERS counters = {};
+
+        ::GetProcessIoCounters(::GetCurrentProcess(), &counters);
+
+        return counters.ReadTransferCount + counters.WriteTransferCount;
+    }
+
+    TEST_CLASS(BigDriveTransferEngineTests)
+    {
+    public:
+
+        TEST_METHOD_INITIALIZE(Initialize)
+        {
+            m_hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            if (SUCCEEDED(m_hrCoInit))
+            {
+                ::CoUninitialize();
+            }
+        }
+
+        /// <summary>
+        /// Copies a batch and checks every file is copied once and counted as succeeded.
+        /// </summary>
+        TEST_METHOD(Submit_CopiesEveryFile)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 50);
+            BigDriveTransferItem item = {};
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(50UL, succeeded);
+            Assert::AreEqual(0UL, failed);
+            Assert::AreEqual(0UL, cancelled);
+            Assert::AreEqual(50L, static_cast<LONG>(pMock->copyCount));
+
+            Assert::AreEqual(S_OK, pBatch->GetItem(49, item));
+            Assert::AreEqual(S_OK, item.hr);
+            Assert::AreEqual(1UL, item.attempts);
+            Assert::AreEqual(E_UNEXPECTED, engine.Submit(pBatch));
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Copies slow files with plenty of workers and checks no more than the provider limit
+        /// run at once, and that the limit is reached.
+        /// </summary>
+        TEST_METHOD(Submit_HonorsProviderLimit)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(16, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 24);
+
+            pMock->sleepMs = 20;
+            Assert::AreEqual(S_OK, engine.SetProviderLimit(CLSID_FirstProvider, 3));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            Assert::AreEqual(3L, static_cast<LONG>(pMock->peakCount));
+            Assert::AreEqual(24L, static_cast<LONG>(pMock->copyCount));
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Copies slow files to two providers and checks the worker limit bounds the copies
+        /// across both, with the second provider getting the worker the first can't use.
+        /// </summary>
+        TEST_METHOD(Submit_HonorsWorkerLimitAcrossProviders)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(5, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pFirstBatch = CreateBatch(CLSID_FirstProvider, pMock, 20);
+            BigDriveTransferBatch* pSecondBatch = CreateBatch(CLSID_SecondProvider, pMock, 20);
+
+            pMock->sleepMs = 20;
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pFirstBatch));
+            Assert::AreEqual(S_OK, engine.Submit(pSecondBatch));
+            Assert::AreEqual(S_OK, pFirstBatch->Wait(10000));
+            Assert::AreEqual(S_OK, pSecondBatch->Wait(10000));
+
+            // Assert: four for the first provider and the one worker left for the second
+            Assert::AreEqual(5L, static_cast<LONG>(pMock->peakCount));
+            Assert::AreEqual(40L, static_cast<LONG>(pMock->copyCount));
+
+            // Cleanup
+            engine.WaitForIdle();
+            pFirstBatch->Release();
+            pSecondBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Fails one file twice and checks the third attempt copies it.
+        /// </summary>
+        TEST_METHOD(Submit_RetriesFailedFile)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 1);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 10);
+            BigDriveTransferItem item = {};
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            pMock->failPath = L"C:\\Upload\\IMG_0003.jpg";
+            pMock->failTimes = 2;
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(10UL, succeeded);
+            Assert::AreEqual(0UL, failed);
+
+            Assert::AreEqual(S_OK, pBatch->GetItem(3, item));
+            Assert::AreEqual(S_OK, item.hr);
+            Assert::AreEqual(3UL, item.attempts);
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Fails one file on every attempt and checks it alone fails, with its error, while the
+        /// rest are copied, and that the retry batch holds just that file.
+        /// </summary>
+        TEST_METHOD(Submit_FailsFileWithoutFailingBatch)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 2, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 10);
+            BigDriveTransferBatch* pRetry = nullptr;
+            BigDriveTransferItem item = {};
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            pMock->failPath = L"C:\\Upload\\IMG_0007.jpg";
+            pMock->failTimes = ULONG_MAX;
+            pMock->failWith = HRESULT_FROM_WIN32(ERROR_DISK_FULL);
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(9UL, succeeded);
+            Assert::AreEqual(1UL, failed);
+
+            Assert::AreEqual(S_OK, pBatch->GetItem(7, item));
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_DISK_FULL), item.hr);
+            Assert::AreEqual(2UL, item.attempts);
+
+            Assert::AreEqual(S_OK, pBatch->CreateRetryBatch(&pRetry));
+            Assert::AreEqual(1UL, pRetry->GetCount());
+            Assert::AreEqual(S_OK, pRetry->GetItem(0, item));
+            Assert::AreEqual(L"C:\\Upload\\IMG_0007.jpg", item.szLocalPath);
+            Assert::AreEqual(L"\\Photos", pRetry->GetTargetPath());
+
+            // Cleanup
+            engine.WaitForIdle();
+            pRetry->Release();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Cancels a batch while its first file is copying and checks the queued files are
+        /// cancelled without being copied.
+        /// </summary>
+        TEST_METHOD(Cancel_SkipsQueuedFiles)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(1, 1, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 20);
+            BigDriveTransferBatch* pRetry = nullptr;
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            pMock->sleepMs = 50;
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+
+            while (pMock->callCount == 0)
+            {
+                ::Sleep(1);
+            }
+
+            pBatch->Cancel();
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::IsTrue(pBatch->IsCancelled());
+            Assert::AreEqual(20UL, succeeded + cancelled);
+            Assert::IsTrue(cancelled >= 18);
+            Assert::AreEqual(0UL, failed);
+            Assert::AreEqual(S_FALSE, pBatch->CreateRetryBatch(&pRetry));
+            Assert::IsNull(pRetry);
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Checks an empty batch is done as soon as it is submitted.
+        /// </summary>
+        TEST_METHOD(Submit_EmptyBatchIsDone)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 0);
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+
+            // Assert
+            Assert::AreEqual(S_OK, pBatch->Wait(0));
+            Assert::AreEqual(E_UNEXPECTED, pBatch->AddFile(L"C:\\Upload\\late.jpg"));
+
+            // Cleanup
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Submits a batch open, adds files after it started, and checks it isn't done until it
+        /// is sealed and that the added files are copied to their own folder.
+        /// </summary>
+        TEST_METHOD(SubmitOpen_CopiesFilesAddedUntilSealed)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 2);
+            BigDriveTransferItem item = {};
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            // Act
+            Assert::AreEqual(S_OK, engine.SubmitOpen(pBatch));
+            Assert::AreEqual(S_OK, pBatch->AddFile(L"C:\\Upload\\More\\IMG_0100.jpg", L"\\Photos\\More"));
+            Assert::AreEqual(S_OK, pBatch->AddFile(L"C:\\Upload\\More\\IMG_0101.jpg", L"\\Photos\\More"));
+            engine.WaitForIdle();
+
+            // Assert: every file is copied, but the batch stays open
+            Assert::AreEqual(4L, static_cast<LONG>(pMock->copyCount));
+            Assert::AreEqual(S_FALSE, pBatch->Wait(0));
+
+            Assert::AreEqual(S_OK, pBatch->AddFile(L"C:\\Upload\\More\\IMG_0102.jpg", L"\\Photos\\More"));
+            Assert::AreEqual(S_OK, pBatch->Seal());
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+            Assert::AreEqual(S_FALSE, pBatch->Seal());
+            Assert::AreEqual(E_UNEXPECTED, pBatch->AddFile(L"C:\\Upload\\late.jpg"));
+
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(5UL, succeeded);
+            Assert::AreEqual(5UL, pBatch->GetCount());
+
+            Assert::AreEqual(S_OK, pBatch->GetItem(4, item));
+            Assert::AreEqual(L"\\Photos\\More", item.szTargetPath);
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Benchmark: uploads 500 files that take 20 ms each, one at a time as the drop target
+        /// used to, and through the engine with its default limits, and reports both times.
+        /// </summary>
+        TEST_METHOD(Benchmark_FiveHundredFiles)
+        {
+            // Arrange
+            const ULONG count = 500;
+            BigDriveTransferEngine sequential(1, 1, 1, 0);
+            BigDriveTransferEngine parallel(BigDriveTransferEngine::DefaultMaxWorkers, BigDriveTransferEngine::DefaultProviderLimit, 1, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pSequentialBatch = CreateBatch(CLSID_FirstProvider, pMock, count);
+            BigDriveTransferBatch* pParallelBatch = CreateBatch(CLSID_FirstProvider, pMock, count);
+            LARGE_INTEGER frequency, start, middle, end;
+            wchar_t message[256];
+
+            pMock->sleepMs = 20;
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act
+            ::QueryPerformanceCounter(&start);
+            Assert::AreEqual(S_OK, sequential.Submit(pSequentialBatch));
+            Assert::AreEqual(S_OK, pSequentialBatch->Wait(60000));
+            ::QueryPerformanceCounter(&middle);
+            Assert::AreEqual(S_OK, parallel.Submit(pParallelBatch));
+            Assert::AreEqual(S_OK, pParallelBatch->Wait(60000));
+            ::QueryPerformanceCounter(&end);
+
+            double sequentialMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double parallelMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"%u files at 20 ms each: one at a time %.0f ms, engine (%u per provider) %.0f ms\n",
+                count, sequentialMs, BigDriveTransferEngine::DefaultProviderLimit, parallelMs);
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(static_cast<LONG>(2 * count), static_cast<LONG>(pMock->copyCount));
+            Assert::IsTrue(parallelMs * 2 < sequentialMs, L"The engine did not copy files in parallel.");
+
+            // Cleanup
+            sequential.WaitForIdle();
+            parallel.WaitForIdle();
+            pSequentialBatch->Release();
+            pParallelBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Uploads a stream to a provider that takes streams and checks it is handed the stream,
+        /// with the file's full path, and reads all of it.
+        /// </summary>
+        TEST_METHOD(AddStream_UsesStreamOperations)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            MockStream* pStream = new MockStream(3 * 1024 * 1024 + 5);
+            BigDriveTransferBatch* pBatch = nullptr;
+            BigDriveTransferItem item = {};
+
+            pMock->supportStreams = TRUE;
+
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(DriveGuid, CLSID_FirstProvider, L"\\Photos", MockBigDriveFileOperations::Factory, pMock, &pBatch));
+            Assert::AreEqual(S_OK, pBatch->AddStream(pStream, L"clip.bin", nullptr, -1, 0));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            Assert::AreEqual(S_OK, pBatch->GetItem(0, item));
+            Assert::AreEqual(S_OK, item.hr);
+            Assert::AreEqual(1L, static_cast<LONG>(pMock->streamCount));
+            Assert::AreEqual(static_cast<LONGLONG>(pStream->size), static_cast<LONGLONG>(pMock->bytesStreamed));
+            Assert::AreEqual(std::wstring(L"\\Photos\\clip.bin"), pMock->lastStreamTarget);
+            Assert::AreEqual(pStream->size, pBatch->GetTotalSize());
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pStream->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Uploads two streams, one of which fails every attempt, and checks only the copied one
+        /// counts as done while the failed one counts as skipped.
+        /// </summary>
+        TEST_METHOD(GetProgress_CountsFailedBytesAsSkipped)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 2, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            MockStream* pCopied = new MockStream(1024 * 1024);
+            MockStream* pFailed = new MockStream(3 * 1024 * 1024);
+            BigDriveTransferBatch* pBatch = nullptr;
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            pMock->supportStreams = TRUE;
+            pFailed->failAt = 0;
+
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(DriveGuid, CLSID_FirstProvider, L"\\Photos", MockBigDriveFileOperations::Factory, pMock, &pBatch));
+            Assert::AreEqual(S_OK, pBatch->AddStream(pCopied, L"copied.bin", nullptr, static_cast<LONGLONG>(pCopied->size), 0));
+            Assert::AreEqual(S_OK, pBatch->AddStream(pFailed, L"failed.bin", nullptr, static_cast<LONGLONG>(pFailed->size), 0));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(1UL, succeeded);
+            Assert::AreEqual(1UL, failed);
+            Assert::AreEqual(pCopied->size, cbDone);
+            Assert::AreEqual(pFailed->size, pBatch->GetSkippedSize());
+            Assert::AreEqual(pCopied->size + pFailed->size, pBatch->GetTotalSize());
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pFailed->Release();
+            pCopied->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Uploads a stream to a provider that only takes files and checks it is copied from a
+        /// temp file with the file's name, which is gone afterwards.
+        /// </summary>
+        TEST_METHOD(AddStream_FallsBackToTempFile)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            MockStream* pStream = new MockStream(3 * 1024 * 1024 + 5);
+            BigDriveTransferBatch* pBatch = nullptr;
+            BigDriveTransferItem item = {};
+            size_t cchPath = 0;
+
+            pMock->readFiles = TRUE;
+
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(DriveGuid, CLSID_FirstProvider, L"\\Photos", MockBigDriveFileOperations::Factory, pMock, &pBatch));
+            Assert::AreEqual(S_OK, pBatch->AddStream(pStream, L"clip.bin", nullptr, -1, 0));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            Assert::AreEqual(S_OK, pBatch->GetItem(0, item));
+            Assert::AreEqual(S_OK, item.hr);
+            Assert::AreEqual(0L, static_cast<LONG>(pMock->streamCount));
+            Assert::AreEqual(static_cast<LONGLONG>(pStream->size), static_cast<LONGLONG>(pMock->bytesRead));
+
+            cchPath = pMock->lastLocalPath.length();
+            Assert::IsTrue((cchPath > 9) && (pMock->lastLocalPath.compare(cchPath - 9, 9, L"\\clip.bin") == 0), L"The temp file was not named after the file.");
+            Assert::AreEqual(INVALID_FILE_ATTRIBUTES, ::GetFileAttributesW(pMock->lastLocalPath.c_str()));
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pStream->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Adds a file that was rejected before it could be queued and checks it is failed with
+        /// its own error, without reaching the provider and without being retried.
+        /// </summary>
+        TEST_METHOD(AddRejected_FailsWithoutCopying)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = CreateBatch(CLSID_FirstProvider, pMock, 2);
+            BigDriveTransferBatch* pRetry = nullptr;
+            BigDriveTransferItem item = {};
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            Assert::AreEqual(E_INVALIDARG, pBatch->AddRejected(L"..\\evil.txt", S_OK));
+            Assert::AreEqual(S_OK, pBatch->AddRejected(L"..\\evil.txt", HRESULT_FROM_WIN32(ERROR_INVALID_NAME)));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.Submit(pBatch));
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(2UL, succeeded);
+            Assert::AreEqual(1UL, failed);
+            Assert::AreEqual(2L, static_cast<LONG>(pMock->callCount));
+
+            Assert::AreEqual(S_OK, pBatch->GetItem(2, item));
+            Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_INVALID_NAME), item.hr);
+            Assert::AreEqual(0UL, item.attempts);
+            Assert::AreEqual(L"..\\evil.txt", item.szName);
+
+            Assert::AreEqual(S_FALSE, pBatch->CreateRetryBatch(&pRetry));
+            Assert::IsNull(pRetry);
+
+            // Cleanup
+            engine.WaitForIdle();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Benchmark: copies a 2 GB file from one drive to another through a temp file, as
+        /// providers without IBigDriveStreamOperations need, and as a stream, and reports the
+        /// time and the bytes of disk I/O each takes.
+        /// </summary>
+        TEST_METHOD(Benchmark_TwoGigabyteCrossDriveCopy)
+        {
+            // Arrange
+            const ULONGLONG size = 2ULL * 1024 * 1024 * 1024;
+            BigDriveTransferEngine engine(1, 1, 1, 0);
+            MockBigDriveFileOperations* pFileMock = new MockBigDriveFileOperations();
+            MockBigDriveFileOperations* pStreamMock = new MockBigDriveFileOperations();
+            MockStream* pFileSource = new MockStream(size);
+            MockStream* pStreamSource = new MockStream(size);
+            BigDriveTransferBatch* pFileBatch = nullptr;
+            BigDriveTransferBatch* pStreamBatch = nullptr;
+            LARGE_INTEGER frequency, start, middle, end;
+            ULONGLONG ioStart = 0, ioMiddle = 0, ioEnd = 0;
+            wchar_t message[256];
+
+            pFileMock->readFiles = TRUE;
+            pStreamMock->supportStreams = TRUE;
+            pFileSource->fillPattern = FALSE;
+            pStreamSource->fillPattern = FALSE;
+
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(DriveGuid, CLSID_FirstProvider, L"\\", MockBigDriveFileOperations::Factory, pFileMock, &pFileBatch));
+            Assert::AreEqual(S_OK, pFileBatch->AddStream(pFileSource, L"movie.mp4", nullptr, static_cast<LONGLONG>(size), 0));
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(DriveGuid, CLSID_SecondProvider, L"\\", MockBigDriveFileOperations::Factory, pStreamMock, &pStreamBatch));
+            Assert::AreEqual(S_OK, pStreamBatch->AddStream(pStreamSource, L"movie.mp4", nullptr, static_cast<LONGLONG>(size), 0));
+
+            ::QueryPerformanceFrequency(&frequency);
+
+            // Act
+            ioStart = GetProcessIoBytes();
+            ::QueryPerformanceCounter(&start);
+            Assert::AreEqual(S_OK, engine.Submit(pFileBatch));
+            Assert::AreEqual(S_OK, pFileBatch->Wait(600000));
+            ::QueryPerformanceCounter(&middle);
+            ioMiddle = GetProcessIoBytes();
+            Assert::AreEqual(S_OK, engine.Submit(pStreamBatch));
+            Assert::AreEqual(S_OK, pStreamBatch->Wait(600000));
+            ::QueryPerformanceCounter(&end);
+            ioEnd = GetProcessIoBytes();
+
+            double fileMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            double streamMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+            ::swprintf_s(message, L"2 GB cross-drive copy: temp file %.0f ms, %llu MB of I/O; stream %.0f ms, %llu MB of I/O\n",
+                fileMs, (ioMiddle - ioStart) / (1024 * 1024), streamMs, (ioEnd - ioMiddle) / (1024 * 1024));
+            Logger::WriteMessage(message);
+
+            // Assert
+            Assert::AreEqual(static_cast<LONGLONG>(size), static_cast<LONGLONG>(pFileMock->bytesRead));
+            Assert::AreEqual(static_cast<LONGLONG>(size), static_cast<LONGLONG>(pStreamMock->bytesStreamed));
+            Assert::IsTrue(ioMiddle - ioStart >= 2 * size, L"The temp file was not written and read back.");
+            Assert::IsTrue(ioEnd - ioMiddle < size / 100, L"The stream went through the disk.");
+
+            // Cleanup
+            engine.WaitForIdle();
+            pFileBatch->Release();
+            pStreamBatch->Release();
+            pFileSource->Release();
+            pStreamSource->Release();
+            pFileMock->Release();
+            pStreamMock->Release();
+        }
+
+    private:
+
+        HRESULT m_hrCoInit = S_OK;
+    };
+}
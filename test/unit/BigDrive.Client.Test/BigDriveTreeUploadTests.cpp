@@ -0,0 +1,433 @@
+// <copyright file="BigDriveTreeUploadTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <string>
+#include <vector>
+
+#include "BigDriveTransferEngine.h"
+#include "BigDriveTreeUpload.h"
+#include "MockBigDriveFileOperations.h"
+#include "MockStream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveClientTest
+{
+    // {5D0A8A7E-3C0B-4F59-9A43-2B7E1C9D6F03}
+    static const CLSID CLSID_TreeProvider =
+        { 0x5d0a8a7e, 0x3c0b, 0x4f59, { 0x9a, 0x43, 0x2b, 0x7e, 0x1c, 0x9d, 0x6f, 0x03 } };
+
+    // {0E6C3B44-71D2-4C8E-8F15-6A9B2D4E7C11}
+    static const GUID TreeDriveGuid =
+        { 0x0e6c3b44, 0x71d2, 0x4c8e, { 0x8f, 0x15, 0x6a, 0x9b, 0x2d, 0x4e, 0x7c, 0x11 } };
+
+    /// <summary>
+    /// Creates a folder under a new temporary folder and returns its path.
+    /// </summary>
+    static std::wstring CreateTempFolder(LPCWSTR name)
+    {
+        wchar_t temp[MAX_PATH];
+        wchar_t path[MAX_PATH];
+
+        ::GetTempPathW(MAX_PATH, temp);
+        ::swprintf_s(path, L"%sBigDriveTreeUploadTests_%u_%llu", temp, ::GetCurrentProcessId(), ::GetTickCount64());
+        Assert::IsTrue(::CreateDirectoryW(path, nullptr) != FALSE);
+
+        ::wcscat_s(path, L"\\");
+        ::wcscat_s(path, name);
+        Assert::IsTrue(::CreateDirectoryW(path, nullptr) != FALSE);
+
+        return path;
+    }
+
+    /// <summary>
+    /// Creates a folder, with empty files named file000.dat onwards in it.
+    /// </summary>
+    static void CreateFolderWithFiles(const std::wstring& folder, ULONG count)
+    {
+        wchar_t path[MAX_PATH];
+        HANDLE hFile = INVALID_HANDLE_VALUE;
+
+        ::CreateDirectoryW(folder.c_str(), nullptr);
+
+        for (ULONG i = 0; i < count; i++)
+        {
+            ::swprintf_s(path, L"%s\\file%03u.dat", folder.c_str(), i);
+
+            hFile = ::CreateFileW(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            Assert::IsTrue(hFile != INVALID_HANDLE_VALUE);
+            ::CloseHandle(hFile);
+        }
+    }
+
+    /// <summary>
+    /// Deletes a folder and everything under it.
+    /// </summary>
+    static void DeleteFolder(const std::wstring& folder)
+    {
+        WIN32_FIND_DATAW data = {};
+        HANDLE hFind = ::FindFirstFileW((folder + L"\\*").c_str(), &data);
+
+        if (hFind != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                std::wstring path = folder + L"\\" + data.cFileName;
+
+                if ((::wcscmp(data.cFileName, L".") == 0) || (::wcscmp(data.cFileName, L"..") == 0))
+                {
+                    continue;
+                }
+
+                if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                {
+                    DeleteFolder(path);
+                }
+                else
+                {
+                    ::DeleteFileW(path.c_str());
+                }
+            }
+            while (::FindNextFileW(hFind, &data));
+
+            ::FindClose(hFind);
+        }
+
+        ::RemoveDirectoryW(folder.c_str());
+    }
+
+    /// <summary>
+    /// Returns the folder a path is in.
+    /// </summary>
+    static std::wstring GetParent(const std::wstring& path)
+    {
+        return path.substr(0, path.find_last_of(L'\\'));
+    }
+
+    /// <summary>
+    /// Walks a folder on one thread the way a drop used to be collected, recording each folder
+    /// to create and each file with the folder it is copied to.
+    /// </summary>
+    static void WalkFolder(const std::wstring& folder, const std::wstring& target, std::vector<std::wstring>& folders, std::vector<std::pair<std::wstring, std::wstring>>& files)
+    {
+        WIN32_FIND_DATAW data = {};
+        HANDLE hFind = ::FindFirstFileW((folder + L"\\*").c_str(), &data);
+
+        folders.push_back(target);
+
+        if (hFind == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        do
+        {
+            if ((::wcscmp(data.cFileName, L".") == 0) || (::wcscmp(data.cFileName, L"..") == 0))
+            {
+                continue;
+            }
+
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                WalkFolder(folder + L"\\" + data.cFileName, target + L"\\" + data.cFileName, folders, files);
+            }
+            else
+            {
+                files.push_back(std::make_pair(folder + L"\\" + data.cFileName, target));
+            }
+        }
+        while (::FindNextFileW(hFind, &data));
+
+        ::FindClose(hFind);
+    }
+
+    TEST_CLASS(BigDriveTreeUploadTests)
+    {
+    public:
+
+        /// <summary>
+        /// Uploads a dropped folder and a dropped file, and checks every file is copied to its
+        /// own folder, every folder is made once and after its parent, and no file is copied
+        /// before its folder exists.
+        /// </summary>
+        TEST_METHOD(Start_UploadsEveryFileAfterItsFolder)
+        {
+            // Arrange
+            std::wstring root = CreateTempFolder(L"Trip");
+            std::wstring loose = GetParent(root) + L"\\loose.dat";
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = nullptr;
+            BigDriveTreeUpload* pUpload = nullptr;
+            BigDriveTransferItem item = {};
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+            HRESULT hrSkipped = S_OK;
+            BOOL fFoundRaw = FALSE;
+
+            CreateFolderWithFiles(root, 3);
+            CreateFolderWithFiles(root + L"\\Day1", 4);
+            CreateFolderWithFiles(root + L"\\Day1\\Raw", 5);
+            CreateFolderWithFiles(root + L"\\Day2", 4);
+            CreateFolderWithFiles(root + L"\\Day3", 0);
+            ::CloseHandle(::CreateFileW(loose.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+            pMock->AddDirectory(L"\\Photos");
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(TreeDriveGuid, CLSID_TreeProvider, L"\\Photos", MockBigDriveFileOperations::Factory, pMock, &pBatch));
+            Assert::AreEqual(S_OK, BigDriveTreeUpload::Create(pBatch, 2, &pUpload));
+            Assert::AreEqual(S_OK, pUpload->Add(root.c_str()));
+            Assert::AreEqual(S_OK, pUpload->Add(loose.c_str()));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.SubmitOpen(pBatch));
+            Assert::AreEqual(S_OK, pUpload->Start());
+            Assert::AreEqual(S_OK, pBatch->Wait(30000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(17UL, succeeded);
+            Assert::AreEqual(0UL, failed);
+            Assert::AreEqual(17UL, pBatch->GetCount());
+            Assert::AreEqual(5L, static_cast<LONG>(pMock->createCount));
+            Assert::AreEqual(0L, static_cast<LONG>(pMock->outOfOrderCount));
+            Assert::AreEqual(0L, static_cast<LONG>(pMock->orphanCount));
+            Assert::AreEqual(0UL, pUpload->GetSkippedFolders(hrSkipped));
+            Assert::AreEqual(E_UNEXPECTED, pUpload->Start());
+
+            for (ULONG i = 0; i < pBatch->GetCount(); i++)
+            {
+                Assert::AreEqual(S_OK, pBatch->GetItem(i, item));
+                if (::wcsstr(item.szLocalPath, L"\\Raw\\") != nullptr)
+                {
+                    Assert::AreEqual(L"\\Photos\\Trip\\Day1\\Raw", item.szTargetPath);
+                    fFoundRaw = TRUE;
+                }
+            }
+
+            Assert::IsTrue(fFoundRaw);
+
+            // Cleanup
+            engine.WaitForIdle();
+            pUpload->Release();
+            pBatch->Release();
+            pMock->Release();
+            DeleteFolder(GetParent(root));
+        }
+
+        /// <summary>
+        /// Checks an upload of files alone seals the batch as soon as it starts.
+        /// </summary>
+        TEST_METHOD(Start_WithoutFoldersSealsBatch)
+        {
+            // Arrange
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            BigDriveTransferBatch* pBatch = nullptr;
+            BigDriveTreeUpload* pUpload = nullptr;
+
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(TreeDriveGuid, CLSID_TreeProvider, L"\\Photos", MockBigDriveFileOperations::Factory, pMock, &pBatch));
+            Assert::AreEqual(S_OK, BigDriveTreeUpload::Create(pBatch, 2, &pUpload));
+            Assert::AreEqual(S_OK, pUpload->Add(L"C:\\Upload\\IMG_0000.jpg"));
+            Assert::AreEqual(S_OK, pUpload->Add(L"C:\\Upload\\IMG_0001.jpg"));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.SubmitOpen(pBatch));
+            Assert::AreEqual(S_OK, pUpload->Start());
+
+            // Assert
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+            Assert::AreEqual(2L, static_cast<LONG>(pMock->copyCount));
+            Assert::AreEqual(E_UNEXPECTED, pUpload->Add(L"C:\\Upload\\IMG_0002.jpg"));
+
+            // Cleanup
+            engine.WaitForIdle();
+            pUpload->Release();
+            pBatch->Release();
+            pMock->Release();
+        }
+
+        /// <summary>
+        /// Uploads virtual files named by paths relative to the drop, and checks each folder is made
+        /// once, after its parent, including one only implied by a file's path, and that no file is
+        /// copied before its folder exists.
+        /// </summary>
+        TEST_METHOD(AddStream_FileInFolder_CopiedAfterFolderCreated)
+        {
+            // Arrange
+            HRESULT hrCoInit = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+            BigDriveTransferEngine engine(4, 4, 3, 0);
+            MockBigDriveFileOperations* pMock = new MockBigDriveFileOperations();
+            MockStream* pStreams[3] = { new MockStream(1024), new MockStream(2048), new MockStream(4096) };
+            BigDriveTransferBatch* pBatch = nullptr;
+            BigDriveTreeUpload* pUpload = nullptr;
+            ULONG succeeded = 0, failed = 0, cancelled = 0;
+            ULONGLONG cbDone = 0;
+
+            pMock->supportStreams = TRUE;
+            pMock->AddDirectory(L"\\Photos");
+
+            Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(TreeDriveGuid, CLSID_TreeProvider, L"\\Photos", MockBigDriveFileOperations::Factory, pMock, &pBatch));
+            Assert::AreEqual(S_OK, BigDriveTreeUpload::Create(pBatch, 2, &pUpload));
+            Assert::AreEqual(S_OK, pUpload->AddFolder(L"Trip"));
+            Assert::AreEqual(S_OK, pUpload->AddStream(pStreams[0], L"Trip\\a.bin", -1, 0));
+            Assert::AreEqual(S_OK, pUpload->AddStream(pStreams[1], L"Trip\\Day1\\b.bin", -1, 0));
+            Assert::AreEqual(S_OK, pUpload->AddStream(pStreams[2], L"c.bin", -1, 0));
+            Assert::AreEqual(E_INVALIDARG, pUpload->AddFolder(L"Trip\\\\Day2"));
+
+            // Act
+            Assert::AreEqual(S_OK, engine.SubmitOpen(pBatch));
+            Assert::AreEqual(S_OK, pUpload->Start());
+            Assert::AreEqual(S_OK, pBatch->Wait(10000));
+
+            // Assert
+            pBatch->GetProgress(succeeded, failed, cancelled, cbDone);
+            Assert::AreEqual(3UL, succeeded);
+            Assert::AreEqual(0UL, failed);
+            Assert::AreEqual(2L, static_cast<LONG>(pMock->createCount), L"Trip and Trip\\Day1 should each be made once.");
+            Assert::AreEqual(0L, static_cast<LONG>(pMock->outOfOrderCount));
+            Assert::AreEqual(0L, static_cast<LONG>(pMock->orphanCount));
+            Assert::AreEqual(3L, static_cast<LONG>(pMock->streamCount));
+            Assert::AreEqual(E_UNEXPECTED, pUpload->AddFolder(L"Later"));
+
+            // Cleanup
+            engine.WaitForIdle();
+            pUpload->Release();
+            pBatch->Release();
+
+            for (ULONG i = 0; i < ARRAYSIZE(pStreams); i++)
+            {
+                pStreams[i]->Release();
+            }
+
+            pMock->Release();
+
+            if (SUCCEEDED(hrCoInit))
+            {
+                ::CoUninitialize();
+            }
+        }
+
+        /// <summary>
+        /// Benchmark: uploads a 50,000-file tree (50 folders of 10 folders of 100 files) to a
+        /// simulated VHD provider, four copies at a time, and to a simulated Zip provider, which
+        /// writes one entry at a time. Each is uploaded the way a drop used to be collected,
+        /// walking the whole tree and creating every folder before the first file is copied, and
+        /// with the tree upload, and both times are reported.
+        /// </summary>
+        TEST_METHOD(Benchmark_FiftyThousandFileTree)
+        {
+            struct Profile
+            {
+                LPCWSTR name;
+                ULONG providerLimit;
+                DWORD spinUs;
+            };
+
+            // Arrange
+            const Profile profiles[] = { { L"VHD", 4, 20 }, { L"Zip", 1, 40 } };
+            const ULONG expected = 50 * 10 * 100;
+            std::wstring root = CreateTempFolder(L"Tree");
+            LARGE_INTEGER frequency, start, middle, end;
+            wchar_t folder[MAX_PATH];
+            wchar_t message[256];
+
+            ::QueryPerformanceFrequency(&frequency);
+            ::QueryPerformanceCounter(&start);
+
+            for (ULONG i = 0; i < 50; i++)
+            {
+                ::swprintf_s(folder, L"%s\\F%02u", root.c_str(), i);
+                ::CreateDirectoryW(folder, nullptr);
+
+                for (ULONG j = 0; j < 10; j++)
+                {
+                    ::swprintf_s(folder, L"%s\\F%02u\\S%02u", root.c_str(), i, j);
+                    CreateFolderWithFiles(folder, 100);
+                }
+            }
+
+            ::QueryPerformanceCounter(&end);
+            ::swprintf_s(message, L"Created %u files in %.0f ms\n", expected, (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+            Logger::WriteMessage(message);
+
+            for (const Profile& profile : profiles)
+            {
+                BigDriveTransferEngine walkFirst(BigDriveTransferEngine::DefaultMaxWorkers, profile.providerLimit, 1, 0);
+                BigDriveTransferEngine overlapped(BigDriveTransferEngine::DefaultMaxWorkers, profile.providerLimit, 1, 0);
+                MockBigDriveFileOperations* pWalkFirstMock = new MockBigDriveFileOperations();
+                MockBigDriveFileOperations* pOverlappedMock = new MockBigDriveFileOperations();
+                BigDriveTransferBatch* pWalkFirstBatch = nullptr;
+                BigDriveTransferBatch* pOverlappedBatch = nullptr;
+                BigDriveTreeUpload* pUpload = nullptr;
+                std::vector<std::wstring> folders;
+                std::vector<std::pair<std::wstring, std::wstring>> files;
+
+                pWalkFirstMock->spinUs = profile.spinUs;
+                pWalkFirstMock->AddDirectory(L"\\Drive");
+                pOverlappedMock->spinUs = profile.spinUs;
+                pOverlappedMock->AddDirectory(L"\\Drive");
+
+                Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(TreeDriveGuid, CLSID_TreeProvider, L"\\Drive", MockBigDriveFileOperations::Factory, pWalkFirstMock, &pWalkFirstBatch));
+                Assert::AreEqual(S_OK, BigDriveTransferBatch::Create(TreeDriveGuid, CLSID_TreeProvider, L"\\Drive", MockBigDriveFileOperations::Factory, pOverlappedMock, &pOverlappedBatch));
+
+                // Act: walk everything, create every folder, then copy
+                ::QueryPerformanceCounter(&start);
+
+                WalkFolder(root, L"\\Drive\\Tree", folders, files);
+
+                for (const std::wstring& target : folders)
+                {
+                    pWalkFirstMock->CreateDirectory(TreeDriveGuid, target.c_str());
+                }
+
+                for (const std::pair<std::wstring, std::wstring>& file : files)
+                {
+                    Assert::AreEqual(S_OK, pWalkFirstBatch->AddFile(file.first.c_str(), file.second.c_str()));
+                }
+
+                Assert::AreEqual(S_OK, walkFirst.Submit(pWalkFirstBatch));
+                Assert::AreEqual(S_OK, pWalkFirstBatch->Wait(600000));
+
+                // Act: walk, create and copy at once
+                ::QueryPerformanceCounter(&middle);
+
+                Assert::AreEqual(S_OK, BigDriveTreeUpload::Create(pOverlappedBatch, BigDriveTreeUpload::DefaultMaxWalkers, &pUpload));
+                Assert::AreEqual(S_OK, pUpload->Add(root.c_str()));
+                Assert::AreEqual(S_OK, overlapped.SubmitOpen(pOverlappedBatch));
+                Assert::AreEqual(S_OK, pUpload->Start());
+                Assert::AreEqual(S_OK, pOverlappedBatch->Wait(600000));
+
+                ::QueryPerformanceCounter(&end);
+
+                double walkFirstMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+                double overlappedMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+                ::swprintf_s(message, L"%s (%u at a time, %u us per call): walk first %.0f ms, tree upload %.0f ms\n",
+                    profile.name, profile.providerLimit, profile.spinUs, walkFirstMs, overlappedMs);
+                Logger::WriteMessage(message);
+
+                // Assert
+                Assert::AreEqual(static_cast<LONG>(expected), static_cast<LONG>(pWalkFirstMock->copyCount));
+                Assert::AreEqual(static_cast<LONG>(expected), static_cast<LONG>(pOverlappedMock->copyCount));
+                Assert::AreEqual(551L, static_cast<LONG>(pOverlappedMock->createCount));
+                Assert::AreEqual(0L, static_cast<LONG>(pOverlappedMock->outOfOrderCount));
+                Assert::AreEqual(0L, static_cast<LONG>(pOverlappedMock->orphanCount));
+
+                // Cleanup
+                walkFirst.WaitForIdle();
+                overlapped.WaitForIdle();
+                pUpload->Release();
+                pWalkFirstBatch->Release();
+                pOverlappedBatch->Release();
+                pWalkFirstMock->Release();
+                pOverlappedMock->Release();
+            }
+
+            // Cleanup
+            DeleteFolder(GetParent(root));
+        }
+    };
+}
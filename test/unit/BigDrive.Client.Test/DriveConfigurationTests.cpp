@@ -116,5 +116,28 @@ namespace BigDriveClientTest
             // Assert
             Assert::AreNotEqual(S_OK, hr, L"ParseJson should not return S_OK for empty JSON.");
         }
+
+        /// <summary>
+        /// Test CopyTo replaces every field of a configuration that already has a name.
+        /// </summary>
+        TEST_METHOD(TestCopyTo_ReplacesTarget)
+        {
+            // Arrange
+            DriveConfiguration source;
+            DriveConfiguration target;
+
+            Assert::AreEqual(S_OK, source.ParseJson(L"{\"id\":\"12345678-1234-1234-1234-56789abcdef2\",\"name\":\"NewDrive\",\"clsid\":\"12345678-1234-1234-1234-56789abc01f3\"}"));
+            Assert::AreEqual(S_OK, target.ParseJson(L"{\"id\":\"12345678-1234-1234-1234-56789abcdef2\",\"name\":\"OldDrive\",\"clsid\":\"12345678-1234-1234-1234-56789abc01f2\"}"));
+
+            // Act
+            HRESULT hr = source.CopyTo(target);
+
+            // Assert
+            Assert::AreEqual(S_OK, hr, L"CopyTo should return S_OK.");
+            Assert::IsTrue(source.id == target.id, L"ID should be copied.");
+            Assert::IsTrue(source.clsid == target.clsid, L"CLSID should be copied.");
+            Assert::AreEqual(wstring(L"NewDrive"), wstring(target.name), L"Name should be replaced.");
+            Assert::IsFalse(source.name == target.name, L"Name should be a copy, not shared.");
+        }
     };
 }
@@ -0,0 +1,389 @@
+// <copyright file="MockBigDriveFileOperations.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <wchar.h>
+#include <set>
+#include <string>
+
+// Local
+#include "Interfaces/IBigDriveFileOperations.h"
+#include "Interfaces/IBigDriveStreamOperations.h"
+
+namespace BigDriveClientTest
+{
+    /// <summary>
+    /// Stand-in for a provider's IBigDriveFileOperations that uploads nothing. CopyFileToBigDrive
+    /// sleeps to simulate the upload, can fail a given file a number of times, and counts the
+    /// copies running at once so a test can check the transfer engine's limits. With directory
+    /// tracking on, CreateDirectory records the folders made, and folders made before their
+    /// parent and files copied to a folder not yet made are counted. With stream support on, it
+    /// also implements IBigDriveStreamOperations and reads each stream to its end.
+    /// </summary>
+    class MockBigDriveFileOperations : public IBigDriveFileOperations, public IBigDriveStreamOperations
+    {
+    private:
+
+        volatile LONG m_refCount;
+
+        std::set<std::wstring> m_directories;
+        SRWLOCK m_directoriesLock;
+
+        /// <summary>
+        /// Determines whether a folder exists, or was made by CreateDirectory.
+        /// </summary>
+        bool HasDirectory(const std::wstring& path)
+        {
+            bool found = false;
+
+            ::AcquireSRWLockShared(&m_directoriesLock);
+            found = m_directories.find(path) != m_directories.end();
+            ::ReleaseSRWLockShared(&m_directoriesLock);
+
+            return found;
+        }
+
+        /// <summary>
+        /// Reads a stream to its end and returns the number of bytes read.
+        /// </summary>
+        static HRESULT ReadToEnd(ISequentialStream* pStream, ULONGLONG& cbTotal)
+        {
+            HRESULT hr = S_OK;
+            BYTE* pBuffer = new BYTE[ReadBufferSize];
+            ULONG cbRead = 0;
+
+            cbTotal = 0;
+
+            do
+            {
+                cbRead = 0;
+                hr = pStream->Read(pBuffer, ReadBufferSize, &cbRead);
+                cbTotal += cbRead;
+            }
+            while (SUCCEEDED(hr) && (cbRead > 0));
+
+            delete[] pBuffer;
+
+            return hr;
+        }
+
+        /// <summary>
+        /// Busy waits, for provider calls shorter than Sleep can time.
+        /// </summary>
+        static void Spin(DWORD microseconds)
+        {
+            LARGE_INTEGER frequency = {};
+            LARGE_INTEGER start = {};
+            LARGE_INTEGER now = {};
+
+            ::QueryPerformanceFrequency(&frequency);
+            ::QueryPerformanceCounter(&start);
+
+            do
+            {
+                ::YieldProcessor();
+                ::QueryPerformanceCounter(&now);
+            }
+            while ((now.QuadPart - start.QuadPart) * 1000000 < static_cast<LONGLONG>(microseconds) * frequency.QuadPart);
+        }
+
+    public:
+
+        /// <summary>
+        /// Size of the reads made of streams and, with readFiles on, of local files.
+        /// </summary>
+        static const ULONG ReadBufferSize = 1024 * 1024;
+
+        /// <summary>
+        /// Milliseconds each copy takes.
+        /// </summary>
+        DWORD sleepMs;
+
+        /// <summary>
+        /// Microseconds each copy and each CreateDirectory spins for, on top of sleepMs.
+        /// </summary>
+        DWORD spinUs;
+
+        /// <summary>
+        /// File that fails; nullptr for none. Compared with the local path.
+        /// </summary>
+        LPCWSTR failPath;
+
+        /// <summary>
+        /// Number of times the file fails before it succeeds; ULONG_MAX for always.
+        /// </summary>
+        ULONG failTimes;
+
+        /// <summary>
+        /// HRESULT the failing file returns.
+        /// </summary>
+        HRESULT failWith;
+
+        /// <summary>
+        /// Number of calls, of successful copies, and of failures.
+        /// </summary>
+        volatile LONG callCount;
+        volatile LONG copyCount;
+        volatile LONG failCount;
+
+        /// <summary>
+        /// Number of copies running, and the most that ran at once.
+        /// </summary>
+        volatile LONG activeCount;
+        volatile LONG peakCount;
+
+        /// <summary>
+        /// TRUE to track folders; see <see cref="AddDirectory"/>.
+        /// </summary>
+        BOOL trackDirectories;
+
+        /// <summary>
+        /// Number of CreateDirectory calls, of folders made before their parent, and of files
+        /// copied to a folder not yet made. Only counted with directory tracking on.
+        /// </summary>
+        volatile LONG createCount;
+        volatile LONG outOfOrderCount;
+        volatile LONG orphanCount;
+
+        /// <summary>
+        /// TRUE to answer QueryInterface for IBigDriveStreamOperations.
+        /// </summary>
+        BOOL supportStreams;
+
+        /// <summary>
+        /// TRUE for CopyFileToBigDrive to read the local file, as a provider would.
+        /// </summary>
+        BOOL readFiles;
+
+        /// <summary>
+        /// Number of CopyStreamToBigDrive calls, bytes read from streams, and bytes read from
+        /// local files with readFiles on.
+        /// </summary>
+        volatile LONG streamCount;
+        volatile LONGLONG bytesStreamed;
+        volatile LONGLONG bytesRead;
+
+        /// <summary>
+        /// Target of the last CopyStreamToBigDrive, and local path of the last CopyFileToBigDrive.
+        /// </summary>
+        std::wstring lastStreamTarget;
+        std::wstring lastLocalPath;
+
+        MockBigDriveFileOperations()
+            : m_refCount(1), sleepMs(0), spinUs(0), failPath(nullptr), failTimes(0), failWith(E_FAIL),
+            callCount(0), copyCount(0), failCount(0), activeCount(0), peakCount(0),
+            trackDirectories(FALSE), createCount(0), outOfOrderCount(0), orphanCount(0),
+            supportStreams(FALSE), readFiles(FALSE), streamCount(0), bytesStreamed(0), bytesRead(0)
+        {
+            ::InitializeSRWLock(&m_directoriesLock);
+        }
+
+        /// <summary>
+        /// Turns on directory tracking with a folder that already exists, such as the one dropped on.
+        /// </summary>
+        void AddDirectory(LPCWSTR path)
+        {
+            trackDirectories = TRUE;
+
+            ::AcquireSRWLockExclusive(&m_directoriesLock);
+            m_directories.insert(path);
+            ::ReleaseSRWLockExclusive(&m_directoriesLock);
+        }
+
+        virtual ~MockBigDriveFileOperations() = default;
+
+        /// <summary>
+        /// <see cref="BigDriveFileOperationsFactory"/> that hands out the mock passed as the context.
+        /// </summary>
+        static HRESULT Factory(REFGUID driveGuid, HRESULT hrLastAttempt, void* pContext, IBigDriveFileOperations** ppFileOperations)
+        {
+            MockBigDriveFileOperations* pMock = static_cast<MockBigDriveFileOperations*>(pContext);
+
+            pMock->AddRef();
+            *ppFileOperations = pMock;
+
+            return S_OK;
+        }
+
+        // IUnknown methods
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+        {
+            if (ppvObject == nullptr)
+            {
+                return E_POINTER;
+            }
+
+            if ((riid == IID_IUnknown) || (riid == IID_IBigDriveFileOperations))
+            {
+                *ppvObject = static_cast<IBigDriveFileOperations*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            if (supportStreams && (riid == IID_IBigDriveStreamOperations))
+            {
+                *ppvObject = static_cast<IBigDriveStreamOperations*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            *ppvObject = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ::InterlockedIncrement(&m_refCount);
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            ULONG res = ::InterlockedDecrement(&m_refCount);
+            if (res == 0) delete this;
+            return res;
+        }
+
+        // IBigDriveFileOperations methods
+        HRESULT STDMETHODCALLTYPE CopyFileToBigDrive(REFCLSID driveGuid, LPCWSTR localFilePath, LPCWSTR bigDriveTargetPath) override
+        {
+            HRESULT hr = S_OK;
+            LONG active = ::InterlockedIncrement(&activeCount);
+            LONG peak = peakCount;
+
+            ::InterlockedIncrement(&callCount);
+
+            while ((active > peak) && (::InterlockedCompareExchange(&peakCount, active, peak) != peak))
+            {
+                peak = peakCount;
+            }
+
+            if (sleepMs > 0)
+            {
+                ::Sleep(sleepMs);
+            }
+
+            if (spinUs > 0)
+            {
+                Spin(spinUs);
+            }
+
+            if (trackDirectories && !HasDirectory(bigDriveTargetPath))
+            {
+                ::InterlockedIncrement(&orphanCount);
+            }
+
+            lastLocalPath = localFilePath;
+
+            if (readFiles)
+            {
+                HANDLE hFile = ::CreateFileW(localFilePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+                BYTE* pBuffer = new BYTE[ReadBufferSize];
+                DWORD cbRead = 0;
+
+                if (hFile == INVALID_HANDLE_VALUE)
+                {
+                    hr = HRESULT_FROM_WIN32(::GetLastError());
+                }
+
+                while ((hFile != INVALID_HANDLE_VALUE) && ::ReadFile(hFile, pBuffer, ReadBufferSize, &cbRead, nullptr) && (cbRead > 0))
+                {
+                    ::InterlockedAdd64(&bytesRead, cbRead);
+                }
+
+                if (hFile != INVALID_HANDLE_VALUE)
+                {
+                    ::CloseHandle(hFile);
+                }
+
+                delete[] pBuffer;
+            }
+
+            if (FAILED(hr))
+            {
+                ::InterlockedIncrement(&failCount);
+            }
+            else if (failPath && (::wcscmp(localFilePath, failPath) == 0) &&
+                (static_cast<ULONG>(::InterlockedIncrement(&failCount)) <= failTimes))
+            {
+                hr = failWith;
+            }
+            else
+            {
+                ::InterlockedIncrement(&copyCount);
+            }
+
+            ::InterlockedDecrement(&activeCount);
+
+            return hr;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateDirectory(REFCLSID driveGuid, LPCWSTR bigDriveDirectoryPath) override
+        {
+            std::wstring path(bigDriveDirectoryPath);
+            size_t separator = path.find_last_of(L'\\');
+
+            if (!trackDirectories)
+            {
+                return E_NOTIMPL;
+            }
+
+            ::InterlockedIncrement(&createCount);
+
+            if (spinUs > 0)
+            {
+                Spin(spinUs);
+            }
+
+            if ((separator == std::wstring::npos) || !HasDirectory(path.substr(0, separator)))
+            {
+                ::InterlockedIncrement(&outOfOrderCount);
+            }
+
+            ::AcquireSRWLockExclusive(&m_directoriesLock);
+            m_directories.insert(path);
+            ::ReleaseSRWLockExclusive(&m_directoriesLock);
+
+            return S_OK;
+        }
+
+        // IBigDriveStreamOperations methods
+        HRESULT STDMETHODCALLTYPE CopyStreamToBigDrive(REFGUID driveGuid, IStream* pStream, LPCWSTR bigDriveTargetPath, LONGLONG size, LONGLONG lastWriteTime) override
+        {
+            HRESULT hr = S_OK;
+            ULONGLONG cbTotal = 0;
+            std::wstring target(bigDriveTargetPath);
+
+            ::InterlockedIncrement(&callCount);
+            ::InterlockedIncrement(&streamCount);
+
+            lastStreamTarget = bigDriveTargetPath;
+
+            if (trackDirectories && !HasDirectory(target.substr(0, target.find_last_of(L'\\'))))
+            {
+                ::InterlockedIncrement(&orphanCount);
+            }
+
+            hr = ReadToEnd(pStream, cbTotal);
+            ::InterlockedAdd64(&bytesStreamed, static_cast<LONGLONG>(cbTotal));
+
+            if (FAILED(hr))
+            {
+                ::InterlockedIncrement(&failCount);
+                return hr;
+            }
+
+            ::InterlockedIncrement(&copyCount);
+
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE CopyFileFromBigDrive(REFCLSID driveGuid, LPCWSTR bigDriveFilePath, LPCWSTR localTargetPath) override { return E_NOTIMPL; }
+        HRESULT STDMETHODCALLTYPE DeleteFile(REFCLSID driveGuid, LPCWSTR bigDriveFilePath) override { return E_NOTIMPL; }
+        HRESULT STDMETHODCALLTYPE OpenFile(REFCLSID driveGuid, LPCWSTR bigDriveFilePath, HWND hwndParent) override { return E_NOTIMPL; }
+        HRESULT STDMETHODCALLTYPE MoveFile(REFCLSID driveGuid, LPCWSTR sourcePath, LPCWSTR destinationPath) override { return E_NOTIMPL; }
+    };
+}
@@ -0,0 +1,504 @@
+// <copyright file="MockBigDriveProvider.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <oaidl.h>
+
+// Local
+#include "BigDriveProviderActivator.h"
+#include "Interfaces/IBigDriveEnumerate.h"
+#include "Interfaces/IBigDriveEnumerateEx.h"
+#include "Interfaces/IBigDriveEnumeratePaged.h"
+#include "Interfaces/IBigDriveFileInfo.h"
+#include "Interfaces/IBigDriveFileInfoBatch.h"
+
+namespace BigDriveClientTest
+{
+    /// <summary>
+    /// In-process stand-in for a COM+ provider. Implements IBigDriveEnumerate, IBigDriveEnumerateEx,
+    /// IBigDriveEnumeratePaged, IBigDriveFileInfo and IBigDriveFileInfoBatch, counts calls, can simulate the cost
+    /// of an out-of-process round trip and can be told to fail every call with a given HRESULT (for example RPC_E_DISCONNECTED).
+    /// Aggregates the free-threaded marshaler, so the connection pool can hold it in the Global Interface Table
+    /// without a registered proxy/stub.
+    /// </summary>
+    class MockBigDriveProvider : public IBigDriveEnumerate, public IBigDriveEnumerateEx, public IBigDriveEnumeratePaged, public IBigDriveFileInfo,
+        public IBigDriveFileInfoBatch
+    {
+    private:
+
+        volatile LONG m_refCount;
+        volatile LONG* m_pLiveCount;
+        IUnknown* m_pMarshaler;
+
+    public:
+
+        /// <summary>
+        /// Number of calls made on the provider interfaces.
+        /// </summary>
+        volatile LONG callCount;
+
+        /// <summary>
+        /// Milliseconds each provider call sleeps to simulate an RPC.
+        /// </summary>
+        DWORD callLatencyMs;
+
+        /// <summary>
+        /// HRESULT returned by every provider call. S_OK for normal operation.
+        /// </summary>
+        HRESULT failWith;
+
+        /// <summary>
+        /// Number of folders, and of files, returned by each enumeration.
+        /// </summary>
+        ULONG entryCount;
+
+        /// <summary>
+        /// Largest number of entries returned in one EnumerateEntriesPage call.
+        /// </summary>
+        ULONG largestPage;
+
+        /// <summary>
+        /// Largest number of paths passed in one GetFileInfoBatch call.
+        /// </summary>
+        volatile LONG largestBatch;
+
+        MockBigDriveProvider(volatile LONG* pLiveCount, DWORD latencyMs)
+            : m_refCount(1), m_pLiveCount(pLiveCount), m_pMarshaler(nullptr), callCount(0), callLatencyMs(latencyMs), failWith(S_OK), entryCount(2),
+            largestPage(0), largestBatch(0)
+        {
+            if (m_pLiveCount)
+            {
+                ::InterlockedIncrement(m_pLiveCount);
+            }
+
+            if (FAILED(::CoCreateFreeThreadedMarshaler(static_cast<IBigDriveEnumerate*>(this), &m_pMarshaler)))
+            {
+                m_pMarshaler = nullptr;
+            }
+        }
+
+        virtual ~MockBigDriveProvider()
+        {
+            if (m_pMarshaler)
+            {
+                m_pMarshaler->Release();
+                m_pMarshaler = nullptr;
+            }
+
+            if (m_pLiveCount)
+            {
+                ::InterlockedDecrement(m_pLiveCount);
+            }
+        }
+
+        // IUnknown methods
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+        {
+            if (ppvObject == nullptr)
+            {
+                return E_POINTER;
+            }
+
+            if (riid == IID_IUnknown || riid == IID_IBigDriveEnumerate)
+            {
+                *ppvObject = static_cast<IBigDriveEnumerate*>(this);
+            }
+            else if (riid == IID_IBigDriveEnumerateEx)
+            {
+                *ppvObject = static_cast<IBigDriveEnumerateEx*>(this);
+            }
+            else if (riid == IID_IBigDriveEnumeratePaged)
+            {
+                *ppvObject = static_cast<IBigDriveEnumeratePaged*>(this);
+            }
+            else if (riid == IID_IBigDriveFileInfo)
+            {
+                *ppvObject = static_cast<IBigDriveFileInfo*>(this);
+            }
+            else if (riid == IID_IBigDriveFileInfoBatch)
+            {
+                *ppvObject = static_cast<IBigDriveFileInfoBatch*>(this);
+            }
+            else if ((riid == IID_IMarshal) && (m_pMarshaler != nullptr))
+            {
+                return m_pMarshaler->QueryInterface(riid, ppvObject);
+            }
+            else
+            {
+                *ppvObject = nullptr;
+                return E_NOINTERFACE;
+            }
+
+            AddRef();
+            return S_OK;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return static_cast<ULONG>(::InterlockedIncrement(&m_refCount));
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            LONG refCount = ::InterlockedDecrement(&m_refCount);
+            if (refCount == 0)
+            {
+                delete this;
+            }
+
+            return static_cast<ULONG>(refCount);
+        }
+
+        // IBigDriveEnumerate methods
+        HRESULT STDMETHODCALLTYPE EnumerateFolders(REFGUID driveGuid, BSTR path, SAFEARRAY** folders) override
+        {
+            return CreateNames(L"Folder", folders);
+        }
+
+        HRESULT STDMETHODCALLTYPE EnumerateFiles(REFGUID driveGuid, BSTR path, SAFEARRAY** files) override
+        {
+            return CreateNames(L"File", files);
+        }
+
+        // IBigDriveEnumerateEx methods
+        HRESULT STDMETHODCALLTYPE EnumerateEntries(REFGUID driveGuid, BSTR path, LONG flags, SAFEARRAY** entries) override
+        {
+            HRESULT hr = SimulateCall();
+            ULONG folders = (flags & BigDriveEnumerateEntries_Folders) ? entryCount : 0;
+            ULONG files = (flags & BigDriveEnumerateEntries_Files) ? entryCount : 0;
+
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            return PackEntries(folders, files, 0, folders + files, entries);
+        }
+
+        // IBigDriveEnumeratePaged methods
+        HRESULT STDMETHODCALLTYPE EnumerateEntriesPage(REFGUID driveGuid, BSTR path, LONG flags, BSTR cursor, LONG pageSize, BSTR* nextCursor, SAFEARRAY** entries) override
+        {
+            HRESULT hr = SimulateCall();
+            ULONG folders = (flags & BigDriveEnumerateEntries_Folders) ? entryCount : 0;
+            ULONG files = (flags & BigDriveEnumerateEntries_Files) ? entryCount : 0;
+            ULONG offset = (cursor != nullptr) ? ::wcstoul(cursor, nullptr, 10) : 0;
+            ULONG count = 0;
+            wchar_t next[16];
+
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            if ((nextCursor == nullptr) || (entries == nullptr) || (pageSize <= 0))
+            {
+                return E_INVALIDARG;
+            }
+
+            *nextCursor = nullptr;
+
+            // The cursor is the offset of the next entry
+            if (offset > folders + files)
+            {
+                offset = folders + files;
+            }
+
+            count = folders + files - offset;
+            if (count > static_cast<ULONG>(pageSize))
+            {
+                count = static_cast<ULONG>(pageSize);
+            }
+
+            if (offset + count < folders + files)
+            {
+                ::swprintf_s(next, L"%lu", offset + count);
+                *nextCursor = ::SysAllocString(next);
+            }
+
+            if (count > largestPage)
+            {
+                largestPage = count;
+            }
+
+            return PackEntries(folders, files, offset, count, entries);
+        }
+
+        // IBigDriveFileInfo methods
+        HRESULT STDMETHODCALLTYPE LastModifiedTime(REFGUID driveGuid, BSTR path, DATE* pDate) override
+        {
+            HRESULT hr = SimulateCall();
+            if (SUCCEEDED(hr) && pDate)
+            {
+                *pDate = 45000.5;
+            }
+
+            return hr;
+        }
+
+        HRESULT STDMETHODCALLTYPE GetFileSize(REFGUID driveGuid, BSTR path, ULONGLONG* fileSize) override
+        {
+            HRESULT hr = SimulateCall();
+            if (SUCCEEDED(hr) && fileSize)
+            {
+                *fileSize = (path != nullptr) ? ::SysStringLen(path) : 0;
+            }
+
+            return hr;
+        }
+
+        // IBigDriveFileInfoBatch methods
+        HRESULT STDMETHODCALLTYPE GetFileInfoBatch(REFGUID driveGuid, SAFEARRAY* paths, LONG fields, SAFEARRAY** records) override
+        {
+            HRESULT hr = SimulateCall();
+            BSTR* aPaths = nullptr;
+            ULONG count = 0;
+            ULONG cb = 12;
+            BYTE* pData = nullptr;
+            BYTE* p = nullptr;
+            LONG largest = 0;
+
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            if ((paths == nullptr) || (records == nullptr))
+            {
+                return E_INVALIDARG;
+            }
+
+            count = paths->rgsabound[0].cElements;
+
+            // Callers may batch from several threads
+            do
+            {
+                largest = largestBatch;
+            } while ((static_cast<LONG>(count) > largest) && (::InterlockedCompareExchange(&largestBatch, static_cast<LONG>(count), largest) != largest));
+
+            ::SafeArrayAccessData(paths, reinterpret_cast<void**>(&aPaths));
+
+            for (ULONG i = 0; i < count; i++)
+            {
+                cb += 36 + ::SysStringLen(aPaths[i]) * sizeof(WCHAR);
+            }
+
+            *records = ::SafeArrayCreateVector(VT_UI1, 0, cb);
+            if (*records == nullptr)
+            {
+                ::SafeArrayUnaccessData(paths);
+                return E_OUTOFMEMORY;
+            }
+
+            ::SafeArrayAccessData(*records, reinterpret_cast<void**>(&pData));
+            ::ZeroMemory(pData, cb);
+
+            p = pData;
+            WriteValue<DWORD>(p, 0x4E454442);
+            WriteValue<USHORT>(p + 4, 1);
+            WriteValue<DWORD>(p + 8, count);
+            p += 12;
+
+            // One record per path, named by it; the size is the path's length and paths containing "Missing" don't exist
+            for (ULONG i = 0; i < count; i++)
+            {
+                USHORT cchName = static_cast<USHORT>(::SysStringLen(aPaths[i]));
+                ULONG cbRecord = 36 + cchName * sizeof(WCHAR);
+                BOOL fMissing = (::wcsstr(aPaths[i], L"Missing") != nullptr);
+
+                WriteValue<DWORD>(p, cbRecord);
+                WriteValue<DWORD>(p + 4, 0);
+                WriteValue<DWORD>(p + 8, fMissing ? 0 : (fields & 0x07));
+                WriteValue<DWORD>(p + 12, fMissing ? 0 : FILE_ATTRIBUTE_ARCHIVE);
+                WriteValue<ULONGLONG>(p + 16, fMissing ? 0 : cchName);
+                WriteValue<ULONGLONG>(p + 24, fMissing ? 0 : 133000000000000000ULL);
+                WriteValue<USHORT>(p + 32, cchName);
+                ::CopyMemory(p + 36, aPaths[i], cchName * sizeof(WCHAR));
+
+                p += cbRecord;
+            }
+
+            ::SafeArrayUnaccessData(*records);
+            ::SafeArrayUnaccessData(paths);
+
+            return S_OK;
+        }
+
+    private:
+
+        /// <summary>
+        /// Packs entries [first, first + count) of a listing of the given number of folders followed by files.
+        /// Names are "FolderN" / "FileN" and every file carries the etag "e".
+        /// </summary>
+        static HRESULT PackEntries(ULONG folders, ULONG files, ULONG first, ULONG count, SAFEARRAY** ppEntries)
+        {
+            ULONG cb = 12;
+            BYTE* pData = nullptr;
+            BYTE* p = nullptr;
+
+            if (ppEntries == nullptr)
+            {
+                return E_POINTER;
+            }
+
+            // Names are at most 16 characters
+            cb += count * (36 + 17 * sizeof(WCHAR));
+
+            *ppEntries = ::SafeArrayCreateVector(VT_UI1, 0, cb);
+            if (*ppEntries == nullptr)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            ::SafeArrayAccessData(*ppEntries, reinterpret_cast<void**>(&pData));
+            ::ZeroMemory(pData, cb);
+
+            p = pData;
+            WriteValue<DWORD>(p, 0x4E454442);
+            WriteValue<USHORT>(p + 4, 1);
+            WriteValue<DWORD>(p + 8, count);
+            p += 12;
+
+            for (ULONG i = first; i < first + count; i++)
+            {
+                BOOL fFolder = (i < folders);
+                wchar_t name[32];
+                USHORT cchName = static_cast<USHORT>(::swprintf_s(name, L"%s%lu", fFolder ? L"Folder" : L"File", fFolder ? i : i - folders));
+                USHORT cchETag = fFolder ? 0 : 1;
+                ULONG cbRecord = 36 + (cchName + cchETag) * sizeof(WCHAR);
+
+                WriteValue<DWORD>(p, cbRecord);
+                WriteValue<DWORD>(p + 4, fFolder ? 1 : 0);
+                WriteValue<DWORD>(p + 8, fFolder ? 0x04 : 0x0F);
+                WriteValue<DWORD>(p + 12, fFolder ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_ARCHIVE);
+                WriteValue<ULONGLONG>(p + 16, fFolder ? 0 : 1024ULL * (i - folders + 1));
+                WriteValue<ULONGLONG>(p + 24, 133000000000000000ULL);
+                WriteValue<USHORT>(p + 32, cchName);
+                WriteValue<USHORT>(p + 34, cchETag);
+                ::CopyMemory(p + 36, name, cchName * sizeof(WCHAR));
+
+                if (cchETag > 0)
+                {
+                    WriteValue<WCHAR>(p + 36 + cchName * sizeof(WCHAR), L'e');
+                }
+
+                p += cbRecord;
+            }
+
+            ::SafeArrayUnaccessData(*ppEntries);
+
+            return S_OK;
+        }
+
+        template <typename T>
+        static void WriteValue(BYTE* p, T value)
+        {
+            ::CopyMemory(p, &value, sizeof(T));
+        }
+
+        HRESULT SimulateCall()
+        {
+            ::InterlockedIncrement(&callCount);
+
+            if (callLatencyMs > 0)
+            {
+                ::Sleep(callLatencyMs);
+            }
+
+            return failWith;
+        }
+
+        HRESULT CreateNames(LPCWSTR prefix, SAFEARRAY** ppNames)
+        {
+            HRESULT hr = SimulateCall();
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            if (ppNames == nullptr)
+            {
+                return E_POINTER;
+            }
+
+            *ppNames = ::SafeArrayCreateVector(VT_BSTR, 0, entryCount);
+            if (*ppNames == nullptr)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            for (LONG i = 0; i < static_cast<LONG>(entryCount); i++)
+            {
+                wchar_t name[32];
+                ::swprintf_s(name, L"%s%ld", prefix, i);
+
+                BSTR bstrName = ::SysAllocString(name);
+                ::SafeArrayPutElement(*ppNames, &i, bstrName);
+                ::SysFreeString(bstrName);
+            }
+
+            return S_OK;
+        }
+    };
+
+    /// <summary>
+    /// Activator that creates <see cref="MockBigDriveProvider"/> instances in process.
+    /// </summary>
+    class MockBigDriveProviderActivator : public IBigDriveProviderActivator
+    {
+    public:
+
+        /// <summary>
+        /// Number of activations performed.
+        /// </summary>
+        volatile LONG activationCount;
+
+        /// <summary>
+        /// Number of provider instances that have not been released.
+        /// </summary>
+        volatile LONG liveCount;
+
+        /// <summary>
+        /// Milliseconds each activation sleeps to simulate an out-of-process activation.
+        /// </summary>
+        DWORD activationLatencyMs;
+
+        /// <summary>
+        /// Milliseconds each provider call sleeps to simulate an RPC.
+        /// </summary>
+        DWORD callLatencyMs;
+
+        /// <summary>
+        /// The most recently activated provider. Not AddRef'd.
+        /// </summary>
+        MockBigDriveProvider* pLastProvider;
+
+        MockBigDriveProviderActivator(DWORD activationLatency = 0, DWORD callLatency = 0)
+            : activationCount(0), liveCount(0), activationLatencyMs(activationLatency), callLatencyMs(callLatency), pLastProvider(nullptr)
+        {
+        }
+
+        HRESULT Activate(const CLSID& clsid, IUnknown** ppUnknown) override
+        {
+            if (ppUnknown == nullptr)
+            {
+                return E_POINTER;
+            }
+
+            ::InterlockedIncrement(&activationCount);
+
+            if (activationLatencyMs > 0)
+            {
+                ::Sleep(activationLatencyMs);
+            }
+
+            pLastProvider = new MockBigDriveProvider(&liveCount, callLatencyMs);
+            *ppUnknown = static_cast<IBigDriveEnumerate*>(pLastProvider);
+
+            return S_OK;
+        }
+    };
+}
@@ -0,0 +1,248 @@
+// <copyright file="MockStream.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <objidl.h>
+
+namespace BigDriveClientTest
+{
+    /// <summary>
+    /// Read-only stand-in for the IStream a provider returns from IBigDriveFileData::GetFileData.
+    /// Produces a file of any size without holding it, every byte a function of its position, and
+    /// can simulate provider throughput and fail at a given offset. Aggregates the free-threaded
+    /// marshaler so it can be read from any apartment, as a provider proxy can.
+    /// </summary>
+    class MockStream : public IStream
+    {
+    private:
+
+        volatile LONG m_refCount;
+        IUnknown* m_pMarshaler;
+
+    public:
+
+        /// <summary>
+        /// Size of the file.
+        /// </summary>
+        ULONGLONG size;
+
+        /// <summary>
+        /// Current position. Updated atomically so a test can watch it from another thread.
+        /// </summary>
+        volatile LONGLONG position;
+
+        /// <summary>
+        /// Microseconds each megabyte read spins for, to simulate a provider. Zero for none.
+        /// </summary>
+        ULONG microsecondsPerMegabyte;
+
+        /// <summary>
+        /// FALSE to skip writing the pattern, for benchmarks that don't check the bytes.
+        /// </summary>
+        BOOL fillPattern;
+
+        /// <summary>
+        /// Offset at which Read starts failing with failWith; ULLONG_MAX for never.
+        /// </summary>
+        ULONGLONG failAt;
+
+        /// <summary>
+        /// HRESULT returned by Read at and past failAt.
+        /// </summary>
+        HRESULT failWith;
+
+        /// <summary>
+        /// Number of Read and Seek calls.
+        /// </summary>
+        volatile LONG readCount;
+        volatile LONG seekCount;
+
+        /// <summary>
+        /// Largest number of bytes asked for in one Read.
+        /// </summary>
+        ULONG largestRead;
+
+        MockStream(ULONGLONG cbSize)
+            : m_refCount(1), m_pMarshaler(nullptr), size(cbSize), position(0), microsecondsPerMegabyte(0), fillPattern(TRUE),
+            failAt(ULLONG_MAX), failWith(E_FAIL), readCount(0), seekCount(0), largestRead(0)
+        {
+            ::CoCreateFreeThreadedMarshaler(static_cast<IStream*>(this), &m_pMarshaler);
+        }
+
+        virtual ~MockStream()
+        {
+            if (m_pMarshaler)
+            {
+                m_pMarshaler->Release();
+                m_pMarshaler = nullptr;
+            }
+        }
+
+        /// <summary>
+        /// The byte at a position.
+        /// </summary>
+        static BYTE ExpectedByte(ULONGLONG offset)
+        {
+            return static_cast<BYTE>(offset + (offset >> 12) * 31);
+        }
+
+        // IUnknown methods
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+        {
+            if (ppvObject == nullptr)
+            {
+                return E_POINTER;
+            }
+
+            if ((riid == IID_IUnknown) || (riid == IID_ISequentialStream) || (riid == IID_IStream))
+            {
+                *ppvObject = static_cast<IStream*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            if ((riid == IID_IMarshal) && m_pMarshaler)
+            {
+                return m_pMarshaler->QueryInterface(riid, ppvObject);
+            }
+
+            *ppvObject = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ::InterlockedIncrement(&m_refCount);
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            ULONG res = ::InterlockedDecrement(&m_refCount);
+            if (res == 0) delete this;
+            return res;
+        }
+
+        // ISequentialStream methods
+        HRESULT STDMETHODCALLTYPE Read(void* pv, ULONG cb, ULONG* pcbRead) override
+        {
+            BYTE* pDest = static_cast<BYTE*>(pv);
+            ULONGLONG offset = static_cast<ULONGLONG>(position);
+            ULONG cbRead = 0;
+
+            ::InterlockedIncrement(&readCount);
+
+            if (cb > largestRead)
+            {
+                largestRead = cb;
+            }
+
+            if (offset >= failAt)
+            {
+                if (pcbRead)
+                {
+                    *pcbRead = 0;
+                }
+
+                return failWith;
+            }
+
+            cbRead = (offset >= size) ? 0 : ((size - offset < cb) ? static_cast<ULONG>(size - offset) : cb);
+            if ((failAt != ULLONG_MAX) && (offset + cbRead > failAt))
+            {
+                cbRead = static_cast<ULONG>(failAt - offset);
+            }
+
+            if (fillPattern)
+            {
+                for (ULONG i = 0; i < cbRead; i++)
+                {
+                    pDest[i] = ExpectedByte(offset + i);
+                }
+            }
+
+            Spin(cbRead);
+
+            ::InterlockedExchange64(&position, static_cast<LONGLONG>(offset + cbRead));
+
+            if (pcbRead)
+            {
+                *pcbRead = cbRead;
+            }
+
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE Write(const void* pv, ULONG cb, ULONG* pcbWritten) override
+        {
+            return STG_E_ACCESSDENIED;
+        }
+
+        // IStream methods
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER dlibMove, DWORD dwOrigin, ULARGE_INTEGER* plibNewPosition) override
+        {
+            LONGLONG llBase = (dwOrigin == STREAM_SEEK_SET) ? 0 : ((dwOrigin == STREAM_SEEK_CUR) ? position : static_cast<LONGLONG>(size));
+
+            ::InterlockedIncrement(&seekCount);
+
+            if (llBase + dlibMove.QuadPart < 0)
+            {
+                return STG_E_INVALIDFUNCTION;
+            }
+
+            ::InterlockedExchange64(&position, llBase + dlibMove.QuadPart);
+
+            if (plibNewPosition)
+            {
+                plibNewPosition->QuadPart = static_cast<ULONGLONG>(position);
+            }
+
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER libNewSize) override { return STG_E_ACCESSDENIED; }
+        HRESULT STDMETHODCALLTYPE CopyTo(IStream* pstm, ULARGE_INTEGER cb, ULARGE_INTEGER* pcbRead, ULARGE_INTEGER* pcbWritten) override { return E_NOTIMPL; }
+        HRESULT STDMETHODCALLTYPE Commit(DWORD grfCommitFlags) override { return S_OK; }
+        HRESULT STDMETHODCALLTYPE Revert() override { return S_OK; }
+        HRESULT STDMETHODCALLTYPE LockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType) override { return STG_E_INVALIDFUNCTION; }
+        HRESULT STDMETHODCALLTYPE UnlockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType) override { return STG_E_INVALIDFUNCTION; }
+
+        HRESULT STDMETHODCALLTYPE Stat(STATSTG* pstatstg, DWORD grfStatFlag) override
+        {
+            ::ZeroMemory(pstatstg, sizeof(STATSTG));
+            pstatstg->type = STGTY_STREAM;
+            pstatstg->cbSize.QuadPart = size;
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE Clone(IStream** ppstm) override { return E_NOTIMPL; }
+
+        /// <summary>
+        /// Spins for the time the given number of bytes costs at the simulated throughput.
+        /// Sleep is too coarse for the per-chunk delays involved.
+        /// </summary>
+        void Spin(ULONG cb)
+        {
+            LARGE_INTEGER frequency, start, now;
+            LONGLONG ticks = 0;
+
+            if (microsecondsPerMegabyte == 0)
+            {
+                return;
+            }
+
+            ::QueryPerformanceFrequency(&frequency);
+            ::QueryPerformanceCounter(&start);
+
+            ticks = static_cast<LONGLONG>(cb) * microsecondsPerMegabyte * frequency.QuadPart / (1000000LL * 1024 * 1024);
+
+            do
+            {
+                ::QueryPerformanceCounter(&now);
+            } while (now.QuadPart - start.QuadPart < ticks);
+        }
+    };
+}
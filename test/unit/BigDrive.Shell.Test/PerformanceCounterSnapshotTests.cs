@@ -0,0 +1,117 @@
+// <copyright file="PerformanceCounterSnapshotTests.cs" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+namespace BigDrive.Shell.Test
+{
+    using System;
+    using System.Text;
+    using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+    /// <summary>
+    /// Tests for the PerformanceCounterSnapshot class.
+    /// </summary>
+    [TestClass]
+    public class PerformanceCounterSnapshotTests
+    {
+        /// <summary>
+        /// Tests that the header, counters and named provider calls are read at their offsets.
+        /// </summary>
+        [TestMethod]
+        public void Parse_ReadsCountersAndProviderCalls()
+        {
+            byte[] data = CreateBlock();
+            DateTime startTime = new DateTime(2026, 1, 2, 3, 4, 5, DateTimeKind.Utc);
+
+            WriteUInt32(data, 12, 1234);
+            WriteInt64(data, 16, startTime.ToFileTimeUtc());
+            WriteInt64(data, 64 + (12 * 8), 65536);
+            WriteProviderCall(data, 5, "IBigDriveFileInfo::GetFileSize", 42);
+
+            PerformanceCounterSnapshot snapshot = PerformanceCounterSnapshot.Parse(data);
+
+            Assert.IsNotNull(snapshot);
+            Assert.AreEqual(1234, snapshot.ProcessId);
+            Assert.AreEqual(startTime, snapshot.StartTime);
+            Assert.AreEqual(65536L, snapshot.Counters[12]);
+            Assert.AreEqual("Bytes streamed", PerformanceCounterSnapshot.CounterNames[12]);
+            Assert.AreEqual(1, snapshot.ProviderCalls.Count);
+            Assert.AreEqual(42L, snapshot.ProviderCalls["IBigDriveFileInfo::GetFileSize"]);
+        }
+
+        /// <summary>
+        /// Tests that a slot claimed but not yet named is skipped.
+        /// </summary>
+        [TestMethod]
+        public void Parse_UnnamedSlot_Skipped()
+        {
+            byte[] data = CreateBlock();
+
+            WriteProviderCall(data, 0, "IBigDriveEnumerate::EnumerateFolders", 7);
+            WriteUInt32(data, 320 + 4, 0);
+
+            PerformanceCounterSnapshot snapshot = PerformanceCounterSnapshot.Parse(data);
+
+            Assert.IsNotNull(snapshot);
+            Assert.AreEqual(0, snapshot.ProviderCalls.Count);
+        }
+
+        /// <summary>
+        /// Tests that a block of another layout is rejected.
+        /// </summary>
+        [TestMethod]
+        public void Parse_WrongVersion_ReturnsNull()
+        {
+            byte[] data = CreateBlock();
+
+            WriteUInt32(data, 4, 2);
+
+            Assert.IsNull(PerformanceCounterSnapshot.Parse(data));
+            Assert.IsNull(PerformanceCounterSnapshot.Parse(new byte[16]));
+        }
+
+        /// <summary>
+        /// Tests that levels have no rate and totals do.
+        /// </summary>
+        [TestMethod]
+        public void IsGauge_LevelsOnly()
+        {
+            Assert.IsTrue(PerformanceCounterSnapshot.IsGauge(1));
+            Assert.IsTrue(PerformanceCounterSnapshot.IsGauge(13));
+            Assert.IsFalse(PerformanceCounterSnapshot.IsGauge(0));
+            Assert.IsFalse(PerformanceCounterSnapshot.IsGauge(12));
+        }
+
+        private static byte[] CreateBlock()
+        {
+            byte[] data = new byte[PerformanceCounterSnapshot.BlockSize];
+
+            WriteUInt32(data, 0, PerformanceCounterSnapshot.Signature);
+            WriteUInt32(data, 4, PerformanceCounterSnapshot.Version);
+            WriteUInt32(data, 8, (uint)data.Length);
+            WriteUInt32(data, 24, (uint)PerformanceCounterSnapshot.CounterNames.Length);
+
+            return data;
+        }
+
+        private static void WriteProviderCall(byte[] data, int slot, string name, long calls)
+        {
+            int offset = 320 + (slot * 64);
+
+            WriteUInt32(data, offset, 0x1234);
+            WriteUInt32(data, offset + 4, 1);
+            Encoding.ASCII.GetBytes(name, 0, name.Length, data, offset + 8);
+            WriteInt64(data, offset + 56, calls);
+        }
+
+        private static void WriteUInt32(byte[] data, int offset, uint value)
+        {
+            Array.Copy(BitConverter.GetBytes(value), 0, data, offset, 4);
+        }
+
+        private static void WriteInt64(byte[] data, int offset, long value)
+        {
+            Array.Copy(BitConverter.GetBytes(value), 0, data, offset, 8);
+        }
+    }
+}
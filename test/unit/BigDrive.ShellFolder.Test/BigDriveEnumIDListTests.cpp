@@ -11,6 +11,9 @@
 #include <windows.h>
 #include "CppUnitTest.h"
 #include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveEnumIDListImports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveItemIdImports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\BigDriveItemType.h"
+#include "CountingMallocSpy.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -139,11 +142,11 @@ namespace BigDriveShellFolderTest
             LPITEMIDLIST pidl = (LPITEMIDLIST)CoTaskMemAlloc(32);
             Assert::IsNotNull(pidl, L"Failed to allocate PIDL.");
 
+            // The enumerator takes ownership of the PIDL
             HRESULT hr = BigDriveEnumIDList_Add(pEnum, pidl);
             Assert::AreEqual(S_OK, hr, L"Add did not return S_OK.");
 
             BigDriveEnumIDList_Release(pEnum);
-            CoTaskMemFree(pidl);
         }
 
         /// <summary>
@@ -175,10 +178,8 @@ namespace BigDriveShellFolderTest
             HRESULT hr = BigDriveEnumIDList_Add(pEnum, pidl4);
             Assert::AreEqual(S_OK, hr, L"Add after capacity did not return S_OK.");
 
-            // Clean up
+            // Clean up; the enumerator owns the added PIDLs
             delete pEnum;
-            for (int i = 0; i < 3; ++i) CoTaskMemFree(pidls[i]);
-            CoTaskMemFree(pidl4);
         }
 
         /// <summary>
@@ -197,7 +198,6 @@ namespace BigDriveShellFolderTest
             Assert::AreEqual(S_OK, hr, L"Add did not return S_OK for zero-capacity list.");
 
             delete pEnum;
-            CoTaskMemFree(pidl);
         }
 
         /// <summary>
@@ -210,5 +210,212 @@ namespace BigDriveShellFolderTest
             // No need to add PIDLs; just ensure no crash on delete
             delete pEnum;
         }
+
+        /// <summary>
+        /// Tests that items added with AddItem come back from Next as BigDrive item IDs with their
+        /// name and metadata, and that Next hands out copies the caller owns.
+        /// </summary>
+        TEST_METHOD(AddItem_NextReturnsEncodedCopies)
+        {
+            // Arrange
+            BigDriveEnumIDList* pEnum = CreateBigDriveEnumIDList();
+            BigDriveItemMetadata metadata = { 0 };
+            LPITEMIDLIST fetched[3] = {};
+            ULONG fetchedCount = 0;
+            BigDriveItemIdView view;
+
+            metadata.dwFields = BigDriveItemField_Size;
+            metadata.ullSize = 4096;
+
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_AddItem(pEnum, BigDriveItemType_Folder, L"Docs", 4, nullptr));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_AddItem(pEnum, BigDriveItemType_File, L"Report.docx", 11, &metadata));
+
+            // Act
+            HRESULT hr = BigDriveEnumIDList_Next(pEnum, 3, fetched, &fetchedCount);
+
+            // Assert
+            Assert::AreEqual(S_FALSE, hr);
+            Assert::AreEqual(2UL, fetchedCount);
+            Assert::AreEqual(1U, ::ILGetCount(fetched[0]));
+
+            Assert::AreEqual(S_OK, DecodeBigDriveItemIdExport(reinterpret_cast<const BYTE*>(fetched[0]), &view));
+            Assert::AreEqual((UINT)BigDriveItemType_Folder, view.uType);
+            Assert::AreEqual(L"Docs", view.szName);
+
+            Assert::AreEqual(S_OK, DecodeBigDriveItemIdExport(reinterpret_cast<const BYTE*>(fetched[1]), &view));
+            Assert::AreEqual((UINT)BigDriveItemType_File, view.uType);
+            Assert::AreEqual(L"Report.docx", view.szName);
+            Assert::AreEqual(4096ULL, view.metadata.ullSize);
+
+            // Cleanup; the fetched PIDLs outlive the enumerator
+            BigDriveEnumIDList_Release(pEnum);
+            ::ILFree(fetched[0]);
+            ::ILFree(fetched[1]);
+        }
+
+        /// <summary>
+        /// Tests that a clone shares the items but keeps its own position, and that adding to the
+        /// original after cloning does not change what the clone enumerates.
+        /// </summary>
+        TEST_METHOD(Clone_SharesItemsWithIndependentPosition)
+        {
+            // Arrange
+            BigDriveEnumIDList* pEnum = CreateBigDriveEnumIDList();
+            IEnumIDList* pClone = nullptr;
+            LPITEMIDLIST pidl = nullptr;
+            ULONG fetchedCount = 0;
+            BigDriveItemIdView view;
+
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_AddItem(pEnum, BigDriveItemType_File, L"a.txt", 5, nullptr));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_AddItem(pEnum, BigDriveItemType_File, L"b.txt", 5, nullptr));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Skip(pEnum, 1));
+
+            // Act
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Clone(pEnum, &pClone));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_AddItem(pEnum, BigDriveItemType_File, L"c.txt", 5, nullptr));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Reset(pEnum));
+
+            // Assert: the clone starts where the original was and stops at the items it was cloned with
+            Assert::AreEqual(S_OK, pClone->Next(1, &pidl, &fetchedCount));
+            Assert::AreEqual(S_OK, DecodeBigDriveItemIdExport(reinterpret_cast<const BYTE*>(pidl), &view));
+            Assert::AreEqual(L"b.txt", view.szName);
+            ::ILFree(pidl);
+            pidl = nullptr;
+
+            Assert::AreEqual(S_FALSE, pClone->Next(1, &pidl, &fetchedCount));
+            Assert::AreEqual(0UL, fetchedCount);
+
+            // Assert: the original has all three items from the start
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Skip(pEnum, 2));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Next(pEnum, 1, &pidl, &fetchedCount));
+            Assert::AreEqual(S_OK, DecodeBigDriveItemIdExport(reinterpret_cast<const BYTE*>(pidl), &view));
+            Assert::AreEqual(L"c.txt", view.szName);
+            ::ILFree(pidl);
+
+            // Cleanup
+            pClone->Release();
+            BigDriveEnumIDList_Release(pEnum);
+        }
+
+        /// <summary>
+        /// Tests that skipping exactly the items left succeeds, that skipping past the end returns
+        /// S_FALSE, and that Next refuses more than one item without a count.
+        /// </summary>
+        TEST_METHOD(Skip_ToEndAndPastEnd)
+        {
+            // Arrange
+            BigDriveEnumIDList* pEnum = CreateBigDriveEnumIDList();
+            LPITEMIDLIST rgpidl[2] = {};
+
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_AddItem(pEnum, BigDriveItemType_File, L"a.txt", 5, nullptr));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_AddItem(pEnum, BigDriveItemType_File, L"b.txt", 5, nullptr));
+
+            // Act & Assert
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Skip(pEnum, 2));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Reset(pEnum));
+            Assert::AreEqual(S_FALSE, BigDriveEnumIDList_Skip(pEnum, 3));
+            Assert::AreEqual(S_OK, BigDriveEnumIDList_Reset(pEnum));
+            Assert::AreEqual(E_POINTER, BigDriveEnumIDList_Next(pEnum, 2, rgpidl, nullptr));
+            Assert::IsNull(rgpidl[0]);
+
+            // Cleanup
+            BigDriveEnumIDList_Release(pEnum);
+        }
+
+        /// <summary>
+        /// Benchmark: builds a 100,000 item enumerator the way EnumObjects used to (a PIDL allocated per
+        /// item, then added) and with AddItem, clones and drains each, and reports the number of COM task
+        /// allocator calls, counted with an IMallocSpy.
+        /// </summary>
+        TEST_METHOD(Benchmark_AllocationCount)
+        {
+            // Arrange
+            const ULONG itemCount = 100000;
+            CountingMallocSpy spy;
+            BigDriveItemMetadata metadata = { 0 };
+            BigDriveEnumIDList* pEnumPidl = nullptr;
+            BigDriveEnumIDList* pEnumItem = nullptr;
+            IEnumIDList* pClone = nullptr;
+            LPITEMIDLIST pidl = nullptr;
+            LARGE_INTEGER frequency, start, end;
+            LONG pidlBuildAllocs = 0, itemBuildAllocs = 0, cloneAllocs = 0, drainAllocs = 0;
+            ULONG fetchedCount = 0, drained = 0;
+            wchar_t szName[32];
+            wchar_t message[256];
+
+            metadata.dwFields = BigDriveItemField_Size | BigDriveItemField_LastWriteTime;
+            ::QueryPerformanceFrequency(&frequency);
+
+            Assert::AreEqual(S_OK, ::CoRegisterMallocSpy(&spy), L"Could not register the malloc spy.");
+
+            // Act: a PIDL allocated per item and handed to Add
+            pEnumPidl = CreateBigDriveEnumIDListWithCapacity(itemCount);
+            spy.allocCount = spy.reallocCount = 0;
+            ::QueryPerformanceCounter(&start);
+
+            for (ULONG i = 0; i < itemCount; i++)
+            {
+                ::swprintf_s(szName, L"\\File %06u.txt", i);
+                BSTR bstrName = ::SysAllocString(szName);
+                metadata.ullSize = i;
+                AllocBigDrivePidlWithMetadataExport(BigDriveItemType_File, bstrName, &metadata, &pidl);
+                BigDriveEnumIDList_Add(pEnumPidl, pidl);
+                pidl = nullptr;
+                ::SysFreeString(bstrName);
+            }
+
+            ::QueryPerformanceCounter(&end);
+            pidlBuildAllocs = spy.allocCount + spy.reallocCount;
+            double pidlBuildMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+            // Act: encoded straight into the snapshot
+            pEnumItem = CreateBigDriveEnumIDListWithCapacity(itemCount);
+            spy.allocCount = spy.reallocCount = 0;
+            ::QueryPerformanceCounter(&start);
+
+            for (ULONG i = 0; i < itemCount; i++)
+            {
+                int cchName = ::swprintf_s(szName, L"File %06u.txt", i);
+                metadata.ullSize = i;
+                BigDriveEnumIDList_AddItem(pEnumItem, BigDriveItemType_File, szName, cchName, &metadata);
+            }
+
+            ::QueryPerformanceCounter(&end);
+            itemBuildAllocs = spy.allocCount + spy.reallocCount;
+            double itemBuildMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+            // Act: clone, then drain the clone
+            spy.allocCount = spy.reallocCount = 0;
+            BigDriveEnumIDList_Clone(pEnumItem, &pClone);
+            cloneAllocs = spy.allocCount + spy.reallocCount;
+
+            spy.allocCount = spy.reallocCount = 0;
+            while (pClone->Next(1, &pidl, &fetchedCount) == S_OK)
+            {
+                ::ILFree(pidl);
+                drained++;
+            }
+            drainAllocs = spy.allocCount + spy.reallocCount;
+
+            ::CoRevokeMallocSpy();
+
+            ::swprintf_s(message, L"%u items: PIDL per item %ld allocations (%.2f ms), AddItem %ld allocations (%.2f ms)\n",
+                itemCount, pidlBuildAllocs, pidlBuildMs, itemBuildAllocs, itemBuildMs);
+            Logger::WriteMessage(message);
+            ::swprintf_s(message, L"Clone %ld allocations, Next %ld allocations for %u items\n", cloneAllocs, drainAllocs, drained);
+            Logger::WriteMessage(message);
+
+            // Assert: building is a handful of block growths, Clone does not copy, Next allocates only what it hands out
+            Assert::IsTrue(pidlBuildAllocs >= (LONG)itemCount, L"Expected at least one allocation per PIDL.");
+            Assert::IsTrue(itemBuildAllocs < 64, L"AddItem should not allocate per item.");
+            Assert::IsTrue(cloneAllocs <= 1, L"Clone should not copy the items.");
+            Assert::AreEqual(itemCount, drained);
+            Assert::AreEqual((LONG)itemCount, drainAllocs);
+
+            // Cleanup
+            pClone->Release();
+            BigDriveEnumIDList_Release(pEnumItem);
+            BigDriveEnumIDList_Release(pEnumPidl);
+        }
     };
 }
\ No newline at end of file
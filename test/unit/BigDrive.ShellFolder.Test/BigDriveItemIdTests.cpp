@@ -0,0 +1,301 @@
+// <copyright file="BigDriveItemIdTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+#include <windows.h>
+#include <shlobj.h>
+
+#include "CppUnitTest.h"
+
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveItemIdExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\BigDriveItemType.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveShellFolderTest
+{
+	/// <summary>
+	/// Unit tests for the versioned, metadata-carrying BIGDRIVE_ITEMID format.
+	/// </summary>
+	TEST_CLASS(BigDriveItemIdTests)
+	{
+	public:
+
+		BigDriveItemIdTests()
+		{
+			::EnableMemoryLeakChecks();
+		}
+
+		/// <summary>
+		/// Tests that an item with metadata decodes to the same type, name and metadata.
+		/// </summary>
+		TEST_METHOD(EncodeDecode_WithMetadata_RoundTrips)
+		{
+			// Arrange
+			BYTE buffer[256] = { 0 };
+			USHORT cbItem = 0;
+			BigDriveItemIdView view;
+			BigDriveItemMetadata metadata = CreateMetadata();
+
+			// Act
+			HRESULT hrEncode = EncodeBigDriveItemIdExport(buffer, sizeof(buffer), BigDriveItemType_File, L"Report.docx", 11, &metadata, &cbItem);
+			HRESULT hrDecode = DecodeBigDriveItemIdExport(buffer, &view);
+
+			// Assert
+			Assert::AreEqual(S_OK, hrEncode);
+			Assert::AreEqual(S_OK, hrDecode);
+			Assert::AreEqual((UINT)BigDriveItemType_File, view.uType);
+			Assert::AreEqual(L"Report.docx", view.szName);
+			Assert::AreEqual((size_t)11, view.cchName);
+			Assert::AreEqual((USHORT)BIGDRIVE_ITEMID_VERSION, view.wVersion);
+			Assert::AreEqual(metadata.dwFields, view.metadata.dwFields);
+			Assert::AreEqual(metadata.dwAttributes, view.metadata.dwAttributes);
+			Assert::AreEqual(metadata.ullSize, view.metadata.ullSize);
+			Assert::AreEqual(metadata.ftLastWrite.dwLowDateTime, view.metadata.ftLastWrite.dwLowDateTime);
+			Assert::AreEqual(metadata.ftLastWrite.dwHighDateTime, view.metadata.ftLastWrite.dwHighDateTime);
+			Assert::AreEqual(metadata.ullChangeToken, view.metadata.ullChangeToken);
+		}
+
+		/// <summary>
+		/// Tests that a folder carrying only the provider's no-children hint keeps the hint, which has no value of its own.
+		/// </summary>
+		TEST_METHOD(EncodeDecode_ChildrenHintOnly_RoundTrips)
+		{
+			// Arrange
+			BYTE buffer[256] = { 0 };
+			USHORT cbItem = 0;
+			BigDriveItemIdView view;
+			BigDriveItemMetadata metadata = { 0 };
+
+			metadata.dwFields = BigDriveItemField_NoChildren;
+
+			// Act
+			HRESULT hrEncode = EncodeBigDriveItemIdExport(buffer, sizeof(buffer), BigDriveItemType_Folder, L"Empty", 5, &metadata, &cbItem);
+			HRESULT hrDecode = DecodeBigDriveItemIdExport(buffer, &view);
+
+			// Assert
+			Assert::AreEqual(S_OK, hrEncode);
+			Assert::AreEqual(S_OK, hrDecode);
+			Assert::AreEqual((UINT)BigDriveItemType_Folder, view.uType);
+			Assert::AreEqual((DWORD)BigDriveItemField_NoChildren, view.metadata.dwFields);
+		}
+
+		/// <summary>
+		/// Tests that items written before the metadata block existed still decode, as version zero with no metadata.
+		/// </summary>
+		TEST_METHOD(Decode_LegacyItem_DecodesWithoutMetadata)
+		{
+			// Arrange: [USHORT cb][UINT uType][WCHAR szName[] + null], as written by earlier builds
+			BYTE buffer[64] = { 0 };
+			const WCHAR szName[] = L"Legacy.txt";
+			USHORT cb = (USHORT)(sizeof(USHORT) + sizeof(UINT) + sizeof(szName));
+			UINT uType = BigDriveItemType_File;
+			BigDriveItemIdView view;
+
+			::CopyMemory(buffer, &cb, sizeof(cb));
+			::CopyMemory(buffer + sizeof(USHORT), &uType, sizeof(uType));
+			::CopyMemory(buffer + sizeof(USHORT) + sizeof(UINT), szName, sizeof(szName));
+
+			// Act
+			HRESULT hr = DecodeBigDriveItemIdExport(buffer, &view);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::AreEqual(L"Legacy.txt", view.szName);
+			Assert::AreEqual((USHORT)0, view.wVersion);
+			Assert::AreEqual((DWORD)BigDriveItemField_None, view.metadata.dwFields);
+			Assert::IsTrue(IsValidBigDriveItemIdExport(reinterpret_cast<PCUIDLIST_RELATIVE>(buffer)) == TRUE);
+		}
+
+		/// <summary>
+		/// Tests that an item without metadata still carries the signed block, with no fields.
+		/// </summary>
+		TEST_METHOD(EncodeDecode_WithoutMetadata_CarriesBlock)
+		{
+			// Arrange
+			BYTE buffer[256] = { 0 };
+			USHORT cbItem = 0;
+			BigDriveItemIdView view;
+
+			// Act
+			HRESULT hrEncode = EncodeBigDriveItemIdExport(buffer, sizeof(buffer), BigDriveItemType_Folder, L"Docs", 4, nullptr, &cbItem);
+			HRESULT hrDecode = DecodeBigDriveItemIdExport(buffer, &view);
+
+			// Assert
+			Assert::AreEqual(S_OK, hrEncode);
+			Assert::AreEqual(S_OK, hrDecode);
+			Assert::AreEqual((USHORT)BIGDRIVE_ITEMID_VERSION, view.wVersion);
+			Assert::AreEqual((DWORD)BigDriveItemField_None, view.metadata.dwFields);
+			Assert::AreEqual(L"Docs", view.szName);
+		}
+
+		/// <summary>
+		/// Tests that an item with no block is rejected unless it ends right after the name's terminator,
+		/// so a foreign item that merely ends in a zero USHORT isn't taken for a legacy item.
+		/// </summary>
+		TEST_METHOD(Decode_LegacyItemWithTrailingBytes_Rejected)
+		{
+			// Arrange: a legacy item followed by four more zero bytes
+			BYTE buffer[64] = { 0 };
+			const WCHAR szName[] = L"Legacy.txt";
+			USHORT cb = (USHORT)(sizeof(USHORT) + sizeof(UINT) + sizeof(szName) + 4);
+			UINT uType = BigDriveItemType_File;
+			BigDriveItemIdView view;
+
+			::CopyMemory(buffer, &cb, sizeof(cb));
+			::CopyMemory(buffer + sizeof(USHORT), &uType, sizeof(uType));
+			::CopyMemory(buffer + sizeof(USHORT) + sizeof(UINT), szName, sizeof(szName));
+
+			// Act
+			HRESULT hr = DecodeBigDriveItemIdExport(buffer, &view);
+
+			// Assert
+			Assert::AreEqual(E_INVALIDARG, hr);
+			Assert::IsTrue(IsValidBigDriveItemIdExport(reinterpret_cast<PCUIDLIST_RELATIVE>(buffer)) == FALSE);
+		}
+
+		/// <summary>
+		/// Tests that a trailing block offset pointing at something other than a metadata block is rejected.
+		/// </summary>
+		TEST_METHOD(Decode_BadSignature_Rejected)
+		{
+			// Arrange
+			BYTE buffer[256] = { 0 };
+			USHORT cbItem = 0;
+			BigDriveItemIdView view;
+			BigDriveItemMetadata metadata = CreateMetadata();
+
+			EncodeBigDriveItemIdExport(buffer, sizeof(buffer), BigDriveItemType_File, L"a.bin", 5, &metadata, &cbItem);
+
+			// The block follows the name: 2 + 4 + (5 + 1) * 2 = 18
+			buffer[18] ^= 0xFF;
+
+			// Act
+			HRESULT hr = DecodeBigDriveItemIdExport(buffer, &view);
+
+			// Assert
+			Assert::AreEqual(E_INVALIDARG, hr);
+			Assert::IsTrue(IsValidBigDriveItemIdExport(reinterpret_cast<PCUIDLIST_RELATIVE>(buffer)) == FALSE);
+		}
+
+		/// <summary>
+		/// Tests that encoding into a buffer that is too small fails without writing a partial item.
+		/// </summary>
+		TEST_METHOD(Encode_BufferTooSmall_Fails)
+		{
+			// Arrange
+			BYTE buffer[16] = { 0 };
+			USHORT cbItem = 0;
+			BigDriveItemMetadata metadata = CreateMetadata();
+
+			// Act
+			HRESULT hr = EncodeBigDriveItemIdExport(buffer, sizeof(buffer), BigDriveItemType_File, L"Report.docx", 11, &metadata, &cbItem);
+
+			// Assert
+			Assert::AreEqual(E_NOT_SUFFICIENT_BUFFER, hr);
+			Assert::AreEqual((USHORT)0, cbItem);
+		}
+
+		/// <summary>
+		/// Tests that AllocBigDrivePidl puts the metadata on the last item only, and that
+		/// the name and path readers still work on the extended items.
+		/// </summary>
+		TEST_METHOD(AllocBigDrivePidl_WithMetadata_LastItemCarriesMetadata)
+		{
+			// Arrange
+			LPITEMIDLIST pidl = nullptr;
+			BSTR bstrPath = ::SysAllocString(L"\\Folder\\Report.docx");
+			BSTR bstrProviderPath = nullptr;
+			BigDriveItemMetadata metadata = CreateMetadata();
+			BigDriveItemIdView viewFirst;
+			BigDriveItemIdView viewLast;
+			STRRET strret = {};
+
+			// Act
+			HRESULT hr = AllocBigDrivePidlWithMetadataExport(BigDriveItemType_File, bstrPath, &metadata, &pidl);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::AreEqual(2U, ::ILGetCount(pidl));
+
+			Assert::AreEqual(S_OK, DecodeBigDriveItemIdExport(reinterpret_cast<const BYTE*>(pidl), &viewFirst));
+			Assert::AreEqual((UINT)BigDriveItemType_Folder, viewFirst.uType);
+			Assert::AreEqual((DWORD)BigDriveItemField_None, viewFirst.metadata.dwFields);
+
+			Assert::AreEqual(S_OK, DecodeBigDriveItemIdExport(reinterpret_cast<const BYTE*>(::ILFindLastID(pidl)), &viewLast));
+			Assert::AreEqual((UINT)BigDriveItemType_File, viewLast.uType);
+			Assert::AreEqual(metadata.ullSize, viewLast.metadata.ullSize);
+
+			Assert::AreEqual(S_OK, GetBigDriveItemNameFromPidlExport(pidl, &strret));
+			Assert::AreEqual(L"Report.docx", strret.pOleStr);
+
+			Assert::AreEqual(S_OK, GetPathForProvidersExport(pidl, bstrProviderPath));
+			Assert::AreEqual(L"\\Folder\\Report.docx", bstrProviderPath);
+
+			// Cleanup
+			::CoTaskMemFree(strret.pOleStr);
+			::SysFreeString(bstrProviderPath);
+			::CoTaskMemFree(pidl);
+			::SysFreeString(bstrPath);
+		}
+
+		/// <summary>
+		/// Benchmark: encode and decode throughput of items with metadata.
+		/// </summary>
+		TEST_METHOD(Benchmark_EncodeDecode)
+		{
+			// Arrange
+			const int iterations = 1000000;
+			BYTE buffer[256] = { 0 };
+			USHORT cbItem = 0;
+			BigDriveItemIdView view;
+			BigDriveItemMetadata metadata = CreateMetadata();
+			LARGE_INTEGER frequency, start, middle, end;
+			ULONGLONG checksum = 0;
+			wchar_t message[256];
+
+			::QueryPerformanceFrequency(&frequency);
+
+			// Act
+			::QueryPerformanceCounter(&start);
+			for (int i = 0; i < iterations; i++)
+			{
+				metadata.ullSize = i;
+				EncodeBigDriveItemIdExport(buffer, sizeof(buffer), BigDriveItemType_File, L"Quarterly Report.docx", 21, &metadata, &cbItem);
+			}
+			::QueryPerformanceCounter(&middle);
+			for (int i = 0; i < iterations; i++)
+			{
+				DecodeBigDriveItemIdExport(buffer, &view);
+				checksum += view.metadata.ullSize;
+			}
+			::QueryPerformanceCounter(&end);
+
+			double encodeMs = (middle.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+			double decodeMs = (end.QuadPart - middle.QuadPart) * 1000.0 / frequency.QuadPart;
+			::swprintf_s(message, L"%d items (%u bytes each): encode %.2f ns/item, decode %.2f ns/item\n",
+				iterations, (UINT)cbItem, encodeMs * 1000000.0 / iterations, decodeMs * 1000000.0 / iterations);
+			Logger::WriteMessage(message);
+
+			// Assert
+			Assert::AreEqual((ULONGLONG)(iterations - 1) * iterations, checksum);
+		}
+
+	private:
+
+		static BigDriveItemMetadata CreateMetadata()
+		{
+			BigDriveItemMetadata metadata = { 0 };
+			metadata.dwFields = BigDriveItemField_Size | BigDriveItemField_LastWriteTime | BigDriveItemField_Attributes | BigDriveItemField_ChangeToken;
+			metadata.dwAttributes = FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_READONLY;
+			metadata.ullSize = 0x123456789AULL;
+			metadata.ftLastWrite.dwLowDateTime = 0xD53E8000;
+			metadata.ftLastWrite.dwHighDateTime = 0x01DA0000;
+			metadata.ullChangeToken = 0xFEEDFACECAFEBEEFULL;
+			return metadata;
+		}
+	};
+}
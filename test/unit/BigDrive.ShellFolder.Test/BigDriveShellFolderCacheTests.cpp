@@ -0,0 +1,328 @@
+// <copyright file="BigDriveShellFolderCacheTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+#include <windows.h>
+#include <shlobj.h>
+
+#include "CppUnitTest.h"
+
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderCacheExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderTraceLoggerExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\BigDriveItemType.h"
+#include "CountingMallocSpy.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveShellFolderTest
+{
+	const CLSID CacheTestDrive = { 0x7AC3D1E0, 0x0000, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08 } };
+
+	struct CacheApartmentContext
+	{
+		LPCITEMIDLIST pidlChild;
+		HRESULT hr;
+		IShellFolder* pChild;
+	};
+
+	/// <summary>
+	/// Binds to the child from a single-threaded apartment of its own, through a root folder of its own.
+	/// The child is kept only to compare it; it is released before the apartment ends.
+	/// </summary>
+	static DWORD WINAPI CacheApartmentThread(LPVOID pParameter)
+	{
+		CacheApartmentContext* pContext = static_cast<CacheApartmentContext*>(pParameter);
+		IShellFolder* pRoot = nullptr;
+		IShellFolder* pChild = nullptr;
+		HRESULT hrCoInit = ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+		pContext->hr = CreateBigDriveShellFolderExport(CacheTestDrive, nullptr, &pRoot);
+		if (SUCCEEDED(pContext->hr))
+		{
+			pContext->hr = pRoot->BindToObject(pContext->pidlChild, nullptr, IID_IShellFolder, reinterpret_cast<void**>(&pChild));
+			pContext->pChild = pChild;
+		}
+
+		if (pChild)
+		{
+			pChild->Release();
+		}
+
+		if (pRoot)
+		{
+			pRoot->Release();
+		}
+
+		if (SUCCEEDED(hrCoInit))
+		{
+			::CoUninitialize();
+		}
+
+		return 0;
+	}
+
+	/// <summary>
+	/// Unit tests for the reuse of live child folders by BindToObject.
+	/// </summary>
+	TEST_CLASS(BigDriveShellFolderCacheTests)
+	{
+	public:
+
+		BigDriveShellFolderCacheTests()
+		{
+			::EnableMemoryLeakChecks();
+		}
+
+		TEST_METHOD_INITIALIZE(Initialize)
+		{
+			// Folders are only reused within the single-threaded apartment that created them
+			m_hrCoInit = ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+			m_pRoot = nullptr;
+			m_pidlChild = nullptr;
+
+			BSTR bstrName = ::SysAllocString(L"Docs");
+			Assert::AreEqual(S_OK, CreateBigDriveShellFolderExport(CacheTestDrive, nullptr, &m_pRoot));
+			Assert::AreEqual(S_OK, AllocBigDrivePidlExport(BigDriveItemType_Folder, bstrName, &m_pidlChild));
+			::SysFreeString(bstrName);
+		}
+
+		TEST_METHOD_CLEANUP(Cleanup)
+		{
+			if (m_pidlChild)
+			{
+				::CoTaskMemFree(m_pidlChild);
+				m_pidlChild = nullptr;
+			}
+
+			if (m_pRoot)
+			{
+				m_pRoot->Release();
+				m_pRoot = nullptr;
+			}
+
+			if (SUCCEEDED(m_hrCoInit))
+			{
+				::CoUninitialize();
+			}
+		}
+
+		/// <summary>
+		/// Tests that a bind to a child that is still alive returns the same instance.
+		/// </summary>
+		TEST_METHOD(BindToObject_LiveFolder_ReturnsSameInstance)
+		{
+			// Arrange
+			IShellFolder* pFirst = nullptr;
+			IShellFolder* pSecond = nullptr;
+			LONG hitsBefore = 0, missesBefore = 0, hits = 0, misses = 0;
+
+			GetShellFolderCacheStatisticsExport(&hitsBefore, &missesBefore);
+
+			// Act
+			HRESULT hr1 = Bind(&pFirst);
+			HRESULT hr2 = Bind(&pSecond);
+			GetShellFolderCacheStatisticsExport(&hits, &misses);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr1);
+			Assert::AreEqual(S_OK, hr2);
+			Assert::IsTrue(pFirst == pSecond, L"The second bind should return the live folder.");
+			Assert::AreEqual(1L, hits - hitsBefore);
+			Assert::AreEqual(1L, misses - missesBefore);
+
+			// Cleanup
+			pSecond->Release();
+			pFirst->Release();
+		}
+
+		/// <summary>
+		/// Tests that the final Release takes the folder out of the cache, so the next bind creates a folder.
+		/// </summary>
+		TEST_METHOD(Release_FinalRelease_RemovesFromCache)
+		{
+			// Arrange
+			IShellFolder* pFolder = nullptr;
+			LONG hitsBefore = 0, missesBefore = 0, hits = 0, misses = 0;
+
+			Assert::AreEqual(S_OK, Bind(&pFolder));
+			GetShellFolderCacheStatisticsExport(&hitsBefore, &missesBefore);
+
+			// Act
+			pFolder->Release();
+			pFolder = nullptr;
+
+			HRESULT hr = Bind(&pFolder);
+			GetShellFolderCacheStatisticsExport(&hits, &misses);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::AreEqual(0L, hits - hitsBefore, L"A released folder should not be found.");
+			Assert::AreEqual(1L, misses - missesBefore);
+
+			// Cleanup
+			pFolder->Release();
+		}
+
+		/// <summary>
+		/// Tests that a bind made while a folder is in its final Release, after its count has reached zero and
+		/// before it has taken itself out of the cache, creates a new folder instead of reviving the dying one.
+		/// </summary>
+		TEST_METHOD(BindToObject_DuringFinalRelease_Misses)
+		{
+			// Arrange
+			IShellFolder* pDying = nullptr;
+			IShellFolder* pNew = nullptr;
+			IShellFolder* pAgain = nullptr;
+
+			Assert::AreEqual(S_OK, Bind(&pDying));
+
+			// Act
+			LONG refCount = BeginFinalReleaseExport(pDying);
+			HRESULT hrDuring = Bind(&pNew);
+			EndFinalReleaseExport(pDying);
+			HRESULT hrAfter = Bind(&pAgain);
+
+			// Assert
+			Assert::AreEqual(0L, refCount);
+			Assert::AreEqual(S_OK, hrDuring);
+			Assert::IsTrue(pNew != pDying, L"The dying folder should not be handed out.");
+			Assert::AreEqual(S_OK, hrAfter);
+			Assert::IsTrue(pAgain == pNew, L"The folder created during the final Release should be reused.");
+
+			// Cleanup
+			pAgain->Release();
+			pNew->Release();
+		}
+
+		/// <summary>
+		/// Tests that a folder is not handed to another apartment, which must not call it directly.
+		/// </summary>
+		TEST_METHOD(BindToObject_OtherApartment_GetsOwnFolder)
+		{
+			// Arrange
+			IShellFolder* pFolder = nullptr;
+			CacheApartmentContext context = { m_pidlChild, E_FAIL, nullptr };
+
+			Assert::AreEqual(S_OK, Bind(&pFolder));
+
+			// Act
+			HANDLE hThread = ::CreateThread(nullptr, 0, CacheApartmentThread, &context, 0, nullptr);
+			::WaitForSingleObject(hThread, INFINITE);
+			::CloseHandle(hThread);
+
+			// Assert
+			Assert::AreEqual(S_OK, context.hr);
+			Assert::IsNotNull(context.pChild);
+			Assert::IsTrue(context.pChild != pFolder, L"Another apartment should get a folder of its own.");
+
+			// Cleanup
+			pFolder->Release();
+		}
+
+		/// <summary>
+		/// Benchmark: measures the heap and COM task allocator allocations of a bind that creates the child
+		/// against one that finds it alive, and the time of each.
+		/// </summary>
+		TEST_METHOD(Benchmark_AllocationsPerBind)
+		{
+			// Arrange
+			const int iterations = 1000;
+			CountingMallocSpy spy;
+			IShellFolder* pHeld = nullptr;
+			IShellFolder* pFolder = nullptr;
+			LARGE_INTEGER frequency, start, end;
+			LONG createTaskAllocs = 0, createHeapAllocs = 0, hitTaskAllocs = 0, hitHeapAllocs = 0;
+			BOOL fHeapCounted = FALSE;
+			wchar_t message[256];
+
+			if (IsTraceEnabledExport())
+			{
+				Logger::WriteMessage(L"A trace session is listening and tracing allocates; skipped.\n");
+				return;
+			}
+
+			::QueryPerformanceFrequency(&frequency);
+			Assert::AreEqual(S_OK, ::CoRegisterMallocSpy(&spy), L"Could not register the malloc spy.");
+
+			// Act: nothing holds the child between binds, so each bind creates it
+			spy.allocCount = spy.reallocCount = 0;
+			fHeapCounted = StartHeapAllocationCountExport();
+			::QueryPerformanceCounter(&start);
+
+			for (int i = 0; i < iterations; i++)
+			{
+				Bind(&pFolder);
+				pFolder->Release();
+				pFolder = nullptr;
+			}
+
+			::QueryPerformanceCounter(&end);
+			createHeapAllocs = StopHeapAllocationCountExport();
+			createTaskAllocs = spy.allocCount + spy.reallocCount;
+			double createUs = (end.QuadPart - start.QuadPart) * 1000000.0 / frequency.QuadPart / iterations;
+
+			// Act: the child is held, as the view holds it while Explorer binds again
+			Bind(&pHeld);
+			spy.allocCount = spy.reallocCount = 0;
+			StartHeapAllocationCountExport();
+			::QueryPerformanceCounter(&start);
+
+			for (int i = 0; i < iterations; i++)
+			{
+				Bind(&pFolder);
+				pFolder->Release();
+				pFolder = nullptr;
+			}
+
+			::QueryPerformanceCounter(&end);
+			hitHeapAllocs = StopHeapAllocationCountExport();
+			hitTaskAllocs = spy.allocCount + spy.reallocCount;
+			double hitUs = (end.QuadPart - start.QuadPart) * 1000000.0 / frequency.QuadPart / iterations;
+
+			::CoRevokeMallocSpy();
+
+			::swprintf_s(message, L"Per bind, created: %.2f task allocator and %.2f heap allocations, %.2f us\n",
+				static_cast<double>(createTaskAllocs) / iterations, static_cast<double>(createHeapAllocs) / iterations, createUs);
+			Logger::WriteMessage(message);
+			::swprintf_s(message, L"Per bind, reused: %.2f task allocator and %.2f heap allocations, %.2f us\n",
+				static_cast<double>(hitTaskAllocs) / iterations, static_cast<double>(hitHeapAllocs) / iterations, hitUs);
+			Logger::WriteMessage(message);
+
+			if (!fHeapCounted)
+			{
+				Logger::WriteMessage(L"Heap allocations are only counted in debug builds.\n");
+			}
+
+			// Assert: creating allocates at least the combined and cloned PIDLs; reusing allocates nothing
+			Assert::IsTrue(createTaskAllocs >= 2 * iterations, L"Expected ILCombine and ILClone per created folder.");
+			Assert::AreEqual(0L, hitTaskAllocs, L"A reused bind should not allocate PIDLs.");
+
+			if (fHeapCounted)
+			{
+				Assert::IsTrue(createHeapAllocs >= iterations, L"Expected the folder object per created folder.");
+				Assert::AreEqual(0L, hitHeapAllocs, L"A reused bind should not allocate from the heap.");
+			}
+
+			// Cleanup
+			pHeld->Release();
+		}
+
+	private:
+
+		/// <summary>
+		/// Binds the root folder to the child.
+		/// </summary>
+		HRESULT Bind(IShellFolder** ppFolder)
+		{
+			return m_pRoot->BindToObject(m_pidlChild, nullptr, IID_IShellFolder, reinterpret_cast<void**>(ppFolder));
+		}
+
+		HRESULT m_hrCoInit = S_OK;
+		IShellFolder* m_pRoot = nullptr;
+		LPITEMIDLIST m_pidlChild = nullptr;
+	};
+}
@@ -0,0 +1,206 @@
+// <copyright file="BigDriveShellFolderTraceLoggerTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+#include <windows.h>
+#include <shlobj.h>
+#include <propkey.h>
+
+#include "CppUnitTest.h"
+
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderTraceLoggerExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\BigDriveItemType.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveShellFolderTest
+{
+	const CLSID TraceTestDrive = { 0x7AC3D1E0, 0x0000, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x19 } };
+
+	/// <summary>
+	/// Unit tests for shell folder tracing: its cost when no session is listening, span timing, and latency histograms.
+	/// </summary>
+	TEST_CLASS(BigDriveShellFolderTraceLoggerTests)
+	{
+	public:
+
+		BigDriveShellFolderTraceLoggerTests()
+		{
+			::EnableMemoryLeakChecks();
+		}
+
+		TEST_METHOD_CLEANUP(DisableHistograms)
+		{
+			EnableLatencyHistogramsExport(FALSE);
+			ResetLatencyHistogramsExport();
+		}
+
+		/// <summary>
+		/// Tests that a nested call doesn't overwrite the start time of the call around it.
+		/// </summary>
+		TEST_METHOD(NestedSpans_KeepOwnDurations)
+		{
+			// Arrange
+			BigDriveLatencySummary outer = { 0 };
+			BigDriveLatencySummary inner = { 0 };
+
+			EnableLatencyHistogramsExport(TRUE);
+			ResetLatencyHistogramsExport();
+
+			// Act
+			TraceEnterExport("NestedSpans::Outer");
+			::Sleep(30);
+			TraceEnterExport("NestedSpans::Inner");
+			::Sleep(10);
+			TraceExitExport("NestedSpans::Inner", S_OK);
+			TraceExitExport("NestedSpans::Outer", S_OK);
+
+			// Assert
+			Assert::AreEqual(S_OK, GetLatencySummaryExport("NestedSpans::Outer", &outer));
+			Assert::AreEqual(S_OK, GetLatencySummaryExport("NestedSpans::Inner", &inner));
+			Assert::AreEqual(1LL, outer.count);
+			Assert::AreEqual(1LL, inner.count);
+			Assert::IsTrue(outer.maxMilliseconds >= 35.0);
+			Assert::IsTrue(inner.maxMilliseconds >= 5.0);
+			Assert::IsTrue(inner.maxMilliseconds < outer.maxMilliseconds);
+		}
+
+		/// <summary>
+		/// Tests that time spent in provider calls is counted against the shell method that made them.
+		/// </summary>
+		TEST_METHOD(ProviderSpans_RollUpIntoShellMethod)
+		{
+			// Arrange
+			BigDriveLatencySummary method = { 0 };
+			BigDriveLatencySummary provider = { 0 };
+
+			EnableLatencyHistogramsExport(TRUE);
+			ResetLatencyHistogramsExport();
+
+			// Act
+			TraceEnterExport("ProviderSpans::GetDetailsEx");
+			TraceProviderEnterExport("ProviderSpans::GetFileSize");
+			::Sleep(20);
+			TraceProviderExitExport("ProviderSpans::GetFileSize", S_OK);
+			::Sleep(10);
+			TraceExitExport("ProviderSpans::GetDetailsEx", S_OK);
+
+			// Assert
+			Assert::AreEqual(S_OK, GetLatencySummaryExport("ProviderSpans::GetDetailsEx", &method));
+			Assert::AreEqual(S_OK, GetLatencySummaryExport("ProviderSpans::GetFileSize", &provider));
+			Assert::AreEqual((int)BigDriveSpanKind_ShellMethod, (int)method.kind);
+			Assert::AreEqual((int)BigDriveSpanKind_ProviderCall, (int)provider.kind);
+			Assert::IsTrue(method.providerMeanMilliseconds >= 15.0);
+			Assert::IsTrue(method.providerMeanMilliseconds < method.meanMilliseconds);
+			Assert::AreEqual(provider.meanMilliseconds, provider.providerMeanMilliseconds);
+		}
+
+		/// <summary>
+		/// Tests that a span left open inside another is dropped when the outer one closes.
+		/// </summary>
+		TEST_METHOD(UnclosedSpan_DroppedByEnclosingExit)
+		{
+			// Arrange
+			BigDriveLatencySummary outer = { 0 };
+			BigDriveLatencySummary leaked = { 0 };
+
+			EnableLatencyHistogramsExport(TRUE);
+			ResetLatencyHistogramsExport();
+
+			// Act
+			TraceEnterExport("UnclosedSpan::Outer");
+			TraceEnterExport("UnclosedSpan::Leaked");
+			TraceExitExport("UnclosedSpan::Outer", S_OK);
+			TraceExitExport("UnclosedSpan::Leaked", S_OK);
+
+			// Assert
+			Assert::AreEqual(S_OK, GetLatencySummaryExport("UnclosedSpan::Outer", &outer));
+			Assert::AreEqual(1LL, outer.count);
+			Assert::AreEqual(S_FALSE, GetLatencySummaryExport("UnclosedSpan::Leaked", &leaked));
+		}
+
+		/// <summary>
+		/// Tests that percentiles are within the precision of the log-linear buckets.
+		/// </summary>
+		TEST_METHOD(Percentiles_WithinBucketPrecision)
+		{
+			// Arrange
+			BigDriveLatencySummary summary = { 0 };
+
+			ResetLatencyHistogramsExport();
+
+			// Act: 1 ms to 1000 ms
+			for (ULONGLONG i = 1; i <= 1000; i++)
+			{
+				RecordLatencyExport("Percentiles::Method", i * 1000);
+			}
+
+			// Assert
+			Assert::AreEqual(S_OK, GetLatencySummaryExport("Percentiles::Method", &summary));
+			Assert::AreEqual(1000LL, summary.count);
+			Assert::IsTrue((summary.p50Milliseconds >= 500.0) && (summary.p50Milliseconds <= 500.0 * 17 / 16));
+			Assert::IsTrue((summary.p90Milliseconds >= 900.0) && (summary.p90Milliseconds <= 900.0 * 17 / 16));
+			Assert::IsTrue((summary.p99Milliseconds >= 990.0) && (summary.p99Milliseconds <= 1000.0));
+			Assert::AreEqual(1000.0, summary.maxMilliseconds);
+			Assert::AreEqual(500.5, summary.meanMilliseconds);
+		}
+
+		/// <summary>
+		/// Benchmark: the tracing GetDetailsEx does per column of an item with no session listening,
+		/// formatting the path and FMTID name on every call as before, and checking the provider first.
+		/// </summary>
+		TEST_METHOD(Benchmark_GetDetailsExTracingOff)
+		{
+			// Arrange
+			const int iterations = 100000;
+			LPITEMIDLIST pidl = nullptr;
+			BSTR bstrName = ::SysAllocString(L"Quarterly Report.docx");
+			SHCOLUMNID scid = PKEY_Size;
+			LARGE_INTEGER frequency, start, middle, end;
+			wchar_t message[256];
+
+			EnableLatencyHistogramsExport(FALSE);
+
+			if (IsTraceEnabledExport())
+			{
+				::SysFreeString(bstrName);
+				Logger::WriteMessage(L"A trace session is listening; skipped.\n");
+				return;
+			}
+
+			Assert::AreEqual(S_OK, AllocBigDrivePidlExport(BigDriveItemType_File, bstrName, &pidl));
+			::QueryPerformanceFrequency(&frequency);
+
+			// Act: arguments formatted whether or not anyone is listening
+			::QueryPerformanceCounter(&start);
+			for (int i = 0; i < iterations; i++)
+			{
+				FormatGetDetailsExTraceExport(TraceTestDrive, pidl, &scid);
+			}
+			::QueryPerformanceCounter(&middle);
+
+			// Act: one check of the provider per entry and exit
+			for (int i = 0; i < iterations; i++)
+			{
+				TraceGetDetailsExExport(TraceTestDrive, pidl, &scid, S_OK);
+			}
+			::QueryPerformanceCounter(&end);
+
+			double formattedNs = (middle.QuadPart - start.QuadPart) * 1000000000.0 / frequency.QuadPart / iterations;
+			double checkedNs = (end.QuadPart - middle.QuadPart) * 1000000000.0 / frequency.QuadPart / iterations;
+			::swprintf_s(message, L"%d calls, tracing off: formatting %.2f ns/call, checking first %.2f ns/call\n",
+				iterations, formattedNs, checkedNs);
+			Logger::WriteMessage(message);
+
+			// Assert
+			Assert::IsTrue(checkedNs < formattedNs);
+
+			// Cleanup
+			::CoTaskMemFree(pidl);
+			::SysFreeString(bstrName);
+		}
+	};
+}
@@ -0,0 +1,588 @@
+// <copyright file="BigDriveTransferSourceTests.cpp" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#include "pch.h"
+
+#include <windows.h>
+#include <shlobj.h>
+#include <shobjidl.h>
+
+#include "CppUnitTest.h"
+
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\Exports\BigDriveShellFolderCacheExports.h"
+#include "..\..\..\src\BigDrive.ShellFolder\BigDriveItemType.h"
+#include "MockBigDriveProvider.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace BigDriveShellFolderTest
+{
+	const CLSID TransferTestDrive = { 0x7AC3D1E0, 0x0000, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x14 } };
+	const CLSID TransferTestProvider = { 0x7AC3D1E0, 0x0001, 0x4C00, { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x14 } };
+
+	/// <summary>
+	/// Unit tests for BindToStorage and for the moves, renames and deletes of the ITransferSource, against a
+	/// provider held in memory.
+	/// </summary>
+	TEST_CLASS(BigDriveTransferSourceTests)
+	{
+	public:
+
+		BigDriveTransferSourceTests()
+		{
+			::EnableMemoryLeakChecks();
+		}
+
+		TEST_CLASS_CLEANUP(ClassCleanup)
+		{
+			if (s_pProvider)
+			{
+				s_pProvider->Release();
+				s_pProvider = nullptr;
+			}
+		}
+
+		TEST_METHOD_INITIALIZE(Initialize)
+		{
+			ITEMIDLIST emptyPidl = {};
+
+			m_hrCoInit = ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+			m_pRoot = nullptr;
+			m_pTransferSource = nullptr;
+
+			// One provider for the class: the connection pool keeps the first it activates for the drive
+			if (s_pProvider == nullptr)
+			{
+				s_pProvider = new MockBigDriveProvider(TransferTestDrive, TransferTestProvider);
+			}
+
+			s_pProvider->Reset();
+			Assert::AreEqual(S_OK, s_pProvider->Register());
+
+			// Rooted at an empty PIDL, so the path of each child is "\" and its name
+			Assert::AreEqual(S_OK, CreateBigDriveShellFolderExport(TransferTestDrive, &emptyPidl, &m_pRoot));
+			Assert::AreEqual(S_OK, m_pRoot->CreateViewObject(nullptr, IID_ITransferSource, reinterpret_cast<void**>(&m_pTransferSource)));
+		}
+
+		TEST_METHOD_CLEANUP(Cleanup)
+		{
+			if (m_pTransferSource)
+			{
+				m_pTransferSource->Release();
+				m_pTransferSource = nullptr;
+			}
+
+			if (m_pRoot)
+			{
+				m_pRoot->Release();
+				m_pRoot = nullptr;
+			}
+
+			if (s_pProvider)
+			{
+				s_pProvider->Revoke();
+			}
+
+			if (SUCCEEDED(m_hrCoInit))
+			{
+				::CoUninitialize();
+			}
+		}
+
+		/// <summary>
+		/// Tests that BindToStorage opens a file as a stream of its bytes.
+		/// </summary>
+		TEST_METHOD(BindToStorage_File_ReturnsStream)
+		{
+			// Arrange
+			const ULONGLONG cbFile = 300000;
+			LPITEMIDLIST pidl = nullptr;
+			IStream* pStream = nullptr;
+			BYTE buffer[4096];
+			ULONG cbRead = 0;
+			ULONGLONG cbTotal = 0;
+			BOOL fMatches = TRUE;
+
+			s_pProvider->AddFile(L"\\a.txt", cbFile);
+			Assert::AreEqual(S_OK, AllocPidl(BigDriveItemType_File, L"a.txt", &pidl));
+
+			// Act
+			HRESULT hr = m_pRoot->BindToStorage(pidl, nullptr, IID_IStream, reinterpret_cast<void**>(&pStream));
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::IsNotNull(pStream);
+
+			while (SUCCEEDED(pStream->Read(buffer, sizeof(buffer), &cbRead)) && (cbRead > 0))
+			{
+				for (ULONG i = 0; i < cbRead; i++)
+				{
+					fMatches = fMatches && (buffer[i] == BigDriveClientTest::MockStream::ExpectedByte(cbTotal + i));
+				}
+
+				cbTotal += cbRead;
+			}
+
+			Assert::AreEqual(cbFile, cbTotal);
+			Assert::IsTrue(fMatches, L"The stream should return the provider's bytes.");
+
+			// Cleanup
+			pStream->Release();
+			::CoTaskMemFree(pidl);
+		}
+
+		/// <summary>
+		/// Tests that BindToStorage refuses a folder, which has no data.
+		/// </summary>
+		TEST_METHOD(BindToStorage_Folder_ReturnsInvalidArg)
+		{
+			// Arrange
+			LPITEMIDLIST pidl = nullptr;
+			IStream* pStream = nullptr;
+
+			s_pProvider->AddFolder(L"\\Docs");
+			Assert::AreEqual(S_OK, AllocPidl(BigDriveItemType_Folder, L"Docs", &pidl));
+
+			// Act
+			HRESULT hr = m_pRoot->BindToStorage(pidl, nullptr, IID_IStream, reinterpret_cast<void**>(&pStream));
+
+			// Assert
+			Assert::AreEqual(E_INVALIDARG, hr);
+			Assert::IsNull(pStream);
+
+			// Cleanup
+			::CoTaskMemFree(pidl);
+		}
+
+		/// <summary>
+		/// Tests that MoveItem moves a file into a folder that doesn't hold one of its name.
+		/// </summary>
+		TEST_METHOD(MoveItem_ToFolder_MovesFile)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+			IShellItem* psiFolder = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			s_pProvider->AddFolder(L"\\Target");
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_Folder, L"Target", &psiFolder));
+
+			// Act
+			HRESULT hr = m_pTransferSource->MoveItem(psiItem, psiFolder, L"a.txt", TSF_NORMAL, nullptr);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::IsFalse(s_pProvider->Exists(L"\\a.txt"));
+			Assert::IsTrue(s_pProvider->Exists(L"\\Target\\a.txt"));
+			Assert::AreEqual(0L, s_pProvider->deleteCount);
+
+			// Cleanup
+			psiFolder->Release();
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that MoveItem leaves an item at the destination alone when TSF_OVERWRITE_EXIST isn't set.
+		/// </summary>
+		TEST_METHOD(MoveItem_DestinationExists_ReturnsAlreadyExists)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+			IShellItem* psiFolder = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			s_pProvider->AddFolder(L"\\Target");
+			s_pProvider->AddFile(L"\\Target\\A.TXT", 20);
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_Folder, L"Target", &psiFolder));
+
+			// Act
+			HRESULT hr = m_pTransferSource->MoveItem(psiItem, psiFolder, L"a.txt", TSF_NORMAL, nullptr);
+
+			// Assert
+			Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS), hr);
+			Assert::IsTrue(s_pProvider->Exists(L"\\a.txt"));
+			Assert::AreEqual(20ULL, s_pProvider->GetSize(L"\\Target\\A.TXT"));
+			Assert::AreEqual(0L, s_pProvider->moveCount);
+			Assert::AreEqual(0L, s_pProvider->deleteCount);
+
+			// Cleanup
+			psiFolder->Release();
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that MoveItem replaces an item at the destination when TSF_OVERWRITE_EXIST is set.
+		/// </summary>
+		TEST_METHOD(MoveItem_DestinationExistsOverwrite_ReplacesItem)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+			IShellItem* psiFolder = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			s_pProvider->AddFolder(L"\\Target");
+			s_pProvider->AddFile(L"\\Target\\a.txt", 20);
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_Folder, L"Target", &psiFolder));
+
+			// Act
+			HRESULT hr = m_pTransferSource->MoveItem(psiItem, psiFolder, L"a.txt", TSF_OVERWRITE_EXIST, nullptr);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::IsFalse(s_pProvider->Exists(L"\\a.txt"));
+			Assert::AreEqual(10ULL, s_pProvider->GetSize(L"\\Target\\a.txt"));
+			Assert::AreEqual(2L, s_pProvider->moveCount);
+			Assert::AreEqual(1L, s_pProvider->deleteCount);
+
+			// Cleanup
+			psiFolder->Release();
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that MoveItem with TSF_OVERWRITE_EXIST puts back the item it was replacing when the move fails,
+		/// rather than having deleted it.
+		/// </summary>
+		TEST_METHOD(MoveItem_DestinationExistsOverwriteMoveFails_KeepsItem)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+			IShellItem* psiFolder = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			s_pProvider->AddFolder(L"\\Target");
+			s_pProvider->AddFile(L"\\Target\\a.txt", 20);
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_Folder, L"Target", &psiFolder));
+
+			// The first MoveFile moves the existing item aside; the second is the move itself
+			s_pProvider->failMoveCall = 2;
+
+			// Act
+			HRESULT hr = m_pTransferSource->MoveItem(psiItem, psiFolder, L"a.txt", TSF_OVERWRITE_EXIST, nullptr);
+
+			// Assert
+			Assert::AreEqual(E_FAIL, hr);
+			Assert::IsTrue(s_pProvider->Exists(L"\\a.txt"));
+			Assert::AreEqual(20ULL, s_pProvider->GetSize(L"\\Target\\a.txt"));
+			Assert::AreEqual(3L, s_pProvider->moveCount);
+			Assert::AreEqual(0L, s_pProvider->deleteCount);
+
+			// Cleanup
+			psiFolder->Release();
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that RenameItem gives a file a name no other item in its folder has.
+		/// </summary>
+		TEST_METHOD(RenameItem_NewName_RenamesFile)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+
+			s_pProvider->AddFolder(L"\\Docs");
+			s_pProvider->AddFile(L"\\Docs\\a.txt", 10);
+			Assert::AreEqual(S_OK, CreateItemInFolder(L"Docs", BigDriveItemType_File, L"a.txt", &psiItem));
+
+			// Act
+			HRESULT hr = m_pTransferSource->RenameItem(psiItem, L"b.txt", TSF_NORMAL, nullptr);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::IsFalse(s_pProvider->Exists(L"\\Docs\\a.txt"));
+			Assert::IsTrue(s_pProvider->Exists(L"\\Docs\\b.txt"));
+
+			// Cleanup
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that RenameItem doesn't take the name of another item when TSF_OVERWRITE_EXIST isn't set.
+		/// </summary>
+		TEST_METHOD(RenameItem_NameTaken_ReturnsAlreadyExists)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			s_pProvider->AddFile(L"\\b.txt", 20);
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+
+			// Act
+			HRESULT hr = m_pTransferSource->RenameItem(psiItem, L"b.txt", TSF_NORMAL, nullptr);
+
+			// Assert
+			Assert::AreEqual(HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS), hr);
+			Assert::IsTrue(s_pProvider->Exists(L"\\a.txt"));
+			Assert::AreEqual(20ULL, s_pProvider->GetSize(L"\\b.txt"));
+			Assert::AreEqual(0L, s_pProvider->moveCount);
+
+			// Cleanup
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that RenameItem picks the next free "Name (n)" when TSF_RENAME_EXIST is set.
+		/// </summary>
+		TEST_METHOD(RenameItem_NameTakenRenameExist_PicksFreeName)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			s_pProvider->AddFile(L"\\b.txt", 20);
+			s_pProvider->AddFile(L"\\b (2).txt", 30);
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+
+			// Act
+			HRESULT hr = m_pTransferSource->RenameItem(psiItem, L"b.txt", TSF_RENAME_EXIST, nullptr);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::IsFalse(s_pProvider->Exists(L"\\a.txt"));
+			Assert::AreEqual(10ULL, s_pProvider->GetSize(L"\\b (3).txt"));
+			Assert::AreEqual(20ULL, s_pProvider->GetSize(L"\\b.txt"));
+			Assert::AreEqual(30ULL, s_pProvider->GetSize(L"\\b (2).txt"));
+
+			// Cleanup
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that RenameItem can change only the case of a name, which matches the item itself.
+		/// </summary>
+		TEST_METHOD(RenameItem_CaseOnly_RenamesFile)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+
+			// Act
+			HRESULT hr = m_pTransferSource->RenameItem(psiItem, L"A.txt", TSF_NORMAL, nullptr);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::IsTrue(s_pProvider->Exists(L"\\A.txt"));
+			Assert::AreEqual(0L, s_pProvider->deleteCount);
+
+			// Cleanup
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Tests that RemoveItem deletes the file from the provider.
+		/// </summary>
+		TEST_METHOD(RemoveItem_File_DeletesFile)
+		{
+			// Arrange
+			IShellItem* psiItem = nullptr;
+
+			s_pProvider->AddFile(L"\\a.txt", 10);
+			s_pProvider->AddFile(L"\\b.txt", 20);
+			Assert::AreEqual(S_OK, CreateItem(BigDriveItemType_File, L"a.txt", &psiItem));
+
+			// Act
+			HRESULT hr = m_pTransferSource->RemoveItem(psiItem, TSF_NORMAL);
+
+			// Assert
+			Assert::AreEqual(S_OK, hr);
+			Assert::IsFalse(s_pProvider->Exists(L"\\a.txt"));
+			Assert::IsTrue(s_pProvider->Exists(L"\\b.txt"));
+			Assert::AreEqual(1L, s_pProvider->deleteCount);
+
+			// Cleanup
+			psiItem->Release();
+		}
+
+		/// <summary>
+		/// Benchmark: copies a 256 MB file out of a provider that reads at 1 GB/s into a local file, as the
+		/// copy engine does, through BindToStorage and straight from the provider's stream. Logs the throughput
+		/// of each; the local disk sets how much the read-ahead can overlap, so neither is asserted.
+		/// </summary>
+		TEST_METHOD(Benchmark_CopyOutThroughput)
+		{
+			// Arrange
+			const ULONGLONG cbFile = 256ULL * 1024 * 1024;
+			LPITEMIDLIST pidl = nullptr;
+			IStream* pStream = nullptr;
+			BigDriveClientTest::MockStream* pDirect = nullptr;
+			LARGE_INTEGER frequency, start, end;
+			ULONGLONG cbDirect = 0, cbReadAhead = 0;
+			wchar_t message[256];
+
+			::QueryPerformanceFrequency(&frequency);
+
+			s_pProvider->AddFile(L"\\big.bin", cbFile);
+			s_pProvider->microsecondsPerMegabyte = 1000;
+			s_pProvider->fillPattern = FALSE;
+			Assert::AreEqual(S_OK, AllocPidl(BigDriveItemType_File, L"big.bin", &pidl));
+
+			// Act: the provider's stream, read as the copy engine reads it
+			pDirect = new BigDriveClientTest::MockStream(cbFile);
+			pDirect->microsecondsPerMegabyte = 1000;
+			pDirect->fillPattern = FALSE;
+
+			::QueryPerformanceCounter(&start);
+			Assert::AreEqual(S_OK, CopyToLocalFile(pDirect, &cbDirect));
+			::QueryPerformanceCounter(&end);
+			double directMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+			// Act: the stream BindToStorage hands the copy engine
+			::QueryPerformanceCounter(&start);
+			Assert::AreEqual(S_OK, m_pRoot->BindToStorage(pidl, nullptr, IID_IStream, reinterpret_cast<void**>(&pStream)));
+			Assert::AreEqual(S_OK, CopyToLocalFile(pStream, &cbReadAhead));
+			::QueryPerformanceCounter(&end);
+			double readAheadMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+			::swprintf_s(message, L"Copy out, provider stream: %.0f ms, %.0f MB/s\n", directMs, (cbFile / (1024.0 * 1024.0)) * 1000.0 / directMs);
+			Logger::WriteMessage(message);
+			::swprintf_s(message, L"Copy out, BindToStorage: %.0f ms, %.0f MB/s\n", readAheadMs, (cbFile / (1024.0 * 1024.0)) * 1000.0 / readAheadMs);
+			Logger::WriteMessage(message);
+
+			// Assert
+			Assert::AreEqual(cbFile, cbDirect);
+			Assert::AreEqual(cbFile, cbReadAhead);
+
+			// Cleanup
+			pStream->Release();
+			pDirect->Release();
+			::CoTaskMemFree(pidl);
+		}
+
+	private:
+
+		/// <summary>
+		/// Allocates the PIDL of a child of the root.
+		/// </summary>
+		static HRESULT AllocPidl(BigDriveItemType nType, LPCWSTR szName, LPITEMIDLIST* ppidl)
+		{
+			BSTR bstrName = ::SysAllocString(szName);
+			HRESULT hr = AllocBigDrivePidlExport(nType, bstrName, ppidl);
+			::SysFreeString(bstrName);
+			return hr;
+		}
+
+		/// <summary>
+		/// Creates the shell item of a child of the root, as the copy engine is handed it.
+		/// </summary>
+		HRESULT CreateItem(BigDriveItemType nType, LPCWSTR szName, IShellItem** ppsi)
+		{
+			LPITEMIDLIST pidl = nullptr;
+			HRESULT hr = AllocPidl(nType, szName, &pidl);
+
+			if (SUCCEEDED(hr))
+			{
+				hr = ::SHCreateItemWithParent(nullptr, m_pRoot, reinterpret_cast<PCUITEMID_CHILD>(pidl), IID_PPV_ARGS(ppsi));
+				::CoTaskMemFree(pidl);
+			}
+
+			return hr;
+		}
+
+		/// <summary>
+		/// Creates the shell item of a child of a folder in the root.
+		/// </summary>
+		HRESULT CreateItemInFolder(LPCWSTR szFolder, BigDriveItemType nType, LPCWSTR szName, IShellItem** ppsi)
+		{
+			LPITEMIDLIST pidlFolder = nullptr;
+			LPITEMIDLIST pidl = nullptr;
+			IShellFolder* pFolder = nullptr;
+			HRESULT hr = AllocPidl(BigDriveItemType_Folder, szFolder, &pidlFolder);
+
+			if (SUCCEEDED(hr))
+			{
+				hr = m_pRoot->BindToObject(pidlFolder, nullptr, IID_IShellFolder, reinterpret_cast<void**>(&pFolder));
+			}
+
+			if (SUCCEEDED(hr))
+			{
+				hr = AllocPidl(nType, szName, &pidl);
+			}
+
+			if (SUCCEEDED(hr))
+			{
+				hr = ::SHCreateItemWithParent(nullptr, pFolder, reinterpret_cast<PCUITEMID_CHILD>(pidl), IID_PPV_ARGS(ppsi));
+			}
+
+			if (pidl)
+			{
+				::CoTaskMemFree(pidl);
+			}
+
+			if (pFolder)
+			{
+				pFolder->Release();
+			}
+
+			if (pidlFolder)
+			{
+				::CoTaskMemFree(pidlFolder);
+			}
+
+			return hr;
+		}
+
+		/// <summary>
+		/// Reads a stream to its end in 1 MB reads and writes it to a temporary file, deleted when closed.
+		/// </summary>
+		static HRESULT CopyToLocalFile(IStream* pStream, ULONGLONG* pcbCopied)
+		{
+			const ULONG cbBuffer = 1024 * 1024;
+			wchar_t szTempPath[MAX_PATH];
+			wchar_t szTempFile[MAX_PATH];
+			BYTE* pBuffer = nullptr;
+			HANDLE hFile = INVALID_HANDLE_VALUE;
+			ULONG cbRead = 0;
+			DWORD cbWritten = 0;
+			HRESULT hr = S_OK;
+
+			*pcbCopied = 0;
+
+			if ((::GetTempPathW(ARRAYSIZE(szTempPath), szTempPath) == 0) || (::GetTempFileNameW(szTempPath, L"bdt", 0, szTempFile) == 0))
+			{
+				return HRESULT_FROM_WIN32(::GetLastError());
+			}
+
+			hFile = ::CreateFileW(szTempFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+			if (hFile == INVALID_HANDLE_VALUE)
+			{
+				return HRESULT_FROM_WIN32(::GetLastError());
+			}
+
+			pBuffer = new BYTE[cbBuffer];
+
+			while (SUCCEEDED(hr = pStream->Read(pBuffer, cbBuffer, &cbRead)) && (cbRead > 0))
+			{
+				if (!::WriteFile(hFile, pBuffer, cbRead, &cbWritten, nullptr))
+				{
+					hr = HRESULT_FROM_WIN32(::GetLastError());
+					break;
+				}
+
+				*pcbCopied += cbRead;
+			}
+
+			delete[] pBuffer;
+			::CloseHandle(hFile);
+
+			return SUCCEEDED(hr) ? S_OK : hr;
+		}
+
+		static MockBigDriveProvider* s_pProvider;
+
+		HRESULT m_hrCoInit = S_OK;
+		IShellFolder* m_pRoot = nullptr;
+		ITransferSource* m_pTransferSource = nullptr;
+	};
+
+	MockBigDriveProvider* BigDriveTransferSourceTests::s_pProvider = nullptr;
+}
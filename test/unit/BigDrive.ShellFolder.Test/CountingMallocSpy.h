@@ -0,0 +1,50 @@
+// <copyright file="CountingMallocSpy.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+#include <windows.h>
+#include <objidl.h>
+
+namespace BigDriveShellFolderTest
+{
+    /// <summary>
+    /// IMallocSpy that counts the allocations made through the COM task allocator while it is registered.
+    /// </summary>
+    class CountingMallocSpy : public IMallocSpy
+    {
+    public:
+
+        LONG allocCount = 0;
+        LONG reallocCount = 0;
+
+        HRESULT __stdcall QueryInterface(REFIID riid, void** ppv) override
+        {
+            if ((riid == IID_IUnknown) || (riid == IID_IMallocSpy))
+            {
+                *ppv = static_cast<IMallocSpy*>(this);
+                return S_OK;
+            }
+
+            *ppv = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG __stdcall AddRef() override { return 1; }
+        ULONG __stdcall Release() override { return 1; }
+
+        SIZE_T __stdcall PreAlloc(SIZE_T cbRequest) override { allocCount++; return cbRequest; }
+        void* __stdcall PostAlloc(void* pActual) override { return pActual; }
+        void* __stdcall PreFree(void* pRequest, BOOL) override { return pRequest; }
+        void __stdcall PostFree(BOOL) override { }
+        SIZE_T __stdcall PreRealloc(void* pRequest, SIZE_T cbRequest, void** ppNewRequest, BOOL) override { reallocCount++; *ppNewRequest = pRequest; return cbRequest; }
+        void* __stdcall PostRealloc(void* pActual, BOOL) override { return pActual; }
+        void* __stdcall PreGetSize(void* pRequest, BOOL) override { return pRequest; }
+        SIZE_T __stdcall PostGetSize(SIZE_T cbActual, BOOL) override { return cbActual; }
+        void* __stdcall PreDidAlloc(void* pRequest, BOOL) override { return pRequest; }
+        int __stdcall PostDidAlloc(void*, BOOL, int fActual) override { return fActual; }
+        void __stdcall PreHeapMinimize() override { }
+        void __stdcall PostHeapMinimize() override { }
+    };
+}
@@ -0,0 +1,444 @@
+// <copyright file="MockBigDriveProvider.h" company="Wayne Walter Berry">
+// Copyright (c) Wayne Walter Berry. All rights reserved.
+// </copyright>
+
+#pragma once
+
+// System
+#include <windows.h>
+#include <oaidl.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Local
+#include "..\..\..\src\BigDrive.Client\Interfaces\IBigDriveConfiguration.h"
+#include "..\..\..\src\BigDrive.Client\Interfaces\IBigDriveEnumerate.h"
+#include "..\..\..\src\BigDrive.Client\Interfaces\IBigDriveFileData.h"
+#include "..\..\..\src\BigDrive.Client\Interfaces\IBigDriveFileOperations.h"
+#include "..\BigDrive.Client.Test\MockStream.h"
+
+namespace BigDriveShellFolderTest
+{
+	/// <summary>
+	/// In-process stand-in for a provider and for the BigDrive service that hands out its drive's configuration.
+	/// Register makes it the class object of the provider CLSID and of CLSID_BigDriveConfiguration, so the shell
+	/// folder reaches it through the same CoCreateInstance calls it makes for a COM+ provider.
+	///
+	/// The drive is a set of paths held in memory. Implements IBigDriveEnumerate over them, IBigDriveFileData
+	/// with a MockStream of each file's size, and the MoveFile and DeleteFile of IBigDriveFileOperations; like
+	/// a provider, MoveFile does not replace an item at the destination. Aggregates the free-threaded marshaler,
+	/// so the connection pool can hold it in the Global Interface Table without a registered proxy/stub.
+	/// Calls are made from one thread at a time.
+	/// </summary>
+	class MockBigDriveProvider : public IBigDriveEnumerate, public IBigDriveFileData, public IBigDriveFileOperations,
+		public IBigDriveConfiguration, public IClassFactory
+	{
+	private:
+
+		struct Item
+		{
+			bool fFolder;
+			ULONGLONG size;
+		};
+
+		volatile LONG m_refCount;
+		IUnknown* m_pMarshaler;
+		GUID m_driveGuid;
+		CLSID m_clsid;
+		DWORD m_dwProviderCookie;
+		DWORD m_dwConfigurationCookie;
+		std::map<std::wstring, Item> m_items;
+
+	public:
+
+		/// <summary>
+		/// Number of MoveFile calls.
+		/// </summary>
+		LONG moveCount;
+
+		/// <summary>
+		/// Number of DeleteFile calls.
+		/// </summary>
+		LONG deleteCount;
+
+		/// <summary>
+		/// The MoveFile call, counting from one, that fails with E_FAIL and moves nothing. Zero for none.
+		/// </summary>
+		LONG failMoveCall;
+
+		/// <summary>
+		/// Microseconds each megabyte read from a file spins for, to simulate a provider. Zero for none.
+		/// </summary>
+		ULONG microsecondsPerMegabyte;
+
+		/// <summary>
+		/// FALSE to skip writing the pattern of the files read, for benchmarks that don't check the bytes.
+		/// </summary>
+		BOOL fillPattern;
+
+		MockBigDriveProvider(REFGUID driveGuid, REFCLSID clsid)
+			: m_refCount(1), m_pMarshaler(nullptr), m_driveGuid(driveGuid), m_clsid(clsid), m_dwProviderCookie(0), m_dwConfigurationCookie(0),
+			moveCount(0), deleteCount(0), failMoveCall(0), microsecondsPerMegabyte(0), fillPattern(TRUE)
+		{
+			if (FAILED(::CoCreateFreeThreadedMarshaler(static_cast<IBigDriveEnumerate*>(this), &m_pMarshaler)))
+			{
+				m_pMarshaler = nullptr;
+			}
+		}
+
+		virtual ~MockBigDriveProvider()
+		{
+			if (m_pMarshaler)
+			{
+				m_pMarshaler->Release();
+				m_pMarshaler = nullptr;
+			}
+		}
+
+		/// <summary>
+		/// Makes this the class object of the provider and of the configuration service, for the calling apartment.
+		/// </summary>
+		HRESULT Register()
+		{
+			HRESULT hr = ::CoRegisterClassObject(m_clsid, static_cast<IClassFactory*>(this), CLSCTX_LOCAL_SERVER, REGCLS_MULTIPLEUSE, &m_dwProviderCookie);
+			if (FAILED(hr))
+			{
+				return hr;
+			}
+
+			hr = ::CoRegisterClassObject(CLSID_BigDriveConfiguration, static_cast<IClassFactory*>(this), CLSCTX_LOCAL_SERVER, REGCLS_MULTIPLEUSE, &m_dwConfigurationCookie);
+			if (FAILED(hr))
+			{
+				Revoke();
+			}
+
+			return hr;
+		}
+
+		/// <summary>
+		/// Undoes Register. Call before the apartment ends.
+		/// </summary>
+		void Revoke()
+		{
+			if (m_dwConfigurationCookie != 0)
+			{
+				::CoRevokeClassObject(m_dwConfigurationCookie);
+				m_dwConfigurationCookie = 0;
+			}
+
+			if (m_dwProviderCookie != 0)
+			{
+				::CoRevokeClassObject(m_dwProviderCookie);
+				m_dwProviderCookie = 0;
+			}
+		}
+
+		/// <summary>
+		/// Empties the drive and zeroes the counters.
+		/// </summary>
+		void Reset()
+		{
+			m_items.clear();
+			moveCount = 0;
+			deleteCount = 0;
+			failMoveCall = 0;
+			microsecondsPerMegabyte = 0;
+			fillPattern = TRUE;
+		}
+
+		void AddFolder(LPCWSTR szPath)
+		{
+			m_items[szPath] = { true, 0 };
+		}
+
+		void AddFile(LPCWSTR szPath, ULONGLONG size)
+		{
+			m_items[szPath] = { false, size };
+		}
+
+		bool Exists(LPCWSTR szPath) const
+		{
+			return m_items.find(szPath) != m_items.end();
+		}
+
+		/// <summary>
+		/// Size of a file, or ULLONG_MAX if there is none at the path.
+		/// </summary>
+		ULONGLONG GetSize(LPCWSTR szPath) const
+		{
+			std::map<std::wstring, Item>::const_iterator it = m_items.find(szPath);
+			return (it != m_items.end()) ? it->second.size : ULLONG_MAX;
+		}
+
+		// IUnknown methods
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+		{
+			if (ppvObject == nullptr)
+			{
+				return E_POINTER;
+			}
+
+			if (riid == IID_IUnknown || riid == IID_IBigDriveEnumerate)
+			{
+				*ppvObject = static_cast<IBigDriveEnumerate*>(this);
+			}
+			else if (riid == IID_IBigDriveFileData)
+			{
+				*ppvObject = static_cast<IBigDriveFileData*>(this);
+			}
+			else if (riid == IID_IBigDriveFileOperations)
+			{
+				*ppvObject = static_cast<IBigDriveFileOperations*>(this);
+			}
+			else if (riid == IID_IBigDriveConfiguration)
+			{
+				*ppvObject = static_cast<IBigDriveConfiguration*>(this);
+			}
+			else if (riid == IID_IClassFactory)
+			{
+				*ppvObject = static_cast<IClassFactory*>(this);
+			}
+			else if ((riid == IID_IMarshal) && (m_pMarshaler != nullptr))
+			{
+				return m_pMarshaler->QueryInterface(riid, ppvObject);
+			}
+			else
+			{
+				*ppvObject = nullptr;
+				return E_NOINTERFACE;
+			}
+
+			AddRef();
+			return S_OK;
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() override
+		{
+			return static_cast<ULONG>(::InterlockedIncrement(&m_refCount));
+		}
+
+		ULONG STDMETHODCALLTYPE Release() override
+		{
+			LONG refCount = ::InterlockedDecrement(&m_refCount);
+			if (refCount == 0)
+			{
+				delete this;
+			}
+
+			return static_cast<ULONG>(refCount);
+		}
+
+		// IClassFactory methods
+		HRESULT STDMETHODCALLTYPE CreateInstance(IUnknown* pUnkOuter, REFIID riid, void** ppvObject) override
+		{
+			if (pUnkOuter != nullptr)
+			{
+				return CLASS_E_NOAGGREGATION;
+			}
+
+			// The one instance serves every activation, so a test can look at what the shell folder did
+			return QueryInterface(riid, ppvObject);
+		}
+
+		HRESULT STDMETHODCALLTYPE LockServer(BOOL /*fLock*/) override
+		{
+			return S_OK;
+		}
+
+		// IBigDriveConfiguration methods
+		HRESULT STDMETHODCALLTYPE GetConfiguration(REFGUID guid, wchar_t** configuration) override
+		{
+			wchar_t szDrive[40];
+			wchar_t szClsid[40];
+			wchar_t szConfiguration[256];
+
+			if (!::IsEqualGUID(guid, m_driveGuid))
+			{
+				return E_INVALIDARG;
+			}
+
+			::StringFromGUID2(m_driveGuid, szDrive, ARRAYSIZE(szDrive));
+			::StringFromGUID2(m_clsid, szClsid, ARRAYSIZE(szClsid));
+
+			// The service writes GUIDs without their braces
+			::swprintf_s(szConfiguration, L"{\"id\":\"%.36s\",\"name\":\"Mock\",\"clsid\":\"%.36s\"}", szDrive + 1, szClsid + 1);
+
+			*configuration = ::SysAllocString(szConfiguration);
+
+			return (*configuration != nullptr) ? S_OK : E_OUTOFMEMORY;
+		}
+
+		// IBigDriveEnumerate methods
+		HRESULT STDMETHODCALLTYPE EnumerateFolders(REFGUID driveGuid, BSTR path, SAFEARRAY** folders) override
+		{
+			return CreateNames(path, true, folders);
+		}
+
+		HRESULT STDMETHODCALLTYPE EnumerateFiles(REFGUID driveGuid, BSTR path, SAFEARRAY** files) override
+		{
+			return CreateNames(path, false, files);
+		}
+
+		// IBigDriveFileData methods
+		HRESULT STDMETHODCALLTYPE GetFileData(REFGUID driveGuid, BSTR path, IStream** ppStream) override
+		{
+			std::map<std::wstring, Item>::const_iterator it = m_items.find(path);
+			BigDriveClientTest::MockStream* pStream = nullptr;
+
+			*ppStream = nullptr;
+
+			if ((it == m_items.end()) || it->second.fFolder)
+			{
+				return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+			}
+
+			pStream = new BigDriveClientTest::MockStream(it->second.size);
+			pStream->microsecondsPerMegabyte = microsecondsPerMegabyte;
+			pStream->fillPattern = fillPattern;
+
+			*ppStream = pStream;
+
+			return S_OK;
+		}
+
+		// IBigDriveFileOperations methods
+		HRESULT STDMETHODCALLTYPE CopyFileToBigDrive(REFCLSID driveGuid, LPCWSTR localFilePath, LPCWSTR bigDriveTargetPath) override
+		{
+			return E_NOTIMPL;
+		}
+
+		HRESULT STDMETHODCALLTYPE CopyFileFromBigDrive(REFCLSID driveGuid, LPCWSTR bigDriveFilePath, LPCWSTR localTargetPath) override
+		{
+			return E_NOTIMPL;
+		}
+
+		HRESULT STDMETHODCALLTYPE DeleteFile(REFCLSID driveGuid, LPCWSTR bigDriveFilePath) override
+		{
+			deleteCount++;
+
+			if (!Exists(bigDriveFilePath))
+			{
+				return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+			}
+
+			Rename(bigDriveFilePath, nullptr);
+
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE CreateDirectory(REFCLSID driveGuid, LPCWSTR bigDriveDirectoryPath) override
+		{
+			return E_NOTIMPL;
+		}
+
+		HRESULT STDMETHODCALLTYPE OpenFile(REFCLSID driveGuid, LPCWSTR bigDriveFilePath, HWND hwndParent) override
+		{
+			return E_NOTIMPL;
+		}
+
+		HRESULT STDMETHODCALLTYPE MoveFile(REFCLSID driveGuid, LPCWSTR sourcePath, LPCWSTR destinationPath) override
+		{
+			moveCount++;
+
+			if (moveCount == failMoveCall)
+			{
+				return E_FAIL;
+			}
+
+			if (!Exists(sourcePath))
+			{
+				return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+			}
+
+			if (Exists(destinationPath))
+			{
+				return HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+			}
+
+			Rename(sourcePath, destinationPath);
+
+			return S_OK;
+		}
+
+	private:
+
+		/// <summary>
+		/// Moves an item and everything under it to a new path, or removes them when szTo is nullptr.
+		/// </summary>
+		void Rename(LPCWSTR szFrom, LPCWSTR szTo)
+		{
+			std::wstring from(szFrom);
+			std::wstring prefix = from + L"\\";
+			std::vector<std::pair<std::wstring, Item>> moved;
+			std::map<std::wstring, Item>::iterator it = m_items.begin();
+
+			while (it != m_items.end())
+			{
+				if ((it->first == from) || (it->first.compare(0, prefix.size(), prefix) == 0))
+				{
+					if (szTo != nullptr)
+					{
+						moved.push_back(std::make_pair(szTo + it->first.substr(from.size()), it->second));
+					}
+
+					it = m_items.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			for (size_t i = 0; i < moved.size(); i++)
+			{
+				m_items[moved[i].first] = moved[i].second;
+			}
+		}
+
+		/// <summary>
+		/// Creates a SAFEARRAY of the names of the folders or files directly in a folder.
+		/// </summary>
+		HRESULT CreateNames(BSTR path, bool fFolders, SAFEARRAY** ppNames)
+		{
+			std::wstring prefix(path);
+			std::vector<std::wstring> names;
+			LONG index = 0;
+			BSTR bstrName = nullptr;
+
+			if (ppNames == nullptr)
+			{
+				return E_POINTER;
+			}
+
+			if (prefix.empty() || (prefix[prefix.size() - 1] != L'\\'))
+			{
+				prefix += L"\\";
+			}
+
+			for (std::map<std::wstring, Item>::const_iterator it = m_items.begin(); it != m_items.end(); ++it)
+			{
+				if ((it->second.fFolder == fFolders) && (it->first.compare(0, prefix.size(), prefix) == 0) &&
+					(it->first.find(L'\\', prefix.size()) == std::wstring::npos))
+				{
+					names.push_back(it->first.substr(prefix.size()));
+				}
+			}
+
+			*ppNames = ::SafeArrayCreateVector(VT_BSTR, 0, static_cast<ULONG>(names.size()));
+			if (*ppNames == nullptr)
+			{
+				return E_OUTOFMEMORY;
+			}
+
+			for (index = 0; index < static_cast<LONG>(names.size()); index++)
+			{
+				bstrName = ::SysAllocString(names[index].c_str());
+				::SafeArrayPutElement(*ppNames, &index, bstrName);
+				::SysFreeString(bstrName);
+			}
+
+			return S_OK;
+		}
+	};
+}